@@ -0,0 +1,418 @@
+#include "pch.h"
+#include "BinaryLogBenchmark.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+#include <binary_log_decoder.h>
+#include <spdlog/sinks/daily_file_sink.h>
+
+namespace
+{
+    using namespace CommonBenchmark;
+    using Clock = std::chrono::steady_clock;
+
+    // A type only fmt knows how to format, which the binary log formats at the call
+    struct Size
+    {
+        int width;
+        int height;
+    };
+}
+
+template<>
+struct fmt::formatter<Size> : fmt::formatter<std::string_view>
+{
+    template<typename FormatContext>
+    auto format(const Size& size, FormatContext& context) const
+    {
+        return fmt::formatter<std::string_view>::format(fmt::format("{}x{}", size.width, size.height), context);
+    }
+};
+
+namespace
+{
+    // A fresh directory in the temp folder, removed with what was written in it
+    class TempDirectory
+    {
+    public:
+        TempDirectory() :
+            path{ std::filesystem::temp_directory_path() / ("CommonBenchmark-binary-log-" + std::to_string(std::random_device{}())) }
+        {
+            std::filesystem::create_directories(path);
+        }
+
+        ~TempDirectory()
+        {
+            std::error_code error;
+            std::filesystem::remove_all(path, error);
+        }
+
+        spdlog::filename_t File(const std::string& name) const
+        {
+            return (path / name).native();
+        }
+
+        // The daily files written in the directory, as one
+        std::string Read() const
+        {
+            std::string data;
+            for (const auto& file : std::filesystem::directory_iterator(path))
+            {
+                std::ifstream stream{ file.path(), std::ios::binary };
+                data.append(std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{});
+            }
+
+            return data;
+        }
+
+        uint64_t Size() const
+        {
+            uint64_t size = 0;
+            for (const auto& file : std::filesystem::directory_iterator(path))
+            {
+                size += file.file_size();
+            }
+
+            return size;
+        }
+
+    private:
+        std::filesystem::path path;
+    };
+
+    // Logs through the writer, and keeps what fmt makes of the same call
+    class Expectations
+    {
+    public:
+        explicit Expectations(BinaryLogWriter& writer) :
+            writer{ writer }
+        {
+        }
+
+        template<typename... Args>
+        void Add(const binary_log::literal<char> format, const Args&... args)
+        {
+            writer.log(spdlog::level::info, format, args...);
+            messages.push_back(fmt::format(fmt::runtime(format.data()), args...));
+        }
+
+        template<typename... Args>
+        void Add(const binary_log::literal<wchar_t> format, const Args&... args)
+        {
+            writer.log(spdlog::level::info, format, args...);
+            const auto message = fmt::format(fmt::runtime(format.data()), args...);
+            messages.push_back(binary_log::to_utf8(message.data(), message.size()));
+        }
+
+        std::vector<std::string> messages;
+
+    private:
+        BinaryLogWriter& writer;
+    };
+
+    std::vector<binary_log::event> Decode(const std::string& data, binary_log::decode_result& result)
+    {
+        std::vector<binary_log::event> events;
+        result = binary_log::decode(data, [&events](const binary_log::event& e) { events.push_back(e); });
+        return events;
+    }
+
+    std::vector<std::string> Messages(const std::vector<binary_log::event>& events)
+    {
+        std::vector<std::string> messages;
+        for (const auto& e : events)
+        {
+            messages.push_back(e.message);
+        }
+
+        return messages;
+    }
+
+    CheckResult CheckRoundTrip()
+    {
+        CheckResult result{ .name = L"Binary log round trip" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        TempDirectory directory;
+        const auto before = std::chrono::system_clock::now();
+        std::vector<std::string> expected;
+        {
+            BinaryLogWriter writer{ directory.File("round-trip.bin") };
+            Expectations log{ writer };
+            log.Add("no arguments");
+            log.Add("{} {} {} {}", -1, 0, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max());
+            log.Add("{} {} {}", std::numeric_limits<uint64_t>::max(), static_cast<unsigned char>(200), static_cast<short>(-300));
+            log.Add("{:#x} {:>8} {:<6}| {:+} {:08b}", 0x10000u, 42, -7, 5, 5);
+            log.Add("{} {}", true, false);
+            log.Add("{} {:>3} {:d}", 'a', 'b', 'c');
+            log.Add("{} {} {:.3f} {:08.2f} {:e}", 0.1f, 0.1, 3.14159, -2.5, 1e300);
+            log.Add("[{}] [{}] [{}] [{}]", std::string{ "string" }, "literal", std::string_view{ "view" }, std::string{});
+            log.Add("{} {}", nullptr, static_cast<const void*>(&expected));
+            log.Add("{:{}}- {} Enter", "", 6, "CallTracer");
+            log.Add("{} and {:>10}", Size{ 1920, 1080 }, Size{ 4, 3 });
+            log.Add(L"{} {} {} {:>3}", std::wstring{ L"café €" }, L"wide literal", std::wstring_view{ L"\U0001F600" }, L'ü');
+            log.Add(L"wide format {} {:.1f} {:#x} {}", std::wstring{ L"über" }, 1.5, 255, true);
+            log.Add("{{braces}} {}", "kept");
+
+            // Only literals are identified by their address, a buffer is passed as a pointer and formatted at the call
+            char buffer[16] = "buffer {}";
+            writer.log(spdlog::level::info, static_cast<const char*>(buffer), 1);
+            log.messages.push_back("buffer 1");
+            std::memcpy(buffer, "reused {}", sizeof("reused {}"));
+            writer.log(spdlog::level::info, static_cast<const char*>(buffer), 2);
+            log.messages.push_back("reused 2");
+
+            // Format strings which aren't literals are formatted at the call
+            const std::string runtime = "runtime {} {:>4}";
+            writer.log(spdlog::level::warn, runtime, 7, "x");
+            const std::wstring wideRuntime = L"wide runtime {}";
+            writer.log(spdlog::level::err, wideRuntime, L"é");
+            writer.log(spdlog::level::critical, std::string{ "not a {valid format" });
+            expected = log.messages;
+            expected.push_back("runtime 7    x");
+            expected.push_back("wide runtime \xc3\xa9");
+            expected.push_back("not a {valid format");
+        }
+
+        binary_log::decode_result decoded;
+        const auto events = Decode(directory.Read(), decoded);
+        const auto after = std::chrono::system_clock::now();
+        check(decoded.complete && decoded.error.empty() && decoded.events == expected.size());
+        check(decoded.process_id == static_cast<uint64_t>(spdlog::details::os::pid()));
+        check(Messages(events) == expected);
+
+        // Times are kept to the microsecond and in order, as the calls were made from one thread
+        bool timed = !events.empty();
+        for (size_t i = 0; i < events.size(); ++i)
+        {
+            timed = timed && events[i].time >= std::chrono::time_point_cast<std::chrono::microseconds>(before) && events[i].time <= after &&
+                    (i == 0 || events[i].time >= events[i - 1].time) && events[i].thread_id == spdlog::details::os::thread_id();
+        }
+        check(timed);
+
+        const auto levels = std::vector<spdlog::level::level_enum>{ spdlog::level::warn, spdlog::level::err, spdlog::level::critical };
+        check(events.size() == expected.size() &&
+              std::equal(levels.begin(), levels.end(), events.end() - 3, [](const auto level, const auto& e) { return e.level == level; }) &&
+              events.front().level == spdlog::level::info);
+
+        // Rendered as the pattern Logger::init gives the text log
+        std::string line;
+        binary_log::render(events.front(), line);
+        const auto suffix = "] [p-" + std::to_string(decoded.process_id) + "] [t-" + std::to_string(events.front().thread_id) + "] [info] no arguments\n";
+        check(line.size() == 27 + suffix.size() && line[0] == '[' && line.compare(27, std::string::npos, suffix) == 0);
+        return result;
+    }
+
+    // Formats are written once per call site, and calls sharing a format string with other types get their own
+    CheckResult CheckCallSites()
+    {
+        CheckResult result{ .name = L"Binary log call sites" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        TempDirectory directory;
+        uint64_t firstSize = 0;
+        {
+            BinaryLogWriter writer{ directory.File("sites.bin") };
+            static constexpr char shared[] = "shared {}";
+            for (int i = 0; i < 1000; ++i)
+            {
+                writer.log(spdlog::level::debug, "call site {}", i);
+                if (i == 0)
+                {
+                    writer.flush();
+                    firstSize = directory.Size();
+                }
+            }
+
+            writer.log(spdlog::level::info, shared, 1);
+            writer.log(spdlog::level::info, shared, "one");
+            writer.log(spdlog::level::info, shared, 2);
+        }
+
+        binary_log::decode_result decoded;
+        const auto events = Decode(directory.Read(), decoded);
+        check(decoded.complete && decoded.events == 1003 && decoded.formats == 3);
+        check(events.size() == 1003 && events[999].message == "call site 999" && events[1000].message == "shared 1" &&
+              events[1001].message == "shared one" && events[1002].message == "shared 2");
+
+        // After the first call, the header and the format, an event is its kind, id, time, thread and argument
+        check(firstSize > 0 && (directory.Size() - firstSize) / 999 < 12);
+        return result;
+    }
+
+    // A file cut anywhere, as a crash leaves it, decodes up to the last whole event
+    CheckResult CheckTruncation()
+    {
+        CheckResult result{ .name = L"Binary log truncation" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        TempDirectory directory;
+        {
+            BinaryLogWriter writer{ directory.File("truncated.bin") };
+            for (int i = 0; i < 50; ++i)
+            {
+                writer.log(spdlog::level::info, "event {} of {}", i, std::wstring{ L"truncation" });
+                writer.log(spdlog::level::trace, "{:.2f}", i / 3.0);
+            }
+        }
+
+        const auto data = directory.Read();
+        binary_log::decode_result full;
+        const auto all = Messages(Decode(data, full));
+        check(full.complete && full.events == 100);
+
+        bool prefixes = true;
+        bool counts = true;
+        uint64_t previous = 0;
+        for (size_t size = 0; size < data.size(); ++size)
+        {
+            binary_log::decode_result cut;
+            const auto messages = Messages(Decode(data.substr(0, size), cut));
+            prefixes = prefixes && std::equal(messages.begin(), messages.end(), all.begin()) && cut.error.empty();
+            counts = counts && cut.events >= previous && cut.events < 100;
+            previous = cut.events;
+        }
+
+        check(prefixes);
+        check(counts && previous == 99);
+
+        // Not a binary log at all
+        binary_log::decode_result text;
+        check(Decode("[2024-01-01 00:00:00.000000] [p-1] [t-1] [info] text\n", text).empty() && !text.error.empty());
+        return result;
+    }
+
+    CheckResult CheckLevels()
+    {
+        CheckResult result{ .name = L"Binary log levels" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        TempDirectory directory;
+        BinaryLogWriter writer{ directory.File("levels.bin") };
+        writer.set_level(spdlog::level::info);
+        writer.log(spdlog::level::trace, "dropped {}", 1);
+        writer.log(spdlog::level::debug, "dropped {}", 2);
+        writer.log(spdlog::level::info, "written {}", 3);
+        writer.log(spdlog::level::warn, "written {}", 4);
+
+        // The first write is flushed, as no flush happened for over a second, the next ones wait
+        const auto flushed = directory.Size();
+        check(flushed > 0);
+        writer.log(spdlog::level::err, "written {}", 5);
+        check(directory.Size() > flushed);
+
+        binary_log::decode_result decoded;
+        check(Messages(Decode(directory.Read(), decoded)) == std::vector<std::string>{ "written 3", "written 4", "written 5" });
+        return result;
+    }
+
+    struct Workload
+    {
+        uint32_t messages;
+
+        // The call tracer entering and leaving a function, a window moving between zones, and settings being applied
+        template<typename Log>
+        void Run(Log&& log) const
+        {
+            static constexpr const char* modules[] = { "FancyZones", "Keyboard Manager", "Always On Top", "Mouse Utilities" };
+            for (uint32_t i = 0; i < messages; ++i)
+            {
+                switch (i % 4)
+                {
+                case 0:
+                    log("{:{}}- {} Enter", "", 2 * (i % 8), "FancyZones::WindowMoveHandler::MoveSizeUpdate");
+                    break;
+                case 1:
+                    log("Window {:#x} moved to zone {} of monitor {}, {}x{}", 0x10000 + i, i % 16, i % 3, 1920, 1080);
+                    break;
+                case 2:
+                    log("Settings of {} applied in {:.2f} ms, {} hotkeys registered", modules[i % 4], i / 1000.0, i % 12);
+                    break;
+                default:
+                    log("{:{}}- {} Exit", "", 2 * (i % 8), "FancyZones::WindowMoveHandler::MoveSizeUpdate");
+                    break;
+                }
+            }
+        }
+    };
+
+    BinaryLogResult RunText(std::wstring name, const Workload& workload, const spdlog::level::level_enum flushLevel)
+    {
+        TempDirectory directory;
+        double seconds = 0;
+        {
+            // The way Logger::init sets the logger up, with the default trace level
+            auto logger = std::make_shared<spdlog::logger>("benchmark", std::make_shared<spdlog::sinks::daily_file_sink_mt>(directory.File("text-log.txt"), 0, 0, false, 30));
+            logger->set_level(spdlog::level::trace);
+            logger->set_pattern("[%Y-%m-%d %H:%M:%S.%f] [p-%P] [t-%t] [%l] %v");
+            logger->flush_on(flushLevel);
+
+            const auto start = Clock::now();
+            workload.Run([&logger](const auto& format, const auto&... args) { logger->info(fmt::runtime(format), args...); });
+            seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        BinaryLogResult result{ .format = std::move(name), .messages = workload.messages };
+        result.nsPerMessage = seconds * 1e9 / workload.messages;
+        result.bytesPerMessage = static_cast<double>(directory.Size()) / workload.messages;
+        return result;
+    }
+}
+
+namespace CommonBenchmark
+{
+    std::vector<CheckResult> RunBinaryLogChecks()
+    {
+        return { CheckRoundTrip(), CheckCallSites(), CheckTruncation(), CheckLevels() };
+    }
+
+    std::vector<BinaryLogResult> RunBinaryLogBenchmark(const uint32_t messages)
+    {
+        const Workload workload{ messages };
+        std::vector<BinaryLogResult> results;
+        results.push_back(RunText(L"Text", workload, spdlog::level::trace));
+        results.push_back(RunText(L"Text, no flush", workload, spdlog::level::err));
+
+        TempDirectory directory;
+        {
+            BinaryLogWriter writer{ directory.File("binary-log.bin") };
+            const auto start = Clock::now();
+            workload.Run([&writer](const binary_log::literal<char> format, const auto&... args) { writer.log(spdlog::level::info, format, args...); });
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+            BinaryLogResult result{ .format = L"Binary", .messages = messages };
+            result.nsPerMessage = seconds * 1e9 / messages;
+            results.push_back(result);
+        }
+
+        results.back().bytesPerMessage = static_cast<double>(directory.Size()) / messages;
+
+        // Offline, back to the text of the text log
+        const auto data = directory.Read();
+        std::string text;
+        const auto start = Clock::now();
+        const auto decoded = binary_log::decode(data, [&text](const binary_log::event& e) { binary_log::render(e, text); });
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        BinaryLogResult result{ .format = L"Binary, decoded", .messages = decoded.events };
+        result.nsPerMessage = seconds * 1e9 / static_cast<double>(std::max<uint64_t>(1, decoded.events));
+        result.bytesPerMessage = static_cast<double>(text.size()) / static_cast<double>(std::max<uint64_t>(1, decoded.events));
+        results.push_back(result);
+        return results;
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+namespace CommonBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Every argument type and format spec decoded as fmt formats it, formats written once per call site, files cut at
+    // any byte, and levels of BinaryLogWriter
+    std::vector<CheckResult> RunBinaryLogChecks();
+
+    struct BinaryLogResult
+    {
+        std::wstring format;
+        uint64_t messages = {};
+        // Time spent in the logging call, per message
+        double nsPerMessage = {};
+        // Size of the log files, or of the text decoded from them, per message
+        double bytesPerMessage = {};
+    };
+
+    // The text log, flushing on every message as Logger::init sets it up and without flushing, against the binary log
+    // and decoding it, for a mix of call tracer, window and settings messages
+    std::vector<BinaryLogResult> RunBinaryLogBenchmark(uint32_t messages);
+}
@@ -0,0 +1,334 @@
+#include "pch.h"
+#include "LegacyPipe.h"
+
+#include <pipe_session.h>
+
+#ifndef _WIN32
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr size_t blockBytes = 1024;
+
+#ifndef _WIN32
+    std::string SocketPath(const std::wstring& name)
+    {
+        return std::string(name.begin(), name.end());
+    }
+
+    bool MakeAddress(const std::wstring& name, sockaddr_un& address)
+    {
+        const auto path = SocketPath(name);
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            return false;
+        }
+
+        address.sun_family = AF_UNIX;
+        path.copy(address.sun_path, path.size());
+        return true;
+    }
+#endif
+}
+
+namespace CommonBenchmark
+{
+    LegacyPipe::LegacyPipe(std::wstring inputName, std::wstring outputName, std::function<void(std::wstring)> onMessage) :
+        _inputName{ std::move(inputName) }, _outputName{ std::move(outputName) }, _onMessage{ std::move(onMessage) }
+    {
+    }
+
+    LegacyPipe::~LegacyPipe()
+    {
+        End();
+    }
+
+    void LegacyPipe::Start()
+    {
+        _sendThread = std::thread(&LegacyPipe::SendQueued, this);
+        _listenThread = std::thread(&LegacyPipe::Listen, this);
+    }
+
+    void LegacyPipe::Send(std::wstring message)
+    {
+        _outputQueue.queue_message(std::move(message));
+    }
+
+    void LegacyPipe::End()
+    {
+        if (_closed.exchange(true))
+        {
+            return;
+        }
+
+        _outputQueue.interrupt();
+        if (_sendThread.joinable())
+        {
+            _sendThread.join();
+        }
+
+        {
+            std::unique_lock lock{ _listeningMutex };
+            if (_listening != -1)
+            {
+#ifdef _WIN32
+                CancelIoEx(reinterpret_cast<HANDLE>(_listening), nullptr);
+#else
+                shutdown(static_cast<int>(_listening), SHUT_RDWR);
+#endif
+            }
+        }
+
+        if (_listenThread.joinable())
+        {
+            _listenThread.join();
+        }
+
+        std::unique_lock lock{ _readersMutex };
+        _readersDone.wait(lock, [this] { return _readers == 0; });
+    }
+
+    void LegacyPipe::SendQueued()
+    {
+        while (!_closed)
+        {
+            const std::wstring message = _outputQueue.pop_message();
+            if (message.empty())
+            {
+                break;
+            }
+
+            SendOne(message);
+        }
+    }
+
+#ifdef _WIN32
+    bool LegacyPipe::SendOne(const std::wstring& message)
+    {
+        HANDLE pipe;
+        while (true)
+        {
+            pipe = CreateFile(_outputName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+            if (pipe != INVALID_HANDLE_VALUE)
+            {
+                break;
+            }
+
+            if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipe(_outputName.c_str(), 20000))
+            {
+                return false;
+            }
+        }
+
+        DWORD mode = PIPE_READMODE_MESSAGE;
+        DWORD written = 0;
+        const bool sent = SetNamedPipeHandleState(pipe, &mode, nullptr, nullptr) &&
+                          WriteFile(pipe, message.data(), static_cast<DWORD>(message.size() * sizeof(wchar_t)), &written, nullptr);
+        CloseHandle(pipe);
+        return sent;
+    }
+
+    void LegacyPipe::Listen()
+    {
+        while (!_closed)
+        {
+            HANDLE pipe;
+            {
+                std::unique_lock lock{ _listeningMutex };
+                pipe = CreateNamedPipe(_inputName.c_str(),
+                                       PIPE_ACCESS_DUPLEX,
+                                       PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT,
+                                       PIPE_UNLIMITED_INSTANCES,
+                                       blockBytes,
+                                       blockBytes,
+                                       0,
+                                       nullptr);
+                if (pipe == INVALID_HANDLE_VALUE)
+                {
+                    return;
+                }
+
+                _listening = reinterpret_cast<intptr_t>(pipe);
+            }
+
+            const bool connected = ConnectNamedPipe(pipe, nullptr) || GetLastError() == ERROR_PIPE_CONNECTED;
+            {
+                std::unique_lock lock{ _listeningMutex };
+                _listening = -1;
+            }
+
+            if (!connected || _closed)
+            {
+                CloseHandle(pipe);
+                continue;
+            }
+
+            {
+                std::unique_lock lock{ _readersMutex };
+                ++_readers;
+            }
+
+            ++_threadsStarted;
+            std::thread(&LegacyPipe::ReadConnection, this, reinterpret_cast<intptr_t>(pipe)).detach();
+        }
+    }
+
+    void LegacyPipe::ReadConnection(const intptr_t connection)
+    {
+        const auto pipe = reinterpret_cast<HANDLE>(connection);
+        std::wstring message;
+        size_t block = 0;
+        bool complete;
+        do
+        {
+            constexpr size_t charsPerBlock = blockBytes / sizeof(wchar_t);
+            message.resize(message.size() + charsPerBlock);
+            DWORD bytesRead = 0;
+            complete = ReadFile(pipe, message.data() + block * charsPerBlock, blockBytes, &bytesRead, nullptr);
+            if (!complete && GetLastError() != ERROR_MORE_DATA)
+            {
+                break;
+            }
+
+            block++;
+        } while (!complete);
+
+        const auto last = message.find_last_not_of(L'\0');
+        message.resize(last == std::wstring::npos ? 0 : last + 1);
+        _onMessage(std::move(message));
+
+        FlushFileBuffers(pipe);
+        DisconnectNamedPipe(pipe);
+        CloseHandle(pipe);
+
+        std::unique_lock lock{ _readersMutex };
+        --_readers;
+        _readersDone.notify_all();
+    }
+
+    std::wstring PipeName(const std::wstring& tag)
+    {
+        static std::atomic<uint32_t> next = 0;
+        return L"\\\\.\\pipe\\powertoys_benchmark_" + std::to_wstring(GetCurrentProcessId()) + L"_" + tag + L"_" + std::to_wstring(next++);
+    }
+#else
+    bool LegacyPipe::SendOne(const std::wstring& message)
+    {
+        sockaddr_un address{};
+        const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        // Written as the UTF-16 the pipe carries on Windows
+        std::vector<char> bytes;
+        pipe_session::append_utf16(bytes, message);
+        bool sent = MakeAddress(_outputName, address) && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        for (size_t offset = 0; sent && offset < bytes.size();)
+        {
+            const ssize_t written = send(fd, bytes.data() + offset, bytes.size() - offset, MSG_NOSIGNAL);
+            sent = written > 0 || (written < 0 && errno == EINTR);
+            offset += written > 0 ? static_cast<size_t>(written) : 0;
+        }
+
+        close(fd);
+        return sent;
+    }
+
+    void LegacyPipe::Listen()
+    {
+        sockaddr_un address{};
+        const int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listener < 0)
+        {
+            return;
+        }
+
+        const auto path = SocketPath(_inputName);
+        unlink(path.c_str());
+        if (!MakeAddress(_inputName, address) || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listener, SOMAXCONN) != 0)
+        {
+            close(listener);
+            return;
+        }
+
+        {
+            std::unique_lock lock{ _listeningMutex };
+            _listening = listener;
+        }
+
+        while (!_closed)
+        {
+            const int connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if (connection < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                {
+                    continue;
+                }
+
+                break;
+            }
+
+            {
+                std::unique_lock lock{ _readersMutex };
+                ++_readers;
+            }
+
+            ++_threadsStarted;
+            std::thread(&LegacyPipe::ReadConnection, this, static_cast<intptr_t>(connection)).detach();
+        }
+
+        {
+            std::unique_lock lock{ _listeningMutex };
+            _listening = -1;
+        }
+
+        close(listener);
+        unlink(path.c_str());
+    }
+
+    void LegacyPipe::ReadConnection(const intptr_t connection)
+    {
+        const int fd = static_cast<int>(connection);
+        std::vector<char> bytes;
+        size_t size = 0;
+        while (true)
+        {
+            bytes.resize(size + blockBytes);
+            const ssize_t bytesRead = read(fd, bytes.data() + size, blockBytes);
+            if (bytesRead < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (bytesRead <= 0)
+            {
+                break;
+            }
+
+            size += static_cast<size_t>(bytesRead);
+        }
+
+        close(fd);
+        _onMessage(pipe_session::decode_utf16(bytes.data(), size));
+
+        std::unique_lock lock{ _readersMutex };
+        --_readers;
+        _readersDone.notify_all();
+    }
+
+    std::wstring PipeName(const std::wstring& tag)
+    {
+        static std::atomic<uint32_t> next = 0;
+        return L"/tmp/powertoys_benchmark_" + std::to_wstring(getpid()) + L"_" + tag + L"_" + std::to_wstring(next++);
+    }
+#endif
+}
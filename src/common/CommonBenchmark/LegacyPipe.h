@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+#include <async_message_queue.h>
+
+namespace CommonBenchmark
+{
+    // Messages sent the way TwoWayPipeMessageIPC sends them without the session mode: the pipe of the peer is opened for
+    // every message, and the listening side starts a thread for every connection, reading the message in 1 KB blocks.
+    // Named pipes on Windows, Unix sockets elsewhere.
+    class LegacyPipe
+    {
+    public:
+        LegacyPipe(std::wstring inputName, std::wstring outputName, std::function<void(std::wstring)> onMessage);
+        ~LegacyPipe();
+
+        void Start();
+        void Send(std::wstring message);
+        void End();
+
+        uint64_t ThreadsStarted() const
+        {
+            return _threadsStarted;
+        }
+
+    private:
+        void SendQueued();
+        bool SendOne(const std::wstring& message);
+        void Listen();
+        void ReadConnection(intptr_t connection);
+
+        std::wstring _inputName;
+        std::wstring _outputName;
+        std::function<void(std::wstring)> _onMessage;
+        AsyncMessageQueue _outputQueue;
+        std::thread _sendThread;
+        std::thread _listenThread;
+        std::atomic_bool _closed = false;
+        std::atomic<uint64_t> _threadsStarted = 0;
+
+        // The connection being waited for, closed to stop listening
+        std::mutex _listeningMutex;
+        intptr_t _listening = -1;
+
+        // The detached connection threads still running
+        std::mutex _readersMutex;
+        std::condition_variable _readersDone;
+        size_t _readers = 0;
+    };
+
+    // A name for the pipes of one case, unique in the machine
+    std::wstring PipeName(const std::wstring& tag);
+}
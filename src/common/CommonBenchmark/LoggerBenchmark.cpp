@@ -0,0 +1,396 @@
+#include "pch.h"
+#include "LoggerBenchmark.h"
+
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+
+#include <async_ring_sink.h>
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/sinks/daily_file_sink.h>
+
+namespace
+{
+    using namespace CommonBenchmark;
+    using namespace std::chrono_literals;
+    using Clock = std::chrono::steady_clock;
+
+    // Keeps the messages it's given, and can hold the writer thread inside log() until it's opened
+    class RecordingSink : public spdlog::sinks::base_sink<std::mutex>
+    {
+    public:
+        std::vector<std::string> Messages()
+        {
+            std::lock_guard lock{ base_sink<std::mutex>::mutex_ };
+            return messages;
+        }
+
+        size_t Flushes()
+        {
+            std::lock_guard lock{ base_sink<std::mutex>::mutex_ };
+            return flushes;
+        }
+
+        void Close()
+        {
+            std::lock_guard lock{ gateMutex };
+            closed = true;
+        }
+
+        void Open()
+        {
+            {
+                std::lock_guard lock{ gateMutex };
+                closed = false;
+            }
+            gate.notify_all();
+        }
+
+        // Waits until the writer thread is held in log()
+        bool WaitUntilHeld()
+        {
+            std::unique_lock lock{ gateMutex };
+            return gate.wait_for(lock, 5s, [this] { return held; });
+        }
+
+    protected:
+        void sink_it_(const spdlog::details::log_msg& msg) override
+        {
+            {
+                std::unique_lock lock{ gateMutex };
+                held = closed;
+                gate.notify_all();
+                gate.wait(lock, [this] { return !closed; });
+            }
+
+            messages.emplace_back(msg.payload.data(), msg.payload.size());
+        }
+
+        void flush_() override
+        {
+            flushes++;
+        }
+
+    private:
+        std::vector<std::string> messages;
+        size_t flushes = 0;
+        std::mutex gateMutex;
+        std::condition_variable gate;
+        bool closed = false;
+        bool held = false;
+    };
+
+    struct AsyncLogger
+    {
+        std::shared_ptr<RecordingSink> recording = std::make_shared<RecordingSink>();
+        std::shared_ptr<AsyncRingSink> sink;
+        std::shared_ptr<spdlog::logger> logger;
+
+        explicit AsyncLogger(const AsyncLogOptions& options)
+        {
+            sink = std::make_shared<AsyncRingSink>(std::vector<spdlog::sink_ptr>{ recording }, options);
+            logger = std::make_shared<spdlog::logger>("check", sink);
+            logger->set_level(spdlog::level::trace);
+            logger->flush_on(spdlog::level::err);
+        }
+    };
+
+    std::vector<std::string> Numbers(const size_t from, const size_t to)
+    {
+        std::vector<std::string> numbers;
+        for (size_t i = from; i < to; ++i)
+        {
+            numbers.push_back(std::to_string(i));
+        }
+
+        return numbers;
+    }
+
+    // Every thread's messages are written in the order it logged them, through a ring much smaller than what is logged
+    CheckResult CheckOrder()
+    {
+        CheckResult result{ .name = L"Logger order" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        constexpr size_t threads = 4;
+        constexpr size_t perThread = 5000;
+        for (const size_t capacity : { size_t{ 1 }, size_t{ 8 }, AsyncLogOptions{}.capacity })
+        {
+            AsyncLogger async{ AsyncLogOptions{ .capacity = capacity } };
+            std::vector<std::thread> loggers;
+            for (size_t thread = 0; thread < threads; ++thread)
+            {
+                loggers.emplace_back([&async, thread] {
+                    for (size_t i = 0; i < perThread; ++i)
+                    {
+                        async.logger->info("{}:{}", thread, i);
+                    }
+                });
+            }
+
+            for (auto& thread : loggers)
+            {
+                thread.join();
+            }
+
+            async.logger->flush();
+            std::vector<size_t> next(threads, 0);
+            bool ordered = true;
+            for (const auto& message : async.recording->Messages())
+            {
+                const size_t separator = message.find(':');
+                const size_t thread = std::stoull(message.substr(0, separator));
+                ordered = ordered && thread < threads && std::stoull(message.substr(separator + 1)) == next[thread]++;
+            }
+
+            check(ordered && std::all_of(next.begin(), next.end(), [](const size_t count) { return count == perThread; }));
+            check(async.sink->dropped_messages() == 0);
+        }
+
+        return result;
+    }
+
+    // With the writer thread held, the ring of 4 fills up and the overflow policy decides what is written
+    CheckResult CheckOverflow()
+    {
+        CheckResult result{ .name = L"Logger overflow" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        const auto fill = [](AsyncLogger& async) {
+            async.recording->Close();
+            async.logger->info("0");
+            const bool held = async.recording->WaitUntilHeld();
+            for (size_t i = 1; i <= 10; ++i)
+            {
+                async.logger->info("{}", i);
+            }
+
+            return held;
+        };
+
+        for (const auto policy : { LogOverflowPolicy::DropOldest, LogOverflowPolicy::Drop })
+        {
+            AsyncLogger async{ AsyncLogOptions{ .capacity = 4, .overflowPolicy = policy, .flushInterval = 1ms } };
+            check(fill(async));
+            check(async.sink->dropped_messages() == 6);
+            async.recording->Open();
+            async.logger->flush();
+
+            auto expected = policy == LogOverflowPolicy::DropOldest ? Numbers(7, 11) : Numbers(1, 5);
+            expected.insert(expected.begin(), "0");
+            expected.push_back("6 log messages were dropped, the log ring was full");
+            check(async.recording->Messages() == expected);
+        }
+
+        // The caller waits for the ring, and nothing is lost
+        AsyncLogger async{ AsyncLogOptions{ .capacity = 4, .overflowPolicy = LogOverflowPolicy::Block, .flushInterval = 1ms } };
+        async.recording->Close();
+        async.logger->info("0");
+        check(async.recording->WaitUntilHeld());
+        for (size_t i = 1; i <= 4; ++i)
+        {
+            async.logger->info("{}", i);
+        }
+
+        std::atomic_bool returned = false;
+        std::thread caller{ [&] {
+            async.logger->info("5");
+            returned = true;
+        } };
+
+        std::this_thread::sleep_for(20ms);
+        check(!returned);
+        async.recording->Open();
+        caller.join();
+        async.logger->flush();
+        check(async.recording->Messages() == Numbers(0, 6) && async.sink->dropped_messages() == 0);
+        return result;
+    }
+
+    CheckResult CheckFlush()
+    {
+        CheckResult result{ .name = L"Logger flush" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        // Messages below the flush level wait for the interval, an error is written and flushed before it returns
+        {
+            AsyncLogger async{ AsyncLogOptions{ .flushInterval = std::chrono::hours{ 1 } } };
+            async.logger->info("info");
+            std::this_thread::sleep_for(20ms);
+            check(async.recording->Messages().empty() && async.recording->Flushes() == 0);
+            async.logger->error("error");
+            check(async.recording->Messages() == std::vector<std::string>{ "info", "error" } && async.recording->Flushes() == 1);
+        }
+
+        // The sinks are flushed once the interval is over
+        {
+            AsyncLogger async{ AsyncLogOptions{ .flushInterval = 10ms } };
+            async.logger->info("info");
+            const auto deadline = Clock::now() + 5s;
+            while (async.recording->Flushes() == 0 && Clock::now() < deadline)
+            {
+                std::this_thread::sleep_for(1ms);
+            }
+
+            check(async.recording->Messages() == std::vector<std::string>{ "info" } && async.recording->Flushes() == 1);
+        }
+
+        // Or once enough bytes were written
+        {
+            AsyncLogger async{ AsyncLogOptions{ .capacity = 8, .flushInterval = std::chrono::hours{ 1 }, .flushBytes = 64 } };
+            for (size_t i = 0; i < 8; ++i)
+            {
+                async.logger->info("{:>16}", i);
+            }
+
+            const auto deadline = Clock::now() + 5s;
+            while (async.recording->Flushes() == 0 && Clock::now() < deadline)
+            {
+                std::this_thread::sleep_for(1ms);
+            }
+
+            check(async.recording->Flushes() > 0);
+        }
+
+        // What is still in the ring is written and flushed when the sink is destroyed
+        auto recording = std::make_shared<RecordingSink>();
+        {
+            AsyncLogger async{ AsyncLogOptions{ .flushInterval = std::chrono::hours{ 1 } } };
+            recording = async.recording;
+            for (size_t i = 0; i < 100; ++i)
+            {
+                async.logger->info("{}", i);
+            }
+        }
+
+        check(recording->Messages() == Numbers(0, 100) && recording->Flushes() == 1);
+        return result;
+    }
+
+    double Percentile(std::vector<double> values, const double percentile)
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, static_cast<size_t>(static_cast<double>(values.size()) * percentile))];
+    }
+
+    uint64_t CountLines(const std::filesystem::path& directory)
+    {
+        uint64_t lines = 0;
+        for (const auto& file : std::filesystem::directory_iterator(directory))
+        {
+            std::ifstream stream{ file.path() };
+            lines += static_cast<uint64_t>(std::count(std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{}, '\n'));
+        }
+
+        return lines;
+    }
+
+    LoggerResult RunCase(std::wstring mode, const size_t threads, const uint32_t messages, const std::optional<LogOverflowPolicy> policy)
+    {
+        const auto directory = std::filesystem::temp_directory_path() / ("CommonBenchmark-logger-" + std::to_string(std::random_device{}()));
+        std::filesystem::create_directories(directory);
+
+        const size_t perThread = std::max<size_t>(1, messages / threads);
+        std::vector<std::vector<double>> ns(threads);
+        uint64_t dropped = 0;
+        {
+            // The way Logger::init sets the logger up, with the default trace level
+            spdlog::sink_ptr sink = std::make_shared<spdlog::sinks::daily_file_sink_mt>((directory / "benchmark-log.txt").native(), 0, 0, false, 30);
+            std::shared_ptr<AsyncRingSink> asyncSink;
+            if (policy.has_value())
+            {
+                asyncSink = std::make_shared<AsyncRingSink>(std::vector<spdlog::sink_ptr>{ sink }, AsyncLogOptions{ .overflowPolicy = *policy });
+                sink = asyncSink;
+            }
+
+            auto logger = std::make_shared<spdlog::logger>("benchmark", sink);
+            logger->set_level(spdlog::level::trace);
+            logger->set_pattern("[%Y-%m-%d %H:%M:%S.%f] [p-%P] [t-%t] [%l] %v");
+            logger->flush_on(policy.has_value() ? spdlog::level::err : spdlog::level::trace);
+
+            std::atomic_bool go = false;
+            std::vector<std::thread> loggers;
+            for (size_t thread = 0; thread < threads; ++thread)
+            {
+                loggers.emplace_back([&, thread] {
+                    ns[thread].reserve(perThread);
+                    while (!go)
+                    {
+                        std::this_thread::yield();
+                    }
+
+                    // Shaped like the messages of the keyboard hook and the zone snapping
+                    for (size_t i = 0; i < perThread; ++i)
+                    {
+                        const auto start = Clock::now();
+                        logger->info("Window {:#x} moved to zone {} of monitor {}, {}x{}", 0x10000 + i, i % 16, thread, 1920, 1080);
+                        ns[thread].push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+                    }
+                });
+            }
+
+            go = true;
+            for (auto& thread : loggers)
+            {
+                thread.join();
+            }
+
+            dropped = asyncSink ? asyncSink->dropped_messages() : 0;
+        }
+
+        std::vector<double> all;
+        for (const auto& samples : ns)
+        {
+            all.insert(all.end(), samples.begin(), samples.end());
+        }
+
+        LoggerResult result{ .mode = std::move(mode), .threads = threads, .messages = all.size(), .dropped = dropped };
+        result.p50Ns = Percentile(all, 0.5);
+        result.p99Ns = Percentile(all, 0.99);
+        result.maxNs = Percentile(all, 1);
+        result.meanNs = all.empty() ? 0 : std::accumulate(all.begin(), all.end(), 0.0) / static_cast<double>(all.size());
+        result.lines = CountLines(directory);
+
+        std::error_code error;
+        std::filesystem::remove_all(directory, error);
+        return result;
+    }
+}
+
+namespace CommonBenchmark
+{
+    std::vector<CheckResult> RunLoggerChecks()
+    {
+        return { CheckOrder(), CheckOverflow(), CheckFlush() };
+    }
+
+    std::vector<LoggerResult> RunLoggerBenchmark(const uint32_t messages)
+    {
+        std::vector<LoggerResult> results;
+        for (const size_t threads : { 1, 4 })
+        {
+            results.push_back(RunCase(L"Sync", threads, messages, std::nullopt));
+            results.push_back(RunCase(L"Block", threads, messages, LogOverflowPolicy::Block));
+            results.push_back(RunCase(L"Drop-oldest", threads, messages, LogOverflowPolicy::DropOldest));
+            results.push_back(RunCase(L"Drop", threads, messages, LogOverflowPolicy::Drop));
+        }
+
+        return results;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+namespace CommonBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Ordering across threads, the overflow policies, flushing and draining on destruction of AsyncRingSink
+    std::vector<CheckResult> RunLoggerChecks();
+
+    struct LoggerResult
+    {
+        std::wstring mode;
+        size_t threads = {};
+        uint64_t messages = {};
+        // Time spent in the logging call on the caller's thread
+        double p50Ns = {};
+        double p99Ns = {};
+        double maxNs = {};
+        double meanNs = {};
+        uint64_t dropped = {};
+        // Lines in the log files once the logger was destroyed
+        uint64_t lines = {};
+    };
+
+    // A daily file logger flushing on every message, as Logger::init sets it up, against the async mode with every
+    // overflow policy, for 1 and 4 logging threads
+    std::vector<LoggerResult> RunLoggerBenchmark(uint32_t messages);
+}
@@ -0,0 +1,352 @@
+#include "pch.h"
+#include "MessageQueueBenchmark.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+
+#include <async_message_queue.h>
+
+namespace
+{
+    using namespace CommonBenchmark;
+    using namespace std::chrono_literals;
+    using Clock = std::chrono::steady_clock;
+
+    // AsyncMessageQueue as it was before: a mutex on every push and pop, a copy into the queue and out of it
+    class LockedMessageQueue
+    {
+    public:
+        void queue_message(std::wstring message)
+        {
+            this->queue_mutex.lock();
+            this->message_queue.push(message);
+            this->queue_mutex.unlock();
+            this->message_ready.notify_one();
+        }
+
+        std::wstring pop_message()
+        {
+            std::unique_lock<std::mutex> lock(this->queue_mutex);
+            while (message_queue.empty() && !this->interrupted)
+            {
+                this->message_ready.wait(lock);
+            }
+            if (this->interrupted)
+            {
+                return std::wstring(L"");
+            }
+            std::wstring message = this->message_queue.front();
+            this->message_queue.pop();
+            return message;
+        }
+
+        void interrupt()
+        {
+            this->queue_mutex.lock();
+            this->interrupted = true;
+            this->queue_mutex.unlock();
+            this->message_ready.notify_all();
+        }
+
+    private:
+        std::mutex queue_mutex;
+        std::queue<std::wstring> message_queue;
+        std::condition_variable message_ready;
+        bool interrupted = false;
+    };
+
+    std::wstring Message(const size_t producer, const size_t index)
+    {
+        return std::to_wstring(producer) + L":" + std::to_wstring(index);
+    }
+
+    // Messages of every producer are popped in the order it queued them, whether they went through the ring or the
+    // overflow list, popped one at a time or in batches
+    CheckResult CheckOrder()
+    {
+        CheckResult result{ .name = L"Queue order" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        constexpr size_t producers = 4;
+        constexpr size_t perProducer = 20000;
+        for (const size_t capacity : { size_t{ 2 }, size_t{ 16 }, AsyncMessageQueue::default_capacity })
+        {
+            for (const bool batched : { false, true })
+            {
+                AsyncMessageQueue queue{ capacity };
+                std::vector<std::thread> threads;
+                for (size_t producer = 0; producer < producers; ++producer)
+                {
+                    threads.emplace_back([&queue, producer] {
+                        for (size_t i = 0; i < perProducer; ++i)
+                        {
+                            queue.queue_message(Message(producer, i));
+                        }
+                    });
+                }
+
+                std::vector<size_t> next(producers, 0);
+                bool ordered = true;
+                const auto take = [&](const std::wstring& message) {
+                    const size_t separator = message.find(L':');
+                    const size_t producer = std::stoull(message.substr(0, separator));
+                    ordered = ordered && producer < producers && std::stoull(message.substr(separator + 1)) == next[producer]++;
+                };
+
+                std::vector<std::wstring> messages;
+                for (size_t popped = 0; popped < producers * perProducer;)
+                {
+                    if (batched)
+                    {
+                        messages.clear();
+                        queue.pop_messages(messages);
+                        std::for_each(messages.begin(), messages.end(), take);
+                        popped += messages.size();
+                    }
+                    else
+                    {
+                        take(queue.pop_message());
+                        popped++;
+                    }
+                }
+
+                for (auto& thread : threads)
+                {
+                    thread.join();
+                }
+
+                check(ordered && std::all_of(next.begin(), next.end(), [](const size_t count) { return count == perProducer; }));
+            }
+        }
+
+        return result;
+    }
+
+    CheckResult CheckMoves()
+    {
+        CheckResult result{ .name = L"Queue moves" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        // The buffer of a message is handed over, through the ring and through the overflow list
+        AsyncMessageQueue queue{ 2 };
+        std::vector<const wchar_t*> buffers;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            std::wstring message(256, static_cast<wchar_t>(L'a' + i));
+            buffers.push_back(message.data());
+            queue.queue_message(std::move(message));
+        }
+
+        for (size_t i = 0; i < 2; ++i)
+        {
+            const std::wstring message = queue.pop_message();
+            check(message.data() == buffers[i] && message == std::wstring(256, static_cast<wchar_t>(L'a' + i)));
+        }
+
+        std::vector<std::wstring> messages;
+        check(queue.pop_messages(messages) && messages.size() == 2);
+        check(messages.size() == 2 && messages[0].data() == buffers[2] && messages[1].data() == buffers[3]);
+        return result;
+    }
+
+    // A consumer parked on an empty queue is woken by every message, however the push races with its parking
+    CheckResult CheckParking()
+    {
+        CheckResult result{ .name = L"Queue parking" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        constexpr uint64_t rounds = 20000;
+        AsyncMessageQueue queue;
+        std::atomic<uint64_t> popped = 0;
+        std::thread consumer{ [&] {
+            while (!queue.pop_message().empty())
+            {
+                popped++;
+            }
+        } };
+
+        // Pushed right after the previous one was popped, while the consumer is about to park
+        bool lost = false;
+        for (uint64_t i = 0; i < rounds && !lost; ++i)
+        {
+            queue.queue_message(L"m");
+            const auto deadline = Clock::now() + 5s;
+            while (popped.load() <= i && !lost)
+            {
+                lost = Clock::now() > deadline;
+                if (i % 64 == 0)
+                {
+                    std::this_thread::sleep_for(50us);
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        queue.interrupt();
+        consumer.join();
+        check(!lost && popped == rounds);
+        return result;
+    }
+
+    CheckResult CheckInterrupt()
+    {
+        CheckResult result{ .name = L"Queue interrupt" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        // A parked consumer gets an empty message
+        {
+            AsyncMessageQueue queue;
+            std::atomic_bool returned = false;
+            std::wstring message = L"not popped";
+            std::thread consumer{ [&] {
+                message = queue.pop_message();
+                returned = true;
+            } };
+
+            std::this_thread::sleep_for(20ms);
+            check(!returned);
+            queue.interrupt();
+            consumer.join();
+            check(message.empty());
+        }
+
+        // A batched consumer is told to stop
+        {
+            AsyncMessageQueue queue;
+            bool popped = true;
+            std::vector<std::wstring> messages;
+            std::thread consumer{ [&] { popped = queue.pop_messages(messages); } };
+            std::this_thread::sleep_for(20ms);
+            queue.interrupt();
+            consumer.join();
+            check(!popped && messages.empty());
+        }
+
+        // Once interrupted, nothing is popped anymore, whether it was queued before or after
+        AsyncMessageQueue queue{ 2 };
+        for (size_t i = 0; i < 4; ++i)
+        {
+            queue.queue_message(L"before");
+        }
+
+        queue.interrupt();
+        queue.queue_message(L"after");
+        std::vector<std::wstring> messages;
+        check(queue.pop_message().empty());
+        check(!queue.pop_messages(messages) && messages.empty());
+        return result;
+    }
+
+    template<typename Queue, typename Drain>
+    MessageQueueResult RunCase(std::wstring name, const size_t producers, const uint32_t messages, Drain&& drain)
+    {
+        const size_t perProducer = std::max<size_t>(1, messages / producers);
+        const uint64_t total = perProducer * producers;
+
+        // Built before the clock starts, so only queuing them is measured. Longer than the small string buffer, as the
+        // JSON of the settings is.
+        std::vector<std::vector<std::wstring>> outgoing(producers);
+        for (size_t producer = 0; producer < producers; ++producer)
+        {
+            outgoing[producer].reserve(perProducer);
+            for (size_t i = 0; i < perProducer; ++i)
+            {
+                auto message = Message(producer, i);
+                message.resize(64, L' ');
+                outgoing[producer].push_back(std::move(message));
+            }
+        }
+
+        Queue queue;
+        std::atomic<uint64_t> pushNs = 0;
+        std::atomic_bool go = false;
+        std::vector<std::thread> threads;
+        for (size_t producer = 0; producer < producers; ++producer)
+        {
+            threads.emplace_back([&, producer] {
+                while (!go)
+                {
+                    std::this_thread::yield();
+                }
+
+                const auto start = Clock::now();
+                for (auto& message : outgoing[producer])
+                {
+                    queue.queue_message(std::move(message));
+                }
+
+                pushNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+            });
+        }
+
+        const auto start = Clock::now();
+        go = true;
+        uint64_t popped = 0;
+        uint64_t checksum = 0;
+        while (popped < total)
+        {
+            popped += drain(queue, checksum);
+        }
+
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        queue.interrupt();
+        MessageQueueResult result{ .queue = std::move(name), .producers = producers, .messages = popped };
+        result.messagesPerSecond = static_cast<double>(popped) / seconds;
+        result.pushMeanNs = static_cast<double>(pushNs.load()) / static_cast<double>(total);
+        return result;
+    }
+}
+
+namespace CommonBenchmark
+{
+    std::vector<CheckResult> RunMessageQueueChecks()
+    {
+        return { CheckOrder(), CheckMoves(), CheckParking(), CheckInterrupt() };
+    }
+
+    std::vector<MessageQueueResult> RunMessageQueueBenchmark(const uint32_t messages)
+    {
+        std::vector<MessageQueueResult> results;
+        for (const size_t producers : { 1, 2, 4, 8, 16 })
+        {
+            results.push_back(RunCase<LockedMessageQueue>(L"Locked", producers, messages, [](LockedMessageQueue& queue, uint64_t& checksum) {
+                checksum += queue.pop_message().size();
+                return uint64_t{ 1 };
+            }));
+
+            results.push_back(RunCase<AsyncMessageQueue>(L"Lock-free", producers, messages, [batch = std::vector<std::wstring>{}](AsyncMessageQueue& queue, uint64_t& checksum) mutable {
+                batch.clear();
+                queue.pop_messages(batch);
+                for (const auto& message : batch)
+                {
+                    checksum += message.size();
+                }
+
+                return static_cast<uint64_t>(batch.size());
+            }));
+        }
+
+        return results;
+    }
+}
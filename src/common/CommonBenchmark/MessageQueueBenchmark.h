@@ -0,0 +1,24 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+namespace CommonBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Ordering across producers, the overflow of a full ring, moves, parking and interrupting of AsyncMessageQueue
+    std::vector<CheckResult> RunMessageQueueChecks();
+
+    struct MessageQueueResult
+    {
+        std::wstring queue;
+        size_t producers = {};
+        uint64_t messages = {};
+        double messagesPerSecond = {};
+        // Time spent in queue_message, per call
+        double pushMeanNs = {};
+    };
+
+    // The queue TwoWayPipeMessageIPC used before against AsyncMessageQueue, for 1 to 16 producers and one consumer
+    std::vector<MessageQueueResult> RunMessageQueueBenchmark(uint32_t messages);
+}
@@ -0,0 +1,664 @@
+#include "pch.h"
+#include "PipeSessionBenchmark.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+
+#include <pipe_session.h>
+#ifdef _WIN32
+#include <named_pipe_transport.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <unix_socket_transport.h>
+#endif
+
+#include "LegacyPipe.h"
+
+namespace
+{
+    using namespace CommonBenchmark;
+    using namespace std::chrono_literals;
+    using Clock = std::chrono::steady_clock;
+
+    std::unique_ptr<pipe_session::transport> MakeTransport(const std::wstring& inputName, const std::wstring& outputName)
+    {
+#ifdef _WIN32
+        return std::make_unique<named_pipe_transport>(inputName, outputName, nullptr);
+#else
+        return std::make_unique<unix_socket_transport>(std::string(inputName.begin(), inputName.end()), std::string(outputName.begin(), outputName.end()));
+#endif
+    }
+
+    // Both ends of TwoWayPipeMessageIPC in the session mode
+    class SessionPeer
+    {
+    public:
+        SessionPeer(const std::wstring& inputName, const std::wstring& outputName, std::function<void(std::wstring)> onMessage, pipe_session::options options = {}) :
+            _transport{ MakeTransport(inputName, outputName) },
+            _session{ std::make_unique<pipe_session::session>(*_transport, std::move(onMessage), options) }
+        {
+        }
+
+        void Start()
+        {
+            _session->start();
+        }
+
+        void Send(std::wstring message)
+        {
+            _session->send(std::move(message));
+        }
+
+        void End()
+        {
+            _session->end();
+        }
+
+        pipe_session::statistics Stats() const
+        {
+            return _session->stats();
+        }
+
+    private:
+        std::unique_ptr<pipe_session::transport> _transport;
+        std::unique_ptr<pipe_session::session> _session;
+    };
+
+    struct Inbox
+    {
+        std::mutex mutex;
+        std::condition_variable received;
+        std::vector<std::wstring> messages;
+
+        void Add(std::wstring message)
+        {
+            {
+                std::unique_lock lock{ mutex };
+                messages.push_back(std::move(message));
+            }
+
+            received.notify_all();
+        }
+
+        bool WaitFor(const size_t count, const std::chrono::milliseconds timeout)
+        {
+            std::unique_lock lock{ mutex };
+            return received.wait_for(lock, timeout, [&] { return messages.size() >= count; });
+        }
+
+        std::vector<std::wstring> Messages()
+        {
+            std::unique_lock lock{ mutex };
+            return messages;
+        }
+    };
+
+    template<typename Done>
+    bool WaitUntil(Done&& done, const std::chrono::milliseconds timeout)
+    {
+        const auto deadline = Clock::now() + timeout;
+        while (!done())
+        {
+            if (Clock::now() > deadline)
+            {
+                return false;
+            }
+
+            std::this_thread::sleep_for(1ms);
+        }
+
+        return true;
+    }
+
+    void AppendCodePoint(std::wstring& message, const uint32_t codePoint)
+    {
+        if constexpr (sizeof(wchar_t) == sizeof(char16_t))
+        {
+            if (codePoint >= 0x10000)
+            {
+                message.push_back(static_cast<wchar_t>(0xD800 + ((codePoint - 0x10000) >> 10)));
+                message.push_back(static_cast<wchar_t>(0xDC00 + ((codePoint - 0x10000) & 0x3FF)));
+                return;
+            }
+        }
+
+        message.push_back(static_cast<wchar_t>(codePoint));
+    }
+
+    // Feeds the bytes to the reader in reads of at most maxRead bytes, as much as the reader offers if zero
+    bool Feed(pipe_session::frame_reader& reader, const std::vector<char>& bytes, std::mt19937& random, const size_t maxRead, std::vector<std::wstring>& decoded, size_t& maxCapacity)
+    {
+        bool valid = true;
+        for (size_t offset = 0; offset < bytes.size();)
+        {
+            size_t size = 0;
+            char* buffer = reader.read_buffer(size);
+            maxCapacity = std::max(maxCapacity, reader.capacity());
+            size = std::min(size, bytes.size() - offset);
+            if (maxRead > 0)
+            {
+                size = std::min<size_t>(size, random() % maxRead + 1);
+            }
+
+            std::memcpy(buffer, bytes.data() + offset, size);
+            offset += size;
+            reader.commit(size);
+            valid &= reader.drain([&](const char* payload, const size_t payloadSize) { decoded.push_back(pipe_session::decode_utf16(payload, payloadSize)); });
+        }
+
+        return valid;
+    }
+
+    CheckResult CheckFraming(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"Session framing" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        // ASCII, other BMP characters and characters taking a surrogate pair in UTF-16, split at random points
+        std::mt19937 random{ seed };
+        std::vector<std::wstring> messages{ L"" };
+        for (size_t i = 0; i < 300; ++i)
+        {
+            std::wstring message;
+            const size_t length = random() % 400;
+            for (size_t c = 0; c < length; ++c)
+            {
+                const uint32_t kind = random() % 8;
+                AppendCodePoint(message, kind < 5 ? 0x20 + random() % 0x5F : kind < 7 ? 0x4E00 + random() % 0x5000 : 0x1F600 + random() % 0x50);
+            }
+
+            messages.push_back(std::move(message));
+        }
+
+        std::vector<char> frames;
+        for (const auto& message : messages)
+        {
+            pipe_session::append_frame(frames, message);
+        }
+
+        for (const size_t maxRead : { size_t{ 1 }, size_t{ 7 }, size_t{ 1000 }, size_t{ 0 } })
+        {
+            pipe_session::frame_reader reader;
+            std::vector<std::wstring> decoded;
+            size_t maxCapacity = 0;
+            check(Feed(reader, frames, random, maxRead, decoded, maxCapacity));
+            check(decoded == messages);
+            check(reader.pending_size() == 0);
+        }
+
+        // A large frame is read into a buffer grown for it, which shrinks back while small messages follow
+        pipe_session::frame_reader reader;
+        std::vector<std::wstring> decoded;
+        size_t maxCapacity = 0;
+        const std::wstring large(512 * 1024, L'x');
+        frames.clear();
+        pipe_session::append_frame(frames, large);
+        check(Feed(reader, frames, random, 0, decoded, maxCapacity));
+        check(decoded.size() == 1 && decoded[0] == large);
+        check(maxCapacity >= large.size() * sizeof(char16_t));
+
+        decoded.clear();
+        for (size_t i = 0; i < 32; ++i)
+        {
+            frames.clear();
+            pipe_session::append_frame(frames, L"toggle");
+            check(Feed(reader, frames, random, 0, decoded, maxCapacity));
+        }
+
+        check(decoded.size() == 32);
+        check(reader.capacity() <= 4 * pipe_session::frame_reader::min_read_size);
+
+        // A size past the limit fails the connection instead of making the reader wait for it
+        pipe_session::frame_reader malformed;
+        frames.clear();
+        pipe_session::append_uint32(frames, pipe_session::max_frame_size + 1);
+        check(!Feed(malformed, frames, random, 0, decoded, maxCapacity));
+        return result;
+    }
+
+    CheckResult CheckDelivery()
+    {
+        CheckResult result{ .name = L"Session delivery" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        const auto senderName = PipeName(L"delivery");
+        const auto receiverName = PipeName(L"delivery");
+        Inbox inbox;
+        SessionPeer receiver{ receiverName, senderName, [&inbox](std::wstring message) { inbox.Add(std::move(message)); } };
+        SessionPeer sender{ senderName, receiverName, nullptr };
+        receiver.Start();
+        sender.Start();
+
+        // Messages sent by every thread arrive in the order the thread sent them
+        constexpr size_t threads = 2;
+        constexpr size_t perThread = 2000;
+        std::vector<std::thread> senders;
+        for (size_t thread = 0; thread < threads; ++thread)
+        {
+            senders.emplace_back([&sender, thread] {
+                for (size_t i = 0; i < perThread; ++i)
+                {
+                    sender.Send(std::to_wstring(thread) + L":" + std::to_wstring(i));
+                }
+            });
+        }
+
+        for (auto& thread : senders)
+        {
+            thread.join();
+        }
+
+        check(inbox.WaitFor(threads * perThread, 10s));
+        std::vector<size_t> next(threads, 0);
+        bool ordered = true;
+        for (const auto& message : inbox.Messages())
+        {
+            const size_t thread = message[0] - L'0';
+            ordered = ordered && thread < threads && std::stoull(message.substr(2)) == next[thread]++;
+        }
+
+        check(ordered && std::all_of(next.begin(), next.end(), [](const size_t count) { return count == perThread; }));
+
+        // All of them over one connection
+        const auto stats = sender.Stats();
+        check(stats.connects == 1 && stats.sent == threads * perThread && stats.single_message_sends == 0);
+        check(stats.batches <= stats.sent);
+        check(receiver.Stats().received == threads * perThread && receiver.Stats().served_connections == 1);
+        return result;
+    }
+
+    CheckResult CheckReconnect()
+    {
+        CheckResult result{ .name = L"Session reconnect" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        pipe_session::options options;
+        options.min_backoff = 5ms;
+        options.max_backoff = 50ms;
+        const auto senderName = PipeName(L"reconnect");
+        const auto receiverName = PipeName(L"reconnect");
+        SessionPeer sender{ senderName, receiverName, nullptr, options };
+        sender.Start();
+
+        // Sent before the peer listens, they wait for it
+        sender.Send(L"1");
+        sender.Send(L"2");
+        sender.Send(L"3");
+        std::this_thread::sleep_for(50ms);
+        {
+            Inbox inbox;
+            SessionPeer receiver{ receiverName, senderName, [&inbox](std::wstring message) { inbox.Add(std::move(message)); } };
+            receiver.Start();
+            check(inbox.WaitFor(3, 10s) && inbox.Messages() == std::vector<std::wstring>{ L"1", L"2", L"3" });
+        }
+
+        check(sender.Stats().failed_connects > 0);
+
+        // The peer went away, e.g. Settings was closed, and the messages sent meanwhile reach it once it's back
+        sender.Send(L"4");
+        sender.Send(L"5");
+        std::this_thread::sleep_for(50ms);
+        Inbox inbox;
+        SessionPeer receiver{ receiverName, senderName, [&inbox](std::wstring message) { inbox.Add(std::move(message)); } };
+        receiver.Start();
+        check(inbox.WaitFor(2, 10s) && inbox.Messages() == std::vector<std::wstring>{ L"4", L"5" });
+        check(sender.Stats().connects == 2);
+
+        // However many messages wait for the peer, none of them is dropped
+        receiver.End();
+        constexpr size_t waiting = 10000;
+        for (size_t i = 0; i < waiting; ++i)
+        {
+            sender.Send(std::to_wstring(i));
+        }
+
+        std::this_thread::sleep_for(50ms);
+        Inbox returnedInbox;
+        SessionPeer returned{ receiverName, senderName, [&returnedInbox](std::wstring message) { returnedInbox.Add(std::move(message)); } };
+        returned.Start();
+        check(returnedInbox.WaitFor(waiting, 10s) && returnedInbox.Messages().size() == waiting && returnedInbox.Messages().back() == std::to_wstring(waiting - 1));
+        return result;
+    }
+
+    CheckResult CheckSingleMessagePeers()
+    {
+        CheckResult result{ .name = L"Session single messages" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        const auto senderName = PipeName(L"single");
+        const auto receiverName = PipeName(L"single");
+        Inbox inbox;
+        SessionPeer receiver{ receiverName, senderName, [&inbox](std::wstring message) { inbox.Add(std::move(message)); } };
+        SessionPeer sender{ senderName, receiverName, nullptr };
+        receiver.Start();
+        sender.Start();
+        sender.Send(L"ready");
+        check(inbox.WaitFor(1, 10s));
+
+        // A peer without the session mode opens the pipe for every message, and is served along with the session
+        LegacyPipe legacy{ PipeName(L"single"), receiverName, [](std::wstring) {} };
+        legacy.Start();
+        std::vector<std::wstring> expected{ L"ready", L"{\"general\":{}}", std::wstring(3000, L'a'), std::wstring(40000, L'b') };
+        for (size_t i = 1; i < expected.size(); ++i)
+        {
+            legacy.Send(expected[i]);
+        }
+
+        sender.Send(L"session");
+        expected.push_back(L"session");
+        check(inbox.WaitFor(expected.size(), 10s));
+        legacy.End();
+
+        auto messages = inbox.Messages();
+        std::sort(messages.begin(), messages.end());
+        std::sort(expected.begin(), expected.end());
+        check(messages == expected);
+        const auto stats = receiver.Stats();
+        check(stats.single_message_connections == 3 && stats.served_connections == 4);
+        return result;
+    }
+
+    CheckResult CheckMalformed()
+    {
+        CheckResult result{ .name = L"Session malformed" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        const auto senderName = PipeName(L"malformed");
+        const auto receiverName = PipeName(L"malformed");
+        Inbox inbox;
+        SessionPeer receiver{ receiverName, senderName, [&inbox](std::wstring message) { inbox.Add(std::move(message)); } };
+        SessionPeer sender{ senderName, receiverName, nullptr };
+        receiver.Start();
+        sender.Start();
+        sender.Send(L"ready");
+        check(inbox.WaitFor(1, 10s));
+
+        // The connection announcing a frame past the limit is closed, the others go on
+        const auto raw = MakeTransport(PipeName(L"malformed"), receiverName);
+        const auto stream = raw->connect();
+        std::vector<char> bytes;
+        pipe_session::append_uint32(bytes, pipe_session::session_magic);
+        pipe_session::append_uint32(bytes, pipe_session::max_frame_size + 1);
+        pipe_session::append_uint32(bytes, 0);
+        check(stream && stream->write(bytes.data(), bytes.size()));
+        check(WaitUntil([&] { return receiver.Stats().malformed_connections == 1; }, 10s));
+
+        sender.Send(L"after");
+        check(inbox.WaitFor(2, 10s) && inbox.Messages().back() == L"after");
+
+        // Messages too large for a frame go through a connection of their own, as without the session mode
+        const std::wstring large(pipe_session::max_frame_size / sizeof(char16_t) + 1, L'x');
+        sender.Send(L"before");
+        sender.Send(large);
+        sender.Send(L"last");
+        check(inbox.WaitFor(5, 30s));
+        auto messages = inbox.Messages();
+        std::vector<std::wstring> expected{ L"ready", L"after", L"before", large, L"last" };
+        std::sort(messages.begin(), messages.end());
+        std::sort(expected.begin(), expected.end());
+        check(messages == expected);
+        check(sender.Stats().single_message_sends == 1 && receiver.Stats().single_message_connections == 1);
+        return result;
+    }
+
+    CheckResult CheckListenRetry()
+    {
+        CheckResult result{ .name = L"Session listen retry" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        const auto senderName = PipeName(L"listen");
+#ifdef _WIN32
+        // Creating the listening instance fails while another pipe of the name allows a single instance
+        const auto receiverName = PipeName(L"listen");
+        HANDLE blocker = CreateNamedPipe(receiverName.c_str(), PIPE_ACCESS_DUPLEX, PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT, 1, 0, 0, 0, NULL);
+        check(blocker != INVALID_HANDLE_VALUE);
+#else
+        // Binding fails while the directory of the socket doesn't exist
+        const auto directory = PipeName(L"listen");
+        const auto receiverName = directory + L"/socket";
+#endif
+
+        std::atomic<size_t> errors = 0;
+        pipe_session::options options;
+        options.on_error = [&errors](const std::wstring&) { ++errors; };
+        Inbox inbox;
+        SessionPeer receiver{ receiverName, senderName, [&inbox](std::wstring message) { inbox.Add(std::move(message)); }, options };
+        SessionPeer sender{ senderName, receiverName, nullptr };
+        receiver.Start();
+        sender.Start();
+        check(WaitUntil([&] { return receiver.Stats().listen_failures > 0; }, 10s) && errors > 0);
+
+#ifdef _WIN32
+        CloseHandle(blocker);
+#else
+        check(mkdir(std::string(directory.begin(), directory.end()).c_str(), 0700) == 0);
+#endif
+
+        // The receiver listens again once the failure is gone
+        sender.Send(L"after");
+        check(inbox.WaitFor(1, 10s) && inbox.Messages() == std::vector<std::wstring>{ L"after" });
+        receiver.End();
+        sender.End();
+#ifndef _WIN32
+        rmdir(std::string(directory.begin(), directory.end()).c_str());
+#endif
+        return result;
+    }
+
+    double Percentile(std::vector<double> values, const double percentile)
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, static_cast<size_t>(static_cast<double>(values.size()) * percentile))];
+    }
+
+    struct Counter
+    {
+        std::mutex mutex;
+        std::condition_variable received;
+        uint64_t count = 0;
+
+        void Add()
+        {
+            {
+                std::unique_lock lock{ mutex };
+                count++;
+            }
+
+            received.notify_all();
+        }
+
+        bool WaitFor(const uint64_t expected, const std::chrono::milliseconds timeout)
+        {
+            std::unique_lock lock{ mutex };
+            return received.wait_for(lock, timeout, [&] { return count >= expected; });
+        }
+    };
+
+    // The message a peer sends until the other one gets it, so it's known to listen. Pipes without the session mode drop
+    // what's sent before.
+    const std::wstring readyMessage = L"ready";
+
+    // The connections the listening side accepted and the threads it started for them, one of each per message without
+    // the session mode
+    std::pair<uint64_t, uint64_t> Opened(const LegacyPipe& pipe)
+    {
+        return { pipe.ThreadsStarted(), pipe.ThreadsStarted() };
+    }
+
+    // The I/O thread serves every connection
+    std::pair<uint64_t, uint64_t> Opened(const SessionPeer& peer)
+    {
+        return { peer.Stats().served_connections, 0 };
+    }
+
+    template<typename MakePeer>
+    PipeThroughputResult RunThroughput(std::wstring ipc, const size_t messageChars, const uint32_t messages, MakePeer&& makePeer)
+    {
+        const auto senderName = PipeName(L"throughput");
+        const auto receiverName = PipeName(L"throughput");
+        Counter counter;
+        std::atomic_bool ready = false;
+        auto receiver = makePeer(receiverName, senderName, [&, messageChars](std::wstring message) {
+            if (message.size() == messageChars)
+            {
+                counter.Add();
+            }
+            else
+            {
+                ready = true;
+            }
+        });
+        auto sender = makePeer(senderName, receiverName, [](std::wstring) {});
+        receiver->Start();
+        sender->Start();
+        while (!WaitUntil([&] { return ready.load(); }, 20ms))
+        {
+            sender->Send(readyMessage);
+        }
+
+        const auto [connectionsBefore, threadsBefore] = Opened(*receiver);
+        const std::wstring message(messageChars, L'm');
+        const auto start = Clock::now();
+        for (uint32_t i = 0; i < messages; ++i)
+        {
+            sender->Send(message);
+        }
+
+        counter.WaitFor(messages, 60s);
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        const auto [connectionsAfter, threadsAfter] = Opened(*receiver);
+        sender->End();
+        receiver->End();
+
+        PipeThroughputResult result{ .ipc = std::move(ipc), .messageChars = messageChars, .messages = counter.count };
+        result.messagesPerSecond = static_cast<double>(counter.count) / seconds;
+        result.megabytesPerSecond = static_cast<double>(counter.count * messageChars * sizeof(char16_t)) / seconds / (1024 * 1024);
+        result.connections = connectionsAfter - connectionsBefore;
+        result.threads = threadsAfter - threadsBefore;
+        return result;
+    }
+
+    template<typename MakePeer>
+    PipeLatencyResult RunLatency(std::wstring ipc, const uint32_t roundTrips, MakePeer&& makePeer)
+    {
+        const auto firstName = PipeName(L"latency");
+        const auto secondName = PipeName(L"latency");
+
+        std::mutex mutex;
+        std::condition_variable received;
+        std::wstring last;
+        auto first = makePeer(firstName, secondName, [&](std::wstring message) {
+            {
+                std::unique_lock lock{ mutex };
+                last = std::move(message);
+            }
+
+            received.notify_all();
+        });
+
+        // Sends every message back, as Settings answers the runner
+        decltype(first) second;
+        second = makePeer(secondName, firstName, [&second](std::wstring message) { second->Send(std::move(message)); });
+        first->Start();
+        second->Start();
+
+        const auto waitFor = [&](const std::wstring& expected, const std::chrono::milliseconds timeout) {
+            std::unique_lock lock{ mutex };
+            return received.wait_for(lock, timeout, [&] { return last == expected; });
+        };
+
+        do
+        {
+            first->Send(readyMessage);
+        } while (!waitFor(readyMessage, 20ms));
+
+        std::vector<double> us;
+        us.reserve(roundTrips);
+        for (uint32_t i = 0; i < roundTrips; ++i)
+        {
+            auto message = std::to_wstring(i);
+            message.resize(64, L' ');
+            const auto start = Clock::now();
+            first->Send(message);
+            if (!waitFor(message, 10s))
+            {
+                break;
+            }
+
+            us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+
+        first->End();
+        second->End();
+
+        PipeLatencyResult result{ .ipc = std::move(ipc), .roundTrips = static_cast<uint32_t>(us.size()) };
+        result.p50Us = Percentile(us, 0.5);
+        result.p99Us = Percentile(us, 0.99);
+        result.maxUs = Percentile(us, 1);
+        return result;
+    }
+
+    std::unique_ptr<LegacyPipe> MakeLegacy(const std::wstring& inputName, const std::wstring& outputName, std::function<void(std::wstring)> onMessage)
+    {
+        return std::make_unique<LegacyPipe>(inputName, outputName, std::move(onMessage));
+    }
+
+    std::unique_ptr<SessionPeer> MakeSession(const std::wstring& inputName, const std::wstring& outputName, std::function<void(std::wstring)> onMessage)
+    {
+        return std::make_unique<SessionPeer>(inputName, outputName, std::move(onMessage));
+    }
+}
+
+namespace CommonBenchmark
+{
+    std::vector<CheckResult> RunPipeSessionChecks(const unsigned int seed)
+    {
+        return { CheckFraming(seed), CheckDelivery(), CheckReconnect(), CheckSingleMessagePeers(), CheckMalformed(), CheckListenRetry() };
+    }
+
+    std::vector<PipeThroughputResult> RunPipeThroughputBenchmark(const uint32_t messages)
+    {
+        std::vector<PipeThroughputResult> results;
+        for (const size_t messageChars : { 64, 2048, 32768 })
+        {
+            results.push_back(RunThroughput(L"Per message", messageChars, messages, MakeLegacy));
+            results.push_back(RunThroughput(L"Session", messageChars, messages, MakeSession));
+        }
+
+        return results;
+    }
+
+    std::vector<PipeLatencyResult> RunPipeLatencyBenchmark(const uint32_t roundTrips)
+    {
+        return {
+            RunLatency(L"Per message", roundTrips, MakeLegacy),
+            RunLatency(L"Session", roundTrips, MakeSession),
+        };
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+namespace CommonBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Framing of split reads, ordering across threads, reconnecting to a restarted peer, peers sending one message per
+    // connection, malformed frames and listening again after a failure of the session mode of TwoWayPipeMessageIPC
+    std::vector<CheckResult> RunPipeSessionChecks(unsigned int seed);
+
+    struct PipeThroughputResult
+    {
+        std::wstring ipc;
+        size_t messageChars = {};
+        uint64_t messages = {};
+        double messagesPerSecond = {};
+        double megabytesPerSecond = {};
+        // Connections the listening side accepted, and the threads it started for them
+        uint64_t connections = {};
+        uint64_t threads = {};
+    };
+
+    // One message per connection against the session mode, for short, medium and large messages
+    std::vector<PipeThroughputResult> RunPipeThroughputBenchmark(uint32_t messages);
+
+    struct PipeLatencyResult
+    {
+        std::wstring ipc;
+        uint32_t roundTrips = {};
+        double p50Us = {};
+        double p99Us = {};
+        double maxUs = {};
+    };
+
+    // A message sent to the peer and sent back by it, the next one sent once it's back
+    std::vector<PipeLatencyResult> RunPipeLatencyBenchmark(uint32_t roundTrips);
+}
@@ -0,0 +1,218 @@
+#include "pch.h"
+
+#include <iostream>
+#include <string_view>
+
+#include "BinaryLogBenchmark.h"
+#include "LoggerBenchmark.h"
+#include "MessageQueueBenchmark.h"
+#include "PipeSessionBenchmark.h"
+
+using namespace CommonBenchmark;
+
+namespace
+{
+    struct Options
+    {
+        // Messages queued in every message queue case, split between the producers
+        uint32_t queueMessages = 200000;
+        // Messages sent in every pipe throughput case
+        uint32_t ipcMessages = 2000;
+        // Messages sent and sent back in every pipe latency case
+        uint32_t roundTrips = 500;
+        // Messages logged in every logger case, split between the logging threads
+        uint32_t logMessages = 20000;
+        // Messages logged in every text and binary log case
+        uint32_t binaryMessages = 100000;
+        unsigned int seed = 42;
+    };
+
+    void PrintUsage()
+    {
+        std::wcout << L"Usage: CommonBenchmark.exe [options]\n"
+                   << L"  --queue-messages <n>    messages queued in every message queue case (default 200000)\n"
+                   << L"  --ipc-messages <n>      messages sent in every pipe throughput case (default 2000)\n"
+                   << L"  --round-trips <n>       messages sent and sent back in every pipe latency case (default 500)\n"
+                   << L"  --log-messages <n>      messages logged in every logger case (default 20000)\n"
+                   << L"  --binary-messages <n>   messages logged in every text and binary log case (default 100000)\n"
+                   << L"  --seed <n>              random seed (default 42)\n";
+    }
+
+    bool ParseOptions(int argc, wchar_t* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::wstring arg = argv[i];
+            if (i + 1 >= argc)
+            {
+                return false;
+            }
+
+            const std::wstring value = argv[++i];
+            try
+            {
+                if (arg == L"--queue-messages")
+                {
+                    options.queueMessages = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--ipc-messages")
+                {
+                    options.ipcMessages = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--round-trips")
+                {
+                    options.roundTrips = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--log-messages")
+                {
+                    options.logMessages = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--binary-messages")
+                {
+                    options.binaryMessages = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--seed")
+                {
+                    options.seed = static_cast<unsigned int>(std::stoul(value));
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+        }
+
+        return options.queueMessages > 0 && options.ipcMessages > 0 && options.roundTrips > 0 && options.logMessages > 0 && options.binaryMessages > 0;
+    }
+
+    int Run(int argc, wchar_t* argv[])
+    {
+        Options options;
+        if (!ParseOptions(argc, argv, options))
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        size_t failures = 0;
+        wprintf(L"Message queue checks\n\n");
+        for (const auto& result : RunMessageQueueChecks())
+        {
+            wprintf(L"%-24ls %10zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        wprintf(L"\nPipe session checks\n\n");
+        for (const auto& result : RunPipeSessionChecks(options.seed))
+        {
+            wprintf(L"%-24ls %10zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        wprintf(L"\nLogger checks\n\n");
+        for (const auto& result : RunLoggerChecks())
+        {
+            wprintf(L"%-24ls %10zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        wprintf(L"\nBinary log checks\n\n");
+        for (const auto& result : RunBinaryLogChecks())
+        {
+            wprintf(L"%-24ls %10zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        wprintf(L"\nMessage queue, %u messages per case, %u threads\n\n", options.queueMessages, std::thread::hardware_concurrency());
+        for (const auto& result : RunMessageQueueBenchmark(options.queueMessages))
+        {
+            wprintf(L"%-10ls %2zu producers %8llu messages %12.0f messages/s %8.1f ns/push\n",
+                    result.queue.c_str(),
+                    result.producers,
+                    static_cast<unsigned long long>(result.messages),
+                    result.messagesPerSecond,
+                    result.pushMeanNs);
+        }
+
+        wprintf(L"\nPipe throughput, %u messages per case\n\n", options.ipcMessages);
+        for (const auto& result : RunPipeThroughputBenchmark(options.ipcMessages))
+        {
+            wprintf(L"%-12ls %6zu chars %6llu messages %10.0f messages/s %8.1f MB/s %6llu connections %6llu threads\n",
+                    result.ipc.c_str(),
+                    result.messageChars,
+                    static_cast<unsigned long long>(result.messages),
+                    result.messagesPerSecond,
+                    result.megabytesPerSecond,
+                    static_cast<unsigned long long>(result.connections),
+                    static_cast<unsigned long long>(result.threads));
+        }
+
+        wprintf(L"\nPipe round trips, 64 char messages\n\n");
+        for (const auto& result : RunPipeLatencyBenchmark(options.roundTrips))
+        {
+            wprintf(L"%-12ls %6u round trips %9.1f us p50 %9.1f us p99 %9.1f us max\n",
+                    result.ipc.c_str(),
+                    result.roundTrips,
+                    result.p50Us,
+                    result.p99Us,
+                    result.maxUs);
+        }
+
+        wprintf(L"\nLogger, %u messages per case, time spent in the call on the logging thread\n\n", options.logMessages);
+        for (const auto& result : RunLoggerBenchmark(options.logMessages))
+        {
+            wprintf(L"%-12ls %2zu threads %8llu messages %9.0f ns p50 %9.0f ns p99 %10.0f ns max %9.0f ns mean %8llu dropped %8llu lines\n",
+                    result.mode.c_str(),
+                    result.threads,
+                    static_cast<unsigned long long>(result.messages),
+                    result.p50Ns,
+                    result.p99Ns,
+                    result.maxNs,
+                    result.meanNs,
+                    static_cast<unsigned long long>(result.dropped),
+                    static_cast<unsigned long long>(result.lines));
+        }
+
+        wprintf(L"\nText and binary log, %u messages per case\n\n", options.binaryMessages);
+        for (const auto& result : RunBinaryLogBenchmark(options.binaryMessages))
+        {
+            wprintf(L"%-16ls %8llu messages %9.1f ns/message %7.1f bytes/message\n",
+                    result.format.c_str(),
+                    static_cast<unsigned long long>(result.messages),
+                    result.nsPerMessage,
+                    result.bytesPerMessage);
+        }
+
+        return failures == 0 ? 0 : 1;
+    }
+}
+
+#ifdef _WIN32
+int wmain(int argc, wchar_t* argv[])
+{
+    return Run(argc, argv);
+}
+#else
+// The options are ASCII
+int main(int argc, char* argv[])
+{
+    std::vector<std::wstring> arguments;
+    for (int i = 0; i < argc; i++)
+    {
+        const std::string_view argument = argv[i];
+        arguments.emplace_back(argument.begin(), argument.end());
+    }
+
+    std::vector<wchar_t*> pointers;
+    for (auto& argument : arguments)
+    {
+        pointers.push_back(argument.data());
+    }
+
+    return Run(argc, pointers.data());
+}
+#endif
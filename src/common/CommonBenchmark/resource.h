@@ -0,0 +1,13 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by CommonBenchmark.rc
+
+//////////////////////////////
+// Non-localizable
+
+#define FILE_DESCRIPTION "PowerToys Common Libraries Benchmark"
+#define INTERNAL_NAME "CommonBenchmark"
+#define ORIGINAL_FILENAME "CommonBenchmark.exe"
+
+// Non-localizable
+//////////////////////////////
@@ -1,54 +1,193 @@
 #pragma once
-#include <queue>
-#include <thread>
-#include <mutex>
+#include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include <common/utils/mpsc_ring.h>
+
+// Queue of messages which any thread pushes into and a single thread pops from. Pushing and popping don't take a lock:
+// the messages go through an MpscRing, and are moved in and out, never copied. The consumer only parks when the queue
+// is empty, and producers only take the lock to wake it up once it has parked.
+// Producers never wait: while the ring is full, messages go to an overflow list under the lock instead, which is taken
+// after the ring so every producer's messages stay in order. The list isn't bounded, a consumer which stops popping
+// lets it grow.
 class AsyncMessageQueue
 {
 private:
-    std::mutex queue_mutex;
-    std::queue<std::wstring> message_queue;
+    MpscRing<std::wstring> ring;
+
+    std::atomic_bool interrupted = false;
+    std::atomic_bool consumer_parked = false;
+    std::atomic<size_t> overflow_size = 0;
+    std::mutex park_mutex;
     std::condition_variable message_ready;
-    bool interrupted = false;
+    std::deque<std::wstring> overflow;
+
+    bool empty() const
+    {
+        return !ring.can_pop() && overflow_size.load(std::memory_order_acquire) == 0;
+    }
+
+    // Parks the consumer until a message is queued. False if the queue was interrupted.
+    bool wait_for_message()
+    {
+        while (!interrupted.load(std::memory_order_acquire))
+        {
+            if (!empty())
+            {
+                return true;
+            }
+
+            // Either the producer sees the consumer parked after queuing, or the consumer sees the message before parking
+            consumer_parked.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> lock(park_mutex);
+                message_ready.wait(lock, [this] { return interrupted.load(std::memory_order_acquire) || !empty(); });
+            }
+            consumer_parked.store(false, std::memory_order_relaxed);
+        }
+
+        return false;
+    }
+
+    void wake_consumer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumer_parked.load(std::memory_order_relaxed))
+        {
+            {
+                std::lock_guard<std::mutex> lock(park_mutex);
+            }
+            message_ready.notify_one();
+        }
+    }
+
+    void push_overflow(std::wstring& message)
+    {
+        {
+            std::lock_guard<std::mutex> lock(park_mutex);
+            overflow.push_back(std::move(message));
+            overflow_size.store(overflow.size(), std::memory_order_release);
+        }
+        message_ready.notify_one();
+    }
+
+    size_t pop_overflow(std::vector<std::wstring>& messages, const size_t max_count)
+    {
+        std::lock_guard<std::mutex> lock(park_mutex);
+        size_t count = 0;
+        for (; count < max_count && !overflow.empty(); ++count)
+        {
+            messages.push_back(std::move(overflow.front()));
+            overflow.pop_front();
+        }
+        overflow_size.store(overflow.size(), std::memory_order_release);
+        return count;
+    }
 
-    //Disable copy
-    AsyncMessageQueue(const AsyncMessageQueue&);
-    AsyncMessageQueue& operator=(const AsyncMessageQueue&);
+    // Pops up to max_count messages. A producer's messages in the overflow list were all queued after its messages in
+    // the ring, so the list is only taken once no push into the ring is in flight anymore.
+    void pop_available(std::vector<std::wstring>& messages, const size_t max_count)
+    {
+        std::wstring message;
+        size_t count = 0;
+        while (count < max_count)
+        {
+            if (ring.try_pop(message))
+            {
+                messages.push_back(std::move(message));
+                count++;
+            }
+            else if (overflow_size.load(std::memory_order_acquire) == 0)
+            {
+                break;
+            }
+            else if (ring.drained())
+            {
+                count += pop_overflow(messages, max_count - count);
+                break;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
 
 public:
-    AsyncMessageQueue()
+    static constexpr size_t default_capacity = 1024;
+
+    // The capacity is rounded up to a power of two
+    explicit AsyncMessageQueue(const size_t capacity = default_capacity) :
+        ring{ capacity }
     {
     }
+
+    AsyncMessageQueue(const AsyncMessageQueue&) = delete;
+    AsyncMessageQueue& operator=(const AsyncMessageQueue&) = delete;
+
+    // Messages queued after interrupt() are dropped
     void queue_message(std::wstring message)
     {
-        this->queue_mutex.lock();
-        this->message_queue.push(message);
-        this->queue_mutex.unlock();
-        this->message_ready.notify_one();
+        if (interrupted.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        // Once a message overflowed, the following ones go after it until the consumer took it
+        if (overflow_size.load(std::memory_order_acquire) == 0 && ring.try_push(std::move(message)))
+        {
+            wake_consumer();
+            return;
+        }
+
+        push_overflow(message);
     }
+
+    // Waits for a message. Just returns an empty string once the queue was interrupted.
     std::wstring pop_message()
     {
-        std::unique_lock<std::mutex> lock(this->queue_mutex);
-        while (message_queue.empty() && !this->interrupted)
+        std::wstring message;
+        if (!wait_for_message())
         {
-            this->message_ready.wait(lock);
+            return std::wstring(L"");
         }
-        if (this->interrupted)
+
+        if (!ring.try_pop(message))
         {
-            //Just returns a empty string if the queue was interrupted.
-            return std::wstring(L"");
+            std::vector<std::wstring> messages;
+            pop_available(messages, 1);
+            message = std::move(messages.front());
         }
-        std::wstring message = this->message_queue.front();
-        this->message_queue.pop();
+
         return message;
     }
+
+    // Waits for a message, then moves every queued message to the end of messages. False once the queue was interrupted.
+    bool pop_messages(std::vector<std::wstring>& messages)
+    {
+        if (!wait_for_message())
+        {
+            return false;
+        }
+
+        pop_available(messages, SIZE_MAX);
+        return true;
+    }
+
     void interrupt()
     {
-        this->queue_mutex.lock();
-        this->interrupted = true;
-        this->queue_mutex.unlock();
-        this->message_ready.notify_all();
+        {
+            std::lock_guard<std::mutex> lock(park_mutex);
+            interrupted.store(true, std::memory_order_release);
+        }
+        message_ready.notify_all();
     }
 };
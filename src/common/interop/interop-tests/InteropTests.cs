@@ -3,6 +3,7 @@
 // See the LICENSE file in the project root for more information.
 
 using System;
+using System.Collections.Concurrent;
 using System.Threading;
 using interop;
 using Microsoft.VisualStudio.TestTools.UnitTesting;
@@ -14,6 +15,8 @@ namespace Microsoft.Interop.Tests
     {
         private const string ServerSidePipe = "\\\\.\\pipe\\serverside";
         private const string ClientSidePipe = "\\\\.\\pipe\\clientside";
+        private const string ServerSideSessionPipe = "\\\\.\\pipe\\serversidesession";
+        private const string ClientSideSessionPipe = "\\\\.\\pipe\\clientsidesession";
 
         internal TwoWayPipeMessageIPCManaged ClientPipe { get; set; }
 
@@ -60,6 +63,47 @@ namespace Microsoft.Interop.Tests
             }
         }
 
+        [TestMethod]
+        public void TestSendSession()
+        {
+            var testStrings = new[] { "First message of the session\n", "Second message of the session\n" };
+            var received = new ConcurrentQueue<string>();
+            using (var reset = new AutoResetEvent(false))
+            {
+                using (var serverPipe = new TwoWayPipeMessageIPCManaged(
+                    ServerSideSessionPipe,
+                    ClientSideSessionPipe,
+                    (string msg) =>
+                    {
+                        received.Enqueue(msg);
+                        if (received.Count == testStrings.Length)
+                        {
+                            reset.Set();
+                        }
+                    },
+                    true))
+                {
+                    using (var clientPipe = new TwoWayPipeMessageIPCManaged(ClientSideSessionPipe, ServerSideSessionPipe, null, true))
+                    {
+                        // The session reconnects until the server pipe is listening, so there's no need to wait for it
+                        clientPipe.Start();
+                        foreach (var testString in testStrings)
+                        {
+                            clientPipe.Send(testString);
+                        }
+
+                        serverPipe.Start();
+                        Assert.IsTrue(reset.WaitOne(TimeSpan.FromSeconds(10)));
+                        CollectionAssert.AreEqual(testStrings, received.ToArray());
+
+                        clientPipe.End();
+                    }
+
+                    serverPipe.End();
+                }
+            }
+        }
+
         protected virtual void Dispose(bool disposing)
         {
             if (!disposedValue)
@@ -67,18 +67,13 @@ public
 
         TwoWayPipeMessageIPCManaged(String ^ inputPipeName, String ^ outputPipeName, ReadCallback ^ callback)
         {
-            _wrapperCallback = gcnew InternalReadCallback(this, &TwoWayPipeMessageIPCManaged::ReadCallbackHelper);
-            _callback = callback;
+            Initialize(inputPipeName, outputPipeName, callback, false);
+        }
 
-            TwoWayPipeMessageIPC::callback_function cb = nullptr;
-            if (callback != nullptr)
-            {
-                cb = (TwoWayPipeMessageIPC::callback_function)(void*)Marshal::GetFunctionPointerForDelegate(_wrapperCallback);
-            }
-            _pipe = new TwoWayPipeMessageIPC(
-                msclr::interop::marshal_as<std::wstring>(inputPipeName),
-                msclr::interop::marshal_as<std::wstring>(outputPipeName),
-                cb);
+        // The session mode keeps one connection open to the peer, which has to use it as well
+        TwoWayPipeMessageIPCManaged(String ^ inputPipeName, String ^ outputPipeName, ReadCallback ^ callback, bool session)
+        {
+            Initialize(inputPipeName, outputPipeName, callback, session);
         }
 
         ~TwoWayPipeMessageIPCManaged()
@@ -118,6 +113,23 @@ public
         {
             _callback(gcnew String(msg.c_str()));
         }
+
+        void Initialize(String ^ inputPipeName, String ^ outputPipeName, ReadCallback ^ callback, bool session)
+        {
+            _wrapperCallback = gcnew InternalReadCallback(this, &TwoWayPipeMessageIPCManaged::ReadCallbackHelper);
+            _callback = callback;
+
+            TwoWayPipeMessageIPC::callback_function cb = nullptr;
+            if (callback != nullptr)
+            {
+                cb = (TwoWayPipeMessageIPC::callback_function)(void*)Marshal::GetFunctionPointerForDelegate(_wrapperCallback);
+            }
+            _pipe = new TwoWayPipeMessageIPC(
+                msclr::interop::marshal_as<std::wstring>(inputPipeName),
+                msclr::interop::marshal_as<std::wstring>(outputPipeName),
+                cb,
+                session);
+        }
     };
 
 public
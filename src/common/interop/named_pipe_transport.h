@@ -0,0 +1,283 @@
+#pragma once
+#include <Windows.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "pipe_session.h"
+
+// pipe_session::transport over the named pipes of TwoWayPipeMessageIPC. The listening pipe is served with overlapped
+// I/O on the thread calling serve(): one instance waits for a client while every connected instance has a read pending,
+// all of them waited on together.
+class named_pipe_transport : public pipe_session::transport
+{
+public:
+    // prepare_instance is called for every instance of the listening pipe created, e.g. to let a restricted token connect
+    named_pipe_transport(std::wstring input_pipe_name, std::wstring output_pipe_name, std::function<void(HANDLE)> prepare_instance) :
+        input_pipe_name{ std::move(input_pipe_name) },
+        output_pipe_name{ std::move(output_pipe_name) },
+        prepare_instance{ std::move(prepare_instance) },
+        stop_event{ CreateEvent(NULL, TRUE, FALSE, NULL) }
+    {
+    }
+
+    ~named_pipe_transport() override
+    {
+        if (stop_event != NULL)
+        {
+            CloseHandle(stop_event);
+        }
+    }
+
+    std::unique_ptr<pipe_session::stream> connect() override
+    {
+        HANDLE pipe = CreateFile(output_pipe_name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+        if (pipe == INVALID_HANDLE_VALUE)
+        {
+            // The session backs off between attempts, so don't wait long for an instance here
+            if (GetLastError() == ERROR_PIPE_BUSY)
+            {
+                WaitNamedPipe(output_pipe_name.c_str(), busy_wait_ms);
+            }
+
+            return nullptr;
+        }
+
+        return std::make_unique<pipe_stream>(pipe);
+    }
+
+    void serve(pipe_session::connection_handler& handler) override
+    {
+        std::unique_ptr<instance> listening;
+        std::vector<std::unique_ptr<instance>> connections;
+        std::vector<HANDLE> events;
+        uint64_t next_id = 1;
+        auto backoff = pipe_session::min_listen_backoff;
+        while (true)
+        {
+            // WaitForMultipleObjects takes up to 64 handles, the stop event and the listening instance included
+            DWORD timeout = INFINITE;
+            if (!listening && connections.size() < MAXIMUM_WAIT_OBJECTS - 2)
+            {
+                DWORD error = ERROR_SUCCESS;
+                listening = listen(error);
+                if (listening)
+                {
+                    backoff = pipe_session::min_listen_backoff;
+                }
+                else
+                {
+                    // Nothing else would wake the loop up to listen again while no connection is open
+                    handler.listen_failed(error);
+                    timeout = static_cast<DWORD>(backoff.count());
+                    backoff = pipe_session::next_listen_backoff(backoff);
+                }
+            }
+
+            events.assign({ stop_event });
+            if (listening)
+            {
+                events.push_back(listening->overlapped.hEvent);
+            }
+
+            for (const auto& connection : connections)
+            {
+                events.push_back(connection->overlapped.hEvent);
+            }
+
+            const DWORD signaled = WaitForMultipleObjects(static_cast<DWORD>(events.size()), events.data(), FALSE, timeout);
+            if (signaled == WAIT_TIMEOUT)
+            {
+                continue;
+            }
+
+            if (signaled == WAIT_OBJECT_0 || signaled >= WAIT_OBJECT_0 + events.size())
+            {
+                break;
+            }
+
+            size_t index = signaled - WAIT_OBJECT_0 - 1;
+            if (listening && index == 0)
+            {
+                DWORD unused;
+                if (GetOverlappedResult(listening->pipe, &listening->overlapped, &unused, FALSE) || GetLastError() == ERROR_PIPE_CONNECTED)
+                {
+                    listening->id = next_id++;
+                    handler.connected(listening->id);
+                    if (read(handler, *listening))
+                    {
+                        connections.push_back(std::move(listening));
+                    }
+                    else
+                    {
+                        handler.closed(listening->id);
+                    }
+                }
+
+                listening.reset();
+                continue;
+            }
+
+            if (listening)
+            {
+                --index;
+            }
+
+            auto& connection = *connections[index];
+            DWORD bytes_read = 0;
+            // A message larger than the buffer is read in parts
+            const bool read_ok = GetOverlappedResult(connection.pipe, &connection.overlapped, &bytes_read, FALSE) || GetLastError() == ERROR_MORE_DATA;
+            if (!read_ok || !handler.received(connection.id, bytes_read) || !read(handler, connection))
+            {
+                handler.closed(connection.id);
+                connections.erase(connections.begin() + index);
+            }
+        }
+
+        for (const auto& connection : connections)
+        {
+            handler.closed(connection->id);
+        }
+    }
+
+    void stop() override
+    {
+        SetEvent(stop_event);
+    }
+
+private:
+    static constexpr DWORD busy_wait_ms = 100;
+    static constexpr DWORD pipe_buffer_size = 64 * 1024;
+
+    class pipe_stream : public pipe_session::stream
+    {
+    public:
+        explicit pipe_stream(HANDLE pipe) :
+            pipe{ pipe }
+        {
+        }
+
+        ~pipe_stream() override
+        {
+            CloseHandle(pipe);
+        }
+
+        bool write(const char* data, size_t size) override
+        {
+            while (size > 0)
+            {
+                DWORD written = 0;
+                if (!WriteFile(pipe, data, static_cast<DWORD>((std::min)<size_t>(size, MAXDWORD)), &written, NULL))
+                {
+                    return false;
+                }
+
+                data += written;
+                size -= written;
+            }
+
+            return true;
+        }
+
+        void cancel() override
+        {
+            CancelIoEx(pipe, NULL);
+        }
+
+    private:
+        HANDLE pipe;
+    };
+
+    // An instance of the listening pipe with the overlapped operation pending on it
+    struct instance
+    {
+        HANDLE pipe = INVALID_HANDLE_VALUE;
+        OVERLAPPED overlapped{};
+        uint64_t id = 0;
+
+        instance() { overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL); }
+        instance(const instance&) = delete;
+        instance& operator=(const instance&) = delete;
+
+        ~instance()
+        {
+            if (pipe != INVALID_HANDLE_VALUE)
+            {
+                // The pending operation writes to overlapped, so it's waited for
+                DWORD unused;
+                if (CancelIoEx(pipe, &overlapped) || GetLastError() != ERROR_NOT_FOUND)
+                {
+                    GetOverlappedResult(pipe, &overlapped, &unused, TRUE);
+                }
+
+                DisconnectNamedPipe(pipe);
+                CloseHandle(pipe);
+            }
+
+            if (overlapped.hEvent != NULL)
+            {
+                CloseHandle(overlapped.hEvent);
+            }
+        }
+    };
+
+    // nullptr with the error if the instance can't be created or wait for a client
+    std::unique_ptr<instance> listen(DWORD& error)
+    {
+        auto listening = std::make_unique<instance>();
+        listening->pipe = CreateNamedPipe(
+            input_pipe_name.c_str(),
+            PIPE_ACCESS_DUPLEX | WRITE_DAC | FILE_FLAG_OVERLAPPED,
+            PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT,
+            PIPE_UNLIMITED_INSTANCES,
+            pipe_buffer_size,
+            pipe_buffer_size,
+            0,
+            NULL);
+        if (listening->pipe == INVALID_HANDLE_VALUE || listening->overlapped.hEvent == NULL)
+        {
+            error = GetLastError();
+            return nullptr;
+        }
+
+        if (prepare_instance)
+        {
+            prepare_instance(listening->pipe);
+        }
+
+        if (!ConnectNamedPipe(listening->pipe, &listening->overlapped))
+        {
+            error = GetLastError();
+            if (error == ERROR_PIPE_CONNECTED)
+            {
+                // A client connected between creating the instance and waiting for one
+                SetEvent(listening->overlapped.hEvent);
+            }
+            else if (error != ERROR_IO_PENDING)
+            {
+                return nullptr;
+            }
+        }
+
+        return listening;
+    }
+
+    // Starts the next read of the connection, its completion signals the event of the instance
+    bool read(pipe_session::connection_handler& handler, instance& connection)
+    {
+        size_t size = 0;
+        char* buffer = handler.read_buffer(connection.id, size);
+        if (!ReadFile(connection.pipe, buffer, static_cast<DWORD>((std::min)<size_t>(size, MAXDWORD)), NULL, &connection.overlapped))
+        {
+            const DWORD error = GetLastError();
+            return error == ERROR_IO_PENDING || error == ERROR_MORE_DATA;
+        }
+
+        return true;
+    }
+
+    std::wstring input_pipe_name;
+    std::wstring output_pipe_name;
+    std::function<void(HANDLE)> prepare_instance;
+    HANDLE stop_event;
+};
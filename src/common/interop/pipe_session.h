@@ -0,0 +1,673 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// The portable core of the session mode of TwoWayPipeMessageIPC. A session keeps one connection to the listening pipe
+// of the peer open and sends every batch of queued messages through it as length-prefixed frames, instead of opening
+// the pipe for every message. The listening side serves all of its connections on one I/O thread. The pipes themselves
+// are behind pipe_session::transport, implemented over named pipes on Windows and over Unix sockets for the tests.
+// Messages are never dropped: they queue up while the peer can't be reached, and frames whose write failed are written
+// again whole on the next connection. The peer may have read some of them before the connection broke, and then gets
+// those twice.
+namespace pipe_session
+{
+    // Written first on every session connection. A connection which doesn't start with it carries a single message, as
+    // sent by TwoWayPipeMessageIPC without the session mode, up to the end of the connection.
+    constexpr uint32_t session_magic = 0x31535450; // "PTS1"
+
+    // A frame is its payload size followed by the message as UTF-16 code units, both little-endian
+    constexpr size_t frame_header_size = sizeof(uint32_t);
+    constexpr uint32_t max_frame_size = 64 * 1024 * 1024;
+
+    // Between attempts to listen again after the listening pipe failed, doubling from the first to the last
+    constexpr std::chrono::milliseconds min_listen_backoff{ 100 };
+    constexpr std::chrono::milliseconds max_listen_backoff{ 5000 };
+
+    inline std::chrono::milliseconds next_listen_backoff(const std::chrono::milliseconds backoff)
+    {
+        return (std::min)(backoff * 2, max_listen_backoff);
+    }
+
+    inline void append_uint32(std::vector<char>& out, const uint32_t value)
+    {
+        const char bytes[] = { static_cast<char>(value), static_cast<char>(value >> 8), static_cast<char>(value >> 16), static_cast<char>(value >> 24) };
+        out.insert(out.end(), std::begin(bytes), std::end(bytes));
+    }
+
+    inline uint32_t read_uint32(const char* data)
+    {
+        const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+        return static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 | static_cast<uint32_t>(bytes[2]) << 16 |
+               static_cast<uint32_t>(bytes[3]) << 24;
+    }
+
+    inline void append_utf16_unit(std::vector<char>& out, const uint32_t unit)
+    {
+        out.push_back(static_cast<char>(unit));
+        out.push_back(static_cast<char>(unit >> 8));
+    }
+
+    // Appends the message as UTF-16, which is what wchar_t holds on Windows
+    inline void append_utf16(std::vector<char>& out, const std::wstring_view message)
+    {
+        if constexpr (sizeof(wchar_t) == sizeof(char16_t))
+        {
+            const auto* bytes = reinterpret_cast<const char*>(message.data());
+            out.insert(out.end(), bytes, bytes + message.size() * sizeof(wchar_t));
+        }
+        else
+        {
+            for (const wchar_t c : message)
+            {
+                const auto code_point = static_cast<uint32_t>(c);
+                if (code_point >= 0x10000)
+                {
+                    append_utf16_unit(out, 0xD800 + ((code_point - 0x10000) >> 10));
+                    append_utf16_unit(out, 0xDC00 + ((code_point - 0x10000) & 0x3FF));
+                }
+                else
+                {
+                    append_utf16_unit(out, code_point);
+                }
+            }
+        }
+    }
+
+    inline std::wstring decode_utf16(const char* data, const size_t size)
+    {
+        std::wstring message;
+        if constexpr (sizeof(wchar_t) == sizeof(char16_t))
+        {
+            message.resize(size / sizeof(wchar_t));
+            std::memcpy(message.data(), data, message.size() * sizeof(wchar_t));
+        }
+        else
+        {
+            const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+            message.reserve(size / 2);
+            for (size_t i = 0; i + 1 < size; i += 2)
+            {
+                const uint32_t unit = bytes[i] | bytes[i + 1] << 8;
+                if (unit >= 0xD800 && unit < 0xDC00 && i + 3 < size)
+                {
+                    const uint32_t low = bytes[i + 2] | bytes[i + 3] << 8;
+                    if (low >= 0xDC00 && low < 0xE000)
+                    {
+                        message.push_back(static_cast<wchar_t>(0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00)));
+                        i += 2;
+                        continue;
+                    }
+                }
+
+                message.push_back(static_cast<wchar_t>(unit));
+            }
+        }
+
+        return message;
+    }
+
+    inline void append_frame(std::vector<char>& out, const std::wstring_view message)
+    {
+        const size_t header = out.size();
+        append_uint32(out, 0);
+        append_utf16(out, message);
+        const auto size = static_cast<uint32_t>(out.size() - header - frame_header_size);
+        for (size_t i = 0; i < frame_header_size; ++i)
+        {
+            out[header + i] = static_cast<char>(size >> (8 * i));
+        }
+    }
+
+    // Collects the bytes read from one connection and splits them into frames. Reads go straight into the buffer, which
+    // grows while reads fill it and shrinks back once it's idle, so a stream of small messages doesn't hold on to the
+    // memory of a large one.
+    class frame_reader
+    {
+    public:
+        static constexpr size_t min_read_size = 4 * 1024;
+        static constexpr size_t max_read_size = 1024 * 1024;
+
+        // The space the next read fills, room for the rest of a partly read frame included
+        char* read_buffer(size_t& size)
+        {
+            size_t wanted = _read_size;
+            if (pending_size() >= frame_header_size)
+            {
+                const size_t frame = frame_header_size + read_uint32(_buffer.data() + _begin);
+                if (frame <= frame_header_size + max_frame_size && frame > pending_size())
+                {
+                    wanted = (std::max)(wanted, frame - pending_size());
+                }
+            }
+
+            if (_begin > 0 && _buffer.size() - _end < wanted)
+            {
+                std::memmove(_buffer.data(), _buffer.data() + _begin, pending_size());
+                _end -= _begin;
+                _begin = 0;
+            }
+
+            if (_buffer.size() - _end < wanted)
+            {
+                _buffer.resize(_end + wanted);
+            }
+
+            size = _buffer.size() - _end;
+            return _buffer.data() + _end;
+        }
+
+        // Takes the bytes read into the read buffer
+        void commit(const size_t size)
+        {
+            const size_t offered = _buffer.size() - _end;
+            _end += size;
+            if (size == offered)
+            {
+                _read_size = (std::min)(_read_size * 2, max_read_size);
+            }
+            else if (size < _read_size / 4 && _read_size > min_read_size)
+            {
+                _read_size /= 2;
+            }
+        }
+
+        const char* pending() const
+        {
+            return _buffer.data() + _begin;
+        }
+
+        size_t pending_size() const
+        {
+            return _end - _begin;
+        }
+
+        void consume(const size_t size)
+        {
+            _begin += size;
+            if (_begin == _end)
+            {
+                _begin = _end = 0;
+                if (_buffer.size() > 4 * _read_size)
+                {
+                    _buffer.resize(_read_size);
+                    _buffer.shrink_to_fit();
+                }
+            }
+        }
+
+        // Calls on_frame(payload, size) for every complete frame. False if the size of a frame is past the limit.
+        template<typename OnFrame>
+        bool drain(OnFrame&& on_frame)
+        {
+            while (pending_size() >= frame_header_size)
+            {
+                const uint32_t size = read_uint32(pending());
+                if (size > max_frame_size)
+                {
+                    return false;
+                }
+
+                if (pending_size() < frame_header_size + size)
+                {
+                    break;
+                }
+
+                on_frame(pending() + frame_header_size, static_cast<size_t>(size));
+                consume(frame_header_size + size);
+            }
+
+            return true;
+        }
+
+        size_t capacity() const
+        {
+            return _buffer.size();
+        }
+
+    private:
+        std::vector<char> _buffer;
+        size_t _begin = 0;
+        size_t _end = 0;
+        size_t _read_size = min_read_size;
+    };
+
+    // A connection to the listening pipe of the peer
+    class stream
+    {
+    public:
+        virtual ~stream() = default;
+
+        // Writes all of the bytes, false once the connection is broken
+        virtual bool write(const char* data, size_t size) = 0;
+
+        // Makes a write blocked on another thread fail
+        virtual void cancel() = 0;
+    };
+
+    // Called by transport::serve on its I/O thread for every connection to the listening pipe
+    class connection_handler
+    {
+    public:
+        virtual ~connection_handler() = default;
+
+        virtual void connected(uint64_t id) = 0;
+        // The space the next read of the connection fills
+        virtual char* read_buffer(uint64_t id, size_t& size) = 0;
+        // False to close the connection
+        virtual bool received(uint64_t id, size_t size) = 0;
+        virtual void closed(uint64_t id) = 0;
+        // The listening pipe couldn't be created or wait for a client. The transport tries again after a backoff,
+        // serving the open connections meanwhile.
+        virtual void listen_failed(uint32_t error) = 0;
+    };
+
+    class transport
+    {
+    public:
+        virtual ~transport() = default;
+
+        // Connects to the listening pipe of the peer, nullptr if it isn't listening
+        virtual std::unique_ptr<stream> connect() = 0;
+
+        // Listens and serves every connection on the calling thread until stop() is called. Serves only once.
+        virtual void serve(connection_handler& handler) = 0;
+
+        virtual void stop() = 0;
+    };
+
+    struct options
+    {
+        // Between attempts to connect to the peer, doubling from the first to the last
+        std::chrono::milliseconds min_backoff{ 10 };
+        std::chrono::milliseconds max_backoff{ 1000 };
+        // Called on the I/O thread with a description of failures the session recovers from, e.g. to log them
+        std::function<void(const std::wstring& error)> on_error;
+    };
+
+    struct statistics
+    {
+        uint64_t connects = 0;
+        uint64_t failed_connects = 0;
+        uint64_t batches = 0;
+        uint64_t sent = 0;
+        // Messages too large for a frame, sent through a connection of their own
+        uint64_t single_message_sends = 0;
+        uint64_t received = 0;
+        uint64_t single_message_connections = 0;
+        uint64_t served_connections = 0;
+        uint64_t malformed_connections = 0;
+        uint64_t listen_failures = 0;
+    };
+
+    class session : private connection_handler
+    {
+    public:
+        using message_callback = std::function<void(std::wstring message)>;
+
+        // on_message is called on the I/O thread with every message received
+        session(transport& transport, message_callback on_message, options options = {}) :
+            _transport{ transport }, _on_message{ std::move(on_message) }, _options{ options }
+        {
+        }
+
+        session(const session&) = delete;
+        session& operator=(const session&) = delete;
+
+        ~session()
+        {
+            end();
+        }
+
+        void start()
+        {
+            _io_thread = std::thread([this] { _transport.serve(*this); });
+            _send_thread = std::thread(&session::send_queued, this);
+        }
+
+        void send(std::wstring message)
+        {
+            {
+                std::unique_lock lock{ _mutex };
+                _queued.push_back(std::move(message));
+            }
+
+            _queued_cv.notify_one();
+        }
+
+        void end()
+        {
+            {
+                std::unique_lock lock{ _mutex };
+                _closed = true;
+                if (_active_stream)
+                {
+                    _active_stream->cancel();
+                }
+            }
+
+            _queued_cv.notify_one();
+            _transport.stop();
+            if (_send_thread.joinable())
+            {
+                _send_thread.join();
+            }
+
+            if (_io_thread.joinable())
+            {
+                _io_thread.join();
+            }
+        }
+
+        statistics stats() const
+        {
+            std::unique_lock lock{ _mutex };
+            return _statistics;
+        }
+
+    private:
+        enum class connection_kind
+        {
+            undecided,
+            session,
+            single_message,
+        };
+
+        struct connection
+        {
+            frame_reader reader;
+            connection_kind kind = connection_kind::undecided;
+        };
+
+        // The peer would close a session connection on a frame past the limit. A wchar_t takes up to two UTF-16 code
+        // units where it's 32 bits.
+        static bool fits_frame(const std::wstring& message)
+        {
+            return message.size() * sizeof(char16_t) * (sizeof(wchar_t) / sizeof(char16_t)) <= max_frame_size;
+        }
+
+        // Connects and writes the session header, or nothing for a connection carrying a single message. Returns
+        // nullptr once the session was ended, end() cancels the returned stream otherwise.
+        std::unique_ptr<stream> connect_with_backoff(const bool session_connection)
+        {
+            auto backoff = _options.min_backoff;
+            while (true)
+            {
+                if (auto connected = _transport.connect())
+                {
+                    std::vector<char> hello;
+                    if (session_connection)
+                    {
+                        append_uint32(hello, session_magic);
+                    }
+
+                    if (hello.empty() || connected->write(hello.data(), hello.size()))
+                    {
+                        std::unique_lock lock{ _mutex };
+                        if (_closed)
+                        {
+                            return nullptr;
+                        }
+
+                        if (session_connection)
+                        {
+                            ++_statistics.connects;
+                        }
+
+                        _active_stream = connected.get();
+                        return connected;
+                    }
+                }
+
+                std::unique_lock lock{ _mutex };
+                ++_statistics.failed_connects;
+                if (_queued_cv.wait_for(lock, backoff, [this] { return _closed; }))
+                {
+                    return nullptr;
+                }
+
+                backoff = (std::min)(backoff * 2, _options.max_backoff);
+            }
+        }
+
+        void release(std::unique_ptr<stream>& released)
+        {
+            std::unique_lock lock{ _mutex };
+            _active_stream = nullptr;
+            released.reset();
+        }
+
+        // Writes the frames through the session connection, connecting again until they got through. Frames which didn't
+        // get through are written again whole, the peer gets the ones it read before the connection broke twice. False
+        // once the session was ended.
+        bool write_frames(std::unique_ptr<stream>& active, const std::vector<char>& frames)
+        {
+            while (true)
+            {
+                if (!active)
+                {
+                    active = connect_with_backoff(true);
+                    if (!active)
+                    {
+                        return false;
+                    }
+                }
+
+                if (active->write(frames.data(), frames.size()))
+                {
+                    return true;
+                }
+
+                release(active);
+            }
+        }
+
+        // Sends the message as TwoWayPipeMessageIPC does without the session mode, as the whole content of a
+        // connection. The frames before it are written first, but the peer reads the connections independently.
+        bool write_single_message(const std::wstring& message)
+        {
+            std::vector<char> bytes;
+            append_utf16(bytes, message);
+            while (true)
+            {
+                auto single = connect_with_backoff(false);
+                if (!single)
+                {
+                    return false;
+                }
+
+                const bool written = single->write(bytes.data(), bytes.size());
+                release(single);
+                if (written)
+                {
+                    std::unique_lock lock{ _mutex };
+                    ++_statistics.single_message_sends;
+                    return true;
+                }
+            }
+        }
+
+        void send_queued()
+        {
+            std::unique_ptr<stream> active;
+            std::vector<std::wstring> batch;
+            std::vector<char> frames;
+            std::unique_lock lock{ _mutex };
+            while (true)
+            {
+                _queued_cv.wait(lock, [this] { return _closed || !_queued.empty(); });
+                if (_closed)
+                {
+                    break;
+                }
+
+                batch.swap(_queued);
+                lock.unlock();
+
+                frames.clear();
+                for (const auto& message : batch)
+                {
+                    if (fits_frame(message))
+                    {
+                        append_frame(frames, message);
+                        continue;
+                    }
+
+                    // Only one stream can be cancelled by end(), so the session connection is reconnected afterwards
+                    if (!frames.empty() && !write_frames(active, frames))
+                    {
+                        return;
+                    }
+
+                    frames.clear();
+                    if (active)
+                    {
+                        release(active);
+                    }
+
+                    if (!write_single_message(message))
+                    {
+                        return;
+                    }
+                }
+
+                if (!frames.empty() && !write_frames(active, frames))
+                {
+                    return;
+                }
+
+                lock.lock();
+                ++_statistics.batches;
+                _statistics.sent += batch.size();
+                batch.clear();
+            }
+
+            _active_stream = nullptr;
+        }
+
+        void deliver(std::wstring message)
+        {
+            {
+                std::unique_lock lock{ _mutex };
+                ++_statistics.received;
+            }
+
+            if (_on_message)
+            {
+                _on_message(std::move(message));
+            }
+        }
+
+        void connected(const uint64_t id) override
+        {
+            _connections[id];
+            std::unique_lock lock{ _mutex };
+            ++_statistics.served_connections;
+        }
+
+        char* read_buffer(const uint64_t id, size_t& size) override
+        {
+            return _connections[id].reader.read_buffer(size);
+        }
+
+        bool received(const uint64_t id, const size_t size) override
+        {
+            auto& connection = _connections[id];
+            connection.reader.commit(size);
+            if (connection.kind == connection_kind::undecided && connection.reader.pending_size() >= frame_header_size)
+            {
+                if (read_uint32(connection.reader.pending()) == session_magic)
+                {
+                    connection.kind = connection_kind::session;
+                    connection.reader.consume(frame_header_size);
+                }
+                else
+                {
+                    connection.kind = connection_kind::single_message;
+                }
+            }
+
+            if (connection.kind != connection_kind::session)
+            {
+                return true;
+            }
+
+            const bool valid = connection.reader.drain([this](const char* payload, const size_t payload_size) {
+                deliver(decode_utf16(payload, payload_size));
+            });
+
+            if (!valid)
+            {
+                std::unique_lock lock{ _mutex };
+                ++_statistics.malformed_connections;
+            }
+
+            return valid;
+        }
+
+        void listen_failed(const uint32_t error) override
+        {
+            {
+                std::unique_lock lock{ _mutex };
+                ++_statistics.listen_failures;
+            }
+
+            if (_options.on_error)
+            {
+                _options.on_error(L"Failed to listen for connections, error " + std::to_wstring(error) + L", trying again");
+            }
+        }
+
+        void closed(const uint64_t id) override
+        {
+            const auto found = _connections.find(id);
+            if (found == _connections.end())
+            {
+                return;
+            }
+
+            // A connection without the session header carried one message, complete once it's closed
+            auto& reader = found->second.reader;
+            if (found->second.kind != connection_kind::session && reader.pending_size() > 0)
+            {
+                {
+                    std::unique_lock lock{ _mutex };
+                    ++_statistics.single_message_connections;
+                }
+
+                deliver(decode_utf16(reader.pending(), reader.pending_size()));
+            }
+
+            _connections.erase(found);
+        }
+
+        transport& _transport;
+        message_callback _on_message;
+        options _options;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _queued_cv;
+        std::vector<std::wstring> _queued;
+        stream* _active_stream = nullptr;
+        bool _closed = false;
+        statistics _statistics;
+
+        // Only used on the I/O thread
+        std::unordered_map<uint64_t, connection> _connections;
+
+        std::thread _io_thread;
+        std::thread _send_thread;
+    };
+}
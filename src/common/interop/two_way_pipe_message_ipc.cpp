@@ -8,11 +8,15 @@ constexpr DWORD BUFSIZE = 1024;
 TwoWayPipeMessageIPC::TwoWayPipeMessageIPC(
     std::wstring _input_pipe_name,
     std::wstring _output_pipe_name,
-    callback_function p_func) :
+    callback_function p_func,
+    bool session,
+    callback_function on_error) :
     impl(new TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl(
         _input_pipe_name,
         _output_pipe_name,
-        p_func))
+        p_func,
+        session,
+        on_error))
 {
 }
 
@@ -39,20 +43,61 @@ void TwoWayPipeMessageIPC::end()
 TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl::TwoWayPipeMessageIPCImpl(
     std::wstring _input_pipe_name,
     std::wstring _output_pipe_name,
-    callback_function p_func)
+    callback_function p_func,
+    bool session_mode,
+    callback_function on_error)
 {
     input_pipe_name = _input_pipe_name;
     output_pipe_name = _output_pipe_name;
     dispatch_inc_message_function = p_func;
+    if (session_mode)
+    {
+        session_transport = std::make_unique<named_pipe_transport>(input_pipe_name, output_pipe_name, [this](HANDLE pipe) {
+            if (restricted_pipe_token != NULL)
+            {
+                change_pipe_security_allow_restricted_token(pipe, restricted_pipe_token);
+            }
+        });
+        pipe_session::options options;
+        if (on_error)
+        {
+            options.on_error = on_error;
+        }
+        else
+        {
+            // The interop library has no logger of its own
+            options.on_error = [](const std::wstring& error) {
+                OutputDebugStringW((L"TwoWayPipeMessageIPC: " + error + L"\n").c_str());
+            };
+        }
+        // The callback is still called on the input queue thread, the I/O thread only decodes the messages
+        session = std::make_unique<pipe_session::session>(*session_transport, [this](std::wstring message) {
+            input_queue.queue_message(std::move(message));
+        }, options);
+    }
 }
 
 void TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl::send(std::wstring msg)
 {
+    if (session)
+    {
+        session->send(std::move(msg));
+        return;
+    }
+
     output_queue.queue_message(msg);
 }
 
 void TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl::start(HANDLE _restricted_pipe_token)
 {
+    if (session)
+    {
+        restricted_pipe_token = _restricted_pipe_token;
+        session->start();
+        input_queue_thread = std::thread(&TwoWayPipeMessageIPCImpl::consume_input_queue_thread, this);
+        return;
+    }
+
     output_queue_thread = std::thread(&TwoWayPipeMessageIPCImpl::consume_output_queue_thread, this);
     input_queue_thread = std::thread(&TwoWayPipeMessageIPCImpl::consume_input_queue_thread, this);
     input_pipe_thread = std::thread(&TwoWayPipeMessageIPCImpl::start_named_pipe_server, this, _restricted_pipe_token);
@@ -63,6 +108,12 @@ void TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl::end()
     closed = true;
     input_queue.interrupt();
     input_queue_thread.join();
+    if (session)
+    {
+        session->end();
+        return;
+    }
+
     output_queue.interrupt();
     output_queue_thread.join();
     pipe_connect_handle_mutex.lock();
@@ -148,14 +199,17 @@ void TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl::send_pipe_message(std::wstr
 
 void TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl::consume_output_queue_thread()
 {
-    while (!closed)
+    std::vector<std::wstring> messages;
+    while (!closed && output_queue.pop_messages(messages))
     {
-        std::wstring message = output_queue.pop_message();
-        if (message.length() == 0)
+        for (const auto& message : messages)
         {
-            break;
+            if (message.length() > 0)
+            {
+                send_pipe_message(message);
+            }
         }
-        send_pipe_message(message);
+        messages.clear();
     }
 }
 
@@ -448,21 +502,25 @@ void TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl::start_named_pipe_server(HAN
 
 void TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl::consume_input_queue_thread()
 {
-    while (!closed)
+    std::vector<std::wstring> messages;
+    while (!closed && input_queue.pop_messages(messages))
     {
-        outgoing_message = L"";
-        std::wstring message = input_queue.pop_message();
-        if (message.length() == 0)
+        for (auto& message : messages)
         {
-            break;
-        }
+            outgoing_message = L"";
+            if (message.length() == 0)
+            {
+                continue;
+            }
 
-        // Check if callback method exists first before trying to call it.
-        // otherwise just store the response message in a variable.
-        if (dispatch_inc_message_function != nullptr)
-        {
-            dispatch_inc_message_function(message);
+            // Check if callback method exists first before trying to call it.
+            // otherwise just store the response message in a variable.
+            if (dispatch_inc_message_function != nullptr)
+            {
+                dispatch_inc_message_function(message);
+            }
+            outgoing_message = std::move(message);
         }
-        outgoing_message = message;
+        messages.clear();
     }
 }
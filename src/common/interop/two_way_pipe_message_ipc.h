@@ -3,10 +3,15 @@ class TwoWayPipeMessageIPC
 {
 public:
     typedef void (*callback_function)(const std::wstring&);
+    // In the session mode, messages go through one connection kept open to the peer, which has to use the session mode
+    // as well. The listening pipe takes messages from peers in either mode. on_error is called with the failures the
+    // session mode recovers from, which go to the debugger output without it.
     TwoWayPipeMessageIPC(
         std::wstring _input_pipe_name,
         std::wstring _output_pipe_name,
-        callback_function p_func);
+        callback_function p_func,
+        bool session = false,
+        callback_function on_error = nullptr);
     ~TwoWayPipeMessageIPC();
     void send(std::wstring msg);
     void start(HANDLE _restricted_pipe_token);
@@ -5,13 +5,15 @@
 #include <accctrl.h>
 #include <aclapi.h>
 #include <list>
+#include <memory>
 #include "two_way_pipe_message_ipc.h"
+#include "named_pipe_transport.h"
 
 class TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl
 {
 public:
     void send(std::wstring msg);
-    TwoWayPipeMessageIPCImpl(std::wstring _input_pipe_name, std::wstring _output_pipe_name, callback_function p_func);
+    TwoWayPipeMessageIPCImpl(std::wstring _input_pipe_name, std::wstring _output_pipe_name, callback_function p_func, bool session_mode, callback_function on_error);
     void start(HANDLE _restricted_pipe_token);
     void end();
 
@@ -28,6 +30,9 @@ private:
 
     HANDLE current_connect_pipe_handle = NULL;
     bool closed = false;
+    HANDLE restricted_pipe_token = NULL;
+    std::unique_ptr<named_pipe_transport> session_transport;
+    std::unique_ptr<pipe_session::session> session;
     TwoWayPipeMessageIPC::callback_function dispatch_inc_message_function;
 
     void send_pipe_message(std::wstring message);
@@ -0,0 +1,242 @@
+#pragma once
+#include <cerrno>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "pipe_session.h"
+
+// pipe_session::transport over Unix domain sockets, so the session mode of TwoWayPipeMessageIPC can be tested and
+// benchmarked on Linux. The pipe names are socket paths.
+class unix_socket_transport : public pipe_session::transport
+{
+public:
+    unix_socket_transport(std::string input_path, std::string output_path) :
+        _input_path{ std::move(input_path) }, _output_path{ std::move(output_path) }
+    {
+        if (pipe(_wake) != 0)
+        {
+            _wake[0] = _wake[1] = -1;
+        }
+    }
+
+    ~unix_socket_transport() override
+    {
+        for (const int fd : _wake)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+    }
+
+    std::unique_ptr<pipe_session::stream> connect() override
+    {
+        const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+
+        sockaddr_un address{};
+        if (!make_address(_output_path, address) || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        return std::make_unique<socket_stream>(fd);
+    }
+
+    void serve(pipe_session::connection_handler& handler) override
+    {
+        // The listener is polled as -1, i.e. skipped, while it can't be opened
+        std::vector<pollfd> fds{ { _wake[0], POLLIN, 0 }, { -1, POLLIN, 0 } };
+        std::vector<uint64_t> ids{ 0, 0 };
+        uint64_t next_id = 1;
+        auto backoff = pipe_session::min_listen_backoff;
+        while (true)
+        {
+            int timeout = -1;
+            if (fds[1].fd < 0)
+            {
+                int error = 0;
+                fds[1].fd = open_listener(error);
+                if (fds[1].fd >= 0)
+                {
+                    backoff = pipe_session::min_listen_backoff;
+                }
+                else
+                {
+                    handler.listen_failed(static_cast<uint32_t>(error));
+                    timeout = static_cast<int>(backoff.count());
+                    backoff = pipe_session::next_listen_backoff(backoff);
+                }
+            }
+
+            if (poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout) < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                break;
+            }
+
+            if (fds[0].revents != 0)
+            {
+                break;
+            }
+
+            if (fds[1].revents & POLLIN)
+            {
+                const int fd = accept4(fds[1].fd, nullptr, nullptr, SOCK_CLOEXEC);
+                if (fd >= 0)
+                {
+                    fds.push_back({ fd, POLLIN, 0 });
+                    ids.push_back(next_id);
+                    handler.connected(next_id++);
+                }
+            }
+
+            for (size_t i = 2; i < fds.size();)
+            {
+                bool open = true;
+                if (fds[i].revents != 0)
+                {
+                    size_t size = 0;
+                    char* buffer = handler.read_buffer(ids[i], size);
+                    const ssize_t read_size = read(fds[i].fd, buffer, size);
+                    open = read_size > 0 && handler.received(ids[i], static_cast<size_t>(read_size));
+                }
+
+                if (open)
+                {
+                    fds[i].revents = 0;
+                    ++i;
+                    continue;
+                }
+
+                handler.closed(ids[i]);
+                close(fds[i].fd);
+                fds.erase(fds.begin() + i);
+                ids.erase(ids.begin() + i);
+            }
+        }
+
+        for (size_t i = 2; i < fds.size(); ++i)
+        {
+            handler.closed(ids[i]);
+            close(fds[i].fd);
+        }
+
+        if (fds[1].fd >= 0)
+        {
+            close(fds[1].fd);
+            unlink(_input_path.c_str());
+        }
+    }
+
+    void stop() override
+    {
+        const char wake = 0;
+        [[maybe_unused]] const auto written = write(_wake[1], &wake, sizeof(wake));
+    }
+
+private:
+    class socket_stream : public pipe_session::stream
+    {
+    public:
+        explicit socket_stream(const int fd) :
+            _fd{ fd }
+        {
+        }
+
+        ~socket_stream() override
+        {
+            close(_fd);
+        }
+
+        bool write(const char* data, size_t size) override
+        {
+            while (size > 0)
+            {
+                const ssize_t written = send(_fd, data, size, MSG_NOSIGNAL);
+                if (written < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+
+                if (written <= 0)
+                {
+                    return false;
+                }
+
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+
+            return true;
+        }
+
+        void cancel() override
+        {
+            shutdown(_fd, SHUT_RDWR);
+        }
+
+    private:
+        int _fd;
+    };
+
+    // -1 with the errno if the socket can't be bound and listened on
+    int open_listener(int& error) const
+    {
+        sockaddr_un address{};
+        if (!make_address(_input_path, address))
+        {
+            error = ENAMETOOLONG;
+            return -1;
+        }
+
+        const int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listener < 0)
+        {
+            error = errno;
+            return -1;
+        }
+
+        unlink(_input_path.c_str());
+        if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+        {
+            error = errno;
+            close(listener);
+            return -1;
+        }
+
+        return listener;
+    }
+
+    static bool make_address(const std::string& path, sockaddr_un& address)
+    {
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            return false;
+        }
+
+        address.sun_family = AF_UNIX;
+        path.copy(address.sun_path, path.size());
+        return true;
+    }
+
+    std::string _input_path;
+    std::string _output_path;
+    // Written to by stop() to wake serve() up
+    int _wake[2] = { -1, -1 };
+};
@@ -0,0 +1,376 @@
+#pragma once
+#include <spdlog/spdlog.h>
+#include <spdlog/details/fmt_helper.h>
+#include <spdlog/sinks/sink.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// What happens to a message logged while the ring is full
+enum class LogOverflowPolicy
+{
+    // The caller waits until the writer thread took the ring
+    Block,
+    // The oldest message in the ring is overwritten
+    DropOldest,
+    // The new message is dropped
+    Drop,
+};
+
+struct AsyncLogOptions
+{
+    // Messages the ring holds before the overflow policy applies
+    size_t capacity = 512;
+    LogOverflowPolicy overflowPolicy = LogOverflowPolicy::Block;
+    // Longest time a message waits to be written and flushed
+    std::chrono::milliseconds flushInterval{ 1000 };
+    // The sinks are flushed as soon as this many bytes were written since the last flush
+    size_t flushBytes = 64 * 1024;
+};
+
+// Sink which only copies the formatted message into a preallocated ring on the caller's thread. A writer thread takes
+// the whole ring at once, by swapping it with a second one of the same size, and hands the messages to the wrapped
+// sinks, which apply the pattern and write the file. The sinks are flushed when flushInterval passed or flushBytes were
+// written since the last flush. flush() blocks until everything logged before it is written and flushed, so the logger
+// flushing on errors makes the caller wait for them to be on disk, while any other message costs it a copy under a short
+// lock. Messages dropped by the overflow policy are counted and reported in the log by the writer thread.
+class AsyncRingSink : public spdlog::sinks::sink
+{
+private:
+    struct entry
+    {
+        spdlog::level::level_enum level = spdlog::level::off;
+        spdlog::log_clock::time_point time;
+        size_t thread_id = 0;
+        spdlog::source_loc source;
+        std::string logger_name;
+        spdlog::memory_buf_t payload;
+    };
+
+    std::vector<spdlog::sink_ptr> sinks;
+    const AsyncLogOptions options;
+
+    std::mutex mutex;
+    std::condition_variable writer_wake;
+    std::condition_variable space_available;
+    std::condition_variable flushed;
+    // The ring callers log into, and the one the writer thread writes out
+    std::vector<entry> rings[2];
+    size_t active = 0;
+    size_t head = 0;
+    size_t count = 0;
+    size_t queued_bytes = 0;
+    size_t blocked_callers = 0;
+    bool writer_signalled = false;
+    bool writer_idle = false;
+    bool stopping = false;
+    bool stopped = false;
+    uint64_t flush_requests = 0;
+    uint64_t flushes_done = 0;
+    uint64_t dropped = 0;
+    uint64_t total_dropped = 0;
+
+    std::thread writer;
+
+    void write(const entry& e)
+    {
+        spdlog::details::log_msg msg{ e.time,
+                                      e.source,
+                                      spdlog::string_view_t{ e.logger_name },
+                                      e.level,
+                                      spdlog::string_view_t{ e.payload.data(), e.payload.size() } };
+        msg.thread_id = e.thread_id;
+        for (const auto& sink : sinks)
+        {
+            if (sink->should_log(msg.level))
+            {
+                try
+                {
+                    sink->log(msg);
+                }
+                catch (...)
+                {
+                    // There is nowhere left to report a failing sink
+                }
+            }
+        }
+    }
+
+    void write_dropped(const uint64_t count_dropped, const std::string& logger_name)
+    {
+        entry notice;
+        notice.level = spdlog::level::warn;
+        notice.time = spdlog::log_clock::now();
+        notice.logger_name = logger_name;
+        spdlog::details::fmt_helper::append_string_view(std::to_string(count_dropped), notice.payload);
+        spdlog::details::fmt_helper::append_string_view(" log messages were dropped, the log ring was full", notice.payload);
+        write(notice);
+    }
+
+    void flush_sinks()
+    {
+        for (const auto& sink : sinks)
+        {
+            try
+            {
+                sink->flush();
+            }
+            catch (...)
+            {
+            }
+        }
+    }
+
+    void run()
+    {
+        size_t unflushed_bytes = 0;
+        auto deadline = std::chrono::steady_clock::now() + options.flushInterval;
+        std::string logger_name;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            // Nothing to write or flush: sleep until something is logged, which then waits at most one flush interval
+            if (count == 0 && unflushed_bytes == 0)
+            {
+                writer_idle = true;
+                writer_wake.wait(lock, [this] { return writer_signalled || stopping || count > 0; });
+                writer_idle = false;
+                deadline = std::chrono::steady_clock::now() + options.flushInterval;
+            }
+
+            writer_wake.wait_until(lock, deadline, [this] { return writer_signalled || stopping; });
+
+            writer_signalled = false;
+            std::vector<entry>& ring = rings[active];
+            const size_t ring_head = head;
+            const size_t ring_count = count;
+            const uint64_t ring_dropped = dropped;
+            const uint64_t flush_ticket = flush_requests;
+            const bool stop = stopping;
+            active ^= 1;
+            head = 0;
+            count = 0;
+            queued_bytes = 0;
+            dropped = 0;
+            if (blocked_callers > 0)
+            {
+                space_available.notify_all();
+            }
+
+            lock.unlock();
+            for (size_t i = 0; i < ring_count; ++i)
+            {
+                const entry& e = ring[(ring_head + i) % ring.size()];
+                write(e);
+                unflushed_bytes += e.payload.size();
+            }
+
+            if (ring_count > 0)
+            {
+                logger_name = ring[(ring_head + ring_count - 1) % ring.size()].logger_name;
+            }
+
+            if (ring_dropped > 0)
+            {
+                write_dropped(ring_dropped, logger_name);
+            }
+
+            // Messages written because the ring was half full wait for the flush of the interval they were logged in
+            const auto now = std::chrono::steady_clock::now();
+            if (flush_ticket > flushes_done || stop || unflushed_bytes >= options.flushBytes || now >= deadline)
+            {
+                if (unflushed_bytes > 0)
+                {
+                    flush_sinks();
+                    unflushed_bytes = 0;
+                }
+
+                deadline = now + options.flushInterval;
+            }
+
+            lock.lock();
+            if (flush_ticket > flushes_done)
+            {
+                flushes_done = flush_ticket;
+                flushed.notify_all();
+            }
+
+            if (stop && count == 0)
+            {
+                stopped = true;
+                flushed.notify_all();
+                return;
+            }
+        }
+    }
+
+public:
+    AsyncRingSink(std::vector<spdlog::sink_ptr> wrapped_sinks, const AsyncLogOptions& async_options = {}) :
+        sinks{ std::move(wrapped_sinks) }, options{ async_options }
+    {
+        const size_t capacity = options.capacity > 0 ? options.capacity : 1;
+        rings[0].resize(capacity);
+        rings[1].resize(capacity);
+        writer = std::thread{ [this] { run(); } };
+    }
+
+    AsyncRingSink(const AsyncRingSink&) = delete;
+    AsyncRingSink& operator=(const AsyncRingSink&) = delete;
+
+    // Only threads ended by ExitProcess are gone while the destructors of statics run
+    bool writer_running()
+    {
+#ifdef _WIN32
+        return WaitForSingleObject(writer.native_handle(), 0) == WAIT_TIMEOUT;
+#else
+        return true;
+#endif
+    }
+
+    // Writes and flushes what is still in the ring. The writer thread is waited for, then detached rather than joined,
+    // as the logger of a module is destroyed while its DLL is unloaded, under the loader lock the exiting thread needs.
+    // Destroyed on process exit, the writer thread has been terminated already, so it's not waited for and the ring is
+    // written here instead.
+    ~AsyncRingSink() override
+    {
+        if (writer_running())
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                stopping = true;
+                writer_wake.notify_one();
+                flushed.wait(lock, [this] { return stopped; });
+            }
+            writer.detach();
+            return;
+        }
+
+        writer.detach();
+
+        // The writer may have been terminated while it held the lock, the ring can't be read then
+        std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+        if (!lock.owns_lock())
+        {
+            return;
+        }
+
+        const std::vector<entry>& ring = rings[active];
+        for (size_t i = 0; i < count; ++i)
+        {
+            write(ring[(head + i) % ring.size()]);
+        }
+
+        if (dropped > 0)
+        {
+            write_dropped(dropped, count > 0 ? ring[(head + count - 1) % ring.size()].logger_name : std::string{});
+        }
+
+        flush_sinks();
+    }
+
+    void log(const spdlog::details::log_msg& msg) override
+    {
+        bool wake = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            std::vector<entry>& ring = rings[active];
+            if (count == ring.size())
+            {
+                switch (options.overflowPolicy)
+                {
+                case LogOverflowPolicy::Block:
+                    blocked_callers++;
+                    writer_signalled = true;
+                    writer_wake.notify_one();
+                    space_available.wait(lock, [this] { return count < rings[active].size(); });
+                    blocked_callers--;
+                    break;
+                case LogOverflowPolicy::DropOldest:
+                    queued_bytes -= ring[head].payload.size();
+                    head = (head + 1) % ring.size();
+                    count--;
+                    dropped++;
+                    total_dropped++;
+                    break;
+                case LogOverflowPolicy::Drop:
+                    dropped++;
+                    total_dropped++;
+                    return;
+                }
+            }
+
+            std::vector<entry>& target = rings[active];
+            entry& e = target[(head + count) % target.size()];
+            e.level = msg.level;
+            e.time = msg.time;
+            e.thread_id = msg.thread_id;
+            e.source = msg.source;
+            e.logger_name.assign(msg.logger_name.data(), msg.logger_name.size());
+            e.payload.clear();
+            spdlog::details::fmt_helper::append_string_view(msg.payload, e.payload);
+            count++;
+            queued_bytes += e.payload.size();
+
+            // The writer thread is only woken for the first message after it went idle, which starts its flush interval,
+            // and to take the ring before it fills up. Otherwise it wakes up on its own once the interval is over.
+            if (writer_idle)
+            {
+                writer_idle = false;
+                wake = true;
+            }
+            else if (!writer_signalled && (count >= target.size() / 2 || queued_bytes >= options.flushBytes))
+            {
+                writer_signalled = true;
+                wake = true;
+            }
+        }
+
+        if (wake)
+        {
+            writer_wake.notify_one();
+        }
+    }
+
+    // Blocks until everything logged before is written and the sinks are flushed
+    void flush() override
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        const uint64_t ticket = ++flush_requests;
+        writer_signalled = true;
+        writer_wake.notify_one();
+        flushed.wait(lock, [this, ticket] { return flushes_done >= ticket; });
+    }
+
+    void set_pattern(const std::string& pattern) override
+    {
+        for (const auto& sink : sinks)
+        {
+            sink->set_pattern(pattern);
+        }
+    }
+
+    void set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) override
+    {
+        for (const auto& sink : sinks)
+        {
+            sink->set_formatter(sink_formatter->clone());
+        }
+    }
+
+    // Messages dropped by the overflow policy since the sink was created
+    uint64_t dropped_messages()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return total_dropped;
+    }
+};
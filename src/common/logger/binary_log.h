@@ -0,0 +1,560 @@
+#pragma once
+#include <spdlog/common.h>
+#include <spdlog/details/file_helper.h>
+#include <spdlog/details/os.h>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/fmt/xchar.h>
+#include <spdlog/sinks/daily_file_sink.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+// Binary log format. Instead of a line of text, a call writes the id of its format string, its level, time and thread,
+// and its arguments as they were passed. The format string itself is written once per file, the first time it is used,
+// along with the types of the arguments, so a file can be turned back into the text log on its own (see
+// binary_log_decoder.h).
+//
+// A file starts with the magic, the version, the process id and the time, in microseconds since the epoch, which the
+// first event's time is relative to. Every record then starts with a byte holding its kind in the high nibble and the
+// level in the low nibble:
+//   format: id, argument count, one type byte per argument, length and UTF-8 text of the format string
+//   event:  format id, microseconds since the previous event (zigzag, as threads may write out of order), thread id,
+//           the arguments
+// Every integer is a LEB128 varint. Strings are a length and their UTF-8 bytes or UTF-16 code units.
+namespace binary_log
+{
+    inline constexpr char magic[] = { 'P', 'T', 'B', 'L', 'O', 'G' };
+    inline constexpr uint8_t version = 1;
+
+    enum class record : uint8_t
+    {
+        format = 1,
+        event = 2,
+    };
+
+    enum class arg_type : uint8_t
+    {
+        int64 = 1,
+        uint64,
+        float32,
+        float64,
+        boolean,
+        character,
+        utf8,
+        utf16,
+        pointer,
+    };
+
+    inline void put_varint(spdlog::memory_buf_t& buffer, uint64_t value)
+    {
+        char bytes[10];
+        size_t size = 0;
+        while (value >= 0x80)
+        {
+            bytes[size++] = static_cast<char>((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        bytes[size++] = static_cast<char>(value);
+        buffer.append(bytes, bytes + size);
+    }
+
+    inline uint64_t zigzag(const int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    inline int64_t unzigzag(const uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    inline void append_utf8(std::string& text, const uint32_t code_point)
+    {
+        if (code_point < 0x80)
+        {
+            text += static_cast<char>(code_point);
+        }
+        else if (code_point < 0x800)
+        {
+            text += static_cast<char>(0xc0 | (code_point >> 6));
+            text += static_cast<char>(0x80 | (code_point & 0x3f));
+        }
+        else if (code_point < 0x10000)
+        {
+            text += static_cast<char>(0xe0 | (code_point >> 12));
+            text += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+            text += static_cast<char>(0x80 | (code_point & 0x3f));
+        }
+        else
+        {
+            text += static_cast<char>(0xf0 | (code_point >> 18));
+            text += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+            text += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+            text += static_cast<char>(0x80 | (code_point & 0x3f));
+        }
+    }
+
+    // UTF-16 or UTF-32 to UTF-8, unpaired surrogates become U+FFFD
+    template<typename Char>
+    std::string to_utf8(const Char* text, const size_t length)
+    {
+        std::string result;
+        result.reserve(length);
+        for (size_t i = 0; i < length; ++i)
+        {
+            uint32_t unit = static_cast<uint32_t>(text[i]);
+            if constexpr (sizeof(Char) == 2)
+            {
+                if (unit >= 0xd800 && unit < 0xdc00 && i + 1 < length && text[i + 1] >= 0xdc00 && text[i + 1] < 0xe000)
+                {
+                    unit = 0x10000 + ((unit - 0xd800) << 10) + (static_cast<uint32_t>(text[++i]) - 0xdc00);
+                }
+                else if (unit >= 0xd800 && unit < 0xe000)
+                {
+                    unit = 0xfffd;
+                }
+            }
+
+            append_utf8(result, unit);
+        }
+
+        return result;
+    }
+
+    // Wide strings are written as UTF-16, whatever the size of wchar_t
+    template<typename Char>
+    void put_utf16(spdlog::memory_buf_t& buffer, const Char* text, const size_t length)
+    {
+        if constexpr (sizeof(Char) == 2)
+        {
+            put_varint(buffer, length);
+            const auto bytes = reinterpret_cast<const char*>(text);
+            buffer.append(bytes, bytes + length * 2);
+        }
+        else
+        {
+            std::u16string units;
+            units.reserve(length);
+            for (size_t i = 0; i < length; ++i)
+            {
+                const auto code_point = static_cast<uint32_t>(text[i]);
+                if (code_point >= 0x10000)
+                {
+                    units += static_cast<char16_t>(0xd800 + ((code_point - 0x10000) >> 10));
+                    units += static_cast<char16_t>(0xdc00 + ((code_point - 0x10000) & 0x3ff));
+                }
+                else
+                {
+                    units += static_cast<char16_t>(code_point);
+                }
+            }
+
+            put_utf16(buffer, units.data(), units.size());
+        }
+    }
+
+    template<typename T>
+    inline constexpr bool is_char_v = std::is_same_v<T, char> || std::is_same_v<T, wchar_t> || std::is_same_v<T, char16_t> ||
+                                      std::is_same_v<T, char32_t>;
+
+    template<typename T, typename Char>
+    inline constexpr bool is_string_of_v = std::is_same_v<T, const Char*> || std::is_same_v<T, Char*> ||
+                                           std::is_same_v<T, std::basic_string<Char>> ||
+                                           std::is_same_v<T, std::basic_string_view<Char>> ||
+                                           std::is_same_v<T, fmt::basic_string_view<Char>>;
+
+    // How an argument of type T is written when the format string is made of Char. Types the format doesn't know are
+    // formatted at the call and written as a string.
+    template<typename Char, typename T>
+    constexpr arg_type type_of()
+    {
+        using U = std::decay_t<T>;
+        if constexpr (std::is_same_v<U, bool>)
+        {
+            return arg_type::boolean;
+        }
+        else if constexpr (is_char_v<U>)
+        {
+            return arg_type::character;
+        }
+        else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>)
+        {
+            return arg_type::int64;
+        }
+        else if constexpr (std::is_integral_v<U>)
+        {
+            return arg_type::uint64;
+        }
+        else if constexpr (std::is_same_v<U, float>)
+        {
+            return arg_type::float32;
+        }
+        else if constexpr (std::is_floating_point_v<U>)
+        {
+            return arg_type::float64;
+        }
+        else if constexpr (is_string_of_v<U, char>)
+        {
+            return arg_type::utf8;
+        }
+        else if constexpr (is_string_of_v<U, wchar_t> || is_string_of_v<U, char16_t>)
+        {
+            return arg_type::utf16;
+        }
+        else if constexpr (std::is_same_v<U, std::nullptr_t> || std::is_same_v<U, void*> || std::is_same_v<U, const void*>)
+        {
+            return arg_type::pointer;
+        }
+        else
+        {
+            return sizeof(Char) == 1 ? arg_type::utf8 : arg_type::utf16;
+        }
+    }
+
+    // The types of a call's arguments. The address of the array tells calls with the same format string apart, in case
+    // the linker merged identical literals of calls with different arguments.
+    template<typename Char, typename... Args>
+    struct signature
+    {
+        static constexpr arg_type types[sizeof...(Args) + 1] = { type_of<Char, Args>()..., arg_type{} };
+    };
+
+    template<typename Char, typename T>
+    void put_arg(spdlog::memory_buf_t& buffer, const T& value)
+    {
+        using U = std::decay_t<T>;
+        constexpr arg_type type = type_of<Char, T>();
+        if constexpr (type == arg_type::boolean)
+        {
+            buffer.push_back(value ? 1 : 0);
+        }
+        else if constexpr (type == arg_type::character)
+        {
+            put_varint(buffer, static_cast<uint64_t>(static_cast<std::make_unsigned_t<U>>(value)));
+        }
+        else if constexpr (type == arg_type::int64)
+        {
+            put_varint(buffer, zigzag(static_cast<int64_t>(value)));
+        }
+        else if constexpr (type == arg_type::uint64)
+        {
+            put_varint(buffer, static_cast<uint64_t>(value));
+        }
+        else if constexpr (type == arg_type::float32 || type == arg_type::float64)
+        {
+            using Float = std::conditional_t<type == arg_type::float32, float, double>;
+            const Float number = static_cast<Float>(value);
+            char bytes[sizeof(Float)];
+            std::memcpy(bytes, &number, sizeof(Float));
+            buffer.append(bytes, bytes + sizeof(Float));
+        }
+        else if constexpr (type == arg_type::pointer)
+        {
+            put_varint(buffer, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(static_cast<const void*>(value))));
+        }
+        else if constexpr (is_string_of_v<U, char>)
+        {
+            const std::basic_string_view<char> text{ value };
+            put_varint(buffer, text.size());
+            buffer.append(text.data(), text.data() + text.size());
+        }
+        else if constexpr (is_string_of_v<U, wchar_t> || is_string_of_v<U, char16_t>)
+        {
+            using Wide = std::conditional_t<is_string_of_v<U, wchar_t>, wchar_t, char16_t>;
+            const std::basic_string_view<Wide> text{ value };
+            put_utf16(buffer, text.data(), text.size());
+        }
+        else if constexpr (sizeof(Char) == 1)
+        {
+            put_arg<Char>(buffer, fmt::format("{}", value));
+        }
+        else
+        {
+            put_arg<Char>(buffer, fmt::format(L"{}", value));
+        }
+    }
+
+    template<typename S>
+    struct format_char
+    {
+        using type = typename S::value_type;
+    };
+
+    template<typename Char>
+    struct format_char<Char*>
+    {
+        using type = std::remove_const_t<Char>;
+    };
+
+    // A format string whose address is the id of its call. The constructor is consteval and reads the array, so only
+    // literals and constexpr arrays convert: a buffer written again would keep the format its address had first.
+    template<typename Char>
+    class literal
+    {
+    public:
+        template<size_t N>
+        consteval literal(const Char (&format)[N]) :
+            text{ format }
+        {
+            if (format[N - 1] != Char{})
+            {
+                throw "format strings must be null terminated";
+            }
+        }
+
+        constexpr const Char* data() const noexcept
+        {
+            return text;
+        }
+
+    private:
+        const Char* text;
+    };
+}
+
+// Writes the binary log of a process to a daily file, named as the daily text log is. Calls encode their arguments on
+// their own thread, the lock is only taken to append the record to the file buffer, which is flushed on errors, once a
+// second has passed since the last flush, and by flush().
+class BinaryLogWriter
+{
+private:
+    struct format_key
+    {
+        const void* format;
+        const binary_log::arg_type* types;
+
+        bool operator==(const format_key& other) const
+        {
+            return format == other.format && types == other.types;
+        }
+    };
+
+    struct format_key_hash
+    {
+        size_t operator()(const format_key& key) const
+        {
+            return std::hash<const void*>{}(key.format) ^ (std::hash<const void*>{}(key.types) << 1);
+        }
+    };
+
+    const spdlog::filename_t base_filename;
+    const size_t max_files;
+    std::atomic<int> level = spdlog::level::trace;
+    std::atomic<int> flush_level = spdlog::level::err;
+
+    std::mutex mutex;
+    spdlog::details::file_helper file;
+    std::deque<spdlog::filename_t> filenames;
+    std::chrono::system_clock::time_point rotation_time;
+    std::chrono::system_clock::time_point last_flush;
+    int64_t last_time = 0;
+    // Ids of the formats written to the current file
+    std::unordered_map<format_key, uint32_t, format_key_hash> formats;
+    spdlog::memory_buf_t record;
+
+    static int64_t microseconds(const std::chrono::system_clock::time_point time)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    }
+
+    static std::chrono::system_clock::time_point next_midnight(const std::chrono::system_clock::time_point time)
+    {
+        auto date = spdlog::details::os::localtime(std::chrono::system_clock::to_time_t(time));
+        date.tm_hour = 0;
+        date.tm_min = 0;
+        date.tm_sec = 0;
+        return std::chrono::system_clock::from_time_t(std::mktime(&date)) + std::chrono::hours(24);
+    }
+
+    void open(const std::chrono::system_clock::time_point time)
+    {
+        const auto filename = spdlog::sinks::daily_filename_calculator::calc_filename(
+            base_filename, spdlog::details::os::localtime(std::chrono::system_clock::to_time_t(time)));
+        file.close();
+        file.open(filename, true);
+        filenames.push_back(filename);
+        while (max_files > 0 && filenames.size() > max_files)
+        {
+            spdlog::details::os::remove_if_exists(filenames.front());
+            filenames.pop_front();
+        }
+
+        rotation_time = next_midnight(time);
+        last_time = microseconds(time);
+        formats.clear();
+
+        record.clear();
+        record.append(std::begin(binary_log::magic), std::end(binary_log::magic));
+        record.push_back(static_cast<char>(binary_log::version));
+        binary_log::put_varint(record, static_cast<uint64_t>(spdlog::details::os::pid()));
+        binary_log::put_varint(record, static_cast<uint64_t>(last_time));
+        file.write(record);
+    }
+
+    template<typename Char>
+    void write(const spdlog::level::level_enum event_level,
+               const Char* format,
+               const binary_log::arg_type* types,
+               const size_t count,
+               const spdlog::memory_buf_t& arguments)
+    {
+        const auto now = spdlog::log_clock::now();
+        const auto thread = spdlog::details::os::thread_id();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        try
+        {
+            if (now >= rotation_time)
+            {
+                open(now);
+            }
+
+            record.clear();
+            const auto [entry, added] = formats.try_emplace(format_key{ format, types }, static_cast<uint32_t>(formats.size()));
+            if (added)
+            {
+                const auto text = std::basic_string_view<Char>{ format };
+                record.push_back(static_cast<char>(static_cast<uint8_t>(binary_log::record::format) << 4));
+                binary_log::put_varint(record, entry->second);
+                binary_log::put_varint(record, count);
+                record.append(reinterpret_cast<const char*>(types), reinterpret_cast<const char*>(types + count));
+                if constexpr (sizeof(Char) == 1)
+                {
+                    binary_log::put_varint(record, text.size());
+                    record.append(text.data(), text.data() + text.size());
+                }
+                else
+                {
+                    const auto utf8 = binary_log::to_utf8(text.data(), text.size());
+                    binary_log::put_varint(record, utf8.size());
+                    record.append(utf8.data(), utf8.data() + utf8.size());
+                }
+            }
+
+            const int64_t time = microseconds(now);
+            record.push_back(static_cast<char>((static_cast<uint8_t>(binary_log::record::event) << 4) | event_level));
+            binary_log::put_varint(record, entry->second);
+            binary_log::put_varint(record, binary_log::zigzag(time - last_time));
+            binary_log::put_varint(record, thread);
+            record.append(arguments.data(), arguments.data() + arguments.size());
+            last_time = time;
+            file.write(record);
+
+            if (event_level >= flush_level.load(std::memory_order_relaxed) || now - last_flush >= std::chrono::seconds(1))
+            {
+                file.flush();
+                last_flush = now;
+            }
+        }
+        catch (...)
+        {
+            // As spdlog does, a failing write doesn't reach the caller
+        }
+    }
+
+    template<typename Char, typename... Args>
+    void log_literal(const spdlog::level::level_enum log_level, const binary_log::literal<Char> format, const Args&... args)
+    {
+        if (!should_log(log_level))
+        {
+            return;
+        }
+
+        spdlog::memory_buf_t arguments;
+        (binary_log::put_arg<Char>(arguments, args), ...);
+        write(log_level, format.data(), binary_log::signature<Char, Args...>::types, sizeof...(Args), arguments);
+    }
+
+public:
+    // The date is added to the file name as the daily text log does, max_files of 0 keeps every file
+    explicit BinaryLogWriter(spdlog::filename_t filename, const size_t max_files = 0) :
+        base_filename{ std::move(filename) }, max_files{ max_files }
+    {
+    }
+
+    BinaryLogWriter(const BinaryLogWriter&) = delete;
+    BinaryLogWriter& operator=(const BinaryLogWriter&) = delete;
+
+    void set_level(const spdlog::level::level_enum log_level)
+    {
+        level.store(log_level, std::memory_order_relaxed);
+    }
+
+    bool should_log(const spdlog::level::level_enum log_level) const
+    {
+        return log_level >= level.load(std::memory_order_relaxed);
+    }
+
+    void flush_on(const spdlog::level::level_enum log_level)
+    {
+        flush_level.store(log_level, std::memory_order_relaxed);
+    }
+
+    // Format strings which are literals: their address is the id of the call
+    template<typename... Args>
+    void log(const spdlog::level::level_enum log_level, const binary_log::literal<char> format, const Args&... args)
+    {
+        log_literal(log_level, format, args...);
+    }
+
+    template<typename... Args>
+    void log(const spdlog::level::level_enum log_level, const binary_log::literal<wchar_t> format, const Args&... args)
+    {
+        log_literal(log_level, format, args...);
+    }
+
+    // Format strings built at runtime have no address to tell the calls apart, so the message is formatted and written
+    // as the argument of "{}". Arrays must be literals, the others don't compile.
+    template<typename FormatString, typename... Args>
+        requires(!std::is_array_v<FormatString>)
+    void log(const spdlog::level::level_enum log_level, const FormatString& format, const Args&... args)
+    {
+        if (!should_log(log_level))
+        {
+            return;
+        }
+
+        using Char = typename binary_log::format_char<FormatString>::type;
+        const fmt::basic_string_view<Char> text{ format };
+        std::basic_string<Char> message;
+        try
+        {
+            message = fmt::vformat(text, fmt::make_format_args<fmt::buffer_context<Char>>(args...));
+        }
+        catch (const fmt::format_error&)
+        {
+            message.assign(text.data(), text.size());
+        }
+
+        if constexpr (sizeof(Char) == 1)
+        {
+            log(log_level, "{}", message);
+        }
+        else
+        {
+            log(log_level, L"{}", message);
+        }
+    }
+
+    void flush()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        try
+        {
+            file.flush();
+        }
+        catch (...)
+        {
+        }
+        last_flush = spdlog::log_clock::now();
+    }
+};
@@ -0,0 +1,339 @@
+#pragma once
+#include "binary_log.h"
+
+#ifdef SPDLOG_FMT_EXTERNAL
+#include <fmt/args.h>
+#else
+#include <spdlog/fmt/bundled/args.h>
+#endif
+
+#include <iterator>
+#include <vector>
+
+// Turns a binary log (see binary_log.h) back into the text the text log would have had for the same calls
+namespace binary_log
+{
+    struct event
+    {
+        spdlog::level::level_enum level = spdlog::level::off;
+        std::chrono::system_clock::time_point time;
+        uint64_t process_id = 0;
+        uint64_t thread_id = 0;
+        std::string message;
+    };
+
+    struct decode_result
+    {
+        uint64_t process_id = 0;
+        uint64_t events = 0;
+        uint64_t formats = 0;
+        // False when the data doesn't end with a whole record, as when the process stopped in the middle of a write
+        bool complete = false;
+        // Why the decoding stopped early, empty if it didn't
+        std::string error;
+    };
+
+    class reader
+    {
+    public:
+        explicit reader(const std::string_view data) :
+            data{ data }
+        {
+        }
+
+        bool at_end() const
+        {
+            return position == data.size();
+        }
+
+        bool byte(uint8_t& value)
+        {
+            if (position >= data.size())
+            {
+                return false;
+            }
+
+            value = static_cast<uint8_t>(data[position++]);
+            return true;
+        }
+
+        bool varint(uint64_t& value)
+        {
+            value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                uint8_t next;
+                if (!byte(next))
+                {
+                    return false;
+                }
+
+                value |= static_cast<uint64_t>(next & 0x7f) << shift;
+                if ((next & 0x80) == 0)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        bool bytes(const size_t count, std::string_view& value)
+        {
+            if (data.size() - position < count)
+            {
+                // Not enough data left, which only a cut file has
+                position = data.size();
+                return false;
+            }
+
+            value = data.substr(position, count);
+            position += count;
+            return true;
+        }
+
+    private:
+        std::string_view data;
+        size_t position = 0;
+    };
+
+    // Adds the next argument of the given type to the arguments of the format string
+    inline bool read_arg(reader& in, const arg_type type, fmt::dynamic_format_arg_store<fmt::format_context>& arguments)
+    {
+        uint64_t value = 0;
+        std::string_view raw;
+        switch (type)
+        {
+        case arg_type::int64:
+            if (!in.varint(value))
+            {
+                return false;
+            }
+            arguments.push_back(unzigzag(value));
+            return true;
+        case arg_type::uint64:
+            if (!in.varint(value))
+            {
+                return false;
+            }
+            arguments.push_back(value);
+            return true;
+        case arg_type::float32:
+        case arg_type::float64:
+            if (!in.bytes(type == arg_type::float32 ? sizeof(float) : sizeof(double), raw))
+            {
+                return false;
+            }
+            if (type == arg_type::float32)
+            {
+                float number;
+                std::memcpy(&number, raw.data(), sizeof(number));
+                arguments.push_back(number);
+            }
+            else
+            {
+                double number;
+                std::memcpy(&number, raw.data(), sizeof(number));
+                arguments.push_back(number);
+            }
+            return true;
+        case arg_type::boolean:
+            if (!in.bytes(1, raw))
+            {
+                return false;
+            }
+            arguments.push_back(raw[0] != 0);
+            return true;
+        case arg_type::character:
+            if (!in.varint(value))
+            {
+                return false;
+            }
+            if (value < 0x80)
+            {
+                arguments.push_back(static_cast<char>(value));
+            }
+            else
+            {
+                std::string character;
+                append_utf8(character, static_cast<uint32_t>(value));
+                arguments.push_back(character);
+            }
+            return true;
+        case arg_type::utf8:
+            if (!in.varint(value) || !in.bytes(static_cast<size_t>(value), raw))
+            {
+                return false;
+            }
+            arguments.push_back(std::string{ raw });
+            return true;
+        case arg_type::utf16:
+        {
+            if (!in.varint(value) || value > SIZE_MAX / 2 || !in.bytes(static_cast<size_t>(value) * 2, raw))
+            {
+                return false;
+            }
+            std::u16string units(static_cast<size_t>(value), u'\0');
+            std::memcpy(units.data(), raw.data(), raw.size());
+            arguments.push_back(to_utf8(units.data(), units.size()));
+            return true;
+        }
+        case arg_type::pointer:
+            if (!in.varint(value))
+            {
+                return false;
+            }
+            arguments.push_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(value)));
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Calls on_event(const event&) for every event, in the order they were written
+    template<typename OnEvent>
+    decode_result decode(const std::string_view data, OnEvent&& on_event)
+    {
+        struct format
+        {
+            std::string text;
+            std::vector<arg_type> types;
+        };
+
+        decode_result result;
+        reader in{ data };
+        std::string_view header;
+        uint64_t base_time = 0;
+        if (data.size() < sizeof(magic) && std::string_view{ magic, sizeof(magic) }.substr(0, data.size()) == data)
+        {
+            return result;
+        }
+
+        if (!in.bytes(sizeof(magic), header) || header != std::string_view{ magic, sizeof(magic) })
+        {
+            result.error = "not a binary log";
+            return result;
+        }
+
+        uint8_t file_version = 0;
+        if (!in.byte(file_version) || !in.varint(result.process_id) || !in.varint(base_time))
+        {
+            return result;
+        }
+
+        if (file_version != version)
+        {
+            result.error = "unsupported version " + std::to_string(file_version);
+            return result;
+        }
+
+        std::vector<format> formats;
+        fmt::dynamic_format_arg_store<fmt::format_context> arguments;
+        event current;
+        current.process_id = result.process_id;
+        int64_t time = static_cast<int64_t>(base_time);
+        while (!in.at_end())
+        {
+            uint8_t kind = 0;
+            uint64_t id = 0;
+            in.byte(kind);
+            if (!in.varint(id))
+            {
+                return result;
+            }
+
+            if (static_cast<record>(kind >> 4) == record::format)
+            {
+                uint64_t count = 0;
+                uint64_t length = 0;
+                std::string_view types;
+                std::string_view text;
+                if (!in.varint(count) || !in.bytes(static_cast<size_t>(count), types) || !in.varint(length) ||
+                    !in.bytes(static_cast<size_t>(length), text))
+                {
+                    return result;
+                }
+
+                if (id != formats.size())
+                {
+                    result.error = "format " + std::to_string(id) + " out of order";
+                    return result;
+                }
+
+                formats.push_back(format{ std::string{ text }, std::vector<arg_type>(reinterpret_cast<const arg_type*>(types.data()), reinterpret_cast<const arg_type*>(types.data() + types.size())) });
+                result.formats++;
+                continue;
+            }
+
+            if (static_cast<record>(kind >> 4) != record::event)
+            {
+                result.error = "unknown record " + std::to_string(kind >> 4);
+                return result;
+            }
+
+            if (id >= formats.size())
+            {
+                result.error = "unknown format " + std::to_string(id);
+                return result;
+            }
+
+            uint64_t delta = 0;
+            if (!in.varint(delta) || !in.varint(current.thread_id))
+            {
+                return result;
+            }
+
+            arguments.clear();
+            const auto& used = formats[static_cast<size_t>(id)];
+            for (const auto type : used.types)
+            {
+                if (!read_arg(in, type, arguments))
+                {
+                    if (!in.at_end())
+                    {
+                        result.error = "bad argument in an event of format " + std::to_string(id);
+                    }
+                    return result;
+                }
+            }
+
+            time += unzigzag(delta);
+            current.level = static_cast<spdlog::level::level_enum>(kind & 0x0f);
+            current.time = std::chrono::system_clock::time_point{ std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::microseconds{ time }) };
+            try
+            {
+                current.message = fmt::vformat(used.text, arguments);
+            }
+            catch (const fmt::format_error&)
+            {
+                current.message = used.text;
+            }
+
+            on_event(static_cast<const event&>(current));
+            result.events++;
+        }
+
+        result.complete = true;
+        return result;
+    }
+
+    // Appends the line the text log has for the event, "[%Y-%m-%d %H:%M:%S.%f] [p-%P] [t-%t] [%l] %v"
+    inline void render(const event& e, std::string& text)
+    {
+        const auto date = spdlog::details::os::localtime(std::chrono::system_clock::to_time_t(e.time));
+        const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(e.time.time_since_epoch()).count() % 1000000;
+        fmt::format_to(std::back_inserter(text),
+                       "[{:04}-{:02}-{:02} {:02}:{:02}:{:02}.{:06}] [p-{}] [t-{}] [{}] {}\n",
+                       date.tm_year + 1900,
+                       date.tm_mon + 1,
+                       date.tm_mday,
+                       date.tm_hour,
+                       date.tm_min,
+                       date.tm_sec,
+                       micros,
+                       e.process_id,
+                       e.thread_id,
+                       spdlog::level::to_string_view(e.level),
+                       e.message);
+    }
+}
@@ -6,25 +6,40 @@
 
 namespace
 {
-    // Non-localizable
-    const std::string entering = " Enter";
-    const std::string exiting = " Exit";
-
     std::mutex indentLevelMutex;
     std::map<std::thread::id, int> indentLevel;
 
-    std::string GetIndentation()
+    int GetIndentLevel()
     {
         std::unique_lock lock(indentLevelMutex);
-        int level = indentLevel[std::this_thread::get_id()];
+        return indentLevel[std::this_thread::get_id()];
+    }
+
+    // The format strings are literals and the indentation is a width, so the binary log only writes the function name
+    // and a number for every line. Non-localizable.
+    void TraceEnter(const char* functionName)
+    {
+        const int level = GetIndentLevel();
+        if (level <= 0)
+        {
+            Logger::trace("{} Enter", functionName);
+        }
+        else
+        {
+            Logger::trace("{:{}}- {} Enter", "", 2 * min(level, 64), functionName);
+        }
+    }
 
+    void TraceExit(const char* functionName)
+    {
+        const int level = GetIndentLevel();
         if (level <= 0)
         {
-            return {};
+            Logger::trace("{} Exit", functionName);
         }
         else
         {
-            return std::string(static_cast<int64_t>(2) * min(level, 64) - 1, ' ') + " - ";
+            Logger::trace("{:{}}- {} Exit", "", 2 * min(level, 64), functionName);
         }
     }
 
@@ -44,12 +59,12 @@ namespace
 CallTracer::CallTracer(const char* functionName) :
     functionName(functionName)
 {
-    Logger::trace((GetIndentation() + functionName + entering).c_str());
+    TraceEnter(functionName);
     Indent();
 }
 
 CallTracer::~CallTracer()
 {
     Unindent();
-    Logger::trace((GetIndentation() + functionName + exiting).c_str());
+    TraceExit(this->functionName.c_str());
 }
@@ -3,6 +3,8 @@
 #include "pch.h"
 #include "framework.h"
 #include "logger.h"
+#include "async_ring_sink.h"
+#include <filesystem>
 #include <unordered_map>
 #include <spdlog/sinks/daily_file_sink.h>
 #include <spdlog/sinks/msvc_sink.h>
@@ -10,7 +12,6 @@
 #include <spdlog/sinks/stdout_color_sinks-inl.h>
 #include <iostream>
 
-using spdlog::sinks_init_list;
 using spdlog::level::level_enum;
 using spdlog::sinks::daily_file_sink_mt;
 using spdlog::sinks::msvc_sink_mt;
@@ -27,12 +28,17 @@ namespace
         { L"critical", level_enum::critical },
         { L"off", level_enum::off },
     };
+
+    const std::unordered_map<std::wstring, LogOverflowPolicy> overflowPolicyMapping = {
+        { L"block", LogOverflowPolicy::Block },
+        { L"drop-oldest", LogOverflowPolicy::DropOldest },
+        { L"drop", LogOverflowPolicy::Drop },
+    };
 }
 
-level_enum getLogLevel(std::wstring_view logSettingsPath)
+level_enum getLogLevel(const LogSettings& logSettings)
 {
-    auto logLevel = get_log_settings(logSettingsPath).logLevel;
-    if (auto it = logLevelMapping.find(logLevel); it != logLevelMapping.end())
+    if (auto it = logLevelMapping.find(logSettings.logLevel); it != logLevelMapping.end())
     {
         return it->second;
     }
@@ -44,7 +50,19 @@ level_enum getLogLevel(std::wstring_view logSettingsPath)
     return level_enum::trace;
 }
 
+AsyncLogOptions getAsyncLogOptions(const LogSettings& logSettings)
+{
+    AsyncLogOptions options;
+    if (auto it = overflowPolicyMapping.find(logSettings.overflowPolicy); it != overflowPolicyMapping.end())
+    {
+        options.overflowPolicy = it->second;
+    }
+
+    return options;
+}
+
 std::shared_ptr<spdlog::logger> Logger::logger = spdlog::null_logger_mt("null");
+std::shared_ptr<BinaryLogWriter> Logger::binaryLog;
 
 bool Logger::wasLogFailedShown()
 {
@@ -57,23 +75,41 @@ bool Logger::wasLogFailedShown()
 
 void Logger::init(std::string loggerName, std::wstring logFilePath, std::wstring_view logSettingsPath)
 {
-    auto logLevel = getLogLevel(logSettingsPath);
+    const auto logSettings = get_log_settings(logSettingsPath);
+    const auto logLevel = getLogLevel(logSettings);
+    const bool asyncMode = logSettings.logMode == L"async";
+    const bool binaryFormat = logSettings.logFormat == L"binary";
     bool newLoggerCreated = false;
     try
     {
         logger = spdlog::get(loggerName);
         if (logger == nullptr)
         {
-            auto sink = make_shared<daily_file_sink_mt>(logFilePath, 0, 0, false, LogSettings::retention);
-            if (IsDebuggerPresent())
+            if (binaryFormat)
             {
-                auto msvc_sink = make_shared<msvc_sink_mt>();
-                msvc_sink->set_pattern("[%Y-%m-%d %H:%M:%S.%f] [%n] [t-%t] [%l] %v");
-                logger = make_shared<spdlog::logger>(loggerName, sinks_init_list{ sink, msvc_sink });
+                // Every message goes to the binary log, which is next to where the text log would be. The logger only
+                // keeps the name and the level.
+                binaryLog = make_shared<BinaryLogWriter>(std::filesystem::path{ logFilePath }.replace_extension(L".bin").wstring(), LogSettings::retention);
+                logger = make_shared<spdlog::logger>(loggerName);
             }
             else
             {
-                logger = make_shared<spdlog::logger>(loggerName, sink);
+                std::vector<spdlog::sink_ptr> sinks{ make_shared<daily_file_sink_mt>(logFilePath, 0, 0, false, LogSettings::retention) };
+                if (IsDebuggerPresent())
+                {
+                    auto msvc_sink = make_shared<msvc_sink_mt>();
+                    msvc_sink->set_pattern("[%Y-%m-%d %H:%M:%S.%f] [%n] [t-%t] [%l] %v");
+                    sinks.push_back(msvc_sink);
+                }
+
+                if (asyncMode)
+                {
+                    logger = make_shared<spdlog::logger>(loggerName, make_shared<AsyncRingSink>(std::move(sinks), getAsyncLogOptions(logSettings)));
+                }
+                else
+                {
+                    logger = make_shared<spdlog::logger>(loggerName, begin(sinks), end(sinks));
+                }
             }
             newLoggerCreated = true;
         }
@@ -99,11 +135,18 @@ void Logger::init(std::string loggerName, std::wstring logFilePath, std::wstring
     {
         logger->set_level(logLevel);
         logger->set_pattern("[%Y-%m-%d %H:%M:%S.%f] [p-%P] [t-%t] [%l] %v");
-        logger->flush_on(logLevel); // Auto flush on every log message.
+        // Auto flush on every log message. In the async mode, only errors make the caller wait until they are flushed,
+        // the writer thread flushes everything else.
+        logger->flush_on(asyncMode ? (std::max)(logLevel, level_enum::err) : logLevel);
+        if (binaryLog)
+        {
+            binaryLog->set_level(logLevel);
+            binaryLog->flush_on((std::max)(logLevel, level_enum::err));
+        }
         spdlog::register_logger(logger);
     }
 
-    logger->info("{} logger is initialized", loggerName);
+    Logger::info("{} logger is initialized", loggerName);
 }
 
 void Logger::init(std::vector<spdlog::sink_ptr> sinks)
@@ -115,4 +158,5 @@ void Logger::init(std::vector<spdlog::sink_ptr> sinks)
     }
 
     Logger::logger = init_logger;
+    Logger::binaryLog = nullptr;
 }
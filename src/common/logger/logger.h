@@ -1,5 +1,6 @@
 #pragma once
 #include <spdlog/spdlog.h>
+#include "binary_log.h"
 #include "logger_settings.h"
 
 class Logger
@@ -7,8 +8,38 @@ class Logger
 private:
     inline const static std::wstring logFailedShown = L"logFailedShown";
     static std::shared_ptr<spdlog::logger> logger;
+    // Set when the log is written in the binary format, which then takes every message
+    static std::shared_ptr<BinaryLogWriter> binaryLog;
     static bool wasLogFailedShown();
 
+    template<typename FormatString, typename... Args>
+    static void log(spdlog::level::level_enum level, const FormatString& fmt, const Args&... args)
+    {
+        if (binaryLog)
+        {
+            binaryLog->log(level, fmt, args...);
+        }
+        else
+        {
+            logger->log(level, fmt, args...);
+        }
+    }
+
+    // The binary log identifies literal format strings by their address. The public functions don't take other arrays,
+    // they would fail to convert to binary_log::literal.
+    template<typename Char, typename... Args>
+    static void log(spdlog::level::level_enum level, const binary_log::literal<Char> fmt, const Args&... args)
+    {
+        if (binaryLog)
+        {
+            binaryLog->log(level, fmt, args...);
+        }
+        else
+        {
+            logger->log(level, fmt.data(), args...);
+        }
+    }
+
 public:
     Logger() = delete;
 
@@ -17,48 +48,131 @@ public:
 
     // log message should not be localized
     template<typename FormatString, typename... Args>
+        requires(!std::is_array_v<FormatString>)
     static void trace(const FormatString& fmt, const Args&... args)
     {
-        logger->trace(fmt, args...);
+        log(spdlog::level::trace, fmt, args...);
+    }
+
+    template<typename... Args>
+    static void trace(const binary_log::literal<char> fmt, const Args&... args)
+    {
+        log(spdlog::level::trace, fmt, args...);
+    }
+
+    template<typename... Args>
+    static void trace(const binary_log::literal<wchar_t> fmt, const Args&... args)
+    {
+        log(spdlog::level::trace, fmt, args...);
     }
 
     // log message should not be localized
     template<typename FormatString, typename... Args>
+        requires(!std::is_array_v<FormatString>)
     static void debug(const FormatString& fmt, const Args&... args)
     {
-        logger->debug(fmt, args...);
+        log(spdlog::level::debug, fmt, args...);
+    }
+
+    template<typename... Args>
+    static void debug(const binary_log::literal<char> fmt, const Args&... args)
+    {
+        log(spdlog::level::debug, fmt, args...);
+    }
+
+    template<typename... Args>
+    static void debug(const binary_log::literal<wchar_t> fmt, const Args&... args)
+    {
+        log(spdlog::level::debug, fmt, args...);
     }
 
     // log message should not be localized
     template<typename FormatString, typename... Args>
+        requires(!std::is_array_v<FormatString>)
     static void info(const FormatString& fmt, const Args&... args)
     {
-        logger->info(fmt, args...);
+        log(spdlog::level::info, fmt, args...);
+    }
+
+    template<typename... Args>
+    static void info(const binary_log::literal<char> fmt, const Args&... args)
+    {
+        log(spdlog::level::info, fmt, args...);
+    }
+
+    template<typename... Args>
+    static void info(const binary_log::literal<wchar_t> fmt, const Args&... args)
+    {
+        log(spdlog::level::info, fmt, args...);
     }
 
     // log message should not be localized
     template<typename FormatString, typename... Args>
+        requires(!std::is_array_v<FormatString>)
     static void warn(const FormatString& fmt, const Args&... args)
     {
-        logger->warn(fmt, args...);
+        log(spdlog::level::warn, fmt, args...);
+    }
+
+    template<typename... Args>
+    static void warn(const binary_log::literal<char> fmt, const Args&... args)
+    {
+        log(spdlog::level::warn, fmt, args...);
+    }
+
+    template<typename... Args>
+    static void warn(const binary_log::literal<wchar_t> fmt, const Args&... args)
+    {
+        log(spdlog::level::warn, fmt, args...);
     }
 
     // log message should not be localized
     template<typename FormatString, typename... Args>
+        requires(!std::is_array_v<FormatString>)
     static void error(const FormatString& fmt, const Args&... args)
     {
-        logger->error(fmt, args...);
+        log(spdlog::level::err, fmt, args...);
+    }
+
+    template<typename... Args>
+    static void error(const binary_log::literal<char> fmt, const Args&... args)
+    {
+        log(spdlog::level::err, fmt, args...);
+    }
+
+    template<typename... Args>
+    static void error(const binary_log::literal<wchar_t> fmt, const Args&... args)
+    {
+        log(spdlog::level::err, fmt, args...);
     }
 
     // log message should not be localized
     template<typename FormatString, typename... Args>
+        requires(!std::is_array_v<FormatString>)
     static void critical(const FormatString& fmt, const Args&... args)
     {
-        logger->critical(fmt, args...);
+        log(spdlog::level::critical, fmt, args...);
+    }
+
+    template<typename... Args>
+    static void critical(const binary_log::literal<char> fmt, const Args&... args)
+    {
+        log(spdlog::level::critical, fmt, args...);
+    }
+
+    template<typename... Args>
+    static void critical(const binary_log::literal<wchar_t> fmt, const Args&... args)
+    {
+        log(spdlog::level::critical, fmt, args...);
     }
 
     static void flush()
     {
+        if (binaryLog)
+        {
+            binaryLog->flush();
+        }
+
         logger->flush();
     }
 };
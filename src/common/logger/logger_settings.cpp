@@ -10,6 +10,9 @@ using namespace winrt::Windows::Data::Json;
 LogSettings::LogSettings()
 {
     logLevel = defaultLogLevel;
+    logMode = defaultLogMode;
+    overflowPolicy = defaultOverflowPolicy;
+    logFormat = defaultLogFormat;
 }
 
 std::optional<JsonObject> from_file(std::wstring_view file_name)
@@ -47,6 +50,9 @@ JsonObject to_json(LogSettings settings)
 {
     JsonObject result;
     result.SetNamedValue(LogSettings::logLevelOption, JsonValue::CreateStringValue(settings.logLevel));
+    result.SetNamedValue(LogSettings::logModeOption, JsonValue::CreateStringValue(settings.logMode));
+    result.SetNamedValue(LogSettings::overflowPolicyOption, JsonValue::CreateStringValue(settings.overflowPolicy));
+    result.SetNamedValue(LogSettings::logFormatOption, JsonValue::CreateStringValue(settings.logFormat));
 
     return result;
 }
@@ -62,7 +68,35 @@ LogSettings to_settings(JsonObject jobject)
     {
         result.logLevel = LogSettings::defaultLogLevel;
     }
-    
+
+    // Settings files written before these options existed don't have them
+    try
+    {
+        result.logMode = jobject.GetNamedString(LogSettings::logModeOption);
+    }
+    catch (...)
+    {
+        result.logMode = LogSettings::defaultLogMode;
+    }
+
+    try
+    {
+        result.overflowPolicy = jobject.GetNamedString(LogSettings::overflowPolicyOption);
+    }
+    catch (...)
+    {
+        result.overflowPolicy = LogSettings::defaultOverflowPolicy;
+    }
+
+    try
+    {
+        result.logFormat = jobject.GetNamedString(LogSettings::logFormatOption);
+    }
+    catch (...)
+    {
+        result.logFormat = LogSettings::defaultLogFormat;
+    }
+
     return result;
 }
 
@@ -6,6 +6,15 @@ struct LogSettings
     // The following strings are not localizable
     inline const static std::wstring defaultLogLevel = L"trace";
     inline const static std::wstring logLevelOption = L"logLevel";
+    // "sync" writes and flushes every message on the caller's thread, "async" hands it to a writer thread
+    inline const static std::wstring defaultLogMode = L"sync";
+    inline const static std::wstring logModeOption = L"logMode";
+    // What the async mode does when its ring is full: "block", "drop-oldest" or "drop"
+    inline const static std::wstring defaultOverflowPolicy = L"block";
+    inline const static std::wstring overflowPolicyOption = L"logOverflowPolicy";
+    // "text" writes lines, "binary" writes the arguments of every call, which the BinaryLogDecoder tool turns into text
+    inline const static std::wstring defaultLogFormat = L"text";
+    inline const static std::wstring logFormatOption = L"logFormat";
     inline const static std::string runnerLoggerName = "runner";
     inline const static std::wstring logPath = L"Logs\\";
     inline const static std::wstring runnerLogPath = L"RunnerLogs\\runner-log.txt";
@@ -71,6 +80,9 @@ struct LogSettings
     inline const static std::string cmdNotFoundLoggerName = "cmd-not-found";
     inline const static int retention = 30;
     std::wstring logLevel;
+    std::wstring logMode;
+    std::wstring overflowPolicy;
+    std::wstring logFormat;
     LogSettings();
 };
 
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// Shared by the benchmark executables of the modules
+namespace benchmark
+{
+    // Outcome of a group of validation cases, printed by main, which fails the run if any case failed
+    struct CheckResult
+    {
+        std::wstring name;
+        size_t cases = {};
+        size_t failures = {};
+    };
+
+    template<typename Fn>
+    double MeasureSeconds(Fn&& fn)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Bounded queue which any thread pushes into and a single thread pops from without taking a lock. Every slot has a
+// sequence telling whether it's free for the push of the current round, or holds the value for the pop of that round.
+template<typename T>
+class MpscRing
+{
+    struct Slot
+    {
+        std::atomic<size_t> sequence = 0;
+        T value = {};
+    };
+
+    std::unique_ptr<Slot[]> _slots;
+    size_t _mask = 0;
+    // Keeps the positions on their own cache lines, and apart from the members of the class holding the ring. Padding
+    // rather than alignas, which warns (C4324) where the ring is instantiated.
+    char _push_padding[64] = {};
+    std::atomic<size_t> _push_position = 0;
+    char _pop_padding[64 - sizeof(std::atomic<size_t>)] = {};
+    std::atomic<size_t> _pop_position = 0;
+    char _end_padding[64 - sizeof(std::atomic<size_t>)] = {};
+
+    static size_t round_up(const size_t capacity) noexcept
+    {
+        size_t rounded = 2;
+        while (rounded < capacity)
+        {
+            rounded <<= 1;
+        }
+
+        return rounded;
+    }
+
+public:
+    // The capacity is rounded up to a power of two
+    explicit MpscRing(const size_t capacity) :
+        _slots{ std::make_unique<Slot[]>(round_up(capacity)) }, _mask{ round_up(capacity) - 1 }
+    {
+        for (size_t i = 0; i <= _mask; ++i)
+        {
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // Fails without waiting if the ring is full. The value is only moved from when it was pushed.
+    bool try_push(T&& value) noexcept
+    {
+        size_t position = _push_position.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot& slot = _slots[position & _mask];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+            if (difference == 0)
+            {
+                if (_push_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    slot.value = std::move(value);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = _push_position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Must only be called by one thread at a time, as the functions below
+    bool try_pop(T& value) noexcept
+    {
+        const size_t position = _pop_position.load(std::memory_order_relaxed);
+        Slot& slot = _slots[position & _mask];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+        {
+            return false;
+        }
+
+        value = std::move(slot.value);
+        slot.value = T{};
+        slot.sequence.store(position + _mask + 1, std::memory_order_release);
+        _pop_position.store(position + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Whether try_pop would return a value
+    bool can_pop() const noexcept
+    {
+        const size_t position = _pop_position.load(std::memory_order_relaxed);
+        return _slots[position & _mask].sequence.load(std::memory_order_acquire) == position + 1;
+    }
+
+    // Whether every push which took a slot was popped, i.e. no push is in flight either
+    bool drained() const noexcept
+    {
+        return _push_position.load(std::memory_order_acquire) == _pop_position.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const noexcept
+    {
+        return _mask + 1;
+    }
+
+    // Approximate while other threads push or pop
+    size_t size() const noexcept
+    {
+        const size_t pushed = _push_position.load(std::memory_order_relaxed);
+        const size_t popped = _pop_position.load(std::memory_order_relaxed);
+        return pushed > popped ? pushed - popped : 0;
+    }
+};
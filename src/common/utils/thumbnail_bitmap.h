@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#include <windows.h>
+
+// Largest thumbnail size the native thumbnail providers accept from IThumbnailProvider::GetThumbnail
+constexpr UINT MaxThumbnailSize = 10000;
+
+// Creates a 32bpp top-down DIB section for a thumbnail, returns the pointer to its pixels in bits
+inline HBITMAP CreateThumbnailBitmap(const UINT width, const UINT height, void** bits)
+{
+    BITMAPINFO bitmapInfo = {};
+    bitmapInfo.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bitmapInfo.bmiHeader.biWidth = static_cast<LONG>(width);
+    // Negative height for top-down rows
+    bitmapInfo.bmiHeader.biHeight = -static_cast<LONG>(height);
+    bitmapInfo.bmiHeader.biPlanes = 1;
+    bitmapInfo.bmiHeader.biBitCount = 32;
+    bitmapInfo.bmiHeader.biCompression = BI_RGB;
+
+    return CreateDIBSection(NULL, &bitmapInfo, DIB_RGB_COLORS, bits, NULL, 0);
+}
+
+// Creates the DIB section and copies width * height BGRA pixels into it
+inline HBITMAP CreateThumbnailBitmap(const UINT width, const UINT height, std::span<const uint32_t> pixels)
+{
+    void* bits = nullptr;
+    HBITMAP bitmap = CreateThumbnailBitmap(width, height, &bits);
+    if (bitmap)
+    {
+        std::memcpy(bits, pixels.data(), std::min<size_t>(pixels.size(), static_cast<size_t>(width) * height) * sizeof(uint32_t));
+    }
+
+    return bitmap;
+}
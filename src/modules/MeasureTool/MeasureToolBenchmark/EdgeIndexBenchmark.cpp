@@ -0,0 +1,127 @@
+#include "pch.h"
+#include "EdgeIndexBenchmark.h"
+
+#include <common/utils/benchmark.h>
+
+#include <EdgeDetection.h>
+#include <EdgeIndex.h>
+
+namespace
+{
+    // Tolerances the mouse wheel goes through, starting from the default one
+    constexpr uint8_t Tolerances[] = { 30, 45, 0, 255 };
+
+    RECT DetectEdgesScanning(const BGRATextureView& texture, const POINT centerPoint, const bool perChannel, const uint8_t tolerance)
+    {
+        static const ScanFunction perChannelScan = GetScanFunction<true>(BestScanInstructionSet());
+        static const ScanFunction sumScan = GetScanFunction<false>(BestScanInstructionSet());
+
+        if (perChannel)
+        {
+            return RECT{ .left = FindEdge<true, true, false>(texture, centerPoint, tolerance, perChannelScan),
+                         .top = FindEdge<true, false, false>(texture, centerPoint, tolerance, perChannelScan),
+                         .right = FindEdge<true, true, true>(texture, centerPoint, tolerance, perChannelScan),
+                         .bottom = FindEdge<true, false, true>(texture, centerPoint, tolerance, perChannelScan) };
+        }
+
+        return RECT{ .left = FindEdge<false, true, false>(texture, centerPoint, tolerance, sumScan),
+                     .top = FindEdge<false, false, false>(texture, centerPoint, tolerance, sumScan),
+                     .right = FindEdge<false, true, true>(texture, centerPoint, tolerance, sumScan),
+                     .bottom = FindEdge<false, false, true>(texture, centerPoint, tolerance, sumScan) };
+    }
+}
+
+namespace MeasureToolBenchmark
+{
+    std::vector<EdgeIndexResult> RunEdgeIndexBenchmark(const SyntheticFrame& frame, size_t queries, unsigned int seed)
+    {
+        const BGRATextureView texture = frame.View();
+
+        // A cursor path rather than random points, since that's how the index is queried
+        std::mt19937 random(seed);
+        std::vector<POINT> points(queries);
+        POINT cursor{ static_cast<LONG>(frame.width / 2), static_cast<LONG>(frame.height / 2) };
+        for (auto& point : points)
+        {
+            cursor.x = std::clamp<LONG>(cursor.x + static_cast<LONG>(random() % 21) - 10, 0, static_cast<LONG>(frame.width - 1));
+            cursor.y = std::clamp<LONG>(cursor.y + static_cast<LONG>(random() % 21) - 10, 0, static_cast<LONG>(frame.height - 1));
+            point = cursor;
+        }
+
+        std::vector<RECT> expected(queries);
+        std::vector<RECT> actual(queries);
+        std::vector<EdgeIndexResult> results;
+
+        for (const bool perChannel : { false, true })
+        {
+            for (const uint8_t tolerance : Tolerances)
+            {
+                EdgeIndexResult result{ .perChannel = perChannel, .tolerance = tolerance, .queries = queries };
+
+                EdgeIndex index{ texture };
+                if (!index.CanIndex())
+                {
+                    continue;
+                }
+
+                result.scanSeconds = benchmark::MeasureSeconds([&] {
+                    for (size_t i = 0; i < queries; ++i)
+                    {
+                        expected[i] = DetectEdgesScanning(texture, points[i], perChannel, tolerance);
+                    }
+                });
+
+                // Tiles are indexed as MeasureTool does, when the cursor enters them, and dropped by the cap of
+                // MeasureTool. Every lookup is checked right after its tile is indexed or found.
+                for (size_t i = 0; i < queries; ++i)
+                {
+                    if (!index.TryDetectEdges(points[i], perChannel, tolerance))
+                    {
+                        result.buildSeconds += benchmark::MeasureSeconds([&] {
+                            index.IndexTile(index.KeyFor(points[i], perChannel, tolerance));
+                        });
+                        result.tilesBuilt++;
+                        result.peakBytes = std::max(result.peakBytes, index.MemoryUsage());
+                    }
+
+                    const auto edges = index.TryDetectEdges(points[i], perChannel, tolerance);
+                    if (!edges || !SameEdges(expected[i], *edges))
+                    {
+                        result.mismatches++;
+                    }
+                }
+
+                // Lookups are timed on an index that keeps every tile of the path, a walk back over tiles dropped by
+                // the cap would time DetectEdges instead
+                EdgeIndex lookupIndex{ texture, result.tilesBuilt };
+                for (size_t i = 0; i < queries; ++i)
+                {
+                    const auto key = lookupIndex.KeyFor(points[i], perChannel, tolerance);
+                    if (!lookupIndex.Contains(key))
+                    {
+                        lookupIndex.IndexTile(key);
+                    }
+                }
+
+                result.lookupSeconds = benchmark::MeasureSeconds([&] {
+                    for (size_t i = 0; i < queries; ++i)
+                    {
+                        actual[i] = lookupIndex.TryDetectEdges(points[i], perChannel, tolerance).value_or(RECT{});
+                    }
+                });
+
+                for (size_t i = 0; i < queries; ++i)
+                {
+                    if (!SameEdges(expected[i], actual[i]))
+                    {
+                        result.mismatches++;
+                    }
+                }
+
+                results.push_back(result);
+            }
+        }
+
+        return results;
+    }
+}
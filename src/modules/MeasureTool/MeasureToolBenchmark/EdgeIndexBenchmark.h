@@ -0,0 +1,23 @@
+#pragma once
+
+#include "SyntheticFrames.h"
+
+namespace MeasureToolBenchmark
+{
+    struct EdgeIndexResult
+    {
+        bool perChannel = {};
+        uint8_t tolerance = {};
+        size_t tilesBuilt = {};
+        double buildSeconds = {}; // for all tiles
+        size_t peakBytes = {};
+        double lookupSeconds = {}; // for all queries
+        double scanSeconds = {}; // DetectEdges for the same queries
+        size_t queries = {};
+        size_t mismatches = {}; // lookups which differ from DetectEdges
+    };
+
+    // Indexes the tiles a cursor path visits for a few tolerances of both edge detection modes, with the tile cap of
+    // MeasureTool, and compares lookups along the path with the edges DetectEdges finds at the same points.
+    std::vector<EdgeIndexResult> RunEdgeIndexBenchmark(const SyntheticFrame& frame, size_t queries, unsigned int seed);
+}
@@ -0,0 +1,162 @@
+#include "pch.h"
+#include "EdgeScanBenchmark.h"
+
+#include <common/utils/benchmark.h>
+
+#include <EdgeDetection.h>
+
+namespace
+{
+    struct Query
+    {
+        POINT point;
+        uint8_t tolerance;
+        bool perChannel;
+    };
+
+    // The original FindEdge implementation, which compares one pixel per step
+    template<bool PerChannel,
+             bool IsX,
+             bool Increment>
+    long FindEdgeStepping(const BGRATextureView& texture, const POINT centerPoint, const uint8_t tolerance)
+    {
+        const size_t maxDim = IsX ? texture.width : texture.height;
+
+        long x = std::clamp<long>(centerPoint.x, 1, static_cast<long>(texture.width - 2));
+        long y = std::clamp<long>(centerPoint.y, 1, static_cast<long>(texture.height - 2));
+
+        const uint32_t startPixel = texture.GetPixel(x, y);
+        while (true)
+        {
+            long oldX = x;
+            long oldY = y;
+            if constexpr (IsX)
+            {
+                if constexpr (Increment)
+                {
+                    if (++x == maxDim)
+                        break;
+                }
+                else
+                {
+                    if (--x == 0)
+                        break;
+                }
+            }
+            else
+            {
+                if constexpr (Increment)
+                {
+                    if (++y == maxDim)
+                        break;
+                }
+                else
+                {
+                    if (--y == 0)
+                        break;
+                }
+            }
+
+            const uint32_t nextPixel = texture.GetPixel(x, y);
+            if (!texture.PixelsClose<PerChannel>(startPixel, nextPixel, tolerance))
+            {
+                return IsX ? oldX : oldY;
+            }
+        }
+
+        return Increment ? static_cast<long>(IsX ? texture.width : texture.height) - 1 : 0;
+    }
+
+    template<bool PerChannel>
+    RECT DetectEdgesStepping(const BGRATextureView& texture, const POINT centerPoint, const uint8_t tolerance)
+    {
+        return RECT{ .left = FindEdgeStepping<PerChannel, true, false>(texture, centerPoint, tolerance),
+                     .top = FindEdgeStepping<PerChannel, false, false>(texture, centerPoint, tolerance),
+                     .right = FindEdgeStepping<PerChannel, true, true>(texture, centerPoint, tolerance),
+                     .bottom = FindEdgeStepping<PerChannel, false, true>(texture, centerPoint, tolerance) };
+    }
+
+    template<bool PerChannel>
+    RECT DetectEdgesScanning(const BGRATextureView& texture, const POINT centerPoint, const uint8_t tolerance, const ScanFunction scan)
+    {
+        return RECT{ .left = FindEdge<PerChannel, true, false>(texture, centerPoint, tolerance, scan),
+                     .top = FindEdge<PerChannel, false, false>(texture, centerPoint, tolerance, scan),
+                     .right = FindEdge<PerChannel, true, true>(texture, centerPoint, tolerance, scan),
+                     .bottom = FindEdge<PerChannel, false, true>(texture, centerPoint, tolerance, scan) };
+    }
+
+    std::vector<std::pair<std::wstring, ScanInstructionSet>> AvailableInstructionSets()
+    {
+        std::vector<std::pair<std::wstring, ScanInstructionSet>> result = { { L"scalar", ScanInstructionSet::Scalar } };
+#if defined(_M_ARM64)
+        result.emplace_back(L"neon", ScanInstructionSet::NEON);
+#else
+        result.emplace_back(L"sse2", ScanInstructionSet::SSE2);
+        if (BestScanInstructionSet() == ScanInstructionSet::AVX2)
+        {
+            result.emplace_back(L"avx2", ScanInstructionSet::AVX2);
+        }
+#endif
+        return result;
+    }
+}
+
+namespace MeasureToolBenchmark
+{
+    std::vector<EdgeScanResult> RunEdgeScanBenchmark(const SyntheticFrame& frame, size_t queries, unsigned int seed)
+    {
+        const BGRATextureView texture = frame.View();
+
+        std::mt19937 random(seed);
+        std::vector<Query> workload(queries);
+        for (auto& query : workload)
+        {
+            query.point = POINT{ static_cast<LONG>(random() % frame.width), static_cast<LONG>(random() % frame.height) };
+            query.tolerance = static_cast<uint8_t>(random() % 64);
+            query.perChannel = random() % 2 == 0;
+        }
+
+        std::vector<RECT> expected(queries);
+        std::vector<EdgeScanResult> results;
+
+        EdgeScanResult stepping{ .name = L"stepping", .queries = queries };
+        stepping.seconds = benchmark::MeasureSeconds([&] {
+            for (size_t i = 0; i < queries; ++i)
+            {
+                const auto& query = workload[i];
+                expected[i] = query.perChannel ? DetectEdgesStepping<true>(texture, query.point, query.tolerance) :
+                                                 DetectEdgesStepping<false>(texture, query.point, query.tolerance);
+            }
+        });
+        results.push_back(stepping);
+
+        std::vector<RECT> actual(queries);
+        for (const auto& [name, instructionSet] : AvailableInstructionSets())
+        {
+            const ScanFunction perChannelScan = GetScanFunction<true>(instructionSet);
+            const ScanFunction sumScan = GetScanFunction<false>(instructionSet);
+
+            EdgeScanResult result{ .name = name, .queries = queries };
+            result.seconds = benchmark::MeasureSeconds([&] {
+                for (size_t i = 0; i < queries; ++i)
+                {
+                    const auto& query = workload[i];
+                    actual[i] = query.perChannel ? DetectEdgesScanning<true>(texture, query.point, query.tolerance, perChannelScan) :
+                                                   DetectEdgesScanning<false>(texture, query.point, query.tolerance, sumScan);
+                }
+            });
+
+            for (size_t i = 0; i < queries; ++i)
+            {
+                if (!SameEdges(expected[i], actual[i]))
+                {
+                    result.mismatches++;
+                }
+            }
+
+            results.push_back(result);
+        }
+
+        return results;
+    }
+}
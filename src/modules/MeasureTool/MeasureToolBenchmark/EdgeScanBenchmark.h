@@ -0,0 +1,18 @@
+#pragma once
+
+#include "SyntheticFrames.h"
+
+namespace MeasureToolBenchmark
+{
+    struct EdgeScanResult
+    {
+        std::wstring name;
+        size_t queries = {};
+        double seconds = {};
+        size_t mismatches = {}; // results which differ from the pixel-by-pixel walk
+    };
+
+    // Detects edges around random points of the frame with the pixel-by-pixel walk MeasureTool used originally,
+    // and then with every edge scanner available on this CPU, checking that all of them return the same edges.
+    std::vector<EdgeScanResult> RunEdgeScanBenchmark(const SyntheticFrame& frame, size_t queries, unsigned int seed);
+}
@@ -0,0 +1,220 @@
+#include "pch.h"
+#include "ReplayBenchmark.h"
+
+#include <EdgeDetection.h>
+#include <common/utils/benchmark.h>
+#include <common/utils/serialized.h>
+
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    struct ReplayState
+    {
+        uint8_t pixelTolerance = 30;
+        std::optional<RECT> measuredEdges;
+    };
+
+    // DetectEdges of MeasureToolCore, which isn't linked into the benchmark, with the sum of channel distances
+    RECT DetectEdgesScanning(const BGRATextureView& texture, const POINT centerPoint, const uint8_t tolerance)
+    {
+        static const ScanFunction scan = GetScanFunction<false>(BestScanInstructionSet());
+
+        return RECT{ .left = FindEdge<false, true, false>(texture, centerPoint, tolerance, scan),
+                     .top = FindEdge<false, false, false>(texture, centerPoint, tolerance, scan),
+                     .right = FindEdge<false, true, true>(texture, centerPoint, tolerance, scan),
+                     .bottom = FindEdge<false, false, true>(texture, centerPoint, tolerance, scan) };
+    }
+
+    // Calls onFrame with every frame of the sequence and the cursor position of the frame. Every replay of the same
+    // frame, path and seed produces the same frames.
+    template<typename OnFrame>
+    void ReplayFrames(const MeasureToolBenchmark::SyntheticFrame& frame, const MeasureToolBenchmark::CursorPath& path, unsigned int seed, OnFrame&& onFrame)
+    {
+        MeasureToolBenchmark::SyntheticFrame replayed = frame;
+        const BGRATextureView texture = replayed.View();
+        const auto fill = [&](const size_t left, const size_t top, const size_t width, const size_t height, const uint32_t color) {
+            for (size_t y = top; y < std::min(top + height, replayed.height); ++y)
+            {
+                std::fill_n(replayed.pixels.begin() + y * replayed.pitch + left, std::min(width, replayed.width - left), color);
+            }
+        };
+
+        // A caret blinks about every 530 ms and a clock ticks every second at 90 fps
+        constexpr size_t caretBlinkFrames = 48;
+        constexpr size_t clockTickFrames = 90;
+        const size_t caretLeft = frame.width / 3;
+        const size_t caretTop = frame.height / 4;
+        const uint32_t caretBackground = frame.pixels[caretTop * frame.pitch + caretLeft];
+
+        // A tooltip shows up below the cursor once it has rested for a third of a second, crossing only its column
+        constexpr size_t tooltipDelayFrames = 30;
+        constexpr size_t tooltipWidth = 200;
+        constexpr size_t tooltipHeight = 30;
+        std::optional<std::pair<size_t, size_t>> tooltip;
+        size_t restingFrames = 0;
+
+        std::mt19937 random(seed);
+        for (size_t frameIndex = 0; frameIndex < path.size(); ++frameIndex)
+        {
+            const POINT cursor{ std::clamp<LONG>(path[frameIndex].x, 0, static_cast<LONG>(frame.width) - 1),
+                                std::clamp<LONG>(path[frameIndex].y, 0, static_cast<LONG>(frame.height) - 1) };
+            restingFrames = frameIndex > 0 && path[frameIndex].x == path[frameIndex - 1].x && path[frameIndex].y == path[frameIndex - 1].y ? restingFrames + 1 : 0;
+            if (restingFrames == 0 && tooltip)
+            {
+                const auto [left, top] = *tooltip;
+                for (size_t y = top; y < std::min(top + tooltipHeight, replayed.height); ++y)
+                {
+                    const size_t offset = y * replayed.pitch + left;
+                    std::copy_n(frame.pixels.begin() + offset, std::min(tooltipWidth, replayed.width - left), replayed.pixels.begin() + offset);
+                }
+
+                tooltip.reset();
+            }
+            else if (restingFrames == tooltipDelayFrames)
+            {
+                tooltip.emplace(cursor.x > tooltipWidth / 2 ? cursor.x - tooltipWidth / 2 : 0, std::min<size_t>(cursor.y + 20, frame.height - 1));
+                fill(tooltip->first, tooltip->second, tooltipWidth, tooltipHeight, 0xFFFFFFE1);
+            }
+
+            fill(frame.width / 16, frame.height / 2, frame.width / 6, frame.height / 6, 0xFF000000 | static_cast<uint32_t>(random()));
+            if (frameIndex % caretBlinkFrames == 0)
+            {
+                fill(caretLeft, caretTop, 2, 20, (frameIndex / caretBlinkFrames) % 2 ? caretBackground : 0xFF000000);
+            }
+
+            if (frameIndex % clockTickFrames == 0)
+            {
+                fill(frame.width - frame.width / 16, frame.height - frame.height / 32, 60, 16, 0xFF000000 | static_cast<uint32_t>(random()));
+            }
+
+            onFrame(texture, cursor);
+        }
+    }
+}
+
+namespace MeasureToolBenchmark
+{
+    std::optional<CursorPath> LoadCursorPath(const std::filesystem::path& path)
+    {
+        std::ifstream file{ path };
+        if (!file)
+        {
+            return std::nullopt;
+        }
+
+        CursorPath cursorPath;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+            {
+                continue;
+            }
+
+            std::istringstream coordinates{ line };
+            POINT point{};
+            if (!(coordinates >> point.x >> point.y))
+            {
+                return std::nullopt;
+            }
+
+            cursorPath.push_back(point);
+        }
+
+        return cursorPath;
+    }
+
+    CursorPath GenerateCursorPath(size_t width, size_t height, size_t frames, unsigned int seed)
+    {
+        std::mt19937 random(seed);
+        const LONG w = static_cast<LONG>(width);
+        const LONG h = static_cast<LONG>(height);
+
+        CursorPath path;
+        path.reserve(frames);
+        POINT cursor{ w / 2, h / 2 };
+        while (path.size() < frames)
+        {
+            const size_t segmentFrames = std::min<size_t>(30 + random() % 90, frames - path.size());
+            switch (random() % 4)
+            {
+            case 0: // resting
+                path.insert(path.end(), segmentFrames, cursor);
+                break;
+            case 1: // adjusting by a pixel or two
+                for (size_t i = 0; i < segmentFrames; ++i)
+                {
+                    cursor.x = std::clamp<LONG>(cursor.x + static_cast<LONG>(random() % 5) - 2, 0, w - 1);
+                    cursor.y = std::clamp<LONG>(cursor.y + static_cast<LONG>(random() % 5) - 2, 0, h - 1);
+                    path.push_back(cursor);
+                }
+                break;
+            case 2: // dragging along a line
+            {
+                const POINT from = cursor;
+                const POINT to{ static_cast<LONG>(random() % width), static_cast<LONG>(random() % height) };
+                for (size_t i = 1; i <= segmentFrames; ++i)
+                {
+                    cursor.x = from.x + static_cast<LONG>((to.x - from.x) * static_cast<int64_t>(i) / static_cast<int64_t>(segmentFrames));
+                    cursor.y = from.y + static_cast<LONG>((to.y - from.y) * static_cast<int64_t>(i) / static_cast<int64_t>(segmentFrames));
+                    path.push_back(cursor);
+                }
+                break;
+            }
+            default: // jumping elsewhere
+                cursor = { static_cast<LONG>(random() % width), static_cast<LONG>(random() % height) };
+                path.push_back(cursor);
+                break;
+            }
+        }
+
+        return path;
+    }
+
+    ReplayResult RunReplayBenchmark(const SyntheticFrame& frame, const CursorPath& path, unsigned int seed)
+    {
+        FrameTimings timings;
+        Serialized<ReplayState> state;
+        EdgeChangeTracker changeTracker;
+        ReplayResult result{ .frames = path.size() };
+
+        // Scanning every edge in a pass of its own, so neither pass finds the scan lines of the other in the cache
+        std::vector<RECT> scanned;
+        scanned.reserve(path.size());
+        ReplayFrames(frame, path, seed, [&](const BGRATextureView& texture, const POINT cursor) {
+            result.scanSeconds += benchmark::MeasureSeconds([&] {
+                scanned.push_back(DetectEdgesScanning(texture, cursor, ReplayState{}.pixelTolerance));
+            });
+        });
+
+        size_t frameIndex = 0;
+        ReplayFrames(frame, path, seed, [&](const BGRATextureView& texture, const POINT cursor) {
+            uint8_t tolerance = {};
+            state.Read([&](const ReplayState& s) { tolerance = s.pixelTolerance; });
+
+            RECT bounds = {};
+            result.trackedSeconds += benchmark::MeasureSeconds([&] {
+                ScopedStageTimer timer{ timings, FrameStage::EdgeDetection };
+                bounds = changeTracker.DetectEdges(texture, cursor, false, tolerance);
+            });
+
+            if (!SameEdges(bounds, scanned[frameIndex++]))
+            {
+                result.mismatches++;
+            }
+
+            ScopedStageTimer timer{ timings, FrameStage::StateHandoff };
+            state.Access([&](ReplayState& s) { s.measuredEdges = bounds; });
+        });
+
+        result.changes = changeTracker.Stats();
+        for (size_t i = 0; i < result.stages.size(); ++i)
+        {
+            result.stages[i] = timings.Summary(static_cast<FrameStage>(i));
+        }
+
+        return result;
+    }
+}
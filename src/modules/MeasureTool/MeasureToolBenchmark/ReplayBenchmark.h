@@ -0,0 +1,38 @@
+#pragma once
+
+#include "SyntheticFrames.h"
+
+#include <EdgeChangeTracker.h>
+#include <FrameTimings.h>
+
+#include <filesystem>
+#include <optional>
+
+namespace MeasureToolBenchmark
+{
+    // Cursor positions of consecutive frames. A recorded path is a text file with an "x y" line per frame,
+    // where lines starting with # are ignored.
+    using CursorPath = std::vector<POINT>;
+
+    std::optional<CursorPath> LoadCursorPath(const std::filesystem::path& path);
+
+    // Resting, small adjustments, drags along lines and jumps, like a user measuring things on the screen
+    CursorPath GenerateCursorPath(size_t width, size_t height, size_t frames, unsigned int seed);
+
+    struct ReplayResult
+    {
+        size_t frames = {};
+        std::array<FrameStageSummary, static_cast<size_t>(FrameStage::Count)> stages = {};
+        EdgeChangeTracker::Statistics changes;
+        double trackedSeconds = {};
+        double scanSeconds = {};
+        size_t mismatches = {}; // frames where the tracked edges differ from a scan of every edge
+    };
+
+    // Drives the measurement of a continuous capture along the path over a sequence of frames based on the given one:
+    // a video region changes every frame, a caret blinks, a clock ticks and a tooltip shows up below a resting cursor.
+    // The settings are read from and the measurement is published to a Serialized state like the capturing thread
+    // does. Edges are detected through an EdgeChangeTracker and compared with a scan of every edge, which is timed in a
+    // pass of its own. Only the stages which don't need a GPU or a window are recorded.
+    ReplayResult RunReplayBenchmark(const SyntheticFrame& frame, const CursorPath& path, unsigned int seed);
+}
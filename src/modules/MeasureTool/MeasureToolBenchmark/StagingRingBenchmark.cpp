@@ -0,0 +1,131 @@
+#include "pch.h"
+#include "StagingRingBenchmark.h"
+
+#include <StagingTextureRing.h>
+
+namespace
+{
+    using namespace MeasureToolBenchmark;
+
+    struct FakeTexture
+    {
+        size_t id = {};
+        StagingTextureSize size;
+        double copyCompletedAt = {}; // simulated time of the last copy to this texture
+        bool mapped = false;
+    };
+
+    using FakeTextureHandle = std::shared_ptr<FakeTexture>;
+
+    class FakeAllocator final : public StagingTextureAllocator<FakeTextureHandle>
+    {
+        size_t nextId = 0;
+
+    public:
+        size_t allocations = 0;
+
+        FakeTextureHandle Allocate(const StagingTextureSize& size) override
+        {
+            allocations++;
+            return std::make_shared<FakeTexture>(FakeTexture{ .id = nextId++, .size = size });
+        }
+    };
+
+    // Frame sizes of the replayed capture, the monitor resolution changes once in the middle
+    StagingTextureSize FrameSize(size_t frame, size_t frames)
+    {
+        constexpr uint32_t B8G8R8A8_UNORM = 87;
+        return frame < frames / 2 ? StagingTextureSize{ 3840, 2160, B8G8R8A8_UNORM } : StagingTextureSize{ 2560, 1440, B8G8R8A8_UNORM };
+    }
+
+    class Replay
+    {
+        StagingRingResult& result;
+        double copyLatencyMs;
+
+    public:
+        double now = {};
+
+        Replay(StagingRingResult& result, double copyLatencyMs) :
+            result{ result }, copyLatencyMs{ copyLatencyMs }
+        {
+        }
+
+        void Copy(const FakeTextureHandle& texture)
+        {
+            if (texture->mapped || texture->copyCompletedAt > now)
+            {
+                result.reusedInFlight++;
+            }
+
+            texture->copyCompletedAt = now + copyLatencyMs;
+        }
+
+        // Map blocks until the copy is complete, the texture is unmapped once edge detection is done
+        void MapAndUnmap(const FakeTextureHandle& texture)
+        {
+            texture->mapped = true;
+            const double stall = std::max(0.0, texture->copyCompletedAt - now);
+            now += stall;
+            result.totalStallMs += stall;
+            result.maxStallMs = std::max(result.maxStallMs, stall);
+            texture->mapped = false;
+        }
+    };
+}
+
+namespace MeasureToolBenchmark
+{
+    std::vector<StagingRingResult> RunStagingRingBenchmark(size_t frames, double frameIntervalMs, double copyLatencyMs)
+    {
+        std::vector<StagingRingResult> results;
+
+        {
+            StagingRingResult result{ .name = L"allocate+map", .copyLatencyMs = copyLatencyMs, .frames = frames };
+            FakeAllocator allocator;
+            Replay replay{ result, copyLatencyMs };
+            for (size_t frame = 0; frame < frames; ++frame)
+            {
+                replay.now = std::max(replay.now, frame * frameIntervalMs);
+
+                const auto texture = allocator.Allocate(FrameSize(frame, frames));
+                replay.Copy(texture);
+                replay.MapAndUnmap(texture);
+            }
+
+            result.allocations = allocator.allocations;
+            results.push_back(result);
+        }
+
+        {
+            StagingRingResult result{ .name = L"ring+pipelined", .copyLatencyMs = copyLatencyMs, .frames = frames };
+            FakeAllocator allocator;
+            StagingTextureRing<FakeTextureHandle> ring{ allocator, 3 };
+            Replay replay{ result, copyLatencyMs };
+            FakeTextureHandle pending;
+            for (size_t frame = 0; frame < frames; ++frame)
+            {
+                replay.now = std::max(replay.now, frame * frameIntervalMs);
+
+                const auto texture = ring.Next(FrameSize(frame, frames));
+                replay.Copy(texture);
+                if (pending)
+                {
+                    replay.MapAndUnmap(pending);
+                }
+
+                pending = texture;
+            }
+
+            if (pending)
+            {
+                replay.MapAndUnmap(pending);
+            }
+
+            result.allocations = allocator.allocations;
+            results.push_back(result);
+        }
+
+        return results;
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+namespace MeasureToolBenchmark
+{
+    struct StagingRingResult
+    {
+        std::wstring name;
+        double copyLatencyMs = {};
+        size_t frames = {};
+        size_t allocations = {};
+        double totalStallMs = {};
+        double maxStallMs = {};
+        size_t reusedInFlight = {}; // textures handed out while still being copied to or mapped
+    };
+
+    // Replays a continuous capture against a fake staging texture backend with a simulated GPU copy latency.
+    // Compares allocating and mapping every frame right away, like the capture used to, with the staging ring
+    // and the pipelined readback, which maps a frame only once the next one has arrived.
+    std::vector<StagingRingResult> RunStagingRingBenchmark(size_t frames, double frameIntervalMs, double copyLatencyMs);
+}
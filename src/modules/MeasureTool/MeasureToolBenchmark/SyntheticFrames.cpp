@@ -0,0 +1,118 @@
+#include "pch.h"
+#include "SyntheticFrames.h"
+
+namespace
+{
+    constexpr size_t PitchAlignment = 64;
+
+    uint32_t Pixel(uint8_t b, uint8_t g, uint8_t r) noexcept
+    {
+        return 0xFF000000 | (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b;
+    }
+
+    void FillRect(MeasureToolBenchmark::SyntheticFrame& frame, size_t left, size_t top, size_t right, size_t bottom, uint32_t color) noexcept
+    {
+        right = std::min(right, frame.width);
+        bottom = std::min(bottom, frame.height);
+        if (left >= right || top >= bottom)
+        {
+            return;
+        }
+
+        for (size_t y = top; y < bottom; ++y)
+        {
+            std::fill(frame.pixels.begin() + y * frame.pitch + left, frame.pixels.begin() + y * frame.pitch + right, color);
+        }
+    }
+}
+
+namespace MeasureToolBenchmark
+{
+    const wchar_t* PatternName(FramePattern pattern) noexcept
+    {
+        switch (pattern)
+        {
+        case FramePattern::Gradient:
+            return L"gradient";
+        case FramePattern::Noise:
+            return L"noise";
+        case FramePattern::FlatUI:
+            return L"flat-ui";
+        default:
+            return L"unknown";
+        }
+    }
+
+    bool SameEdges(const RECT& a, const RECT& b) noexcept
+    {
+        return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+    }
+
+    BGRATextureView SyntheticFrame::View() const
+    {
+        BGRATextureView view;
+        view.pixels = pixels.data();
+        view.pitch = pitch;
+        view.width = width;
+        view.height = height;
+        return view;
+    }
+
+    SyntheticFrame GenerateFrame(FramePattern pattern, size_t width, size_t height, unsigned int seed)
+    {
+        SyntheticFrame frame;
+        frame.width = width;
+        frame.height = height;
+        frame.pitch = (width + PitchAlignment - 1) / PitchAlignment * PitchAlignment;
+        frame.pixels.resize(frame.pitch * height);
+
+        std::mt19937 random(seed);
+        switch (pattern)
+        {
+        case FramePattern::Gradient:
+            for (size_t y = 0; y < height; ++y)
+            {
+                for (size_t x = 0; x < frame.pitch; ++x)
+                {
+                    frame.pixels[y * frame.pitch + x] = Pixel(static_cast<uint8_t>(x / 7), static_cast<uint8_t>(y / 5), static_cast<uint8_t>((x + y) / 11));
+                }
+            }
+            break;
+        case FramePattern::Noise:
+            for (auto& pixel : frame.pixels)
+            {
+                pixel = random();
+            }
+            break;
+        case FramePattern::FlatUI:
+            FillRect(frame, 0, 0, frame.pitch, height, Pixel(0xF3, 0xF3, 0xF3));
+            for (int window = 0; window < 24; ++window)
+            {
+                const size_t left = random() % width;
+                const size_t top = random() % height;
+                const size_t right = left + 200 + random() % 1200;
+                const size_t bottom = top + 150 + random() % 800;
+                const uint8_t shade = static_cast<uint8_t>(0xC0 + random() % 0x40);
+
+                FillRect(frame, left, top, right, bottom, Pixel(0x80, 0x80, 0x80)); // border
+                FillRect(frame, left + 1, top + 1, right - 1, bottom - 1, Pixel(shade, shade, shade));
+                FillRect(frame, left + 1, top + 1, right - 1, top + 32, Pixel(0xD0, 0x78, 0x00)); // title bar
+
+                // Lines of "text"
+                for (size_t line = top + 48; line + 12 < bottom; line += 24)
+                {
+                    for (size_t glyph = left + 12; glyph + 8 < right; glyph += 10)
+                    {
+                        if (random() % 4 != 0)
+                        {
+                            FillRect(frame, glyph, line, glyph + 6, line + 10, Pixel(0x20, 0x20, 0x20));
+                        }
+                    }
+                }
+            }
+            break;
+        }
+
+        return frame;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <BGRATextureView.h>
+
+namespace MeasureToolBenchmark
+{
+    enum class FramePattern
+    {
+        Gradient, // smooth gradients, every pixel differs slightly from its neighbors
+        Noise, // random pixels, edges are found after a step or two
+        FlatUI, // large flat regions with borders and text-like details, the common case for screenshots
+    };
+
+    const wchar_t* PatternName(FramePattern pattern) noexcept;
+
+    // Compares detected edges, like EqualRect but on every platform
+    bool SameEdges(const RECT& a, const RECT& b) noexcept;
+
+    struct SyntheticFrame
+    {
+        size_t width = {};
+        size_t height = {};
+        size_t pitch = {}; // in pixels, wider than width like mapped staging textures usually are
+        std::vector<uint32_t> pixels;
+
+        BGRATextureView View() const;
+    };
+
+    SyntheticFrame GenerateFrame(FramePattern pattern, size_t width, size_t height, unsigned int seed);
+}
@@ -0,0 +1,137 @@
+#include "pch.h"
+#include "TextBoxCacheChecks.h"
+
+#include <TextBoxCache.h>
+
+namespace
+{
+    using namespace MeasureToolBenchmark;
+
+    CheckResult CheckEviction()
+    {
+        CheckResult result{ .name = L"LRU eviction" };
+        const auto check = [&](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        LruCache<int, int> cache{ 3 };
+        cache.Insert(1, 10);
+        cache.Insert(2, 20);
+        cache.Insert(3, 30);
+
+        // 1 becomes the most recently used one, so 2 is evicted first
+        check(cache.Find(1) && *cache.Find(1) == 10);
+        cache.Insert(4, 40);
+        check(cache.Size() == 3);
+        check(cache.Find(2) == nullptr);
+        check(cache.Find(1) && cache.Find(3) && cache.Find(4));
+
+        // Replacing a value doesn't evict anything
+        cache.Insert(3, 31);
+        check(cache.Size() == 3 && *cache.Find(3) == 31 && cache.Find(1) && cache.Find(4));
+
+        // Found values stay in place while other ones are added and evicted
+        const int* found = cache.Find(4);
+        cache.Insert(5, 50);
+        check(found == cache.Find(4) && *found == 40);
+
+        LruCache<int, int> single{ 0 };
+        single.Insert(1, 10);
+        single.Insert(2, 20);
+        check(single.Size() == 1 && single.Find(1) == nullptr && single.Find(2));
+
+        cache.Clear();
+        check(cache.Size() == 0 && cache.Find(4) == nullptr);
+        return result;
+    }
+
+    CheckResult CheckFindOrInsert()
+    {
+        CheckResult result{ .name = L"LRU FindOrInsert" };
+        const auto check = [&](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        LruCache<int, int> cache{ 2 };
+        size_t created = 0;
+        const auto make = [&created] { return static_cast<int>(++created); };
+
+        check(cache.FindOrInsert(1, make) == 1 && created == 1);
+        check(cache.FindOrInsert(1, make) == 1 && created == 1);
+        check(cache.FindOrInsert(2, make) == 2 && created == 2);
+        cache.FindOrInsert(1, make);
+        check(cache.FindOrInsert(3, make) == 3 && created == 3);
+        check(cache.Find(2) == nullptr && cache.Find(1));
+        return result;
+    }
+
+    CheckResult CheckTextLayoutKeys()
+    {
+        CheckResult result{ .name = L"Text layout keys" };
+        const auto check = [&](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        const TextLayoutKey key{ .text = L"1920 x 1080", .dpiScale = 1.f, .halfOpaqueSymbolPos = 5 };
+        const TextLayoutKeyHash hash;
+        check(key == TextLayoutKey{ key } && hash(key) == hash(TextLayoutKey{ key }));
+
+        auto otherText = key;
+        otherText.text = L"1920 x 1081";
+        auto otherScale = key;
+        otherScale.dpiScale = 1.5f;
+        auto noSymbol = key;
+        noSymbol.halfOpaqueSymbolPos.reset();
+        auto symbolAtZero = key;
+        symbolAtZero.halfOpaqueSymbolPos = 0;
+
+        LruCache<TextLayoutKey, int, TextLayoutKeyHash> cache{ 8 };
+        int value = 0;
+        for (const auto& k : { key, otherText, otherScale, noSymbol, symbolAtZero })
+        {
+            cache.Insert(k, value++);
+        }
+
+        check(cache.Size() == 5);
+        check(*cache.Find(key) == 0 && *cache.Find(otherScale) == 2 && *cache.Find(noSymbol) == 3 && *cache.Find(symbolAtZero) == 4);
+        return result;
+    }
+
+    CheckResult CheckShadowKeys()
+    {
+        CheckResult result{ .name = L"Shadow keys" };
+        const auto check = [&](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        const ShadowKey box{ .width = 96, .height = 24, .dpiScale = 1.f };
+        const ShadowKeyHash hash;
+        check(box == ShadowKey{ box } && hash(box) == hash(ShadowKey{ box }));
+
+        // The same box size on a monitor with another DPI has a different corner radius
+        auto scaled = box;
+        scaled.dpiScale = 1.25f;
+        auto transposed = box;
+        std::swap(transposed.width, transposed.height);
+
+        LruCache<ShadowKey, int, ShadowKeyHash> cache{ 8 };
+        cache.Insert(box, 0);
+        cache.Insert(scaled, 1);
+        cache.Insert(transposed, 2);
+        check(cache.Size() == 3);
+        check(*cache.Find(box) == 0 && *cache.Find(scaled) == 1 && *cache.Find(transposed) == 2);
+        return result;
+    }
+}
+
+namespace MeasureToolBenchmark
+{
+    std::vector<CheckResult> RunTextBoxCacheChecks()
+    {
+        return { CheckEviction(), CheckFindOrInsert(), CheckTextLayoutKeys(), CheckShadowKeys() };
+    }
+}
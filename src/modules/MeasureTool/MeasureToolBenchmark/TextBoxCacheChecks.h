@@ -0,0 +1,14 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+#include <vector>
+
+namespace MeasureToolBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Checks the eviction order of LruCache and the keys D2DState caches text layouts and shadows by, which don't
+    // need Direct2D
+    std::vector<CheckResult> RunTextBoxCacheChecks();
+}
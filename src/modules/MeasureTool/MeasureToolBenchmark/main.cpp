@@ -0,0 +1,261 @@
+#include "pch.h"
+
+#include <iostream>
+#include <string_view>
+
+#include "EdgeIndexBenchmark.h"
+#include "EdgeScanBenchmark.h"
+#include "ReplayBenchmark.h"
+#include "StagingRingBenchmark.h"
+#include "SyntheticFrames.h"
+#include "TextBoxCacheChecks.h"
+
+#include <EdgeIndex.h>
+
+using namespace MeasureToolBenchmark;
+
+namespace
+{
+    struct Options
+    {
+        // 4K and 8K by default
+        std::vector<std::pair<size_t, size_t>> resolutions = { { 3840, 2160 }, { 7680, 4320 } };
+        size_t queries = 20000;
+        size_t frames = 900;
+        unsigned int seed = 42;
+        std::optional<std::filesystem::path> cursorPath;
+    };
+
+    void PrintUsage()
+    {
+        std::wcout << L"Usage: MeasureToolBenchmark.exe [options]\n"
+                   << L"  --resolution <w>x<h>    synthetic frame size (default 3840x2160 and 7680x4320)\n"
+                   << L"  --queries <n>           edge detection queries per frame (default 20000)\n"
+                   << L"  --frames <n>            frames of the replayed continuous capture (default 900)\n"
+                   << L"  --seed <n>              random seed (default 42)\n"
+                   << L"  --cursor-path <file>    replayed cursor path, an \"x y\" line per frame (default generated)\n";
+    }
+
+    bool ParseOptions(int argc, wchar_t* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::wstring arg = argv[i];
+            if (i + 1 >= argc)
+            {
+                return false;
+            }
+
+            const std::wstring value = argv[++i];
+            try
+            {
+                if (arg == L"--resolution")
+                {
+                    const auto separator = value.find(L'x');
+                    if (separator == std::wstring::npos)
+                    {
+                        return false;
+                    }
+
+                    options.resolutions = { { std::stoull(value.substr(0, separator)), std::stoull(value.substr(separator + 1)) } };
+                }
+                else if (arg == L"--queries")
+                {
+                    options.queries = std::stoull(value);
+                }
+                else if (arg == L"--frames")
+                {
+                    options.frames = std::stoull(value);
+                }
+                else if (arg == L"--seed")
+                {
+                    options.seed = static_cast<unsigned int>(std::stoul(value));
+                }
+                else if (arg == L"--cursor-path")
+                {
+                    options.cursorPath = value;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+        }
+
+        // edge detection clamps the start point to [1, size - 2]
+        return std::all_of(options.resolutions.begin(), options.resolutions.end(), [](const auto& resolution) {
+                   return resolution.first >= 3 && resolution.second >= 3;
+               }) &&
+               options.queries > 0 && options.frames > 0;
+    }
+
+    int Run(int argc, wchar_t* argv[])
+    {
+        Options options;
+        if (!ParseOptions(argc, argv, options))
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        std::optional<CursorPath> recordedPath;
+        if (options.cursorPath)
+        {
+            recordedPath = LoadCursorPath(*options.cursorPath);
+            if (!recordedPath || recordedPath->empty())
+            {
+                std::wcerr << L"Couldn't read a cursor path from " << options.cursorPath->wstring() << L"\n";
+                return 1;
+            }
+        }
+
+        size_t failures = 0;
+        wprintf(L"Text box cache checks\n\n");
+        for (const auto& result : RunTextBoxCacheChecks())
+        {
+            wprintf(L"%-20ls %8zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        size_t mismatches = 0;
+        for (const auto& [width, height] : options.resolutions)
+        {
+            wprintf(L"\nEdge detection, %zux%zu frames, %zu queries\n\n", width, height, options.queries);
+            for (const auto pattern : { FramePattern::Gradient, FramePattern::Noise, FramePattern::FlatUI })
+            {
+                const auto frame = GenerateFrame(pattern, width, height, options.seed);
+                const auto results = RunEdgeScanBenchmark(frame, options.queries, options.seed);
+                const double baseline = results.front().seconds;
+
+                for (const auto& result : results)
+                {
+                    wprintf(L"%-10ls %-10ls %10.3f us/query %6.2fx %zu mismatches\n",
+                            PatternName(pattern),
+                            result.name.c_str(),
+                            result.seconds * 1e6 / result.queries,
+                            result.seconds > 0 ? baseline / result.seconds : 0.0,
+                            result.mismatches);
+                    mismatches += result.mismatches;
+                }
+            }
+
+            wprintf(L"\nEdge index, %zux%zu frames, at most %zu tiles of %zux%zu pixels\n\n", width, height, EdgeIndex::DefaultMaxTiles, EdgeIndex::TileSize, EdgeIndex::TileSize);
+            for (const auto pattern : { FramePattern::Gradient, FramePattern::Noise, FramePattern::FlatUI })
+            {
+                const auto frame = GenerateFrame(pattern, width, height, options.seed);
+                for (const auto& result : RunEdgeIndexBenchmark(frame, options.queries, options.seed))
+                {
+                    wprintf(L"%-10ls %-11ls tolerance %3u %8.3f ms/tile %5zu tiles %6.1f MiB peak %8.3f us/lookup %8.3f us/scan %zu mismatches\n",
+                            PatternName(pattern),
+                            result.perChannel ? L"per-channel" : L"sum",
+                            result.tolerance,
+                            result.tilesBuilt ? result.buildSeconds * 1e3 / result.tilesBuilt : 0.0,
+                            result.tilesBuilt,
+                            result.peakBytes / (1024.0 * 1024.0),
+                            result.lookupSeconds * 1e6 / result.queries,
+                            result.scanSeconds * 1e6 / result.queries,
+                            result.mismatches);
+                    mismatches += result.mismatches;
+                }
+            }
+
+            wprintf(L"\n");
+        }
+
+        // Copy latencies below, around and above the continuous capture frame duration
+        const double frameIntervalMs = 1000.0 / 90;
+        wprintf(L"Staging textures, %zu frames at 90 fps\n\n", options.frames);
+        for (const double copyLatencyMs : { 2.0, 8.0, 16.0 })
+        {
+            for (const auto& result : RunStagingRingBenchmark(options.frames, frameIntervalMs, copyLatencyMs))
+            {
+                wprintf(L"%-15ls copy %4.1f ms %8.3f allocs/frame %8.3f ms stall/frame %6.1f ms max stall %zu reused in flight\n",
+                        result.name.c_str(),
+                        result.copyLatencyMs,
+                        result.frames ? static_cast<double>(result.allocations) / result.frames : 0.0,
+                        result.frames ? result.totalStallMs / result.frames : 0.0,
+                        result.maxStallMs,
+                        result.reusedInFlight);
+            }
+        }
+
+        for (const auto& [width, height] : options.resolutions)
+        {
+            const auto frame = GenerateFrame(FramePattern::FlatUI, width, height, options.seed);
+            const auto path = recordedPath ? *recordedPath : GenerateCursorPath(width, height, options.frames, options.seed);
+            const auto result = RunReplayBenchmark(frame, path, options.seed);
+            wprintf(L"\nCursor path replay, %zux%zu, %zu frames\n\n", width, height, result.frames);
+            for (size_t i = 0; i < result.stages.size(); ++i)
+            {
+                const auto& stage = result.stages[i];
+                if (stage.recorded == 0)
+                {
+                    continue;
+                }
+
+                wprintf(L"%-10ls %8llu samples %10.3f us p50 %10.3f us p99\n",
+                        FrameStageName(static_cast<FrameStage>(i)),
+                        stage.recorded,
+                        stage.p50.count() / 1e3,
+                        stage.p99.count() / 1e3);
+            }
+
+            wprintf(L"\nTile hashes: %llu frames reused the edges, %llu rescanned changed edges, %llu scanned every edge\n",
+                    result.changes.skipped,
+                    result.changes.rescanned,
+                    result.changes.recomputed);
+            wprintf(L"%10.3f us/frame tracked %10.3f us/frame scanning every edge %zu mismatches\n",
+                    result.frames ? result.trackedSeconds * 1e6 / result.frames : 0.0,
+                    result.frames ? result.scanSeconds * 1e6 / result.frames : 0.0,
+                    result.mismatches);
+            mismatches += result.mismatches;
+        }
+
+        if (failures != 0)
+        {
+            std::wcerr << L"\n" << failures << L" text box cache checks failed\n";
+        }
+
+        if (mismatches != 0)
+        {
+            std::wcerr << L"\nEdge scanners returned " << mismatches << L" results different from the pixel-by-pixel walk or DetectEdges\n";
+        }
+
+        if (failures != 0 || mismatches != 0)
+        {
+            return 1;
+        }
+
+        return 0;
+    }
+}
+
+#ifdef _WIN32
+int wmain(int argc, wchar_t* argv[])
+{
+    return Run(argc, argv);
+}
+#else
+// The options are ASCII
+int main(int argc, char* argv[])
+{
+    std::vector<std::wstring> arguments;
+    for (int i = 0; i < argc; i++)
+    {
+        const std::string_view argument = argv[i];
+        arguments.emplace_back(argument.begin(), argument.end());
+    }
+
+    std::vector<wchar_t*> pointers;
+    for (auto& argument : arguments)
+    {
+        pointers.push_back(argument.data());
+    }
+
+    return Run(argc, pointers.data());
+}
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+
+#ifdef _WIN32
+#include <windows.h>
+#include <d3d11.h>
+#include <intrin.h>
+#include <winrt/base.h>
+#include <wil/resource.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
@@ -0,0 +1,13 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by MeasureToolBenchmark.rc
+
+//////////////////////////////
+// Non-localizable
+
+#define FILE_DESCRIPTION "PowerToys Measure Tool Benchmark"
+#define INTERNAL_NAME "MeasureToolBenchmark"
+#define ORIGINAL_FILENAME "MeasureToolBenchmark.exe"
+
+// Non-localizable
+//////////////////////////////
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <cinttypes>
-#include <wil/resource.h>
 #ifdef _M_ARM64
 #include <arm64_neon.h.>
 #else
@@ -9,7 +8,25 @@
 #endif
 #include <cassert>
 #include <limits>
-#include <d3d11.h>
+
+#if !defined(_WIN32)
+// The edge detection returns the Win32 rectangle, which windows.h defines on Windows
+using LONG = long;
+
+struct POINT
+{
+    LONG x;
+    LONG y;
+};
+
+struct RECT
+{
+    LONG left;
+    LONG top;
+    LONG right;
+    LONG bottom;
+};
+#endif
 
 
 //#define DEBUG_TEXTURE
@@ -64,11 +81,10 @@ inline __m128i _mm_cmpgt_epi16(__m128i a, __m128i b)
         vcgtq_s16(vreinterpretq_s16_s64(a), vreinterpretq_s16_s64(b)));
 }
 
-inline __m128i _mm_cvtepu8_epi16(__m128i a)
+inline __m128i _mm_unpacklo_epi8(__m128i a, __m128i b)
 {
-    uint8x16_t u8x16 = vreinterpretq_u8_s64(a); /* xxxx xxxx HGFE DCBA */
-    uint16x8_t u16x8 = vmovl_u8(vget_low_u8(u8x16)); /* 0H0G 0F0E 0D0C 0B0A */
-    return vreinterpretq_s64_u16(u16x8);
+    return vreinterpretq_s64_u8(
+        vzip1q_u8(vreinterpretq_u8_s64(a), vreinterpretq_u8_s64(b)));
 }
 
 inline int64_t _mm_cvtsi128_si64(__m128i a)
@@ -112,7 +128,8 @@ struct BGRATextureView
         if constexpr (perChannel)
         {
             const __m128i tolerances = _mm_set1_epi16(tolerance);
-            const auto gtResults128 = _mm_cmpgt_epi16(_mm_cvtepu8_epi16(distances), tolerances);
+            // Widen the channel distances to 16 bits with SSE2, _mm_cvtepu8_epi16 needs SSE4.1
+            const auto gtResults128 = _mm_cmpgt_epi16(_mm_unpacklo_epi8(distances, _mm_setzero_si128()), tolerances);
             return _mm_cvtsi128_si64(gtResults128) == 0;
         }
         else
@@ -127,43 +144,3 @@ struct BGRATextureView
     void SaveAsBitmap(const char* filename) const;
 #endif
 };
-
-class MappedTextureView
-{
-    winrt::com_ptr<ID3D11DeviceContext> context;
-    winrt::com_ptr<ID3D11Texture2D> texture;
-
-public:
-    BGRATextureView view;
-    MappedTextureView(winrt::com_ptr<ID3D11Texture2D> _texture,
-                      winrt::com_ptr<ID3D11DeviceContext> _context,
-                      const size_t textureWidth,
-                      const size_t textureHeight) :
-        texture{ std::move(_texture) }, context{ std::move(_context) }
-    {
-        D3D11_TEXTURE2D_DESC desc;
-        texture->GetDesc(&desc);
-
-        D3D11_MAPPED_SUBRESOURCE resource = {};
-        winrt::check_hresult(context->Map(texture.get(), D3D11CalcSubresource(0, 0, 0), D3D11_MAP_READ, 0, &resource));
-
-        view.pixels = static_cast<const uint32_t*>(resource.pData);
-        view.pitch = resource.RowPitch / 4;
-        view.width = textureWidth;
-        view.height = textureHeight;
-    }
-
-    MappedTextureView(MappedTextureView&&) = default;
-    MappedTextureView& operator=(MappedTextureView&&) = default;
-
-    inline winrt::com_ptr<ID3D11Texture2D> GetTexture() const
-    {
-        return texture;
-    }
-
-    ~MappedTextureView()
-    {
-        if (context && texture)
-            context->Unmap(texture.get(), D3D11CalcSubresource(0, 0, 0));
-    }
-};
\ No newline at end of file
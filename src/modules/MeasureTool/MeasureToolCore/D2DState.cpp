@@ -5,6 +5,7 @@
 #include "DxgiAPI.h"
 
 #include <common/Display/dpi_aware.h>
+#include <cmath>
 #include <ToolState.h>
 
 namespace
@@ -32,8 +33,6 @@ D2DState::D2DState(const DxgiAPI* dxgi,
 
     dxgiWindowState = dxgiAPI->CreateD2D1RenderTarget(window);
 
-    winrt::check_hresult(dxgiWindowState.rt->CreateCompatibleRenderTarget(bitmapRt.put()));
-
     winrt::check_hresult(dxgiAPI->writeFactory->CreateTextFormat(L"Segoe UI Variable Text",
                                                                  nullptr,
                                                                  DWRITE_FONT_WEIGHT_NORMAL,
@@ -57,40 +56,90 @@ D2DState::D2DState(const DxgiAPI* dxgi,
     winrt::check_hresult(shadowEffect->SetValue(D2D1_SHADOW_PROP_BLUR_STANDARD_DEVIATION, consts::SHADOW_RADIUS));
     winrt::check_hresult(shadowEffect->SetValue(D2D1_SHADOW_PROP_COLOR, D2D1::ColorF(0.f, 0.f, 0.f, consts::SHADOW_OPACITY)));
 
-    winrt::check_hresult(deviceContext->CreateEffect(CLSID_D2D12DAffineTransform, affineTransformEffect.put()));
-    affineTransformEffect->SetInputEffect(0, shadowEffect.get());
-
     textRenderer = winrt::make_self<PerGlyphOpacityTextRender>(dxgi->d2dFactory2, dxgiWindowState.rt, solidBrushes[Brush::foreground]);
 }
 
-void D2DState::DrawTextBox(const wchar_t* text,
-                           const size_t textLen,
-                           const std::optional<size_t> halfOpaqueSymbolPos,
-                           const D2D_POINT_2F center,
-                           const bool screenQuadrantAware,
-                           const HWND window) const
+CachedTextLayout D2DState::CreateTextLayout(const TextLayoutKey& key) const
 {
-    wil::com_ptr<IDWriteTextLayout> textLayout;
+    CachedTextLayout result;
     winrt::check_hresult(
-        dxgiAPI->writeFactory->CreateTextLayout(text,
-                                                static_cast<uint32_t>(textLen),
+        dxgiAPI->writeFactory->CreateTextLayout(key.text.c_str(),
+                                                static_cast<uint32_t>(key.text.size()),
                                                 textFormat.get(),
                                                 std::numeric_limits<float>::max(),
                                                 std::numeric_limits<float>::max(),
-                                                &textLayout));
+                                                &result.layout));
     DWRITE_TEXT_METRICS textMetrics = {};
-    winrt::check_hresult(textLayout->GetMetrics(&textMetrics));
+    winrt::check_hresult(result.layout->GetMetrics(&textMetrics));
     // Assumes text doesn't contain new lines
     const float lineHeight = textMetrics.height;
-    textMetrics.width += lineHeight;
-    textMetrics.height += lineHeight * .5f;
-    winrt::check_hresult(textLayout->SetMaxWidth(textMetrics.width));
-    winrt::check_hresult(textLayout->SetMaxHeight(textMetrics.height));
+    result.boxSize = { .width = static_cast<uint32_t>(std::ceil(textMetrics.width + lineHeight)),
+                       .height = static_cast<uint32_t>(std::ceil(textMetrics.height + lineHeight * .5f)),
+                       .dpiScale = key.dpiScale };
+    winrt::check_hresult(result.layout->SetMaxWidth(static_cast<float>(result.boxSize.width)));
+    winrt::check_hresult(result.layout->SetMaxHeight(static_cast<float>(result.boxSize.height)));
+
+    if (key.halfOpaqueSymbolPos.has_value())
+    {
+        DWRITE_TEXT_RANGE textRange = { static_cast<uint32_t>(*key.halfOpaqueSymbolPos), 2 };
+        auto opacityEffect = winrt::make_self<OpacityEffect>();
+        opacityEffect->alpha = consts::CROSS_OPACITY;
+        winrt::check_hresult(result.layout->SetDrawingEffect(opacityEffect.get(), textRange));
+    }
 
-    D2D1_RECT_F textRect{ .left = center.x - textMetrics.width / 2.f,
-                          .top = center.y - textMetrics.height / 2.f,
-                          .right = center.x + textMetrics.width / 2.f,
-                          .bottom = center.y + textMetrics.height / 2.f };
+    return result;
+}
+
+winrt::com_ptr<ID2D1Bitmap> D2DState::CreateShadowBitmap(const ShadowKey& boxSize) const
+{
+    // The blurred shadow extends 3 standard deviations past the box
+    const float margin = std::ceil(consts::SHADOW_RADIUS * 3.f);
+    const D2D1_SIZE_F bitmapSize{ .width = boxSize.width + margin * 2.f, .height = boxSize.height + margin * 2.f };
+
+    winrt::com_ptr<ID2D1BitmapRenderTarget> boxRt;
+    winrt::check_hresult(dxgiWindowState.rt->CreateCompatibleRenderTarget(bitmapSize, boxRt.put()));
+    const float radius = consts::TEXT_BOX_CORNER_RADIUS * boxSize.dpiScale;
+    boxRt->BeginDraw();
+    boxRt->Clear(D2D1::ColorF(0.f, 0.f, 0.f, 0.f));
+    boxRt->FillRoundedRectangle(D2D1::RoundedRect(D2D1::RectF(margin, margin, margin + boxSize.width, margin + boxSize.height),
+                                                  radius,
+                                                  radius),
+                                solidBrushes[Brush::border].get());
+    winrt::check_hresult(boxRt->EndDraw());
+
+    winrt::com_ptr<ID2D1Bitmap> boxBitmap;
+    winrt::check_hresult(boxRt->GetBitmap(boxBitmap.put()));
+    shadowEffect->SetInput(0, boxBitmap.get());
+
+    winrt::com_ptr<ID2D1BitmapRenderTarget> shadowRt;
+    winrt::check_hresult(dxgiWindowState.rt->CreateCompatibleRenderTarget(bitmapSize, shadowRt.put()));
+    shadowRt->BeginDraw();
+    shadowRt->Clear(D2D1::ColorF(0.f, 0.f, 0.f, 0.f));
+    shadowRt.as<ID2D1DeviceContext>()->DrawImage(shadowEffect.get(), D2D1_INTERPOLATION_MODE_LINEAR);
+    winrt::check_hresult(shadowRt->EndDraw());
+    shadowEffect->SetInput(0, nullptr);
+
+    winrt::com_ptr<ID2D1Bitmap> shadowBitmap;
+    winrt::check_hresult(shadowRt->GetBitmap(shadowBitmap.put()));
+    return shadowBitmap;
+}
+
+void D2DState::DrawTextBox(const wchar_t* text,
+                           const size_t textLen,
+                           const std::optional<size_t> halfOpaqueSymbolPos,
+                           const D2D_POINT_2F center,
+                           const bool screenQuadrantAware,
+                           const HWND window) const
+{
+    TextLayoutKey layoutKey{ .text = std::wstring{ text, textLen }, .dpiScale = dpiScale, .halfOpaqueSymbolPos = halfOpaqueSymbolPos };
+    const CachedTextLayout& textLayout = textLayouts.FindOrInsert(layoutKey, [&] { return CreateTextLayout(layoutKey); });
+    const float boxWidth = static_cast<float>(textLayout.boxSize.width);
+    const float boxHeight = static_cast<float>(textLayout.boxSize.height);
+
+    D2D1_RECT_F textRect{ .left = center.x - boxWidth / 2.f,
+                          .top = center.y - boxHeight / 2.f,
+                          .right = center.x + boxWidth / 2.f,
+                          .bottom = center.y + boxHeight / 2.f };
 
     const float SHADOW_OFFSET = consts::SHADOW_OFFSET * dpiScale;
     if (screenQuadrantAware)
@@ -102,8 +151,8 @@ void D2DState::DrawTextBox(const wchar_t* text,
                                 static_cast<long>(center.y),
                                 cursorInLeftScreenHalf,
                                 cursorInTopScreenHalf);
-        float textQuadrantOffsetX = textMetrics.width / 2.f + SHADOW_OFFSET;
-        float textQuadrantOffsetY = textMetrics.height / 2.f + SHADOW_OFFSET;
+        float textQuadrantOffsetX = boxWidth / 2.f + SHADOW_OFFSET;
+        float textQuadrantOffsetY = boxHeight / 2.f + SHADOW_OFFSET;
         if (!cursorInLeftScreenHalf)
             textQuadrantOffsetX *= -1.f;
         if (!cursorInTopScreenHalf)
@@ -115,28 +164,19 @@ void D2DState::DrawTextBox(const wchar_t* text,
     }
 
     // Draw shadow
-    bitmapRt->BeginDraw();
-    bitmapRt->Clear(D2D1::ColorF(0.f, 0.f, 0.f, 0.f));
-    D2D1_ROUNDED_RECT textBoxRect;
-    textBoxRect.radiusX = textBoxRect.radiusY = consts::TEXT_BOX_CORNER_RADIUS * dpiScale;
-    textBoxRect.rect.bottom = textRect.bottom;
-    textBoxRect.rect.top = textRect.top;
-    textBoxRect.rect.left = textRect.left;
-    textBoxRect.rect.right = textRect.right;
-    bitmapRt->FillRoundedRectangle(textBoxRect, solidBrushes[Brush::border].get());
-    bitmapRt->EndDraw();
-
-    wil::com_ptr<ID2D1Bitmap> rtBitmap;
-    bitmapRt->GetBitmap(&rtBitmap);
-
-    shadowEffect->SetInput(0, rtBitmap.get());
-    const auto shadowMatrix = D2D1::Matrix3x2F::Translation(SHADOW_OFFSET, SHADOW_OFFSET);
-    winrt::check_hresult(affineTransformEffect->SetValue(D2D1_2DAFFINETRANSFORM_PROP_TRANSFORM_MATRIX,
-                                                         shadowMatrix));
-    auto deviceContext = dxgiWindowState.rt.as<ID2D1DeviceContext>();
-    deviceContext->DrawImage(affineTransformEffect.get(), D2D1_INTERPOLATION_MODE_LINEAR);
+    const auto& shadowBitmap = shadowBitmaps.FindOrInsert(textLayout.boxSize, [&] { return CreateShadowBitmap(textLayout.boxSize); });
+    const D2D1_SIZE_F shadowSize = shadowBitmap->GetSize();
+    const float shadowLeft = textRect.left + SHADOW_OFFSET - (shadowSize.width - boxWidth) / 2.f;
+    const float shadowTop = textRect.top + SHADOW_OFFSET - (shadowSize.height - boxHeight) / 2.f;
+    dxgiWindowState.rt->DrawBitmap(shadowBitmap.get(),
+                                   D2D1::RectF(shadowLeft, shadowTop, shadowLeft + shadowSize.width, shadowTop + shadowSize.height),
+                                   1.f,
+                                   D2D1_BITMAP_INTERPOLATION_MODE_LINEAR);
 
     // Draw text box border rectangle
+    D2D1_ROUNDED_RECT textBoxRect;
+    textBoxRect.radiusX = textBoxRect.radiusY = consts::TEXT_BOX_CORNER_RADIUS * dpiScale;
+    textBoxRect.rect = textRect;
     dxgiWindowState.rt->DrawRoundedRectangle(textBoxRect, solidBrushes[Brush::border].get());
     const float TEXT_BOX_PADDING = 1.f * dpiScale;
     textBoxRect.rect.bottom -= TEXT_BOX_PADDING;
@@ -146,15 +186,7 @@ void D2DState::DrawTextBox(const wchar_t* text,
 
     // Draw text & its box
     dxgiWindowState.rt->FillRoundedRectangle(textBoxRect, solidBrushes[Brush::background].get());
-
-    if (halfOpaqueSymbolPos.has_value())
-    {
-        DWRITE_TEXT_RANGE textRange = { static_cast<uint32_t>(*halfOpaqueSymbolPos), 2 };
-        auto opacityEffect = winrt::make_self<OpacityEffect>();
-        opacityEffect->alpha = consts::CROSS_OPACITY;
-        winrt::check_hresult(textLayout->SetDrawingEffect(opacityEffect.get(), textRange));
-    }
-    winrt::check_hresult(textLayout->Draw(nullptr, textRenderer.get(), textRect.left, textRect.top));
+    winrt::check_hresult(textLayout.layout->Draw(nullptr, textRenderer.get(), textRect.left, textRect.top));
 }
 
 void D2DState::ToggleAliasedLinesMode(const bool enabled) const
@@ -5,8 +5,10 @@
 
 #include <windef.h>
 
+#include "constants.h"
 #include "DxgiAPI.h"
 #include "PerGlyphOpacityTextRender.h"
+#include "TextBoxCache.h"
 
 enum Brush : size_t
 {
@@ -16,17 +18,26 @@ enum Brush : size_t
     border
 };
 
+struct CachedTextLayout
+{
+    wil::com_ptr<IDWriteTextLayout> layout;
+    // Size of the box around the text, in whole pixels
+    ShadowKey boxSize;
+};
+
 struct D2DState
 {
     const DxgiAPI* dxgiAPI = nullptr;
 
     DxgiWindowState dxgiWindowState;
-    winrt::com_ptr<ID2D1BitmapRenderTarget> bitmapRt;
     winrt::com_ptr<IDWriteTextFormat> textFormat;
     winrt::com_ptr<PerGlyphOpacityTextRender> textRenderer;
     std::vector<winrt::com_ptr<ID2D1SolidColorBrush>> solidBrushes;
     winrt::com_ptr<ID2D1Effect> shadowEffect;
-    winrt::com_ptr<ID2D1Effect> affineTransformEffect;
+
+    // Labels rarely change between frames, so their layouts and shadows are only created once
+    mutable LruCache<TextLayoutKey, CachedTextLayout, TextLayoutKeyHash> textLayouts{ consts::TEXT_LAYOUT_CACHE_SIZE };
+    mutable LruCache<ShadowKey, winrt::com_ptr<ID2D1Bitmap>, ShadowKeyHash> shadowBitmaps{ consts::SHADOW_CACHE_SIZE };
 
     float dpiScale = 1.f;
 
@@ -40,4 +51,8 @@ struct D2DState
                      const bool screenQuadrantAware,
                      const HWND window) const;
     void ToggleAliasedLinesMode(const bool enabled) const;
+
+private:
+    CachedTextLayout CreateTextLayout(const TextLayoutKey& key) const;
+    winrt::com_ptr<ID2D1Bitmap> CreateShadowBitmap(const ShadowKey& boxSize) const;
 };
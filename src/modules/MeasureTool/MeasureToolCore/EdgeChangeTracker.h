@@ -0,0 +1,188 @@
+#pragma once
+
+#include "BGRATextureView.h"
+#include "EdgeDetection.h"
+
+#include <algorithm>
+#include <vector>
+
+// Edges of the frames of a continuous capture, scanned again only where the frames have changed.
+// The row and the column through the cursor are split into tiles of TileSize pixels. Once the cursor rests, the tiles
+// an edge depends on, from the start pixel to the pixel past the edge which stopped the scan, are hashed on every
+// frame. While the cursor and the settings stay the same, the edges of a frame whose tiles didn't change are the ones
+// of the previous frame, and only the edges with a changed tile are scanned again. Only the pixels of a tile on the
+// scan line are hashed, since the rest of the tile doesn't affect the edges.
+// Not thread safe.
+class EdgeChangeTracker
+{
+public:
+    static constexpr size_t TileSize = 64;
+
+    struct Statistics
+    {
+        uint64_t skipped = {}; // frames which reused the previous edges
+        uint64_t rescanned = {}; // frames which scanned only the edges with a changed tile
+        uint64_t recomputed = {}; // frames which scanned every edge, since the cursor or the settings changed or the tiles weren't hashed yet
+    };
+
+private:
+    // Hashes of the tiles of a scan line, valid for the tiles [first, last]
+    struct LineTiles
+    {
+        std::vector<uint64_t> hashes;
+        size_t first = {};
+        size_t last = {};
+
+        // FNV-1a over whole pixels, so a single changed pixel always changes the hash
+        static uint64_t HashTile(const uint32_t* line, const ptrdiff_t stride, const size_t length, const size_t tile)
+        {
+            const size_t end = std::min((tile + 1) * TileSize, length);
+            uint64_t hash = 14695981039346656037ull;
+            for (size_t i = tile * TileSize; i < end; ++i)
+            {
+                hash = (hash ^ line[static_cast<ptrdiff_t>(i) * stride]) * 1099511628211ull;
+            }
+
+            return hash;
+        }
+
+        // Hashes the tiles between the pixels past both edges. Tiles which are already hashed are kept unless rehashAll.
+        void Cover(const uint32_t* line, const ptrdiff_t stride, const size_t length, const long decreasingEdge, const long increasingEdge, const bool rehashAll)
+        {
+            hashes.resize((length + TileSize - 1) / TileSize);
+            const size_t newFirst = static_cast<size_t>(std::max<long>(decreasingEdge - 1, 0)) / TileSize;
+            const size_t newLast = std::min(static_cast<size_t>(increasingEdge) + 1, length - 1) / TileSize;
+            for (size_t tile = newFirst; tile <= newLast; ++tile)
+            {
+                if (rehashAll || tile < first || tile > last)
+                {
+                    hashes[tile] = HashTile(line, stride, length, tile);
+                }
+            }
+
+            first = newFirst;
+            last = newLast;
+        }
+
+        // Hashes the tiles again and returns whether a tile up to or from the tile of the start pixel has changed
+        std::pair<bool, bool> Update(const uint32_t* line, const ptrdiff_t stride, const size_t length, const size_t start)
+        {
+            const size_t startTile = start / TileSize;
+            bool decreasingChanged = false;
+            bool increasingChanged = false;
+            for (size_t tile = first; tile <= last; ++tile)
+            {
+                const uint64_t hash = HashTile(line, stride, length, tile);
+                if (hash != hashes[tile])
+                {
+                    hashes[tile] = hash;
+                    decreasingChanged |= tile <= startTile;
+                    increasingChanged |= tile >= startTile;
+                }
+            }
+
+            return { decreasingChanged, increasingChanged };
+        }
+    };
+
+    bool valid = false;
+    size_t restingFrames = {}; // frames since the cursor or the settings changed, up to the first compared one
+    POINT start = {};
+    bool perChannel = {};
+    uint8_t tolerance = {};
+    size_t width = {};
+    size_t height = {};
+    RECT edges = {};
+    LineTiles row;
+    LineTiles column;
+    Statistics stats;
+
+    template<bool PerChannel>
+    RECT DetectEdgesInternal(const BGRATextureView& texture, const POINT centerPoint, const uint8_t newTolerance)
+    {
+        static const ScanFunction scan = GetScanFunction<PerChannel>(BestScanInstructionSet());
+
+        // FindEdge starts from the same clamped pixel
+        const POINT newStart{ std::clamp<LONG>(centerPoint.x, 1, static_cast<LONG>(texture.width) - 2),
+                              std::clamp<LONG>(centerPoint.y, 1, static_cast<LONG>(texture.height) - 2) };
+        const uint32_t* rowPixels = texture.pixels + texture.pitch * newStart.y;
+        const uint32_t* columnPixels = texture.pixels + newStart.x;
+        const ptrdiff_t pitch = static_cast<ptrdiff_t>(texture.pitch);
+
+        if (!valid || newStart.x != start.x || newStart.y != start.y || PerChannel != perChannel || newTolerance != tolerance ||
+            texture.width != width || texture.height != height)
+        {
+            valid = true;
+            restingFrames = 0;
+            start = newStart;
+            perChannel = PerChannel;
+            tolerance = newTolerance;
+            width = texture.width;
+            height = texture.height;
+        }
+
+        // Hashing costs more than scanning, so tiles are only hashed once the cursor rests
+        if (restingFrames < 2)
+        {
+            edges = RECT{ .left = FindEdge<PerChannel, true, false>(texture, start, tolerance, scan),
+                          .top = FindEdge<PerChannel, false, false>(texture, start, tolerance, scan),
+                          .right = FindEdge<PerChannel, true, true>(texture, start, tolerance, scan),
+                          .bottom = FindEdge<PerChannel, false, true>(texture, start, tolerance, scan) };
+            if (restingFrames++ == 1)
+            {
+                row.Cover(rowPixels, 1, texture.width, edges.left, edges.right, true);
+                column.Cover(columnPixels, pitch, texture.height, edges.top, edges.bottom, true);
+            }
+
+            stats.recomputed++;
+            return edges;
+        }
+
+        const auto [leftChanged, rightChanged] = row.Update(rowPixels, 1, texture.width, start.x);
+        const auto [topChanged, bottomChanged] = column.Update(columnPixels, pitch, texture.height, start.y);
+        if (!leftChanged && !rightChanged && !topChanged && !bottomChanged)
+        {
+            stats.skipped++;
+            return edges;
+        }
+
+        if (leftChanged)
+        {
+            edges.left = FindEdge<PerChannel, true, false>(texture, start, tolerance, scan);
+        }
+
+        if (rightChanged)
+        {
+            edges.right = FindEdge<PerChannel, true, true>(texture, start, tolerance, scan);
+        }
+
+        if (topChanged)
+        {
+            edges.top = FindEdge<PerChannel, false, false>(texture, start, tolerance, scan);
+        }
+
+        if (bottomChanged)
+        {
+            edges.bottom = FindEdge<PerChannel, false, true>(texture, start, tolerance, scan);
+        }
+
+        // The edges may have moved on to tiles which weren't hashed
+        row.Cover(rowPixels, 1, texture.width, edges.left, edges.right, false);
+        column.Cover(columnPixels, pitch, texture.height, edges.top, edges.bottom, false);
+        stats.rescanned++;
+        return edges;
+    }
+
+public:
+    // Returns the same result as DetectEdges for the texture
+    RECT DetectEdges(const BGRATextureView& texture, const POINT centerPoint, const bool perChannel, const uint8_t tolerance)
+    {
+        return perChannel ? DetectEdgesInternal<true>(texture, centerPoint, tolerance) :
+                            DetectEdgesInternal<false>(texture, centerPoint, tolerance);
+    }
+
+    const Statistics& Stats() const
+    {
+        return stats;
+    }
+};
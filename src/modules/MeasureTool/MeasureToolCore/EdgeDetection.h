@@ -1,8 +1,39 @@
 #pragma once
 
 #include "BGRATextureView.h"
+#include "EdgeScanner.h"
 
 RECT DetectEdges(const BGRATextureView& texture,
                  const POINT centerPoint,
                  const bool perChannel,
-                 const uint8_t tolerance);
\ No newline at end of file
+                 const uint8_t tolerance);
+
+// Returns the last pixel in the given direction from centerPoint which is still close to the pixel at centerPoint
+template<bool PerChannel,
+         bool IsX,
+         bool Increment>
+inline long FindEdge(const BGRATextureView& texture, const POINT centerPoint, const uint8_t tolerance, const ScanFunction scan)
+{
+    const long maxDim = static_cast<long>(IsX ? texture.width : texture.height);
+
+    long x = std::clamp<long>(centerPoint.x, 1, static_cast<long>(texture.width - 2));
+    long y = std::clamp<long>(centerPoint.y, 1, static_cast<long>(texture.height - 2));
+
+    const uint32_t startPixel = texture.GetPixel(x, y);
+    const long start = IsX ? x : y;
+
+    // Pixels are compared up to the last one when incrementing, and down to 1 when decrementing
+    const size_t count = Increment ? maxDim - 1 - start : start - 1;
+    const ptrdiff_t step = IsX ? 1 : static_cast<ptrdiff_t>(texture.pitch);
+    const ptrdiff_t stride = Increment ? step : -step;
+
+    const uint32_t* first = texture.pixels + x + texture.pitch * y + stride;
+    const size_t closePixels = scan(first, stride, count, startPixel, tolerance);
+    if (closePixels < count)
+    {
+        // The edge is the last pixel that is still close to the start pixel
+        return Increment ? start + static_cast<long>(closePixels) : start - static_cast<long>(closePixels);
+    }
+
+    return Increment ? maxDim - 1 : 0;
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "BGRATextureView.h"
+#include "EdgeScanner.h"
+
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Edges of the pixels of a frame, turning DetectEdges into a lookup for frames which don't change, i.e. when the
+// screen is captured once instead of continuously.
+// Edges are indexed lazily in square tiles, for the tolerance and edge detection mode of the query, so a tolerance
+// change only costs the tiles the cursor visits afterwards. The number of tiles is capped and the least recently used
+// tile is dropped first, so the memory doesn't grow with the monitor resolution.
+// Not thread safe. BuildTile only reads the texture, so tiles can be built without holding the lock of the index.
+class EdgeIndex
+{
+public:
+    static constexpr size_t TileSize = 64;
+    // A tile takes 32 KiB, so the default cap is 16 MiB per monitor
+    static constexpr size_t DefaultMaxTiles = 512;
+    // Texture dimensions can't exceed D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION, so 16 bits are enough for a coordinate
+    static constexpr size_t MaxDimension = std::numeric_limits<uint16_t>::max();
+
+    struct TileKey
+    {
+        uint16_t tileX = {};
+        uint16_t tileY = {};
+        uint8_t tolerance = {};
+        bool perChannel = {};
+
+        bool operator==(const TileKey&) const = default;
+    };
+
+    struct Tile
+    {
+        // Horizontal edges are stored by rows, vertical ones by columns, so every line of the tile is written
+        // sequentially. Entries of pixels FindEdge never starts from are left at 0.
+        std::vector<uint16_t> edges;
+        uint64_t lastUsed = {};
+
+        uint16_t* Left() { return edges.data(); }
+        uint16_t* Right() { return edges.data() + TileSize * TileSize; }
+        uint16_t* Top() { return edges.data() + 2 * TileSize * TileSize; }
+        uint16_t* Bottom() { return edges.data() + 3 * TileSize * TileSize; }
+    };
+
+private:
+    const BGRATextureView& texture;
+    const size_t maxTiles;
+
+    std::unordered_map<uint64_t, Tile> tiles;
+    uint64_t useCounter = {};
+
+    static uint64_t Pack(const TileKey& key)
+    {
+        return uint64_t{ key.tileX } | uint64_t{ key.tileY } << 16 | uint64_t{ key.tolerance } << 32 |
+               uint64_t{ key.perChannel } << 40;
+    }
+
+    // Stores the edges FindEdge returns for the start positions [begin, end) of a line at [start - begin].
+    // Start positions are clamped to [1, length - 2] by FindEdge, so the first and the last pixels are skipped.
+    static void IndexLine(const uint32_t* line,
+                          const ptrdiff_t stride,
+                          const size_t length,
+                          const size_t begin,
+                          const size_t end,
+                          const uint8_t tolerance,
+                          const ScanFunction scan,
+                          uint16_t* decreasingEdges,
+                          uint16_t* increasingEdges)
+    {
+        const size_t first = std::max<size_t>(begin, 1);
+        const size_t last = std::min(end, length - 1);
+
+        // Every pixel is close to every other one, which would otherwise cost a scan of the whole line per pixel
+        if (tolerance == std::numeric_limits<uint8_t>::max())
+        {
+            for (size_t start = first; start < last; ++start)
+            {
+                decreasingEdges[start - begin] = 0;
+                increasingEdges[start - begin] = static_cast<uint16_t>(length - 1);
+            }
+            return;
+        }
+
+        for (size_t start = first; start < last; ++start)
+        {
+            const uint32_t pixel = line[static_cast<ptrdiff_t>(start) * stride];
+
+            // Every pixel of a run of identical pixels compares the same pixels against the same color
+            if (start > first && pixel == line[static_cast<ptrdiff_t>(start - 1) * stride])
+            {
+                decreasingEdges[start - begin] = decreasingEdges[start - 1 - begin];
+                increasingEdges[start - begin] = increasingEdges[start - 1 - begin];
+                continue;
+            }
+
+            // The pixel 0 is never compared, so a whole line of close pixels ends at 0 instead of 1
+            const size_t before = start - 1;
+            const size_t closeBefore = scan(line + static_cast<ptrdiff_t>(start - 1) * stride, -stride, before, pixel, tolerance);
+            decreasingEdges[start - begin] = static_cast<uint16_t>(closeBefore < before ? start - closeBefore : 0);
+
+            const size_t after = length - 1 - start;
+            increasingEdges[start - begin] = static_cast<uint16_t>(start + scan(line + static_cast<ptrdiff_t>(start + 1) * stride, stride, after, pixel, tolerance));
+        }
+    }
+
+public:
+    explicit EdgeIndex(const BGRATextureView& texture, const size_t maxTiles = DefaultMaxTiles) :
+        texture{ texture }, maxTiles{ std::max<size_t>(maxTiles, 1) }
+    {
+    }
+
+    // FindEdge needs at least 3 pixels to clamp the start position
+    inline bool CanIndex() const
+    {
+        return texture.width >= 3 && texture.height >= 3 && texture.width <= MaxDimension && texture.height <= MaxDimension;
+    }
+
+    // The tile FindEdge reads the edges of centerPoint from, after clamping it like FindEdge does
+    inline TileKey KeyFor(const POINT centerPoint, const bool perChannel, const uint8_t tolerance) const
+    {
+        const size_t x = std::clamp<long>(centerPoint.x, 1, static_cast<long>(texture.width - 2));
+        const size_t y = std::clamp<long>(centerPoint.y, 1, static_cast<long>(texture.height - 2));
+        return TileKey{ .tileX = static_cast<uint16_t>(x / TileSize),
+                        .tileY = static_cast<uint16_t>(y / TileSize),
+                        .tolerance = tolerance,
+                        .perChannel = perChannel };
+    }
+
+    // Whether the key addresses a tile of the texture
+    inline bool IsValid(const TileKey& key) const
+    {
+        return key.tileX * TileSize < texture.width && key.tileY * TileSize < texture.height;
+    }
+
+    inline bool Contains(const TileKey& key) const
+    {
+        return tiles.contains(Pack(key));
+    }
+
+    inline size_t TileCount() const
+    {
+        return tiles.size();
+    }
+
+    inline size_t MemoryUsage() const
+    {
+        return tiles.size() * 4 * TileSize * TileSize * sizeof(uint16_t);
+    }
+
+    // Returns the same result as DetectEdges for the texture, or nothing while the tile isn't indexed for these settings
+    inline std::optional<RECT> TryDetectEdges(const POINT centerPoint, const bool perChannel, const uint8_t tolerance)
+    {
+        if (!CanIndex())
+        {
+            return std::nullopt;
+        }
+
+        const auto key = KeyFor(centerPoint, perChannel, tolerance);
+        const auto it = tiles.find(Pack(key));
+        if (it == tiles.end())
+        {
+            return std::nullopt;
+        }
+
+        Tile& tile = it->second;
+        tile.lastUsed = ++useCounter;
+
+        const size_t x = std::clamp<long>(centerPoint.x, 1, static_cast<long>(texture.width - 2)) - key.tileX * TileSize;
+        const size_t y = std::clamp<long>(centerPoint.y, 1, static_cast<long>(texture.height - 2)) - key.tileY * TileSize;
+        const size_t row = x + TileSize * y;
+        const size_t column = y + TileSize * x;
+        return RECT{ .left = tile.Left()[row],
+                     .top = tile.Top()[column],
+                     .right = tile.Right()[row],
+                     .bottom = tile.Bottom()[column] };
+    }
+
+    // Indexes the rows and columns of the tile, scanning as far out of the tile as FindEdge does
+    static Tile BuildTile(const BGRATextureView& texture, const TileKey& key)
+    {
+        const ScanFunction scan = key.perChannel ? GetScanFunction<true>(BestScanInstructionSet()) :
+                                                   GetScanFunction<false>(BestScanInstructionSet());
+
+        Tile tile;
+        tile.edges.resize(4 * TileSize * TileSize);
+
+        const size_t left = key.tileX * TileSize;
+        const size_t top = key.tileY * TileSize;
+        const size_t right = std::min(left + TileSize, texture.width);
+        const size_t bottom = std::min(top + TileSize, texture.height);
+
+        for (size_t y = top; y < bottom; ++y)
+        {
+            const size_t offset = (y - top) * TileSize;
+            IndexLine(texture.pixels + y * texture.pitch, 1, texture.width, left, right, key.tolerance, scan, tile.Left() + offset, tile.Right() + offset);
+        }
+
+        for (size_t x = left; x < right; ++x)
+        {
+            const size_t offset = (x - left) * TileSize;
+            IndexLine(texture.pixels + x, static_cast<ptrdiff_t>(texture.pitch), texture.height, top, bottom, key.tolerance, scan, tile.Top() + offset, tile.Bottom() + offset);
+        }
+
+        return tile;
+    }
+
+    // Adds a tile built by BuildTile, dropping the least recently used one when the index is full
+    void Insert(const TileKey& key, Tile tile)
+    {
+        const uint64_t packed = Pack(key);
+        if (!tiles.contains(packed) && tiles.size() >= maxTiles)
+        {
+            const auto oldest = std::min_element(tiles.begin(), tiles.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.second.lastUsed < rhs.second.lastUsed;
+            });
+            tiles.erase(oldest);
+        }
+
+        tile.lastUsed = ++useCounter;
+        tiles.insert_or_assign(packed, std::move(tile));
+    }
+
+    void IndexTile(const TileKey& key)
+    {
+        Insert(key, BuildTile(texture, key));
+    }
+};
@@ -0,0 +1,312 @@
+#pragma once
+
+#include "BGRATextureView.h"
+
+#include <bit>
+
+#if defined(_M_ARM64)
+#include <arm64_neon.h>
+#else
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// Scans `count` pixels, starting at `first` and moving by `stride` pixels, and returns how many leading pixels
+// are close to `reference` according to BGRATextureView::PixelsClose. Vectorized variants compare several pixels
+// per step, but must return exactly the same result as the scalar one.
+using ScanFunction = size_t (*)(const uint32_t* first, ptrdiff_t stride, size_t count, uint32_t reference, uint8_t tolerance);
+
+enum class ScanInstructionSet
+{
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON,
+};
+
+template<bool PerChannel>
+inline size_t CountClosePixelsScalar(const uint32_t* first, const ptrdiff_t stride, const size_t count, const uint32_t reference, const uint8_t tolerance)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!BGRATextureView::PixelsClose<PerChannel>(reference, first[static_cast<ptrdiff_t>(i) * stride], tolerance))
+        {
+            return i;
+        }
+    }
+
+    return count;
+}
+
+#if !defined(_M_ARM64)
+
+// MSVC compiles AVX2 intrinsics in any function, GCC and Clang only in functions targeting AVX2
+#if defined(_MSC_VER)
+#define AVX2_FUNCTION
+#else
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+
+// Returns all-ones in every 32-bit lane whose pixel isn't close to the reference pixel
+template<bool PerChannel>
+inline __m128i FarPixelsSSE2(const __m128i pixels, const __m128i reference, const uint8_t tolerance)
+{
+    const __m128i distances = distance_epu8(pixels, reference);
+    if constexpr (PerChannel)
+    {
+        const __m128i exceeded = _mm_subs_epu8(distances, _mm_set1_epi8(static_cast<char>(tolerance)));
+        return _mm_xor_si128(_mm_cmpeq_epi32(exceeded, _mm_setzero_si128()), _mm_set1_epi32(-1));
+    }
+    else
+    {
+        // Sum the 4 channel distances of every pixel, truncated to 8 bits like PixelsClose does
+        const __m128i lowBytes = _mm_set1_epi32(0x00FF00FF);
+        const __m128i pairs = _mm_add_epi32(_mm_and_si128(distances, lowBytes), _mm_and_si128(_mm_srli_epi32(distances, 8), lowBytes));
+        const __m128i sums = _mm_add_epi32(pairs, _mm_srli_epi32(pairs, 16));
+        const __m128i scores = _mm_and_si128(sums, _mm_set1_epi32(std::numeric_limits<uint8_t>::max()));
+        return _mm_cmpgt_epi32(scores, _mm_set1_epi32(tolerance));
+    }
+}
+
+template<bool PerChannel>
+inline size_t CountClosePixelsSSE2(const uint32_t* first, const ptrdiff_t stride, const size_t count, const uint32_t reference, const uint8_t tolerance)
+{
+    constexpr size_t step = 4;
+    const __m128i referencePixels = _mm_set1_epi32(static_cast<int>(reference));
+
+    size_t i = 0;
+    for (; i + step <= count; i += step)
+    {
+        const uint32_t* block = first + static_cast<ptrdiff_t>(i) * stride;
+
+        // Lane N always holds the Nth pixel in the scan order
+        __m128i pixels;
+        if (stride == 1)
+        {
+            pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+        }
+        else if (stride == -1)
+        {
+            pixels = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block - 3)), _MM_SHUFFLE(0, 1, 2, 3));
+        }
+        else
+        {
+            pixels = _mm_set_epi32(static_cast<int>(block[3 * stride]),
+                                   static_cast<int>(block[2 * stride]),
+                                   static_cast<int>(block[stride]),
+                                   static_cast<int>(block[0]));
+        }
+
+        const unsigned farMask = _mm_movemask_ps(_mm_castsi128_ps(FarPixelsSSE2<PerChannel>(pixels, referencePixels, tolerance)));
+        if (farMask != 0)
+        {
+            return i + std::countr_zero(farMask);
+        }
+    }
+
+    return i + CountClosePixelsScalar<PerChannel>(first + static_cast<ptrdiff_t>(i) * stride, stride, count - i, reference, tolerance);
+}
+
+template<bool PerChannel>
+AVX2_FUNCTION inline __m256i FarPixelsAVX2(const __m256i pixels, const __m256i reference, const uint8_t tolerance)
+{
+    const __m256i distances = _mm256_or_si256(_mm256_subs_epu8(pixels, reference), _mm256_subs_epu8(reference, pixels));
+    if constexpr (PerChannel)
+    {
+        const __m256i exceeded = _mm256_subs_epu8(distances, _mm256_set1_epi8(static_cast<char>(tolerance)));
+        return _mm256_xor_si256(_mm256_cmpeq_epi32(exceeded, _mm256_setzero_si256()), _mm256_set1_epi32(-1));
+    }
+    else
+    {
+        const __m256i lowBytes = _mm256_set1_epi32(0x00FF00FF);
+        const __m256i pairs = _mm256_add_epi32(_mm256_and_si256(distances, lowBytes), _mm256_and_si256(_mm256_srli_epi32(distances, 8), lowBytes));
+        const __m256i sums = _mm256_add_epi32(pairs, _mm256_srli_epi32(pairs, 16));
+        const __m256i scores = _mm256_and_si256(sums, _mm256_set1_epi32(std::numeric_limits<uint8_t>::max()));
+        return _mm256_cmpgt_epi32(scores, _mm256_set1_epi32(tolerance));
+    }
+}
+
+template<bool PerChannel>
+AVX2_FUNCTION inline size_t CountClosePixelsAVX2(const uint32_t* first, const ptrdiff_t stride, const size_t count, const uint32_t reference, const uint8_t tolerance)
+{
+    constexpr size_t step = 8;
+    const __m256i referencePixels = _mm256_set1_epi32(static_cast<int>(reference));
+    const __m256i reversed = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const int s = static_cast<int>(stride);
+    const __m256i offsets = _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+
+    size_t i = 0;
+    for (; i + step <= count; i += step)
+    {
+        const uint32_t* block = first + static_cast<ptrdiff_t>(i) * stride;
+
+        __m256i pixels;
+        if (stride == 1)
+        {
+            pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+        }
+        else if (stride == -1)
+        {
+            pixels = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block - 7)), reversed);
+        }
+        else
+        {
+            pixels = _mm256_i32gather_epi32(reinterpret_cast<const int*>(block), offsets, sizeof(uint32_t));
+        }
+
+        const unsigned farMask = _mm256_movemask_ps(_mm256_castsi256_ps(FarPixelsAVX2<PerChannel>(pixels, referencePixels, tolerance)));
+        if (farMask != 0)
+        {
+            return i + std::countr_zero(farMask);
+        }
+    }
+
+    return i + CountClosePixelsSSE2<PerChannel>(first + static_cast<ptrdiff_t>(i) * stride, stride, count - i, reference, tolerance);
+}
+
+#if defined(_MSC_VER)
+inline void CpuId(int info[4], const int leaf)
+{
+    __cpuidex(info, leaf, 0);
+}
+
+inline uint64_t EnabledXStateFeatures()
+{
+    return _xgetbv(0);
+}
+#else
+inline void CpuId(int info[4], const int leaf)
+{
+    unsigned int registers[4] = {};
+    __cpuid_count(leaf, 0, registers[0], registers[1], registers[2], registers[3]);
+    for (int i = 0; i < 4; ++i)
+    {
+        info[i] = static_cast<int>(registers[i]);
+    }
+}
+
+inline uint64_t EnabledXStateFeatures()
+{
+    uint32_t low, high;
+    __asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return (static_cast<uint64_t>(high) << 32) | low;
+}
+#endif
+
+inline bool IsAVX2Supported()
+{
+    int info[4] = {};
+    CpuId(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    // AVX must be enabled by the OS as well, otherwise YMM registers aren't preserved across context switches
+    CpuId(info, 1);
+    const bool osxsave = info[2] & (1 << 27);
+    const bool avx = info[2] & (1 << 28);
+    if (!osxsave || !avx || (EnabledXStateFeatures() & 0x6) != 0x6)
+    {
+        return false;
+    }
+
+    CpuId(info, 7);
+    return info[1] & (1 << 5);
+}
+
+#else
+
+template<bool PerChannel>
+inline uint32x4_t FarPixelsNEON(const uint32x4_t pixels, const uint32x4_t reference, const uint8_t tolerance)
+{
+    const uint8x16_t distances = vabdq_u8(vreinterpretq_u8_u32(pixels), vreinterpretq_u8_u32(reference));
+    if constexpr (PerChannel)
+    {
+        const uint32x4_t exceeded = vreinterpretq_u32_u8(vcgtq_u8(distances, vdupq_n_u8(tolerance)));
+        return vtstq_u32(exceeded, exceeded);
+    }
+    else
+    {
+        const uint32x4_t sums = vpaddlq_u16(vpaddlq_u8(distances));
+        const uint32x4_t scores = vandq_u32(sums, vdupq_n_u32(std::numeric_limits<uint8_t>::max()));
+        return vcgtq_u32(scores, vdupq_n_u32(tolerance));
+    }
+}
+
+template<bool PerChannel>
+inline size_t CountClosePixelsNEON(const uint32_t* first, const ptrdiff_t stride, const size_t count, const uint32_t reference, const uint8_t tolerance)
+{
+    constexpr size_t step = 4;
+    const uint32x4_t referencePixels = vdupq_n_u32(reference);
+    static constexpr uint32_t laneBitValues[] = { 1, 2, 4, 8 };
+    const uint32x4_t laneBits = vld1q_u32(laneBitValues);
+
+    size_t i = 0;
+    for (; i + step <= count; i += step)
+    {
+        const uint32_t* block = first + static_cast<ptrdiff_t>(i) * stride;
+
+        uint32x4_t pixels;
+        if (stride == 1)
+        {
+            pixels = vld1q_u32(block);
+        }
+        else if (stride == -1)
+        {
+            const uint32x4_t loaded = vrev64q_u32(vld1q_u32(block - 3));
+            pixels = vcombine_u32(vget_high_u32(loaded), vget_low_u32(loaded));
+        }
+        else
+        {
+            pixels = vdupq_n_u32(block[0]);
+            pixels = vsetq_lane_u32(block[stride], pixels, 1);
+            pixels = vsetq_lane_u32(block[2 * stride], pixels, 2);
+            pixels = vsetq_lane_u32(block[3 * stride], pixels, 3);
+        }
+
+        const uint32_t farMask = vaddvq_u32(vandq_u32(FarPixelsNEON<PerChannel>(pixels, referencePixels, tolerance), laneBits));
+        if (farMask != 0)
+        {
+            return i + std::countr_zero(farMask);
+        }
+    }
+
+    return i + CountClosePixelsScalar<PerChannel>(first + static_cast<ptrdiff_t>(i) * stride, stride, count - i, reference, tolerance);
+}
+
+#endif
+
+inline ScanInstructionSet BestScanInstructionSet()
+{
+#if defined(_M_ARM64)
+    return ScanInstructionSet::NEON;
+#else
+    static const ScanInstructionSet best = IsAVX2Supported() ? ScanInstructionSet::AVX2 : ScanInstructionSet::SSE2;
+    return best;
+#endif
+}
+
+// Returns the scanner for the given instruction set, or the scalar one if it isn't available on this architecture
+template<bool PerChannel>
+inline ScanFunction GetScanFunction(const ScanInstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+#if defined(_M_ARM64)
+    case ScanInstructionSet::NEON:
+        return &CountClosePixelsNEON<PerChannel>;
+#else
+    case ScanInstructionSet::SSE2:
+        return &CountClosePixelsSSE2<PerChannel>;
+    case ScanInstructionSet::AVX2:
+        return &CountClosePixelsAVX2<PerChannel>;
+#endif
+    default:
+        return &CountClosePixelsScalar<PerChannel>;
+    }
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+// Stages a captured frame goes through until its measurement is drawn
+enum class FrameStage : uint8_t
+{
+    Capture, // acquiring the captured frame
+    CopyToCPU, // queuing the copy to a staging texture
+    Map, // waiting for the copy to complete
+    EdgeDetection,
+    StateHandoff, // publishing the measurement to the drawing thread
+    Draw, // DrawMeasureToolTick or DrawBoundsToolTick
+
+    Count
+};
+
+inline const wchar_t* FrameStageName(const FrameStage stage)
+{
+    switch (stage)
+    {
+    case FrameStage::Capture:
+        return L"capture";
+    case FrameStage::CopyToCPU:
+        return L"copy";
+    case FrameStage::Map:
+        return L"map";
+    case FrameStage::EdgeDetection:
+        return L"edges";
+    case FrameStage::StateHandoff:
+        return L"handoff";
+    case FrameStage::Draw:
+        return L"draw";
+    default:
+        return L"unknown";
+    }
+}
+
+// Histogram of the last WindowSize durations, so percentiles follow what the tool is doing now rather than what it
+// did at the start of a session. Buckets are log-linear, i.e. 8 buckets per power of 2, which keeps percentiles
+// within 12.5% of the recorded values without storing them.
+class DurationHistogram
+{
+public:
+    static constexpr size_t WindowSize = 1024;
+
+private:
+    static constexpr uint32_t SubBucketBits = 3;
+    static constexpr uint32_t SubBuckets = 1u << SubBucketBits;
+    static constexpr size_t BucketCount = (64 - SubBucketBits + 1) * SubBuckets;
+
+    std::array<uint32_t, BucketCount> counts = {};
+    std::array<uint16_t, WindowSize> window = {};
+    size_t windowPos = 0;
+    size_t windowFill = 0;
+    uint64_t recorded = 0;
+
+    static inline size_t BucketOf(const uint64_t nanoseconds)
+    {
+        if (nanoseconds < SubBuckets)
+        {
+            return static_cast<size_t>(nanoseconds);
+        }
+
+        const uint32_t exponent = static_cast<uint32_t>(std::bit_width(nanoseconds)) - 1;
+        const uint32_t subBucket = static_cast<uint32_t>(nanoseconds >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+        return (exponent - SubBucketBits + 1) * SubBuckets + subBucket;
+    }
+
+    // Middle of the range of durations which fall into the bucket
+    static inline uint64_t BucketValue(const size_t bucket)
+    {
+        if (bucket < SubBuckets)
+        {
+            return bucket;
+        }
+
+        const uint32_t exponent = static_cast<uint32_t>(bucket / SubBuckets) + SubBucketBits - 1;
+        const uint64_t lower = static_cast<uint64_t>(SubBuckets + bucket % SubBuckets) << (exponent - SubBucketBits);
+        return lower + (uint64_t{ 1 } << (exponent - SubBucketBits)) / 2;
+    }
+
+public:
+    void Record(const std::chrono::nanoseconds duration)
+    {
+        const size_t bucket = BucketOf(static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0)));
+        if (windowFill == WindowSize)
+        {
+            counts[window[windowPos]]--;
+        }
+        else
+        {
+            windowFill++;
+        }
+
+        window[windowPos] = static_cast<uint16_t>(bucket);
+        counts[bucket]++;
+        windowPos = (windowPos + 1) % WindowSize;
+        recorded++;
+    }
+
+    // Returns the duration which `percentile` percent of the durations in the window don't exceed
+    std::chrono::nanoseconds Percentile(const double percentile) const
+    {
+        if (windowFill == 0)
+        {
+            return {};
+        }
+
+        const auto rank = static_cast<uint64_t>(std::clamp(percentile, 0., 100.) / 100. * (windowFill - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < BucketCount; ++bucket)
+        {
+            seen += counts[bucket];
+            if (seen >= rank)
+            {
+                return std::chrono::nanoseconds{ BucketValue(bucket) };
+            }
+        }
+
+        return {};
+    }
+
+    // Durations recorded since the last reset, including the ones which have left the window
+    inline uint64_t Recorded() const
+    {
+        return recorded;
+    }
+
+    void Reset()
+    {
+        *this = {};
+    }
+};
+
+struct FrameStageSummary
+{
+    uint64_t recorded = {};
+    std::chrono::nanoseconds p50 = {};
+    std::chrono::nanoseconds p99 = {};
+};
+
+// Durations of every frame stage. Stages are recorded from the capturing and drawing threads of every monitor.
+class FrameTimings
+{
+    struct Stage
+    {
+        mutable std::mutex mutex;
+        DurationHistogram histogram;
+    };
+
+    std::array<Stage, static_cast<size_t>(FrameStage::Count)> stages;
+
+public:
+    void Record(const FrameStage stage, const std::chrono::nanoseconds duration)
+    {
+        auto& s = stages[static_cast<size_t>(stage)];
+        std::lock_guard lock{ s.mutex };
+        s.histogram.Record(duration);
+    }
+
+    FrameStageSummary Summary(const FrameStage stage) const
+    {
+        const auto& s = stages[static_cast<size_t>(stage)];
+        std::lock_guard lock{ s.mutex };
+        return { .recorded = s.histogram.Recorded(), .p50 = s.histogram.Percentile(50.), .p99 = s.histogram.Percentile(99.) };
+    }
+
+    void Reset()
+    {
+        for (auto& s : stages)
+        {
+            std::lock_guard lock{ s.mutex };
+            s.histogram.Reset();
+        }
+    }
+};
+
+// Records the time from its construction to its destruction as the duration of a stage
+class ScopedStageTimer
+{
+    FrameTimings& timings;
+    FrameStage stage;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+public:
+    ScopedStageTimer(FrameTimings& timings, const FrameStage stage) :
+        timings{ timings }, stage{ stage }
+    {
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+    ~ScopedStageTimer()
+    {
+        timings.Record(stage, std::chrono::steady_clock::now() - start);
+    }
+};
@@ -1,9 +1,9 @@
 ﻿#include "pch.h"
 
-#include "BGRATextureView.h"
 #include "Clipboard.h"
 #include "CoordinateSystemConversion.h"
 #include "constants.h"
+#include "MappedTextureView.h"
 #include "MeasureToolOverlayUI.h"
 
 #include <common/utils/window.h>
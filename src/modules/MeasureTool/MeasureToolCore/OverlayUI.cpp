@@ -122,6 +122,31 @@ std::vector<D2D1::ColorF> AppendCommonOverlayUIColors(const D2D1::ColorF& lineCo
     return { lineColor, foreground, background, border };
 }
 
+#if defined(DEBUG_FRAME_TIMINGS)
+void OverlayUIState::DrawFrameTimings()
+{
+    const float lineHeight = consts::FONT_SIZE * 2.f * _d2dState.dpiScale;
+    for (size_t i = 0; i < static_cast<size_t>(FrameStage::Count); ++i)
+    {
+        const auto stage = static_cast<FrameStage>(i);
+        const auto summary = _commonState.frameTimings.Summary(stage);
+        OverlayBoxText text;
+        const int length = swprintf_s(text.buffer.data(),
+                                      text.buffer.size(),
+                                      L"%s p50 %.1f us p99 %.1f us",
+                                      FrameStageName(stage),
+                                      summary.p50.count() / 1000.,
+                                      summary.p99.count() / 1000.);
+        _d2dState.DrawTextBox(text.buffer.data(),
+                              static_cast<size_t>(std::max(length, 0)),
+                              std::nullopt,
+                              D2D_POINT_2F{ .x = lineHeight * 5.f, .y = lineHeight * (i + 1) },
+                              false,
+                              _window);
+    }
+}
+#endif
+
 void OverlayUIState::RunUILoop()
 {
     bool cursorOnScreen = false;
@@ -146,7 +171,14 @@ void OverlayUIState::RunUILoop()
         dxgi.rt->Clear();
 
         if (!cursorOverToolbar)
+        {
+            ScopedStageTimer timer{ _commonState.frameTimings, FrameStage::Draw };
             _tickFunc();
+        }
+
+#if defined(DEBUG_FRAME_TIMINGS)
+        DrawFrameTimings();
+#endif
 
         dxgi.rt->EndDraw();
         dxgi.swapChain->Present(0, 0);
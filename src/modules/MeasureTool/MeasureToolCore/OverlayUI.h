@@ -34,6 +34,10 @@ class OverlayUIState final
                                                           const MonitorInfo& monitor,
                                                           const bool excludeFromCapture);
 
+#if defined(DEBUG_FRAME_TIMINGS)
+    void DrawFrameTimings();
+#endif
+
 public:
     OverlayUIState(OverlayUIState&&) noexcept = default;
     ~OverlayUIState();
@@ -75,6 +75,7 @@ namespace winrt::PowerToys::MeasureToolCore::implementation
             }
         }
         _screenCaptureThreads.clear();
+        LogFrameTimings();
         _measureToolState.Reset();
         _measureToolState.Access([&](MeasureToolState& s) {
             s.commonState = &_commonState;
@@ -89,6 +90,25 @@ namespace winrt::PowerToys::MeasureToolCore::implementation
         _commonState.closeOnOtherMonitors = false;
     }
 
+    void Core::LogFrameTimings()
+    {
+        for (size_t i = 0; i < static_cast<size_t>(FrameStage::Count); ++i)
+        {
+            const auto stage = static_cast<FrameStage>(i);
+            const auto summary = _commonState.frameTimings.Summary(stage);
+            if (summary.recorded == 0)
+                continue;
+
+            Logger::info(L"Frame stage {}: {} samples, p50 {} us, p99 {} us",
+                         FrameStageName(stage),
+                         summary.recorded,
+                         std::chrono::duration_cast<std::chrono::microseconds>(summary.p50).count(),
+                         std::chrono::duration_cast<std::chrono::microseconds>(summary.p99).count());
+        }
+
+        _commonState.frameTimings.Reset();
+    }
+
     void Core::StartBoundsTool()
     {
         ResetState();
@@ -36,6 +36,7 @@ namespace winrt::PowerToys::MeasureToolCore::implementation
         void SetToolCompletionEvent(ToolSessionCompleted sessionCompletedTrigger);
         void SetToolbarBoundingBox(const uint32_t fromX, const uint32_t fromY, const uint32_t toX, const uint32_t toY);
         void ResetState();
+        void LogFrameTimings();
         float GetDPIScaleForWindow(uint64_t windowHandle);
         void MouseCaptureThread();
 
@@ -1,13 +1,19 @@
 #include "pch.h"
 
-#include "BGRATextureView.h"
 #include "constants.h"
 #include "CoordinateSystemConversion.h"
+#include "EdgeChangeTracker.h"
 #include "EdgeDetection.h"
+#include "EdgeIndex.h"
+#include "MappedTextureView.h"
 #include "ScreenCapturing.h"
+#include "StagingTextureRing.h"
 
 #include <common/Display/monitors.h>
 
+#include <array>
+#include <condition_variable>
+
 //#define DEBUG_EDGES
 
 namespace
@@ -27,6 +33,139 @@ namespace
 
         return item;
     }
+
+    // Indexes the edges of a captured frame around the cursor on a background thread, so the cursor doesn't freeze
+    // while tiles are built. Queries are answered by DetectEdges until the tile under the cursor is indexed.
+    class EdgeIndexBuilder final
+    {
+        const BGRATextureView& texture;
+
+        std::mutex indexMutex;
+        std::condition_variable requestChanged;
+        EdgeIndex index;
+        std::optional<EdgeIndex::TileKey> requested;
+        bool stopping = false;
+        std::thread buildThread;
+
+        void BuildTiles()
+        {
+            // The tile under the cursor first, then its neighbors, where the cursor is likely to go next
+            constexpr std::array<std::pair<int, int>, 9> order = { { { 0, 0 }, { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 }, { -1, -1 }, { 1, -1 }, { -1, 1 }, { 1, 1 } } };
+
+            std::unique_lock lock{ indexMutex };
+            while (true)
+            {
+                requestChanged.wait(lock, [this] { return stopping || requested.has_value(); });
+                if (stopping)
+                {
+                    return;
+                }
+
+                const auto center = *requested;
+                requested.reset();
+
+                for (const auto& [dx, dy] : order)
+                {
+                    const int tileX = center.tileX + dx;
+                    const int tileY = center.tileY + dy;
+                    if (tileX < 0 || tileY < 0)
+                    {
+                        continue;
+                    }
+
+                    auto key = center;
+                    key.tileX = static_cast<uint16_t>(tileX);
+                    key.tileY = static_cast<uint16_t>(tileY);
+                    if (!index.IsValid(key) || index.Contains(key))
+                    {
+                        continue;
+                    }
+
+                    lock.unlock();
+                    auto tile = EdgeIndex::BuildTile(texture, key);
+                    lock.lock();
+                    index.Insert(key, std::move(tile));
+
+                    // The cursor has moved on to a tile which isn't indexed, or the settings have changed
+                    if (stopping || requested)
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+
+    public:
+        explicit EdgeIndexBuilder(const BGRATextureView& texture) :
+            texture{ texture }, index{ texture }
+        {
+            buildThread = SpawnLoggedThread(L"Edge index thread", [this] { BuildTiles(); });
+        }
+
+        ~EdgeIndexBuilder()
+        {
+            {
+                std::lock_guard lock{ indexMutex };
+                stopping = true;
+            }
+
+            requestChanged.notify_one();
+            buildThread.join();
+        }
+
+        // Returns the edges from the index, or nothing while the tile under the cursor isn't indexed for these settings
+        std::optional<RECT> TryDetectEdges(const POINT centerPoint, const bool perChannel, const uint8_t tolerance)
+        {
+            std::lock_guard lock{ indexMutex };
+            if (!index.CanIndex())
+            {
+                return std::nullopt;
+            }
+
+            if (const auto edges = index.TryDetectEdges(centerPoint, perChannel, tolerance))
+            {
+                return edges;
+            }
+
+            requested = index.KeyFor(centerPoint, perChannel, tolerance);
+            requestChanged.notify_one();
+            return std::nullopt;
+        }
+    };
+
+    class D3DStagingTextureAllocator final : public StagingTextureAllocator<winrt::com_ptr<ID3D11Texture2D>>
+    {
+        ID3D11Device* device = nullptr;
+
+    public:
+        explicit D3DStagingTextureAllocator(ID3D11Device* device) :
+            device{ device }
+        {
+        }
+
+        winrt::com_ptr<ID3D11Texture2D> Allocate(const StagingTextureSize& size) override
+        {
+            const D3D11_TEXTURE2D_DESC desc = {
+                .Width = size.width,
+                .Height = size.height,
+                .MipLevels = 1,
+                .ArraySize = 1,
+                .Format = static_cast<DXGI_FORMAT>(size.format),
+                .SampleDesc = { .Count = 1, .Quality = 0 },
+                .Usage = D3D11_USAGE_STAGING,
+                .BindFlags = 0,
+                .CPUAccessFlags = D3D11_CPU_ACCESS_READ,
+                .MiscFlags = 0,
+            };
+
+            winrt::com_ptr<ID3D11Texture2D> texture;
+            winrt::check_hresult(device->CreateTexture2D(&desc, nullptr, texture.put()));
+            return texture;
+        }
+    };
+
+    // Staging textures per capture session: one is copied to, one is mapped by the frame callback, and one is spare
+    constexpr size_t STAGING_RING_DEPTH = 3;
 }
 
 class D3DCaptureState final
@@ -43,16 +182,33 @@ class D3DCaptureState final
     winrt::GraphicsCaptureSession session = nullptr;
 
     std::function<void(MappedTextureView)> frameCallback;
+    FrameTimings& frameTimings;
     Box monitorArea;
     bool continuousCapture = false;
 
+    D3DStagingTextureAllocator stagingAllocator;
+    StagingTextureRing<winrt::com_ptr<ID3D11Texture2D>> stagingRing;
+
+    // In continuous mode, a frame is mapped only after the copy of the next one has been queued, or after a frame
+    // duration without new frames, so the GPU copy has most likely completed and Map doesn't stall
+    winrt::com_ptr<ID3D11Texture2D> pendingFrame;
+    winrt::SizeInt32 pendingFrameSize{};
+    std::chrono::steady_clock::time_point pendingFrameCopyTime;
+
+    uint64_t mappedFrames = 0;
+    std::chrono::nanoseconds mapStallTime{};
+    std::chrono::nanoseconds maxMapStallTime{};
+
     D3DCaptureState(DxgiAPI* dxgiAPI,
                     winrt::com_ptr<IDXGISwapChain1> swapChain,
                     winrt::DirectXPixelFormat pixelFormat,
                     MonitorInfo monitorInfo,
-                    const bool continuousCapture);
+                    const bool continuousCapture,
+                    FrameTimings& frameTimings);
 
-    winrt::com_ptr<ID3D11Texture2D> CopyFrameToCPU(const winrt::com_ptr<ID3D11Texture2D>& texture);
+    winrt::com_ptr<ID3D11Texture2D> CopyFrameToCPU(const winrt::com_ptr<ID3D11Texture2D>& texture, const bool reuseTexture);
+    MappedTextureView MapFrame(winrt::com_ptr<ID3D11Texture2D> texture, const winrt::SizeInt32 size);
+    void ProcessPendingFrame();
 
     void OnFrameArrived(const winrt::Direct3D11CaptureFramePool& sender, const winrt::IInspectable&);
 
@@ -64,13 +220,17 @@ public:
     static std::unique_ptr<D3DCaptureState> Create(DxgiAPI* dxgiAPI,
                                                    MonitorInfo monitorInfo,
                                                    const winrt::DirectXPixelFormat pixelFormat,
-                                                   const bool continuousCapture);
+                                                   const bool continuousCapture,
+                                                   FrameTimings& frameTimings);
 
     ~D3DCaptureState();
 
     void StartCapture(std::function<void(MappedTextureView)> _frameCallback);
     MappedTextureView CaptureSingleFrame();
 
+    // Delivers the last frame of a continuous capture if no new frames have arrived since, e.g. when the screen is static
+    void FlushPendingFrame();
+
     void StopCapture();
 };
 
@@ -78,33 +238,62 @@ D3DCaptureState::D3DCaptureState(DxgiAPI* dxgiAPI,
                                  winrt::com_ptr<IDXGISwapChain1> _swapChain,
                                  winrt::DirectXPixelFormat pixelFormat_,
                                  MonitorInfo monitorInfo,
-                                 const bool continuousCapture_) :
+                                 const bool continuousCapture_,
+                                 FrameTimings& frameTimings) :
     dxgiAPI{ dxgiAPI },
     device{ dxgiAPI->d3dForCapture.d3dDeviceInspectable.as<winrt::IDirect3DDevice>() },
     swapChain{ std::move(_swapChain) },
     pixelFormat{ std::move(pixelFormat_) },
     monitor{ monitorInfo.GetHandle() },
+    frameTimings{ frameTimings },
     monitorArea{ monitorInfo.GetScreenSize(true) },
-    continuousCapture{ continuousCapture_ }
+    continuousCapture{ continuousCapture_ },
+    stagingAllocator{ dxgiAPI->d3dForCapture.d3dDevice.get() },
+    stagingRing{ stagingAllocator, STAGING_RING_DEPTH }
 {
 }
 
-winrt::com_ptr<ID3D11Texture2D> D3DCaptureState::CopyFrameToCPU(const winrt::com_ptr<ID3D11Texture2D>& frameTexture)
+winrt::com_ptr<ID3D11Texture2D> D3DCaptureState::CopyFrameToCPU(const winrt::com_ptr<ID3D11Texture2D>& frameTexture, const bool reuseTexture)
 {
+    ScopedStageTimer timer{ frameTimings, FrameStage::CopyToCPU };
     D3D11_TEXTURE2D_DESC desc = {};
     frameTexture->GetDesc(&desc);
-    desc.Usage = D3D11_USAGE_STAGING;
-    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-    desc.MiscFlags = 0;
-    desc.BindFlags = 0;
+    const StagingTextureSize size{ .width = desc.Width, .height = desc.Height, .format = static_cast<uint32_t>(desc.Format) };
 
-    winrt::com_ptr<ID3D11Texture2D> cpuTexture;
-    winrt::check_hresult(dxgiAPI->d3dForCapture.d3dDevice->CreateTexture2D(&desc, nullptr, cpuTexture.put()));
+    // A single captured frame stays mapped for the whole session, so it gets a texture of its own
+    auto cpuTexture = reuseTexture ? stagingRing.Next(size) : stagingAllocator.Allocate(size);
     dxgiAPI->d3dForCapture.d3dContext->CopyResource(cpuTexture.get(), frameTexture.get());
 
     return cpuTexture;
 }
 
+MappedTextureView D3DCaptureState::MapFrame(winrt::com_ptr<ID3D11Texture2D> texture, const winrt::SizeInt32 size)
+{
+    // Map waits for the copy to the staging texture to complete
+    const auto mapStart = std::chrono::steady_clock::now();
+    MappedTextureView textureView{ std::move(texture),
+                                   dxgiAPI->d3dForCapture.d3dContext,
+                                   static_cast<size_t>(size.Width),
+                                   static_cast<size_t>(size.Height) };
+    const auto stall = std::chrono::steady_clock::now() - mapStart;
+    frameTimings.Record(FrameStage::Map, stall);
+
+    mappedFrames++;
+    mapStallTime += stall;
+    maxMapStallTime = std::max<std::chrono::nanoseconds>(maxMapStallTime, stall);
+
+    return textureView;
+}
+
+void D3DCaptureState::ProcessPendingFrame()
+{
+    if (!pendingFrame)
+        return;
+
+    auto texture = std::exchange(pendingFrame, nullptr);
+    frameCallback(MapFrame(std::move(texture), pendingFrameSize));
+}
+
 template<typename T>
 auto GetDXGIInterfaceFromObject(winrt::IInspectable const& object)
 {
@@ -119,6 +308,7 @@ void D3DCaptureState::OnFrameArrived(const winrt::Direct3D11CaptureFramePool& se
     // Prevent calling a callback on a partially destroyed state
     std::lock_guard callbackLock{ frameArrivedMutex };
 
+    const auto captureStart = std::chrono::steady_clock::now();
     bool resized = false;
     POINT cursorPos = {};
     GetCursorPos(&cursorPos);
@@ -153,16 +343,29 @@ void D3DCaptureState::OnFrameArrived(const winrt::Direct3D11CaptureFramePool& se
             winrt::check_hresult(swapChain->GetBuffer(0, winrt::guid_of<ID3D11Texture2D>(), texture.put_void()));
             auto surface = frame.Surface();
             auto gpuTexture = GetDXGIInterfaceFromObject<ID3D11Texture2D>(surface);
-            texture = CopyFrameToCPU(gpuTexture);
+            frameTimings.Record(FrameStage::Capture, std::chrono::steady_clock::now() - captureStart);
+            texture = CopyFrameToCPU(gpuTexture, continuousCapture);
             surface.Close();
-            MappedTextureView textureView{ texture,
-                                           dxgiAPI->d3dForCapture.d3dContext,
-                                           static_cast<size_t>(frameSize.Width),
-                                           static_cast<size_t>(frameSize.Height) };
 
-            frameCallback(std::move(textureView));
+            if (continuousCapture)
+            {
+                // Edges of the previous frame are detected while this one is being copied
+                ProcessPendingFrame();
+                pendingFrame = std::move(texture);
+                pendingFrameSize = frameSize;
+                pendingFrameCopyTime = std::chrono::steady_clock::now();
+            }
+            else
+            {
+                frameCallback(MapFrame(std::move(texture), frameSize));
+            }
         }
     }
+    else
+    {
+        // Don't deliver a stale frame once the cursor returns
+        pendingFrame = nullptr;
+    }
 
     frame.Close();
 
@@ -175,7 +378,8 @@ void D3DCaptureState::OnFrameArrived(const winrt::Direct3D11CaptureFramePool& se
 std::unique_ptr<D3DCaptureState> D3DCaptureState::Create(DxgiAPI* dxgiAPI,
                                                          MonitorInfo monitorInfo,
                                                          const winrt::DirectXPixelFormat pixelFormat,
-                                                         const bool continuousCapture)
+                                                         const bool continuousCapture,
+                                                         FrameTimings& frameTimings)
 {
     const auto dims = monitorInfo.GetScreenSize(true);
     const DXGI_SWAP_CHAIN_DESC1 desc = {
@@ -197,7 +401,7 @@ std::unique_ptr<D3DCaptureState> D3DCaptureState::Create(DxgiAPI* dxgiAPI,
                                                                                             swapChain.put()));
 
     // We must create the object in a heap, since we need to pin it in memory to receive callbacks
-    auto statePtr = std::unique_ptr<D3DCaptureState>(new D3DCaptureState{ dxgiAPI, std::move(swapChain), pixelFormat, std::move(monitorInfo), continuousCapture });
+    auto statePtr = std::unique_ptr<D3DCaptureState>(new D3DCaptureState{ dxgiAPI, std::move(swapChain), pixelFormat, std::move(monitorInfo), continuousCapture, frameTimings });
 
     return statePtr;
 }
@@ -206,6 +410,17 @@ D3DCaptureState::~D3DCaptureState()
 {
     std::unique_lock callbackLock{ frameArrivedMutex };
     StopCapture();
+
+    const auto& stagingStats = stagingRing.Stats();
+    if (mappedFrames != 0)
+    {
+        Logger::info(L"Captured {} frames, {} staging texture allocations ({} bytes), map stall {} us on average and {} us at most",
+                     mappedFrames,
+                     stagingStats.allocations,
+                     stagingStats.allocatedBytes,
+                     std::chrono::duration_cast<std::chrono::microseconds>(mapStallTime).count() / mappedFrames,
+                     std::chrono::duration_cast<std::chrono::microseconds>(maxMapStallTime).count());
+    }
 }
 
 void D3DCaptureState::StartSessionInPreferredMode()
@@ -228,10 +443,25 @@ void D3DCaptureState::StartSessionInPreferredMode()
 
 void D3DCaptureState::StartCapture(std::function<void(MappedTextureView)> _frameCallback)
 {
+    {
+        // Callbacks of the previous session might still be running
+        std::lock_guard callbackLock{ frameArrivedMutex };
+        pendingFrame = nullptr;
+    }
+
     frameCallback = std::move(_frameCallback);
     StartSessionInPreferredMode();
 }
 
+void D3DCaptureState::FlushPendingFrame()
+{
+    std::lock_guard callbackLock{ frameArrivedMutex };
+    if (pendingFrame && std::chrono::steady_clock::now() - pendingFrameCopyTime >= consts::TARGET_FRAME_DURATION)
+    {
+        ProcessPendingFrame();
+    }
+}
+
 MappedTextureView D3DCaptureState::CaptureSingleFrame()
 {
     std::optional<MappedTextureView> result;
@@ -271,7 +501,9 @@ void D3DCaptureState::StopCapture()
 void UpdateCaptureState(const CommonState& commonState,
                         Serialized<MeasureToolState>& state,
                         HWND window,
-                        const MappedTextureView& textureView)
+                        const MappedTextureView& textureView,
+                        EdgeIndexBuilder* edgeIndex,
+                        EdgeChangeTracker* changeTracker)
 {
     const auto cursorPos = convert::FromSystemToWindow(window, commonState.cursorPosSystemSpace);
     const bool cursorInLeftScreenHalf = cursorPos.x < textureView.view.width / 2;
@@ -290,10 +522,28 @@ void UpdateCaptureState(const CommonState& commonState,
     //          at 20x100, bounds should be [20,100]-[24,104]. We don't include [25,105] or
     //          [19,99], since those pixels are blue. Thus, square dims are equal to
     //          [24-20+1,104-100+1]=[5,5].
-    const RECT bounds = DetectEdges(textureView.view,
-                                    cursorPos,
-                                    perColorChannelEdgeDetection,
-                                    pixelTolerance);
+    RECT bounds = {};
+    {
+        ScopedStageTimer timer{ commonState.frameTimings, FrameStage::EdgeDetection };
+        std::optional<RECT> indexedBounds;
+        if (edgeIndex)
+        {
+            indexedBounds = edgeIndex->TryDetectEdges(cursorPos, perColorChannelEdgeDetection, pixelTolerance);
+        }
+
+        if (indexedBounds)
+        {
+            bounds = *indexedBounds;
+        }
+        else if (changeTracker)
+        {
+            bounds = changeTracker->DetectEdges(textureView.view, cursorPos, perColorChannelEdgeDetection, pixelTolerance);
+        }
+        else
+        {
+            bounds = DetectEdges(textureView.view, cursorPos, perColorChannelEdgeDetection, pixelTolerance);
+        }
+    }
 
 #if defined(DEBUG_EDGES)
     char buffer[256];
@@ -309,6 +559,8 @@ void UpdateCaptureState(const CommonState& commonState,
               textureView.view.height);
     OutputDebugStringA(buffer);
 #endif
+    // Published even when the edges haven't changed, since the overlay clears them when the cursor leaves the window
+    ScopedStageTimer timer{ commonState.frameTimings, FrameStage::StateHandoff };
     state.Access([&](MeasureToolState& state) {
         state.perScreen[window].measuredEdges = Measurement{ bounds };
     });
@@ -326,10 +578,13 @@ std::thread StartCapturingThread(DxgiAPI* dxgiAPI,
             continuousCapture = state.global.continuousCapture;
         });
 
+        // Used by the frame callbacks of a continuous capture, so it must outlive the capture state
+        EdgeChangeTracker changeTracker;
         auto captureState = D3DCaptureState::Create(dxgiAPI,
                                                     monitor,
                                                     winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized,
-                                                    continuousCapture);
+                                                    continuousCapture,
+                                                    commonState.frameTimings);
         const auto monitorArea = monitor.GetScreenSize(true);
         bool mouseOnMonitor = false;
         if (continuousCapture)
@@ -338,6 +593,11 @@ std::thread StartCapturingThread(DxgiAPI* dxgiAPI,
             {
                 if (mouseOnMonitor == monitorArea.inside(commonState.cursorPosSystemSpace))
                 {
+                    if (mouseOnMonitor)
+                    {
+                        captureState->FlushPendingFrame();
+                    }
+
                     std::this_thread::sleep_for(consts::TARGET_FRAME_DURATION);
                     continue;
                 }
@@ -346,7 +606,7 @@ std::thread StartCapturingThread(DxgiAPI* dxgiAPI,
                 if (mouseOnMonitor)
                 {
                     captureState->StartCapture([&, window](MappedTextureView textureView) {
-                        UpdateCaptureState(commonState, state, window, textureView);
+                        UpdateCaptureState(commonState, state, window, textureView, nullptr, &changeTracker);
                     });
                 }
                 else
@@ -367,6 +627,9 @@ std::thread StartCapturingThread(DxgiAPI* dxgiAPI,
                 s.perScreen[window].capturedScreenTexture = &textureView;
             });
 
+            // The frame doesn't change anymore, so its edges are indexed once instead of being detected every tick
+            EdgeIndexBuilder edgeIndex{ textureView.view };
+
             while (IsWindow(window) && !commonState.closeOnOtherMonitors)
             {
                 const auto now = std::chrono::high_resolution_clock::now();
@@ -380,7 +643,7 @@ std::thread StartCapturingThread(DxgiAPI* dxgiAPI,
                     auto path = std::filesystem::temp_directory_path() / buf;
                     textureView.view.SaveAsBitmap(path.string().c_str());
 #endif
-                    UpdateCaptureState(commonState, state, window, textureView);
+                    UpdateCaptureState(commonState, state, window, textureView, &edgeIndex, nullptr);
                     mouseOnMonitor = true;
                 }
                 else if (mouseOnMonitor)
@@ -399,6 +662,15 @@ std::thread StartCapturingThread(DxgiAPI* dxgiAPI,
             }
         }
 
-        captureState->StopCapture();
+        // Waits for the running frame callback, so the statistics aren't updated anymore
+        captureState = nullptr;
+        if (continuousCapture)
+        {
+            const auto& changeStats = changeTracker.Stats();
+            Logger::info(L"Edge detection reused the edges of {} frames, rescanned changed edges of {} frames and scanned every edge of {} frames",
+                         changeStats.skipped,
+                         changeStats.rescanned,
+                         changeStats.recomputed);
+        }
     });
 }
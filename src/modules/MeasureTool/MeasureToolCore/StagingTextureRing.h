@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+struct StagingTextureSize
+{
+    uint32_t width = {};
+    uint32_t height = {};
+    uint32_t format = {};
+
+    bool operator==(const StagingTextureSize&) const = default;
+};
+
+// Creates the CPU readable textures captured frames are copied to
+template<typename Texture>
+class StagingTextureAllocator
+{
+public:
+    virtual ~StagingTextureAllocator() = default;
+
+    virtual Texture Allocate(const StagingTextureSize& size) = 0;
+};
+
+struct StagingTextureStats
+{
+    uint64_t frames = {};
+    uint64_t allocations = {};
+    uint64_t allocatedBytes = {};
+};
+
+// Staging textures reused round-robin, so frames don't allocate a texture unless the frame size changes.
+// The ring must be deeper than the number of frames in flight, e.g. with a pipelined readback one texture is copied to
+// while the previous one is still mapped.
+// Texture is any nullable handle, like winrt::com_ptr<ID3D11Texture2D>.
+template<typename Texture>
+class StagingTextureRing
+{
+    StagingTextureAllocator<Texture>& allocator;
+    std::vector<Texture> textures;
+    StagingTextureSize size;
+    size_t next = 0;
+    StagingTextureStats stats;
+
+public:
+    StagingTextureRing(StagingTextureAllocator<Texture>& allocator, const size_t depth) :
+        allocator{ allocator }, textures(std::max<size_t>(depth, 1))
+    {
+    }
+
+    // Returns the least recently used texture, which is allocated first if the ring doesn't have one of this size
+    Texture Next(const StagingTextureSize& frameSize)
+    {
+        if (frameSize != size)
+        {
+            // Whoever still uses a texture of the old size keeps its own reference to it
+            std::fill(textures.begin(), textures.end(), Texture{});
+            size = frameSize;
+            next = 0;
+        }
+
+        Texture& texture = textures[next];
+        next = (next + 1) % textures.size();
+
+        if (!texture)
+        {
+            texture = allocator.Allocate(size);
+            stats.allocations++;
+            stats.allocatedBytes += static_cast<uint64_t>(size.width) * size.height * sizeof(uint32_t);
+        }
+
+        stats.frames++;
+        return texture;
+    }
+
+    inline size_t Depth() const
+    {
+        return textures.size();
+    }
+
+    inline const StagingTextureStats& Stats() const
+    {
+        return stats;
+    }
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// Keeps the `capacity` most recently used values, evicting the least recently used one when a new one is added
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache
+{
+    using Entry = std::pair<Key, Value>;
+
+    size_t capacity;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> lookup;
+
+public:
+    explicit LruCache(const size_t capacity) :
+        capacity{ std::max<size_t>(capacity, 1) }
+    {
+    }
+
+    // Returns nullptr if the key isn't cached, otherwise marks the value as the most recently used one.
+    // The pointer stays valid until the value is evicted.
+    Value* Find(const Key& key)
+    {
+        const auto it = lookup.find(key);
+        if (it == lookup.end())
+        {
+            return nullptr;
+        }
+
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->second;
+    }
+
+    Value& Insert(Key key, Value value)
+    {
+        if (const auto it = lookup.find(key); it != lookup.end())
+        {
+            entries.erase(it->second);
+            lookup.erase(it);
+        }
+        else if (entries.size() == capacity)
+        {
+            lookup.erase(entries.back().first);
+            entries.pop_back();
+        }
+
+        entries.emplace_front(std::move(key), std::move(value));
+        lookup.emplace(entries.front().first, entries.begin());
+        return entries.front().second;
+    }
+
+    template<typename MakeValue>
+    Value& FindOrInsert(const Key& key, MakeValue&& makeValue)
+    {
+        if (Value* value = Find(key))
+        {
+            return *value;
+        }
+
+        return Insert(key, makeValue());
+    }
+
+    inline size_t Size() const
+    {
+        return entries.size();
+    }
+
+    void Clear()
+    {
+        lookup.clear();
+        entries.clear();
+    }
+};
+
+// Everything a text box layout depends on, besides the text format which doesn't change during a D2DState lifetime
+struct TextLayoutKey
+{
+    std::wstring text;
+    float dpiScale = 1.f;
+    std::optional<size_t> halfOpaqueSymbolPos;
+
+    bool operator==(const TextLayoutKey&) const = default;
+};
+
+struct TextLayoutKeyHash
+{
+    size_t operator()(const TextLayoutKey& key) const
+    {
+        size_t hash = std::hash<std::wstring>{}(key.text);
+        const auto combine = [&hash](const size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+        combine(std::hash<float>{}(key.dpiScale));
+        combine(key.halfOpaqueSymbolPos ? *key.halfOpaqueSymbolPos + 1 : 0);
+        return hash;
+    }
+};
+
+// Text box sizes are rounded up to whole pixels, so boxes of labels with the same length share a shadow.
+// The corner radius of the box is scaled by the DPI, so the scale is part of the key too.
+struct ShadowKey
+{
+    uint32_t width = {};
+    uint32_t height = {};
+    float dpiScale = 1.f;
+
+    bool operator==(const ShadowKey&) const = default;
+};
+
+struct ShadowKeyHash
+{
+    size_t operator()(const ShadowKey& key) const
+    {
+        size_t hash = std::hash<uint64_t>{}(static_cast<uint64_t>(key.width) << 32 | key.height);
+        hash ^= std::hash<float>{}(key.dpiScale) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+};
@@ -15,7 +15,9 @@
 #include <common/utils/serialized.h>
 
 //#define DEBUG_OVERLAY
-#include "BGRATextureView.h"
+//#define DEBUG_FRAME_TIMINGS
+#include "MappedTextureView.h"
+#include "FrameTimings.h"
 #include "Measurement.h"
 
 struct OverlayBoxText
@@ -34,6 +36,7 @@ struct CommonState
     mutable Serialized<OverlayBoxText> overlayBoxText;
     POINT cursorPosSystemSpace = {}; // updated atomically
     std::atomic_bool closeOnOtherMonitors = false;
+    mutable FrameTimings frameTimings;
 };
 
 struct CursorDrag
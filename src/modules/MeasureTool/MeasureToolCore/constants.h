@@ -14,6 +14,8 @@ namespace consts
     constexpr inline float SHADOW_RADIUS = 6.f;
     constexpr inline float SHADOW_OFFSET = 5.f;
     constexpr inline float CROSS_OPACITY = .25f;
+    constexpr inline size_t TEXT_LAYOUT_CACHE_SIZE = 32;
+    constexpr inline size_t SHADOW_CACHE_SIZE = 8;
     constexpr inline int8_t MOUSE_WHEEL_TOLERANCE_STEP = 15;
     /* Offset to not try not to use the cursor immediate pixels in measuring, but it seems only necessary for continuous mode. */
     constexpr inline long CURSOR_OFFSET_AMOUNT_X = 4;
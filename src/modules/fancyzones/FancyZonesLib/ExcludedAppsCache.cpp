@@ -0,0 +1,189 @@
+#include "pch.h"
+#include "ExcludedAppsCache.h"
+
+#include <common/utils/process_path.h>
+#include <common/utils/window.h>
+
+#include <FancyZonesLib/Settings.h>
+
+// Non-Localizable strings
+namespace NonLocalizable
+{
+    const wchar_t PowerToysAppFZEditor[] = L"POWERTOYS.FANCYZONESEDITOR.EXE";
+    const char SplashClassName[] = "MsoSplash";
+    const wchar_t CoreWindow[] = L"Windows.UI.Core.CoreWindow";
+    const wchar_t SearchUI[] = L"SearchUI.exe";
+    const wchar_t SystemAppsFolder[] = L"SYSTEMAPPS";
+    const wchar_t ApplicationFrameHost[] = L"ApplicationFrameHost.exe";
+}
+
+namespace
+{
+    constexpr size_t MaxCachedProcesses = 512;
+    constexpr int MaxTitleLength = 255;
+
+    bool IsApplicationFrameHost(const std::wstring& processPath) noexcept
+    {
+        const std::wstring_view appFrameHost = NonLocalizable::ApplicationFrameHost;
+        return processPath.length() >= appFrameHost.length() &&
+               processPath.compare(processPath.length() - appFrameHost.length(), appFrameHost.length(), appFrameHost) == 0;
+    }
+}
+
+ExcludedAppsCache& ExcludedAppsCache::instance()
+{
+    static ExcludedAppsCache instance;
+    return instance;
+}
+
+ExcludedAppsCache::ExcludedAppsCache() :
+    SettingsObserver({ SettingId::ExcludedApps })
+{
+    CompileMatchers();
+}
+
+bool ExcludedAppsCache::IsExcluded(HWND window)
+{
+    std::shared_ptr<const Matchers> matchers;
+    size_t generation;
+    {
+        std::scoped_lock lock(m_mutex);
+        matchers = m_matchers;
+        generation = m_generation;
+    }
+
+    DWORD pid{};
+    GetWindowThreadProcessId(window, &pid);
+
+    auto excludedByPath = CachedDecision(pid);
+    if (!excludedByPath.has_value())
+    {
+        std::wstring processPath = get_process_path(pid);
+        if (IsApplicationFrameHost(processPath))
+        {
+            // UWP apps are hosted by ApplicationFrameHost, the actual process is only known per window
+            processPath = get_process_path_waiting_uwp(window);
+            excludedByPath = IsExcludedByPath(*matchers, processPath);
+        }
+        else
+        {
+            excludedByPath = IsExcludedByPath(*matchers, processPath);
+            Store(pid, *excludedByPath, generation);
+        }
+    }
+
+    if (*excludedByPath)
+    {
+        return true;
+    }
+
+    return IsExcludedByClassName(window) || IsExcludedByTitle(*matchers, window);
+}
+
+void ExcludedAppsCache::SettingsUpdate(SettingId type)
+{
+    if (type == SettingId::ExcludedApps)
+    {
+        CompileMatchers();
+    }
+}
+
+void ExcludedAppsCache::CompileMatchers()
+{
+    std::vector<std::wstring> apps = FancyZonesSettings::settings().excludedAppsArray;
+    apps.insert(apps.end(), { NonLocalizable::PowerToysAppFZEditor, NonLocalizable::CoreWindow, NonLocalizable::SearchUI });
+
+    auto matchers = std::make_shared<Matchers>();
+    matchers->apps = ExcludedAppsMatcher(apps);
+    matchers->folders = ExcludedAppsMatcher({ NonLocalizable::SystemAppsFolder });
+
+    std::scoped_lock lock(m_mutex);
+    m_matchers = std::move(matchers);
+    m_processes.clear();
+    m_generation++;
+}
+
+std::optional<bool> ExcludedAppsCache::CachedDecision(DWORD pid) noexcept
+{
+    std::scoped_lock lock(m_mutex);
+
+    auto iter = m_processes.find(pid);
+    if (iter == m_processes.end())
+    {
+        return std::nullopt;
+    }
+
+    if (WaitForSingleObject(iter->second.process.get(), 0) != WAIT_TIMEOUT)
+    {
+        // the process has exited, its pid may be reused by another process
+        m_processes.erase(iter);
+        return std::nullopt;
+    }
+
+    return iter->second.excludedByPath;
+}
+
+void ExcludedAppsCache::Store(DWORD pid, bool excludedByPath, size_t generation)
+{
+    wil::unique_handle process(OpenProcess(SYNCHRONIZE, FALSE, pid));
+    if (!process)
+    {
+        return;
+    }
+
+    std::scoped_lock lock(m_mutex);
+    if (generation != m_generation)
+    {
+        // the decision was made with outdated settings
+        return;
+    }
+
+    if (m_processes.size() >= MaxCachedProcesses)
+    {
+        RemoveExitedProcesses();
+        if (m_processes.size() >= MaxCachedProcesses)
+        {
+            m_processes.clear();
+        }
+    }
+
+    m_processes.insert_or_assign(pid, ProcessEntry{ std::move(process), excludedByPath });
+}
+
+void ExcludedAppsCache::RemoveExitedProcesses() noexcept
+{
+    std::erase_if(m_processes, [](const auto& item) {
+        return WaitForSingleObject(item.second.process.get(), 0) != WAIT_TIMEOUT;
+    });
+}
+
+bool ExcludedAppsCache::IsExcludedByPath(const Matchers& matchers, std::wstring& processPath)
+{
+    CharUpperBuffW(processPath.data(), static_cast<DWORD>(processPath.length()));
+    return matchers.apps.MatchesAppName(processPath) || matchers.folders.MatchesAnywhere(processPath);
+}
+
+bool ExcludedAppsCache::IsExcludedByClassName(HWND window)
+{
+    std::array<char, 256> className{};
+    GetClassNameA(window, className.data(), static_cast<int>(className.size()));
+    if (is_system_window(window, className.data()))
+    {
+        return true;
+    }
+
+    return strcmp(NonLocalizable::SplashClassName, className.data()) == 0;
+}
+
+bool ExcludedAppsCache::IsExcludedByTitle(const Matchers& matchers, HWND window)
+{
+    WCHAR title[MaxTitleLength];
+    int len = GetWindowTextW(window, title, MaxTitleLength);
+    if (len <= 0)
+    {
+        return false;
+    }
+
+    CharUpperBuffW(title, static_cast<DWORD>(len));
+    return matchers.apps.MatchesAnywhere(std::wstring_view(title, len));
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <FancyZonesLib/ExcludedAppsMatcher.h>
+#include <FancyZonesLib/SettingsObserver.h>
+
+// Keeps the process path based part of the exclusion decision per process, so the path
+// is queried and matched once per process instead of on every window event.
+// Entries are dropped when the excluded apps setting changes or the process exits.
+class ExcludedAppsCache : public SettingsObserver
+{
+public:
+    static ExcludedAppsCache& instance();
+
+    bool IsExcluded(HWND window);
+
+private:
+    ExcludedAppsCache();
+    ~ExcludedAppsCache() = default;
+
+    struct Matchers
+    {
+        ExcludedAppsMatcher apps; // user defined and default excluded apps
+        ExcludedAppsMatcher folders;
+    };
+
+    struct ProcessEntry
+    {
+        wil::unique_handle process; // prevents the pid from being reused while the entry exists
+        bool excludedByPath = false;
+    };
+
+    virtual void SettingsUpdate(SettingId type) override;
+
+    void CompileMatchers();
+    std::optional<bool> CachedDecision(DWORD pid) noexcept;
+    void Store(DWORD pid, bool excludedByPath, size_t generation);
+    void RemoveExitedProcesses() noexcept;
+
+    static bool IsExcludedByPath(const Matchers& matchers, std::wstring& processPath);
+    static bool IsExcludedByClassName(HWND window);
+    static bool IsExcludedByTitle(const Matchers& matchers, HWND window);
+
+    std::mutex m_mutex;
+    std::shared_ptr<const Matchers> m_matchers;
+    std::unordered_map<DWORD, ProcessEntry> m_processes;
+    size_t m_generation = 0;
+};
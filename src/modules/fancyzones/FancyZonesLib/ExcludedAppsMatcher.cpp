@@ -0,0 +1,156 @@
+#include "pch.h"
+#include "ExcludedAppsMatcher.h"
+
+#include <algorithm>
+#include <queue>
+
+ExcludedAppsMatcher::ExcludedAppsMatcher() noexcept :
+    m_nodes(1)
+{
+}
+
+ExcludedAppsMatcher::ExcludedAppsMatcher(const std::vector<std::wstring>& patterns) :
+    m_nodes(1)
+{
+    for (const auto& pattern : patterns)
+    {
+        if (pattern.empty())
+        {
+            m_hasEmptyPattern = true;
+            continue;
+        }
+
+        size_t node = 0;
+        for (wchar_t ch : pattern)
+        {
+            auto& transitions = m_nodes[node].transitions;
+            auto iter = std::lower_bound(transitions.begin(), transitions.end(), ch, [](const auto& transition, wchar_t value) { return transition.first < value; });
+            if (iter != transitions.end() && iter->first == ch)
+            {
+                node = iter->second;
+                continue;
+            }
+
+            const size_t child = m_nodes.size();
+            transitions.insert(iter, { ch, child });
+
+            // transitions may be invalidated by the emplace below
+            const size_t depth = m_nodes[node].depth + 1;
+            m_nodes.emplace_back();
+            m_nodes[child].depth = depth;
+            node = child;
+        }
+
+        m_nodes[node].terminal = true;
+    }
+
+    // breadth-first construction of the failure and output links
+    std::queue<size_t> queue;
+    for (const auto& [ch, child] : m_nodes[0].transitions)
+    {
+        m_nodes[child].fail = 0;
+        m_nodes[child].output = m_nodes[child].terminal ? child : NoNode;
+        queue.push(child);
+    }
+
+    while (!queue.empty())
+    {
+        const size_t node = queue.front();
+        queue.pop();
+
+        for (const auto& [ch, child] : m_nodes[node].transitions)
+        {
+            size_t fail = m_nodes[node].fail;
+            while (fail != 0 && Goto(fail, ch) == NoNode)
+            {
+                fail = m_nodes[fail].fail;
+            }
+
+            const size_t target = Goto(fail, ch);
+            m_nodes[child].fail = (target != NoNode && target != child) ? target : 0;
+            m_nodes[child].output = m_nodes[child].terminal ? child : m_nodes[m_nodes[child].fail].output;
+            queue.push(child);
+        }
+    }
+}
+
+bool ExcludedAppsMatcher::Empty() const noexcept
+{
+    return m_nodes.size() == 1 && !m_hasEmptyPattern;
+}
+
+bool ExcludedAppsMatcher::MatchesAppName(std::wstring_view path) const
+{
+    const auto lastSlash = path.rfind(L'\\');
+    if (lastSlash == std::wstring_view::npos)
+    {
+        return false;
+    }
+
+    if (m_hasEmptyPattern && path.length() == lastSlash + 1)
+    {
+        return true;
+    }
+
+    // start position of the last occurrence of every pattern, indexed by its terminal node
+    std::vector<size_t> lastStart(m_nodes.size(), std::wstring_view::npos);
+
+    size_t node = 0;
+    for (size_t i = 0; i < path.length(); i++)
+    {
+        node = Next(node, path[i]);
+        for (size_t match = m_nodes[node].output; match != NoNode; match = m_nodes[m_nodes[match].fail].output)
+        {
+            lastStart[match] = i + 1 - m_nodes[match].depth;
+        }
+    }
+
+    for (size_t i = 1; i < m_nodes.size(); i++)
+    {
+        const size_t pos = lastStart[i];
+        if (pos != std::wstring_view::npos && pos <= lastSlash + 1 && pos + m_nodes[i].depth > lastSlash)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ExcludedAppsMatcher::MatchesAnywhere(std::wstring_view text) const
+{
+    if (m_hasEmptyPattern)
+    {
+        return true;
+    }
+
+    size_t node = 0;
+    for (wchar_t ch : text)
+    {
+        node = Next(node, ch);
+        if (m_nodes[node].output != NoNode)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t ExcludedAppsMatcher::Next(size_t node, wchar_t ch) const noexcept
+{
+    while (node != 0 && Goto(node, ch) == NoNode)
+    {
+        node = m_nodes[node].fail;
+    }
+
+    const size_t target = Goto(node, ch);
+    return target == NoNode ? 0 : target;
+}
+
+size_t ExcludedAppsMatcher::Goto(size_t node, wchar_t ch) const noexcept
+{
+    const auto& transitions = m_nodes[node].transitions;
+    auto iter = std::lower_bound(transitions.begin(), transitions.end(), ch, [](const auto& transition, wchar_t value) { return transition.first < value; });
+    return (iter != transitions.end() && iter->first == ch) ? iter->second : NoNode;
+}
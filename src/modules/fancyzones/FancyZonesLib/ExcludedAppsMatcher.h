@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Aho-Corasick automaton compiled from a list of excluded app names (uppercase UTF-16).
+// Every query is a single pass over the text, regardless of the number of patterns.
+class ExcludedAppsMatcher
+{
+public:
+    ExcludedAppsMatcher() noexcept;
+    explicit ExcludedAppsMatcher(const std::vector<std::wstring>& patterns);
+
+    bool Empty() const noexcept;
+
+    // Same result as find_app_name_in_path: the last occurrence of a pattern must touch the file name.
+    bool MatchesAppName(std::wstring_view path) const;
+
+    // Same result as find_folder_in_path: any occurrence of any pattern.
+    bool MatchesAnywhere(std::wstring_view text) const;
+
+private:
+    static constexpr size_t NoNode = static_cast<size_t>(-1);
+
+    struct Node
+    {
+        std::vector<std::pair<wchar_t, size_t>> transitions; // sorted by character
+        size_t fail = 0;
+        size_t output = NoNode; // nearest node (this or a suffix) that terminates a pattern
+        size_t depth = 0;
+        bool terminal = false;
+    };
+
+    size_t Next(size_t node, wchar_t ch) const noexcept;
+    size_t Goto(size_t node, wchar_t ch) const noexcept;
+
+    std::vector<Node> m_nodes;
+    bool m_hasEmptyPattern = false;
+};
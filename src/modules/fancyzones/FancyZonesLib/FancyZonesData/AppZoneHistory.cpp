@@ -3,13 +3,13 @@
 
 #include <common/logger/call_tracer.h>
 #include <common/logger/logger.h>
-#include <common/utils/process_path.h>
 
 #include <FancyZonesLib/GuidUtils.h>
 #include <FancyZonesLib/FancyZonesWindowProperties.h>
 #include <FancyZonesLib/JsonHelpers.h>
 #include <FancyZonesLib/MonitorUtils.h>
 #include <FancyZonesLib/VirtualDesktop.h>
+#include <FancyZonesLib/WindowSystem.h>
 #include <FancyZonesLib/util.h>
 
 namespace JsonUtils
@@ -321,7 +321,7 @@ bool AppZoneHistory::SetAppLastZones(HWND window, const FancyZonesDataTypes::Wor
         return false;
     }
 
-    auto processPath = get_process_path_waiting_uwp(window);
+    auto processPath = WindowSystem::instance().GetProcessPath(window);
     if (processPath.empty())
     {
         return false;
@@ -333,8 +333,7 @@ bool AppZoneHistory::SetAppLastZones(HWND window, const FancyZonesDataTypes::Wor
         Logger::info(L"Add app zone history, device: {}, layout: {}", workAreaId.toString(), layoutIdStr.value());
     }
     
-    DWORD processId = 0;
-    GetWindowThreadProcessId(window, &processId);
+    const DWORD processId = WindowSystem::instance().GetProcessId(window);
 
     auto history = m_history.find(processPath);
     if (history != std::end(m_history))
@@ -378,7 +377,7 @@ bool AppZoneHistory::SetAppLastZones(HWND window, const FancyZonesDataTypes::Wor
 
 bool AppZoneHistory::RemoveAppLastZone(HWND window, const FancyZonesDataTypes::WorkAreaId& workAreaId, const GUID& layoutId)
 {
-    auto processPath = get_process_path_waiting_uwp(window);
+    auto processPath = WindowSystem::instance().GetProcessPath(window);
     if (processPath.empty())
     {
         return false;
@@ -406,8 +405,7 @@ bool AppZoneHistory::RemoveAppLastZone(HWND window, const FancyZonesDataTypes::W
         {
             if (!IsAnotherWindowOfApplicationInstanceZoned(window, workAreaId))
             {
-                DWORD processId = 0;
-                GetWindowThreadProcessId(window, &processId);
+                const DWORD processId = WindowSystem::instance().GetProcessId(window);
 
                 data->processIdToHandleMap.erase(processId);
             }
@@ -417,7 +415,7 @@ bool AppZoneHistory::RemoveAppLastZone(HWND window, const FancyZonesDataTypes::W
             for (auto placedWindow : data->processIdToHandleMap)
             {
                 auto placedWindowZoneStamps = FancyZonesWindowProperties::RetrieveZoneIndexProperty(placedWindow.second);
-                if (IsWindow(placedWindow.second) && (windowZoneStamps == placedWindowZoneStamps))
+                if (WindowSystem::instance().IsWindow(placedWindow.second) && (windowZoneStamps == placedWindowZoneStamps))
                 {
                     return false;
                 }
@@ -494,7 +492,7 @@ std::optional<FancyZonesDataTypes::AppZoneHistoryData> AppZoneHistory::GetZoneHi
 
 bool AppZoneHistory::IsAnotherWindowOfApplicationInstanceZoned(HWND window, const FancyZonesDataTypes::WorkAreaId& workAreaId) const noexcept
 {
-    auto processPath = get_process_path_waiting_uwp(window);
+    auto processPath = WindowSystem::instance().GetProcessPath(window);
     if (!processPath.empty())
     {
         auto history = m_history.find(processPath);
@@ -505,8 +503,7 @@ bool AppZoneHistory::IsAnotherWindowOfApplicationInstanceZoned(HWND window, cons
             {
                 if (data.workAreaId == workAreaId)
                 {
-                    DWORD processId = 0;
-                    GetWindowThreadProcessId(window, &processId);
+                    const DWORD processId = WindowSystem::instance().GetProcessId(window);
 
                     auto processIdIt = data.processIdToHandleMap.find(processId);
 
@@ -514,7 +511,7 @@ bool AppZoneHistory::IsAnotherWindowOfApplicationInstanceZoned(HWND window, cons
                     {
                         return false;
                     }
-                    else if (processIdIt->second != window && IsWindow(processIdIt->second))
+                    else if (processIdIt->second != window && WindowSystem::instance().IsWindow(processIdIt->second))
                     {
                         return true;
                     }
@@ -528,7 +525,7 @@ bool AppZoneHistory::IsAnotherWindowOfApplicationInstanceZoned(HWND window, cons
 
 ZoneIndexSet AppZoneHistory::GetAppLastZoneIndexSet(HWND window, const FancyZonesDataTypes::WorkAreaId& workAreaId, const GUID& layoutId) const
 {
-    auto processPath = get_process_path_waiting_uwp(window);
+    auto processPath = WindowSystem::instance().GetProcessPath(window);
     if (processPath.empty())
     {
         Logger::error("Process path is empty");
@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "FancyZonesWindowProperties.h"
 
+#include <FancyZonesLib/WindowSystem.h>
 #include <FancyZonesLib/ZoneIndexSetBitmask.h>
 
 #include <common/logger/logger.h>
@@ -30,7 +31,7 @@ bool FancyZonesWindowProperties::StampZoneIndexProperty(HWND window, const ZoneI
         HANDLE rawData;
         memcpy(&rawData, data.data(), sizeof data);
 
-        if (!SetProp(window, ZonedWindowProperties::PropertyMultipleZone64ID, rawData))
+        if (!WindowSystem::instance().SetProperty(window, ZonedWindowProperties::PropertyMultipleZone64ID, rawData))
         {
             Logger::error(L"Failed to stamp window {}", get_last_error_or_default(GetLastError()));
             return false;
@@ -47,7 +48,7 @@ bool FancyZonesWindowProperties::StampZoneIndexProperty(HWND window, const ZoneI
         HANDLE rawData;
         memcpy(&rawData, data.data(), sizeof data);
 
-        if (!SetProp(window, ZonedWindowProperties::PropertyMultipleZone128ID, rawData))
+        if (!WindowSystem::instance().SetProperty(window, ZonedWindowProperties::PropertyMultipleZone128ID, rawData))
         {
             Logger::error(L"Failed to stamp window {}", get_last_error_or_default(GetLastError()));
             return false;
@@ -59,14 +60,14 @@ bool FancyZonesWindowProperties::StampZoneIndexProperty(HWND window, const ZoneI
 
 void FancyZonesWindowProperties::RemoveZoneIndexProperty(HWND window)
 {
-    ::RemoveProp(window, ZonedWindowProperties::PropertyMultipleZone64ID);
-    ::RemoveProp(window, ZonedWindowProperties::PropertyMultipleZone128ID);
+    WindowSystem::instance().RemoveProperty(window, ZonedWindowProperties::PropertyMultipleZone64ID);
+    WindowSystem::instance().RemoveProperty(window, ZonedWindowProperties::PropertyMultipleZone128ID);
 }
 
 ZoneIndexSet FancyZonesWindowProperties::RetrieveZoneIndexProperty(HWND window)
 {
-    HANDLE handle64 = ::GetProp(window, ZonedWindowProperties::PropertyMultipleZone64ID);
-    HANDLE handle128 = ::GetProp(window, ZonedWindowProperties::PropertyMultipleZone128ID);
+    HANDLE handle64 = WindowSystem::instance().GetProperty(window, ZonedWindowProperties::PropertyMultipleZone64ID);
+    HANDLE handle128 = WindowSystem::instance().GetProperty(window, ZonedWindowProperties::PropertyMultipleZone128ID);
 
     ZoneIndexSetBitmask bitmask{};
 
@@ -89,18 +90,18 @@ ZoneIndexSet FancyZonesWindowProperties::RetrieveZoneIndexProperty(HWND window)
 
 void FancyZonesWindowProperties::StampMovedOnOpeningProperty(HWND window)
 {
-    ::SetPropW(window, ZonedWindowProperties::PropertyMovedOnOpening, reinterpret_cast<HANDLE>(1));
+    WindowSystem::instance().SetProperty(window, ZonedWindowProperties::PropertyMovedOnOpening, reinterpret_cast<HANDLE>(1));
 }
 
 bool FancyZonesWindowProperties::RetrieveMovedOnOpeningProperty(HWND window)
 {
-    HANDLE handle = ::GetProp(window, ZonedWindowProperties::PropertyMovedOnOpening);
+    HANDLE handle = WindowSystem::instance().GetProperty(window, ZonedWindowProperties::PropertyMovedOnOpening);
     return handle != nullptr;
 }
 
 std::optional<size_t> FancyZonesWindowProperties::GetTabSortKeyWithinZone(HWND window)
 {
-    auto rawTabSortKeyWithinZone = ::GetPropW(window, ZonedWindowProperties::PropertySortKeyWithinZone);
+    auto rawTabSortKeyWithinZone = WindowSystem::instance().GetProperty(window, ZonedWindowProperties::PropertySortKeyWithinZone);
     if (rawTabSortKeyWithinZone == NULL)
     {
         return std::nullopt;
@@ -114,11 +115,11 @@ void FancyZonesWindowProperties::SetTabSortKeyWithinZone(HWND window, std::optio
 {
     if (!tabSortKeyWithinZone.has_value())
     {
-        ::RemovePropW(window, ZonedWindowProperties::PropertySortKeyWithinZone);
+        WindowSystem::instance().RemoveProperty(window, ZonedWindowProperties::PropertySortKeyWithinZone);
     }
     else
     {
         auto rawTabSortKeyWithinZone = reinterpret_cast<HANDLE>(tabSortKeyWithinZone.value() + 1);
-        ::SetPropW(window, ZonedWindowProperties::PropertySortKeyWithinZone, rawTabSortKeyWithinZone);
+        WindowSystem::instance().SetProperty(window, ZonedWindowProperties::PropertySortKeyWithinZone, rawTabSortKeyWithinZone);
     }
 }
@@ -165,6 +165,8 @@ bool Layout::Init(const FancyZonesUtils::Rect& workArea, HMONITOR monitor) noexc
     break;
     }
 
+    m_adjacency = ZonesAdjacency(m_zones, RECT{ 0, 0, workArea.width(), workArea.height() });
+
     return m_zones.size() == m_data.zoneCount;
 }
 
@@ -183,6 +185,11 @@ const ZonesMap& Layout::Zones() const noexcept
     return m_zones;
 }
 
+const ZonesAdjacency& Layout::Adjacency() const noexcept
+{
+    return m_adjacency;
+}
+
 ZoneIndexSet Layout::ZonesFromPoint(POINT pt) const noexcept
 {
     ZoneIndexSet capturedZones;
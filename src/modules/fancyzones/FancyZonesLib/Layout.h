@@ -4,6 +4,7 @@
 #include <FancyZonesLib/util.h>
 
 #include <FancyZonesLib/LayoutConfigurator.h> // ZonesMap
+#include <FancyZonesLib/ZonesAdjacency.h>
 
 class Layout
 {
@@ -17,6 +18,7 @@ public:
     FancyZonesDataTypes::ZoneSetLayoutType Type() const noexcept;
 
     const ZonesMap& Zones() const noexcept;
+    const ZonesAdjacency& Adjacency() const noexcept;
     ZoneIndexSet ZonesFromPoint(POINT pt) const noexcept;
     /**
      * Returns all zones spanned by the minimum bounding rectangle containing the two given zone index sets.
@@ -28,4 +30,5 @@ public:
 private:
     const LayoutData m_data;
     ZonesMap m_zones{};
+    ZonesAdjacency m_adjacency{};
 };
@@ -4,7 +4,7 @@
 #include <FancyZonesLib/FancyZonesWindowProperties.h>
 #include <FancyZonesLib/Settings.h>
 #include <FancyZonesLib/VirtualDesktop.h>
-#include <FancyZonesLib/WindowUtils.h>
+#include <FancyZonesLib/WindowSystem.h>
 
 void LayoutAssignedWindows::Assign(HWND window, const ZoneIndexSet& zones)
 {
@@ -17,7 +17,7 @@ void LayoutAssignedWindows::Assign(HWND window, const ZoneIndexSet& zones)
 
     if (FancyZonesSettings::settings().disableRoundCorners)
     {
-        FancyZonesWindowUtils::DisableRoundCorners(window);
+        WindowSystem::instance().DisableRoundCorners(window);
     }
 
     auto tabSortKeyWithinZone = FancyZonesWindowProperties::GetTabSortKeyWithinZone(window);
@@ -90,7 +90,7 @@ void LayoutAssignedWindows::CycleWindows(HWND window, bool reverse)
         }
 
         // Determine whether the window still exists
-        if (!IsWindow(next))
+        if (!WindowSystem::instance().IsWindow(next))
         {
             // Dismiss the encountered window since it was probably closed
             Dismiss(next);
@@ -99,7 +99,7 @@ void LayoutAssignedWindows::CycleWindows(HWND window, bool reverse)
 
         if (VirtualDesktop::instance().IsWindowOnCurrentDesktop(next))
         {
-            FancyZonesWindowUtils::SwitchToWindow(next);
+            WindowSystem::instance().SwitchToWindow(next);
         }
 
         break;
@@ -82,7 +82,12 @@ public:
 #if defined(UNIT_TESTS)
     inline void SetSettings(const Settings& settings)
     {
+        bool excludedAppsChanged = m_settings.excludedAppsArray != settings.excludedAppsArray;
         m_settings = settings;
+        if (excludedAppsChanged)
+        {
+            NotifyObservers(SettingId::ExcludedApps);
+        }
     }
 #endif
 
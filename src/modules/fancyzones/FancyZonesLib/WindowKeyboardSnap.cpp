@@ -3,7 +3,7 @@
 
 #include <FancyZonesLib/Settings.h>
 #include <FancyZonesLib/trace.h>
-#include <FancyZonesLib/WindowUtils.h>
+#include <FancyZonesLib/WindowSystem.h>
 #include <FancyZonesLib/WorkArea.h>
 #include <FancyZonesLib/util.h>
 
@@ -122,8 +122,7 @@ bool WindowKeyboardSnap::SnapHotkeyBasedOnZoneNumber(HWND window, DWORD vkCode,
 
             if (FancyZonesSettings::settings().restoreSize && !moved)
             {
-                FancyZonesWindowUtils::RestoreWindowOrigin(window);
-                FancyZonesWindowUtils::RestoreWindowSize(window);
+                WindowSystem::instance().RestoreWindowSizeAndOrigin(window);
             }
 
             return moved;
@@ -135,6 +134,31 @@ bool WindowKeyboardSnap::SnapHotkeyBasedOnZoneNumber(HWND window, DWORD vkCode,
 
 bool WindowKeyboardSnap::SnapBasedOnPositionOnAnotherMonitor(HWND window, RECT windowRect, DWORD vkCode, HMONITOR current, const std::unordered_map<HMONITOR, std::unique_ptr<WorkArea>>& activeWorkAreas, const std::vector<std::pair<HMONITOR, RECT>>& monitors)
 {
+    // A window snapped to a single zone moves along the precomputed cross-monitor adjacency
+    const auto& currentWorkArea = activeWorkAreas.at(current);
+    const auto windowZones = currentWorkArea ? currentWorkArea->GetLayoutWindows().GetZoneIndexSetFromWindow(window) : ZoneIndexSet{};
+    if (windowZones.size() == 1)
+    {
+        m_monitorsAdjacency.Update(activeWorkAreas, monitors);
+        if (m_monitorsAdjacency.Contains(current, windowZones[0]))
+        {
+            const auto target = m_monitorsAdjacency.Neighbor(current, windowZones[0], vkCode);
+            if (!target.has_value() || !activeWorkAreas.contains(target->monitor))
+            {
+                return false;
+            }
+
+            const auto& workArea = activeWorkAreas.at(target->monitor);
+            bool snapped = workArea && workArea->Snap(window, { target->zone });
+            if (snapped)
+            {
+                Trace::FancyZones::KeyboardSnapWindowToZone(workArea->GetLayout().get(), workArea->GetLayoutWindows());
+            }
+
+            return snapped;
+        }
+    }
+
     // Extract zones from all other monitors and target one of them
     std::vector<RECT> zoneRects;
     std::vector<std::pair<ZoneIndex, WorkArea*>> zoneRectsInfo;
@@ -198,7 +222,6 @@ bool WindowKeyboardSnap::SnapBasedOnPositionOnAnotherMonitor(HWND window, RECT w
     // Sanity check: the current monitor is valid
     if (currentMonitorRect.top <= currentMonitorRect.bottom)
     {
-        const auto& currentWorkArea = activeWorkAreas.at(current);
         if (currentWorkArea)
         {
             const auto& layout = currentWorkArea->GetLayout();
@@ -330,9 +353,30 @@ bool WindowKeyboardSnap::MoveByDirectionAndPosition(HWND window, RECT windowRect
         return false;
     }
 
-    std::vector<bool> usedZoneIndices(zones.size(), false);
     auto windowZones = layoutWindows.GetZoneIndexSetFromWindow(window);
+    if (windowZones.size() == 1)
+    {
+        // The window is snapped to a single zone, move along the precomputed adjacency
+        auto target = layout->Adjacency().Neighbor(windowZones[0], vkCode);
+        if (!target.has_value() && cycle)
+        {
+            target = layout->Adjacency().CycledNeighbor(windowZones[0], vkCode);
+        }
+
+        if (!target.has_value())
+        {
+            return false;
+        }
+
+        bool success = workArea->Snap(window, { *target });
+        if (success)
+        {
+            Trace::FancyZones::KeyboardSnapWindowToZone(layout.get(), layoutWindows);
+        }
+        return success;
+    }
 
+    std::vector<bool> usedZoneIndices(zones.size(), false);
     for (const ZoneIndex id : windowZones)
     {
         usedZoneIndices[id] = true;
@@ -408,51 +452,62 @@ bool WindowKeyboardSnap::Extend(HWND window, RECT windowRect, DWORD vkCode, Work
 
     const auto& zones = layout->Zones();
     auto appliedZones = layoutWindows.GetZoneIndexSetFromWindow(window);
-    
-    std::vector<bool> usedZoneIndices(zones.size(), false);
-    std::vector<RECT> zoneRects;
-    ZoneIndexSet freeZoneIndices;
+    std::optional<ZoneIndex> targetZone;
 
     // If selectManyZones = true for the second time, use the last zone into which we moved
     // instead of the window rect and enable moving to all zones except the old one
     if (m_extendData.IsExtended(window))
     {
-        usedZoneIndices[m_extendData.windowFinalIndex] = true;
-        windowRect = zones.at(m_extendData.windowFinalIndex).GetZoneRect();
+        targetZone = layout->Adjacency().Neighbor(m_extendData.windowFinalIndex, vkCode);
     }
     else
     {
-        for (const ZoneIndex idx : appliedZones)
+        m_extendData.Set(window);
+
+        if (appliedZones.size() == 1)
         {
-            usedZoneIndices[idx] = true;
+            targetZone = layout->Adjacency().Neighbor(appliedZones[0], vkCode);
         }
+        else
+        {
+            std::vector<bool> usedZoneIndices(zones.size(), false);
+            std::vector<RECT> zoneRects;
+            ZoneIndexSet freeZoneIndices;
 
-        // Move to coordinates relative to windowZone
-        const auto& workAreaRect = workArea->GetWorkAreaRect();
-        windowRect.top -= workAreaRect.top();
-        windowRect.bottom -= workAreaRect.top();
-        windowRect.left -= workAreaRect.left();
-        windowRect.right -= workAreaRect.left();
+            for (const ZoneIndex idx : appliedZones)
+            {
+                usedZoneIndices[idx] = true;
+            }
 
-        m_extendData.Set(window);
-    }
+            for (size_t i = 0; i < zones.size(); i++)
+            {
+                if (!usedZoneIndices[i])
+                {
+                    zoneRects.emplace_back(zones.at(i).GetZoneRect());
+                    freeZoneIndices.emplace_back(i);
+                }
+            }
 
-    for (size_t i = 0; i < zones.size(); i++)
-    {
-        if (!usedZoneIndices[i])
-        {
-            zoneRects.emplace_back(zones.at(i).GetZoneRect());
-            freeZoneIndices.emplace_back(i);
+            // Move to coordinates relative to windowZone
+            const auto& workAreaRect = workArea->GetWorkAreaRect();
+            windowRect.top -= workAreaRect.top();
+            windowRect.bottom -= workAreaRect.top();
+            windowRect.left -= workAreaRect.left();
+            windowRect.right -= workAreaRect.left();
+
+            const auto result = FancyZonesUtils::ChooseNextZoneByPosition(vkCode, windowRect, zoneRects);
+            if (result < zoneRects.size())
+            {
+                targetZone = freeZoneIndices[result];
+            }
         }
     }
 
-    const auto result = FancyZonesUtils::ChooseNextZoneByPosition(vkCode, windowRect, zoneRects);
-    if (result >= zoneRects.size())
+    if (!targetZone.has_value())
     {
         return false;
     }
 
-    ZoneIndex targetZone = freeZoneIndices[result];
     ZoneIndexSet resultIndexSet;
 
     // First time with selectManyZones = true for this window?
@@ -462,21 +517,21 @@ bool WindowKeyboardSnap::Extend(HWND window, RECT windowRect, DWORD vkCode, Work
         if (appliedZones.size())
         {
             m_extendData.windowInitialIndexSet = appliedZones;
-            m_extendData.windowFinalIndex = targetZone;
-            resultIndexSet = layout->GetCombinedZoneRange(appliedZones, { targetZone });
+            m_extendData.windowFinalIndex = *targetZone;
+            resultIndexSet = layout->GetCombinedZoneRange(appliedZones, { *targetZone });
         }
         else
         {
-            m_extendData.windowInitialIndexSet = { targetZone };
-            m_extendData.windowFinalIndex = targetZone;
-            resultIndexSet = { targetZone };
+            m_extendData.windowInitialIndexSet = { *targetZone };
+            m_extendData.windowFinalIndex = *targetZone;
+            resultIndexSet = { *targetZone };
         }
     }
     else
     {
         auto deletethis = m_extendData.windowInitialIndexSet;
-        m_extendData.windowFinalIndex = targetZone;
-        resultIndexSet = layout->GetCombinedZoneRange(m_extendData.windowInitialIndexSet, { targetZone });
+        m_extendData.windowFinalIndex = *targetZone;
+        resultIndexSet = layout->GetCombinedZoneRange(m_extendData.windowInitialIndexSet, { *targetZone });
     }
 
     bool success = workArea->Snap(window, resultIndexSet);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <FancyZonesLib/Zone.h>
+#include <FancyZonesLib/ZonesAdjacency.h>
 
 class WorkArea;
 
@@ -53,4 +54,5 @@ private:
     bool Extend(HWND window, RECT windowRect, DWORD vkCode, WorkArea* const workArea);
 
     ExtendWindowModeData m_extendData{}; // Needed for ExtendWindowByDirectionAndPosition
+    MonitorsZonesAdjacency m_monitorsAdjacency{};
 };
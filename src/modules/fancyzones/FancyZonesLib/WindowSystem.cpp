@@ -0,0 +1,81 @@
+#include "pch.h"
+#include "WindowSystem.h"
+
+#include <common/utils/process_path.h>
+
+#include <FancyZonesLib/WindowUtils.h>
+
+namespace
+{
+    class Win32WindowSystem : public WindowSystem
+    {
+    public:
+        bool IsWindow(HWND window) const override
+        {
+            return ::IsWindow(window);
+        }
+
+        void SizeWindowToZone(HWND window, RECT rect, HWND windowOfRect) override
+        {
+            const auto adjustedRect = FancyZonesWindowUtils::AdjustRectForSizeWindowToRect(window, rect, windowOfRect);
+            FancyZonesWindowUtils::SaveWindowSizeAndOrigin(window);
+            FancyZonesWindowUtils::SizeWindowToRect(window, adjustedRect);
+        }
+
+        void RestoreWindowSizeAndOrigin(HWND window) override
+        {
+            FancyZonesWindowUtils::RestoreWindowOrigin(window);
+            FancyZonesWindowUtils::RestoreWindowSize(window);
+        }
+
+        void SwitchToWindow(HWND window) override
+        {
+            FancyZonesWindowUtils::SwitchToWindow(window);
+        }
+
+        void DisableRoundCorners(HWND window) override
+        {
+            FancyZonesWindowUtils::DisableRoundCorners(window);
+        }
+
+        HANDLE GetProperty(HWND window, const wchar_t* name) const override
+        {
+            return ::GetPropW(window, name);
+        }
+
+        bool SetProperty(HWND window, const wchar_t* name, HANDLE data) override
+        {
+            return ::SetPropW(window, name, data);
+        }
+
+        void RemoveProperty(HWND window, const wchar_t* name) override
+        {
+            ::RemovePropW(window, name);
+        }
+
+        std::wstring GetProcessPath(HWND window) const override
+        {
+            return get_process_path_waiting_uwp(window);
+        }
+
+        DWORD GetProcessId(HWND window) const override
+        {
+            DWORD processId = 0;
+            GetWindowThreadProcessId(window, &processId);
+            return processId;
+        }
+    };
+
+    Win32WindowSystem win32WindowSystem;
+    WindowSystem* installedWindowSystem = &win32WindowSystem;
+}
+
+WindowSystem& WindowSystem::instance()
+{
+    return *installedWindowSystem;
+}
+
+void WindowSystem::SetInstance(WindowSystem* windowSystem) noexcept
+{
+    installedWindowSystem = windowSystem ? windowSystem : &win32WindowSystem;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+// What zoning does to a window: moving it into a zone, stamping properties on it and finding the app it belongs to.
+// The default implementation calls Win32. The simulator and the unit tests install their own to snap windows that
+// only exist in memory.
+class WindowSystem
+{
+public:
+    virtual ~WindowSystem() = default;
+
+    // The installed implementation, Win32 unless SetInstance replaced it
+    static WindowSystem& instance();
+
+    // Replaces the implementation, nullptr restores Win32. Not thread safe, install before any work area is created.
+    static void SetInstance(WindowSystem* windowSystem) noexcept;
+
+    virtual bool IsWindow(HWND window) const = 0;
+
+    // Moves the window to rect, given in windowOfRect coordinates, and saves its size and origin to be restored
+    virtual void SizeWindowToZone(HWND window, RECT rect, HWND windowOfRect) = 0;
+    virtual void RestoreWindowSizeAndOrigin(HWND window) = 0;
+    virtual void SwitchToWindow(HWND window) = 0;
+    virtual void DisableRoundCorners(HWND window) = 0;
+
+    virtual HANDLE GetProperty(HWND window, const wchar_t* name) const = 0;
+    virtual bool SetProperty(HWND window, const wchar_t* name, HANDLE data) = 0;
+    virtual void RemoveProperty(HWND window, const wchar_t* name) = 0;
+
+    // Empty when the process can't be found
+    virtual std::wstring GetProcessPath(HWND window) const = 0;
+    virtual DWORD GetProcessId(HWND window) const = 0;
+};
@@ -3,23 +3,11 @@
 
 #include <common/display/dpi_aware.h>
 #include <common/logger/logger.h>
-#include <common/utils/process_path.h>
 #include <common/utils/winapi_error.h>
 #include <common/utils/window.h>
-#include <common/utils/excluded_apps.h>
 
+#include <FancyZonesLib/ExcludedAppsCache.h>
 #include <FancyZonesLib/FancyZonesWindowProperties.h>
-#include <FancyZonesLib/Settings.h>
-
-// Non-Localizable strings
-namespace NonLocalizable
-{
-    const wchar_t PowerToysAppFZEditor[] = L"POWERTOYS.FANCYZONESEDITOR.EXE";
-    const char SplashClassName[] = "MsoSplash";
-    const wchar_t CoreWindow[] = L"Windows.UI.Core.CoreWindow";
-    const wchar_t SearchUI[] = L"SearchUI.exe";
-    const wchar_t SystemAppsFolder[] = L"SYSTEMAPPS";
-}
 
 // Placeholder enums since dwmapi.h doesn't have these until SDK 22000.
 // TODO: Remove once SDK targets 22000 or above.
@@ -160,48 +148,7 @@ bool FancyZonesWindowUtils::IsRoot(HWND window) noexcept
 
 bool FancyZonesWindowUtils::IsExcluded(HWND window)
 {
-    std::wstring processPath = get_process_path_waiting_uwp(window);
-    CharUpperBuffW(const_cast<std::wstring&>(processPath).data(), static_cast<DWORD>(processPath.length()));
-    if (IsExcludedByUser(window, processPath))
-    {
-        return true;
-    }
-
-    if (IsExcludedByDefault(window, processPath))
-    {
-        return true;
-    }
-
-    return false;
-}
-
-bool FancyZonesWindowUtils::IsExcludedByUser(const HWND& hwnd, const std::wstring& processPath) noexcept
-{
-    return (check_excluded_app(hwnd, processPath, FancyZonesSettings::settings().excludedAppsArray));
-}
-
-bool FancyZonesWindowUtils::IsExcludedByDefault(const HWND& hwnd, const std::wstring& processPath) noexcept
-{
-    static std::vector<std::wstring> defaultExcludedFolders = { NonLocalizable::SystemAppsFolder };
-    if (find_folder_in_path(processPath, defaultExcludedFolders))
-    {
-        return true;
-    }
-
-    std::array<char, 256> className;
-    GetClassNameA(hwnd, className.data(), static_cast<int>(className.size()));
-    if (is_system_window(hwnd, className.data()))
-    {
-        return true;
-    }
-
-    if (strcmp(NonLocalizable::SplashClassName, className.data()) == 0)
-    {
-        return true;
-    }
-
-    static std::vector<std::wstring> defaultExcludedApps = { NonLocalizable::PowerToysAppFZEditor, NonLocalizable::CoreWindow, NonLocalizable::SearchUI };
-    return (check_excluded_app(hwnd, processPath, defaultExcludedApps));
+    return ExcludedAppsCache::instance().IsExcluded(window);
 }
 
 void FancyZonesWindowUtils::SwitchToWindow(HWND window) noexcept
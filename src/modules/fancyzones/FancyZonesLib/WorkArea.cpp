@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "WorkArea.h"
 
+#include <atomic>
+
 #include <common/logger/logger.h>
 
 #include "FancyZonesData/AppliedLayouts.h"
@@ -9,6 +11,7 @@
 #include "Settings.h"
 #include <FancyZonesLib/FancyZonesWindowProperties.h>
 #include <FancyZonesLib/VirtualDesktop.h>
+#include <FancyZonesLib/WindowSystem.h>
 #include <FancyZonesLib/WindowUtils.h>
 
 // disabling warning 4458 - declaration of 'identifier' hides class member
@@ -27,6 +30,11 @@ namespace NonLocalizable
 
 using namespace FancyZonesUtils;
 
+namespace
+{
+    std::atomic<uint64_t> layoutsVersion{ 0 };
+}
+
 namespace
 {
     // The reason for using this class is the need to call ShowWindow(window, SW_SHOWNORMAL); on each
@@ -115,6 +123,12 @@ WorkArea::WorkArea(HINSTANCE hinstance, const FancyZonesDataTypes::WorkAreaId& u
 WorkArea::~WorkArea()
 {
     windowPool.FreeZonesOverlayWindow(m_window);
+    layoutsVersion.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t WorkArea::LayoutsVersion() noexcept
+{
+    return layoutsVersion.load(std::memory_order_relaxed);
 }
 
 bool WorkArea::Snap(HWND window, const ZoneIndexSet& zones, bool updatePosition)
@@ -137,10 +151,7 @@ bool WorkArea::Snap(HWND window, const ZoneIndexSet& zones, bool updatePosition)
 
     if (updatePosition)
     {
-        const auto rect = m_layout->GetCombinedZonesRect(zones);
-        const auto adjustedRect = FancyZonesWindowUtils::AdjustRectForSizeWindowToRect(window, rect, m_window);
-        FancyZonesWindowUtils::SaveWindowSizeAndOrigin(window);
-        FancyZonesWindowUtils::SizeWindowToRect(window, adjustedRect);
+        WindowSystem::instance().SizeWindowToZone(window, m_layout->GetCombinedZonesRect(zones), m_window);
     }
 
     return FancyZonesWindowProperties::StampZoneIndexProperty(window, zones);
@@ -297,6 +308,8 @@ void WorkArea::InitSnappedWindows()
 
 void WorkArea::CalculateZoneSet()
 {
+    layoutsVersion.fetch_add(1, std::memory_order_relaxed);
+
     const auto appliedLayout = AppliedLayouts::instance().GetDeviceLayout(m_uniqueId);
     if (!appliedLayout.has_value())
     {
@@ -42,6 +42,10 @@ public:
     const HWND GetWorkAreaWindow() const noexcept { return m_window; }
     const GUID GetLayoutId() const noexcept;
     const FancyZonesUtils::Rect& GetWorkAreaRect() const noexcept { return m_workAreaRect; }
+
+    // Changes whenever a work area is destroyed or the layout of a work area is calculated, caches built from the zones
+    // of all work areas compare it instead of the zones.
+    static uint64_t LayoutsVersion() noexcept;
     
     void InitLayout();
     void InitSnappedWindows();
@@ -0,0 +1,239 @@
+#include "pch.h"
+#include "ZonesAdjacency.h"
+
+#include <FancyZonesLib/WorkArea.h>
+#include <FancyZonesLib/util.h>
+
+namespace
+{
+    constexpr std::array<DWORD, 4> Directions = { VK_LEFT, VK_RIGHT, VK_UP, VK_DOWN };
+
+    std::optional<size_t> DirectionIndex(DWORD vkCode) noexcept
+    {
+        switch (vkCode)
+        {
+        case VK_LEFT:
+            return 0;
+        case VK_RIGHT:
+            return 1;
+        case VK_UP:
+            return 2;
+        case VK_DOWN:
+            return 3;
+        default:
+            return std::nullopt;
+        }
+    }
+
+    std::optional<ZoneIndex> ToOptional(ZoneIndex zone) noexcept
+    {
+        return zone != -1 ? std::optional<ZoneIndex>(zone) : std::nullopt;
+    }
+
+    RECT ToScreen(RECT zoneRect, const RECT& monitorRect) noexcept
+    {
+        OffsetRect(&zoneRect, monitorRect.left, monitorRect.top);
+        return zoneRect;
+    }
+}
+
+ZonesAdjacency::ZonesAdjacency(const ZonesMap& zones, const RECT& workAreaRect) noexcept
+{
+    std::vector<RECT> allRects;
+    ZoneIndexSet allIndices;
+    for (const auto& [zoneId, zone] : zones)
+    {
+        allRects.emplace_back(zone.GetZoneRect());
+        allIndices.emplace_back(zoneId);
+    }
+
+    std::vector<RECT> otherRects;
+    ZoneIndexSet otherIndices;
+    otherRects.reserve(allRects.size());
+    otherIndices.reserve(allRects.size());
+
+    for (const auto& [zoneId, zone] : zones)
+    {
+        // candidates are ordered the same way as in WindowKeyboardSnap, the order affects ties
+        otherRects.clear();
+        otherIndices.clear();
+        for (const auto& [otherId, other] : zones)
+        {
+            if (otherId != zoneId)
+            {
+                otherRects.emplace_back(other.GetZoneRect());
+                otherIndices.emplace_back(otherId);
+            }
+        }
+
+        Neighbors neighbors{};
+        const RECT zoneRect = zone.GetZoneRect();
+        for (size_t i = 0; i < Directions.size(); i++)
+        {
+            const size_t direct = FancyZonesUtils::ChooseNextZoneByPosition(Directions[i], zoneRect, otherRects);
+            if (direct < otherRects.size())
+            {
+                neighbors.direct[i] = otherIndices[direct];
+            }
+
+            const RECT cycledRect = FancyZonesUtils::PrepareRectForCycling(zoneRect, workAreaRect, Directions[i]);
+            const size_t cycled = FancyZonesUtils::ChooseNextZoneByPosition(Directions[i], cycledRect, allRects);
+            if (cycled < allRects.size())
+            {
+                neighbors.cycled[i] = allIndices[cycled];
+            }
+        }
+
+        m_neighbors.emplace(zoneId, neighbors);
+    }
+}
+
+std::optional<ZoneIndex> ZonesAdjacency::Neighbor(ZoneIndex zone, DWORD vkCode) const noexcept
+{
+    const auto direction = DirectionIndex(vkCode);
+    const auto iter = m_neighbors.find(zone);
+    if (!direction.has_value() || iter == m_neighbors.end())
+    {
+        return std::nullopt;
+    }
+
+    return ToOptional(iter->second.direct[*direction]);
+}
+
+std::optional<ZoneIndex> ZonesAdjacency::CycledNeighbor(ZoneIndex zone, DWORD vkCode) const noexcept
+{
+    const auto direction = DirectionIndex(vkCode);
+    const auto iter = m_neighbors.find(zone);
+    if (!direction.has_value() || iter == m_neighbors.end())
+    {
+        return std::nullopt;
+    }
+
+    return ToOptional(iter->second.cycled[*direction]);
+}
+
+void MonitorsZonesAdjacency::Update(const std::unordered_map<HMONITOR, std::unique_ptr<WorkArea>>& activeWorkAreas, const std::vector<std::pair<HMONITOR, RECT>>& monitors) noexcept
+{
+    if (IsUpToDate(monitors))
+    {
+        return;
+    }
+
+    m_layoutsVersion = WorkArea::LayoutsVersion();
+    m_monitorZones.clear();
+    for (const auto& [monitor, monitorRect] : monitors)
+    {
+        MonitorZones monitorZones{ .monitor = monitor, .monitorRect = monitorRect };
+        if (activeWorkAreas.contains(monitor) && activeWorkAreas.at(monitor) && activeWorkAreas.at(monitor)->GetLayout())
+        {
+            for (const auto& [zoneId, zone] : activeWorkAreas.at(monitor)->GetLayout()->Zones())
+            {
+                monitorZones.zones.emplace_back(zoneId, ToScreen(zone.GetZoneRect(), monitorRect));
+            }
+        }
+
+        m_monitorZones.emplace_back(std::move(monitorZones));
+    }
+
+    Build(monitors);
+}
+
+bool MonitorsZonesAdjacency::Contains(HMONITOR monitor, ZoneIndex zone) const noexcept
+{
+    return m_neighbors.contains({ monitor, zone });
+}
+
+std::optional<MonitorsZonesAdjacency::Target> MonitorsZonesAdjacency::Neighbor(HMONITOR monitor, ZoneIndex zone, DWORD vkCode) const noexcept
+{
+    const auto direction = DirectionIndex(vkCode);
+    const auto iter = m_neighbors.find({ monitor, zone });
+    if (!direction.has_value() || iter == m_neighbors.end())
+    {
+        return std::nullopt;
+    }
+
+    const auto& target = iter->second[*direction];
+    return target.monitor ? std::optional<Target>(target) : std::nullopt;
+}
+
+bool MonitorsZonesAdjacency::IsUpToDate(const std::vector<std::pair<HMONITOR, RECT>>& monitors) const noexcept
+{
+    if (m_layoutsVersion != WorkArea::LayoutsVersion() || m_monitorZones.size() != monitors.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < monitors.size(); i++)
+    {
+        const auto& [monitor, monitorRect] = monitors[i];
+        const auto& cached = m_monitorZones[i];
+        if (cached.monitor != monitor || !EqualRect(&cached.monitorRect, &monitorRect))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void MonitorsZonesAdjacency::Build(const std::vector<std::pair<HMONITOR, RECT>>& monitors) noexcept
+{
+    m_neighbors.clear();
+
+    const RECT combinedRect = FancyZonesUtils::GetMonitorsCombinedRect<&MONITORINFOEX::rcWork>(monitors);
+
+    std::vector<RECT> zoneRects;
+    std::vector<Target> zoneRectsInfo;
+
+    for (const auto& current : m_monitorZones)
+    {
+        // zones from all other monitors first, then zones from the current monitor for cycling
+        zoneRects.clear();
+        zoneRectsInfo.clear();
+        for (const auto& other : m_monitorZones)
+        {
+            if (other.monitor != current.monitor)
+            {
+                for (const auto& [zoneId, zoneRect] : other.zones)
+                {
+                    zoneRects.emplace_back(zoneRect);
+                    zoneRectsInfo.push_back(Target{ other.monitor, zoneId });
+                }
+            }
+        }
+
+        const size_t otherZonesCount = zoneRects.size();
+        for (const auto& [zoneId, zoneRect] : current.zones)
+        {
+            zoneRects.emplace_back(zoneRect);
+            zoneRectsInfo.push_back(Target{ current.monitor, zoneId });
+        }
+
+        const std::vector<RECT> otherZoneRects(zoneRects.begin(), zoneRects.begin() + otherZonesCount);
+        const bool validMonitorRect = current.monitorRect.top <= current.monitorRect.bottom;
+
+        for (const auto& [zoneId, zoneRect] : current.zones)
+        {
+            std::array<Target, 4> targets{};
+            for (size_t i = 0; i < Directions.size(); i++)
+            {
+                size_t chosenIdx = FancyZonesUtils::ChooseNextZoneByPosition(Directions[i], zoneRect, otherZoneRects);
+                if (chosenIdx < otherZoneRects.size())
+                {
+                    targets[i] = zoneRectsInfo[chosenIdx];
+                }
+                else if (validMonitorRect)
+                {
+                    const RECT cycledRect = FancyZonesUtils::PrepareRectForCycling(zoneRect, combinedRect, Directions[i]);
+                    chosenIdx = FancyZonesUtils::ChooseNextZoneByPosition(Directions[i], cycledRect, zoneRects);
+                    if (chosenIdx < zoneRects.size())
+                    {
+                        targets[i] = zoneRectsInfo[chosenIdx];
+                    }
+                }
+            }
+
+            m_neighbors.emplace(std::make_pair(current.monitor, zoneId), targets);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <FancyZonesLib/LayoutConfigurator.h> // ZonesMap
+
+class WorkArea;
+
+// Directional neighbors of every zone of a layout.
+// Neighbors are chosen with the same metric as FancyZonesUtils::ChooseNextZoneByPosition, starting from the zone rect,
+// so a lookup gives the zone keyboard snapping would choose for a window that occupies exactly that zone.
+class ZonesAdjacency
+{
+public:
+    ZonesAdjacency() = default;
+    ZonesAdjacency(const ZonesMap& zones, const RECT& workAreaRect) noexcept;
+
+    // The closest zone in the vkCode direction, all other zones are candidates.
+    std::optional<ZoneIndex> Neighbor(ZoneIndex zone, DWORD vkCode) const noexcept;
+    // The zone chosen when cycling past the edge of the work area, all zones are candidates.
+    std::optional<ZoneIndex> CycledNeighbor(ZoneIndex zone, DWORD vkCode) const noexcept;
+
+private:
+    struct Neighbors
+    {
+        std::array<ZoneIndex, 4> direct{ -1, -1, -1, -1 };
+        std::array<ZoneIndex, 4> cycled{ -1, -1, -1, -1 };
+    };
+
+    std::map<ZoneIndex, Neighbors> m_neighbors;
+};
+
+// Directional neighbors of every zone on monitors other than the zone's own monitor, used to move windows across monitors.
+// The graph is rebuilt only when monitors have moved or WorkArea::LayoutsVersion has changed since the last update, so
+// an update on every keypress doesn't look at the zones.
+class MonitorsZonesAdjacency
+{
+public:
+    struct Target
+    {
+        HMONITOR monitor{ nullptr };
+        ZoneIndex zone{ -1 };
+    };
+
+    void Update(const std::unordered_map<HMONITOR, std::unique_ptr<WorkArea>>& activeWorkAreas, const std::vector<std::pair<HMONITOR, RECT>>& monitors) noexcept;
+
+    bool Contains(HMONITOR monitor, ZoneIndex zone) const noexcept;
+    // The zone on another monitor, or on any monitor after cycling past the edge of the combined monitors rect.
+    std::optional<Target> Neighbor(HMONITOR monitor, ZoneIndex zone, DWORD vkCode) const noexcept;
+
+private:
+    struct MonitorZones
+    {
+        HMONITOR monitor{ nullptr };
+        RECT monitorRect{};
+        std::vector<std::pair<ZoneIndex, RECT>> zones; // screen coordinates
+    };
+
+    bool IsUpToDate(const std::vector<std::pair<HMONITOR, RECT>>& monitors) const noexcept;
+    void Build(const std::vector<std::pair<HMONITOR, RECT>>& monitors) noexcept;
+
+    std::optional<uint64_t> m_layoutsVersion;
+    std::vector<MonitorZones> m_monitorZones;
+    std::map<std::pair<HMONITOR, ZoneIndex>, std::array<Target, 4>> m_neighbors;
+};
@@ -0,0 +1,39 @@
+#include "pch.h"
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <new>
+
+namespace
+{
+    std::atomic<size_t> s_count{ 0 };
+    std::atomic<size_t> s_bytes{ 0 };
+}
+
+AllocationCounter::Snapshot AllocationCounter::Current() noexcept
+{
+    return Snapshot{ .count = s_count.load(std::memory_order_relaxed), .bytes = s_bytes.load(std::memory_order_relaxed) };
+}
+
+void* operator new(size_t size)
+{
+    s_count.fetch_add(1, std::memory_order_relaxed);
+    s_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    if (void* ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
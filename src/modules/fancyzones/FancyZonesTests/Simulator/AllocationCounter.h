@@ -0,0 +1,13 @@
+#pragma once
+
+// Counts heap allocations made through the global operator new of the simulator process.
+namespace AllocationCounter
+{
+    struct Snapshot
+    {
+        size_t count{};
+        size_t bytes{};
+    };
+
+    Snapshot Current() noexcept;
+}
@@ -0,0 +1,115 @@
+#include "pch.h"
+#include "ScenarioFile.h"
+
+#include <FancyZonesLib/FancyZonesData/AppliedLayouts.h>
+#include <FancyZonesLib/FancyZonesData/CustomLayouts.h>
+#include <FancyZonesLib/FancyZonesData/LayoutDefaults.h>
+#include <FancyZonesLib/util.h>
+
+namespace NonLocalizable
+{
+    namespace ScenarioIds
+    {
+        const static wchar_t* WindowsID = L"windows";
+        const static wchar_t* MoveWindowAcrossMonitorsID = L"move-window-across-monitors";
+        const static wchar_t* MonitorsID = L"monitors";
+        const static wchar_t* LeftID = L"left";
+        const static wchar_t* TopID = L"top";
+        const static wchar_t* WidthID = L"width";
+        const static wchar_t* HeightID = L"height";
+    }
+}
+
+namespace
+{
+    std::optional<LayoutData> ParseLayout(const json::JsonObject& json, std::wstring& error)
+    {
+        LayoutData layout{};
+        layout.type = FancyZonesDataTypes::TypeFromString(std::wstring{ json.GetNamedString(NonLocalizable::AppliedLayoutsIds::TypeID) });
+        layout.showSpacing = json.GetNamedBoolean(NonLocalizable::AppliedLayoutsIds::ShowSpacingID, DefaultValues::ShowSpacing);
+        layout.spacing = static_cast<int>(json.GetNamedNumber(NonLocalizable::AppliedLayoutsIds::SpacingID, DefaultValues::Spacing));
+        layout.zoneCount = static_cast<int>(json.GetNamedNumber(NonLocalizable::AppliedLayoutsIds::ZoneCountID, DefaultValues::ZoneCount));
+        layout.sensitivityRadius = static_cast<int>(json.GetNamedNumber(NonLocalizable::AppliedLayoutsIds::SensitivityRadiusID, DefaultValues::SensitivityRadius));
+
+        const auto uuid = json.GetNamedString(NonLocalizable::AppliedLayoutsIds::UuidID, L"");
+        if (!uuid.empty())
+        {
+            const auto id = FancyZonesUtils::GuidFromString(uuid.c_str());
+            if (!id.has_value())
+            {
+                error = L"Invalid layout uuid " + std::wstring{ uuid };
+                return std::nullopt;
+            }
+
+            layout.uuid = id.value();
+        }
+        else if (layout.type == FancyZonesDataTypes::ZoneSetLayoutType::Custom)
+        {
+            error = L"Custom layouts need the uuid of an entry of custom-layouts";
+            return std::nullopt;
+        }
+
+        return layout;
+    }
+}
+
+namespace FancyZonesSimulator
+{
+    std::optional<Scenario> LoadScenario(const std::wstring& path, const Scenario& defaults, std::wstring& error)
+    {
+        const auto json = json::from_file(path);
+        if (!json)
+        {
+            error = L"Failed to read " + path;
+            return std::nullopt;
+        }
+
+        try
+        {
+            Scenario scenario = defaults;
+            scenario.monitors.clear();
+            scenario.windowCount = static_cast<int>(json->GetNamedNumber(NonLocalizable::ScenarioIds::WindowsID, defaults.windowCount));
+            scenario.moveWindowAcrossMonitors = json->GetNamedBoolean(NonLocalizable::ScenarioIds::MoveWindowAcrossMonitorsID, defaults.moveWindowAcrossMonitors);
+
+            if (json->HasKey(NonLocalizable::CustomLayoutsIds::CustomLayoutsArrayID))
+            {
+                scenario.customLayouts = json->GetNamedArray(NonLocalizable::CustomLayoutsIds::CustomLayoutsArrayID);
+            }
+
+            for (const auto& value : json->GetNamedArray(NonLocalizable::ScenarioIds::MonitorsID))
+            {
+                const auto monitor = value.GetObjectW();
+                const auto left = static_cast<LONG>(monitor.GetNamedNumber(NonLocalizable::ScenarioIds::LeftID, 0));
+                const auto top = static_cast<LONG>(monitor.GetNamedNumber(NonLocalizable::ScenarioIds::TopID, 0));
+                const auto width = static_cast<LONG>(monitor.GetNamedNumber(NonLocalizable::ScenarioIds::WidthID));
+                const auto height = static_cast<LONG>(monitor.GetNamedNumber(NonLocalizable::ScenarioIds::HeightID));
+                if (width <= 0 || height <= 0)
+                {
+                    error = L"Monitors need a positive width and height";
+                    return std::nullopt;
+                }
+
+                const auto layout = ParseLayout(monitor.GetNamedObject(NonLocalizable::AppliedLayoutsIds::AppliedLayoutID), error);
+                if (!layout)
+                {
+                    return std::nullopt;
+                }
+
+                scenario.monitors.push_back(SimulatedMonitor{ .workArea = RECT{ left, top, left + width, top + height }, .layout = layout.value() });
+            }
+
+            if (scenario.monitors.empty() || scenario.windowCount <= 0)
+            {
+                error = L"The scenario needs at least one monitor and one window";
+                return std::nullopt;
+            }
+
+            return scenario;
+        }
+        catch (const winrt::hresult_error& e)
+        {
+            error = L"Invalid scenario " + path + L": " + std::wstring{ e.message() };
+            return std::nullopt;
+        }
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "SnapSimulator.h"
+
+namespace FancyZonesSimulator
+{
+    // Reads monitors and layouts from a JSON file:
+    // {
+    //   "windows": 32,                        // optional
+    //   "move-window-across-monitors": true,  // optional
+    //   "monitors": [
+    //     { "left": 0, "top": 0, "width": 2560, "height": 1400,
+    //       "applied-layout": { "uuid": "{...}", "type": "custom", "show-spacing": true, "spacing": 16, "zone-count": 4, "sensitivity-radius": 20 } }
+    //   ],
+    //   "custom-layouts": [ ... ]             // optional, entries as in custom-layouts.json
+    // }
+    // "applied-layout" is written as in applied-layouts.json, the uuid is only needed for custom layouts.
+    // Values missing from the file are taken from defaults. Returns nullopt and fills error when the file can't be used.
+    std::optional<Scenario> LoadScenario(const std::wstring& path, const Scenario& defaults, std::wstring& error);
+}
@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "SimulatedWindowSystem.h"
+
+namespace NonLocalizable
+{
+    const wchar_t SimulatedProcessPath[] = L"C:\\Simulated\\SimulatedApp.exe";
+}
+
+namespace
+{
+    constexpr DWORD SimulatedProcessId = 4242;
+}
+
+namespace FancyZonesSimulator
+{
+    HWND SimulatedWindowSystem::AddWindow()
+    {
+        // handles are aligned like real ones and never zero
+        const auto window = reinterpret_cast<HWND>(static_cast<uintptr_t>(m_windows.size() + 1) << 4);
+        m_windows.insert({ window, Window{} });
+        return window;
+    }
+
+    std::optional<RECT> SimulatedWindowSystem::ZoneRect(HWND window) const noexcept
+    {
+        const auto iter = m_windows.find(window);
+        return iter != m_windows.end() ? iter->second.zoneRect : std::nullopt;
+    }
+
+    size_t SimulatedWindowSystem::MoveCount() const noexcept
+    {
+        return m_moveCount;
+    }
+
+    bool SimulatedWindowSystem::IsWindow(HWND window) const
+    {
+        return m_windows.contains(window);
+    }
+
+    void SimulatedWindowSystem::SizeWindowToZone(HWND window, RECT rect, HWND /*windowOfRect*/)
+    {
+        const auto iter = m_windows.find(window);
+        if (iter != m_windows.end())
+        {
+            iter->second.zoneRect = rect;
+            m_moveCount++;
+        }
+    }
+
+    void SimulatedWindowSystem::RestoreWindowSizeAndOrigin(HWND window)
+    {
+        const auto iter = m_windows.find(window);
+        if (iter != m_windows.end())
+        {
+            iter->second.zoneRect.reset();
+        }
+    }
+
+    void SimulatedWindowSystem::SwitchToWindow(HWND /*window*/)
+    {
+    }
+
+    void SimulatedWindowSystem::DisableRoundCorners(HWND /*window*/)
+    {
+    }
+
+    HANDLE SimulatedWindowSystem::GetProperty(HWND window, const wchar_t* name) const
+    {
+        const auto iter = m_windows.find(window);
+        if (iter == m_windows.end())
+        {
+            return nullptr;
+        }
+
+        for (const auto& [propertyName, data] : iter->second.properties)
+        {
+            if (propertyName == name)
+            {
+                return data;
+            }
+        }
+
+        return nullptr;
+    }
+
+    bool SimulatedWindowSystem::SetProperty(HWND window, const wchar_t* name, HANDLE data)
+    {
+        const auto iter = m_windows.find(window);
+        if (iter == m_windows.end())
+        {
+            return false;
+        }
+
+        for (auto& [propertyName, propertyData] : iter->second.properties)
+        {
+            if (propertyName == name)
+            {
+                propertyData = data;
+                return true;
+            }
+        }
+
+        iter->second.properties.emplace_back(name, data);
+        return true;
+    }
+
+    void SimulatedWindowSystem::RemoveProperty(HWND window, const wchar_t* name)
+    {
+        const auto iter = m_windows.find(window);
+        if (iter == m_windows.end())
+        {
+            return;
+        }
+
+        for (auto& [propertyName, data] : iter->second.properties)
+        {
+            if (propertyName == name)
+            {
+                data = nullptr;
+            }
+        }
+    }
+
+    std::wstring SimulatedWindowSystem::GetProcessPath(HWND window) const
+    {
+        return IsWindow(window) ? NonLocalizable::SimulatedProcessPath : L"";
+    }
+
+    DWORD SimulatedWindowSystem::GetProcessId(HWND window) const
+    {
+        return IsWindow(window) ? SimulatedProcessId : 0;
+    }
+}
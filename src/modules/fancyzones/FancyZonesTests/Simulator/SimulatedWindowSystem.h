@@ -0,0 +1,42 @@
+#pragma once
+
+#include <FancyZonesLib/WindowSystem.h>
+
+namespace FancyZonesSimulator
+{
+    // Windows that only exist in memory: handles are made up, properties are kept in a table and moving a window into a
+    // zone only records the zone rect. Every window belongs to the same simulated process.
+    class SimulatedWindowSystem : public WindowSystem
+    {
+    public:
+        HWND AddWindow();
+
+        // Zone rect of the last SizeWindowToZone, in the coordinates of the work area
+        std::optional<RECT> ZoneRect(HWND window) const noexcept;
+        size_t MoveCount() const noexcept;
+
+        bool IsWindow(HWND window) const override;
+        void SizeWindowToZone(HWND window, RECT rect, HWND windowOfRect) override;
+        void RestoreWindowSizeAndOrigin(HWND window) override;
+        void SwitchToWindow(HWND window) override;
+        void DisableRoundCorners(HWND window) override;
+
+        HANDLE GetProperty(HWND window, const wchar_t* name) const override;
+        bool SetProperty(HWND window, const wchar_t* name, HANDLE data) override;
+        void RemoveProperty(HWND window, const wchar_t* name) override;
+
+        std::wstring GetProcessPath(HWND window) const override;
+        DWORD GetProcessId(HWND window) const override;
+
+    private:
+        struct Window
+        {
+            std::optional<RECT> zoneRect;
+            // removed properties keep their entry with a null handle, so snapping back and forth doesn't allocate
+            std::vector<std::pair<std::wstring, HANDLE>> properties;
+        };
+
+        std::unordered_map<HWND, Window> m_windows;
+        size_t m_moveCount{};
+    };
+}
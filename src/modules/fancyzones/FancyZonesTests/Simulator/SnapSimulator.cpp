@@ -0,0 +1,258 @@
+#include "pch.h"
+#include "SnapSimulator.h"
+
+#include <filesystem>
+
+#include <FancyZonesLib/FancyZonesData/AppliedLayouts.h>
+#include <FancyZonesLib/FancyZonesData/AppZoneHistory.h>
+#include <FancyZonesLib/FancyZonesData/CustomLayouts.h>
+#include <FancyZonesLib/Settings.h>
+
+#include "AllocationCounter.h"
+
+namespace NonLocalizable
+{
+    const wchar_t VirtualDesktopId[] = L"{A998CA86-F08D-4BCA-AED8-77F5C8FC9925}";
+}
+
+namespace FancyZonesSimulator
+{
+    double BenchmarkResult::OperationsPerSecond() const noexcept
+    {
+        return seconds > 0 ? operations / seconds : 0;
+    }
+
+    SnapSimulator::SnapSimulator(const Scenario& scenario) :
+        m_scenario(scenario),
+        m_random(scenario.seed)
+    {
+        WindowSystem::SetInstance(&m_windowSystem);
+        FancyZonesSettings::instance().SetSettings(Settings{ .moveWindowAcrossMonitors = scenario.moveWindowAcrossMonitors });
+
+        if (scenario.customLayouts)
+        {
+            json::JsonObject root{};
+            root.SetNamedValue(NonLocalizable::CustomLayoutsIds::CustomLayoutsArrayID, scenario.customLayouts);
+            json::to_file(CustomLayouts::CustomLayoutsFileName(), root);
+        }
+
+        CustomLayouts::instance().LoadData();
+
+        const auto virtualDesktopId = FancyZonesUtils::GuidFromString(NonLocalizable::VirtualDesktopId).value();
+
+        std::vector<FancyZonesDataTypes::WorkAreaId> workAreaIds;
+        AppliedLayouts::TAppliedLayoutsMap appliedLayouts;
+        for (size_t i = 0; i < scenario.monitors.size(); i++)
+        {
+            const auto monitor = reinterpret_cast<HMONITOR>(i + 1);
+            const auto number = std::to_wstring(i + 1);
+
+            FancyZonesDataTypes::WorkAreaId id{
+                .monitorId = {
+                    .monitor = monitor,
+                    .deviceId = {
+                        .id = L"simulated-device-" + number,
+                        .instanceId = L"simulated-instance-" + number,
+                        .number = static_cast<int>(i + 1),
+                    },
+                    .serialNumber = L"simulated-serial-number-" + number },
+                .virtualDesktopId = virtualDesktopId
+            };
+
+            appliedLayouts.insert({ id, scenario.monitors[i].layout });
+            workAreaIds.push_back(id);
+            m_monitors.emplace_back(monitor, scenario.monitors[i].workArea);
+        }
+
+        AppliedLayouts::instance().SetAppliedLayouts(appliedLayouts);
+        AppZoneHistory::instance().LoadData();
+
+        for (size_t i = 0; i < workAreaIds.size(); i++)
+        {
+            auto workArea = WorkArea::Create(nullptr, workAreaIds[i], {}, FancyZonesUtils::Rect(scenario.monitors[i].workArea));
+            if (workArea)
+            {
+                m_workAreas.insert({ m_monitors[i].first, std::move(workArea) });
+            }
+        }
+
+        for (int i = 0; i < scenario.windowCount && !m_monitors.empty(); i++)
+        {
+            const HWND window = m_windowSystem.AddWindow();
+            const auto& [monitor, monitorRect] = m_monitors[m_random() % m_monitors.size()];
+            const POINT topLeft = RandomPoint(monitorRect);
+            const LONG width = std::max<LONG>(1, (monitorRect.right - topLeft.x) / 2);
+            const LONG height = std::max<LONG>(1, (monitorRect.bottom - topLeft.y) / 2);
+            m_windows.push_back(SimulatedWindow{ window, monitor, RECT{ topLeft.x, topLeft.y, topLeft.x + width, topLeft.y + height } });
+        }
+    }
+
+    SnapSimulator::~SnapSimulator()
+    {
+        m_workAreas.clear();
+        WindowSystem::SetInstance(nullptr);
+
+        std::filesystem::remove(AppliedLayouts::AppliedLayoutsFileName());
+        std::filesystem::remove(AppZoneHistory::AppZoneHistoryFileName());
+        std::filesystem::remove(CustomLayouts::CustomLayoutsFileName());
+    }
+
+    bool SnapSimulator::IsValid() const noexcept
+    {
+        return !m_monitors.empty() && m_workAreas.size() == m_monitors.size() && !m_windows.empty();
+    }
+
+    size_t SnapSimulator::ZoneCount() const noexcept
+    {
+        size_t count = 0;
+        for (const auto& [_, workArea] : m_workAreas)
+        {
+            if (workArea->GetLayout())
+            {
+                count += workArea->GetLayout()->Zones().size();
+            }
+        }
+
+        return count;
+    }
+
+    template<typename Fn>
+    BenchmarkResult SnapSimulator::Measure(std::wstring name, size_t count, Fn&& operation)
+    {
+        BenchmarkResult result{ .name = std::move(name), .operations = count };
+
+        const auto allocationsBefore = AllocationCounter::Current();
+        const auto start = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (operation())
+            {
+                result.succeeded++;
+            }
+        }
+
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const auto allocationsAfter = AllocationCounter::Current();
+        result.allocations = allocationsAfter.count - allocationsBefore.count;
+        result.allocatedBytes = allocationsAfter.bytes - allocationsBefore.bytes;
+
+        return result;
+    }
+
+    BenchmarkResult SnapSimulator::RunHitTests(size_t count)
+    {
+        return Measure(L"Hit-tests", count, [&]() {
+            const auto& [monitor, monitorRect] = m_monitors[m_random() % m_monitors.size()];
+            const auto& layout = m_workAreas.at(monitor)->GetLayout();
+            POINT point = RandomPoint(monitorRect);
+            point.x -= monitorRect.left;
+            point.y -= monitorRect.top;
+            return layout && !layout->ZonesFromPoint(point).empty();
+        });
+    }
+
+    BenchmarkResult SnapSimulator::RunDrags(size_t count, bool selectManyZones)
+    {
+        int step = m_scenario.dragLength;
+        POINT start{}, end{};
+        const Layout* layout = nullptr;
+
+        // every operation is one hit-test along a straight drag path, a new drag starts when the previous one is finished
+        return Measure(selectManyZones ? L"Drags (select many zones)" : L"Drags", count, [&]() {
+            if (step >= m_scenario.dragLength)
+            {
+                const auto& [monitor, monitorRect] = m_monitors[m_random() % m_monitors.size()];
+                layout = m_workAreas.at(monitor)->GetLayout().get();
+                start = RandomPoint(monitorRect);
+                end = RandomPoint(monitorRect);
+                start.x -= monitorRect.left;
+                start.y -= monitorRect.top;
+                end.x -= monitorRect.left;
+                end.y -= monitorRect.top;
+                step = 0;
+                m_highlightedZones.Reset();
+            }
+
+            const POINT point{
+                .x = start.x + MulDiv(end.x - start.x, step, m_scenario.dragLength),
+                .y = start.y + MulDiv(end.y - start.y, step, m_scenario.dragLength),
+            };
+            step++;
+
+            m_highlightedZones.Update(layout, point, selectManyZones);
+            return !m_highlightedZones.Empty();
+        });
+    }
+
+    BenchmarkResult SnapSimulator::RunKeyboardSnaps(size_t count)
+    {
+        return Measure(L"Keyboard snaps", count, [&]() {
+            auto& window = RandomWindow();
+            const bool snapped = m_keyboardSnap.Snap(window.window, window.rect, window.monitor, RandomDirection(), m_workAreas, m_monitors);
+            if (snapped)
+            {
+                UpdateWindowPosition(window);
+            }
+
+            return snapped;
+        });
+    }
+
+    BenchmarkResult SnapSimulator::RunKeyboardExtends(size_t count)
+    {
+        return Measure(L"Keyboard extends", count, [&]() {
+            auto& window = RandomWindow();
+            const bool extended = m_keyboardSnap.Extend(window.window, window.rect, window.monitor, RandomDirection(), m_workAreas);
+            if (extended)
+            {
+                UpdateWindowPosition(window);
+            }
+
+            return extended;
+        });
+    }
+
+    POINT SnapSimulator::RandomPoint(const RECT& rect) noexcept
+    {
+        const auto width = std::max<LONG>(1, rect.right - rect.left);
+        const auto height = std::max<LONG>(1, rect.bottom - rect.top);
+        return POINT{ rect.left + static_cast<LONG>(m_random() % width), rect.top + static_cast<LONG>(m_random() % height) };
+    }
+
+    DWORD SnapSimulator::RandomDirection() noexcept
+    {
+        constexpr DWORD directions[] = { VK_LEFT, VK_RIGHT, VK_UP, VK_DOWN };
+        return directions[m_random() % std::size(directions)];
+    }
+
+    SnapSimulator::SimulatedWindow& SnapSimulator::RandomWindow() noexcept
+    {
+        return m_windows[m_random() % m_windows.size()];
+    }
+
+    void SnapSimulator::UpdateWindowPosition(SimulatedWindow& window) noexcept
+    {
+        const auto zoneRect = m_windowSystem.ZoneRect(window.window);
+        if (!zoneRect)
+        {
+            return;
+        }
+
+        // the zone rect is relative to the work area the window was snapped in
+        for (const auto& [monitor, workArea] : m_workAreas)
+        {
+            if (!workArea->GetLayoutWindows().GetZoneIndexSetFromWindow(window.window).empty())
+            {
+                const auto& workAreaRect = workArea->GetWorkAreaRect();
+                RECT rect = zoneRect.value();
+                OffsetRect(&rect, workAreaRect.left(), workAreaRect.top());
+
+                window.rect = rect;
+                window.monitor = monitor;
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <common/utils/json.h>
+
+#include <FancyZonesLib/FancyZonesData/LayoutData.h>
+#include <FancyZonesLib/HighlightedZones.h>
+#include <FancyZonesLib/WindowKeyboardSnap.h>
+#include <FancyZonesLib/WorkArea.h>
+
+#include "SimulatedWindowSystem.h"
+
+namespace FancyZonesSimulator
+{
+    struct SimulatedMonitor
+    {
+        RECT workArea{}; // screen coordinates
+        LayoutData layout{};
+    };
+
+    struct Scenario
+    {
+        std::vector<SimulatedMonitor> monitors;
+        json::JsonArray customLayouts{ nullptr }; // entries of custom-layouts.json the monitor layouts refer to
+        int windowCount = 16;
+        int dragLength = 64; // hit-tests per simulated drag
+        bool moveWindowAcrossMonitors = true;
+        unsigned int seed = 42;
+    };
+
+    struct BenchmarkResult
+    {
+        std::wstring name;
+        size_t operations{};
+        size_t succeeded{};
+        double seconds{};
+        size_t allocations{};
+        size_t allocatedBytes{};
+
+        double OperationsPerSecond() const noexcept;
+    };
+
+    // Drives the FancyZonesLib snapping core headlessly: work areas are created in UNIT_TESTS mode (without zones overlay windows)
+    // and SimulatedWindowSystem is installed, so no window on the desktop is created or moved.
+    class SnapSimulator
+    {
+    public:
+        explicit SnapSimulator(const Scenario& scenario);
+        ~SnapSimulator();
+
+        bool IsValid() const noexcept;
+        size_t ZoneCount() const noexcept;
+
+        BenchmarkResult RunHitTests(size_t count);
+        BenchmarkResult RunDrags(size_t count, bool selectManyZones);
+        BenchmarkResult RunKeyboardSnaps(size_t count);
+        BenchmarkResult RunKeyboardExtends(size_t count);
+
+    private:
+        struct SimulatedWindow
+        {
+            HWND window{};
+            HMONITOR monitor{};
+            RECT rect{}; // screen coordinates
+        };
+
+        template<typename Fn>
+        BenchmarkResult Measure(std::wstring name, size_t count, Fn&& operation);
+
+        POINT RandomPoint(const RECT& rect) noexcept;
+        DWORD RandomDirection() noexcept;
+        SimulatedWindow& RandomWindow() noexcept;
+        void UpdateWindowPosition(SimulatedWindow& window) noexcept;
+
+        const Scenario m_scenario;
+        std::mt19937 m_random;
+        std::vector<std::pair<HMONITOR, RECT>> m_monitors;
+        std::unordered_map<HMONITOR, std::unique_ptr<WorkArea>> m_workAreas;
+        SimulatedWindowSystem m_windowSystem;
+        std::vector<SimulatedWindow> m_windows;
+        WindowKeyboardSnap m_keyboardSnap;
+        HighlightedZones m_highlightedZones;
+    };
+}
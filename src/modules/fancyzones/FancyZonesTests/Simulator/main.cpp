@@ -0,0 +1,204 @@
+#include "pch.h"
+
+#include <iostream>
+#include <string>
+
+#include "ScenarioFile.h"
+#include "SnapSimulator.h"
+
+using namespace FancyZonesSimulator;
+
+namespace
+{
+    struct Options
+    {
+        std::wstring scenarioFile;
+        int monitors = 2;
+        int width = 2560;
+        int height = 1440;
+        FancyZonesDataTypes::ZoneSetLayoutType layoutType = FancyZonesDataTypes::ZoneSetLayoutType::PriorityGrid;
+        int zoneCount = 6;
+        int spacing = 16;
+        int sensitivityRadius = 20;
+        int windows = 32;
+        size_t iterations = 100000;
+        unsigned int seed = 42;
+    };
+
+    void PrintUsage()
+    {
+        std::wcout << L"Usage: FancyZonesSimulator.exe [options]\n"
+                   << L"  --scenario <file>       monitors and layouts from a JSON file, see ScenarioFile.h;\n"
+                   << L"                          replaces the monitor and layout options\n"
+                   << L"  --monitors <n>          number of side-by-side monitors (default 2)\n"
+                   << L"  --resolution <w>x<h>    work area size of every monitor (default 2560x1440)\n"
+                   << L"  --layout <type>         focus, columns, rows, grid, priority-grid (default priority-grid)\n"
+                   << L"  --zones <n>             zone count (default 6)\n"
+                   << L"  --spacing <n>           zone spacing, 0 disables spacing (default 16)\n"
+                   << L"  --sensitivity <n>       sensitivity radius (default 20)\n"
+                   << L"  --windows <n>           number of synthetic windows (default 32)\n"
+                   << L"  --iterations <n>        operations per benchmark (default 100000)\n"
+                   << L"  --seed <n>              random seed (default 42)\n";
+    }
+
+    bool ParseOptions(int argc, wchar_t* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::wstring arg = argv[i];
+            if (i + 1 >= argc)
+            {
+                return false;
+            }
+
+            const std::wstring value = argv[++i];
+            try
+            {
+                if (arg == L"--scenario")
+                {
+                    options.scenarioFile = value;
+                }
+                else if (arg == L"--monitors")
+                {
+                    options.monitors = std::stoi(value);
+                }
+                else if (arg == L"--resolution")
+                {
+                    const auto separator = value.find(L'x');
+                    if (separator == std::wstring::npos)
+                    {
+                        return false;
+                    }
+
+                    options.width = std::stoi(value.substr(0, separator));
+                    options.height = std::stoi(value.substr(separator + 1));
+                }
+                else if (arg == L"--layout")
+                {
+                    options.layoutType = FancyZonesDataTypes::TypeFromString(value);
+                    if (options.layoutType == FancyZonesDataTypes::ZoneSetLayoutType::Custom || options.layoutType == FancyZonesDataTypes::ZoneSetLayoutType::Blank)
+                    {
+                        return false;
+                    }
+                }
+                else if (arg == L"--zones")
+                {
+                    options.zoneCount = std::stoi(value);
+                }
+                else if (arg == L"--spacing")
+                {
+                    options.spacing = std::stoi(value);
+                }
+                else if (arg == L"--sensitivity")
+                {
+                    options.sensitivityRadius = std::stoi(value);
+                }
+                else if (arg == L"--windows")
+                {
+                    options.windows = std::stoi(value);
+                }
+                else if (arg == L"--iterations")
+                {
+                    options.iterations = std::stoull(value);
+                }
+                else if (arg == L"--seed")
+                {
+                    options.seed = static_cast<unsigned int>(std::stoul(value));
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+        }
+
+        return options.monitors > 0 && options.width > 0 && options.height > 0 && options.zoneCount > 0 && options.windows > 0;
+    }
+
+    void PrintResult(const BenchmarkResult& result)
+    {
+        const double operations = static_cast<double>(result.operations);
+        wprintf(L"%-28ls %12.0f ops/s %10.3f us/op %8.2f allocs/op %10.1f bytes/op %6.1f%% succeeded\n",
+                result.name.c_str(),
+                result.OperationsPerSecond(),
+                operations > 0 ? result.seconds * 1e6 / operations : 0.0,
+                operations > 0 ? result.allocations / operations : 0.0,
+                operations > 0 ? result.allocatedBytes / operations : 0.0,
+                operations > 0 ? result.succeeded * 100.0 / operations : 0.0);
+    }
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    Scenario scenario{
+        .windowCount = options.windows,
+        .seed = options.seed,
+    };
+
+    if (!options.scenarioFile.empty())
+    {
+        std::wstring error;
+        auto loaded = LoadScenario(options.scenarioFile, scenario, error);
+        if (!loaded)
+        {
+            std::wcerr << error << L"\n";
+            return 1;
+        }
+
+        scenario = std::move(loaded.value());
+    }
+    else
+    {
+        const LayoutData layout{
+            .uuid = GUID_NULL,
+            .type = options.layoutType,
+            .showSpacing = options.spacing > 0,
+            .spacing = options.spacing,
+            .zoneCount = options.zoneCount,
+            .sensitivityRadius = options.sensitivityRadius
+        };
+
+        for (int i = 0; i < options.monitors; i++)
+        {
+            scenario.monitors.push_back(SimulatedMonitor{ .workArea = RECT{ i * options.width, 0, (i + 1) * options.width, options.height }, .layout = layout });
+        }
+    }
+
+    SnapSimulator simulator(scenario);
+    if (!simulator.IsValid())
+    {
+        std::wcerr << L"Failed to initialize the simulated work areas\n";
+        return 1;
+    }
+
+    for (const auto& monitor : scenario.monitors)
+    {
+        wprintf(L"monitor %ldx%ld at (%ld, %ld), layout %ls\n",
+                monitor.workArea.right - monitor.workArea.left,
+                monitor.workArea.bottom - monitor.workArea.top,
+                monitor.workArea.left,
+                monitor.workArea.top,
+                FancyZonesDataTypes::TypeToString(monitor.layout.type).c_str());
+    }
+
+    wprintf(L"%zu zones in total, %d windows, %zu iterations\n\n", simulator.ZoneCount(), scenario.windowCount, options.iterations);
+
+    PrintResult(simulator.RunHitTests(options.iterations));
+    PrintResult(simulator.RunDrags(options.iterations, false));
+    PrintResult(simulator.RunDrags(options.iterations, true));
+    PrintResult(simulator.RunKeyboardSnaps(options.iterations));
+    PrintResult(simulator.RunKeyboardExtends(options.iterations));
+
+    return 0;
+}
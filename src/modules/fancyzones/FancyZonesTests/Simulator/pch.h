@@ -0,0 +1,10 @@
+#pragma once
+
+#include <Windows.h>
+#include <winrt/base.h>
+#include <winrt/Windows.Foundation.h>
+#include <winrt/Windows.Foundation.Collections.h>
+#include "FancyZonesLib/pch.h"
+
+#include <chrono>
+#include <random>
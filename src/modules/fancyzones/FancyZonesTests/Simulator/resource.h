@@ -0,0 +1,13 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by FancyZonesSimulator.rc
+
+//////////////////////////////
+// Non-localizable
+
+#define FILE_DESCRIPTION "PowerToys FancyZones Simulator"
+#define INTERNAL_NAME "FancyZonesSimulator"
+#define ORIGINAL_FILENAME "FancyZonesSimulator.exe"
+
+// Non-localizable
+//////////////////////////////
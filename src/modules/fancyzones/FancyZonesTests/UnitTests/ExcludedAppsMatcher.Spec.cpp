@@ -0,0 +1,94 @@
+#include "pch.h"
+
+#include <common/utils/excluded_apps.h>
+
+#include <FancyZonesLib/ExcludedAppsMatcher.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (ExcludedAppsMatcherUnitTests)
+    {
+        const std::vector<std::wstring> m_patterns = { L"NOTEPAD.EXE", L"CALC", L"POWERTOYS.FANCYZONESEDITOR.EXE", L"APP\\TOOL" };
+
+        void AssertSameAsReference(const std::vector<std::wstring>& patterns, const std::wstring& path)
+        {
+            ExcludedAppsMatcher matcher(patterns);
+            Assert::AreEqual(find_app_name_in_path(path, patterns), matcher.MatchesAppName(path), path.c_str());
+            Assert::AreEqual(find_folder_in_path(path, patterns), matcher.MatchesAnywhere(path), path.c_str());
+        }
+
+        TEST_METHOD (EmptyMatcher)
+        {
+            ExcludedAppsMatcher matcher;
+            Assert::IsTrue(matcher.Empty());
+            Assert::IsFalse(matcher.MatchesAppName(L"C:\\WINDOWS\\NOTEPAD.EXE"));
+            Assert::IsFalse(matcher.MatchesAnywhere(L"C:\\WINDOWS\\NOTEPAD.EXE"));
+        }
+
+        TEST_METHOD (MatchesAppName)
+        {
+            ExcludedAppsMatcher matcher(m_patterns);
+            Assert::IsFalse(matcher.Empty());
+            Assert::IsTrue(matcher.MatchesAppName(L"C:\\WINDOWS\\NOTEPAD.EXE"));
+            Assert::IsTrue(matcher.MatchesAppName(L"C:\\WINDOWS\\SYSTEM32\\CALC.EXE"));
+            Assert::IsTrue(matcher.MatchesAppName(L"C:\\PROGRAMS\\APP\\TOOL.EXE"));
+        }
+
+        TEST_METHOD (DoesNotMatchFolderName)
+        {
+            ExcludedAppsMatcher matcher(m_patterns);
+            Assert::IsFalse(matcher.MatchesAppName(L"C:\\CALC\\EDITOR.EXE"));
+            Assert::IsTrue(matcher.MatchesAnywhere(L"C:\\CALC\\EDITOR.EXE"));
+        }
+
+        TEST_METHOD (LastOccurrenceDecides)
+        {
+            // the last occurrence of the pattern is in the folder name
+            ExcludedAppsMatcher matcher({ L"APP" });
+            Assert::IsFalse(matcher.MatchesAppName(L"C:\\APP\\APP\\EDITOR.EXE"));
+            Assert::IsTrue(matcher.MatchesAppName(L"C:\\APP\\APP\\APP.EXE"));
+        }
+
+        TEST_METHOD (OverlappingPatterns)
+        {
+            ExcludedAppsMatcher matcher({ L"ABCD", L"BC", L"BCDE", L"C" });
+            Assert::IsTrue(matcher.MatchesAnywhere(L"XXABCXX"));
+            Assert::IsTrue(matcher.MatchesAppName(L"C:\\X\\BCX.EXE"));
+            Assert::IsFalse(matcher.MatchesAnywhere(L"XXABXX"));
+        }
+
+        TEST_METHOD (PathWithoutSlash)
+        {
+            ExcludedAppsMatcher matcher(m_patterns);
+            Assert::IsFalse(matcher.MatchesAppName(L"NOTEPAD.EXE"));
+            Assert::IsTrue(matcher.MatchesAnywhere(L"NOTEPAD.EXE"));
+        }
+
+        TEST_METHOD (SameResultAsReference)
+        {
+            const std::vector<std::wstring> paths = {
+                L"",
+                L"\\",
+                L"C:\\",
+                L"C:\\WINDOWS\\NOTEPAD.EXE",
+                L"C:\\NOTEPAD.EXE\\NOTEPAD.EXE",
+                L"C:\\NOTEPAD.EXE\\OTHER.EXE",
+                L"C:\\PROGRAMS\\APP\\TOOL.EXE",
+                L"C:\\PROGRAMS\\APP\\TOOLS\\CALC",
+                L"C:\\PROGRAM FILES\\POWERTOYS\\POWERTOYS.FANCYZONESEDITOR.EXE",
+                L"C:\\WINDOWS\\SYSTEMAPPS\\MICROSOFT.WINDOWS.SEARCH\\SEARCHAPP.EXE",
+            };
+
+            for (const auto& path : paths)
+            {
+                AssertSameAsReference(m_patterns, path);
+                AssertSameAsReference({ L"" }, path);
+                AssertSameAsReference({ L"\\" }, path);
+                AssertSameAsReference({ L"SYSTEMAPPS" }, path);
+                AssertSameAsReference({ L"EXE", L"E", L"\\N" }, path);
+            }
+        }
+    };
+}
@@ -8,6 +8,7 @@
 #include <FancyZonesLib/FancyZonesData/DefaultLayouts.h>
 #include <FancyZonesLib/FancyZonesWindowProperties.h>
 #include <FancyZonesLib/LayoutAssignedWindows.h>
+#include <FancyZonesLib/WindowSystem.h>
 #include "Util.h"
 
 #include <common/utils/process_path.h>
@@ -376,4 +377,114 @@ namespace FancyZonesUnitTests
             Assert::IsTrue(layoutWindows.GetZoneIndexSetFromWindow(window).empty());
         }
     };
+
+    TEST_CLASS (WorkAreaWindowSystemUnitTests)
+    {
+        // Records what zoning asks of windows that don't exist
+        class FakeWindowSystem : public WindowSystem
+        {
+        public:
+            HWND window = reinterpret_cast<HWND>(0x1230);
+            std::optional<RECT> zoneRect;
+            std::map<std::wstring, HANDLE> properties;
+
+            bool IsWindow(HWND hwnd) const override { return hwnd == window; }
+            void SizeWindowToZone(HWND, RECT rect, HWND) override { zoneRect = rect; }
+            void RestoreWindowSizeAndOrigin(HWND) override { zoneRect.reset(); }
+            void SwitchToWindow(HWND) override {}
+            void DisableRoundCorners(HWND) override {}
+
+            HANDLE GetProperty(HWND, const wchar_t* name) const override
+            {
+                const auto iter = properties.find(name);
+                return iter != properties.end() ? iter->second : nullptr;
+            }
+
+            bool SetProperty(HWND, const wchar_t* name, HANDLE data) override
+            {
+                properties[name] = data;
+                return true;
+            }
+
+            void RemoveProperty(HWND, const wchar_t* name) override { properties.erase(name); }
+
+            std::wstring GetProcessPath(HWND) const override { return L"C:\\Fake\\FakeApp.exe"; }
+            DWORD GetProcessId(HWND) const override { return 1234; }
+        };
+
+        FakeWindowSystem m_windowSystem;
+        HINSTANCE m_hInst{};
+        const FancyZonesUtils::Rect m_workAreaRect{ RECT(0, 0, 1920, 1080) };
+        const FancyZonesDataTypes::WorkAreaId m_workAreaId = {
+            .monitorId = {
+                .monitor = Mocks::Monitor(),
+                .deviceId = {
+                    .id = L"device-id-1",
+                    .instanceId = L"5&10a58c63&0&UID16777488",
+                    .number = 1,
+                },
+                .serialNumber = L"serial-number-1" },
+            .virtualDesktopId = FancyZonesUtils::GuidFromString(L"{310F2924-B587-4D87-97C2-90031BDBE3F1}").value()
+        };
+
+        TEST_METHOD_INITIALIZE(Init) noexcept
+        {
+            WindowSystem::SetInstance(&m_windowSystem);
+            AppZoneHistory::instance().LoadData();
+        }
+
+        TEST_METHOD_CLEANUP(CleanUp) noexcept
+        {
+            WindowSystem::SetInstance(nullptr);
+            std::filesystem::remove(AppZoneHistory::AppZoneHistoryFileName());
+        }
+
+        TEST_METHOD (SnapMovesWindowToCombinedZonesRect)
+        {
+            const auto workArea = WorkArea::Create(m_hInst, m_workAreaId, {}, m_workAreaRect);
+            const ZoneIndexSet zones = { 1, 2 };
+
+            Assert::IsTrue(workArea->Snap(m_windowSystem.window, zones, true));
+
+            Assert::IsTrue(m_windowSystem.zoneRect.has_value());
+            const RECT expected = workArea->GetLayout()->GetCombinedZonesRect(zones);
+            Assert::AreEqual(expected.left, m_windowSystem.zoneRect->left);
+            Assert::AreEqual(expected.top, m_windowSystem.zoneRect->top);
+            Assert::AreEqual(expected.right, m_windowSystem.zoneRect->right);
+            Assert::AreEqual(expected.bottom, m_windowSystem.zoneRect->bottom);
+        }
+
+        TEST_METHOD (SnapWithoutUpdatingPositionDoesNotMoveWindow)
+        {
+            const auto workArea = WorkArea::Create(m_hInst, m_workAreaId, {}, m_workAreaRect);
+
+            Assert::IsTrue(workArea->Snap(m_windowSystem.window, { 1 }, false));
+            Assert::IsFalse(m_windowSystem.zoneRect.has_value());
+        }
+
+        TEST_METHOD (SnapStampsPropertiesAndHistoryThroughWindowSystem)
+        {
+            const auto workArea = WorkArea::Create(m_hInst, m_workAreaId, {}, m_workAreaRect);
+            const ZoneIndexSet expected = { 0, 1 };
+
+            Assert::IsTrue(workArea->Snap(m_windowSystem.window, expected));
+
+            Assert::IsFalse(m_windowSystem.properties.empty());
+            Assert::IsTrue(expected == FancyZonesWindowProperties::RetrieveZoneIndexProperty(m_windowSystem.window));
+
+            const auto history = AppZoneHistory::instance().GetZoneHistory(L"C:\\Fake\\FakeApp.exe", m_workAreaId);
+            Assert::IsTrue(history.has_value());
+            Assert::IsTrue(expected == history->zoneIndexSet);
+        }
+
+        TEST_METHOD (UnsnapRemovesPropertiesThroughWindowSystem)
+        {
+            const auto workArea = WorkArea::Create(m_hInst, m_workAreaId, {}, m_workAreaRect);
+
+            Assert::IsTrue(workArea->Snap(m_windowSystem.window, { 1 }));
+            Assert::IsTrue(workArea->Unsnap(m_windowSystem.window));
+
+            Assert::IsTrue(FancyZonesWindowProperties::RetrieveZoneIndexProperty(m_windowSystem.window).empty());
+        }
+    };
 }
@@ -0,0 +1,261 @@
+#include "pch.h"
+
+#include <filesystem>
+
+#include <FancyZonesLib/FancyZonesData/AppliedLayouts.h>
+#include <FancyZonesLib/Layout.h>
+#include <FancyZonesLib/WorkArea.h>
+#include <FancyZonesLib/ZonesAdjacency.h>
+#include <FancyZonesLib/util.h>
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FancyZonesDataTypes;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (ZonesAdjacencyUnitTests)
+    {
+        const RECT m_workArea = RECT{ 0, 0, 1920, 1080 };
+        const std::vector<DWORD> m_directions = { VK_LEFT, VK_RIGHT, VK_UP, VK_DOWN };
+
+        std::unique_ptr<Layout> CreateLayout(ZoneSetLayoutType type, int zoneCount, int spacing)
+        {
+            LayoutData data{
+                .uuid = FancyZonesUtils::GuidFromString(L"{F762BAD6-DAA1-4997-9497-E11DFEB72F21}").value(),
+                .type = type,
+                .showSpacing = spacing > 0,
+                .spacing = spacing,
+                .zoneCount = zoneCount,
+                .sensitivityRadius = 20
+            };
+
+            auto layout = std::make_unique<Layout>(data);
+            Assert::IsTrue(layout->Init(m_workArea, Mocks::Monitor()));
+            return layout;
+        }
+
+        // the zone keyboard snapping chooses by scanning, for a window occupying exactly the given zone
+        std::optional<ZoneIndex> ScanNeighbor(const ZonesMap& zones, ZoneIndex zoneId, DWORD vkCode, bool cycle)
+        {
+            std::vector<RECT> zoneRects;
+            ZoneIndexSet zoneIndices;
+            for (const auto& [id, zone] : zones)
+            {
+                if (cycle || id != zoneId)
+                {
+                    zoneRects.emplace_back(zone.GetZoneRect());
+                    zoneIndices.emplace_back(id);
+                }
+            }
+
+            RECT windowRect = zones.at(zoneId).GetZoneRect();
+            if (cycle)
+            {
+                windowRect = FancyZonesUtils::PrepareRectForCycling(windowRect, m_workArea, vkCode);
+            }
+
+            const auto result = FancyZonesUtils::ChooseNextZoneByPosition(vkCode, windowRect, zoneRects);
+            return result < zoneRects.size() ? std::optional<ZoneIndex>(zoneIndices[result]) : std::nullopt;
+        }
+
+        void AssertSameAsScan(const Layout& layout)
+        {
+            for (const auto& [zoneId, zone] : layout.Zones())
+            {
+                for (DWORD vkCode : m_directions)
+                {
+                    Assert::IsTrue(ScanNeighbor(layout.Zones(), zoneId, vkCode, false) == layout.Adjacency().Neighbor(zoneId, vkCode));
+                    Assert::IsTrue(ScanNeighbor(layout.Zones(), zoneId, vkCode, true) == layout.Adjacency().CycledNeighbor(zoneId, vkCode));
+                }
+            }
+        }
+
+        TEST_METHOD (GridNeighbors)
+        {
+            auto layout = CreateLayout(ZoneSetLayoutType::Grid, 4, 0);
+            const auto& adjacency = layout->Adjacency();
+
+            Assert::IsTrue(std::optional<ZoneIndex>(1) == adjacency.Neighbor(0, VK_RIGHT));
+            Assert::IsTrue(std::optional<ZoneIndex>(2) == adjacency.Neighbor(0, VK_DOWN));
+            Assert::IsTrue(std::optional<ZoneIndex>(0) == adjacency.Neighbor(1, VK_LEFT));
+            Assert::IsTrue(std::optional<ZoneIndex>(0) == adjacency.Neighbor(2, VK_UP));
+            Assert::IsFalse(adjacency.Neighbor(0, VK_LEFT).has_value());
+            Assert::IsFalse(adjacency.Neighbor(0, VK_UP).has_value());
+        }
+
+        TEST_METHOD (GridCycledNeighbors)
+        {
+            auto layout = CreateLayout(ZoneSetLayoutType::Grid, 4, 0);
+            const auto& adjacency = layout->Adjacency();
+
+            Assert::IsTrue(std::optional<ZoneIndex>(1) == adjacency.CycledNeighbor(0, VK_LEFT));
+            Assert::IsTrue(std::optional<ZoneIndex>(2) == adjacency.CycledNeighbor(0, VK_UP));
+            Assert::IsTrue(std::optional<ZoneIndex>(0) == adjacency.CycledNeighbor(1, VK_RIGHT));
+        }
+
+        TEST_METHOD (UnknownZoneOrDirection)
+        {
+            auto layout = CreateLayout(ZoneSetLayoutType::Grid, 4, 0);
+            const auto& adjacency = layout->Adjacency();
+
+            Assert::IsFalse(adjacency.Neighbor(4, VK_RIGHT).has_value());
+            Assert::IsFalse(adjacency.CycledNeighbor(-1, VK_RIGHT).has_value());
+            Assert::IsFalse(adjacency.Neighbor(0, VK_SPACE).has_value());
+        }
+
+        TEST_METHOD (EmptyLayout)
+        {
+            auto layout = CreateLayout(ZoneSetLayoutType::Blank, 0, 0);
+            Assert::IsFalse(layout->Adjacency().Neighbor(0, VK_RIGHT).has_value());
+        }
+
+        TEST_METHOD (SameResultAsScan)
+        {
+            for (auto type : { ZoneSetLayoutType::Focus, ZoneSetLayoutType::Columns, ZoneSetLayoutType::Rows, ZoneSetLayoutType::Grid, ZoneSetLayoutType::PriorityGrid })
+            {
+                for (int zoneCount : { 1, 2, 3, 5, 8, 13 })
+                {
+                    AssertSameAsScan(*CreateLayout(type, zoneCount, 0));
+                    AssertSameAsScan(*CreateLayout(type, zoneCount, 16));
+                }
+            }
+        }
+    };
+
+    TEST_CLASS (MonitorsZonesAdjacencyUnitTests)
+    {
+        const RECT m_workAreaRect = RECT{ 0, 0, 1920, 1080 };
+        const HMONITOR m_monitorLeft = Mocks::Monitor();
+        const HMONITOR m_monitorRight = Mocks::Monitor();
+
+        std::unordered_map<HMONITOR, std::unique_ptr<WorkArea>> m_workAreas;
+        std::vector<std::pair<HMONITOR, RECT>> m_monitors;
+
+        WorkAreaId Id(HMONITOR monitor, int number)
+        {
+            return WorkAreaId{
+                .monitorId = {
+                    .monitor = monitor,
+                    .deviceId = {
+                        .id = L"device-id-" + std::to_wstring(number),
+                        .instanceId = L"5&10a58c63&0&UID1677748" + std::to_wstring(number),
+                        .number = number,
+                    },
+                    .serialNumber = L"serial-number-" + std::to_wstring(number) },
+                .virtualDesktopId = FancyZonesUtils::GuidFromString(L"{310F2924-B587-4D87-97C2-90031BDBE3F1}").value()
+            };
+        }
+
+        void ApplyColumns(HMONITOR monitor, int number, int zoneCount)
+        {
+            LayoutData layout{
+                .uuid = FancyZonesUtils::GuidFromString(L"{A1B2C3D4-0000-4000-8000-00000000000" + std::to_wstring(zoneCount) + L"}").value(),
+                .type = ZoneSetLayoutType::Columns,
+                .showSpacing = false,
+                .spacing = 0,
+                .zoneCount = zoneCount,
+                .sensitivityRadius = 20
+            };
+
+            AppliedLayouts::instance().ApplyLayout(Id(monitor, number), layout);
+        }
+
+        TEST_METHOD_INITIALIZE(Init) noexcept
+        {
+            ApplyColumns(m_monitorLeft, 1, 2);
+            ApplyColumns(m_monitorRight, 2, 2);
+
+            m_workAreas.insert({ m_monitorLeft, WorkArea::Create({}, Id(m_monitorLeft, 1), {}, FancyZonesUtils::Rect(m_workAreaRect)) });
+            m_workAreas.insert({ m_monitorRight, WorkArea::Create({}, Id(m_monitorRight, 2), {}, FancyZonesUtils::Rect(m_workAreaRect)) });
+
+            m_monitors = {
+                { m_monitorLeft, RECT{ 0, 0, 1920, 1080 } },
+                { m_monitorRight, RECT{ 1920, 0, 3840, 1080 } },
+            };
+        }
+
+        TEST_METHOD_CLEANUP(CleanUp) noexcept
+        {
+            m_workAreas.clear();
+            std::filesystem::remove(AppliedLayouts::AppliedLayoutsFileName());
+        }
+
+        bool IsNeighbor(const MonitorsZonesAdjacency& adjacency, HMONITOR monitor, ZoneIndex zone, DWORD vkCode, HMONITOR expectedMonitor, ZoneIndex expectedZone)
+        {
+            const auto target = adjacency.Neighbor(monitor, zone, vkCode);
+            return target.has_value() && target->monitor == expectedMonitor && target->zone == expectedZone;
+        }
+
+        TEST_METHOD (NeighborsOnOtherMonitor)
+        {
+            MonitorsZonesAdjacency adjacency;
+            adjacency.Update(m_workAreas, m_monitors);
+
+            Assert::IsTrue(IsNeighbor(adjacency, m_monitorLeft, 1, VK_RIGHT, m_monitorRight, 0));
+            Assert::IsTrue(IsNeighbor(adjacency, m_monitorRight, 0, VK_LEFT, m_monitorLeft, 1));
+        }
+
+        TEST_METHOD (CycledNeighbors)
+        {
+            MonitorsZonesAdjacency adjacency;
+            adjacency.Update(m_workAreas, m_monitors);
+
+            Assert::IsTrue(IsNeighbor(adjacency, m_monitorLeft, 0, VK_LEFT, m_monitorRight, 1));
+            Assert::IsTrue(IsNeighbor(adjacency, m_monitorRight, 1, VK_RIGHT, m_monitorLeft, 0));
+        }
+
+        TEST_METHOD (UnknownZoneOrDirection)
+        {
+            MonitorsZonesAdjacency adjacency;
+            adjacency.Update(m_workAreas, m_monitors);
+
+            Assert::IsTrue(adjacency.Contains(m_monitorLeft, 1));
+            Assert::IsFalse(adjacency.Contains(m_monitorLeft, 2));
+            Assert::IsFalse(adjacency.Neighbor(m_monitorLeft, 2, VK_RIGHT).has_value());
+            Assert::IsFalse(adjacency.Neighbor(m_monitorLeft, 1, VK_SPACE).has_value());
+        }
+
+        TEST_METHOD (RebuiltWhenLayoutIsCalculated)
+        {
+            MonitorsZonesAdjacency adjacency;
+            adjacency.Update(m_workAreas, m_monitors);
+
+            // applying a layout doesn't change the zones until the work area calculates it
+            ApplyColumns(m_monitorRight, 2, 3);
+            adjacency.Update(m_workAreas, m_monitors);
+            Assert::IsFalse(adjacency.Contains(m_monitorRight, 2));
+
+            m_workAreas.at(m_monitorRight)->InitLayout();
+            adjacency.Update(m_workAreas, m_monitors);
+            Assert::IsTrue(adjacency.Contains(m_monitorRight, 2));
+            Assert::IsTrue(IsNeighbor(adjacency, m_monitorLeft, 0, VK_LEFT, m_monitorRight, 2));
+        }
+
+        TEST_METHOD (RebuiltWhenMonitorsMove)
+        {
+            MonitorsZonesAdjacency adjacency;
+            adjacency.Update(m_workAreas, m_monitors);
+
+            m_monitors[1].second = RECT{ -1920, 0, 0, 1080 };
+            adjacency.Update(m_workAreas, m_monitors);
+
+            Assert::IsTrue(IsNeighbor(adjacency, m_monitorLeft, 0, VK_LEFT, m_monitorRight, 1));
+            Assert::IsTrue(IsNeighbor(adjacency, m_monitorRight, 1, VK_RIGHT, m_monitorLeft, 0));
+        }
+
+        TEST_METHOD (RebuiltWhenWorkAreaIsRemoved)
+        {
+            MonitorsZonesAdjacency adjacency;
+            adjacency.Update(m_workAreas, m_monitors);
+
+            m_workAreas.erase(m_monitorRight);
+            adjacency.Update(m_workAreas, m_monitors);
+
+            Assert::IsFalse(adjacency.Contains(m_monitorRight, 0));
+            Assert::IsTrue(adjacency.Contains(m_monitorLeft, 0));
+            Assert::IsFalse(IsNeighbor(adjacency, m_monitorLeft, 1, VK_RIGHT, m_monitorRight, 0));
+        }
+    };
+}
@@ -1,25 +1,99 @@
 #include "pch.h"
 #include "GcodeThumbnailProvider.h"
 
+#include <cstring>
 #include <filesystem>
-#include <fstream>
-#include <shellapi.h>
 #include <Shlwapi.h>
 #include <string>
+#include <wincodec.h>
 
 #include <wil/com.h>
 
-#include <common/utils/process_path.h>
 #include <common/interop/shared_constants.h>
 #include <common/logger/logger.h>
 #include <common/SettingsAPI/settings_helpers.h>
-#include <common/utils/process_path.h>
+#include <common/utils/gpo.h>
+#include <common/utils/thumbnail_bitmap.h>
+#include <modules/previewpane/QoiThumbnailProviderCpp/QoiDecoder.h>
 
 extern HINSTANCE g_hInst;
 extern long g_cDllRef;
 
+namespace
+{
+    class StreamByteSource : public GcodeByteSource
+    {
+        IStream* stream;
+        uint64_t position = 0;
+
+    public:
+        explicit StreamByteSource(IStream* stream) :
+            stream{ stream }
+        {
+            // The stream may not be at its start
+            LARGE_INTEGER zero = {};
+            stream->Seek(zero, STREAM_SEEK_SET, nullptr);
+        }
+
+        std::optional<uint64_t> Size() override
+        {
+            STATSTG stat = {};
+            if (FAILED(stream->Stat(&stat, STATFLAG_NONAME)))
+            {
+                return std::nullopt;
+            }
+
+            return stat.cbSize.QuadPart;
+        }
+
+        size_t ReadAt(uint64_t offset, uint8_t* buffer, size_t size) override
+        {
+            if (offset != position)
+            {
+                LARGE_INTEGER move = {};
+                move.QuadPart = static_cast<LONGLONG>(offset);
+                if (FAILED(stream->Seek(move, STREAM_SEEK_SET, nullptr)))
+                {
+                    return 0;
+                }
+
+                position = offset;
+            }
+
+            ULONG read = 0;
+            if (FAILED(stream->Read(buffer, static_cast<ULONG>(size), &read)))
+            {
+                return 0;
+            }
+
+            position += read;
+            return read;
+        }
+    };
+
+    class MemoryByteSource : public QoiByteSource
+    {
+        const std::vector<uint8_t>& data;
+        size_t position = 0;
+
+    public:
+        explicit MemoryByteSource(const std::vector<uint8_t>& data) :
+            data{ data }
+        {
+        }
+
+        size_t Read(uint8_t* buffer, size_t size) override
+        {
+            const size_t count = std::min(size, data.size() - position);
+            std::memcpy(buffer, data.data() + position, count);
+            position += count;
+            return count;
+        }
+    };
+}
+
 GcodeThumbnailProvider::GcodeThumbnailProvider() :
-    m_cRef(1), m_pStream(NULL), m_process(NULL)
+    m_cRef(1), m_pStream(NULL)
 {
     std::filesystem::path logFilePath(PTSettingsHelper::get_local_low_folder_location());
     logFilePath.append(LogSettings::gcodeThumbLogPath);
@@ -92,104 +166,136 @@ IFACEMETHODIMP GcodeThumbnailProvider::Initialize(IStream* pStream, DWORD grfMod
 
 IFACEMETHODIMP GcodeThumbnailProvider::GetThumbnail(UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha)
 {
-    // Read stream into the buffer
-    char buffer[4096];
-    ULONG cbRead;
-
     Logger::trace(L"Begin");
 
-    GUID guid;
-    if (CoCreateGuid(&guid) == S_OK)
+    if (!m_pStream || !phbmp || !pdwAlpha || cx == 0 || cx > MaxThumbnailSize)
     {
-        wil::unique_cotaskmem_string guidString;
-        if (SUCCEEDED(StringFromCLSID(guid, &guidString)))
-        {
-            Logger::info(L"Read stream and save to tmp file.");
+        return E_INVALIDARG;
+    }
 
-            // {CLSID} -> CLSID
-            std::wstring guid = std::wstring(guidString.get()).substr(1, std::wstring(guidString.get()).size() - 2);
-            std::wstring filePath = PTSettingsHelper::get_local_low_folder_location() + L"\\GCodeThumbnail-Temp\\";
-            if (!std::filesystem::exists(filePath))
-            {
-                std::filesystem::create_directories(filePath);
-            }
+    if (powertoys_gpo::getConfiguredGcodeThumbnailsEnabledValue() == powertoys_gpo::gpo_rule_configured_disabled)
+    {
+        return E_FAIL;
+    }
 
-            std::wstring fileName = filePath + guid + L".gcode";
-            
-            // Write data to tmp file
-            std::fstream file;
-            file.open(fileName, std::ios_base::out | std::ios_base::binary);
+    // Only the ends of the file are read unless the thumbnails aren't there
+    StreamByteSource source{ m_pStream };
+    const auto result = FindGcodeThumbnails(source);
 
-            if (!file.is_open())
-            {
-                return 0;
-            }
+    m_pStream->Release();
+    m_pStream = NULL;
 
-            while (true)
-            {
-                auto result = m_pStream->Read(buffer, 4096, &cbRead);
+    Logger::trace(L"Read {} bytes, found {} thumbnails, full scan: {}", result.bytesRead, result.thumbnails.size(), result.fullScan);
 
-                file.write(buffer, cbRead);
-                if (result == S_FALSE)
-                {               
-                    break;
-                }
-            }
-            file.close();
+    for (const size_t index : RankGcodeThumbnails(result.thumbnails, cx))
+    {
+        *phbmp = DecodeThumbnail(result.thumbnails[index], cx);
+        if (*phbmp)
+        {
+            *pdwAlpha = WTS_ALPHATYPE::WTSAT_ARGB;
+            return S_OK;
+        }
 
-            m_pStream->Release();
-            m_pStream = NULL;
+        Logger::info(L"Failed to decode the embedded thumbnail {}.", index);
+    }
 
-            try
-            {
-                Logger::info(L"Start GcodeThumbnailProvider.exe");
+    Logger::info(L"No embedded thumbnail found.");
+    return E_FAIL;
+}
 
-                STARTUPINFO info = { sizeof(info) };
-                std::wstring cmdLine{ L"\"" + fileName + L"\"" };
-                cmdLine += L" ";
-                cmdLine += std::to_wstring(cx);
+#pragma endregion
 
-                std::wstring appPath = get_module_folderpath(g_hInst) + L"\\PowerToys.GcodeThumbnailProvider.exe";
+#pragma region Helper Functions
 
-                SHELLEXECUTEINFO sei{ sizeof(sei) };
-                sei.fMask = { SEE_MASK_NOCLOSEPROCESS | SEE_MASK_FLAG_NO_UI };
-                sei.lpFile = appPath.c_str();
-                sei.lpParameters = cmdLine.c_str();
-                sei.nShow = SW_SHOWDEFAULT;
-                ShellExecuteEx(&sei);
-                m_process = sei.hProcess;
-                WaitForSingleObject(m_process, INFINITE);
-                std::filesystem::remove(fileName);
+HBITMAP GcodeThumbnailProvider::DecodeThumbnail(const GcodeThumbnail& thumbnail, UINT cx)
+{
+    switch (thumbnail.format)
+    {
+    case GcodeThumbnailFormat::QOI:
+        return DecodeQoiThumbnailBitmap(thumbnail.data, cx);
+    case GcodeThumbnailFormat::PNG:
+    case GcodeThumbnailFormat::JPG:
+        return DecodeWicThumbnailBitmap(thumbnail.data, cx);
+    default:
+        return NULL;
+    }
+}
 
+HBITMAP GcodeThumbnailProvider::DecodeQoiThumbnailBitmap(const std::vector<uint8_t>& data, UINT cx)
+{
+    MemoryByteSource source{ data };
+    const auto thumbnail = DecodeQoiThumbnail(source, cx);
+    if (!thumbnail)
+    {
+        return NULL;
+    }
 
-                std::wstring fileNameBmp = filePath + guid + L".bmp";
-                if (std::filesystem::exists(fileNameBmp))
-                {
-                    *phbmp = static_cast<HBITMAP>(LoadImage(NULL, fileNameBmp.c_str(), IMAGE_BITMAP, 0, 0, LR_LOADFROMFILE));
-                    *pdwAlpha = WTS_ALPHATYPE::WTSAT_ARGB;
-                    std::filesystem::remove(fileNameBmp);
-                }
-                else
-                {
-                    Logger::info(L"Bmp file not generated.");
-                    return E_FAIL;
-                }
-            }
-            catch (std::exception& e)
-            {
-                std::wstring errorMessage = std::wstring{ winrt::to_hstring(e.what()) };
-                Logger::error(L"Failed to start GcodeThumbnailProvider.exe. Error: {}", errorMessage);
-            }
-        }
+    return CreateThumbnailBitmap(thumbnail->width, thumbnail->height, thumbnail->pixels);
+}
+
+HBITMAP GcodeThumbnailProvider::DecodeWicThumbnailBitmap(const std::vector<uint8_t>& data, UINT cx)
+{
+    wil::com_ptr_nothrow<IWICImagingFactory> factory;
+    if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory))))
+    {
+        return NULL;
     }
 
+    wil::com_ptr_nothrow<IStream> stream;
+    stream.attach(SHCreateMemStream(data.data(), static_cast<UINT>(data.size())));
+    if (!stream)
+    {
+        return NULL;
+    }
 
-    return S_OK;
-}
+    wil::com_ptr_nothrow<IWICBitmapDecoder> decoder;
+    wil::com_ptr_nothrow<IWICBitmapFrameDecode> frame;
+    UINT width = 0, height = 0;
+    if (FAILED(factory->CreateDecoderFromStream(stream.get(), nullptr, WICDecodeMetadataCacheOnDemand, &decoder)) ||
+        FAILED(decoder->GetFrame(0, &frame)) ||
+        FAILED(frame->GetSize(&width, &height)) ||
+        width == 0 || height == 0)
+    {
+        return NULL;
+    }
 
+    // Thumbnails are only scaled down, like the QOI ones and the shell's own image thumbnails
+    wil::com_ptr_nothrow<IWICBitmapSource> source = frame;
+    const auto [thumbnailWidth, thumbnailHeight] = QoiThumbnailSize(width, height, cx);
+    if (thumbnailWidth != width || thumbnailHeight != height)
+    {
+        wil::com_ptr_nothrow<IWICBitmapScaler> scaler;
+        if (FAILED(factory->CreateBitmapScaler(&scaler)) ||
+            FAILED(scaler->Initialize(source.get(), thumbnailWidth, thumbnailHeight, WICBitmapInterpolationModeFant)))
+        {
+            return NULL;
+        }
 
-#pragma endregion
+        source = scaler;
+    }
 
-#pragma region Helper Functions
+    wil::com_ptr_nothrow<IWICFormatConverter> converter;
+    if (FAILED(factory->CreateFormatConverter(&converter)) ||
+        FAILED(converter->Initialize(source.get(), GUID_WICPixelFormat32bppBGRA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom)))
+    {
+        return NULL;
+    }
+
+    void* bits = nullptr;
+    HBITMAP bitmap = CreateThumbnailBitmap(thumbnailWidth, thumbnailHeight, &bits);
+    if (!bitmap)
+    {
+        return NULL;
+    }
+
+    const UINT stride = thumbnailWidth * 4;
+    if (FAILED(converter->CopyPixels(nullptr, stride, stride * thumbnailHeight, static_cast<BYTE*>(bits))))
+    {
+        DeleteObject(bitmap);
+        return NULL;
+    }
+
+    return bitmap;
+}
 
 #pragma endregion
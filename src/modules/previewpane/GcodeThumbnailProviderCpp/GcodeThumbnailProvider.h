@@ -6,6 +6,8 @@
 #include <string>
 #include <thumbcache.h>
 
+#include "GcodeThumbnails.h"
+
 class GcodeThumbnailProvider :
     public IInitializeWithStream,
     public IThumbnailProvider
@@ -33,5 +35,8 @@ private:
     // Provided during initialization.
     IStream* m_pStream;
 
-    HANDLE m_process;
+    // Decodes an embedded thumbnail and scales it down to fit into cx x cx, returns NULL if it can't be decoded
+    static HBITMAP DecodeThumbnail(const GcodeThumbnail& thumbnail, UINT cx);
+    static HBITMAP DecodeQoiThumbnailBitmap(const std::vector<uint8_t>& data, UINT cx);
+    static HBITMAP DecodeWicThumbnailBitmap(const std::vector<uint8_t>& data, UINT cx);
 };
\ No newline at end of file
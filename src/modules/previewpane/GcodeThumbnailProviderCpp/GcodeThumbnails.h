@@ -0,0 +1,497 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Finds the thumbnails slicers embed in G-code files as blocks of base64 comments:
+//
+//   ; thumbnail begin 300x300 12345
+//   ; iVBORw0KGgoAAAANSUhEUgAAASwAAAEsCAYAAAB5fY51AAA...
+//   ; thumbnail end
+//
+// with "thumbnail_JPG" and "thumbnail_QOI" instead of "thumbnail" for the other formats. Slicers write them near
+// the start of the file, a few write them at its end, so only windows at both ends are read unless neither of them
+// has a thumbnail.
+
+// Random access to the file, e.g. an IStream. ReadAt returns how many bytes were read, 0 past the end of the file.
+class GcodeByteSource
+{
+public:
+    virtual ~GcodeByteSource() = default;
+
+    // Returns nullopt if the size isn't known, which means the whole file is read
+    virtual std::optional<uint64_t> Size() = 0;
+    virtual size_t ReadAt(uint64_t offset, uint8_t* buffer, size_t size) = 0;
+};
+
+// Same order as GcodeThumbnailFormat of FilePreviewCommon, later formats are preferred
+enum class GcodeThumbnailFormat
+{
+    Unknown,
+    JPG,
+    QOI,
+    PNG,
+};
+
+struct GcodeThumbnail
+{
+    GcodeThumbnailFormat format = GcodeThumbnailFormat::Unknown;
+    // As announced by the block, 0 if it wasn't
+    uint32_t width = {};
+    uint32_t height = {};
+    // The decoded image file
+    std::vector<uint8_t> data;
+};
+
+struct GcodeScanOptions
+{
+    uint64_t headWindow = 1024 * 1024;
+    uint64_t tailWindow = 256 * 1024;
+    // Blocks with more base64 text are dropped. A block which starts inside a window is read to its end.
+    uint64_t maxBlockSize = 16 * 1024 * 1024;
+};
+
+struct GcodeScanResult
+{
+    std::vector<GcodeThumbnail> thumbnails;
+    uint64_t bytesRead = {};
+    // Whether the windows had no thumbnail and the rest of the file was read as well
+    bool fullScan = false;
+};
+
+namespace GcodeFormat
+{
+    constexpr std::string_view ThumbnailComment = "; thumbnail";
+    constexpr size_t ChunkSize = 64 * 1024;
+    // Lines of G-code and base64 are short, longer ones can't be a part of a thumbnail
+    constexpr size_t MaxLineLength = 4096;
+
+    constexpr uint8_t Base64Invalid = 0xFF;
+    constexpr uint8_t Base64Padding = 0xFE;
+
+    constexpr std::array<uint8_t, 256> MakeBase64Table()
+    {
+        std::array<uint8_t, 256> table = {};
+        table.fill(Base64Invalid);
+        constexpr std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (size_t i = 0; i < alphabet.size(); ++i)
+        {
+            table[static_cast<uint8_t>(alphabet[i])] = static_cast<uint8_t>(i);
+        }
+
+        table['='] = Base64Padding;
+        return table;
+    }
+
+    constexpr std::array<uint8_t, 256> Base64Table = MakeBase64Table();
+
+    inline bool EqualsIgnoringCase(const std::string_view a, const std::string_view b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const char x, const char y) {
+                   return (x >= 'a' && x <= 'z' ? x - 'a' + 'A' : x) == (y >= 'a' && y <= 'z' ? y - 'a' + 'A' : y);
+               });
+    }
+
+    // Parses "300x300" of "; thumbnail begin 300x300 12345"
+    inline void ParseSize(const std::string_view text, uint32_t& width, uint32_t& height)
+    {
+        const auto separator = text.find('x');
+        if (separator == std::string_view::npos ||
+            std::from_chars(text.data(), text.data() + separator, width).ec != std::errc{} ||
+            std::from_chars(text.data() + separator + 1, text.data() + text.size(), height).ec != std::errc{})
+        {
+            width = 0;
+            height = 0;
+        }
+    }
+}
+
+// Collects the thumbnail blocks of the bytes it's fed, which may split lines anywhere
+class GcodeThumbnailScanner
+{
+    uint64_t maxBlockSize;
+    std::vector<GcodeThumbnail> thumbnails;
+    std::string partialLine;
+    bool skippingLine = false;
+    bool sawBegin = false;
+    bool sawEndBeforeBegin = false;
+
+    std::optional<GcodeThumbnail> block;
+    uint64_t blockText = 0;
+    uint32_t bits = 0;
+    uint32_t bitCount = 0;
+    bool padded = false;
+
+    void ProcessLine(std::string_view line)
+    {
+        if (line.ends_with('\r'))
+        {
+            line.remove_suffix(1);
+        }
+
+        if (line.starts_with(GcodeFormat::ThumbnailComment))
+        {
+            line.remove_prefix(GcodeFormat::ThumbnailComment.size());
+            const auto space = line.find(' ');
+            const std::string_view suffix = line.substr(0, space);
+            line.remove_prefix(space == std::string_view::npos ? line.size() : space + 1);
+            const std::string_view keyword = line.substr(0, line.find(' '));
+
+            if (keyword == "begin")
+            {
+                StartBlock(suffix, line.substr(std::min(line.size(), keyword.size() + 1)));
+                return;
+            }
+
+            if (keyword == "end")
+            {
+                EndBlock();
+                return;
+            }
+        }
+
+        if (block)
+        {
+            AppendBase64(line);
+        }
+    }
+
+    void StartBlock(const std::string_view suffix, const std::string_view parameters)
+    {
+        GcodeThumbnail thumbnail;
+        if (suffix.empty())
+        {
+            thumbnail.format = GcodeThumbnailFormat::PNG;
+        }
+        else if (GcodeFormat::EqualsIgnoringCase(suffix, "_JPG"))
+        {
+            thumbnail.format = GcodeThumbnailFormat::JPG;
+        }
+        else if (GcodeFormat::EqualsIgnoringCase(suffix, "_QOI"))
+        {
+            thumbnail.format = GcodeThumbnailFormat::QOI;
+        }
+
+        GcodeFormat::ParseSize(parameters.substr(0, parameters.find(' ')), thumbnail.width, thumbnail.height);
+
+        // The announced length of the base64 text, which saves reallocations
+        uint64_t length = 0;
+        if (const auto space = parameters.find(' '); space != std::string_view::npos)
+        {
+            std::from_chars(parameters.data() + space + 1, parameters.data() + parameters.size(), length);
+        }
+
+        thumbnail.data.reserve(static_cast<size_t>(std::min(length, maxBlockSize) / 4 * 3));
+        block = std::move(thumbnail);
+        sawBegin = true;
+        blockText = 0;
+        bits = 0;
+        bitCount = 0;
+        padded = false;
+    }
+
+    void EndBlock()
+    {
+        sawEndBeforeBegin = sawEndBeforeBegin || !sawBegin;
+
+        // Leftover bits which don't make a byte are the zero padding of the last group
+        if (block && block->format != GcodeThumbnailFormat::Unknown && !block->data.empty())
+        {
+            thumbnails.push_back(std::move(*block));
+        }
+
+        block.reset();
+    }
+
+    // Appends the base64 of a "; <base64>" line. Anything else ends up dropping the block.
+    void AppendBase64(const std::string_view line)
+    {
+        if (!line.starts_with(';'))
+        {
+            block.reset();
+            return;
+        }
+
+        blockText += line.size();
+        if (blockText > maxBlockSize)
+        {
+            block.reset();
+            return;
+        }
+
+        for (size_t i = 1; i < line.size(); ++i)
+        {
+            const uint8_t c = static_cast<uint8_t>(line[i]);
+            if (c == ' ' || c == '\t')
+            {
+                continue;
+            }
+
+            const uint8_t value = GcodeFormat::Base64Table[c];
+            if (value == GcodeFormat::Base64Padding)
+            {
+                padded = true;
+                continue;
+            }
+
+            if (value == GcodeFormat::Base64Invalid || padded)
+            {
+                block.reset();
+                return;
+            }
+
+            bits = bits << 6 | value;
+            bitCount += 6;
+            if (bitCount >= 8)
+            {
+                bitCount -= 8;
+                block->data.push_back(static_cast<uint8_t>(bits >> bitCount));
+            }
+        }
+    }
+
+public:
+    explicit GcodeThumbnailScanner(const uint64_t maxBlockSize) :
+        maxBlockSize{ maxBlockSize }
+    {
+    }
+
+    // Ignores everything up to the next line, for scans which start in the middle of a line
+    void SkipLine()
+    {
+        partialLine.clear();
+        skippingLine = true;
+    }
+
+    void Feed(const uint8_t* data, const size_t size)
+    {
+        const char* text = reinterpret_cast<const char*>(data);
+        const char* end = text + size;
+        while (text != end)
+        {
+            const char* newline = static_cast<const char*>(std::memchr(text, '\n', end - text));
+            const char* lineEnd = newline ? newline : end;
+
+            if (!skippingLine)
+            {
+                // Lines within the chunk are processed in place, only the ones split between chunks are copied
+                if (newline && partialLine.empty())
+                {
+                    if (static_cast<size_t>(lineEnd - text) <= GcodeFormat::MaxLineLength)
+                    {
+                        ProcessLine({ text, static_cast<size_t>(lineEnd - text) });
+                    }
+                    else
+                    {
+                        block.reset();
+                    }
+                }
+                else if (partialLine.size() + (lineEnd - text) > GcodeFormat::MaxLineLength)
+                {
+                    partialLine.clear();
+                    skippingLine = newline == nullptr;
+                    block.reset();
+                }
+                else
+                {
+                    partialLine.append(text, lineEnd);
+                    if (newline)
+                    {
+                        ProcessLine(partialLine);
+                        partialLine.clear();
+                    }
+                }
+            }
+            else if (newline)
+            {
+                skippingLine = false;
+            }
+
+            text = newline ? newline + 1 : end;
+        }
+    }
+
+    // Processes the last line if the file doesn't end with a line break
+    void Finish()
+    {
+        if (!skippingLine && !partialLine.empty())
+        {
+            ProcessLine(partialLine);
+        }
+
+        partialLine.clear();
+        skippingLine = false;
+    }
+
+    inline bool InBlock() const
+    {
+        return block.has_value();
+    }
+
+    // Whether the last line fed isn't complete yet
+    inline bool InLine() const
+    {
+        return !partialLine.empty();
+    }
+
+    // How many of the bytes fed last belong to a line which isn't complete yet
+    inline size_t UnfinishedLineSize() const
+    {
+        return partialLine.size();
+    }
+
+    // Whether a block ended before any began, i.e. the scan started in the middle of a block
+    inline bool SawEndBeforeBegin() const
+    {
+        return sawEndBeforeBegin;
+    }
+
+    std::vector<GcodeThumbnail> TakeThumbnails()
+    {
+        return std::move(thumbnails);
+    }
+};
+
+namespace GcodeFormat
+{
+    // Feeds [begin, end) to the scanner, then keeps reading to the end of the line and of a block started in it.
+    // Returns where the lines the scanner didn't process start.
+    inline uint64_t Scan(GcodeByteSource& source,
+                         GcodeThumbnailScanner& scanner,
+                         uint64_t begin,
+                         const uint64_t end,
+                         std::vector<uint8_t>& buffer,
+                         uint64_t& bytesRead)
+    {
+        // Past the end, lines which start there are only read while a block continues
+        bool pastEnd = false;
+        while (begin < end || scanner.InBlock() || (scanner.InLine() && !pastEnd))
+        {
+            pastEnd = begin >= end;
+            const size_t wanted = static_cast<size_t>(begin < end ? std::min<uint64_t>(buffer.size(), end - begin) : buffer.size());
+            const size_t read = source.ReadAt(begin, buffer.data(), wanted);
+            if (read == 0)
+            {
+                scanner.Finish();
+                break;
+            }
+
+            scanner.Feed(buffer.data(), read);
+            begin += read;
+            bytesRead += read;
+        }
+
+        return begin - scanner.UnfinishedLineSize();
+    }
+
+    // Starts a scan at `offset` at the start of a line: reads the byte before it to know whether it is one
+    inline uint64_t AlignToLine(GcodeThumbnailScanner& scanner, const uint64_t offset)
+    {
+        if (offset > 0)
+        {
+            scanner.SkipLine();
+            return offset - 1;
+        }
+
+        return offset;
+    }
+}
+
+// Reads the head window, then the tail window, then the rest of the file only if neither had a thumbnail or if a block
+// started before the tail window
+inline GcodeScanResult FindGcodeThumbnails(GcodeByteSource& source, const GcodeScanOptions& options = {})
+{
+    GcodeScanResult result;
+    std::vector<uint8_t> buffer(GcodeFormat::ChunkSize);
+    const auto size = source.Size();
+
+    if (!size || *size - std::min(*size, options.headWindow) <= options.tailWindow)
+    {
+        GcodeThumbnailScanner scanner{ options.maxBlockSize };
+        GcodeFormat::Scan(source, scanner, 0, UINT64_MAX, buffer, result.bytesRead);
+        scanner.Finish();
+        result.thumbnails = scanner.TakeThumbnails();
+        return result;
+    }
+
+    GcodeThumbnailScanner head{ options.maxBlockSize };
+    const uint64_t headEnd = GcodeFormat::Scan(source, head, 0, options.headWindow, buffer, result.bytesRead);
+    result.thumbnails = head.TakeThumbnails();
+    const size_t headThumbnails = result.thumbnails.size();
+
+    // Blocks which started before the tail window are read by the head scan or the full scan
+    GcodeThumbnailScanner tail{ options.maxBlockSize };
+    const uint64_t tailStart = std::max(*size - options.tailWindow, headEnd);
+    GcodeFormat::Scan(source, tail, GcodeFormat::AlignToLine(tail, tailStart), *size, buffer, result.bytesRead);
+    tail.Finish();
+    for (auto& thumbnail : tail.TakeThumbnails())
+    {
+        result.thumbnails.push_back(std::move(thumbnail));
+    }
+
+    if (!result.thumbnails.empty() && !tail.SawEndBeforeBegin())
+    {
+        return result;
+    }
+
+    // The tail window is read again, its thumbnails are found by this scan too
+    result.fullScan = true;
+    result.thumbnails.resize(headThumbnails);
+    GcodeThumbnailScanner rest{ options.maxBlockSize };
+    GcodeFormat::Scan(source, rest, GcodeFormat::AlignToLine(rest, headEnd), *size, buffer, result.bytesRead);
+    rest.Finish();
+    for (auto& thumbnail : rest.TakeThumbnails())
+    {
+        result.thumbnails.push_back(std::move(thumbnail));
+    }
+
+    return result;
+}
+
+// Orders the thumbnails from the best one for a thumbnail of cx x cx to the worst one: the smallest one which is at
+// least as large as cx, so it only has to be scaled down, or the largest one if none is. Between thumbnails of the
+// same size, the preferred format comes first, then the larger file. Thumbnails of unknown formats are left out.
+inline std::vector<size_t> RankGcodeThumbnails(const std::vector<GcodeThumbnail>& thumbnails, const uint32_t cx)
+{
+    std::vector<size_t> ranking;
+    for (size_t i = 0; i < thumbnails.size(); ++i)
+    {
+        if (thumbnails[i].format != GcodeThumbnailFormat::Unknown)
+        {
+            ranking.push_back(i);
+        }
+    }
+
+    const auto largestSide = [&](const size_t i) { return std::max(thumbnails[i].width, thumbnails[i].height); };
+    std::stable_sort(ranking.begin(), ranking.end(), [&](const size_t a, const size_t b) {
+        const uint32_t sideA = largestSide(a);
+        const uint32_t sideB = largestSide(b);
+        const bool largeEnoughA = sideA >= cx;
+        const bool largeEnoughB = sideB >= cx;
+        if (largeEnoughA != largeEnoughB)
+        {
+            return largeEnoughA;
+        }
+
+        if (sideA != sideB)
+        {
+            return largeEnoughA ? sideA < sideB : sideA > sideB;
+        }
+
+        if (thumbnails[a].format != thumbnails[b].format)
+        {
+            return thumbnails[a].format > thumbnails[b].format;
+        }
+
+        return thumbnails[a].data.size() > thumbnails[b].data.size();
+    });
+
+    return ranking;
+}
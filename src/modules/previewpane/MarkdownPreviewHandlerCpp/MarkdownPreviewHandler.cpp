@@ -3,7 +3,6 @@
 #include "Generated Files/resource.h"
 #include "../powerpreview/powerpreviewConstants.h"
 
-#include <shellapi.h>
 #include <Shlwapi.h>
 #include <string>
 
@@ -12,24 +11,40 @@
 #include <common/SettingsAPI/settings_helpers.h>
 #include <common/utils/process_path.h>
 #include <common/Themes/windows_colors.h>
+#include <modules/previewpane/PreviewHostPool/PreviewHostProcess.h>
 
 extern HINSTANCE g_hInst;
 extern long g_cDllRef;
 
-MarkdownPreviewHandler::MarkdownPreviewHandler() :
-    m_cRef(1), m_hwndParent(NULL), m_rcParent(), m_punkSite(NULL), m_process(NULL)
+namespace
 {
-    m_resizeEvent = CreateEvent(nullptr, false, false, CommonSharedConstants::MARKDOWN_PREVIEW_RESIZE_EVENT);
+    PreviewHostPool& HostPool()
+    {
+        static PreviewHostPool* pool = CreatePreviewHostPool(get_module_folderpath(g_hInst) + L"\\PowerToys.MarkdownPreviewHandler.exe");
+        return *pool;
+    }
+}
 
+MarkdownPreviewHandler::MarkdownPreviewHandler() :
+    m_cRef(1), m_hwndParent(NULL), m_rcParent(), m_punkSite(NULL), m_preview(0)
+{
     std::filesystem::path logFilePath(PTSettingsHelper::get_local_low_folder_location());
     logFilePath.append(LogSettings::mdPrevLogPath);
     Logger::init(LogSettings::mdPrevLoggerName, logFilePath.wstring(), PTSettingsHelper::get_log_settings_file_location());
 
+    // Explorer creates the handler before it previews the file, so the host can start in the meantime
+    HostPool().Prewarm();
+
     InterlockedIncrement(&g_cDllRef);
 }
 
 MarkdownPreviewHandler::~MarkdownPreviewHandler()
 {
+    if (m_preview != 0)
+    {
+        HostPool().Unload(m_preview);
+    }
+
     InterlockedDecrement(&g_cDllRef);
 }
 
@@ -130,19 +145,9 @@ IFACEMETHODIMP MarkdownPreviewHandler::SetRect(const RECT* prc)
     HRESULT hr = E_INVALIDARG;
     if (prc != NULL)
     {
-        if (!m_resizeEvent)
-        {
-            Logger::error(L"Failed to create resize event for MDPreviewHandler");
-        }
-        else
+        if (m_preview != 0 && (m_rcParent.right != prc->right || m_rcParent.left != prc->left || m_rcParent.top != prc->top || m_rcParent.bottom != prc->bottom))
         {
-            if (m_rcParent.right != prc->right || m_rcParent.left != prc->left || m_rcParent.top != prc->top || m_rcParent.bottom != prc->bottom)
-            {
-                if (!SetEvent(m_resizeEvent))
-                {
-                    Logger::error(L"Failed to signal resize event for MDPreviewHandler");
-                }
-            }
+            HostPool().Resize(m_preview, { prc->left, prc->right, prc->top, prc->bottom });
         }
         m_rcParent = *prc;
         hr = S_OK;
@@ -152,50 +157,31 @@ IFACEMETHODIMP MarkdownPreviewHandler::SetRect(const RECT* prc)
 
 IFACEMETHODIMP MarkdownPreviewHandler::DoPreview()
 {
-    try
+    Logger::info(L"Sending the preview to MarkdownPreviewHandler.exe");
+
+    if (m_preview != 0)
     {
-        Logger::info(L"Starting MarkdownPreviewHandler.exe");
-
-        STARTUPINFO info = { sizeof(info) };
-        std::wstring cmdLine{ L"\"" + m_filePath + L"\"" };
-        cmdLine += L" ";
-        std::wostringstream ss;
-        ss << std::hex << m_hwndParent;
-
-        cmdLine += ss.str();
-        cmdLine += L" ";
-        cmdLine += std::to_wstring(m_rcParent.left);
-        cmdLine += L" ";
-        cmdLine += std::to_wstring(m_rcParent.right);
-        cmdLine += L" ";
-        cmdLine += std::to_wstring(m_rcParent.top);
-        cmdLine += L" ";
-        cmdLine += std::to_wstring(m_rcParent.bottom);
-        std::wstring appPath = get_module_folderpath(g_hInst) + L"\\PowerToys.MarkdownPreviewHandler.exe";
-
-        SHELLEXECUTEINFO sei{ sizeof(sei) };
-        sei.fMask = { SEE_MASK_NOCLOSEPROCESS | SEE_MASK_FLAG_NO_UI };
-        sei.lpFile = appPath.c_str();
-        sei.lpParameters = cmdLine.c_str();
-        sei.nShow = SW_SHOWDEFAULT;
-        ShellExecuteEx(&sei);
-        m_process = sei.hProcess;
+        HostPool().Unload(m_preview);
     }
-    catch (std::exception& e)
+
+    m_preview = HostPool().Preview({ .filePath = m_filePath,
+                                     .parentWindow = reinterpret_cast<uintptr_t>(m_hwndParent),
+                                     .rect = { m_rcParent.left, m_rcParent.right, m_rcParent.top, m_rcParent.bottom } });
+    if (m_preview == 0)
     {
-        std::wstring errorMessage = std::wstring{ winrt::to_hstring(e.what()) };
-        Logger::error(L"Failed to start MarkdownPreviewHandler.exe. Error: {}", errorMessage);
+        Logger::error(L"Failed to start MarkdownPreviewHandler.exe");
+        return E_FAIL;
     }
 
     return S_OK;
 }
 
 IFACEMETHODIMP MarkdownPreviewHandler::Unload()
-
 {
-    Logger::info(L"Unload and terminate .exe");
+    Logger::info(L"Unload the preview, the .exe stays for the next one");
 
-    TerminateProcess(m_process, 0);
+    HostPool().Unload(m_preview);
+    m_preview = 0;
     return S_OK;
 }
 
@@ -4,6 +4,7 @@
 
 using System.Globalization;
 using System.Windows.Threading;
+using Common;
 using Common.UI;
 using interop;
 using ManagedCommon;
@@ -27,7 +28,12 @@ namespace Microsoft.PowerToys.PreviewHandler.Monaco
             ApplicationConfiguration.Initialize();
             if (args != null)
             {
-                if (args.Length == 6)
+                if (args.Length == 2 && args[0] == "--pooled")
+                {
+                    // Started by the preview handler to show many previews, one after the other
+                    PooledPreviewHost.Run(() => new MonacoPreviewHandlerControl(), Convert.ToInt32(args[1], 10));
+                }
+                else if (args.Length == 6)
                 {
                     string filePath = args[0];
                     int hwnd = Convert.ToInt32(args[1], 16);
@@ -2,7 +2,6 @@
 #include "MonacoPreviewHandler.h"
 #include "../powerpreview/powerpreviewConstants.h"
 
-#include <shellapi.h>
 #include <Shlwapi.h>
 #include <string>
 
@@ -11,24 +10,40 @@
 #include <common/SettingsAPI/settings_helpers.h>
 #include <common/utils/process_path.h>
 #include <common/Themes/windows_colors.h>
+#include <modules/previewpane/PreviewHostPool/PreviewHostProcess.h>
 
 extern HINSTANCE g_hInst;
 extern long g_cDllRef;
 
-MonacoPreviewHandler::MonacoPreviewHandler() :
-    m_cRef(1), m_hwndParent(NULL), m_rcParent(), m_punkSite(NULL), m_process(NULL)
+namespace
 {
-    m_resizeEvent = CreateEvent(nullptr, false, false, CommonSharedConstants::DEV_FILES_PREVIEW_RESIZE_EVENT);
+    PreviewHostPool& HostPool()
+    {
+        static PreviewHostPool* pool = CreatePreviewHostPool(get_module_folderpath(g_hInst) + L"\\PowerToys.MonacoPreviewHandler.exe");
+        return *pool;
+    }
+}
 
+MonacoPreviewHandler::MonacoPreviewHandler() :
+    m_cRef(1), m_hwndParent(NULL), m_rcParent(), m_punkSite(NULL), m_preview(0)
+{
     std::filesystem::path logFilePath(PTSettingsHelper::get_local_low_folder_location());
     logFilePath.append(LogSettings::monacoPrevLogPath);
     Logger::init(LogSettings::monacoPrevLoggerName, logFilePath.wstring(), PTSettingsHelper::get_log_settings_file_location());
 
+    // Explorer creates the handler before it previews the file, so the host can start in the meantime
+    HostPool().Prewarm();
+
     InterlockedIncrement(&g_cDllRef);
 }
 
 MonacoPreviewHandler::~MonacoPreviewHandler()
 {
+    if (m_preview != 0)
+    {
+        HostPool().Unload(m_preview);
+    }
+
     InterlockedDecrement(&g_cDllRef);
 }
 
@@ -129,19 +144,9 @@ IFACEMETHODIMP MonacoPreviewHandler::SetRect(const RECT* prc)
     HRESULT hr = E_INVALIDARG;
     if (prc != NULL)
     {
-        if (!m_resizeEvent)
+        if (m_preview != 0 && (m_rcParent.right != prc->right || m_rcParent.left != prc->left || m_rcParent.top != prc->top || m_rcParent.bottom != prc->bottom))
         {
-            Logger::error(L"Failed to create resize event for MonacoPreviewHandler");
-        }
-        else
-        {
-            if (m_rcParent.right != prc->right || m_rcParent.left != prc->left || m_rcParent.top != prc->top || m_rcParent.bottom != prc->bottom)
-            {
-                if (!SetEvent(m_resizeEvent))
-                {
-                    Logger::error(L"Failed to signal resize event for MonacoPreviewHandler");
-                }
-            }
+            HostPool().Resize(m_preview, { prc->left, prc->right, prc->top, prc->bottom });
         }
         m_rcParent = *prc;
         hr = S_OK;
@@ -151,39 +156,20 @@ IFACEMETHODIMP MonacoPreviewHandler::SetRect(const RECT* prc)
 
 IFACEMETHODIMP MonacoPreviewHandler::DoPreview()
 {
-    try
+    Logger::info(L"Sending the preview to MonacoPreviewHandler.exe");
+
+    if (m_preview != 0)
     {
-        Logger::info(L"Starting MonacoPreviewHandler.exe");
-
-        STARTUPINFO info = { sizeof(info) };
-        std::wstring cmdLine{ L"\"" + m_filePath + L"\"" };
-        cmdLine += L" ";
-        std::wostringstream ss;
-        ss << std::hex << m_hwndParent;
-
-        cmdLine += ss.str();
-        cmdLine += L" ";
-        cmdLine += std::to_wstring(m_rcParent.left);
-        cmdLine += L" ";
-        cmdLine += std::to_wstring(m_rcParent.right);
-        cmdLine += L" ";
-        cmdLine += std::to_wstring(m_rcParent.top);
-        cmdLine += L" ";
-        cmdLine += std::to_wstring(m_rcParent.bottom);
-        std::wstring appPath = get_module_folderpath(g_hInst) + L"\\PowerToys.MonacoPreviewHandler.exe";
-
-        SHELLEXECUTEINFO sei{ sizeof(sei) };
-        sei.fMask = { SEE_MASK_NOCLOSEPROCESS | SEE_MASK_FLAG_NO_UI };
-        sei.lpFile = appPath.c_str();
-        sei.lpParameters = cmdLine.c_str();
-        sei.nShow = SW_SHOWDEFAULT;
-        ShellExecuteEx(&sei);
-        m_process = sei.hProcess;
+        HostPool().Unload(m_preview);
     }
-    catch (std::exception& e)
+
+    m_preview = HostPool().Preview({ .filePath = m_filePath,
+                                     .parentWindow = reinterpret_cast<uintptr_t>(m_hwndParent),
+                                     .rect = { m_rcParent.left, m_rcParent.right, m_rcParent.top, m_rcParent.bottom } });
+    if (m_preview == 0)
     {
-        std::wstring errorMessage = std::wstring{ winrt::to_hstring(e.what()) };
-        Logger::error(L"Failed to start MonacoPreviewHandler.exe. Error: {}", errorMessage);
+        Logger::error(L"Failed to start MonacoPreviewHandler.exe");
+        return E_FAIL;
     }
 
     return S_OK;
@@ -191,10 +177,11 @@ IFACEMETHODIMP MonacoPreviewHandler::DoPreview()
 
 IFACEMETHODIMP MonacoPreviewHandler::Unload()
 {
-    Logger::info(L"Unload and terminate .exe");
+    Logger::info(L"Unload the preview, the .exe stays for the next one");
 
     m_hwndParent = NULL;
-    TerminateProcess(m_process, 0);
+    HostPool().Unload(m_preview);
+    m_preview = 0;
     return S_OK;
 }
 
@@ -64,7 +64,6 @@ private:
     // Site pointer from host, used to get IPreviewHandlerFrame.
     IUnknown* m_punkSite;
 
-    HANDLE m_process;
-
-    HANDLE m_resizeEvent;
+    // The preview shown by the pooled .exe, 0 if there's none
+    uint64_t m_preview;
 };
\ No newline at end of file
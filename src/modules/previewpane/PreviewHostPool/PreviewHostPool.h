@@ -0,0 +1,758 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Keeps the .exe which renders a preview handler's previews running between previews, so selecting the next file
+// doesn't pay for starting a process and its runtime. A host shows one preview at a time, into the window of the
+// preview pane, and is told what to show over a channel of text lines:
+//
+//   preview <id> <file path> <parent window> <left> <right> <top> <bottom>    ->  shown <id> | failed <id>
+//   resize <id> <left> <right> <top> <bottom>
+//   unload <id>
+//   exit
+//
+// with the fields separated by tabs, in UTF-8, the parent window in hex. The host says "ready" once it started.
+// Hosts are recycled after a number of previews and ended when they have been idle for a while. A host which doesn't
+// answer a preview in time is terminated and replaced.
+
+struct PreviewHostRect
+{
+    int32_t left = {};
+    int32_t right = {};
+    int32_t top = {};
+    int32_t bottom = {};
+
+    bool operator==(const PreviewHostRect&) const = default;
+};
+
+struct PreviewHostRequest
+{
+    std::wstring filePath;
+    uint64_t parentWindow = {};
+    PreviewHostRect rect;
+
+    bool operator==(const PreviewHostRequest&) const = default;
+};
+
+// A running host, e.g. a process and the pipes of its standard input and output
+class PreviewHostChannel
+{
+public:
+    virtual ~PreviewHostChannel() = default;
+
+    // Sends a line without its line break. Returns false if the host is gone.
+    virtual bool Send(const std::string& line) = 0;
+    // Returns the next line of the host without its line break, nullopt if none arrives within the timeout.
+    // Only one thread receives at a time, but Send, Running and Terminate may be called while it waits.
+    virtual std::optional<std::string> Receive(std::chrono::milliseconds timeout) = 0;
+    virtual bool Running() = 0;
+    virtual void Terminate() = 0;
+};
+
+// Starts hosts, from any thread. Returns nullptr if the host couldn't be started.
+class PreviewHostLauncher
+{
+public:
+    virtual ~PreviewHostLauncher() = default;
+
+    virtual std::unique_ptr<PreviewHostChannel> Launch() = 0;
+};
+
+namespace PreviewHostProtocol
+{
+    enum class ReplyKind
+    {
+        Unknown,
+        Ready,
+        Shown,
+        Failed,
+    };
+
+    struct Reply
+    {
+        ReplyKind kind = ReplyKind::Unknown;
+        uint64_t id = {};
+    };
+
+    struct Command
+    {
+        std::string name;
+        uint64_t id = {};
+        PreviewHostRequest request;
+    };
+
+    inline std::string ToUtf8(const std::wstring_view text)
+    {
+        std::string result;
+        result.reserve(text.size());
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            uint32_t c = static_cast<uint32_t>(text[i]);
+            if constexpr (sizeof(wchar_t) == 2)
+            {
+                if (c >= 0xD800 && c < 0xDC00 && i + 1 < text.size() && text[i + 1] >= 0xDC00 && text[i + 1] < 0xE000)
+                {
+                    c = 0x10000 + ((c - 0xD800) << 10) + (static_cast<uint32_t>(text[++i]) - 0xDC00);
+                }
+            }
+
+            if ((c >= 0xD800 && c < 0xE000) || c > 0x10FFFF)
+            {
+                c = 0xFFFD;
+            }
+
+            if (c < 0x80)
+            {
+                result += static_cast<char>(c);
+            }
+            else if (c < 0x800)
+            {
+                result += static_cast<char>(0xC0 | c >> 6);
+                result += static_cast<char>(0x80 | (c & 0x3F));
+            }
+            else if (c < 0x10000)
+            {
+                result += static_cast<char>(0xE0 | c >> 12);
+                result += static_cast<char>(0x80 | (c >> 6 & 0x3F));
+                result += static_cast<char>(0x80 | (c & 0x3F));
+            }
+            else
+            {
+                result += static_cast<char>(0xF0 | c >> 18);
+                result += static_cast<char>(0x80 | (c >> 12 & 0x3F));
+                result += static_cast<char>(0x80 | (c >> 6 & 0x3F));
+                result += static_cast<char>(0x80 | (c & 0x3F));
+            }
+        }
+
+        return result;
+    }
+
+    // Invalid sequences become U+FFFD
+    inline std::wstring FromUtf8(const std::string_view text)
+    {
+        std::wstring result;
+        result.reserve(text.size());
+        for (size_t i = 0; i < text.size();)
+        {
+            const uint8_t lead = static_cast<uint8_t>(text[i]);
+            const size_t length = lead < 0x80 ? 1 : (lead & 0xE0) == 0xC0 ? 2 : (lead & 0xF0) == 0xE0 ? 3 : (lead & 0xF8) == 0xF0 ? 4 : 0;
+            uint32_t c = length == 1 ? lead : length == 2 ? lead & 0x1F : length == 3 ? lead & 0x0F : lead & 0x07;
+            bool valid = length != 0 && i + length <= text.size();
+            for (size_t j = 1; valid && j < length; ++j)
+            {
+                const uint8_t next = static_cast<uint8_t>(text[i + j]);
+                valid = (next & 0xC0) == 0x80;
+                c = c << 6 | (next & 0x3F);
+            }
+
+            // Overlong encodings, surrogates and code points past the last one
+            constexpr uint32_t minimum[] = { 0, 0, 0x80, 0x800, 0x10000 };
+            if (!valid || c < minimum[length] || (c >= 0xD800 && c < 0xE000) || c > 0x10FFFF)
+            {
+                result += static_cast<wchar_t>(0xFFFD);
+                i++;
+                continue;
+            }
+
+            if (sizeof(wchar_t) == 2 && c >= 0x10000)
+            {
+                result += static_cast<wchar_t>(0xD800 + ((c - 0x10000) >> 10));
+                result += static_cast<wchar_t>(0xDC00 + ((c - 0x10000) & 0x3FF));
+            }
+            else
+            {
+                result += static_cast<wchar_t>(c);
+            }
+
+            i += length;
+        }
+
+        return result;
+    }
+
+    inline std::vector<std::string_view> Split(const std::string_view line)
+    {
+        std::vector<std::string_view> fields;
+        size_t start = 0;
+        for (size_t tab = line.find('\t'); tab != std::string_view::npos; tab = line.find('\t', start))
+        {
+            fields.push_back(line.substr(start, tab - start));
+            start = tab + 1;
+        }
+
+        fields.push_back(line.substr(start));
+        return fields;
+    }
+
+    template<typename T>
+    bool ParseNumber(const std::string_view text, T& value, const int base = 10)
+    {
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+        return error == std::errc{} && end == text.data() + text.size() && !text.empty();
+    }
+
+    inline std::string RectFields(const PreviewHostRect& rect)
+    {
+        return std::to_string(rect.left) + '\t' + std::to_string(rect.right) + '\t' + std::to_string(rect.top) + '\t' + std::to_string(rect.bottom);
+    }
+
+    // Returns nullopt for paths which can't be sent, file names can't have tabs or line breaks anyway
+    inline std::optional<std::string> PreviewCommand(const uint64_t id, const PreviewHostRequest& request)
+    {
+        const std::string path = ToUtf8(request.filePath);
+        if (path.empty() || path.find_first_of("\t\r\n") != std::string::npos)
+        {
+            return std::nullopt;
+        }
+
+        char window[17];
+        const auto end = std::to_chars(window, window + sizeof(window), request.parentWindow, 16).ptr;
+        return "preview\t" + std::to_string(id) + '\t' + path + '\t' + std::string{ window, end } + '\t' + RectFields(request.rect);
+    }
+
+    inline std::string ResizeCommand(const uint64_t id, const PreviewHostRect& rect)
+    {
+        return "resize\t" + std::to_string(id) + '\t' + RectFields(rect);
+    }
+
+    inline std::string UnloadCommand(const uint64_t id)
+    {
+        return "unload\t" + std::to_string(id);
+    }
+
+    inline std::string ExitCommand()
+    {
+        return "exit";
+    }
+
+    // What a host does with a line, for hosts written in C++. Returns nullopt for malformed lines.
+    inline std::optional<Command> ParseCommand(const std::string_view line)
+    {
+        const auto fields = Split(line);
+        Command command{ .name = std::string{ fields[0] } };
+        if (command.name == "exit")
+        {
+            return fields.size() == 1 ? std::optional<Command>{ command } : std::nullopt;
+        }
+
+        const auto parseRect = [&](const size_t first) {
+            return ParseNumber(fields[first], command.request.rect.left) && ParseNumber(fields[first + 1], command.request.rect.right) &&
+                   ParseNumber(fields[first + 2], command.request.rect.top) && ParseNumber(fields[first + 3], command.request.rect.bottom);
+        };
+
+        bool valid = fields.size() >= 2 && ParseNumber(fields[1], command.id);
+        if (command.name == "preview")
+        {
+            valid = valid && fields.size() == 8 && !fields[2].empty() && ParseNumber(fields[3], command.request.parentWindow, 16) && parseRect(4);
+            command.request.filePath = valid ? FromUtf8(fields[2]) : std::wstring{};
+        }
+        else if (command.name == "resize")
+        {
+            valid = valid && fields.size() == 6 && parseRect(2);
+        }
+        else
+        {
+            valid = valid && command.name == "unload" && fields.size() == 2;
+        }
+
+        return valid ? std::optional<Command>{ command } : std::nullopt;
+    }
+
+    inline Reply ParseReply(const std::string_view line)
+    {
+        const auto fields = Split(line);
+        Reply reply;
+        if (fields.size() == 1 && fields[0] == "ready")
+        {
+            reply.kind = ReplyKind::Ready;
+        }
+        else if (fields.size() == 2 && (fields[0] == "shown" || fields[0] == "failed") && ParseNumber(fields[1], reply.id))
+        {
+            reply.kind = fields[0] == "shown" ? ReplyKind::Shown : ReplyKind::Failed;
+        }
+
+        return reply;
+    }
+}
+
+struct PreviewHostPoolOptions
+{
+    // A host is replaced after this many previews, so whatever leaks in it doesn't add up
+    uint32_t maxPreviews = 50;
+    // A host which shows nothing for this long is ended, and started again by the next preview
+    std::chrono::milliseconds idleTimeout = std::chrono::minutes{ 2 };
+    // How long a host which was told to exit may take before it's terminated
+    std::chrono::milliseconds exitTimeout = std::chrono::seconds{ 5 };
+    // A host which hasn't answered a preview for this long is hung, and is replaced by the next Preview or Unload
+    std::chrono::milliseconds replyTimeout = std::chrono::seconds{ 10 };
+};
+
+struct PreviewHostPoolStatistics
+{
+    uint64_t launched = {};
+    uint64_t launchFailures = {};
+    uint64_t recycled = {};
+    uint64_t expired = {};
+    // Hosts which were gone when a preview was sent to them
+    uint64_t lost = {};
+    // Hosts which were terminated because they didn't answer a preview
+    uint64_t hung = {};
+};
+
+class PreviewHostPool
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Host
+    {
+        // Shared with WaitForPreview, which receives without holding the lock
+        std::shared_ptr<PreviewHostChannel> channel;
+        uint32_t previews = 0;
+        // The preview the host shows, 0 if it's idle
+        uint64_t preview = 0;
+        Clock::time_point lastUsed;
+        // The last preview sent to the host until it answers it, and when it was sent
+        uint64_t pendingReply = 0;
+        Clock::time_point sent;
+        // WaitForPreview is reading the replies of the host
+        bool receiving = false;
+    };
+
+    struct ExitingHost
+    {
+        std::shared_ptr<PreviewHostChannel> channel;
+        Clock::time_point deadline;
+    };
+
+    std::unique_ptr<PreviewHostLauncher> launcher;
+    PreviewHostPoolOptions options;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Host> hosts;
+    std::vector<ExitingHost> exiting;
+    PreviewHostPoolStatistics statistics;
+    uint64_t nextPreview = 1;
+    bool prewarmRequested = false;
+    // Hosts became idle or were told to exit, so the worker has new deadlines
+    bool rescheduled = false;
+    bool launching = false;
+    bool stopping = false;
+    std::thread worker;
+
+    // The host handles previews in order, so it answered every preview once it answered the last one
+    static PreviewHostProtocol::Reply HandleReply(Host& host, const std::string& line)
+    {
+        const auto reply = PreviewHostProtocol::ParseReply(line);
+        if (reply.id == host.pendingReply && (reply.kind == PreviewHostProtocol::ReplyKind::Shown || reply.kind == PreviewHostProtocol::ReplyKind::Failed))
+        {
+            host.pendingReply = 0;
+        }
+
+        return reply;
+    }
+
+    // Replies are read so the host never blocks on a full pipe, unless WaitForPreview is reading them
+    static void DrainReplies(Host& host)
+    {
+        if (host.receiving)
+        {
+            return;
+        }
+
+        while (const auto line = host.channel->Receive(std::chrono::milliseconds{ 0 }))
+        {
+            HandleReply(host, *line);
+        }
+    }
+
+    bool Hung(const Host& host, const Clock::time_point now) const
+    {
+        return host.pendingReply != 0 && !host.receiving && now - host.sent >= options.replyTimeout;
+    }
+
+    // Terminates the host, the caller starts its replacement
+    void TerminateHung(const std::vector<Host>::iterator host)
+    {
+        statistics.hung++;
+        host->channel->Terminate();
+        hosts.erase(host);
+    }
+
+    void Exit(std::shared_ptr<PreviewHostChannel> channel)
+    {
+        if (channel->Send(PreviewHostProtocol::ExitCommand()))
+        {
+            exiting.push_back({ .channel = std::move(channel), .deadline = Clock::now() + options.exitTimeout });
+            rescheduled = true;
+            changed.notify_all();
+        }
+        else
+        {
+            channel->Terminate();
+        }
+    }
+
+    Host* FindPreview(const uint64_t id)
+    {
+        const auto host = std::find_if(hosts.begin(), hosts.end(), [id](const Host& h) { return h.preview == id; });
+        return host != hosts.end() ? &*host : nullptr;
+    }
+
+    Host* FindChannel(const PreviewHostChannel* channel)
+    {
+        const auto host = std::find_if(hosts.begin(), hosts.end(), [channel](const Host& h) { return h.channel.get() == channel; });
+        return host != hosts.end() ? &*host : nullptr;
+    }
+
+    bool HasIdleHost() const
+    {
+        return std::any_of(hosts.begin(), hosts.end(), [](const Host& h) { return h.preview == 0; });
+    }
+
+    // Starts a host with the lock released, so previews of other hosts don't wait for it
+    std::unique_ptr<PreviewHostChannel> Launch(std::unique_lock<std::mutex>& lock)
+    {
+        launching = true;
+        lock.unlock();
+        auto channel = launcher->Launch();
+        lock.lock();
+        launching = false;
+        changed.notify_all();
+
+        if (channel)
+        {
+            statistics.launched++;
+        }
+        else
+        {
+            statistics.launchFailures++;
+        }
+
+        return channel;
+    }
+
+    // Prewarms hosts, ends idle hosts and terminates the ones which take too long to exit
+    void Run()
+    {
+        std::unique_lock lock{ mutex };
+        while (!stopping)
+        {
+            rescheduled = false;
+            if (prewarmRequested && !launching)
+            {
+                prewarmRequested = false;
+                if (!HasIdleHost())
+                {
+                    auto channel = Launch(lock);
+                    if (channel && !stopping && !HasIdleHost())
+                    {
+                        hosts.push_back({ .channel = std::move(channel), .lastUsed = Clock::now() });
+                    }
+                    else if (channel)
+                    {
+                        Exit(std::move(channel));
+                    }
+                }
+            }
+
+            const auto now = Clock::now();
+            for (auto host = hosts.begin(); host != hosts.end();)
+            {
+                if (host->preview == 0 && now - host->lastUsed >= options.idleTimeout)
+                {
+                    statistics.expired++;
+                    Exit(std::move(host->channel));
+                    host = hosts.erase(host);
+                }
+                else
+                {
+                    ++host;
+                }
+            }
+
+            std::erase_if(exiting, [&](ExitingHost& host) {
+                if (host.channel->Running() && now < host.deadline)
+                {
+                    return false;
+                }
+
+                host.channel->Terminate();
+                return true;
+            });
+
+            auto wakeUp = Clock::time_point::max();
+            for (const auto& host : hosts)
+            {
+                if (host.preview == 0)
+                {
+                    wakeUp = std::min(wakeUp, host.lastUsed + options.idleTimeout);
+                }
+            }
+
+            for (const auto& host : exiting)
+            {
+                // Hosts usually exit well before the deadline, check on them now and then
+                wakeUp = std::min({ wakeUp, host.deadline, now + std::chrono::milliseconds{ 100 } });
+            }
+
+            const auto woken = [this] { return stopping || rescheduled || (prewarmRequested && !launching); };
+            if (wakeUp == Clock::time_point::max())
+            {
+                changed.wait(lock, woken);
+            }
+            else
+            {
+                changed.wait_until(lock, wakeUp, woken);
+            }
+        }
+    }
+
+public:
+    PreviewHostPool(std::unique_ptr<PreviewHostLauncher> launcher, const PreviewHostPoolOptions& options = {}) :
+        launcher{ std::move(launcher) }, options{ options }
+    {
+        worker = std::thread{ [this] { Run(); } };
+    }
+
+    ~PreviewHostPool()
+    {
+        {
+            std::unique_lock lock{ mutex };
+            stopping = true;
+            changed.notify_all();
+        }
+
+        worker.join();
+        for (auto& host : hosts)
+        {
+            host.channel->Send(PreviewHostProtocol::ExitCommand());
+            host.channel->Terminate();
+        }
+
+        for (auto& host : exiting)
+        {
+            host.channel->Terminate();
+        }
+    }
+
+    PreviewHostPool(const PreviewHostPool&) = delete;
+    PreviewHostPool& operator=(const PreviewHostPool&) = delete;
+
+    // Starts a host in the background unless one is idle, e.g. when a preview handler is created
+    void Prewarm()
+    {
+        std::unique_lock lock{ mutex };
+        prewarmRequested = true;
+        changed.notify_all();
+    }
+
+    // Sends the preview to an idle host, or to a new one if none is. Returns the id of the preview, 0 if no host
+    // could show it.
+    uint64_t Preview(const PreviewHostRequest& request)
+    {
+        std::unique_lock lock{ mutex };
+        const uint64_t id = nextPreview++;
+        const auto command = PreviewHostProtocol::PreviewCommand(id, request);
+        if (!command)
+        {
+            return 0;
+        }
+
+        // A host which was lost is replaced once
+        for (int attempt = 0; attempt < 2; ++attempt)
+        {
+            // The host the worker is starting, or about to, is likely ready sooner than a new one
+            changed.wait(lock, [this] { return HasIdleHost() || (!launching && !prewarmRequested); });
+
+            // An idle host may still be busy with the last preview it was sent
+            const auto now = Clock::now();
+            for (auto idle = hosts.begin(); idle != hosts.end();)
+            {
+                if (idle->preview == 0)
+                {
+                    DrainReplies(*idle);
+                    if (Hung(*idle, now))
+                    {
+                        TerminateHung(idle);
+                        continue;
+                    }
+                }
+
+                ++idle;
+            }
+
+            auto host = std::find_if(hosts.begin(), hosts.end(), [](const Host& h) { return h.preview == 0 && h.pendingReply == 0; });
+            if (host == hosts.end())
+            {
+                host = std::find_if(hosts.begin(), hosts.end(), [](const Host& h) { return h.preview == 0; });
+            }
+
+            if (host != hosts.end())
+            {
+                // The host is what a pending prewarm would have started
+                prewarmRequested = false;
+            }
+            else
+            {
+                auto channel = Launch(lock);
+                if (!channel)
+                {
+                    return 0;
+                }
+
+                hosts.push_back({ .channel = std::move(channel) });
+                host = hosts.end() - 1;
+            }
+
+            if (host->channel->Send(*command))
+            {
+                host->preview = id;
+                host->previews++;
+                host->lastUsed = Clock::now();
+                host->pendingReply = id;
+                host->sent = host->lastUsed;
+
+                // The host is recycled after this preview, its replacement starts while it shows it
+                if (host->previews >= options.maxPreviews)
+                {
+                    prewarmRequested = true;
+                    changed.notify_all();
+                }
+
+                return id;
+            }
+
+            statistics.lost++;
+            host->channel->Terminate();
+            hosts.erase(host);
+        }
+
+        return 0;
+    }
+
+    void Resize(const uint64_t id, const PreviewHostRect& rect)
+    {
+        std::unique_lock lock{ mutex };
+        if (Host* host = FindPreview(id))
+        {
+            host->channel->Send(PreviewHostProtocol::ResizeCommand(id, rect));
+        }
+    }
+
+    // Hides the preview. The host stays for the next one unless it's due to be recycled or another host is idle.
+    void Unload(const uint64_t id)
+    {
+        std::unique_lock lock{ mutex };
+        Host* host = FindPreview(id);
+        if (!host)
+        {
+            return;
+        }
+
+        host->channel->Send(PreviewHostProtocol::UnloadCommand(id));
+        DrainReplies(*host);
+        host->preview = 0;
+        host->lastUsed = Clock::now();
+        rescheduled = true;
+        changed.notify_all();
+
+        if (Hung(*host, host->lastUsed))
+        {
+            TerminateHung(hosts.begin() + (host - hosts.data()));
+            if (!HasIdleHost())
+            {
+                prewarmRequested = true;
+                changed.notify_all();
+            }
+
+            return;
+        }
+
+        const bool recycle = host->previews >= options.maxPreviews;
+        const bool spare = std::count_if(hosts.begin(), hosts.end(), [](const Host& h) { return h.preview == 0; }) > 1;
+        if (recycle || spare)
+        {
+            statistics.recycled += recycle ? 1 : 0;
+            Exit(std::move(host->channel));
+            hosts.erase(hosts.begin() + (host - hosts.data()));
+        }
+
+        // In case the replacement couldn't be started with the last preview
+        if (recycle && !HasIdleHost())
+        {
+            prewarmRequested = true;
+            changed.notify_all();
+        }
+    }
+
+    // Waits until the host showed the preview, for tests and benchmarks. The host handles previews one at a time, so
+    // this is the time to the first paint of the preview. The pool isn't locked while waiting.
+    bool WaitForPreview(const uint64_t id, const std::chrono::milliseconds timeout)
+    {
+        const auto deadline = Clock::now() + timeout;
+        std::shared_ptr<PreviewHostChannel> channel;
+        {
+            std::unique_lock lock{ mutex };
+            Host* host = FindPreview(id);
+            if (!host || host->receiving)
+            {
+                return false;
+            }
+
+            host->receiving = true;
+            channel = host->channel;
+        }
+
+        while (true)
+        {
+            const auto now = Clock::now();
+            const auto line = channel->Receive(std::chrono::duration_cast<std::chrono::milliseconds>(std::max(deadline - now, Clock::duration::zero())));
+
+            // The host may have been unloaded, recycled or replaced meanwhile
+            std::unique_lock lock{ mutex };
+            Host* host = FindChannel(channel.get());
+            if (!host)
+            {
+                return false;
+            }
+
+            if (!line)
+            {
+                host->receiving = false;
+                return false;
+            }
+
+            const auto reply = HandleReply(*host, *line);
+            if (reply.id == id && (reply.kind == PreviewHostProtocol::ReplyKind::Shown || reply.kind == PreviewHostProtocol::ReplyKind::Failed))
+            {
+                host->receiving = false;
+                return reply.kind == PreviewHostProtocol::ReplyKind::Shown;
+            }
+        }
+    }
+
+    size_t HostCount()
+    {
+        std::unique_lock lock{ mutex };
+        return hosts.size();
+    }
+
+    PreviewHostPoolStatistics Statistics()
+    {
+        std::unique_lock lock{ mutex };
+        return statistics;
+    }
+};
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <wil/resource.h>
+
+#include <common/logger/logger.h>
+
+#include "PreviewHostPool.h"
+
+// Runs a preview host .exe with "--pooled <process id>", and talks to it through its standard input and output. The
+// host exits when its input is closed or when the process which started it exits, so it never outlives it.
+class PreviewHostProcess : public PreviewHostChannel
+{
+    wil::unique_process_information process;
+    wil::unique_handle input;
+    wil::unique_handle output;
+    std::string received;
+
+    // Moves a complete line from what was received into line
+    bool TakeLine(std::string& line)
+    {
+        const auto end = received.find('\n');
+        if (end == std::string::npos)
+        {
+            return false;
+        }
+
+        line.assign(received, 0, end > 0 && received[end - 1] == '\r' ? end - 1 : end);
+        received.erase(0, end + 1);
+        return true;
+    }
+
+public:
+    PreviewHostProcess(wil::unique_process_information process, wil::unique_handle input, wil::unique_handle output) :
+        process{ std::move(process) }, input{ std::move(input) }, output{ std::move(output) }
+    {
+    }
+
+    ~PreviewHostProcess()
+    {
+        // Closing the input tells the host to exit
+        input.reset();
+    }
+
+    bool Send(const std::string& line) override
+    {
+        const std::string message = line + '\n';
+        DWORD written = 0;
+        return WriteFile(input.get(), message.data(), static_cast<DWORD>(message.size()), &written, nullptr) && written == message.size();
+    }
+
+    std::optional<std::string> Receive(std::chrono::milliseconds timeout) override
+    {
+        // Anonymous pipes can't be read with a timeout, so they are polled
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        std::string line;
+        while (!TakeLine(line))
+        {
+            DWORD available = 0;
+            if (!PeekNamedPipe(output.get(), nullptr, 0, nullptr, &available, nullptr))
+            {
+                return std::nullopt;
+            }
+
+            if (available == 0)
+            {
+                if (std::chrono::steady_clock::now() >= deadline)
+                {
+                    return std::nullopt;
+                }
+
+                WaitForSingleObject(process.hProcess, 1);
+                continue;
+            }
+
+            char buffer[4096];
+            DWORD read = 0;
+            if (!ReadFile(output.get(), buffer, std::min<DWORD>(available, sizeof(buffer)), &read, nullptr) || read == 0)
+            {
+                return std::nullopt;
+            }
+
+            received.append(buffer, read);
+        }
+
+        return line;
+    }
+
+    bool Running() override
+    {
+        return WaitForSingleObject(process.hProcess, 0) == WAIT_TIMEOUT;
+    }
+
+    void Terminate() override
+    {
+        if (Running())
+        {
+            TerminateProcess(process.hProcess, 0);
+        }
+    }
+};
+
+class PreviewHostProcessLauncher : public PreviewHostLauncher
+{
+    std::wstring appPath;
+
+public:
+    explicit PreviewHostProcessLauncher(std::wstring appPath) :
+        appPath{ std::move(appPath) }
+    {
+    }
+
+    std::unique_ptr<PreviewHostChannel> Launch() override
+    {
+        // Only the host's ends of the pipes are inherited, and only by the host
+        SECURITY_ATTRIBUTES inheritable{ .nLength = sizeof(SECURITY_ATTRIBUTES), .bInheritHandle = TRUE };
+        wil::unique_handle hostInput, input, output, hostOutput;
+        if (!CreatePipe(&hostInput, &input, &inheritable, 0) || !CreatePipe(&output, &hostOutput, &inheritable, 0) ||
+            !SetHandleInformation(input.get(), HANDLE_FLAG_INHERIT, 0) || !SetHandleInformation(output.get(), HANDLE_FLAG_INHERIT, 0))
+        {
+            Logger::error(L"Failed to create the pipes of the preview host. {}", GetLastError());
+            return nullptr;
+        }
+
+        HANDLE inherited[] = { hostInput.get(), hostOutput.get() };
+        SIZE_T attributesSize = 0;
+        InitializeProcThreadAttributeList(nullptr, 1, 0, &attributesSize);
+        std::vector<std::byte> attributesBuffer(attributesSize);
+        auto attributes = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributesBuffer.data());
+        if (!InitializeProcThreadAttributeList(attributes, 1, 0, &attributesSize))
+        {
+            Logger::error(L"Failed to initialize the attributes of the preview host. {}", GetLastError());
+            return nullptr;
+        }
+
+        auto deleteAttributes = wil::scope_exit([attributes] { DeleteProcThreadAttributeList(attributes); });
+        if (!UpdateProcThreadAttribute(attributes, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherited, sizeof(inherited), nullptr, nullptr))
+        {
+            Logger::error(L"Failed to set the handles of the preview host. {}", GetLastError());
+            return nullptr;
+        }
+
+        STARTUPINFOEXW startupInfo{};
+        startupInfo.StartupInfo.cb = sizeof(startupInfo);
+        startupInfo.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+        startupInfo.StartupInfo.hStdInput = hostInput.get();
+        startupInfo.StartupInfo.hStdOutput = hostOutput.get();
+        startupInfo.lpAttributeList = attributes;
+
+        std::wstring commandLine = L"\"" + appPath + L"\" --pooled " + std::to_wstring(GetCurrentProcessId());
+        wil::unique_process_information process;
+        if (!CreateProcessW(appPath.c_str(), commandLine.data(), nullptr, nullptr, TRUE, EXTENDED_STARTUPINFO_PRESENT, nullptr, nullptr, &startupInfo.StartupInfo, &process))
+        {
+            Logger::error(L"Failed to start {}. {}", appPath, GetLastError());
+            return nullptr;
+        }
+
+        Logger::info(L"Started preview host {}", process.dwProcessId);
+        return std::make_unique<PreviewHostProcess>(std::move(process), std::move(input), std::move(output));
+    }
+};
+
+// Creates the pool of the hosts of a preview handler. The hosts outlive the handlers, so the pool is never destroyed
+// and the calling DLL stays loaded from then on, instead of unloading while the pool's thread runs its code.
+inline PreviewHostPool* CreatePreviewHostPool(std::wstring appPath)
+{
+    HMODULE module = nullptr;
+    GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN, reinterpret_cast<LPCWSTR>(&CreatePreviewHostPool), &module);
+    return new PreviewHostPool(std::make_unique<PreviewHostProcessLauncher>(std::move(appPath)));
+}
@@ -0,0 +1,658 @@
+#include "pch.h"
+#include "GcodeBenchmark.h"
+
+#include "QoiEncoder.h"
+#include <common/utils/benchmark.h>
+
+#include <GcodeThumbnails.h>
+#include <QoiDecoder.h>
+
+namespace
+{
+    using namespace PreviewPaneBenchmark;
+
+    // Moves of a print, repeated to fill a file of any size without allocating it
+    const std::string& FillerPattern()
+    {
+        static const std::string pattern = [] {
+            std::string text;
+            char line[64];
+            for (int i = 0; i < 64; ++i)
+            {
+                snprintf(line, sizeof(line), "G1 X%d.%03d Y%d.%03d E%d.%05d\n", 100 + i, i * 37 % 1000, 80 + i % 13, i * 91 % 1000, i % 3, i * 1234 % 100000);
+                text += line;
+            }
+
+            return text;
+        }();
+        return pattern;
+    }
+
+    // A G-code file made of explicit text and of filler, read through a counting byte source
+    class SyntheticGcode
+    {
+        struct Segment
+        {
+            uint64_t offset = {};
+            uint64_t size = {};
+            std::string text;
+        };
+
+        std::vector<Segment> segments;
+        uint64_t size = 0;
+
+    public:
+        SyntheticGcode& Text(std::string text)
+        {
+            const uint64_t length = text.size();
+            segments.push_back({ .offset = size, .size = length, .text = std::move(text) });
+            size += length;
+            return *this;
+        }
+
+        // About `bytes` bytes of whole lines of moves
+        SyntheticGcode& Filler(const uint64_t bytes)
+        {
+            const uint64_t length = bytes / FillerPattern().size() * FillerPattern().size();
+            segments.push_back({ .offset = size, .size = length });
+            size += length;
+            return *this;
+        }
+
+        uint64_t Size() const
+        {
+            return size;
+        }
+
+        size_t ReadAt(const uint64_t offset, uint8_t* buffer, size_t count) const
+        {
+            count = static_cast<size_t>(std::min<uint64_t>(count, offset < size ? size - offset : 0));
+            auto segment = std::upper_bound(segments.begin(), segments.end(), offset, [](const uint64_t o, const Segment& s) { return o < s.offset; });
+            for (size_t copied = 0; copied < count; ++segment)
+            {
+                const Segment& s = *(segment - 1);
+                const uint64_t position = offset + copied - s.offset;
+                const size_t length = static_cast<size_t>(std::min<uint64_t>(count - copied, s.size - position));
+                if (!s.text.empty())
+                {
+                    std::memcpy(buffer + copied, s.text.data() + position, length);
+                }
+                else
+                {
+                    const std::string& pattern = FillerPattern();
+                    for (size_t i = 0; i < length;)
+                    {
+                        const size_t start = static_cast<size_t>((position + i) % pattern.size());
+                        const size_t run = std::min(length - i, pattern.size() - start);
+                        std::memcpy(buffer + copied + i, pattern.data() + start, run);
+                        i += run;
+                    }
+                }
+
+                copied += length;
+            }
+
+            return count;
+        }
+
+        std::vector<uint8_t> Bytes() const
+        {
+            std::vector<uint8_t> bytes(static_cast<size_t>(size));
+            ReadAt(0, bytes.data(), bytes.size());
+            return bytes;
+        }
+    };
+
+    class SyntheticByteSource : public GcodeByteSource
+    {
+        const SyntheticGcode& file;
+        bool knownSize;
+
+    public:
+        uint64_t bytesRead = 0;
+
+        SyntheticByteSource(const SyntheticGcode& file, const bool knownSize = true) :
+            file{ file }, knownSize{ knownSize }
+        {
+        }
+
+        std::optional<uint64_t> Size() override
+        {
+            return knownSize ? std::optional<uint64_t>{ file.Size() } : std::nullopt;
+        }
+
+        size_t ReadAt(uint64_t offset, uint8_t* buffer, size_t size) override
+        {
+            const size_t read = file.ReadAt(offset, buffer, size);
+            bytesRead += read;
+            return read;
+        }
+    };
+
+    class MemoryByteSource : public GcodeByteSource
+    {
+        const std::vector<uint8_t>& bytes;
+
+    public:
+        explicit MemoryByteSource(const std::vector<uint8_t>& bytes) :
+            bytes{ bytes }
+        {
+        }
+
+        std::optional<uint64_t> Size() override
+        {
+            return bytes.size();
+        }
+
+        size_t ReadAt(uint64_t offset, uint8_t* buffer, size_t size) override
+        {
+            if (offset >= bytes.size())
+            {
+                return 0;
+            }
+
+            size = std::min<size_t>(size, bytes.size() - static_cast<size_t>(offset));
+            std::memcpy(buffer, bytes.data() + offset, size);
+            return size;
+        }
+    };
+
+    class QoiMemoryByteSource : public QoiByteSource
+    {
+        const std::vector<uint8_t>& bytes;
+        size_t position = 0;
+
+    public:
+        explicit QoiMemoryByteSource(const std::vector<uint8_t>& bytes) :
+            bytes{ bytes }
+        {
+        }
+
+        size_t Read(uint8_t* buffer, size_t size) override
+        {
+            size = std::min(size, bytes.size() - position);
+            std::memcpy(buffer, bytes.data() + position, size);
+            position += size;
+            return size;
+        }
+    };
+
+    std::string EncodeBase64(const std::vector<uint8_t>& data)
+    {
+        constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string text;
+        for (size_t i = 0; i < data.size(); i += 3)
+        {
+            const uint32_t group = static_cast<uint32_t>(data[i]) << 16 | (i + 1 < data.size() ? data[i + 1] << 8 : 0) | (i + 2 < data.size() ? data[i + 2] : 0);
+            text += alphabet[group >> 18 & 0x3F];
+            text += alphabet[group >> 12 & 0x3F];
+            text += i + 1 < data.size() ? alphabet[group >> 6 & 0x3F] : '=';
+            text += i + 2 < data.size() ? alphabet[group & 0x3F] : '=';
+        }
+
+        return text;
+    }
+
+    const char* FormatSuffix(const GcodeThumbnailFormat format)
+    {
+        switch (format)
+        {
+        case GcodeThumbnailFormat::JPG:
+            return "_JPG";
+        case GcodeThumbnailFormat::QOI:
+            return "_QOI";
+        default:
+            return "";
+        }
+    }
+
+    // A block the way PrusaSlicer writes it: 78 characters of base64 per line and an empty comment after it
+    std::string WriteBlock(const GcodeThumbnail& thumbnail, const std::string_view lineBreak = "\n", const size_t lineLength = 78)
+    {
+        const std::string base64 = EncodeBase64(thumbnail.data);
+        std::string text = "; thumbnail" + std::string{ FormatSuffix(thumbnail.format) } + " begin " + std::to_string(thumbnail.width) + "x" +
+                           std::to_string(thumbnail.height) + " " + std::to_string(base64.size()) + std::string{ lineBreak };
+        for (size_t i = 0; i < base64.size(); i += lineLength)
+        {
+            text += "; " + base64.substr(i, lineLength) + std::string{ lineBreak };
+        }
+
+        text += "; thumbnail" + std::string{ FormatSuffix(thumbnail.format) } + " end" + std::string{ lineBreak } + ";" + std::string{ lineBreak };
+        return text;
+    }
+
+    std::string WriteBlocks(const std::vector<GcodeThumbnail>& thumbnails, const std::string_view lineBreak = "\n")
+    {
+        std::string text;
+        for (const auto& thumbnail : thumbnails)
+        {
+            text += WriteBlock(thumbnail, lineBreak);
+        }
+
+        return text;
+    }
+
+    // The data only has to look like an image file, the scanner doesn't decode it
+    GcodeThumbnail MakeThumbnail(const GcodeThumbnailFormat format, const uint32_t width, const uint32_t height, std::mt19937& random)
+    {
+        GcodeThumbnail thumbnail{ .format = format, .width = width, .height = height };
+        if (format == GcodeThumbnailFormat::QOI)
+        {
+            std::vector<uint32_t> pixels(static_cast<size_t>(width) * height);
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    const uint32_t noise = random() % 4;
+                    pixels[static_cast<size_t>(y) * width + x] = (x * 4 / width == 2 ? 0u : 0xFF000000u) | (x * 255 / width) << 16 | (y * 255 / height) << 8 | noise;
+                }
+            }
+
+            thumbnail.data = EncodeQoi(pixels, width, height, 4);
+            return thumbnail;
+        }
+
+        static const std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        static const std::vector<uint8_t> jpg = { 0xFF, 0xD8, 0xFF, 0xE0 };
+        thumbnail.data = format == GcodeThumbnailFormat::JPG ? jpg : png;
+        // Compressed images are about a byte per pixel at these sizes
+        const size_t size = static_cast<size_t>(width) * height / 4 + random() % 64;
+        for (size_t i = 0; i < size; ++i)
+        {
+            thumbnail.data.push_back(static_cast<uint8_t>(random()));
+        }
+
+        return thumbnail;
+    }
+
+    struct Fixture
+    {
+        std::wstring name;
+        SyntheticGcode file;
+        std::vector<GcodeThumbnail> thumbnails;
+        // Whether the thumbnails are outside of the default windows
+        bool fullScan = false;
+    };
+
+    std::string Header(const std::string_view slicer)
+    {
+        return "; generated by " + std::string{ slicer } + " on 2024-05-01 at 10:00:00 UTC\n\n;\n";
+    }
+
+    std::vector<Fixture> MakeFixtures(const uint64_t fillerBytes, const unsigned int seed)
+    {
+        std::mt19937 random(seed);
+        std::vector<Fixture> fixtures;
+
+        {
+            // PrusaSlicer: the sizes of the printer profile at the start, its configuration at the end
+            Fixture fixture{ .name = L"PrusaSlicer" };
+            fixture.thumbnails = { MakeThumbnail(GcodeThumbnailFormat::PNG, 16, 16, random),
+                                   MakeThumbnail(GcodeThumbnailFormat::PNG, 313, 173, random),
+                                   MakeThumbnail(GcodeThumbnailFormat::QOI, 440, 240, random) };
+            fixture.file.Text(Header("PrusaSlicer 2.7.4") + WriteBlocks(fixture.thumbnails) + "\n; external perimeters extrusion width = 0.45mm\n\nM73 P0 R42\nG21\n")
+                .Filler(fillerBytes)
+                .Text("; filament used [mm] = 1234.56\n\n; prusaslicer_config = begin\n; layer_height = 0.2\n; prusaslicer_config = end\n");
+            fixtures.push_back(std::move(fixture));
+        }
+
+        {
+            // Cura: one thumbnail after the header
+            Fixture fixture{ .name = L"Cura" };
+            fixture.thumbnails = { MakeThumbnail(GcodeThumbnailFormat::PNG, 300, 300, random) };
+            fixture.file.Text(";START_OF_HEADER\n;HEADER_VERSION:0.1\n;FLAVOR:Griffin\n;GENERATOR.NAME:Cura_SteamEngine\n;END_OF_HEADER\n" +
+                              WriteBlocks(fixture.thumbnails) + ";FLAVOR:Marlin\n;TIME:6042\n;Generated with Cura_SteamEngine 5.7.0\n")
+                .Filler(fillerBytes)
+                .Text(";TIME_ELAPSED:6042.0\n;End of Gcode\n");
+            fixtures.push_back(std::move(fixture));
+        }
+
+        {
+            // Bambu Studio and OrcaSlicer: the blocks are inside a thumbnail section after a header section
+            Fixture fixture{ .name = L"Bambu Studio" };
+            fixture.thumbnails = { MakeThumbnail(GcodeThumbnailFormat::PNG, 512, 512, random), MakeThumbnail(GcodeThumbnailFormat::PNG, 128, 128, random) };
+            fixture.file.Text("; HEADER_BLOCK_START\n; BambuStudio 01.09.00.70\n; model printing time: 1h 40m; total estimated time: 1h 47m\n"
+                              "; HEADER_BLOCK_END\n\n; THUMBNAIL_BLOCK_START\n" +
+                              WriteBlocks(fixture.thumbnails) + "; THUMBNAIL_BLOCK_END\n\n; CONFIG_BLOCK_START\n; layer_height = 0.2\n; CONFIG_BLOCK_END\n")
+                .Filler(fillerBytes);
+            fixtures.push_back(std::move(fixture));
+        }
+
+        {
+            // JPG thumbnails with Windows line breaks
+            Fixture fixture{ .name = L"JPG, CRLF" };
+            fixture.thumbnails = { MakeThumbnail(GcodeThumbnailFormat::JPG, 220, 124, random), MakeThumbnail(GcodeThumbnailFormat::JPG, 32, 32, random) };
+            fixture.file.Text(Header("SuperSlicer 2.5.59") + WriteBlocks(fixture.thumbnails, "\r\n") + "M107\r\n").Filler(fillerBytes);
+            fixtures.push_back(std::move(fixture));
+        }
+
+        {
+            // Post-processing scripts which append the thumbnails
+            Fixture fixture{ .name = L"Thumbnails at end" };
+            fixture.thumbnails = { MakeThumbnail(GcodeThumbnailFormat::PNG, 300, 300, random), MakeThumbnail(GcodeThumbnailFormat::QOI, 64, 64, random) };
+            fixture.file.Text(";FLAVOR:Marlin\nG28\n").Filler(fillerBytes).Text(";End of Gcode\n" + WriteBlocks(fixture.thumbnails));
+            fixtures.push_back(std::move(fixture));
+        }
+
+        {
+            Fixture fixture{ .name = L"Thumbnails in middle", .fullScan = true };
+            fixture.thumbnails = { MakeThumbnail(GcodeThumbnailFormat::PNG, 200, 200, random) };
+            fixture.file.Text(";FLAVOR:Marlin\nG28\n").Filler(fillerBytes / 2).Text(WriteBlocks(fixture.thumbnails)).Filler(fillerBytes / 2);
+            fixtures.push_back(std::move(fixture));
+        }
+
+        return fixtures;
+    }
+
+    bool Equal(const std::vector<GcodeThumbnail>& a, const std::vector<GcodeThumbnail>& b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const GcodeThumbnail& x, const GcodeThumbnail& y) {
+            return x.format == y.format && x.width == y.width && x.height == y.height && x.data == y.data;
+        });
+    }
+
+    // The largest block of the file, blocks which start in a window are read to their end
+    uint64_t LargestBlock(const std::vector<GcodeThumbnail>& thumbnails)
+    {
+        uint64_t largest = 0;
+        for (const auto& thumbnail : thumbnails)
+        {
+            largest = std::max<uint64_t>(largest, WriteBlock(thumbnail, "\r\n").size());
+        }
+
+        return largest;
+    }
+
+    CheckResult CheckSlicerFiles(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"G-code slicer files" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        const GcodeScanOptions options;
+        for (const uint64_t filler : { uint64_t{ 1024 }, uint64_t{ 8 * 1024 * 1024 } })
+        {
+            for (const auto& fixture : MakeFixtures(filler, seed))
+            {
+                SyntheticByteSource source{ fixture.file };
+                const auto scan = FindGcodeThumbnails(source, options);
+                const bool windowed = fixture.file.Size() > options.headWindow + options.tailWindow;
+                check(Equal(scan.thumbnails, fixture.thumbnails) && scan.bytesRead == source.bytesRead);
+                check(scan.fullScan == (windowed && fixture.fullScan));
+
+                // Small files are read once, large ones only at their ends unless the thumbnails are elsewhere
+                const uint64_t bound = !windowed ? fixture.file.Size() :
+                                       scan.fullScan ? fixture.file.Size() + options.tailWindow + GcodeFormat::ChunkSize :
+                                                       options.headWindow + options.tailWindow + LargestBlock(fixture.thumbnails) + 2 * GcodeFormat::ChunkSize;
+                check(scan.bytesRead <= bound);
+
+                // Without a size the whole file is read, and the same thumbnails are found
+                SyntheticByteSource unknownSize{ fixture.file, false };
+                const auto fullScan = FindGcodeThumbnails(unknownSize, options);
+                check(Equal(fullScan.thumbnails, fixture.thumbnails) && fullScan.bytesRead == fixture.file.Size());
+            }
+        }
+
+        // The embedded QOI thumbnails decode to the image they were made of
+        for (const auto& fixture : MakeFixtures(1024, seed))
+        {
+            for (const auto& thumbnail : fixture.thumbnails)
+            {
+                if (thumbnail.format == GcodeThumbnailFormat::QOI)
+                {
+                    QoiMemoryByteSource source{ thumbnail.data };
+                    const auto image = DecodeQoiThumbnail(source, std::max(thumbnail.width, thumbnail.height));
+                    check(image && image->width == thumbnail.width && image->height == thumbnail.height);
+                }
+            }
+        }
+
+        return result;
+    }
+
+    // Blocks which straddle the edges of the windows and lines split between reads
+    CheckResult CheckWindowEdges(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"G-code window edges" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        std::mt19937 random(seed);
+        const std::vector<GcodeThumbnail> thumbnails = { MakeThumbnail(GcodeThumbnailFormat::PNG, 48, 48, random),
+                                                         MakeThumbnail(GcodeThumbnailFormat::QOI, 24, 24, random) };
+        const std::string blocks = WriteBlocks(thumbnails);
+
+        // Windows ending anywhere in the blocks at the start of the file, or starting anywhere in the ones at its end
+        SyntheticGcode head;
+        head.Text(";FLAVOR:Marlin\n" + blocks).Filler(256 * 1024);
+        SyntheticGcode tail;
+        tail.Text(";FLAVOR:Marlin\n").Filler(256 * 1024).Text(blocks + ";End of Gcode\n");
+        for (uint64_t edge = 1; edge < blocks.size() + 64; edge += 1 + edge / 8)
+        {
+            SyntheticByteSource headSource{ head };
+            const auto headScan = FindGcodeThumbnails(headSource, { .headWindow = edge, .tailWindow = 4096 });
+            // A window which ends between the blocks finds the first one only, which is enough
+            check((Equal(headScan.thumbnails, thumbnails) || Equal(headScan.thumbnails, { thumbnails[0] })) && !headScan.fullScan);
+
+            // A block cut by the start of the tail window is found by the full scan, the others by the tail scan
+            SyntheticByteSource tailSource{ tail };
+            const auto tailScan = FindGcodeThumbnails(tailSource, { .headWindow = 4096, .tailWindow = edge });
+            check(Equal(tailScan.thumbnails, thumbnails) || (tailScan.thumbnails.size() == 1 && Equal(tailScan.thumbnails, { thumbnails[1] }) && !tailScan.fullScan));
+        }
+
+        // The scanner gets the same thumbnails however the file is split
+        const auto bytes = MakeFixtures(1024, seed)[0].file.Bytes();
+        const auto expected = MakeFixtures(1024, seed)[0].thumbnails;
+        for (size_t i = 0; i < 200; ++i)
+        {
+            GcodeThumbnailScanner scanner{ GcodeScanOptions{}.maxBlockSize };
+            const size_t maxPiece = size_t{ 1 } << (i % 12);
+            for (size_t position = 0; position < bytes.size();)
+            {
+                const size_t piece = std::min<size_t>(bytes.size() - position, 1 + random() % maxPiece);
+                scanner.Feed(bytes.data() + position, piece);
+                position += piece;
+            }
+
+            scanner.Finish();
+            check(Equal(scanner.TakeThumbnails(), expected));
+        }
+
+        return result;
+    }
+
+    CheckResult CheckRanking(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"G-code ranking" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        std::mt19937 random(seed);
+        const std::vector<GcodeThumbnail> thumbnails = { MakeThumbnail(GcodeThumbnailFormat::PNG, 16, 16, random),
+                                                         MakeThumbnail(GcodeThumbnailFormat::JPG, 600, 600, random),
+                                                         MakeThumbnail(GcodeThumbnailFormat::QOI, 300, 300, random),
+                                                         MakeThumbnail(GcodeThumbnailFormat::PNG, 220, 124, random),
+                                                         GcodeThumbnail{ .width = 1000, .height = 1000, .data = { 1, 2, 3 } },
+                                                         MakeThumbnail(GcodeThumbnailFormat::PNG, 300, 300, random) };
+
+        check(RankGcodeThumbnails(thumbnails, 16) == std::vector<size_t>{ 0, 3, 5, 2, 1 });
+        check(RankGcodeThumbnails(thumbnails, 96) == std::vector<size_t>{ 3, 5, 2, 1, 0 });
+        check(RankGcodeThumbnails(thumbnails, 256) == std::vector<size_t>{ 5, 2, 1, 3, 0 });
+        check(RankGcodeThumbnails(thumbnails, 1024) == std::vector<size_t>{ 1, 5, 2, 3, 0 });
+
+        // Between thumbnails of the same size and format, the larger file is likely the better one
+        std::vector<GcodeThumbnail> same = { thumbnails[5], thumbnails[5] };
+        same[1].data.push_back(0);
+        check(RankGcodeThumbnails(same, 256) == std::vector<size_t>{ 1, 0 });
+        check(RankGcodeThumbnails({}, 256).empty());
+
+        return result;
+    }
+
+    CheckResult CheckMalformedBlocks(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"G-code malformed" };
+        std::mt19937 random(seed);
+        auto thumbnail = MakeThumbnail(GcodeThumbnailFormat::PNG, 24, 24, random);
+        // So the base64 text ends with padding
+        thumbnail.data.resize(thumbnail.data.size() / 3 * 3 + 1);
+        const std::string block = WriteBlock(thumbnail);
+        const std::string base64 = EncodeBase64(thumbnail.data);
+
+        const auto thumbnailsOf = [](const std::string& text, const GcodeScanOptions& options = {}) {
+            const std::vector<uint8_t> bytes{ text.begin(), text.end() };
+            MemoryByteSource source{ bytes };
+            return FindGcodeThumbnails(source, options).thumbnails;
+        };
+
+        const auto replace = [](std::string text, const std::string_view from, const std::string_view to) {
+            text.replace(text.find(from), from.size(), to);
+            return text;
+        };
+
+        const GcodeThumbnail unsized{ .format = GcodeThumbnailFormat::PNG, .data = thumbnail.data };
+        const GcodeThumbnail jpg{ .format = GcodeThumbnailFormat::JPG, .width = 24, .height = 24, .data = thumbnail.data };
+        const std::vector<std::pair<std::string, std::vector<GcodeThumbnail>>> cases = {
+            // Dropped: invalid characters, data after the padding, a line of G-code, no end, an unknown format
+            { replace(block, base64.substr(0, 4), "iV*O"), {} },
+            { replace(block, "; thumbnail end", "; AAAA\n; thumbnail end"), {} },
+            { replace(block, "; thumbnail end", "G1 X10\n; thumbnail end"), {} },
+            { block.substr(0, block.find("; thumbnail end")), {} },
+            { replace(replace(block, "thumbnail begin", "thumbnail_BMP begin"), "thumbnail end", "thumbnail_BMP end"), {} },
+            { "; thumbnail begin 24x24 0\n; thumbnail end\n", {} },
+            { replace(block, "; thumbnail end", ";" + std::string(GcodeFormat::MaxLineLength, 'A') + "\n; thumbnail end"), {} },
+            // A block which begins inside another one replaces it
+            { block.substr(0, block.size() / 2) + "\n" + block, { thumbnail } },
+            // Kept: an end without a begin, no length, no size, lower case formats, no line break at the end
+            { "; thumbnail end\n" + block, { thumbnail } },
+            { replace(block, " " + std::to_string(base64.size()) + "\n", "\n"), { thumbnail } },
+            { replace(block, "24x24 " + std::to_string(base64.size()), "garbage"), { unsized } },
+            { replace(replace(block, "thumbnail begin", "thumbnail_jpg begin"), "thumbnail end", "thumbnail_jpg end"), { jpg } },
+            { block.substr(0, block.size() - 3), { thumbnail } },
+        };
+
+        for (const auto& [text, expected] : cases)
+        {
+            result.cases++;
+            result.failures += Equal(thumbnailsOf(text), expected) ? 0 : 1;
+        }
+
+        // Blocks larger than the limit are dropped, and reading doesn't go past them
+        result.cases++;
+        result.failures += thumbnailsOf(block, { .maxBlockSize = base64.size() / 2 }).empty() &&
+                                   Equal(thumbnailsOf(block, { .maxBlockSize = base64.size() + 1024 }), { thumbnail }) ?
+                               0 :
+                               1;
+
+        return result;
+    }
+
+    CheckResult CheckMutatedFiles(const size_t iterations, const unsigned int seed)
+    {
+        CheckResult result{ .name = L"G-code mutated files" };
+        std::mt19937 random(seed);
+        const auto fixtures = MakeFixtures(32 * 1024, seed);
+        std::vector<std::vector<uint8_t>> originals;
+        for (const auto& fixture : fixtures)
+        {
+            originals.push_back(fixture.file.Bytes());
+        }
+
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            auto bytes = originals[i % originals.size()];
+            const size_t mutations = 1 + random() % 8;
+            for (size_t m = 0; m < mutations; ++m)
+            {
+                const size_t position = random() % bytes.size();
+                switch (random() % 4)
+                {
+                case 0:
+                    bytes[position] = static_cast<uint8_t>(random());
+                    break;
+                case 1:
+                    bytes[position] = "\n\r;= "[random() % 5];
+                    break;
+                case 2:
+                    bytes.erase(bytes.begin() + position, bytes.begin() + std::min(bytes.size(), position + 1 + random() % 64));
+                    break;
+                default:
+                    bytes.insert(bytes.begin() + position, 1 + random() % 16, static_cast<uint8_t>(random()));
+                    break;
+                }
+
+                if (bytes.empty())
+                {
+                    bytes.push_back('\n');
+                }
+            }
+
+            // Small windows, so mutated files take every path, which never reads much more than the file
+            const GcodeScanOptions options{ .headWindow = 1 + random() % 16384, .tailWindow = 1 + random() % 16384, .maxBlockSize = 64 * 1024 };
+            MemoryByteSource source{ bytes };
+            const auto scan = FindGcodeThumbnails(source, options);
+            result.cases++;
+            const bool valid = scan.bytesRead <= bytes.size() + options.tailWindow + GcodeFormat::ChunkSize &&
+                               std::all_of(scan.thumbnails.begin(), scan.thumbnails.end(), [&](const GcodeThumbnail& t) {
+                                   return t.format != GcodeThumbnailFormat::Unknown && !t.data.empty() && t.data.size() <= options.maxBlockSize;
+                               });
+            const auto ranking = RankGcodeThumbnails(scan.thumbnails, 256);
+            result.failures += valid && ranking.size() == scan.thumbnails.size() ? 0 : 1;
+        }
+
+        return result;
+    }
+}
+
+namespace PreviewPaneBenchmark
+{
+    std::vector<CheckResult> RunGcodeChecks(size_t fuzzIterations, unsigned int seed)
+    {
+        return { CheckSlicerFiles(seed),
+                 CheckWindowEdges(seed),
+                 CheckRanking(seed),
+                 CheckMalformedBlocks(seed),
+                 CheckMutatedFiles(fuzzIterations, seed) };
+    }
+
+    std::vector<GcodeThroughputResult> RunGcodeThroughputBenchmark(const std::vector<uint64_t>& fileSizes, unsigned int seed)
+    {
+        std::vector<GcodeThroughputResult> results;
+        for (const uint64_t fileSize : fileSizes)
+        {
+            for (const auto& fixture : MakeFixtures(fileSize, seed))
+            {
+                if (fixture.name != L"PrusaSlicer" && fixture.name != L"Thumbnails at end" && fixture.name != L"Thumbnails in middle")
+                {
+                    continue;
+                }
+
+                GcodeThroughputResult result{ .layout = fixture.name, .fileBytes = fixture.file.Size() };
+                SyntheticByteSource source{ fixture.file };
+                GcodeScanResult scan;
+                result.seconds = benchmark::MeasureSeconds([&] { scan = FindGcodeThumbnails(source); });
+                if (!Equal(scan.thumbnails, fixture.thumbnails))
+                {
+                    throw std::runtime_error("failed to find the thumbnails of a synthetic G-code file");
+                }
+
+                result.thumbnails = scan.thumbnails.size();
+                result.bytesRead = scan.bytesRead;
+                result.fullScan = scan.fullScan;
+
+                SyntheticByteSource unknownSize{ fixture.file, false };
+                result.fullScanSeconds = benchmark::MeasureSeconds([&] { scan = FindGcodeThumbnails(unknownSize); });
+                result.fullScanBytesRead = scan.bytesRead;
+                results.push_back(result);
+            }
+        }
+
+        return results;
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+namespace PreviewPaneBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Extraction from files laid out like the ones of common slicers, thumbnails at the edges of the read windows,
+    // files of unknown size, ranking, malformed and randomly mutated files
+    std::vector<CheckResult> RunGcodeChecks(size_t fuzzIterations, unsigned int seed);
+
+    struct GcodeThroughputResult
+    {
+        std::wstring layout;
+        uint64_t fileBytes = {};
+        size_t thumbnails = {};
+        uint64_t bytesRead = {};
+        bool fullScan = {};
+        double seconds = {};
+        // Reading the whole file, as the provider did before
+        uint64_t fullScanBytesRead = {};
+        double fullScanSeconds = {};
+    };
+
+    // Finds the thumbnails of synthetic files of every given size, with the thumbnails at their start, at their end
+    // and in their middle, where only a full scan finds them
+    std::vector<GcodeThroughputResult> RunGcodeThroughputBenchmark(const std::vector<uint64_t>& fileSizes, unsigned int seed);
+}
@@ -0,0 +1,704 @@
+#include "pch.h"
+#include "PreviewHostBenchmark.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+
+#include <PreviewHostPool.h>
+
+namespace
+{
+    using namespace PreviewPaneBenchmark;
+    using namespace std::chrono_literals;
+
+    // A preview host running on a thread of this process, which takes a while to start and to show a preview, like
+    // the .exe does. Paths containing "fail" fail to show, the host hangs on paths containing "hang".
+    struct StubHostState
+    {
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<std::string> input;
+        std::deque<std::string> output;
+        // Every command the host received, in order
+        std::vector<std::string> commands;
+        bool inputClosed = false;
+        bool killed = false;
+        bool exited = false;
+    };
+
+    class StubHostChannel : public PreviewHostChannel
+    {
+        std::shared_ptr<StubHostState> state;
+        std::thread thread;
+
+        static void Run(StubHostState& state, const std::chrono::milliseconds startupTime, const std::chrono::milliseconds renderTime)
+        {
+            std::unique_lock lock{ state.mutex };
+            const auto work = [&](const std::chrono::milliseconds time) {
+                return !state.changed.wait_for(lock, time, [&] { return state.killed; });
+            };
+
+            if (work(startupTime))
+            {
+                state.output.push_back("ready");
+                state.changed.notify_all();
+            }
+
+            while (!state.killed)
+            {
+                state.changed.wait(lock, [&] { return state.killed || state.inputClosed || !state.input.empty(); });
+                if (state.killed || state.input.empty())
+                {
+                    break;
+                }
+
+                const std::string line = std::move(state.input.front());
+                state.input.pop_front();
+                state.commands.push_back(line);
+                const auto command = PreviewHostProtocol::ParseCommand(line);
+                if (command && command->name == "exit")
+                {
+                    break;
+                }
+
+                if (command && command->name == "preview" && command->request.filePath.find(L"hang") != std::wstring::npos)
+                {
+                    state.changed.wait(lock, [&] { return state.killed; });
+                    break;
+                }
+
+                if (command && command->name == "preview" && work(renderTime))
+                {
+                    const bool shown = command->request.filePath.find(L"fail") == std::wstring::npos;
+                    state.output.push_back((shown ? "shown\t" : "failed\t") + std::to_string(command->id));
+                    state.changed.notify_all();
+                }
+            }
+
+            state.exited = true;
+            state.changed.notify_all();
+        }
+
+    public:
+        StubHostChannel(std::shared_ptr<StubHostState> state, const std::chrono::milliseconds startupTime, const std::chrono::milliseconds renderTime) :
+            state{ std::move(state) }
+        {
+            thread = std::thread{ [s = this->state, startupTime, renderTime] { Run(*s, startupTime, renderTime); } };
+        }
+
+        ~StubHostChannel()
+        {
+            {
+                std::unique_lock lock{ state->mutex };
+                state->inputClosed = true;
+                state->changed.notify_all();
+            }
+
+            thread.join();
+        }
+
+        bool Send(const std::string& line) override
+        {
+            std::unique_lock lock{ state->mutex };
+            if (state->exited || state->killed)
+            {
+                return false;
+            }
+
+            state->input.push_back(line);
+            state->changed.notify_all();
+            return true;
+        }
+
+        std::optional<std::string> Receive(const std::chrono::milliseconds timeout) override
+        {
+            std::unique_lock lock{ state->mutex };
+            if (!state->changed.wait_for(lock, timeout, [&] { return !state->output.empty() || state->exited; }) || state->output.empty())
+            {
+                return std::nullopt;
+            }
+
+            std::string line = std::move(state->output.front());
+            state->output.pop_front();
+            return line;
+        }
+
+        bool Running() override
+        {
+            std::unique_lock lock{ state->mutex };
+            return !state->exited;
+        }
+
+        void Terminate() override
+        {
+            std::unique_lock lock{ state->mutex };
+            state->killed = true;
+            state->changed.notify_all();
+        }
+    };
+
+    // Keeps the state of every host it started, so checks can look at what hosts received, or kill them
+    class StubHostLauncher : public PreviewHostLauncher
+    {
+        std::chrono::milliseconds startupTime;
+        std::chrono::milliseconds renderTime;
+        std::mutex mutex;
+        std::vector<std::shared_ptr<StubHostState>> hosts;
+
+    public:
+        std::atomic<bool> failing = false;
+
+        StubHostLauncher(const std::chrono::milliseconds startupTime, const std::chrono::milliseconds renderTime) :
+            startupTime{ startupTime }, renderTime{ renderTime }
+        {
+        }
+
+        std::unique_ptr<PreviewHostChannel> Launch() override
+        {
+            if (failing)
+            {
+                return nullptr;
+            }
+
+            auto state = std::make_shared<StubHostState>();
+            {
+                std::unique_lock lock{ mutex };
+                hosts.push_back(state);
+            }
+
+            return std::make_unique<StubHostChannel>(std::move(state), startupTime, renderTime);
+        }
+
+        std::shared_ptr<StubHostState> Host(const size_t index)
+        {
+            std::unique_lock lock{ mutex };
+            return index < hosts.size() ? hosts[index] : nullptr;
+        }
+
+        size_t Launches()
+        {
+            std::unique_lock lock{ mutex };
+            return hosts.size();
+        }
+
+        // The commands a host received which start with the given name
+        std::vector<std::string> Commands(const size_t index, const std::string_view name)
+        {
+            std::vector<std::string> result;
+            if (const auto host = Host(index))
+            {
+                std::unique_lock lock{ host->mutex };
+                for (const auto& command : host->commands)
+                {
+                    if (command.starts_with(name))
+                    {
+                        result.push_back(command);
+                    }
+                }
+            }
+
+            return result;
+        }
+
+        void Kill(const size_t index)
+        {
+            if (const auto host = Host(index))
+            {
+                std::unique_lock lock{ host->mutex };
+                host->killed = true;
+                host->changed.notify_all();
+                host->changed.wait(lock, [&] { return host->exited; });
+            }
+        }
+    };
+
+    // The pool doesn't expose its launcher, so the checks keep a pointer to it
+    struct StubPool
+    {
+        StubHostLauncher* launcher;
+        std::unique_ptr<PreviewHostPool> pool;
+
+        StubPool(const PreviewHostPoolOptions& options = {}, const std::chrono::milliseconds startupTime = 1ms, const std::chrono::milliseconds renderTime = 1ms)
+        {
+            auto stub = std::make_unique<StubHostLauncher>(startupTime, renderTime);
+            launcher = stub.get();
+            pool = std::make_unique<PreviewHostPool>(std::move(stub), options);
+        }
+    };
+
+    PreviewHostRequest Request(const std::wstring& filePath)
+    {
+        return { .filePath = filePath, .parentWindow = 0x10a2c, .rect = { .left = 0, .right = 640, .top = 0, .bottom = 480 } };
+    }
+
+    // Selects a file and waits for its preview, returns false if it wasn't shown
+    bool ShowPreview(PreviewHostPool& pool, const std::wstring& filePath, uint64_t& id)
+    {
+        id = pool.Preview(Request(filePath));
+        return id != 0 && pool.WaitForPreview(id, 5s);
+    }
+
+    template<typename Predicate>
+    bool WaitFor(Predicate&& predicate, const std::chrono::milliseconds timeout = 5s)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!predicate())
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                return false;
+            }
+
+            std::this_thread::sleep_for(1ms);
+        }
+
+        return true;
+    }
+
+    CheckResult CheckProtocol(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"Host protocol" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        using namespace PreviewHostProtocol;
+        const std::vector<std::wstring> paths = {
+            L"C:\\Users\\user\\README.md",
+            L"\\\\server\\share\\dir with spaces\\file.cs",
+            L"C:\\Users\\\x540d\x524d\\\x30d5\x30a1\x30a4\x30eb \U0001F600.md",
+            L"D:\\\xe9\xe8\xea\\\x0444\x0430\x0439\x043b.qoi",
+        };
+
+        std::mt19937 random{ seed };
+        std::uniform_int_distribution<int32_t> coordinate{ std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max() };
+        for (const auto& path : paths)
+        {
+            const PreviewHostRequest request{ .filePath = path, .parentWindow = 0xffffffff'ffffffff, .rect = { coordinate(random), coordinate(random), -1, 0 } };
+            const auto line = PreviewCommand(42, request);
+            const auto command = line ? ParseCommand(*line) : std::nullopt;
+            check(command && command->name == "preview" && command->id == 42 && command->request == request);
+        }
+
+        const PreviewHostRect rect{ .left = -20, .right = 1920, .top = -5, .bottom = 1080 };
+        const auto resize = ParseCommand(ResizeCommand(7, rect));
+        check(resize && resize->name == "resize" && resize->id == 7 && resize->request.rect == rect);
+        const auto unload = ParseCommand(UnloadCommand(uint64_t{ 1 } << 63));
+        check(unload && unload->name == "unload" && unload->id == uint64_t{ 1 } << 63);
+        const auto exit = ParseCommand(ExitCommand());
+        check(exit && exit->name == "exit");
+
+        // Paths which would break the lines
+        check(!PreviewCommand(1, Request(L"")));
+        check(!PreviewCommand(1, Request(L"a\tb.md")));
+        check(!PreviewCommand(1, Request(L"a\nb.md")));
+        check(!PreviewCommand(1, Request(L"a\rb.md")));
+
+        for (const std::string_view line : { "", "preview", "preview\t1\tC:\\a.md\t10a2c\t0\t1\t2", "preview\t1\t\t10a2c\t0\t1\t2\t3",
+                                             "preview\tx\tC:\\a.md\t10a2c\t0\t1\t2\t3", "preview\t1\tC:\\a.md\tzz\t0\t1\t2\t3",
+                                             "preview\t1\tC:\\a.md\t10a2c\t0\t1\t2\t3\t4", "resize\t1\t0\t1\t2", "resize\t1\t0\t1\t2\t3.5",
+                                             "resize\t-1\t0\t1\t2\t3", "unload", "unload\t1\t2", "unload\t99999999999999999999", "exit\t1", "show\t1" })
+        {
+            check(!ParseCommand(line));
+        }
+
+        check(ParseReply("ready").kind == ReplyKind::Ready);
+        const auto shown = ParseReply("shown\t12");
+        check(shown.kind == ReplyKind::Shown && shown.id == 12);
+        const auto failed = ParseReply("failed\t13");
+        check(failed.kind == ReplyKind::Failed && failed.id == 13);
+        for (const std::string_view line : { "", "ready\t1", "shown", "shown\t", "shown\tx", "failed\t1\t2", "hello" })
+        {
+            check(ParseReply(line).kind == ReplyKind::Unknown);
+        }
+
+        // Invalid UTF-8, overlong encodings and encoded surrogates become U+FFFD
+        check(FromUtf8("a\xff" "b") == L"a\xfffd" L"b");
+        check(FromUtf8("\xc0\xaf") == L"\xfffd\xfffd");
+        check(FromUtf8("\xed\xa0\x80") == L"\xfffd\xfffd\xfffd");
+        check(FromUtf8("\xe2\x82") == L"\xfffd\xfffd");
+        return result;
+    }
+
+    CheckResult CheckReuse()
+    {
+        CheckResult result{ .name = L"Host reuse" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        StubPool stub;
+        std::vector<std::string> expected;
+        for (int i = 0; i < 10; ++i)
+        {
+            uint64_t id = 0;
+            const std::wstring path = L"C:\\file" + std::to_wstring(i) + L".md";
+            check(ShowPreview(*stub.pool, path, id));
+            expected.push_back(*PreviewHostProtocol::PreviewCommand(id, Request(path)));
+            stub.pool->Unload(id);
+        }
+
+        check(stub.launcher->Launches() == 1);
+        check(stub.pool->HostCount() == 1);
+        check(stub.launcher->Commands(0, "preview") == expected);
+        check(stub.launcher->Commands(0, "unload").size() == 10);
+
+        // A path the host can't show
+        uint64_t id = 0;
+        check(!ShowPreview(*stub.pool, L"C:\\fail.md", id) && id != 0);
+        stub.pool->Unload(id);
+        check(stub.launcher->Launches() == 1);
+        return result;
+    }
+
+    CheckResult CheckRecycling()
+    {
+        CheckResult result{ .name = L"Host recycling" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        StubPool stub{ { .maxPreviews = 3 } };
+        for (int i = 0; i < 10; ++i)
+        {
+            uint64_t id = 0;
+            check(ShowPreview(*stub.pool, L"C:\\file.md", id));
+            stub.pool->Unload(id);
+            check(stub.pool->HostCount() <= 1);
+        }
+
+        const auto statistics = stub.pool->Statistics();
+        check(statistics.recycled == 3);
+        check(statistics.launched == 4 && stub.launcher->Launches() == 4);
+        for (size_t host = 0; host < 4; ++host)
+        {
+            check(stub.launcher->Commands(host, "preview").size() == (host < 3 ? 3 : 1));
+        }
+
+        // Recycled hosts are told to exit
+        for (size_t host = 0; host < 3; ++host)
+        {
+            check(WaitFor([&] { return stub.launcher->Commands(host, "exit").size() == 1; }));
+        }
+
+        return result;
+    }
+
+    CheckResult CheckExpiry()
+    {
+        CheckResult result{ .name = L"Host idle expiry" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        StubPool stub{ { .idleTimeout = 50ms } };
+        uint64_t id = 0;
+        check(ShowPreview(*stub.pool, L"C:\\file.md", id));
+
+        // A host showing a preview never expires
+        std::this_thread::sleep_for(150ms);
+        check(stub.pool->HostCount() == 1);
+        stub.pool->Unload(id);
+
+        check(WaitFor([&] { return stub.pool->HostCount() == 0; }));
+        check(stub.pool->Statistics().expired == 1);
+        check(WaitFor([&] { return stub.launcher->Commands(0, "exit").size() == 1; }));
+
+        check(ShowPreview(*stub.pool, L"C:\\file.md", id));
+        check(stub.launcher->Launches() == 2);
+        stub.pool->Unload(id);
+        return result;
+    }
+
+    CheckResult CheckLostHosts()
+    {
+        CheckResult result{ .name = L"Host lost" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        StubPool stub;
+        uint64_t id = 0;
+        check(ShowPreview(*stub.pool, L"C:\\file.md", id));
+        stub.pool->Unload(id);
+
+        // The host crashed between two previews
+        stub.launcher->Kill(0);
+        check(ShowPreview(*stub.pool, L"C:\\file.md", id));
+        check(stub.pool->Statistics().lost == 1);
+        check(stub.launcher->Launches() == 2 && stub.pool->HostCount() == 1);
+
+        // The host crashed while showing a preview
+        stub.launcher->Kill(1);
+        check(!stub.pool->WaitForPreview(id, 1s));
+        stub.pool->Unload(id);
+        check(ShowPreview(*stub.pool, L"C:\\file.md", id));
+        stub.pool->Unload(id);
+        check(stub.launcher->Launches() == 3);
+
+        // Hosts which can't be started
+        stub.launcher->failing = true;
+        stub.launcher->Kill(2);
+        check(stub.pool->Preview(Request(L"C:\\file.md")) == 0);
+        check(stub.pool->Statistics().launchFailures >= 1);
+
+        stub.launcher->failing = false;
+        check(ShowPreview(*stub.pool, L"C:\\file.md", id));
+        stub.pool->Unload(id);
+        return result;
+    }
+
+    CheckResult CheckHungHosts()
+    {
+        CheckResult result{ .name = L"Host hung" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        StubPool stub{ { .replyTimeout = 50ms } };
+        const auto killed = [&](const size_t index) {
+            const auto host = stub.launcher->Host(index);
+            std::unique_lock lock{ host->mutex };
+            return host->killed;
+        };
+
+        // The preview is unloaded after the host should have answered it
+        uint64_t id = 0;
+        check(!ShowPreview(*stub.pool, L"C:\\hang.md", id) && id != 0);
+        stub.pool->Unload(id);
+        check(stub.pool->Statistics().hung == 1 && killed(0));
+        check(ShowPreview(*stub.pool, L"C:\\file.md", id));
+        stub.pool->Unload(id);
+        check(stub.launcher->Launches() == 2 && stub.pool->HostCount() == 1);
+
+        // The preview is unloaded in time, the host is replaced by the next preview once the timeout passed
+        id = stub.pool->Preview(Request(L"C:\\hang.md"));
+        stub.pool->Unload(id);
+        check(stub.pool->Statistics().hung == 1 && !killed(1));
+        std::this_thread::sleep_for(60ms);
+        check(ShowPreview(*stub.pool, L"C:\\file.md", id));
+        stub.pool->Unload(id);
+        check(stub.pool->Statistics().hung == 2 && killed(1));
+        check(stub.launcher->Commands(2, "preview").size() == 1);
+
+        // A host which answers in time is kept, even when its reply is read after the timeout
+        check(ShowPreview(*stub.pool, L"C:\\file.md", id));
+        std::this_thread::sleep_for(60ms);
+        stub.pool->Unload(id);
+        id = stub.pool->Preview(Request(L"C:\\file.md"));
+        std::this_thread::sleep_for(60ms);
+        stub.pool->Unload(id);
+        check(stub.pool->Statistics().hung == 2 && stub.launcher->Launches() == 3);
+
+        // Waiting for a preview doesn't block the pool
+        id = stub.pool->Preview(Request(L"C:\\hang.md"));
+        std::atomic<bool> waiting = true;
+        std::thread waiter{ [&] {
+            stub.pool->WaitForPreview(id, 1s);
+            waiting = false;
+        } };
+
+        std::this_thread::sleep_for(20ms);
+        const auto start = std::chrono::steady_clock::now();
+        stub.pool->Resize(id, { .right = 100 });
+        stub.pool->HostCount();
+        uint64_t other = 0;
+        check(ShowPreview(*stub.pool, L"C:\\other.md", other));
+        stub.pool->Unload(other);
+        check(waiting && std::chrono::steady_clock::now() - start < 500ms);
+        waiter.join();
+        stub.pool->Unload(id);
+        check(stub.pool->Statistics().hung == 3);
+        return result;
+    }
+
+    CheckResult CheckConcurrentPreviews(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"Host concurrency" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        {
+            // Two preview panes at once, e.g. in two Explorer windows
+            StubPool stub;
+            uint64_t first = 0;
+            uint64_t second = 0;
+            check(ShowPreview(*stub.pool, L"C:\\first.md", first));
+            check(ShowPreview(*stub.pool, L"C:\\second.md", second));
+            check(first != second && stub.pool->HostCount() == 2);
+
+            // Resizes go to the host of the preview
+            const PreviewHostRect rect{ .left = 0, .right = 800, .top = 0, .bottom = 600 };
+            stub.pool->Resize(second, rect);
+            stub.pool->Resize(first + second + 1, rect);
+            check(WaitFor([&] { return stub.launcher->Commands(1, "resize").size() == 1; }));
+            check(stub.launcher->Commands(1, "resize") == std::vector{ PreviewHostProtocol::ResizeCommand(second, rect) });
+            check(stub.launcher->Commands(0, "resize").empty());
+
+            // One idle host is kept
+            stub.pool->Unload(first);
+            stub.pool->Unload(second);
+            check(stub.pool->HostCount() == 1);
+
+            // Unloading twice does nothing
+            stub.pool->Unload(first);
+            check(WaitFor([&] { return stub.launcher->Commands(0, "unload").size() == 1; }));
+            std::this_thread::sleep_for(10ms);
+            check(stub.launcher->Commands(0, "unload").size() == 1);
+        }
+
+        {
+            StubPool stub{ { .maxPreviews = 7 } };
+            constexpr size_t threads = 4;
+            constexpr size_t previews = 25;
+            std::atomic<size_t> shown = 0;
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; ++t)
+            {
+                workers.emplace_back([&, t] {
+                    std::mt19937 random{ seed + static_cast<unsigned int>(t) };
+                    for (size_t i = 0; i < previews; ++i)
+                    {
+                        uint64_t id = 0;
+                        shown += ShowPreview(*stub.pool, L"C:\\file" + std::to_wstring(t) + L".md", id) ? 1 : 0;
+                        if (random() % 2)
+                        {
+                            stub.pool->Resize(id, { .right = static_cast<int32_t>(random() % 1000) });
+                        }
+
+                        stub.pool->Unload(id);
+                    }
+                });
+            }
+
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+
+            check(shown == threads * previews);
+            check(stub.pool->HostCount() <= threads);
+            const auto statistics = stub.pool->Statistics();
+            check(statistics.lost == 0 && statistics.launchFailures == 0);
+        }
+
+        return result;
+    }
+
+    struct Latencies
+    {
+        std::vector<double> milliseconds;
+        size_t launches = 0;
+    };
+
+    PreviewHostLatencyResult Summarize(std::wstring name, Latencies latencies)
+    {
+        PreviewHostLatencyResult result{ .name = std::move(name), .selections = latencies.milliseconds.size(), .launches = latencies.launches };
+        if (latencies.milliseconds.empty())
+        {
+            return result;
+        }
+
+        result.firstMilliseconds = latencies.milliseconds.front();
+        auto sorted = latencies.milliseconds;
+        std::sort(sorted.begin(), sorted.end());
+        result.medianMilliseconds = sorted[sorted.size() / 2];
+        result.p95Milliseconds = sorted[(sorted.size() * 95 + 99) / 100 - 1];
+        double sum = 0;
+        for (const double value : sorted)
+        {
+            sum += value;
+        }
+
+        result.meanMilliseconds = sum / sorted.size();
+        return result;
+    }
+
+    double MillisecondsSince(const std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // What the handlers did before: start the .exe with the file, and terminate it when the preview is unloaded
+    Latencies ProcessPerPreview(const size_t selections, const std::chrono::milliseconds startupTime, const std::chrono::milliseconds renderTime, const std::chrono::milliseconds selectionInterval)
+    {
+        StubHostLauncher launcher{ startupTime, renderTime };
+        Latencies latencies;
+        for (size_t i = 0; i < selections; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            auto host = launcher.Launch();
+            host->Send(*PreviewHostProtocol::PreviewCommand(i + 1, Request(L"C:\\file.md")));
+            while (const auto line = host->Receive(5s))
+            {
+                if (PreviewHostProtocol::ParseReply(*line).kind == PreviewHostProtocol::ReplyKind::Shown)
+                {
+                    break;
+                }
+            }
+
+            latencies.milliseconds.push_back(MillisecondsSince(start));
+            std::this_thread::sleep_for(selectionInterval);
+            host->Terminate();
+        }
+
+        latencies.launches = launcher.Launches();
+        return latencies;
+    }
+
+    Latencies Pooled(const PreviewHostPoolOptions& options, const size_t selections, const std::chrono::milliseconds startupTime, const std::chrono::milliseconds renderTime, const std::chrono::milliseconds selectionInterval)
+    {
+        StubPool stub{ options, startupTime, renderTime };
+        Latencies latencies;
+        for (size_t i = 0; i < selections; ++i)
+        {
+            // Explorer creates a handler for every selected file, which prewarms the pool
+            const auto start = std::chrono::steady_clock::now();
+            stub.pool->Prewarm();
+            uint64_t id = 0;
+            if (!ShowPreview(*stub.pool, L"C:\\file.md", id))
+            {
+                throw std::runtime_error("a pooled preview host failed to show a preview");
+            }
+
+            latencies.milliseconds.push_back(MillisecondsSince(start));
+            std::this_thread::sleep_for(selectionInterval);
+            stub.pool->Unload(id);
+        }
+
+        latencies.launches = stub.launcher->Launches();
+        return latencies;
+    }
+}
+
+namespace PreviewPaneBenchmark
+{
+    std::vector<CheckResult> RunPreviewHostChecks(unsigned int seed)
+    {
+        return { CheckProtocol(seed), CheckReuse(), CheckRecycling(), CheckExpiry(), CheckLostHosts(), CheckHungHosts(), CheckConcurrentPreviews(seed) };
+    }
+
+    std::vector<PreviewHostLatencyResult> RunPreviewHostLatencyBenchmark(size_t selections,
+                                                                         std::chrono::milliseconds startupTime,
+                                                                         std::chrono::milliseconds renderTime,
+                                                                         std::chrono::milliseconds selectionInterval)
+    {
+        const PreviewHostPoolOptions recycling{ .maxPreviews = 5 };
+        return {
+            Summarize(L"Process per preview", ProcessPerPreview(selections, startupTime, renderTime, selectionInterval)),
+            Summarize(L"Pool", Pooled({}, selections, startupTime, renderTime, selectionInterval)),
+            Summarize(L"Pool, recycled", Pooled(recycling, selections, startupTime, renderTime, selectionInterval)),
+        };
+    }
+}
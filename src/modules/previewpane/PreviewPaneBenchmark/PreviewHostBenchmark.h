@@ -0,0 +1,31 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+namespace PreviewPaneBenchmark
+{
+    using benchmark::CheckResult;
+
+    // The protocol of the pooled preview hosts, host reuse, recycling, idle expiry, lost and hung hosts and
+    // concurrent previews, against hosts simulated in this process
+    std::vector<CheckResult> RunPreviewHostChecks(unsigned int seed);
+
+    struct PreviewHostLatencyResult
+    {
+        std::wstring name;
+        size_t selections = {};
+        size_t launches = {};
+        // Time from selecting a file to the first paint of its preview
+        double firstMilliseconds = {};
+        double medianMilliseconds = {};
+        double p95Milliseconds = {};
+        double meanMilliseconds = {};
+    };
+
+    // Selects files one after the other, with hosts which take startupTime to start and renderTime to show a
+    // preview, starting a host per preview as the handlers did before, and with the pool
+    std::vector<PreviewHostLatencyResult> RunPreviewHostLatencyBenchmark(size_t selections,
+                                                                         std::chrono::milliseconds startupTime,
+                                                                         std::chrono::milliseconds renderTime,
+                                                                         std::chrono::milliseconds selectionInterval);
+}
@@ -0,0 +1,385 @@
+#include "pch.h"
+#include "QoiBenchmark.h"
+
+#include "QoiEncoder.h"
+#include <common/utils/benchmark.h>
+
+#include <QoiDecoder.h>
+
+namespace
+{
+    using namespace PreviewPaneBenchmark;
+
+    class MemoryByteSource : public QoiByteSource
+    {
+        const uint8_t* data;
+        size_t size;
+        size_t position = 0;
+
+    public:
+        MemoryByteSource(const uint8_t* data, const size_t size) :
+            data{ data }, size{ size }
+        {
+        }
+
+        size_t Read(uint8_t* buffer, size_t count) override
+        {
+            count = std::min(count, size - position);
+            std::copy_n(data + position, count, buffer);
+            position += count;
+            return count;
+        }
+    };
+
+    std::optional<QoiThumbnail> Decode(const std::vector<uint8_t>& bytes, const uint32_t maxSize, const size_t length = SIZE_MAX)
+    {
+        MemoryByteSource source{ bytes.data(), std::min(length, bytes.size()) };
+        return DecodeQoiThumbnail(source, maxSize);
+    }
+
+    enum class ImageKind
+    {
+        Photo, // smooth gradients with noise, mostly DIFF and LUMA operations
+        Screenshot, // flat regions, mostly runs and indexed colors
+        Sprite, // transparent background with antialiased shapes
+    };
+
+    const wchar_t* ImageKindName(const ImageKind kind)
+    {
+        switch (kind)
+        {
+        case ImageKind::Photo:
+            return L"photo";
+        case ImageKind::Screenshot:
+            return L"screenshot";
+        default:
+            return L"sprite";
+        }
+    }
+
+    std::vector<uint32_t> GenerateImage(const ImageKind kind, const uint32_t width, const uint32_t height, const unsigned int seed)
+    {
+        std::mt19937 random(seed);
+        std::vector<uint32_t> pixels(static_cast<size_t>(width) * height);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                uint32_t pixel = 0;
+                switch (kind)
+                {
+                case ImageKind::Photo:
+                {
+                    const uint32_t noise = random() % 6;
+                    const uint32_t r = (x * 255 / width + noise) & 0xFF;
+                    const uint32_t g = (y * 255 / height + noise) & 0xFF;
+                    const uint32_t b = ((x + y) * 127 / (width + height) + 64 + noise) & 0xFF;
+                    pixel = 0xFF000000 | r << 16 | g << 8 | b;
+                    break;
+                }
+                case ImageKind::Screenshot:
+                {
+                    static constexpr uint32_t palette[] = { 0xFFF3F3F3, 0xFFFFFFFF, 0xFF202020, 0xFF0067C0, 0xFFE5E5E5 };
+                    const uint32_t region = (x / 97 + y / 61 * 3) % 5;
+                    const bool text = (y % 61) > 20 && (y % 61) < 30 && (x * 7 + y) % 11 < 4;
+                    pixel = text ? palette[2] : palette[region];
+                    break;
+                }
+                default:
+                {
+                    const int64_t dx = static_cast<int64_t>(x % 128) - 64;
+                    const int64_t dy = static_cast<int64_t>(y % 128) - 64;
+                    const int64_t distance = dx * dx + dy * dy;
+                    const uint32_t alpha = distance < 40 * 40 ? 255 : distance < 48 * 48 ? static_cast<uint32_t>((48 * 48 - distance) * 255 / (48 * 48 - 40 * 40)) : 0;
+                    pixel = alpha << 24 | (alpha ? 0x00C04020 + (x / 128 % 4) * 0x10 : 0);
+                    break;
+                }
+                }
+
+                pixels[static_cast<size_t>(y) * width + x] = pixel;
+            }
+        }
+
+        return pixels;
+    }
+
+    // What DecodeQoiThumbnail should return for decoded pixels, computed pixel by pixel
+    std::vector<uint32_t> ScaleDown(const std::vector<uint32_t>& pixels, const uint32_t width, const uint32_t height, const uint32_t thumbnailWidth, const uint32_t thumbnailHeight)
+    {
+        std::vector<uint64_t> sums(static_cast<size_t>(thumbnailWidth) * thumbnailHeight * 4);
+        std::vector<uint64_t> counts(static_cast<size_t>(thumbnailWidth) * thumbnailHeight);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                const size_t target = static_cast<size_t>(static_cast<uint64_t>(y) * thumbnailHeight / height) * thumbnailWidth +
+                                      static_cast<size_t>(static_cast<uint64_t>(x) * thumbnailWidth / width);
+                const uint32_t pixel = pixels[static_cast<size_t>(y) * width + x];
+                const uint64_t a = pixel >> 24;
+                sums[target * 4] += a;
+                sums[target * 4 + 1] += (pixel >> 16 & 0xFF) * a;
+                sums[target * 4 + 2] += (pixel >> 8 & 0xFF) * a;
+                sums[target * 4 + 3] += (pixel & 0xFF) * a;
+                counts[target]++;
+            }
+        }
+
+        std::vector<uint32_t> result(counts.size());
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+            const uint64_t* sum = &sums[i * 4];
+            if (sum[0] != 0)
+            {
+                result[i] = static_cast<uint32_t>((sum[0] + counts[i] / 2) / counts[i]) << 24 |
+                            static_cast<uint32_t>((sum[1] + sum[0] / 2) / sum[0]) << 16 |
+                            static_cast<uint32_t>((sum[2] + sum[0] / 2) / sum[0]) << 8 |
+                            static_cast<uint32_t>((sum[3] + sum[0] / 2) / sum[0]);
+            }
+        }
+
+        return result;
+    }
+
+    std::vector<uint8_t> Header(const uint32_t width, const uint32_t height, const uint8_t channels)
+    {
+        return { 'q', 'o', 'i', 'f',
+                 static_cast<uint8_t>(width >> 24), static_cast<uint8_t>(width >> 16), static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width),
+                 static_cast<uint8_t>(height >> 24), static_cast<uint8_t>(height >> 16), static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height),
+                 channels, 0 };
+    }
+
+    // Hand-encoded images which use every operation, with the pixels the specification says they decode to
+    CheckResult CheckReferenceImages()
+    {
+        struct ReferenceImage
+        {
+            uint32_t width;
+            uint32_t height;
+            uint8_t channels;
+            std::vector<uint8_t> operations;
+            std::vector<uint32_t> pixels;
+        };
+
+        const std::vector<ReferenceImage> images = {
+            // RGB, DIFF by (-1, +1, 0), LUMA by green +10 with red +10 - 4 and blue +10 + 7, RUN of 2, INDEX of the first pixel
+            { 6, 1, 3,
+              { 0xFE, 100, 150, 200, 0x40 | 1 << 4 | 3 << 2 | 2, 0x80 | 42, (4 << 4) | 15, 0xC0 | 1, static_cast<uint8_t>((100 * 3 + 150 * 5 + 200 * 7 + 255 * 11) % 64) },
+              { 0xFF6496C8, 0xFF6397C8, 0xFF69A1D9, 0xFF69A1D9, 0xFF69A1D9, 0xFF6496C8 } },
+            // RGBA, then a DIFF which wraps around, in a 2x2 image
+            { 2, 2, 4,
+              { 0xFF, 1, 2, 3, 128, 0x40 | 0 << 4 | 2 << 2 | 3, 0xC0 | 1 },
+              { 0x80010203, 0x80FF0204, 0x80FF0204, 0x80FF0204 } },
+            // Alpha of a 3 channel image is ignored
+            { 1, 1, 3, { 0xFF, 9, 8, 7, 0 }, { 0xFF090807 } },
+        };
+
+        CheckResult result{ .name = L"reference images" };
+        for (const auto& image : images)
+        {
+            auto bytes = Header(image.width, image.height, image.channels);
+            bytes.insert(bytes.end(), image.operations.begin(), image.operations.end());
+            bytes.insert(bytes.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+
+            const auto decoded = Decode(bytes, 256);
+            result.cases++;
+            if (!decoded || decoded->width != image.width || decoded->height != image.height || decoded->pixels != image.pixels)
+            {
+                result.failures++;
+            }
+        }
+
+        return result;
+    }
+
+    CheckResult CheckRoundTrips(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"round trips" };
+        const std::pair<uint32_t, uint32_t> sizes[] = { { 1, 1 }, { 7, 3 }, { 64, 64 }, { 300, 17 }, { 17, 300 }, { 513, 257 } };
+        for (const auto kind : { ImageKind::Photo, ImageKind::Screenshot, ImageKind::Sprite })
+        {
+            for (const auto [width, height] : sizes)
+            {
+                const auto pixels = GenerateImage(kind, width, height, seed);
+                const uint8_t channels = kind == ImageKind::Sprite ? 4 : 3;
+                const auto bytes = EncodeQoi(pixels, width, height, channels);
+
+                for (const uint32_t maxSize : { 1u, 16u, 96u, 256u, 1024u })
+                {
+                    const auto [thumbnailWidth, thumbnailHeight] = QoiThumbnailSize(width, height, maxSize);
+                    const auto expected = ScaleDown(pixels, width, height, thumbnailWidth, thumbnailHeight);
+                    const auto decoded = Decode(bytes, maxSize);
+
+                    result.cases++;
+                    if (!decoded || decoded->width != thumbnailWidth || decoded->height != thumbnailHeight || decoded->pixels != expected)
+                    {
+                        result.failures++;
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+    CheckResult CheckTruncatedImages(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"truncated images" };
+        const auto pixels = GenerateImage(ImageKind::Sprite, 40, 30, seed);
+        const auto bytes = EncodeQoi(pixels, 40, 30, 4);
+
+        // Without the end marker, the last byte belongs to the operation of the last pixel
+        const size_t lastOperationEnd = bytes.size() - 8;
+        for (size_t length = 0; length < bytes.size(); ++length)
+        {
+            const bool complete = length >= lastOperationEnd;
+            const auto decoded = Decode(bytes, 256, length);
+            result.cases++;
+            if (decoded.has_value() != complete || (decoded && decoded->pixels != pixels))
+            {
+                result.failures++;
+            }
+        }
+
+        return result;
+    }
+
+    CheckResult CheckCorruptHeaders()
+    {
+        CheckResult result{ .name = L"corrupt headers" };
+        const std::vector<std::vector<uint8_t>> headers = {
+            {},
+            { 'q', 'o', 'i' },
+            { 'Q', 'O', 'I', 'F', 0, 0, 0, 1, 0, 0, 0, 1, 4, 0 },
+            Header(0, 10, 4),
+            Header(10, 0, 4),
+            Header(10, 10, 2),
+            Header(10, 10, 5),
+            { 'q', 'o', 'i', 'f', 0, 0, 0, 1, 0, 0, 0, 1, 4, 2 },
+            Header(100'000, 100'000, 4),
+            Header(0xFFFFFFFF, 0xFFFFFFFF, 3),
+        };
+
+        for (auto bytes : headers)
+        {
+            bytes.insert(bytes.end(), { 0xFE, 1, 2, 3, 0, 0, 0, 0, 0, 0, 0, 1 });
+            result.cases++;
+            if (Decode(bytes, 256))
+            {
+                result.failures++;
+            }
+        }
+
+        result.cases++;
+        if (Decode(EncodeQoi({ 0xFF000000 }, 1, 1, 3), 0))
+        {
+            result.failures++;
+        }
+
+        return result;
+    }
+
+    CheckResult CheckMutatedImages(const size_t iterations, const unsigned int seed)
+    {
+        CheckResult result{ .name = L"mutated images" };
+        std::mt19937 random(seed);
+        std::vector<std::vector<uint8_t>> originals;
+        for (const auto kind : { ImageKind::Photo, ImageKind::Screenshot, ImageKind::Sprite })
+        {
+            originals.push_back(EncodeQoi(GenerateImage(kind, 97, 61, seed), 97, 61, 4));
+        }
+
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            auto bytes = originals[i % originals.size()];
+            const size_t mutations = 1 + random() % 8;
+            for (size_t m = 0; m < mutations; ++m)
+            {
+                const size_t position = random() % bytes.size();
+                switch (random() % 4)
+                {
+                case 0:
+                    bytes[position] = static_cast<uint8_t>(random());
+                    break;
+                case 1:
+                    bytes[position] ^= static_cast<uint8_t>(1 << (random() % 8));
+                    break;
+                case 2:
+                    bytes.erase(bytes.begin() + position, bytes.begin() + std::min(bytes.size(), position + 1 + random() % 16));
+                    break;
+                default:
+                    bytes.insert(bytes.begin() + position, 1 + random() % 16, static_cast<uint8_t>(random()));
+                    break;
+                }
+
+                if (bytes.empty())
+                {
+                    bytes.push_back(0);
+                }
+            }
+
+            // Whatever the header claims now, a decoded thumbnail must have the size it implies
+            const uint32_t maxSize = 1 + random() % 128;
+            const auto decoded = Decode(bytes, maxSize);
+            result.cases++;
+            if (decoded)
+            {
+                MemoryByteSource headerSource{ bytes.data(), bytes.size() };
+                QoiByteReader reader{ headerSource };
+                const auto header = ReadQoiHeader(reader);
+                const auto [width, height] = header ? QoiThumbnailSize(header->width, header->height, maxSize) : std::pair<uint32_t, uint32_t>{};
+                if (!header || decoded->width != width || decoded->height != height || decoded->pixels.size() != static_cast<size_t>(width) * height)
+                {
+                    result.failures++;
+                }
+            }
+        }
+
+        return result;
+    }
+}
+
+namespace PreviewPaneBenchmark
+{
+    std::vector<CheckResult> RunQoiChecks(size_t fuzzIterations, unsigned int seed)
+    {
+        return { CheckReferenceImages(),
+                 CheckRoundTrips(seed),
+                 CheckTruncatedImages(seed),
+                 CheckCorruptHeaders(),
+                 CheckMutatedImages(fuzzIterations, seed) };
+    }
+
+    std::vector<QoiThroughputResult> RunQoiThroughputBenchmark(uint32_t width,
+                                                               uint32_t height,
+                                                               const std::vector<uint32_t>& thumbnailSizes,
+                                                               size_t iterations,
+                                                               unsigned int seed)
+    {
+        std::vector<QoiThroughputResult> results;
+        for (const auto kind : { ImageKind::Photo, ImageKind::Screenshot, ImageKind::Sprite })
+        {
+            const auto bytes = EncodeQoi(GenerateImage(kind, width, height, seed), width, height, kind == ImageKind::Sprite ? 4 : 3);
+            for (const uint32_t thumbnailSize : thumbnailSizes)
+            {
+                QoiThroughputResult result{ .image = ImageKindName(kind),
+                                            .width = width,
+                                            .height = height,
+                                            .thumbnailSize = thumbnailSize,
+                                            .encodedBytes = bytes.size(),
+                                            .iterations = iterations };
+                result.seconds = benchmark::MeasureSeconds([&] {
+                    for (size_t i = 0; i < iterations; ++i)
+                    {
+                        if (!Decode(bytes, thumbnailSize))
+                        {
+                            throw std::runtime_error("failed to decode a synthetic image");
+                        }
+                    }
+                });
+                results.push_back(std::move(result));
+            }
+        }
+
+        return results;
+    }
+}
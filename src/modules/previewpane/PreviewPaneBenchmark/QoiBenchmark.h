@@ -0,0 +1,30 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+namespace PreviewPaneBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Reference images, round trips at full and thumbnail sizes, truncated and corrupt inputs, and `fuzzIterations`
+    // randomly mutated images which must be either rejected or decoded to a thumbnail of the right size
+    std::vector<CheckResult> RunQoiChecks(size_t fuzzIterations, unsigned int seed);
+
+    struct QoiThroughputResult
+    {
+        std::wstring image;
+        uint32_t width = {};
+        uint32_t height = {};
+        uint32_t thumbnailSize = {};
+        size_t encodedBytes = {};
+        size_t iterations = {};
+        double seconds = {};
+    };
+
+    // Decodes synthetic images of the given size into thumbnails of every given size
+    std::vector<QoiThroughputResult> RunQoiThroughputBenchmark(uint32_t width,
+                                                               uint32_t height,
+                                                               const std::vector<uint32_t>& thumbnailSizes,
+                                                               size_t iterations,
+                                                               unsigned int seed);
+}
@@ -0,0 +1,103 @@
+#include "pch.h"
+#include "QoiEncoder.h"
+
+#include <QoiDecoder.h>
+
+namespace
+{
+    void WriteBigEndian32(std::vector<uint8_t>& bytes, const uint32_t value)
+    {
+        bytes.push_back(static_cast<uint8_t>(value >> 24));
+        bytes.push_back(static_cast<uint8_t>(value >> 16));
+        bytes.push_back(static_cast<uint8_t>(value >> 8));
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+}
+
+namespace PreviewPaneBenchmark
+{
+    std::vector<uint8_t> EncodeQoi(const std::vector<uint32_t>& pixels, uint32_t width, uint32_t height, uint8_t channels)
+    {
+        using namespace QoiFormat;
+
+        std::vector<uint8_t> bytes = { 'q', 'o', 'i', 'f' };
+        WriteBigEndian32(bytes, width);
+        WriteBigEndian32(bytes, height);
+        bytes.push_back(channels);
+        bytes.push_back(0);
+
+        std::array<Pixel, 64> index = {};
+        Pixel previous{ .a = 255 };
+        uint8_t run = 0;
+        const size_t count = static_cast<size_t>(width) * height;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const uint32_t value = pixels[i];
+            const Pixel pixel{ .r = static_cast<uint8_t>(value >> 16),
+                               .g = static_cast<uint8_t>(value >> 8),
+                               .b = static_cast<uint8_t>(value),
+                               .a = channels == 4 ? static_cast<uint8_t>(value >> 24) : previous.a };
+
+            const bool same = pixel.r == previous.r && pixel.g == previous.g && pixel.b == previous.b && pixel.a == previous.a;
+            if (same)
+            {
+                run++;
+                if (run == 62 || i + 1 == count)
+                {
+                    bytes.push_back(static_cast<uint8_t>(OpRun | (run - 1)));
+                    run = 0;
+                }
+
+                continue;
+            }
+
+            if (run > 0)
+            {
+                bytes.push_back(static_cast<uint8_t>(OpRun | (run - 1)));
+                run = 0;
+            }
+
+            const size_t hash = pixel.Hash();
+            const Pixel& indexed = index[hash];
+            if (indexed.r == pixel.r && indexed.g == pixel.g && indexed.b == pixel.b && indexed.a == pixel.a)
+            {
+                bytes.push_back(static_cast<uint8_t>(OpIndex | hash));
+            }
+            else
+            {
+                index[hash] = pixel;
+                if (pixel.a == previous.a)
+                {
+                    const int8_t dr = static_cast<int8_t>(pixel.r - previous.r);
+                    const int8_t dg = static_cast<int8_t>(pixel.g - previous.g);
+                    const int8_t db = static_cast<int8_t>(pixel.b - previous.b);
+                    const int8_t drg = static_cast<int8_t>(dr - dg);
+                    const int8_t dbg = static_cast<int8_t>(db - dg);
+
+                    if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2)
+                    {
+                        bytes.push_back(static_cast<uint8_t>(OpDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                    }
+                    else if (drg > -9 && drg < 8 && dg > -33 && dg < 32 && dbg > -9 && dbg < 8)
+                    {
+                        bytes.push_back(static_cast<uint8_t>(OpLuma | (dg + 32)));
+                        bytes.push_back(static_cast<uint8_t>((drg + 8) << 4 | (dbg + 8)));
+                    }
+                    else
+                    {
+                        bytes.insert(bytes.end(), { OpRGB, pixel.r, pixel.g, pixel.b });
+                    }
+                }
+                else
+                {
+                    bytes.insert(bytes.end(), { OpRGBA, pixel.r, pixel.g, pixel.b, pixel.a });
+                }
+            }
+
+            previous = pixel;
+        }
+
+        bytes.insert(bytes.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+        return bytes;
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace PreviewPaneBenchmark
+{
+    // Encodes 0xAARRGGBB pixels the way the reference encoder does, including its choice of operations,
+    // to produce test images for the decoder
+    std::vector<uint8_t> EncodeQoi(const std::vector<uint32_t>& pixels, uint32_t width, uint32_t height, uint8_t channels);
+}
@@ -0,0 +1,477 @@
+#include "pch.h"
+#include "StlBenchmark.h"
+
+#include <common/utils/benchmark.h>
+
+#include <StlRenderer.h>
+
+namespace
+{
+    using namespace PreviewPaneBenchmark;
+
+    class MemoryByteSource : public StlByteSource
+    {
+        const uint8_t* data;
+        size_t size;
+        size_t position = 0;
+
+    public:
+        MemoryByteSource(const uint8_t* data, const size_t size) :
+            data{ data }, size{ size }
+        {
+        }
+
+        size_t Read(uint8_t* buffer, size_t count) override
+        {
+            count = std::min(count, size - position);
+            std::copy_n(data + position, count, buffer);
+            position += count;
+            return count;
+        }
+    };
+
+    std::optional<StlMesh> Parse(const std::vector<uint8_t>& bytes, const size_t length = SIZE_MAX)
+    {
+        MemoryByteSource source{ bytes.data(), std::min(length, bytes.size()) };
+        return ParseStl(source);
+    }
+
+    StlBounds BoundsOf(const std::vector<StlTriangle>& triangles)
+    {
+        StlBounds bounds;
+        for (const auto& triangle : triangles)
+        {
+            for (const auto& v : triangle.vertices)
+            {
+                bounds.Add(v);
+            }
+        }
+
+        return bounds;
+    }
+
+    // A bumpy torus of about `triangles` triangles, so lighting varies over the whole model
+    std::vector<StlTriangle> GenerateTorus(const size_t triangles, const unsigned int seed)
+    {
+        const size_t minor = std::max<size_t>(3, static_cast<size_t>(std::sqrt(triangles / 8.0)));
+        const size_t major = std::max<size_t>(3, triangles / (2 * minor));
+        std::mt19937 random(seed);
+        const float phase = static_cast<float>(random() % 1000) / 100.f;
+
+        const auto point = [&](const size_t i, const size_t j) {
+            const float u = 2.f * 3.14159265f * (i % major) / major;
+            const float v = 2.f * 3.14159265f * (j % minor) / minor;
+            const float bump = 1.f + 0.08f * std::sin(7.f * u + phase) * std::sin(5.f * v);
+            const float r = 40.f + 15.f * bump * std::cos(v);
+            return StlVector{ r * std::cos(u), r * std::sin(u), 15.f * bump * std::sin(v) };
+        };
+
+        std::vector<StlTriangle> result;
+        result.reserve(2 * major * minor);
+        for (size_t i = 0; i < major; ++i)
+        {
+            for (size_t j = 0; j < minor; ++j)
+            {
+                result.push_back({ { point(i, j), point(i + 1, j), point(i + 1, j + 1) } });
+                result.push_back({ { point(i, j), point(i + 1, j + 1), point(i, j + 1) } });
+            }
+        }
+
+        return result;
+    }
+
+    std::vector<StlTriangle> GenerateCube(const float size)
+    {
+        const auto corner = [size](const int i) {
+            return StlVector{ (i & 1) ? size : 0.f, (i & 2) ? size : 0.f, (i & 4) ? size : 0.f };
+        };
+
+        // Two triangles per face, given by the corners of the face in order around it
+        const int faces[6][4] = { { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 } };
+        std::vector<StlTriangle> result;
+        for (const auto& face : faces)
+        {
+            result.push_back({ { corner(face[0]), corner(face[1]), corner(face[2]) } });
+            result.push_back({ { corner(face[0]), corner(face[2]), corner(face[3]) } });
+        }
+
+        return result;
+    }
+
+    std::vector<uint8_t> WriteBinary(const std::vector<StlTriangle>& triangles, const std::string_view header = "binary STL")
+    {
+        std::vector<uint8_t> bytes(StlFormat::HeaderSize + sizeof(uint32_t) + triangles.size() * StlFormat::TriangleSize);
+        std::copy_n(header.data(), std::min(header.size(), StlFormat::HeaderSize), bytes.begin());
+        const uint32_t count = static_cast<uint32_t>(triangles.size());
+        std::memcpy(&bytes[StlFormat::HeaderSize], &count, sizeof(count));
+
+        uint8_t* triangle = &bytes[StlFormat::HeaderSize + sizeof(uint32_t)];
+        for (const auto& t : triangles)
+        {
+            // Zero normal, as many exporters write
+            std::memcpy(triangle + sizeof(StlVector), t.vertices.data(), sizeof(t.vertices));
+            triangle += StlFormat::TriangleSize;
+        }
+
+        return bytes;
+    }
+
+    std::vector<uint8_t> WriteAscii(const std::vector<StlTriangle>& triangles)
+    {
+        std::string text = "solid torus\n";
+        char line[128];
+        for (const auto& t : triangles)
+        {
+            text += "  facet normal 0 0 0\n    outer loop\n";
+            for (const auto& v : t.vertices)
+            {
+                // 9 significant digits round trip any float
+                snprintf(line, sizeof(line), "      vertex %.9g %.9g %.9g\n", v.x, v.y, v.z);
+                text += line;
+            }
+
+            text += "    endloop\n  endfacet\n";
+        }
+
+        text += "endsolid torus\n";
+        return { text.begin(), text.end() };
+    }
+
+    std::vector<uint8_t> ToBytes(const std::string_view text)
+    {
+        return { text.begin(), text.end() };
+    }
+
+    CheckResult CheckParsing(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"STL parsing" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        const auto triangles = GenerateTorus(2000, seed);
+        const auto bounds = BoundsOf(triangles);
+        for (const auto& bytes : { WriteBinary(triangles), WriteAscii(triangles) })
+        {
+            const auto mesh = Parse(bytes);
+            check(mesh && mesh->triangles == triangles && mesh->bounds == bounds);
+        }
+
+        // Binary files whose header looks like the start of an ASCII file
+        for (const auto header : { "solid", "solid part", "solid part facet normal" })
+        {
+            const auto mesh = Parse(WriteBinary(triangles, header));
+            check(mesh && mesh->triangles == triangles);
+        }
+
+        // Signs, exponents and several solids in one file
+        const auto ascii = Parse(ToBytes("solid a\nfacet normal 0 0 1\nouter loop\nvertex +1 -2 3e1\nvertex 1.5E+0 2 3\n"
+                                         "vertex 0 0 0\nendloop\nendfacet\nendsolid a\nsolid b\nfacet normal 0 0 0\nouter loop\n"
+                                         "vertex 4 5 6\nvertex 7 8 9\nvertex -1e-3 0 0\nendloop\nendfacet\nendsolid b\n"));
+        check(ascii && ascii->triangles.size() == 2 && ascii->triangles[0].vertices[0] == StlVector{ 1.f, -2.f, 30.f } &&
+              ascii->triangles[1].vertices[2] == StlVector{ -1e-3f, 0.f, 0.f } &&
+              ascii->bounds.min == StlVector{ -1e-3f, -2.f, 0.f } && ascii->bounds.max == StlVector{ 7.f, 8.f, 30.f });
+
+        // Empty models are valid, empty files aren't
+        const auto empty = Parse(WriteBinary({}));
+        check(empty && empty->triangles.empty() && empty->bounds.Empty());
+        const auto emptyAscii = Parse(ToBytes("solid empty\nendsolid empty\n"));
+        check(emptyAscii && emptyAscii->triangles.empty());
+        check(!Parse({}));
+
+        // Triangles with non-finite coordinates are skipped, in both formats
+        auto withNan = triangles;
+        withNan[5].vertices[1].y = std::numeric_limits<float>::quiet_NaN();
+        withNan[9].vertices[2].z = std::numeric_limits<float>::infinity();
+        auto finite = triangles;
+        finite.erase(finite.begin() + 9);
+        finite.erase(finite.begin() + 5);
+        for (const auto& bytes : { WriteBinary(withNan), WriteAscii(withNan) })
+        {
+            const auto mesh = Parse(bytes);
+            check(mesh && mesh->triangles == finite && mesh->bounds == BoundsOf(finite));
+        }
+
+        // Malformed ASCII
+        for (const auto text : { "solid x\nfacet\nouter loop\nvertex 1 2 abc\nvertex 0 0 0\nvertex 0 0 0\nendloop\nendsolid x\n",
+                                 "solid x\nfacet\nouter loop\nvertex 1 2 3\nvertex 0 0 0\nendloop\nendsolid x\n",
+                                 "solid x\nfacet\nouter loop\nvertex 1 2 3\nvertex 0 0 0\nvertex 0 1 0\nvertex 1 1 0\nendloop\nendsolid x\n",
+                                 "solid x\nfacet\nouter loop\nvertex 1 2 3\nvertex 0 0 0\nvertex 0 1 0\n" })
+        {
+            check(!Parse(ToBytes(text)));
+        }
+
+        return result;
+    }
+
+    CheckResult CheckTruncatedFiles(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"STL truncated files" };
+        const auto triangles = GenerateTorus(200, seed);
+
+        const auto binary = WriteBinary(triangles);
+        for (size_t length = 0; length < binary.size(); length += 7)
+        {
+            result.cases++;
+            result.failures += Parse(binary, length) ? 1 : 0;
+        }
+
+        // An ASCII file cut after a facet is a valid smaller model, one cut inside a loop isn't
+        const auto ascii = WriteAscii(triangles);
+        for (size_t length = 0; length < ascii.size(); length += 5)
+        {
+            const auto mesh = Parse(ascii, length);
+            result.cases++;
+            if (mesh && (mesh->triangles.size() > triangles.size() || !std::equal(mesh->triangles.begin(), mesh->triangles.end(), triangles.begin())))
+            {
+                result.failures++;
+            }
+        }
+
+        return result;
+    }
+
+    CheckResult CheckMutatedFiles(const size_t iterations, const unsigned int seed)
+    {
+        CheckResult result{ .name = L"STL mutated files" };
+        std::mt19937 random(seed);
+        const auto triangles = GenerateTorus(100, seed);
+        const std::vector<std::vector<uint8_t>> originals = { WriteBinary(triangles), WriteAscii(triangles) };
+
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            auto bytes = originals[i % originals.size()];
+            const size_t mutations = 1 + random() % 8;
+            for (size_t m = 0; m < mutations; ++m)
+            {
+                const size_t position = random() % bytes.size();
+                switch (random() % 4)
+                {
+                case 0:
+                    bytes[position] = static_cast<uint8_t>(random());
+                    break;
+                case 1:
+                    bytes[position] ^= static_cast<uint8_t>(1 << (random() % 8));
+                    break;
+                case 2:
+                    bytes.erase(bytes.begin() + position, bytes.begin() + std::min(bytes.size(), position + 1 + random() % 16));
+                    break;
+                default:
+                    bytes.insert(bytes.begin() + position, 1 + random() % 16, static_cast<uint8_t>(random()));
+                    break;
+                }
+
+                if (bytes.empty())
+                {
+                    bytes.push_back(0);
+                }
+            }
+
+            // Whatever was parsed must be finite, within the bounds and renderable
+            const auto mesh = Parse(bytes);
+            result.cases++;
+            if (mesh)
+            {
+                const bool valid = std::all_of(mesh->triangles.begin(), mesh->triangles.end(), [](const StlTriangle& t) {
+                                       return std::all_of(t.vertices.begin(), t.vertices.end(), StlFormat::IsFinite);
+                                   }) &&
+                                   BoundsOf(mesh->triangles) == mesh->bounds;
+                const auto thumbnail = RenderStlThumbnail(*mesh, { .size = 32, .threads = 1 });
+                result.failures += valid && thumbnail.pixels.size() == 32 * 32 ? 0 : 1;
+            }
+        }
+
+        return result;
+    }
+
+    size_t CoveredPixels(const StlThumbnail& thumbnail)
+    {
+        return std::count_if(thumbnail.pixels.begin(), thumbnail.pixels.end(), [](const uint32_t pixel) { return pixel != 0; });
+    }
+
+    CheckResult CheckRendering(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"STL rendering" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        // A cube is seen corner first: opaque in the middle, transparent in the corners, in the shades of its color
+        StlMesh cube{ .triangles = GenerateCube(10.f) };
+        cube.bounds = BoundsOf(cube.triangles);
+        const auto cubeThumbnail = RenderStlThumbnail(cube, { .size = 64, .color = 0xFF8000 });
+        const auto pixel = [&](const uint32_t x, const uint32_t y) { return cubeThumbnail.pixels[y * 64 + x]; };
+        check(pixel(32, 32) >> 24 == 0xFF && pixel(0, 0) == 0 && pixel(63, 0) == 0 && pixel(0, 63) == 0 && pixel(63, 63) == 0);
+        check(std::all_of(cubeThumbnail.pixels.begin(), cubeThumbnail.pixels.end(), [](const uint32_t p) {
+            return p == 0 || ((p & 0xFF) == 0 && (p >> 16 & 0xFF) >= (p >> 8 & 0xFF));
+        }));
+
+        // Three faces are visible, and they are lit differently
+        std::vector<uint32_t> colors = cubeThumbnail.pixels;
+        std::sort(colors.begin(), colors.end());
+        colors.erase(std::unique(colors.begin(), colors.end()), colors.end());
+        check(colors.size() == 4);
+
+        // The image doesn't depend on the number of threads
+        StlMesh torus{ .triangles = GenerateTorus(200'000, seed) };
+        torus.bounds = BoundsOf(torus.triangles);
+        const auto reference = RenderStlThumbnail(torus, { .size = 256, .threads = 1 });
+        for (const unsigned int threads : { 2u, 3u, 7u, 16u })
+        {
+            check(RenderStlThumbnail(torus, { .size = 256, .threads = threads }).pixels == reference.pixels);
+        }
+
+        // A model of a single point or a flat one still renders without dividing by zero
+        StlMesh flat{ .triangles = { { { StlVector{ 0, 0, 0 }, StlVector{ 1, 0, 0 }, StlVector{ 0, 1, 0 } } } } };
+        flat.bounds = BoundsOf(flat.triangles);
+        check(CoveredPixels(RenderStlThumbnail(flat, { .size = 64 })) > 0);
+        StlMesh point{ .triangles = { { { StlVector{ 1, 1, 1 }, StlVector{ 1, 1, 1 }, StlVector{ 1, 1, 1 } } } } };
+        point.bounds = BoundsOf(point.triangles);
+        check(RenderStlThumbnail(point, { .size = 64 }).pixels.size() == 64 * 64);
+
+        return result;
+    }
+
+    CheckResult CheckDecimation(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"STL decimation" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        // Models coarser than the grid are left alone
+        StlMesh cube{ .triangles = GenerateCube(10.f) };
+        cube.bounds = BoundsOf(cube.triangles);
+        StlMesh decimatedCube = cube;
+        DecimateStlMesh(decimatedCube, 256);
+        check(decimatedCube.triangles.size() == cube.triangles.size());
+
+        for (const uint32_t size : { 64u, 256u })
+        {
+            StlMesh torus{ .triangles = GenerateTorus(1'000'000, seed) };
+            torus.bounds = BoundsOf(torus.triangles);
+            check(ShouldDecimateStlMesh(torus, size));
+
+            const auto full = RenderStlThumbnail(torus, { .size = size });
+            StlMesh decimated = torus;
+            DecimateStlMesh(decimated, size);
+
+            // A fraction of the triangles, which cover the same pixels but for a pixel of the outline here and there
+            const auto thumbnail = RenderStlThumbnail(decimated, { .size = size });
+            const auto covered = [&](const int64_t x, const int64_t y) {
+                return x >= 0 && y >= 0 && x < size && y < size && full.pixels[y * size + x] != 0;
+            };
+
+            size_t differentInside = 0;
+            for (int64_t y = 0; y < size; ++y)
+            {
+                for (int64_t x = 0; x < size; ++x)
+                {
+                    const bool pixel = covered(x, y);
+                    if (pixel == (thumbnail.pixels[y * size + x] != 0))
+                    {
+                        continue;
+                    }
+
+                    bool outline = false;
+                    for (int64_t dy = -1; dy <= 1; ++dy)
+                    {
+                        for (int64_t dx = -1; dx <= 1; ++dx)
+                        {
+                            outline = outline || covered(x + dx, y + dy) != pixel;
+                        }
+                    }
+
+                    differentInside += outline ? 0 : 1;
+                }
+            }
+
+            // Every cell the surface passes through keeps a few triangles, the cells are a pixel across
+            double area = 0;
+            for (const auto& t : torus.triangles)
+            {
+                const StlVector a{ t.vertices[1].x - t.vertices[0].x, t.vertices[1].y - t.vertices[0].y, t.vertices[1].z - t.vertices[0].z };
+                const StlVector b{ t.vertices[2].x - t.vertices[0].x, t.vertices[2].y - t.vertices[0].y, t.vertices[2].z - t.vertices[0].z };
+                const StlVector cross{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+                area += std::sqrt(cross.x * cross.x + cross.y * cross.y + cross.z * cross.z) / 2;
+            }
+
+            const StlVector extent{ torus.bounds.max.x - torus.bounds.min.x, torus.bounds.max.y - torus.bounds.min.y, torus.bounds.max.z - torus.bounds.min.z };
+            const double cellSize = std::sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z) / size;
+            const double surfaceCells = area / (cellSize * cellSize);
+            check(decimated.triangles.size() < torus.triangles.size() / 4 && decimated.triangles.size() < 4 * surfaceCells &&
+                  decimated.bounds == torus.bounds);
+            check(differentInside == 0);
+        }
+
+        return result;
+    }
+}
+
+namespace PreviewPaneBenchmark
+{
+    std::vector<CheckResult> RunStlChecks(size_t fuzzIterations, unsigned int seed)
+    {
+        return { CheckParsing(seed),
+                 CheckTruncatedFiles(seed),
+                 CheckMutatedFiles(fuzzIterations, seed),
+                 CheckRendering(seed),
+                 CheckDecimation(seed) };
+    }
+
+    std::vector<StlThroughputResult> RunStlThroughputBenchmark(const std::vector<size_t>& triangleCounts, uint32_t thumbnailSize, unsigned int seed)
+    {
+        // ASCII files of more triangles take gigabytes
+        constexpr size_t MaxAsciiTriangles = 1'000'000;
+
+        std::vector<StlThroughputResult> results;
+        for (const size_t triangleCount : triangleCounts)
+        {
+            StlThroughputResult result;
+            std::optional<StlMesh> mesh;
+            {
+                const auto triangles = GenerateTorus(triangleCount, seed);
+                const auto binary = WriteBinary(triangles);
+                result.binaryBytes = binary.size();
+                result.binarySeconds = benchmark::MeasureSeconds([&] { mesh = Parse(binary); });
+
+                if (triangles.size() <= MaxAsciiTriangles)
+                {
+                    const auto ascii = WriteAscii(triangles);
+                    result.asciiBytes = ascii.size();
+                    result.asciiSeconds = benchmark::MeasureSeconds([&] {
+                        if (!Parse(ascii))
+                        {
+                            throw std::runtime_error("failed to parse a synthetic ASCII model");
+                        }
+                    });
+                }
+            }
+
+            if (!mesh)
+            {
+                throw std::runtime_error("failed to parse a synthetic binary model");
+            }
+
+            result.triangles = mesh->triangles.size();
+            result.renderSeconds = benchmark::MeasureSeconds([&] { RenderStlThumbnail(*mesh, { .size = thumbnailSize, .threads = 1 }); });
+            result.renderThreadedSeconds = benchmark::MeasureSeconds([&] { RenderStlThumbnail(*mesh, { .size = thumbnailSize }); });
+
+            // What the thumbnail provider does: decimate only when it pays off
+            result.decimateSeconds = benchmark::MeasureSeconds([&] {
+                if (ShouldDecimateStlMesh(*mesh, thumbnailSize))
+                {
+                    DecimateStlMesh(*mesh, thumbnailSize);
+                }
+            });
+            result.decimatedTriangles = mesh->triangles.size();
+            result.renderDecimatedSeconds = benchmark::MeasureSeconds([&] { RenderStlThumbnail(*mesh, { .size = thumbnailSize }); });
+            results.push_back(result);
+        }
+
+        return results;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+namespace PreviewPaneBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Binary and ASCII parsing, format detection, truncated, malformed and randomly mutated files, rendering with
+    // any number of threads and the coverage of decimated models
+    std::vector<CheckResult> RunStlChecks(size_t fuzzIterations, unsigned int seed);
+
+    struct StlThroughputResult
+    {
+        size_t triangles = {};
+        size_t binaryBytes = {};
+        double binarySeconds = {};
+        // Zero when the ASCII file would be too large to be worth it
+        size_t asciiBytes = {};
+        double asciiSeconds = {};
+        size_t decimatedTriangles = {};
+        double decimateSeconds = {};
+        double renderSeconds = {};
+        double renderThreadedSeconds = {};
+        double renderDecimatedSeconds = {};
+    };
+
+    // Parses, decimates and renders synthetic models of every given size into thumbnails of thumbnailSize
+    std::vector<StlThroughputResult> RunStlThroughputBenchmark(const std::vector<size_t>& triangleCounts, uint32_t thumbnailSize, unsigned int seed);
+}
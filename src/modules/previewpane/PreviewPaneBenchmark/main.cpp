@@ -0,0 +1,284 @@
+#include "pch.h"
+
+#include <iostream>
+#include <string_view>
+
+#include "GcodeBenchmark.h"
+#include "PreviewHostBenchmark.h"
+#include "QoiBenchmark.h"
+#include "StlBenchmark.h"
+
+using namespace PreviewPaneBenchmark;
+
+namespace
+{
+    struct Options
+    {
+        // A 4K image by default
+        uint32_t width = 3840;
+        uint32_t height = 2160;
+        size_t iterations = 10;
+        size_t fuzzIterations = 20000;
+        // STL models from 1K to this many triangles
+        size_t maxTriangles = 5'000'000;
+        uint32_t thumbnailSize = 256;
+        // G-code files from 1 MB to this many bytes
+        uint64_t maxGcodeSize = 256 * 1024 * 1024;
+        // Files selected one after the other, by hosts which start and render that fast
+        size_t selections = 20;
+        uint32_t hostStartupMs = 300;
+        uint32_t hostRenderMs = 20;
+        uint32_t selectionIntervalMs = 500;
+        unsigned int seed = 42;
+    };
+
+    void PrintUsage()
+    {
+        std::wcout << L"Usage: PreviewPaneBenchmark.exe [options]\n"
+                   << L"  --size <w>x<h>          synthetic image size (default 3840x2160)\n"
+                   << L"  --iterations <n>        decodes per image and thumbnail size (default 10)\n"
+                   << L"  --fuzz <n>              randomly mutated images and models to decode (default 20000)\n"
+                   << L"  --max-triangles <n>     largest STL model, from 1K triangles up by 10x (default 5000000)\n"
+                   << L"  --thumbnail-size <n>    STL thumbnail size (default 256)\n"
+                   << L"  --max-gcode-size <n>    largest G-code file in MB, from 1 MB up by 4x (default 256)\n"
+                   << L"  --selections <n>        files selected in the preview pane (default 20)\n"
+                   << L"  --host-startup-ms <n>   time a preview host takes to start (default 300)\n"
+                   << L"  --host-render-ms <n>    time a preview host takes to show a preview (default 20)\n"
+                   << L"  --selection-interval-ms <n>  time between two selections (default 500)\n"
+                   << L"  --seed <n>              random seed (default 42)\n";
+    }
+
+    bool ParseOptions(int argc, wchar_t* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::wstring arg = argv[i];
+            if (i + 1 >= argc)
+            {
+                return false;
+            }
+
+            const std::wstring value = argv[++i];
+            try
+            {
+                if (arg == L"--size")
+                {
+                    const auto separator = value.find(L'x');
+                    if (separator == std::wstring::npos)
+                    {
+                        return false;
+                    }
+
+                    options.width = static_cast<uint32_t>(std::stoul(value.substr(0, separator)));
+                    options.height = static_cast<uint32_t>(std::stoul(value.substr(separator + 1)));
+                }
+                else if (arg == L"--iterations")
+                {
+                    options.iterations = std::stoull(value);
+                }
+                else if (arg == L"--fuzz")
+                {
+                    options.fuzzIterations = std::stoull(value);
+                }
+                else if (arg == L"--max-triangles")
+                {
+                    options.maxTriangles = std::stoull(value);
+                }
+                else if (arg == L"--thumbnail-size")
+                {
+                    options.thumbnailSize = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--max-gcode-size")
+                {
+                    options.maxGcodeSize = std::stoull(value) * 1024 * 1024;
+                }
+                else if (arg == L"--selections")
+                {
+                    options.selections = std::stoull(value);
+                }
+                else if (arg == L"--host-startup-ms")
+                {
+                    options.hostStartupMs = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--host-render-ms")
+                {
+                    options.hostRenderMs = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--selection-interval-ms")
+                {
+                    options.selectionIntervalMs = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--seed")
+                {
+                    options.seed = static_cast<unsigned int>(std::stoul(value));
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+        }
+
+        return options.width > 0 && options.height > 0 && options.iterations > 0 && options.maxTriangles >= 1000 &&
+               options.thumbnailSize > 0 && options.maxGcodeSize > 0 && options.selections > 0;
+    }
+
+    int Run(int argc, wchar_t* argv[])
+    {
+        Options options;
+        if (!ParseOptions(argc, argv, options))
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        size_t failures = 0;
+        wprintf(L"QOI decoder checks\n\n");
+        for (const auto& result : RunQoiChecks(options.fuzzIterations, options.seed))
+        {
+            wprintf(L"%-20ls %8zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        // The sizes Explorer asks for with small, large and extra large icons, and the full size
+        wprintf(L"\nQOI thumbnails, %ux%u images, %zu iterations\n\n", options.width, options.height, options.iterations);
+        for (const auto& result : RunQoiThroughputBenchmark(options.width, options.height, { 96, 256, 1024, std::max(options.width, options.height) }, options.iterations, options.seed))
+        {
+            const double megabytes = static_cast<double>(result.encodedBytes) * result.iterations / (1024 * 1024);
+            const double megapixels = static_cast<double>(result.width) * result.height * result.iterations / 1e6;
+            wprintf(L"%-10ls %5u px %10zu bytes %10.3f ms/image %9.1f MB/s %9.1f Mpx/s\n",
+                    result.image.c_str(),
+                    result.thumbnailSize,
+                    result.encodedBytes,
+                    result.seconds * 1e3 / result.iterations,
+                    result.seconds > 0 ? megabytes / result.seconds : 0.0,
+                    result.seconds > 0 ? megapixels / result.seconds : 0.0);
+        }
+
+        wprintf(L"\nSTL thumbnail checks\n\n");
+        for (const auto& result : RunStlChecks(options.fuzzIterations, options.seed))
+        {
+            wprintf(L"%-20ls %8zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        std::vector<size_t> triangleCounts;
+        for (size_t count = 1000; count < options.maxTriangles; count *= 10)
+        {
+            triangleCounts.push_back(count);
+        }
+
+        triangleCounts.push_back(options.maxTriangles);
+
+        wprintf(L"\nSTL thumbnails, %u px, %u threads\n\n", options.thumbnailSize, std::thread::hardware_concurrency());
+        for (const auto& result : RunStlThroughputBenchmark(triangleCounts, options.thumbnailSize, options.seed))
+        {
+            wprintf(L"%9zu triangles %9.2f ms binary %8.1f MB/s", result.triangles, result.binarySeconds * 1e3, result.binarySeconds > 0 ? static_cast<double>(result.binaryBytes) / (1024 * 1024) / result.binarySeconds : 0.0);
+            if (result.asciiBytes != 0)
+            {
+                wprintf(L" %9.2f ms ASCII %7.1f MB/s", result.asciiSeconds * 1e3, result.asciiSeconds > 0 ? static_cast<double>(result.asciiBytes) / (1024 * 1024) / result.asciiSeconds : 0.0);
+            }
+
+            wprintf(L"\n          render %9.2f ms 1 thread %9.2f ms threaded, decimated to %zu triangles in %.2f ms, rendered in %.2f ms\n",
+                    result.renderSeconds * 1e3,
+                    result.renderThreadedSeconds * 1e3,
+                    result.decimatedTriangles,
+                    result.decimateSeconds * 1e3,
+                    result.renderDecimatedSeconds * 1e3);
+        }
+
+        wprintf(L"\nG-code thumbnail checks\n\n");
+        for (const auto& result : RunGcodeChecks(options.fuzzIterations, options.seed))
+        {
+            wprintf(L"%-20ls %8zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        std::vector<uint64_t> fileSizes;
+        for (uint64_t size = 1024 * 1024; size < options.maxGcodeSize; size *= 4)
+        {
+            fileSizes.push_back(size);
+        }
+
+        fileSizes.push_back(options.maxGcodeSize);
+
+        wprintf(L"\nG-code thumbnails, windows against a full scan\n\n");
+        for (const auto& result : RunGcodeThroughputBenchmark(fileSizes, options.seed))
+        {
+            wprintf(L"%-20ls %8.1f MB %2zu thumbnails %10" PRIu64 L" bytes read %9" PRIu64 L" per thumbnail %8.3f ms%-10ls full scan %10" PRIu64 L" bytes read %8.3f ms\n",
+                    result.layout.c_str(),
+                    static_cast<double>(result.fileBytes) / (1024 * 1024),
+                    result.thumbnails,
+                    result.bytesRead,
+                    result.thumbnails != 0 ? result.bytesRead / result.thumbnails : 0,
+                    result.seconds * 1e3,
+                    result.fullScan ? L" (full)" : L"",
+                    result.fullScanBytesRead,
+                    result.fullScanSeconds * 1e3);
+        }
+
+        wprintf(L"\nPreview host checks\n\n");
+        for (const auto& result : RunPreviewHostChecks(options.seed))
+        {
+            wprintf(L"%-20ls %8zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        wprintf(L"\nPreview hosts, time to first paint of %zu selections, hosts start in %u ms and render in %u ms, %u ms between selections\n\n",
+                options.selections,
+                options.hostStartupMs,
+                options.hostRenderMs,
+                options.selectionIntervalMs);
+        for (const auto& result : RunPreviewHostLatencyBenchmark(options.selections,
+                                                                 std::chrono::milliseconds{ options.hostStartupMs },
+                                                                 std::chrono::milliseconds{ options.hostRenderMs },
+                                                                 std::chrono::milliseconds{ options.selectionIntervalMs }))
+        {
+            wprintf(L"%-20ls %3zu launches %8.1f ms first %8.1f ms median %8.1f ms p95 %8.1f ms mean\n",
+                    result.name.c_str(),
+                    result.launches,
+                    result.firstMilliseconds,
+                    result.medianMilliseconds,
+                    result.p95Milliseconds,
+                    result.meanMilliseconds);
+        }
+
+        if (failures != 0)
+        {
+            std::wcerr << L"\n" << failures << L" checks failed\n";
+            return 1;
+        }
+
+        return 0;
+    }
+}
+
+#ifdef _WIN32
+int wmain(int argc, wchar_t* argv[])
+{
+    return Run(argc, argv);
+}
+#else
+// The options are ASCII
+int main(int argc, char* argv[])
+{
+    std::vector<std::wstring> arguments;
+    for (int i = 0; i < argc; i++)
+    {
+        const std::string_view argument = argv[i];
+        arguments.emplace_back(argument.begin(), argument.end());
+    }
+
+    std::vector<wchar_t*> pointers;
+    for (auto& argument : arguments)
+    {
+        pointers.push_back(argument.data());
+    }
+
+    return Run(argc, pointers.data());
+}
+#endif
@@ -0,0 +1,13 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by PreviewPaneBenchmark.rc
+
+//////////////////////////////
+// Non-localizable
+
+#define FILE_DESCRIPTION "PowerToys Preview Pane Benchmark"
+#define INTERNAL_NAME "PreviewPaneBenchmark"
+#define ORIGINAL_FILENAME "PreviewPaneBenchmark.exe"
+
+// Non-localizable
+//////////////////////////////
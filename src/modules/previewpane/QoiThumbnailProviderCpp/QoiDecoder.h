@@ -0,0 +1,323 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Decoder for the "Quite OK Image" format (https://qoiformat.org/qoi-specification.pdf) which scales the image down
+// while decoding, so only a thumbnail sized buffer is ever allocated.
+
+// Supplies the encoded bytes, e.g. from an IStream. Returns how many bytes were read, 0 at the end of the input.
+class QoiByteSource
+{
+public:
+    virtual ~QoiByteSource() = default;
+
+    virtual size_t Read(uint8_t* buffer, size_t size) = 0;
+};
+
+struct QoiHeader
+{
+    uint32_t width = {};
+    uint32_t height = {};
+    uint8_t channels = {};
+    uint8_t colorspace = {};
+};
+
+struct QoiThumbnail
+{
+    uint32_t width = {};
+    uint32_t height = {};
+    // Top-down rows of 0xAARRGGBB pixels, not premultiplied, i.e. a 32bpp BGRA DIB
+    std::vector<uint32_t> pixels;
+};
+
+namespace QoiFormat
+{
+    constexpr size_t HeaderSize = 14;
+    // Same limit as the reference implementation, to keep corrupt headers from requesting absurd work
+    constexpr uint64_t MaxPixels = 400'000'000;
+
+    constexpr uint8_t OpIndex = 0x00;
+    constexpr uint8_t OpDiff = 0x40;
+    constexpr uint8_t OpLuma = 0x80;
+    constexpr uint8_t OpRun = 0xC0;
+    constexpr uint8_t OpRGB = 0xFE;
+    constexpr uint8_t OpRGBA = 0xFF;
+    constexpr uint8_t OpMask = 0xC0;
+
+    struct Pixel
+    {
+        uint8_t r = 0;
+        uint8_t g = 0;
+        uint8_t b = 0;
+        uint8_t a = 0;
+
+        inline size_t Hash() const
+        {
+            return (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+        }
+    };
+
+    inline uint32_t ReadBigEndian32(const uint8_t* bytes)
+    {
+        return static_cast<uint32_t>(bytes[0]) << 24 | static_cast<uint32_t>(bytes[1]) << 16 | static_cast<uint32_t>(bytes[2]) << 8 | bytes[3];
+    }
+}
+
+// Buffers the byte source, so reading a byte usually is a comparison and an increment
+class QoiByteReader
+{
+    QoiByteSource& source;
+    std::array<uint8_t, 64 * 1024> buffer;
+    size_t position = 0;
+    size_t available = 0;
+
+    bool Refill()
+    {
+        position = 0;
+        available = source.Read(buffer.data(), buffer.size());
+        return available != 0;
+    }
+
+public:
+    explicit QoiByteReader(QoiByteSource& source) :
+        source{ source }
+    {
+    }
+
+    inline bool Next(uint8_t& byte)
+    {
+        if (position == available && !Refill())
+        {
+            return false;
+        }
+
+        byte = buffer[position++];
+        return true;
+    }
+
+    bool Read(uint8_t* bytes, const size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!Next(bytes[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+// Returns the size of the thumbnail of an image: the image scaled down to fit into maxSize x maxSize, keeping its
+// aspect ratio. Images which already fit keep their size, like the shell does for its own image thumbnails.
+inline std::pair<uint32_t, uint32_t> QoiThumbnailSize(const uint32_t width, const uint32_t height, const uint32_t maxSize)
+{
+    if (width <= maxSize && height <= maxSize)
+    {
+        return { width, height };
+    }
+
+    if (width >= height)
+    {
+        return { maxSize, std::max<uint32_t>(static_cast<uint32_t>(static_cast<uint64_t>(height) * maxSize / width), 1) };
+    }
+
+    return { std::max<uint32_t>(static_cast<uint32_t>(static_cast<uint64_t>(width) * maxSize / height), 1), maxSize };
+}
+
+inline std::optional<QoiHeader> ReadQoiHeader(QoiByteReader& reader)
+{
+    std::array<uint8_t, QoiFormat::HeaderSize> bytes;
+    if (!reader.Read(bytes.data(), bytes.size()) || bytes[0] != 'q' || bytes[1] != 'o' || bytes[2] != 'i' || bytes[3] != 'f')
+    {
+        return std::nullopt;
+    }
+
+    const QoiHeader header{ .width = QoiFormat::ReadBigEndian32(&bytes[4]),
+                            .height = QoiFormat::ReadBigEndian32(&bytes[8]),
+                            .channels = bytes[12],
+                            .colorspace = bytes[13] };
+    if (header.width == 0 || header.height == 0 || (header.channels != 3 && header.channels != 4) || header.colorspace > 1 ||
+        static_cast<uint64_t>(header.width) * header.height > QoiFormat::MaxPixels)
+    {
+        return std::nullopt;
+    }
+
+    return header;
+}
+
+// Decodes the image and scales it down to fit into maxSize x maxSize. Every thumbnail pixel is the average of the image
+// pixels it covers, weighted by their alpha so transparent pixels don't darken the edges of opaque ones.
+// Returns nullopt if the input isn't a QOI image or if it ends before the last pixel.
+inline std::optional<QoiThumbnail> DecodeQoiThumbnail(QoiByteSource& source, const uint32_t maxSize)
+{
+    if (maxSize == 0)
+    {
+        return std::nullopt;
+    }
+
+    QoiByteReader reader{ source };
+    const auto header = ReadQoiHeader(reader);
+    if (!header)
+    {
+        return std::nullopt;
+    }
+
+    const uint32_t width = header->width;
+    const uint32_t height = header->height;
+    const auto [thumbnailWidth, thumbnailHeight] = QoiThumbnailSize(width, height, maxSize);
+    const bool scaled = thumbnailWidth != width || thumbnailHeight != height;
+    const bool opaque = header->channels == 3;
+
+    QoiThumbnail thumbnail{ .width = thumbnailWidth,
+                            .height = thumbnailHeight,
+                            .pixels = std::vector<uint32_t>(static_cast<size_t>(thumbnailWidth) * thumbnailHeight, 0) };
+
+    // Sums of the image pixels covered by the current thumbnail row: alpha, then the colors multiplied by alpha
+    std::vector<uint64_t> sums(scaled ? static_cast<size_t>(thumbnailWidth) * 4 : 0);
+    std::vector<uint32_t> columnCounts(scaled ? thumbnailWidth : 0);
+    for (uint32_t x = 0; x < width && scaled; ++x)
+    {
+        columnCounts[static_cast<uint64_t>(x) * thumbnailWidth / width]++;
+    }
+
+    uint32_t thumbnailRow = 0;
+    uint32_t rowsInThumbnailRow = 0;
+    const auto flushRow = [&] {
+        uint32_t* row = thumbnail.pixels.data() + static_cast<size_t>(thumbnailRow) * thumbnailWidth;
+        for (uint32_t x = 0; x < thumbnailWidth; ++x)
+        {
+            const uint64_t* sum = &sums[static_cast<size_t>(x) * 4];
+            const uint64_t count = static_cast<uint64_t>(columnCounts[x]) * rowsInThumbnailRow;
+            uint32_t pixel = 0;
+            if (sum[0] != 0)
+            {
+                const uint32_t a = static_cast<uint32_t>((sum[0] + count / 2) / count);
+                const uint32_t r = static_cast<uint32_t>((sum[1] + sum[0] / 2) / sum[0]);
+                const uint32_t g = static_cast<uint32_t>((sum[2] + sum[0] / 2) / sum[0]);
+                const uint32_t b = static_cast<uint32_t>((sum[3] + sum[0] / 2) / sum[0]);
+                pixel = a << 24 | r << 16 | g << 8 | b;
+            }
+
+            row[x] = pixel;
+        }
+
+        std::fill(sums.begin(), sums.end(), uint64_t{ 0 });
+        rowsInThumbnailRow = 0;
+    };
+
+    std::array<QoiFormat::Pixel, 64> index = {};
+    QoiFormat::Pixel pixel{ .a = 255 };
+    uint32_t run = 0;
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint32_t targetRow = scaled ? static_cast<uint32_t>(static_cast<uint64_t>(y) * thumbnailHeight / height) : y;
+        if (scaled && targetRow != thumbnailRow)
+        {
+            flushRow();
+            thumbnailRow = targetRow;
+        }
+
+        uint32_t* fullSizeRow = scaled ? nullptr : thumbnail.pixels.data() + static_cast<size_t>(y) * width;
+        uint32_t column = 0;
+        uint32_t nextColumnStart = scaled && thumbnailWidth > 1 ? (width + thumbnailWidth - 1) / thumbnailWidth : width;
+
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            if (run > 0)
+            {
+                run--;
+            }
+            else
+            {
+                uint8_t op;
+                if (!reader.Next(op))
+                {
+                    return std::nullopt;
+                }
+
+                if (op == QoiFormat::OpRGB)
+                {
+                    if (!reader.Next(pixel.r) || !reader.Next(pixel.g) || !reader.Next(pixel.b))
+                    {
+                        return std::nullopt;
+                    }
+                }
+                else if (op == QoiFormat::OpRGBA)
+                {
+                    if (!reader.Next(pixel.r) || !reader.Next(pixel.g) || !reader.Next(pixel.b) || !reader.Next(pixel.a))
+                    {
+                        return std::nullopt;
+                    }
+                }
+                else
+                {
+                    switch (op & QoiFormat::OpMask)
+                    {
+                    case QoiFormat::OpIndex:
+                        pixel = index[op];
+                        break;
+                    case QoiFormat::OpDiff:
+                        pixel.r += static_cast<uint8_t>(((op >> 4) & 0x03) - 2);
+                        pixel.g += static_cast<uint8_t>(((op >> 2) & 0x03) - 2);
+                        pixel.b += static_cast<uint8_t>((op & 0x03) - 2);
+                        break;
+                    case QoiFormat::OpLuma:
+                    {
+                        uint8_t redBlue;
+                        if (!reader.Next(redBlue))
+                        {
+                            return std::nullopt;
+                        }
+
+                        const int greenDiff = (op & 0x3F) - 32;
+                        pixel.r += static_cast<uint8_t>(greenDiff - 8 + ((redBlue >> 4) & 0x0F));
+                        pixel.g += static_cast<uint8_t>(greenDiff);
+                        pixel.b += static_cast<uint8_t>(greenDiff - 8 + (redBlue & 0x0F));
+                        break;
+                    }
+                    default:
+                        run = op & 0x3F;
+                        break;
+                    }
+                }
+
+                index[pixel.Hash()] = pixel;
+            }
+
+            const uint32_t a = opaque ? 255 : pixel.a;
+            if (!scaled)
+            {
+                fullSizeRow[x] = a << 24 | static_cast<uint32_t>(pixel.r) << 16 | static_cast<uint32_t>(pixel.g) << 8 | pixel.b;
+                continue;
+            }
+
+            if (x == nextColumnStart)
+            {
+                column++;
+                nextColumnStart = static_cast<uint32_t>((static_cast<uint64_t>(column + 1) * width + thumbnailWidth - 1) / thumbnailWidth);
+            }
+
+            uint64_t* sum = &sums[static_cast<size_t>(column) * 4];
+            sum[0] += a;
+            sum[1] += pixel.r * a;
+            sum[2] += pixel.g * a;
+            sum[3] += pixel.b * a;
+        }
+
+        rowsInThumbnailRow++;
+    }
+
+    if (scaled)
+    {
+        flushRow();
+    }
+
+    return thumbnail;
+}
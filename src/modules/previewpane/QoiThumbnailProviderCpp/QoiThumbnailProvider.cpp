@@ -2,24 +2,41 @@
 #include "QoiThumbnailProvider.h"
 
 #include <filesystem>
-#include <fstream>
-#include <shellapi.h>
 #include <Shlwapi.h>
 #include <string>
 
-#include <wil/com.h>
-
-#include <common/utils/process_path.h>
 #include <common/interop/shared_constants.h>
 #include <common/logger/logger.h>
 #include <common/SettingsAPI/settings_helpers.h>
-#include <common/utils/process_path.h>
+#include <common/utils/gpo.h>
+#include <common/utils/thumbnail_bitmap.h>
 
 extern HINSTANCE g_hInst;
 extern long g_cDllRef;
 
+namespace
+{
+    class StreamByteSource : public QoiByteSource
+    {
+        IStream* stream;
+
+    public:
+        explicit StreamByteSource(IStream* stream) :
+            stream{ stream }
+        {
+        }
+
+        size_t Read(uint8_t* buffer, size_t size) override
+        {
+            ULONG read = 0;
+            const HRESULT hr = stream->Read(buffer, static_cast<ULONG>(size), &read);
+            return FAILED(hr) ? 0 : read;
+        }
+    };
+}
+
 QoiThumbnailProvider::QoiThumbnailProvider() :
-    m_cRef(1), m_pStream(NULL), m_process(NULL)
+    m_cRef(1), m_pStream(NULL)
 {
     std::filesystem::path logFilePath(PTSettingsHelper::get_local_low_folder_location());
     logFilePath.append(LogSettings::qoiThumbLogPath);
@@ -92,104 +109,40 @@ IFACEMETHODIMP QoiThumbnailProvider::Initialize(IStream* pStream, DWORD grfMode)
 
 IFACEMETHODIMP QoiThumbnailProvider::GetThumbnail(UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha)
 {
-    // Read stream into the buffer
-    char buffer[4096];
-    ULONG cbRead;
-
     Logger::trace(L"Begin");
 
-    GUID guid;
-    if (CoCreateGuid(&guid) == S_OK)
+    if (!m_pStream || !phbmp || !pdwAlpha || cx == 0 || cx > MaxThumbnailSize)
     {
-        wil::unique_cotaskmem_string guidString;
-        if (SUCCEEDED(StringFromCLSID(guid, &guidString)))
-        {
-            Logger::info(L"Read stream and save to tmp file.");
-
-            // {CLSID} -> CLSID
-            std::wstring guid = std::wstring(guidString.get()).substr(1, std::wstring(guidString.get()).size() - 2);
-            std::wstring filePath = PTSettingsHelper::get_local_low_folder_location() + L"\\QoiThumbnail-Temp\\";
-            if (!std::filesystem::exists(filePath))
-            {
-                std::filesystem::create_directories(filePath);
-            }
-
-            std::wstring fileName = filePath + guid + L".qoi";
-            
-            // Write data to tmp file
-            std::fstream file;
-            file.open(fileName, std::ios_base::out | std::ios_base::binary);
-
-            if (!file.is_open())
-            {
-                return 0;
-            }
-
-            while (true)
-            {
-                auto result = m_pStream->Read(buffer, 4096, &cbRead);
-
-                file.write(buffer, cbRead);
-                if (result == S_FALSE)
-                {               
-                    break;
-                }
-            }
-            file.close();
-
-            m_pStream->Release();
-            m_pStream = NULL;
+        return E_INVALIDARG;
+    }
 
-            try
-            {
-                Logger::info(L"Start QoiThumbnailProvider.exe");
-
-                STARTUPINFO info = { sizeof(info) };
-                std::wstring cmdLine{ L"\"" + fileName + L"\"" };
-                cmdLine += L" ";
-                cmdLine += std::to_wstring(cx);
-
-                std::wstring appPath = get_module_folderpath(g_hInst) + L"\\PowerToys.QoiThumbnailProvider.exe";
-
-                SHELLEXECUTEINFO sei{ sizeof(sei) };
-                sei.fMask = { SEE_MASK_NOCLOSEPROCESS | SEE_MASK_FLAG_NO_UI };
-                sei.lpFile = appPath.c_str();
-                sei.lpParameters = cmdLine.c_str();
-                sei.nShow = SW_SHOWDEFAULT;
-                ShellExecuteEx(&sei);
-                m_process = sei.hProcess;
-                WaitForSingleObject(m_process, INFINITE);
-                std::filesystem::remove(fileName);
-
-
-                std::wstring fileNameBmp = filePath + guid + L".bmp";
-                if (std::filesystem::exists(fileNameBmp))
-                {
-                    *phbmp = static_cast<HBITMAP>(LoadImage(NULL, fileNameBmp.c_str(), IMAGE_BITMAP, 0, 0, LR_LOADFROMFILE));
-                    *pdwAlpha = WTS_ALPHATYPE::WTSAT_ARGB;
-                    std::filesystem::remove(fileNameBmp);
-                }
-                else
-                {
-                    Logger::info(L"Bmp file not generated.");
-                    return E_FAIL;
-                }
-            }
-            catch (std::exception& e)
-            {
-                std::wstring errorMessage = std::wstring{ winrt::to_hstring(e.what()) };
-                Logger::error(L"Failed to start QoiThumbnailProvider.exe. Error: {}", errorMessage);
-            }
-        }
+    if (powertoys_gpo::getConfiguredQoiThumbnailsEnabledValue() == powertoys_gpo::gpo_rule_configured_disabled)
+    {
+        return E_FAIL;
     }
 
+    // The image is decoded straight from the stream and scaled down while decoding
+    StreamByteSource source{ m_pStream };
+    auto thumbnail = DecodeQoiThumbnail(source, cx);
 
-    return S_OK;
-}
+    m_pStream->Release();
+    m_pStream = NULL;
 
+    if (!thumbnail)
+    {
+        Logger::error(L"Failed to decode the QOI image.");
+        return E_FAIL;
+    }
 
-#pragma endregion
+    *phbmp = CreateThumbnailBitmap(thumbnail->width, thumbnail->height, thumbnail->pixels);
+    if (!*phbmp)
+    {
+        Logger::error(L"Failed to create the thumbnail bitmap.");
+        return E_OUTOFMEMORY;
+    }
 
-#pragma region Helper Functions
+    *pdwAlpha = WTS_ALPHATYPE::WTSAT_ARGB;
+    return S_OK;
+}
 
 #pragma endregion
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "pch.h"
+#include "QoiDecoder.h"
 
 #include <ShlObj.h>
 #include <string>
@@ -32,6 +33,4 @@ private:
 
     // Provided during initialization.
     IStream* m_pStream;
-
-    HANDLE m_process;
 };
\ No newline at end of file
@@ -0,0 +1,422 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Streaming parser for binary and ASCII STL models, which computes the bounds of the model while reading it, and
+// vertex clustering decimation, which keeps the work of rendering a thumbnail bounded by the thumbnail size.
+
+// Supplies the file bytes, e.g. from an IStream. Returns how many bytes were read, 0 at the end of the input.
+class StlByteSource
+{
+public:
+    virtual ~StlByteSource() = default;
+
+    virtual size_t Read(uint8_t* buffer, size_t size) = 0;
+};
+
+struct StlVector
+{
+    float x = {};
+    float y = {};
+    float z = {};
+
+    bool operator==(const StlVector&) const = default;
+};
+
+struct StlTriangle
+{
+    // Normals stored in the file aren't kept, they are often missing or wrong
+    std::array<StlVector, 3> vertices = {};
+
+    bool operator==(const StlTriangle&) const = default;
+};
+
+struct StlBounds
+{
+    StlVector min{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    StlVector max{ std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+
+    inline void Add(const StlVector& v)
+    {
+        min = { std::min(min.x, v.x), std::min(min.y, v.y), std::min(min.z, v.z) };
+        max = { std::max(max.x, v.x), std::max(max.y, v.y), std::max(max.z, v.z) };
+    }
+
+    inline bool Empty() const
+    {
+        return min.x > max.x;
+    }
+
+    bool operator==(const StlBounds&) const = default;
+};
+
+struct StlMesh
+{
+    std::vector<StlTriangle> triangles;
+    StlBounds bounds;
+};
+
+namespace StlFormat
+{
+    constexpr size_t HeaderSize = 80;
+    constexpr size_t TriangleSize = 50;
+    // Bytes inspected to tell ASCII files from binary ones whose header starts with "solid" too
+    constexpr size_t DetectionSize = 512;
+    // Keeps a corrupt triangle count from reserving absurd amounts of memory upfront
+    constexpr uint32_t MaxReservedTriangles = 1'000'000;
+    // Longer ASCII tokens can't be numbers or keywords, so they are only skipped
+    constexpr size_t MaxTokenLength = 64;
+
+    inline bool IsFinite(const StlVector& v)
+    {
+        return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
+    }
+
+    inline bool IsWhitespace(const uint8_t c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+    }
+}
+
+// Buffers the byte source. The first bytes can be inspected before any of them are consumed.
+class StlByteReader
+{
+    StlByteSource& source;
+    std::array<uint8_t, 64 * 1024> buffer;
+    size_t position = 0;
+    size_t available = 0;
+
+    bool Refill()
+    {
+        position = 0;
+        available = source.Read(buffer.data(), buffer.size());
+        return available != 0;
+    }
+
+public:
+    explicit StlByteReader(StlByteSource& source) :
+        source{ source }
+    {
+    }
+
+    // Reads up to `size` bytes without consuming them. Only valid before anything is consumed.
+    std::string_view Peek(const size_t size)
+    {
+        while (available < size)
+        {
+            const size_t read = source.Read(buffer.data() + available, std::min(size, buffer.size()) - available);
+            if (read == 0)
+            {
+                break;
+            }
+
+            available += read;
+        }
+
+        return { reinterpret_cast<const char*>(buffer.data()), std::min(available, size) };
+    }
+
+    inline bool Next(uint8_t& byte)
+    {
+        if (position == available && !Refill())
+        {
+            return false;
+        }
+
+        byte = buffer[position++];
+        return true;
+    }
+
+    bool Read(uint8_t* bytes, size_t count)
+    {
+        while (count > 0)
+        {
+            if (position == available && !Refill())
+            {
+                return false;
+            }
+
+            const size_t chunk = std::min(count, available - position);
+            std::memcpy(bytes, buffer.data() + position, chunk);
+            position += chunk;
+            bytes += chunk;
+            count -= chunk;
+        }
+
+        return true;
+    }
+};
+
+// ASCII files start with "solid" and contain only text. Binary files may start with "solid" as well, but their
+// triangle count and coordinates contain non-printable bytes sooner or later.
+inline bool IsAsciiStl(std::string_view prefix)
+{
+    const auto start = std::find_if_not(prefix.begin(), prefix.end(), [](const char c) { return StlFormat::IsWhitespace(c); });
+    prefix.remove_prefix(start - prefix.begin());
+    if (!prefix.starts_with("solid"))
+    {
+        return false;
+    }
+
+    const bool text = std::all_of(prefix.begin(), prefix.end(), [](const char c) {
+        return StlFormat::IsWhitespace(c) || (c >= 0x20 && c < 0x7F);
+    });
+    return text && (prefix.find("facet") != std::string_view::npos || prefix.find("endsolid") != std::string_view::npos);
+}
+
+namespace StlFormat
+{
+    inline std::optional<StlMesh> ParseBinary(StlByteReader& reader)
+    {
+        std::array<uint8_t, HeaderSize + sizeof(uint32_t)> header;
+        if (!reader.Read(header.data(), header.size()))
+        {
+            return std::nullopt;
+        }
+
+        uint32_t count;
+        std::memcpy(&count, &header[HeaderSize], sizeof(count));
+
+        StlMesh mesh;
+        mesh.triangles.reserve(std::min(count, MaxReservedTriangles));
+
+        std::array<uint8_t, TriangleSize> bytes;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (!reader.Read(bytes.data(), bytes.size()))
+            {
+                return std::nullopt;
+            }
+
+            // The normal comes first and the attribute byte count last, both are ignored
+            StlTriangle triangle;
+            std::memcpy(triangle.vertices.data(), &bytes[sizeof(StlVector)], sizeof(triangle.vertices));
+            if (!std::all_of(triangle.vertices.begin(), triangle.vertices.end(), IsFinite))
+            {
+                continue;
+            }
+
+            for (const auto& v : triangle.vertices)
+            {
+                mesh.bounds.Add(v);
+            }
+
+            mesh.triangles.push_back(triangle);
+        }
+
+        return mesh;
+    }
+
+    // Returns false at the end of the input. Tokens longer than MaxTokenLength are truncated.
+    inline bool NextToken(StlByteReader& reader, std::array<char, MaxTokenLength>& token, size_t& length)
+    {
+        uint8_t c;
+        do
+        {
+            if (!reader.Next(c))
+            {
+                return false;
+            }
+        } while (IsWhitespace(c));
+
+        length = 0;
+        do
+        {
+            if (length < token.size())
+            {
+                token[length++] = static_cast<char>(c);
+            }
+        } while (reader.Next(c) && !IsWhitespace(c));
+
+        return true;
+    }
+
+    inline bool ParseFloat(std::string_view text, float& value)
+    {
+        // from_chars doesn't accept a leading plus sign, which some exporters write
+        if (text.starts_with('+'))
+        {
+            text.remove_prefix(1);
+        }
+
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return error == std::errc{} && end == text.data() + text.size();
+    }
+
+    // Only vertices and the loops around them matter, everything else, e.g. names of solids and facet normals,
+    // is skipped
+    inline std::optional<StlMesh> ParseAscii(StlByteReader& reader)
+    {
+        StlMesh mesh;
+        StlTriangle triangle;
+        size_t vertices = 0;
+
+        std::array<char, MaxTokenLength> token;
+        size_t length = 0;
+        while (NextToken(reader, token, length))
+        {
+            const std::string_view keyword{ token.data(), length };
+            if (keyword == "loop")
+            {
+                vertices = 0;
+            }
+            else if (keyword == "vertex")
+            {
+                if (vertices == triangle.vertices.size())
+                {
+                    return std::nullopt;
+                }
+
+                std::array<float, 3> coordinates;
+                for (float& coordinate : coordinates)
+                {
+                    if (!NextToken(reader, token, length) || !ParseFloat({ token.data(), length }, coordinate))
+                    {
+                        return std::nullopt;
+                    }
+                }
+
+                triangle.vertices[vertices++] = { coordinates[0], coordinates[1], coordinates[2] };
+            }
+            else if (keyword == "endloop")
+            {
+                if (vertices != triangle.vertices.size())
+                {
+                    return std::nullopt;
+                }
+
+                vertices = 0;
+                if (!std::all_of(triangle.vertices.begin(), triangle.vertices.end(), IsFinite))
+                {
+                    continue;
+                }
+
+                for (const auto& v : triangle.vertices)
+                {
+                    mesh.bounds.Add(v);
+                }
+
+                mesh.triangles.push_back(triangle);
+            }
+        }
+
+        // A loop which isn't closed means the file was cut short
+        if (vertices != 0)
+        {
+            return std::nullopt;
+        }
+
+        return mesh;
+    }
+}
+
+// Reads a whole model in one pass. Triangles with non-finite coordinates are skipped.
+// Returns nullopt if the input is truncated or malformed.
+inline std::optional<StlMesh> ParseStl(StlByteSource& source)
+{
+    StlByteReader reader{ source };
+    return IsAsciiStl(reader.Peek(StlFormat::DetectionSize)) ? StlFormat::ParseAscii(reader) : StlFormat::ParseBinary(reader);
+}
+
+// Decimating pays off once there are more triangles than pixels to draw them into
+inline bool ShouldDecimateStlMesh(const StlMesh& mesh, const uint32_t thumbnailSize)
+{
+    return mesh.triangles.size() > static_cast<uint64_t>(thumbnailSize) * thumbnailSize;
+}
+
+// Vertex clustering: snaps the vertices to the centers of a grid of cubic cells, `gridSize` of which span the diagonal
+// of the bounds, then drops the triangles which collapse to a line or a point and the ones which duplicate another
+// triangle. A thumbnail fits the bounding sphere, so with as many cells as pixels vertices move by less than a pixel,
+// while the remaining triangles are bounded by the number of grid cells on the surface of the model. Triangles keep
+// their order and orientation, the bounds are left as they were so the camera doesn't move.
+inline void DecimateStlMesh(StlMesh& mesh, uint32_t gridSize)
+{
+    constexpr uint32_t CoordinateBits = 21;
+    gridSize = std::clamp<uint32_t>(gridSize, 1, 1u << CoordinateBits);
+
+    const StlBounds& bounds = mesh.bounds;
+    const StlVector size{ bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z };
+    const float diagonal = bounds.Empty() ? 0.f : std::sqrt(size.x * size.x + size.y * size.y + size.z * size.z);
+    if (diagonal <= 0.f || !std::isfinite(diagonal))
+    {
+        return;
+    }
+
+    const float cellSize = diagonal / gridSize;
+    const auto cellOf = [&](const float value, const float min) {
+        return std::min(static_cast<uint32_t>(std::max((value - min) / cellSize, 0.f)), gridSize - 1);
+    };
+    const auto cellCenter = [&](const uint32_t cell, const float min) { return min + (cell + 0.5f) * cellSize; };
+
+    // Open addressing set of triangle hashes, where 0 marks an empty slot
+    size_t capacity = 16;
+    while (capacity < mesh.triangles.size() * 2)
+    {
+        capacity *= 2;
+    }
+
+    std::vector<uint64_t> seen(capacity);
+    const auto insert = [&](uint64_t hash) {
+        hash = hash ? hash : 1;
+        for (size_t slot = hash & (capacity - 1);; slot = (slot + 1) & (capacity - 1))
+        {
+            if (seen[slot] == hash)
+            {
+                return false;
+            }
+
+            if (seen[slot] == 0)
+            {
+                seen[slot] = hash;
+                return true;
+            }
+        }
+    };
+
+    size_t kept = 0;
+    for (const StlTriangle& triangle : mesh.triangles)
+    {
+        std::array<uint64_t, 3> keys;
+        StlTriangle snapped;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            const StlVector& v = triangle.vertices[i];
+            const uint32_t x = cellOf(v.x, bounds.min.x);
+            const uint32_t y = cellOf(v.y, bounds.min.y);
+            const uint32_t z = cellOf(v.z, bounds.min.z);
+            keys[i] = static_cast<uint64_t>(x) | static_cast<uint64_t>(y) << CoordinateBits | static_cast<uint64_t>(z) << (2 * CoordinateBits);
+            snapped.vertices[i] = { cellCenter(x, bounds.min.x), cellCenter(y, bounds.min.y), cellCenter(z, bounds.min.z) };
+        }
+
+        if (keys[0] == keys[1] || keys[1] == keys[2] || keys[0] == keys[2])
+        {
+            continue;
+        }
+
+        // The same cells in any order are the same triangle
+        std::sort(keys.begin(), keys.end());
+        uint64_t hash = 0xcbf29ce484222325;
+        for (const uint64_t key : keys)
+        {
+            hash = (hash ^ key) * 0x100000001b3;
+            hash ^= hash >> 29;
+        }
+
+        if (insert(hash))
+        {
+            mesh.triangles[kept++] = snapped;
+        }
+    }
+
+    mesh.triangles.resize(kept);
+    mesh.triangles.shrink_to_fit();
+}
@@ -0,0 +1,306 @@
+#pragma once
+
+#include "StlMesh.h"
+
+#include <atomic>
+#include <thread>
+
+// Software rasterizer for STL thumbnails, which renders the model like the .NET thumbnail provider did: rotated by
+// 180 degrees around the Z axis and seen from (1, 2, 1) through a 20 degree perspective camera which fits the model.
+// Triangles are flat shaded with a key light from the upper left of the camera, a fill light from the camera and
+// an ambient light, lighting both of their sides since the winding of STL triangles can't be trusted.
+
+struct StlThumbnail
+{
+    uint32_t width = {};
+    uint32_t height = {};
+    // Top-down rows of 0xAARRGGBB pixels, transparent where there's no model, i.e. a 32bpp BGRA DIB
+    std::vector<uint32_t> pixels;
+};
+
+struct StlRenderOptions
+{
+    uint32_t size = 256;
+    // 0xRRGGBB
+    uint32_t color = 0xFFC924;
+    // 0 for one thread per processor
+    unsigned int threads = 0;
+};
+
+namespace StlRendering
+{
+    constexpr float FieldOfViewDegrees = 20.f;
+    // Rows of pixels rasterized together. Bands don't depend on the number of threads, so neither does the image.
+    constexpr uint32_t BandHeight = 16;
+    // Below this, starting threads costs more than it saves
+    constexpr size_t MinTrianglesPerThread = 4096;
+
+    constexpr float AmbientLight = 0.3f;
+    constexpr float KeyLight = 0.55f;
+    constexpr float FillLight = 0.25f;
+
+    struct Vector
+    {
+        float x = {};
+        float y = {};
+        float z = {};
+
+        inline Vector operator+(const Vector& o) const { return { x + o.x, y + o.y, z + o.z }; }
+        inline Vector operator-(const Vector& o) const { return { x - o.x, y - o.y, z - o.z }; }
+        inline Vector operator*(const float s) const { return { x * s, y * s, z * s }; }
+        inline float Dot(const Vector& o) const { return x * o.x + y * o.y + z * o.z; }
+        inline Vector Cross(const Vector& o) const { return { y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x }; }
+
+        inline Vector Normalized() const
+        {
+            const float length = std::sqrt(Dot(*this));
+            return length > 0.f ? *this * (1.f / length) : Vector{};
+        }
+    };
+
+    // The model rotated by 180 degrees around the Z axis
+    inline Vector ModelToWorld(const StlVector& v)
+    {
+        return { -v.x, -v.y, v.z };
+    }
+
+    struct Camera
+    {
+        Vector eye;
+        Vector right;
+        Vector up;
+        Vector forward;
+        float focalLength = {};
+        float center = {};
+    };
+
+    // Fits the bounding sphere of the model into the view, like HelixToolkit's ZoomExtents
+    inline Camera FitCamera(const StlBounds& bounds, const uint32_t size)
+    {
+        const Vector min = ModelToWorld(bounds.min);
+        const Vector max = ModelToWorld(bounds.max);
+        const Vector target = (min + max) * 0.5f;
+        const float radius = std::max(std::sqrt((max - min).Dot(max - min)) * 0.5f, std::numeric_limits<float>::min());
+
+        const float halfFieldOfView = FieldOfViewDegrees * 0.5f * 3.14159265f / 180.f;
+        Camera camera;
+        camera.forward = Vector{ -1.f, -2.f, -1.f }.Normalized();
+        camera.right = camera.forward.Cross({ 0.f, 0.f, 1.f }).Normalized();
+        camera.up = camera.right.Cross(camera.forward);
+        camera.eye = target - camera.forward * (radius / std::sin(halfFieldOfView));
+        camera.center = size * 0.5f;
+        camera.focalLength = camera.center / std::tan(halfFieldOfView);
+        return camera;
+    }
+
+    struct ScreenTriangle
+    {
+        std::array<float, 3> x;
+        std::array<float, 3> y;
+        // Inverse view depth, which is affine in screen space. Closer is larger.
+        std::array<float, 3> depth;
+        uint32_t color;
+    };
+
+    // Returns false for triangles which don't cover any pixel center
+    inline bool Project(const Camera& camera,
+                        const StlTriangle& triangle,
+                        const uint32_t size,
+                        const Vector& color,
+                        const Vector& keyLightDirection,
+                        ScreenTriangle& screen)
+    {
+        std::array<Vector, 3> world;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            world[i] = ModelToWorld(triangle.vertices[i]);
+            const Vector view = world[i] - camera.eye;
+            const float inverseDepth = 1.f / view.Dot(camera.forward);
+            screen.x[i] = camera.center + view.Dot(camera.right) * camera.focalLength * inverseDepth;
+            screen.y[i] = camera.center - view.Dot(camera.up) * camera.focalLength * inverseDepth;
+            screen.depth[i] = inverseDepth;
+        }
+
+        const float minX = std::min({ screen.x[0], screen.x[1], screen.x[2] });
+        const float maxX = std::max({ screen.x[0], screen.x[1], screen.x[2] });
+        const float minY = std::min({ screen.y[0], screen.y[1], screen.y[2] });
+        const float maxY = std::max({ screen.y[0], screen.y[1], screen.y[2] });
+        if (maxX < 0.5f || maxY < 0.5f || minX > size - 0.5f || minY > size - 0.5f)
+        {
+            return false;
+        }
+
+        const float area = (screen.x[1] - screen.x[0]) * (screen.y[2] - screen.y[0]) - (screen.x[2] - screen.x[0]) * (screen.y[1] - screen.y[0]);
+        if (area == 0.f)
+        {
+            return false;
+        }
+
+        // Rasterization expects one winding
+        if (area < 0.f)
+        {
+            std::swap(screen.x[1], screen.x[2]);
+            std::swap(screen.y[1], screen.y[2]);
+            std::swap(screen.depth[1], screen.depth[2]);
+        }
+
+        Vector normal = (world[1] - world[0]).Cross(world[2] - world[0]).Normalized();
+        if (normal.Dot(camera.forward) > 0.f)
+        {
+            normal = normal * -1.f;
+        }
+
+        const float light = AmbientLight + KeyLight * std::max(0.f, -normal.Dot(keyLightDirection)) + FillLight * -normal.Dot(camera.forward);
+        const auto channel = [light](const float value) { return static_cast<uint32_t>(std::clamp(value * light, 0.f, 255.f) + 0.5f); };
+        screen.color = 0xFF000000 | channel(color.x) << 16 | channel(color.y) << 8 | channel(color.z);
+        return true;
+    }
+
+    // Fills the pixels of the triangle whose centers are inside it or on its edges, rows [rowBegin, rowEnd) only.
+    // Every row starts from the left of the triangle bounds, so a pixel gets the same depth whatever band it's in.
+    inline void Rasterize(const ScreenTriangle& t, const uint32_t size, const uint32_t rowBegin, const uint32_t rowEnd, uint32_t* pixels, float* depths)
+    {
+        const float minX = std::min({ t.x[0], t.x[1], t.x[2] });
+        const float maxX = std::max({ t.x[0], t.x[1], t.x[2] });
+        const float minY = std::min({ t.y[0], t.y[1], t.y[2] });
+        const float maxY = std::max({ t.y[0], t.y[1], t.y[2] });
+
+        // Pixel centers are at +0.5
+        const int64_t left = std::max<int64_t>(static_cast<int64_t>(std::ceil(minX - 0.5f)), 0);
+        const int64_t right = std::min<int64_t>(static_cast<int64_t>(std::floor(maxX - 0.5f)), static_cast<int64_t>(size) - 1);
+        const int64_t top = std::max<int64_t>(static_cast<int64_t>(std::ceil(minY - 0.5f)), rowBegin);
+        const int64_t bottom = std::min<int64_t>(static_cast<int64_t>(std::floor(maxY - 0.5f)), static_cast<int64_t>(rowEnd) - 1);
+        if (left > right || top > bottom)
+        {
+            return;
+        }
+
+        // Edge functions, positive inside: edge i is opposite to vertex i
+        const float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+        std::array<float, 3> stepX;
+        std::array<float, 3> stepY;
+        std::array<float, 3> origin;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            const size_t a = (i + 1) % 3;
+            const size_t b = (i + 2) % 3;
+            stepX[i] = t.y[a] - t.y[b];
+            stepY[i] = t.x[b] - t.x[a];
+            origin[i] = t.x[a] * t.y[b] - t.y[a] * t.x[b];
+        }
+
+        const float inverseArea = 1.f / area;
+        const float depthStepX = (stepX[0] * t.depth[0] + stepX[1] * t.depth[1] + stepX[2] * t.depth[2]) * inverseArea;
+
+        for (int64_t y = top; y <= bottom; ++y)
+        {
+            const float centerX = left + 0.5f;
+            const float centerY = y + 0.5f;
+            std::array<float, 3> edges;
+            for (size_t i = 0; i < 3; ++i)
+            {
+                edges[i] = stepX[i] * centerX + stepY[i] * centerY + origin[i];
+            }
+
+            float depth = (edges[0] * t.depth[0] + edges[1] * t.depth[1] + edges[2] * t.depth[2]) * inverseArea;
+            const size_t row = static_cast<size_t>(y) * size;
+            for (int64_t x = left; x <= right; ++x)
+            {
+                if (edges[0] >= 0.f && edges[1] >= 0.f && edges[2] >= 0.f && depth > depths[row + x])
+                {
+                    depths[row + x] = depth;
+                    pixels[row + x] = t.color;
+                }
+
+                edges[0] += stepX[0];
+                edges[1] += stepX[1];
+                edges[2] += stepX[2];
+                depth += depthStepX;
+            }
+        }
+    }
+
+    template<typename Fn>
+    void RunOnThreads(const unsigned int threads, Fn&& fn)
+    {
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for (unsigned int i = 1; i < threads; ++i)
+        {
+            workers.emplace_back(fn, i);
+        }
+
+        fn(0u);
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+}
+
+// Every thread projects a contiguous range of triangles and sorts them into bands of rows, then the threads take
+// bands one by one and rasterize the triangles of every range in order, so pixels don't need synchronization and
+// the image is the same whatever the number of threads.
+inline StlThumbnail RenderStlThumbnail(const StlMesh& mesh, const StlRenderOptions& options)
+{
+    using namespace StlRendering;
+
+    const uint32_t size = options.size;
+    StlThumbnail thumbnail{ .width = size, .height = size, .pixels = std::vector<uint32_t>(static_cast<size_t>(size) * size, 0) };
+    if (size == 0 || mesh.triangles.empty() || mesh.bounds.Empty())
+    {
+        return thumbnail;
+    }
+
+    const unsigned int maxThreads = options.threads ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    const unsigned int threads = static_cast<unsigned int>(std::clamp<size_t>(mesh.triangles.size() / MinTrianglesPerThread, 1, maxThreads));
+
+    const Camera camera = FitCamera(mesh.bounds, size);
+    const Vector keyLightDirection = (camera.forward + camera.right * 0.5f - camera.up * 0.7f).Normalized();
+    const Vector color{ static_cast<float>(options.color >> 16 & 0xFF), static_cast<float>(options.color >> 8 & 0xFF), static_cast<float>(options.color & 0xFF) };
+
+    const uint32_t bandCount = (size + BandHeight - 1) / BandHeight;
+    std::vector<ScreenTriangle> screenTriangles(mesh.triangles.size());
+    // Indices of the projected triangles in every band, for every thread's range of triangles
+    std::vector<std::vector<std::vector<uint32_t>>> bins(threads, std::vector<std::vector<uint32_t>>(bandCount));
+
+    RunOnThreads(threads, [&](const unsigned int thread) {
+        const size_t begin = mesh.triangles.size() * thread / threads;
+        const size_t end = mesh.triangles.size() * (thread + 1) / threads;
+        auto& threadBins = bins[thread];
+        for (size_t i = begin; i < end; ++i)
+        {
+            ScreenTriangle& screen = screenTriangles[i];
+            if (!Project(camera, mesh.triangles[i], size, color, keyLightDirection, screen))
+            {
+                continue;
+            }
+
+            const float minY = std::max(std::min({ screen.y[0], screen.y[1], screen.y[2] }) - 0.5f, 0.f);
+            const float maxY = std::min(std::max({ screen.y[0], screen.y[1], screen.y[2] }) - 0.5f, size - 1.f);
+            for (uint32_t band = static_cast<uint32_t>(std::ceil(minY)) / BandHeight; band <= static_cast<uint32_t>(maxY) / BandHeight; ++band)
+            {
+                threadBins[band].push_back(static_cast<uint32_t>(i));
+            }
+        }
+    });
+
+    std::vector<float> depths(thumbnail.pixels.size());
+    std::atomic<uint32_t> nextBand = 0;
+    RunOnThreads(threads, [&](unsigned int) {
+        for (uint32_t band = nextBand++; band < bandCount; band = nextBand++)
+        {
+            const uint32_t rowBegin = band * BandHeight;
+            const uint32_t rowEnd = std::min(rowBegin + BandHeight, size);
+            for (const auto& threadBins : bins)
+            {
+                for (const uint32_t i : threadBins[band])
+                {
+                    Rasterize(screenTriangles[i], size, rowBegin, rowEnd, thumbnail.pixels.data(), depths.data());
+                }
+            }
+        }
+    });
+
+    return thumbnail;
+}
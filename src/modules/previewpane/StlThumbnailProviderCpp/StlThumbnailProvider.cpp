@@ -2,23 +2,49 @@
 #include "StlThumbnailProvider.h"
 
 #include <filesystem>
-#include <fstream>
-#include <shellapi.h>
 #include <Shlwapi.h>
 #include <string>
 
-#include <wil/com.h>
-
 #include <common/interop/shared_constants.h>
 #include <common/logger/logger.h>
 #include <common/SettingsAPI/settings_helpers.h>
-#include <common/utils/process_path.h>
+#include <common/utils/color.h>
+#include <common/utils/gpo.h>
+#include <common/utils/thumbnail_bitmap.h>
 
 extern HINSTANCE g_hInst;
 extern long g_cDllRef;
 
+namespace
+{
+    // PowerPreviewProperties.DefaultStlThumbnailColor
+    constexpr uint32_t DefaultModelColor = 0xFFC924;
+
+    const wchar_t JSON_KEY_PROPERTIES[] = L"properties";
+    const wchar_t JSON_KEY_VALUE[] = L"value";
+    const wchar_t JSON_KEY_STL_THUMBNAIL_COLOR[] = L"stl-thumbnail-color-setting";
+
+    class StreamByteSource : public StlByteSource
+    {
+        IStream* stream;
+
+    public:
+        explicit StreamByteSource(IStream* stream) :
+            stream{ stream }
+        {
+        }
+
+        size_t Read(uint8_t* buffer, size_t size) override
+        {
+            ULONG read = 0;
+            const HRESULT hr = stream->Read(buffer, static_cast<ULONG>(size), &read);
+            return FAILED(hr) ? 0 : read;
+        }
+    };
+}
+
 StlThumbnailProvider::StlThumbnailProvider() :
-    m_cRef(1), m_pStream(NULL), m_process(NULL)
+    m_cRef(1), m_pStream(NULL)
 {
     std::filesystem::path logFilePath(PTSettingsHelper::get_local_low_folder_location());
     logFilePath.append(LogSettings::stlThumbLogPath);
@@ -91,96 +117,47 @@ IFACEMETHODIMP StlThumbnailProvider::Initialize(IStream* pStream, DWORD grfMode)
 
 IFACEMETHODIMP StlThumbnailProvider::GetThumbnail(UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha)
 {
-    // Read stream into the buffer
-    char buffer[4096];
-    ULONG cbRead;
-
     Logger::trace(L"Begin");
 
-    GUID guid;
-    if (CoCreateGuid(&guid) == S_OK)
+    if (!m_pStream || !phbmp || !pdwAlpha || cx == 0 || cx > MaxThumbnailSize)
     {
-        wil::unique_cotaskmem_string guidString;
-        if (SUCCEEDED(StringFromCLSID(guid, &guidString)))
-        {
-            Logger::info(L"Read stream and save to tmp file.");
-            
-            // {CLSID} -> CLSID
-            std::wstring guid = std::wstring(guidString.get()).substr(1, std::wstring(guidString.get()).size() - 2);
-            std::wstring filePath = PTSettingsHelper::get_local_low_folder_location() + L"\\StlThumbnail-Temp\\";
-            if (!std::filesystem::exists(filePath))
-            {
-                std::filesystem::create_directories(filePath);
-            }
-
-            std::wstring fileName = filePath + guid + L".stl";
-
-            // Write data to tmp file
-            std::fstream file;
-            file.open(fileName, std::ios_base::out | std::ios_base::binary);
-
-            if (!file.is_open())
-            {
-                return 0;
-            }
-
-            while (true)
-            {
-                auto result = m_pStream->Read(buffer, 4096, &cbRead);
-
-                file.write(buffer, cbRead);
-                if (result == S_FALSE)
-                {
-                    break;
-                }
-            }
-            file.close();
+        return E_INVALIDARG;
+    }
 
-            m_pStream->Release();
-            m_pStream = NULL;
+    if (powertoys_gpo::getConfiguredStlThumbnailsEnabledValue() == powertoys_gpo::gpo_rule_configured_disabled)
+    {
+        return E_FAIL;
+    }
 
-            try
-            {
-                Logger::info(L"Start StlThumbnailProvider.exe");
-                
-                STARTUPINFO info = { sizeof(info) };
-                std::wstring cmdLine{ L"\"" + fileName + L"\"" };
-                cmdLine += L" ";
-                cmdLine += std::to_wstring(cx);
-
-                std::wstring appPath = get_module_folderpath(g_hInst) + L"\\PowerToys.StlThumbnailProvider.exe";
-
-                SHELLEXECUTEINFO sei{ sizeof(sei) };
-                sei.fMask = { SEE_MASK_NOCLOSEPROCESS | SEE_MASK_FLAG_NO_UI };
-                sei.lpFile = appPath.c_str();
-                sei.lpParameters = cmdLine.c_str();
-                sei.nShow = SW_SHOWDEFAULT;
-                ShellExecuteEx(&sei);
-                m_process = sei.hProcess;
-                WaitForSingleObject(m_process, INFINITE);
-                std::filesystem::remove(fileName);
-
-                std::wstring fileNameBmp = filePath + guid + L".bmp";
-                if (std::filesystem::exists(fileNameBmp))
-                {
-                    *phbmp = static_cast<HBITMAP>(LoadImage(NULL, fileNameBmp.c_str(), IMAGE_BITMAP, 0, 0, LR_LOADFROMFILE));
-                    *pdwAlpha = WTS_ALPHATYPE::WTSAT_ARGB;
-                    std::filesystem::remove(fileNameBmp);
-                }
-                else
-                {
-                    Logger::info(L"Bmp file not generated.");
-                    return E_FAIL;
-                }
-            }
-            catch (std::exception& e)
-            {
-                std::wstring errorMessage = std::wstring{ winrt::to_hstring(e.what()) };
-                Logger::error(L"Failed to start StlThumbnailProvider.exe. Error: {}", errorMessage);
-            }
-        }
+    // The model is parsed straight from the stream and rendered in-process
+    StreamByteSource source{ m_pStream };
+    auto mesh = ParseStl(source);
+
+    m_pStream->Release();
+    m_pStream = NULL;
+
+    if (!mesh || mesh->triangles.empty())
+    {
+        Logger::error(L"Failed to read the STL model.");
+        return E_FAIL;
+    }
+
+    if (ShouldDecimateStlMesh(*mesh, cx))
+    {
+        const size_t triangles = mesh->triangles.size();
+        DecimateStlMesh(*mesh, cx);
+        Logger::trace(L"Decimated {} triangles to {}", triangles, mesh->triangles.size());
+    }
+
+    const auto thumbnail = RenderStlThumbnail(*mesh, { .size = cx, .color = LoadModelColor() });
+    *phbmp = CreateThumbnailBitmap(thumbnail.width, thumbnail.height, thumbnail.pixels);
+    if (!*phbmp)
+    {
+        Logger::error(L"Failed to create the thumbnail bitmap.");
+        return E_OUTOFMEMORY;
     }
 
+    *pdwAlpha = WTS_ALPHATYPE::WTSAT_ARGB;
     return S_OK;
 }
 
@@ -188,4 +165,26 @@ IFACEMETHODIMP StlThumbnailProvider::GetThumbnail(UINT cx, HBITMAP* phbmp, WTS_A
 
 #pragma region Helper Functions
 
+uint32_t StlThumbnailProvider::LoadModelColor()
+{
+    try
+    {
+        const auto colorString = PTSettingsHelper::load_module_settings(L"File Explorer")
+                                     .GetNamedObject(JSON_KEY_PROPERTIES)
+                                     .GetNamedObject(JSON_KEY_STL_THUMBNAIL_COLOR)
+                                     .GetNamedString(JSON_KEY_VALUE);
+        uint8_t r, g, b;
+        if (checkValidRGB(colorString, &r, &g, &b))
+        {
+            return static_cast<uint32_t>(r) << 16 | static_cast<uint32_t>(g) << 8 | b;
+        }
+    }
+    catch (...)
+    {
+        // Couldn't read the settings, use the default color
+    }
+
+    return DefaultModelColor;
+}
+
 #pragma endregion
@@ -6,6 +6,8 @@
 #include <string>
 #include <thumbcache.h>
 
+#include "StlRenderer.h"
+
 class StlThumbnailProvider :
     public IInitializeWithStream,
     public IThumbnailProvider
@@ -33,5 +35,6 @@ private:
     // Provided during initialization.
     IStream* m_pStream;
 
-    HANDLE m_process;
+    // The color of the model from the File Explorer settings, 0xRRGGBB
+    static uint32_t LoadModelColor();
 };
\ No newline at end of file
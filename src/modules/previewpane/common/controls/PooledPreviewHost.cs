@@ -0,0 +1,111 @@
+﻿// Copyright (c) Microsoft Corporation
+// The Microsoft Corporation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System;
+using System.Diagnostics;
+using System.Drawing;
+using System.IO;
+using System.Text;
+using System.Threading;
+using System.Windows.Forms;
+
+namespace Common
+{
+    /// <summary>
+    /// Runs a preview host which stays for many previews, started by the native preview handler with "--pooled &lt;process id&gt;".
+    /// The handler sends one command per line on the standard input, with tab separated fields:
+    /// "preview id path parent left right top bottom", "resize id left right top bottom", "unload id" and "exit".
+    /// The host answers "ready" once it started, then "shown id" or "failed id" for every preview.
+    /// </summary>
+    public static class PooledPreviewHost
+    {
+        /// <summary>
+        /// Starts reading commands, call it before <see cref="Application.Run()"/>.
+        /// The host exits when its input is closed, or when the process which started it exits.
+        /// </summary>
+        /// <param name="createControl">Creates the control of a preview.</param>
+        /// <param name="parentProcessId">Id of the process which started the host.</param>
+        public static void Run(Func<FormHandlerControl> createControl, int parentProcessId)
+        {
+            var context = new WindowsFormsSynchronizationContext();
+            var output = new StreamWriter(Console.OpenStandardOutput(), new UTF8Encoding(false)) { AutoFlush = true, NewLine = "\n" };
+            FormHandlerControl? control = null;
+            string? preview = null;
+
+            void UnloadPreview()
+            {
+                if (control != null)
+                {
+                    control.Unload();
+                    control.Dispose();
+                    control = null;
+                    preview = null;
+                }
+            }
+
+            void Handle(string line)
+            {
+                var fields = line.Split('\t');
+                switch (fields[0])
+                {
+                    case "preview" when fields.Length == 8:
+                        UnloadPreview();
+                        try
+                        {
+                            control = createControl();
+                            preview = fields[1];
+                            control.SetWindow((IntPtr)Convert.ToInt64(fields[3], 16), default(Rectangle));
+                            control.DoPreview(fields[2]);
+                            output.WriteLine("shown\t" + fields[1]);
+                        }
+                        catch (Exception)
+                        {
+                            output.WriteLine("failed\t" + fields[1]);
+                        }
+
+                        break;
+                    case "resize" when fields.Length == 6 && fields[1] == preview:
+                        control?.SetRect(default(Rectangle));
+                        break;
+                    case "unload" when fields.Length == 2 && fields[1] == preview:
+                        UnloadPreview();
+                        break;
+                    case "exit":
+                        UnloadPreview();
+                        Application.Exit();
+                        break;
+                }
+            }
+
+            try
+            {
+                var parent = Process.GetProcessById(parentProcessId);
+                parent.EnableRaisingEvents = true;
+                parent.Exited += (sender, e) => context.Post(_ => Application.Exit(), null);
+            }
+            catch (ArgumentException)
+            {
+                // The process which started the host is already gone
+                Environment.Exit(0);
+            }
+
+            var reader = new Thread(() =>
+            {
+                using var input = new StreamReader(Console.OpenStandardInput(), new UTF8Encoding(false));
+                string? line;
+                while ((line = input.ReadLine()) != null)
+                {
+                    var command = line;
+                    context.Send(_ => Handle(command), null);
+                }
+
+                context.Post(_ => Application.Exit(), null);
+            });
+
+            reader.IsBackground = true;
+            reader.Start();
+            output.WriteLine("ready");
+        }
+    }
+}
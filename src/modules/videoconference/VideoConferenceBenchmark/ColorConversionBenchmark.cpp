@@ -0,0 +1,464 @@
+#include "pch.h"
+#include "ColorConversionBenchmark.h"
+
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include <ColorConversion.h>
+#include <MediaTypeSelection.h>
+
+namespace
+{
+    using namespace VideoConferenceBenchmark;
+    using namespace ColorConversion;
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::array<TargetFormat, 5> targetFormats = {
+        TargetFormat::Nv12, TargetFormat::I420, TargetFormat::Yuy2, TargetFormat::Rgb24, TargetFormat::Rgb32
+    };
+
+    const wchar_t* FormatName(const TargetFormat format)
+    {
+        switch (format)
+        {
+        case TargetFormat::Nv12:
+            return L"NV12";
+        case TargetFormat::I420:
+            return L"I420";
+        case TargetFormat::Yuy2:
+            return L"YUY2";
+        case TargetFormat::Rgb24:
+            return L"RGB24";
+        case TargetFormat::Rgb32:
+            return L"RGB32";
+        }
+
+        return L"";
+    }
+
+    struct Image
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        size_t stride = 0;
+        SourceFormat format = SourceFormat::Bgr24;
+        std::vector<uint8_t> pixels;
+
+        uint8_t* Pixel(const uint32_t x, const uint32_t y)
+        {
+            return pixels.data() + y * stride + x * BytesPerPixel(format);
+        }
+
+        const uint8_t* Pixel(const uint32_t x, const uint32_t y) const
+        {
+            return pixels.data() + y * stride + x * BytesPerPixel(format);
+        }
+    };
+
+    Image MakeImage(const uint32_t width, const uint32_t height, const SourceFormat format, const size_t padding = 0)
+    {
+        Image image{ width, height, width * BytesPerPixel(format) + padding, format };
+        image.pixels.resize(image.stride * height);
+        return image;
+    }
+
+    void Fill(Image& image, const uint32_t x, const uint32_t y, const std::array<uint8_t, 3>& bgr)
+    {
+        std::copy(bgr.begin(), bgr.end(), image.Pixel(x, y));
+    }
+
+    std::vector<uint8_t> ConvertImage(const Image& image, const TargetFormat format, const bool simd)
+    {
+        std::vector<uint8_t> frame(FrameSize(format, image.width, image.height));
+        if (!Convert(image.pixels.data(), image.stride, image.format, image.width, image.height, format, frame.data(), frame.size(), simd))
+        {
+            frame.clear();
+        }
+
+        return frame;
+    }
+
+    // BT.601 limited range in floating point, for the average of the pixels
+    std::array<double, 3> ReferenceYuv(const double b, const double g, const double r)
+    {
+        return { 16 + (65.481 * r + 128.553 * g + 24.966 * b) / 255,
+                 128 + (-37.797 * r - 74.203 * g + 112.0 * b) / 255,
+                 128 + (112.0 * r - 93.786 * g - 18.214 * b) / 255 };
+    }
+
+    bool Near(const uint8_t value, const double reference)
+    {
+        return std::abs(value - reference) <= 1.0;
+    }
+
+    struct Planes
+    {
+        uint8_t y;
+        uint8_t u;
+        uint8_t v;
+    };
+
+    // The samples of the pixel, and of the chroma of its block, whatever the layout of the format
+    Planes Sample(const std::vector<uint8_t>& frame, const TargetFormat format, const uint32_t width, const uint32_t height, const uint32_t x, const uint32_t y)
+    {
+        const size_t lumaSize = size_t{ width } * height;
+        switch (format)
+        {
+        case TargetFormat::Nv12:
+        {
+            const uint8_t* chroma = frame.data() + lumaSize + (y / 2) * size_t{ width } + (x / 2) * 2;
+            return { frame[y * size_t{ width } + x], chroma[0], chroma[1] };
+        }
+        case TargetFormat::I420:
+        {
+            const size_t chroma = (y / 2) * size_t{ width / 2 } + x / 2;
+            return { frame[y * size_t{ width } + x], frame[lumaSize + chroma], frame[lumaSize + lumaSize / 4 + chroma] };
+        }
+        case TargetFormat::Yuy2:
+        {
+            const uint8_t* pair = frame.data() + y * size_t{ width } * 2 + (x / 2) * 4;
+            return { pair[(x % 2) * 2], pair[1], pair[3] };
+        }
+        default:
+            return {};
+        }
+    }
+
+    CheckResult CheckGoldenColors()
+    {
+        CheckResult result{ .name = L"Conversion golden colors" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        struct Golden
+        {
+            std::array<uint8_t, 3> bgr;
+            Planes yuv;
+        };
+
+        // Black and white exactly at the ends of the limited range, and the primaries as BT.601 gives them
+        const std::array<Golden, 5> goldens = { {
+            { { 0, 0, 0 }, { 16, 128, 128 } },
+            { { 255, 255, 255 }, { 235, 128, 128 } },
+            { { 0, 0, 255 }, { 82, 90, 240 } },
+            { { 0, 255, 0 }, { 144, 54, 34 } },
+            { { 255, 0, 0 }, { 41, 240, 110 } },
+        } };
+
+        for (const bool simd : { true, false })
+        {
+            for (const auto& golden : goldens)
+            {
+                // Wide enough for the SIMD loops and their scalar tails
+                auto image = MakeImage(18, 4, SourceFormat::Bgr24);
+                for (uint32_t y = 0; y < image.height; ++y)
+                {
+                    for (uint32_t x = 0; x < image.width; ++x)
+                    {
+                        Fill(image, x, y, golden.bgr);
+                    }
+                }
+
+                for (const auto format : { TargetFormat::Nv12, TargetFormat::I420, TargetFormat::Yuy2 })
+                {
+                    const auto frame = ConvertImage(image, format, simd);
+                    bool matches = !frame.empty();
+                    for (uint32_t y = 0; matches && y < image.height; ++y)
+                    {
+                        for (uint32_t x = 0; matches && x < image.width; ++x)
+                        {
+                            const Planes planes = Sample(frame, format, image.width, image.height, x, y);
+                            matches = planes.y == golden.yuv.y && planes.u == golden.yuv.u && planes.v == golden.yuv.v;
+                        }
+                    }
+                    check(matches);
+                }
+            }
+        }
+
+        // A 4x2 image of a red and a blue 2x2 block, whose frames are spelled out
+        auto image = MakeImage(4, 2, SourceFormat::Bgr24);
+        for (uint32_t y = 0; y < 2; ++y)
+        {
+            for (uint32_t x = 0; x < 4; ++x)
+            {
+                Fill(image, x, y, x < 2 ? std::array<uint8_t, 3>{ 0, 0, 255 } : std::array<uint8_t, 3>{ 255, 0, 0 });
+            }
+        }
+
+        const std::vector<uint8_t> nv12 = { 82, 82, 41, 41, 82, 82, 41, 41, 90, 240, 240, 110 };
+        const std::vector<uint8_t> i420 = { 82, 82, 41, 41, 82, 82, 41, 41, 90, 240, 240, 110 };
+        const std::vector<uint8_t> yuy2 = { 82, 90, 82, 240, 41, 240, 41, 110, 82, 90, 82, 240, 41, 240, 41, 110 };
+        const std::vector<uint8_t> rgb32 = { 0, 0, 255, 255, 0, 0, 255, 255, 255, 0, 0, 255, 255, 0, 0, 255,
+                                             0, 0, 255, 255, 0, 0, 255, 255, 255, 0, 0, 255, 255, 0, 0, 255 };
+        check(ConvertImage(image, TargetFormat::Nv12, true) == nv12);
+        check(ConvertImage(image, TargetFormat::I420, true) == i420);
+        check(ConvertImage(image, TargetFormat::Yuy2, true) == yuy2);
+        check(ConvertImage(image, TargetFormat::Rgb24, true) == image.pixels);
+        check(ConvertImage(image, TargetFormat::Rgb32, true) == rgb32);
+        return result;
+    }
+
+    CheckResult CheckRandomImages(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"Conversion SIMD vs scalar" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        std::mt19937 random{ seed };
+        std::uniform_int_distribution<int> byte{ 0, 255 };
+        for (int i = 0; i < 300; ++i)
+        {
+            const uint32_t width = 2 * std::uniform_int_distribution<uint32_t>{ 1, 40 }(random);
+            const uint32_t height = 2 * std::uniform_int_distribution<uint32_t>{ 1, 6 }(random);
+            const auto sourceFormat = i % 2 ? SourceFormat::Bgra32 : SourceFormat::Bgr24;
+            auto image = MakeImage(width, height, sourceFormat, std::uniform_int_distribution<size_t>{ 0, 7 }(random));
+            for (auto& value : image.pixels)
+            {
+                value = static_cast<uint8_t>(byte(random));
+            }
+
+            for (const auto format : targetFormats)
+            {
+                const auto simd = ConvertImage(image, format, true);
+                const auto scalar = ConvertImage(image, format, false);
+                check(!simd.empty() && simd == scalar);
+                if (format == TargetFormat::Rgb24 || format == TargetFormat::Rgb32 || simd.empty())
+                {
+                    continue;
+                }
+
+                // Within a step of the floating point reference, for the luma of every pixel and the chroma of its block
+                const uint32_t blockHeight = format == TargetFormat::Yuy2 ? 1 : 2;
+                bool near = true;
+                for (uint32_t y = 0; near && y < height; ++y)
+                {
+                    for (uint32_t x = 0; near && x < width; ++x)
+                    {
+                        const uint8_t* pixel = image.Pixel(x, y);
+                        const Planes planes = Sample(simd, format, width, height, x, y);
+                        double b = 0, g = 0, r = 0;
+                        const uint32_t top = y - y % blockHeight;
+                        for (uint32_t by = top; by < top + blockHeight; ++by)
+                        {
+                            for (uint32_t bx = x - x % 2; bx < x - x % 2 + 2; ++bx)
+                            {
+                                const uint8_t* blockPixel = image.Pixel(bx, by);
+                                b += blockPixel[0];
+                                g += blockPixel[1];
+                                r += blockPixel[2];
+                            }
+                        }
+
+                        const double count = 2.0 * blockHeight;
+                        const auto chroma = ReferenceYuv(b / count, g / count, r / count);
+                        near = Near(planes.y, ReferenceYuv(pixel[0], pixel[1], pixel[2])[0]) && Near(planes.u, chroma[1]) &&
+                               Near(planes.v, chroma[2]);
+                    }
+                }
+                check(near);
+            }
+        }
+
+        return result;
+    }
+
+    CheckResult CheckRejectedImages()
+    {
+        CheckResult result{ .name = L"Conversion rejections" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        const auto odd = MakeImage(5, 4, SourceFormat::Bgr24);
+        const auto oddHeight = MakeImage(4, 3, SourceFormat::Bgr24);
+        for (const auto format : { TargetFormat::Nv12, TargetFormat::I420, TargetFormat::Yuy2 })
+        {
+            check(ConvertImage(odd, format, true).empty());
+        }
+
+        check(ConvertImage(oddHeight, TargetFormat::Nv12, true).empty());
+        check(ConvertImage(oddHeight, TargetFormat::I420, true).empty());
+        check(!ConvertImage(oddHeight, TargetFormat::Yuy2, true).empty());
+        check(!ConvertImage(odd, TargetFormat::Rgb32, true).empty());
+
+        const auto image = MakeImage(8, 8, SourceFormat::Bgr24);
+        std::vector<uint8_t> frame(FrameSize(TargetFormat::Nv12, 8, 8) - 1);
+        check(!Convert(image.pixels.data(), image.stride, image.format, 8, 8, TargetFormat::Nv12, frame.data(), frame.size()));
+        frame.resize(FrameSize(TargetFormat::Nv12, 8, 8));
+        check(!Convert(image.pixels.data(), image.stride - 1, image.format, 8, 8, TargetFormat::Nv12, frame.data(), frame.size()));
+        check(!Convert(nullptr, image.stride, image.format, 8, 8, TargetFormat::Nv12, frame.data(), frame.size()));
+        return result;
+    }
+
+    constexpr int64_t MinimalFps = 29;
+    constexpr int64_t Fps30 = 333333;
+    constexpr int64_t Fps15 = 666666;
+
+    MediaTypeOffer Offer(const SubTypePriority priority, const int64_t avgFrameTime, const long width, const long height)
+    {
+        return MediaTypeOffer{ .priority = priority, .avgFrameTime = avgFrameTime, .width = width, .height = height };
+    }
+
+    // How the capture device selected the media type when it only negotiated YUY2, MJPG and RGB24
+    std::optional<size_t> SelectOriginalOffer(const std::vector<MediaTypeOffer>& offers)
+    {
+        std::optional<size_t> selected;
+        int64_t avgFrameTime = std::numeric_limits<int64_t>::max();
+        long width = 0;
+        long height = 0;
+        for (size_t i = 0; i < offers.size(); ++i)
+        {
+            const auto& offer = offers[i];
+            if (offer.avgFrameTime > avgFrameTime || 10000000LL / offer.avgFrameTime < MinimalFps)
+            {
+                continue;
+            }
+
+            if (offer.width < width || offer.height < height || offer.priority != SubTypePriority::Original)
+            {
+                continue;
+            }
+
+            selected = i;
+            avgFrameTime = offer.avgFrameTime;
+            width = offer.width;
+            height = offer.height;
+        }
+
+        return selected;
+    }
+
+    // Cameras offering MJPG, YUY2 or RGB24 keep the media type they were opened with before NV12, I420 and RGB32 were
+    // negotiated, the others are opened with the best of those
+    CheckResult CheckMediaTypeSelection(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"Media type selection" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        const auto original = SubTypePriority::Original;
+        const auto converted = SubTypePriority::Converted;
+        const auto unsupported = SubTypePriority::Unsupported;
+
+        // MJPG and NV12 at the same resolution and rate, in both orders
+        check(SelectMediaTypeOffer({ Offer(original, Fps30, 1920, 1080), Offer(converted, Fps30, 1920, 1080) }, MinimalFps) == 0);
+        check(SelectMediaTypeOffer({ Offer(converted, Fps30, 1920, 1080), Offer(original, Fps30, 1920, 1080) }, MinimalFps) == 1);
+        // A larger NV12 doesn't replace MJPG
+        check(SelectMediaTypeOffer({ Offer(original, Fps30, 1280, 720), Offer(converted, Fps30, 1920, 1080) }, MinimalFps) == 0);
+        // Without a usable MJPG, the best NV12 is selected
+        check(SelectMediaTypeOffer({ Offer(original, Fps15, 1920, 1080), Offer(converted, Fps30, 1280, 720), Offer(converted, Fps30, 1920, 1080) }, MinimalFps) == 2);
+        check(SelectMediaTypeOffer({ Offer(converted, Fps30, 1920, 1080), Offer(converted, Fps15, 3840, 2160) }, MinimalFps) == 0);
+        check(!SelectMediaTypeOffer({ Offer(unsupported, Fps30, 1920, 1080), Offer(converted, Fps15, 1920, 1080) }, MinimalFps));
+        check(!SelectMediaTypeOffer({}, MinimalFps));
+
+        // Random cameras: whenever the original selection found a media type, it's still the one selected
+        std::mt19937 random{ seed };
+        constexpr std::array<int64_t, 4> frameTimes = { Fps30 / 2, Fps30, 400000, Fps15 };
+        constexpr std::array<std::pair<long, long>, 4> sizes = { { { 640, 480 }, { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } } };
+        bool kept = true;
+        bool convertedUsed = true;
+        for (int camera = 0; camera < 2000; ++camera)
+        {
+            std::vector<MediaTypeOffer> offers(std::uniform_int_distribution<size_t>{ 1, 12 }(random));
+            for (auto& offer : offers)
+            {
+                const auto& [width, height] = sizes[std::uniform_int_distribution<size_t>{ 0, sizes.size() - 1 }(random)];
+                offer = Offer(static_cast<SubTypePriority>(std::uniform_int_distribution<int>{ 0, 2 }(random)),
+                              frameTimes[std::uniform_int_distribution<size_t>{ 0, frameTimes.size() - 1 }(random)],
+                              width,
+                              height);
+            }
+
+            const auto selected = SelectMediaTypeOffer(offers, MinimalFps);
+            if (const auto previous = SelectOriginalOffer(offers))
+            {
+                kept = kept && selected == previous;
+                continue;
+            }
+
+            // Otherwise it's a converted subtype when any of them is fast enough
+            const bool anyConverted = std::any_of(offers.begin(), offers.end(), [](const MediaTypeOffer& offer) {
+                return offer.priority == SubTypePriority::Converted && 10000000LL / offer.avgFrameTime >= MinimalFps;
+            });
+            convertedUsed = convertedUsed && (selected.has_value() == anyConverted) &&
+                            (!selected || offers[*selected].priority == SubTypePriority::Converted);
+        }
+
+        check(kept);
+        check(convertedUsed);
+        return result;
+    }
+}
+
+namespace VideoConferenceBenchmark
+{
+    std::vector<CheckResult> RunColorConversionChecks(const unsigned int seed)
+    {
+        return { CheckGoldenColors(), CheckRandomImages(seed), CheckRejectedImages(), CheckMediaTypeSelection(seed) };
+    }
+
+    std::vector<ColorConversionResult> RunColorConversionBenchmark(const std::chrono::milliseconds duration, const unsigned int seed)
+    {
+        constexpr std::array<std::pair<uint32_t, uint32_t>, 4> resolutions = {
+            { { 640, 480 }, { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } }
+        };
+
+        std::vector<ColorConversionResult> results;
+        std::mt19937 random{ seed };
+        for (const auto& [width, height] : resolutions)
+        {
+            // A smooth gradient with noise, like a photo
+            auto image = MakeImage(width, height, SourceFormat::Bgr24);
+            std::uniform_int_distribution<int> noise{ -8, 8 };
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    const int base = static_cast<int>((x * 255) / width + (y * 255) / height) / 2;
+                    uint8_t* pixel = image.Pixel(x, y);
+                    for (int channel = 0; channel < 3; ++channel)
+                    {
+                        pixel[channel] = static_cast<uint8_t>(std::clamp(base + channel * 20 + noise(random), 0, 255));
+                    }
+                }
+            }
+
+            for (const auto format : targetFormats)
+            {
+                std::vector<uint8_t> frame(FrameSize(format, width, height));
+                for (const bool simd : { true, false })
+                {
+                    size_t frames = 0;
+                    const auto start = Clock::now();
+                    auto elapsed = Clock::duration::zero();
+                    while (frames < 3 || elapsed < duration)
+                    {
+                        Convert(image.pixels.data(), image.stride, image.format, width, height, format, frame.data(), frame.size(), simd);
+                        ++frames;
+                        elapsed = Clock::now() - start;
+                    }
+
+                    const double ms = std::chrono::duration<double, std::milli>(elapsed).count() / static_cast<double>(frames);
+                    results.push_back({ .format = FormatName(format),
+                                        .path = simd ? L"SIMD" : L"Scalar",
+                                        .width = width,
+                                        .height = height,
+                                        .frames = frames,
+                                        .msPerFrame = ms,
+                                        .megapixelsPerSecond = static_cast<double>(width) * height / (ms * 1000.0) });
+                }
+            }
+        }
+
+        return results;
+    }
+}
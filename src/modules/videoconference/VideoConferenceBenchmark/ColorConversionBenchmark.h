@@ -0,0 +1,27 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+namespace VideoConferenceBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Golden colors and layouts of every target format, SIMD against scalar conversions of random images, the images
+    // which can't be converted, and the capture media types selected now that these formats are negotiated
+    std::vector<CheckResult> RunColorConversionChecks(unsigned int seed);
+
+    struct ColorConversionResult
+    {
+        std::wstring format;
+        std::wstring path;
+        uint32_t width = {};
+        uint32_t height = {};
+        size_t frames = {};
+        double msPerFrame = {};
+        double megapixelsPerSecond = {};
+    };
+
+    // Converts BGR images, as WIC decodes them, into every target format at resolutions up to 4K, for each case for at
+    // least the duration
+    std::vector<ColorConversionResult> RunColorConversionBenchmark(std::chrono::milliseconds duration, unsigned int seed);
+}
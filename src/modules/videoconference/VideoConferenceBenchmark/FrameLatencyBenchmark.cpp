@@ -0,0 +1,341 @@
+#include "pch.h"
+#include "FrameLatencyBenchmark.h"
+
+#include <cstring>
+#include <ctime>
+
+#include <CameraStateUpdateChannels.h>
+#include <FrameWorker.h>
+#include <OverlayDelivery.h>
+
+namespace
+{
+    using namespace VideoConferenceBenchmark;
+    using Clock = std::chrono::steady_clock;
+
+    // Distinct from every sequence number the camera writes into its frames
+    constexpr uint64_t overlayMarker = 0xEEEE'EEEE'EEEE'EEEEull;
+    constexpr size_t overlayPoolBuffers = 3;
+
+    enum class Delivery
+    {
+        Passthrough,
+        MutedOverwrite,
+        MutedPool,
+    };
+
+    const wchar_t* DeliveryName(const Delivery delivery)
+    {
+        switch (delivery)
+        {
+        case Delivery::Passthrough:
+            return L"Passthrough";
+        case Delivery::MutedOverwrite:
+            return L"Overwrite";
+        case Delivery::MutedPool:
+            return L"Pool";
+        }
+
+        return L"";
+    }
+
+    std::chrono::nanoseconds ThreadCpuTime()
+    {
+#if defined(_WIN32)
+        FILETIME creation{}, exited{}, kernel{}, user{};
+        GetThreadTimes(GetCurrentThread(), &creation, &exited, &kernel, &user);
+        const auto ticks = [](const FILETIME& time) {
+            return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+        };
+        return std::chrono::nanoseconds{ (ticks(kernel) + ticks(user)) * 100 };
+#else
+        timespec time{};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return std::chrono::seconds{ time.tv_sec } + std::chrono::nanoseconds{ time.tv_nsec };
+#endif
+    }
+
+    struct DeliveredFrame
+    {
+        uint64_t sequence = 0;
+        bool muted = false;
+        // The frame starts with the overlay if muted, and with the camera's sequence number otherwise
+        bool contentMatches = false;
+        double latencyUs = 0;
+    };
+
+    // The frame path of the proxy filter on a synthetic camera: FrameWorker hands the frames to the worker thread,
+    // which syncs the settings from the versioned channel, overwrites the muted frames with the overlay, from the overlay
+    // pool or into the camera frame, and delivers them downstream
+    class ProxyHarness
+    {
+    public:
+        ProxyHarness(const CameraOptions& camera, const Delivery delivery) :
+            _delivery{ delivery },
+            _camera{ camera, [this](SyntheticFramePtr frame) { _frames.Post(std::move(frame)); } }
+        {
+            _overlay.assign(FramePayloadSize(camera.format, camera.width, camera.height) * 2 / 3, static_cast<uint8_t>(0x10));
+            std::memcpy(_overlay.data(), &overlayMarker, sizeof(overlayMarker));
+            for (size_t i = 0; i < overlayPoolBuffers; ++i)
+            {
+                _pool.emplace_back(FrameBufferSize(camera.format, camera.width, camera.height));
+                _freePoolBuffers.push_back(i);
+            }
+
+            SetMuted(delivery != Delivery::Passthrough);
+        }
+
+        void SetMuted(const bool muted)
+        {
+            _channel.settings.update([muted](CameraSettings& settings) { settings.useOverlayImage = muted; });
+        }
+
+        void Start()
+        {
+            _worker = std::thread{ [this] {
+                const auto cpuStart = ThreadCpuTime();
+                _frames.Run(_processingMutex, [this](SyntheticFramePtr& frame) { Process(*frame); });
+                _workerCpu = ThreadCpuTime() - cpuStart;
+            } };
+            _camera.Start();
+        }
+
+        void Stop()
+        {
+            _camera.Stop();
+            _frames.Stop();
+            _worker.join();
+        }
+
+        FrameLatencyResult Result(const CameraOptions& camera) const
+        {
+            const auto stats = _frames.Stats();
+            FrameLatencyResult result{ DeliveryName(_delivery), camera };
+            result.captured = _camera.Captured();
+            result.delivered = _delivered.size();
+            result.replaced = stats.dropped;
+            result.skipped = _camera.Skipped();
+
+            std::vector<double> latencies;
+            for (const auto& frame : _delivered)
+            {
+                latencies.push_back(frame.latencyUs);
+            }
+
+            std::sort(latencies.begin(), latencies.end());
+            if (!latencies.empty())
+            {
+                result.p50Us = latencies[latencies.size() / 2];
+                result.p99Us = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+                result.maxUs = latencies.back();
+                result.cpuUsPerFrame = std::chrono::duration<double, std::micro>(_workerCpu).count() / static_cast<double>(latencies.size());
+            }
+
+            return result;
+        }
+
+        const std::vector<DeliveredFrame>& Delivered() const
+        {
+            return _delivered;
+        }
+
+    private:
+        void Process(SyntheticFrame& frame)
+        {
+            _channel.settings.read_if_changed(_settingsGeneration, _settings);
+
+            const uint8_t* data = frame.data.data();
+            std::optional<size_t> poolBuffer;
+            if (_settings.useOverlayImage)
+            {
+                if (_delivery == Delivery::MutedPool && !_freePoolBuffers.empty())
+                {
+                    poolBuffer = _freePoolBuffers.back();
+                    _freePoolBuffers.pop_back();
+                    auto& buffer = _pool[*poolBuffer];
+                    if (!_poolBuffers.Held(buffer.data(), 1))
+                    {
+                        std::memcpy(buffer.data(), _overlay.data(), _overlay.size());
+                        _poolBuffers.Written(buffer.data(), 1, _overlay.size());
+                    }
+
+                    data = buffer.data();
+                }
+                else
+                {
+                    std::memcpy(frame.data.data(), _overlay.data(), _overlay.size());
+                    frame.length = _overlay.size();
+                }
+            }
+
+            Receive(frame, data);
+            if (poolBuffer)
+            {
+                _freePoolBuffers.push_back(*poolBuffer);
+            }
+        }
+
+        void Receive(const SyntheticFrame& frame, const uint8_t* data)
+        {
+            const auto received = Clock::now();
+            uint64_t head = 0;
+            std::memcpy(&head, data, sizeof(head));
+            const bool muted = _settings.useOverlayImage;
+            _delivered.push_back(DeliveredFrame{ frame.sequence,
+                                                 muted,
+                                                 head == (muted ? overlayMarker : frame.sequence),
+                                                 std::chrono::duration<double, std::micro>(received - frame.captured).count() });
+        }
+
+        Delivery _delivery;
+        CameraSettingsUpdateChannel _channel;
+        uint32_t _settingsGeneration = VersionedChannel<CameraSettings>::UNREAD;
+        CameraSettings _settings;
+        std::vector<uint8_t> _overlay;
+        std::vector<std::vector<uint8_t>> _pool;
+        std::vector<size_t> _freePoolBuffers;
+        OverlayBufferTracker _poolBuffers;
+        std::vector<DeliveredFrame> _delivered;
+        std::chrono::nanoseconds _workerCpu{};
+
+        std::mutex _processingMutex;
+        FrameWorker<SyntheticFramePtr> _frames;
+        SyntheticCamera _camera;
+        std::thread _worker;
+    };
+
+    CheckResult CheckFrameWorker()
+    {
+        CheckResult result{ .name = L"Frame worker handoff" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        // Frames count how many of them are alive, so frames which are never released are noticed
+        std::atomic<int> alive = 0;
+        const auto makeFrame = [&alive](const uint64_t sequence) {
+            ++alive;
+            return SyntheticFramePtr{ new SyntheticFrame{ .sequence = sequence }, [&alive](SyntheticFrame* frame) {
+                                         --alive;
+                                         delete frame;
+                                     } };
+        };
+
+        FrameWorker<SyntheticFramePtr> frames;
+        std::mutex processingMutex;
+        std::vector<uint64_t> processed;
+        std::thread worker{ [&] {
+            frames.Run(processingMutex, [&processed](SyntheticFramePtr& frame) { processed.push_back(frame->sequence); });
+        } };
+
+        // While a frame is processed, the worker takes at most one of the frames posted, and the last one posted is
+        // processed next
+        {
+            std::unique_lock lock{ processingMutex };
+            for (uint64_t sequence = 1; sequence <= 10; ++sequence)
+            {
+                frames.Post(makeFrame(sequence));
+                std::this_thread::yield();
+            }
+        }
+
+        const auto deadline = Clock::now() + std::chrono::seconds{ 5 };
+        while ((frames.Stats().processed + frames.Stats().dropped < 10 || alive != 0) && Clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+        }
+
+        auto stats = frames.Stats();
+        {
+            std::unique_lock lock{ processingMutex };
+            check(!processed.empty() && processed.size() <= 2 && processed.back() == 10);
+            check(std::is_sorted(processed.begin(), processed.end()));
+        }
+
+        check(stats.posted == 10);
+        check(stats.processed + stats.dropped == 10);
+        check(alive == 0);
+
+        // Frames posted after Stop() are released
+        frames.Stop();
+        worker.join();
+        frames.Post(makeFrame(11));
+        stats = frames.Stats();
+        check(stats.posted == 11);
+        check(stats.processed + stats.dropped == 11);
+        check(alive == 0);
+
+        FrameWorker<SyntheticFramePtr> stopped;
+        stopped.Post(makeFrame(1));
+        check(alive == 1);
+        stopped.Stop();
+        check(alive == 0);
+        check(stopped.Stats().dropped == 1);
+        return result;
+    }
+
+    CheckResult CheckHarnessDelivery()
+    {
+        CheckResult result{ .name = L"Frame harness delivery" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        CameraOptions camera{ CameraFormat::Nv12, 320, 240, 120 };
+        for (const auto delivery : { Delivery::MutedOverwrite, Delivery::MutedPool })
+        {
+            ProxyHarness harness{ camera, delivery };
+            harness.SetMuted(false);
+            harness.Start();
+            for (int i = 0; i < 4; ++i)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+                harness.SetMuted(i % 2 == 0);
+            }
+            harness.Stop();
+
+            size_t muted = 0;
+            size_t unmuted = 0;
+            for (const auto& frame : harness.Delivered())
+            {
+                check(frame.contentMatches);
+                (frame.muted ? muted : unmuted)++;
+            }
+
+            check(muted > 0 && unmuted > 0);
+            const auto counts = harness.Result(camera);
+            check(counts.delivered + counts.replaced == counts.captured);
+        }
+
+        return result;
+    }
+}
+
+namespace VideoConferenceBenchmark
+{
+    std::vector<CheckResult> RunFrameLatencyChecks()
+    {
+        return { CheckFrameWorker(), CheckHarnessDelivery() };
+    }
+
+    std::vector<FrameLatencyResult> RunFrameLatencyBenchmark(const std::vector<CameraOptions>& cameras,
+                                                             const std::chrono::milliseconds duration)
+    {
+        std::vector<FrameLatencyResult> results;
+        for (const auto& camera : cameras)
+        {
+            for (const auto delivery : { Delivery::Passthrough, Delivery::MutedOverwrite, Delivery::MutedPool })
+            {
+                ProxyHarness harness{ camera, delivery };
+                harness.Start();
+                std::this_thread::sleep_for(duration);
+                harness.Stop();
+                results.push_back(harness.Result(camera));
+            }
+        }
+
+        return results;
+    }
+}
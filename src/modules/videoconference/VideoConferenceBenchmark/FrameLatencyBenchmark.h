@@ -0,0 +1,36 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+#include "SyntheticCamera.h"
+
+namespace VideoConferenceBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Handoff of the frames to the worker of the proxy filter, and the content of the frames the harness delivers while
+    // the camera is muted and unmuted
+    std::vector<CheckResult> RunFrameLatencyChecks();
+
+    struct FrameLatencyResult
+    {
+        std::wstring delivery;
+        CameraOptions camera;
+        uint64_t captured = {};
+        uint64_t delivered = {};
+        // Replaced by a newer frame before the worker took them
+        uint64_t replaced = {};
+        // Not captured because the downstream side held all camera buffers
+        uint64_t skipped = {};
+        double p50Us = {};
+        double p99Us = {};
+        double maxUs = {};
+        // CPU time of the worker thread
+        double cpuUsPerFrame = {};
+    };
+
+    // Frames of a synthetic camera through the frame path of the proxy filter, passed through, and overwritten with the
+    // overlay as the filter did before and from the overlay pool. The latency is the one the filter adds, from the
+    // capture until the downstream filter receives the frame.
+    std::vector<FrameLatencyResult> RunFrameLatencyBenchmark(const std::vector<CameraOptions>& cameras,
+                                                             std::chrono::milliseconds duration);
+}
@@ -0,0 +1,545 @@
+#include "pch.h"
+#include "HotkeyBenchmark.h"
+
+#include <array>
+#include <bit>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include <HotkeyMatcher.h>
+
+namespace
+{
+    using namespace VideoConferenceBenchmark;
+    using Clock = std::chrono::steady_clock;
+    namespace Vk = ModifierVirtualKeys;
+
+    // As in VideoConferenceModule.h
+    enum class HotkeyAction : uint8_t
+    {
+        None,
+        MuteCameraAndMicrophone,
+        MuteMicrophone,
+        PushToTalk,
+        MuteCamera,
+    };
+
+    constexpr uint32_t backKey = 0x08;
+    constexpr uint32_t tabKey = 0x09;
+    constexpr uint32_t returnKey = 0x0D;
+    constexpr uint32_t spaceKey = 0x20;
+    constexpr uint32_t leftKey = 0x25;
+    constexpr uint32_t f9Key = 0x78;
+
+    struct Hotkey
+    {
+        bool win = false;
+        bool ctrl = false;
+        bool alt = false;
+        bool shift = false;
+        uint32_t code = 0;
+        HotkeyAction action = HotkeyAction::None;
+    };
+
+    // The defaults of VideoConferenceSettings, in the order of their priority
+    const std::vector<Hotkey> defaultHotkeys = {
+        { true, false, false, true, 'Q', HotkeyAction::MuteCameraAndMicrophone },
+        { true, false, false, true, 'A', HotkeyAction::MuteMicrophone },
+        { true, false, false, true, 'I', HotkeyAction::PushToTalk },
+        { true, false, false, true, 'O', HotkeyAction::MuteCamera },
+    };
+
+    // Rebound hotkeys, two of them to the same keys and one unset
+    const std::vector<Hotkey> reboundHotkeys = {
+        { false, true, true, false, 'M', HotkeyAction::MuteCameraAndMicrophone },
+        { false, true, true, false, 'M', HotkeyAction::MuteMicrophone },
+        { false, false, false, false, f9Key, HotkeyAction::PushToTalk },
+        { false, false, false, false, 0, HotkeyAction::MuteCamera },
+    };
+
+    uint8_t HotkeyMask(const Hotkey& hotkey)
+    {
+        uint8_t modifiers = 0;
+        modifiers |= hotkey.shift ? HotkeyModifiers::Shift : 0;
+        modifiers |= hotkey.ctrl ? HotkeyModifiers::Control : 0;
+        modifiers |= hotkey.win ? HotkeyModifiers::Win : 0;
+        modifiers |= hotkey.alt ? HotkeyModifiers::Alt : 0;
+        return modifiers;
+    }
+
+    // The keys held down as the system sees them, answering key state queries like GetKeyState
+    class SimulatedKeyboard
+    {
+    public:
+        void Apply(const KeyEvent& event)
+        {
+            const uint8_t bit = ModifierKeys::key_bit(event.vk);
+            const uint32_t vk = bit ? ModifierKeys::KEYS[std::countr_zero(bit)] : event.vk;
+            _down[vk & 0xFF] = event.down;
+        }
+
+        bool Pressed(const uint32_t vk) const
+        {
+            ++_queries;
+            switch (vk)
+            {
+            case Vk::Shift:
+                return _down[Vk::LeftShift] || _down[Vk::RightShift];
+            case Vk::Control:
+                return _down[Vk::LeftControl] || _down[Vk::RightControl];
+            case Vk::Menu:
+                return _down[Vk::LeftMenu] || _down[Vk::RightMenu];
+            }
+
+            return _down[vk & 0xFF];
+        }
+
+        // What the module reads to resync the tracked modifier keys
+        uint8_t KeysDown() const
+        {
+            uint8_t keysDown = 0;
+            for (const auto key : ModifierKeys::KEYS)
+            {
+                if (Pressed(key))
+                {
+                    keysDown |= ModifierKeys::key_bit(key);
+                }
+            }
+
+            return keysDown;
+        }
+
+        uint64_t Queries() const
+        {
+            return _queries;
+        }
+
+    private:
+        std::array<bool, 256> _down{};
+        mutable uint64_t _queries = 0;
+    };
+
+    // The hotkey matching of the hook before: HotkeyObject keeps a hotkey in a JSON object, so every accessor looks a
+    // value up by name, and every hotkey whose key was pressed asks for the state of four modifiers
+    class LegacyMatcher
+    {
+    public:
+        explicit LegacyMatcher(const std::vector<Hotkey>& hotkeys)
+        {
+            for (const auto& hotkey : hotkeys)
+            {
+                _hotkeys.push_back({ { { L"win", hotkey.win },
+                                       { L"ctrl", hotkey.ctrl },
+                                       { L"alt", hotkey.alt },
+                                       { L"shift", hotkey.shift },
+                                       { L"code", static_cast<double>(hotkey.code) } },
+                                     hotkey.action });
+            }
+        }
+
+        void OnKey(const KeyEvent&)
+        {
+        }
+
+        HotkeyAction Match(const uint32_t vk, const SimulatedKeyboard& keyboard)
+        {
+            for (const auto& hotkey : _hotkeys)
+            {
+                if (IsHotkeyPressed(vk, hotkey.values, keyboard))
+                {
+                    return hotkey.action;
+                }
+            }
+
+            return HotkeyAction::None;
+        }
+
+        uint64_t Lookups() const
+        {
+            return _lookups;
+        }
+
+    private:
+        using Values = std::map<std::wstring, double>;
+
+        struct JsonHotkey
+        {
+            Values values;
+            HotkeyAction action;
+        };
+
+        double Get(const Values& values, const wchar_t* name)
+        {
+            ++_lookups;
+            return values.find(name)->second;
+        }
+
+        bool IsHotkeyPressed(const uint32_t vk, const Values& hotkey, const SimulatedKeyboard& keyboard)
+        {
+            return vk == static_cast<uint32_t>(Get(hotkey, L"code")) &&
+                   keyboard.Pressed(Vk::Shift) == (Get(hotkey, L"shift") != 0) &&
+                   keyboard.Pressed(Vk::Control) == (Get(hotkey, L"ctrl") != 0) &&
+                   keyboard.Pressed(Vk::LeftWin) == (Get(hotkey, L"win") != 0) &&
+                   keyboard.Pressed(Vk::LeftMenu) == (Get(hotkey, L"alt") != 0);
+        }
+
+        std::vector<JsonHotkey> _hotkeys;
+        uint64_t _lookups = 0;
+    };
+
+    class TableMatcher
+    {
+    public:
+        explicit TableMatcher(const std::vector<Hotkey>& hotkeys)
+        {
+            Compile(hotkeys);
+        }
+
+        void Compile(const std::vector<Hotkey>& hotkeys)
+        {
+            _table.clear();
+            for (const auto& hotkey : hotkeys)
+            {
+                _table.add(hotkey.code, HotkeyMask(hotkey), hotkey.action);
+            }
+        }
+
+        void OnKey(const KeyEvent& event)
+        {
+            _table.on_key(event.vk, event.down);
+        }
+
+        HotkeyAction Match(const uint32_t vk, const SimulatedKeyboard& keyboard)
+        {
+            return _table.match(vk, [&keyboard] { return keyboard.KeysDown(); });
+        }
+
+        uint64_t Lookups() const
+        {
+            return 0;
+        }
+
+        HotkeyMatcher<HotkeyAction>& Table()
+        {
+            return _table;
+        }
+
+    private:
+        HotkeyMatcher<HotkeyAction> _table;
+    };
+
+    CheckResult CheckReplay(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"Hotkey replay" };
+        const auto events = SynthesizeKeystrokes(20000, seed);
+        for (const auto& hotkeys : { defaultHotkeys, reboundHotkeys })
+        {
+            SimulatedKeyboard keyboard;
+            LegacyMatcher legacy{ hotkeys };
+            TableMatcher table{ hotkeys };
+            size_t matches = 0;
+            for (const auto& event : events)
+            {
+                keyboard.Apply(event);
+                table.OnKey(event);
+                if (event.down)
+                {
+                    const auto expected = legacy.Match(event.vk, keyboard);
+                    result.cases++;
+                    result.failures += table.Match(event.vk, keyboard) == expected ? 0 : 1;
+                    matches += expected != HotkeyAction::None ? 1 : 0;
+                }
+            }
+
+            // The stream presses the hotkeys
+            result.cases++;
+            result.failures += matches > 0 ? 0 : 1;
+        }
+
+        return result;
+    }
+
+    CheckResult CheckTable()
+    {
+        CheckResult result{ .name = L"Hotkey table" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        constexpr uint8_t winShift = HotkeyModifiers::Win | HotkeyModifiers::Shift;
+        TableMatcher table{ defaultHotkeys };
+        check(table.Table().find('O', winShift) == HotkeyAction::MuteCamera);
+        check(table.Table().find('O', HotkeyModifiers::Win) == HotkeyAction::None);
+        check(table.Table().find('P', winShift) == HotkeyAction::None);
+
+        // Rebuilt when the settings change
+        auto hotkeys = defaultHotkeys;
+        hotkeys[3].code = 'P';
+        table.Compile(hotkeys);
+        check(table.Table().find('O', winShift) == HotkeyAction::None);
+        check(table.Table().find('P', winShift) == HotkeyAction::MuteCamera);
+
+        // The first hotkey bound to the keys wins, and unset hotkeys bind nothing
+        table.Compile(reboundHotkeys);
+        check(table.Table().find('M', HotkeyModifiers::Control | HotkeyModifiers::Alt) == HotkeyAction::MuteCameraAndMicrophone);
+        check(table.Table().find(0, 0) == HotkeyAction::None);
+        table.Table().add(0x1FF, 0, HotkeyAction::MuteCamera);
+        check(table.Table().find(0x1FF, 0) == HotkeyAction::None);
+
+        // Either Shift key and the generic one count, the right Windows key doesn't
+        check(ModifierKeys::mask(ModifierKeys::key_bit(Vk::RightShift)) == HotkeyModifiers::Shift);
+        check(ModifierKeys::key_bit(Vk::Shift) == ModifierKeys::key_bit(Vk::LeftShift));
+        check(ModifierKeys::mask(ModifierKeys::key_bit(Vk::RightWin)) == 0);
+        check(ModifierKeys::key_bit('A') == 0);
+        return result;
+    }
+
+    CheckResult CheckResync()
+    {
+        CheckResult result{ .name = L"Hotkey modifier resync" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        SimulatedKeyboard keyboard;
+        TableMatcher table{ defaultHotkeys };
+        const auto both = [&](const uint32_t vk, const bool down) {
+            keyboard.Apply({ vk, down });
+            table.OnKey({ vk, down });
+        };
+        const auto press = [&](const uint32_t vk) {
+            both(vk, true);
+            const auto action = table.Match(vk, keyboard);
+            both(vk, false);
+            return action;
+        };
+
+        // Typing the keys of the hotkeys, or other keys with modifiers, never asks for the key state
+        both(Vk::LeftControl, true);
+        check(press('C') == HotkeyAction::None);
+        both(Vk::LeftControl, false);
+        check(press('A') == HotkeyAction::None);
+        check(keyboard.Queries() == 0);
+
+        // A hotkey is confirmed once, also while its key repeats
+        both(Vk::LeftWin, true);
+        both(Vk::RightShift, true);
+        both('A', true);
+        check(table.Match('A', keyboard) == HotkeyAction::MuteMicrophone);
+        both('A', true);
+        check(table.Match('A', keyboard) == HotkeyAction::MuteMicrophone);
+        both('A', false);
+        check(keyboard.Queries() == std::size(ModifierKeys::KEYS));
+        check(press('A') == HotkeyAction::MuteMicrophone);
+        check(keyboard.Queries() == 2 * std::size(ModifierKeys::KEYS));
+        both(Vk::RightShift, false);
+
+        // The hook missed the Windows key up, e.g. as the session was locked
+        keyboard.Apply({ Vk::LeftWin, false });
+        both(Vk::LeftShift, true);
+        check(press('A') == HotkeyAction::None);
+        check(table.Table().stats().resyncs == 1);
+        both(Vk::LeftShift, false);
+
+        // The hook missed a Control key up, and then the hotkey is pressed
+        both(Vk::RightControl, true);
+        keyboard.Apply({ Vk::RightControl, false });
+        both(Vk::LeftWin, true);
+        both(Vk::LeftShift, true);
+        check(press('O') == HotkeyAction::MuteCamera);
+        check(table.Table().stats().resyncs == 2);
+        both(Vk::LeftShift, false);
+        both(Vk::LeftWin, false);
+
+        // The hook is installed while the modifiers are held
+        keyboard.Apply({ Vk::LeftWin, true });
+        keyboard.Apply({ Vk::LeftShift, true });
+        TableMatcher installed{ defaultHotkeys };
+        installed.Table().resync(keyboard.KeysDown());
+        keyboard.Apply({ 'Q', true });
+        check(installed.Match('Q', keyboard) == HotkeyAction::MuteCameraAndMicrophone);
+        check(installed.Table().stats().resyncs == 0);
+        return result;
+    }
+
+    template<typename Matcher>
+    HotkeyResult Replay(const wchar_t* name,
+                        const std::vector<KeyEvent>& events,
+                        const uint32_t rounds,
+                        Matcher& matcher)
+    {
+        SimulatedKeyboard keyboard;
+        uint64_t matches = 0;
+        const auto start = Clock::now();
+        for (uint32_t round = 0; round < rounds; ++round)
+        {
+            for (const auto& event : events)
+            {
+                keyboard.Apply(event);
+                matcher.OnKey(event);
+                if (event.down && matcher.Match(event.vk, keyboard) != HotkeyAction::None)
+                {
+                    ++matches;
+                }
+            }
+        }
+
+        const auto elapsed = Clock::now() - start;
+        const auto total = static_cast<double>(events.size()) * rounds;
+        HotkeyResult result{ name };
+        result.events = events.size() * rounds;
+        result.matches = matches;
+        result.nsPerEvent = std::chrono::duration<double, std::nano>(elapsed).count() / total;
+        result.keyStatesPerEvent = static_cast<double>(keyboard.Queries()) / total;
+        result.settingsLookupsPerEvent = static_cast<double>(matcher.Lookups()) / total;
+        return result;
+    }
+}
+
+namespace VideoConferenceBenchmark
+{
+    std::vector<KeyEvent> SynthesizeKeystrokes(const size_t events, const unsigned int seed)
+    {
+        std::mt19937 random{ seed };
+        const auto pick = [&random](const auto& keys) {
+            return keys[std::uniform_int_distribution<size_t>{ 0, std::size(keys) - 1 }(random)];
+        };
+
+        std::vector<KeyEvent> stream;
+        const auto tap = [&stream](const uint32_t vk, const size_t repeats = 1) {
+            for (size_t i = 0; i < repeats; ++i)
+            {
+                stream.push_back({ vk, true });
+            }
+
+            stream.push_back({ vk, false });
+        };
+        const auto chord = [&stream, &tap](const std::vector<uint32_t>& modifiers, const uint32_t vk, const size_t repeats = 1) {
+            for (const auto modifier : modifiers)
+            {
+                stream.push_back({ modifier, true });
+            }
+
+            tap(vk, repeats);
+            for (auto modifier = modifiers.rbegin(); modifier != modifiers.rend(); ++modifier)
+            {
+                stream.push_back({ *modifier, false });
+            }
+        };
+
+        constexpr char letters[] = "ETAOINSHRDLUCMFWYPVBGKQJXZ";
+        constexpr uint32_t shortcuts[] = { 'C', 'V', 'Z', 'S', 'A', 'X' };
+        constexpr uint32_t winShortcuts[] = { 'D', 'E', 'R', 'L', 'V' };
+        constexpr uint32_t winShiftShortcuts[] = { 'Q', 'A', 'I', 'O', 'S' };
+        constexpr uint32_t hotkeyKeys[] = { 'Q', 'A', 'I', 'O', 'M', 'S', f9Key };
+        while (stream.size() < events)
+        {
+            const auto kind = random() % 100;
+            if (kind < 62)
+            {
+                tap(random() % 6 == 0 ? spaceKey : static_cast<uint32_t>(letters[random() % (std::size(letters) - 1)]));
+            }
+            else if (kind < 70)
+            {
+                chord({ random() % 2 ? Vk::LeftShift : Vk::RightShift }, letters[random() % (std::size(letters) - 1)]);
+            }
+            else if (kind < 76)
+            {
+                chord({ Vk::LeftControl }, pick(shortcuts));
+            }
+            else if (kind < 79)
+            {
+                chord({ Vk::LeftMenu }, tabKey, 1 + random() % 3);
+            }
+            else if (kind < 84)
+            {
+                tap(random() % 2 ? backKey : leftKey, 1 + random() % 8);
+            }
+            else if (kind < 88)
+            {
+                tap(returnKey);
+            }
+            else if (kind < 93)
+            {
+                chord({ Vk::LeftWin }, pick(winShortcuts));
+            }
+            else if (kind < 97)
+            {
+                // The default hotkeys, push to talk held for a while, and Windows+Shift+S
+                const auto key = pick(winShiftShortcuts);
+                chord({ Vk::LeftWin, Vk::LeftShift }, key, key == 'I' ? 1 + random() % 30 : 1);
+            }
+            else
+            {
+                // Any modifiers with the keys of the hotkeys
+                std::vector<uint32_t> modifiers;
+                for (const auto key : ModifierKeys::KEYS)
+                {
+                    if (random() % 3 == 0)
+                    {
+                        modifiers.push_back(key);
+                    }
+                }
+
+                chord(modifiers, pick(hotkeyKeys));
+            }
+        }
+
+        return stream;
+    }
+
+    std::vector<KeyEvent> LoadKeystrokes(const std::filesystem::path& path)
+    {
+        std::ifstream file{ path };
+        if (!file)
+        {
+            throw std::runtime_error{ "can't open " + path.string() };
+        }
+
+        std::vector<KeyEvent> events;
+        std::string line;
+        for (size_t number = 1; std::getline(file, line); ++number)
+        {
+            std::istringstream fields{ line };
+            std::string code;
+            std::string state;
+            if (!(fields >> code) || code.starts_with('#'))
+            {
+                continue;
+            }
+
+            try
+            {
+                fields >> state;
+                const auto vk = std::stoul(code, nullptr, 0);
+                if (vk == 0 || vk > 0xFF || (state != "down" && state != "up"))
+                {
+                    throw std::invalid_argument{ line };
+                }
+
+                events.push_back({ static_cast<uint32_t>(vk), state == "down" });
+            }
+            catch (const std::logic_error&)
+            {
+                throw std::runtime_error{ path.string() + ":" + std::to_string(number) + ": expected \"<code> down|up\"" };
+            }
+        }
+
+        return events;
+    }
+
+    std::vector<CheckResult> RunHotkeyChecks(const unsigned int seed)
+    {
+        return { CheckReplay(seed), CheckTable(), CheckResync() };
+    }
+
+    std::vector<HotkeyResult> RunHotkeyBenchmark(const std::vector<KeyEvent>& events, const uint32_t rounds)
+    {
+        LegacyMatcher legacy{ defaultHotkeys };
+        TableMatcher table{ defaultHotkeys };
+        return { Replay(L"Key state", events, rounds, legacy), Replay(L"Table", events, rounds, table) };
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <filesystem>
+
+#include <common/utils/benchmark.h>
+
+namespace VideoConferenceBenchmark
+{
+    using benchmark::CheckResult;
+
+    struct KeyEvent
+    {
+        uint32_t vk = 0;
+        bool down = false;
+    };
+
+    // Typing with shortcuts, Alt+Tab, Windows key chords, key repeats and the default hotkeys of the module, as a
+    // recorded keystroke stream would have them
+    std::vector<KeyEvent> SynthesizeKeystrokes(size_t events, unsigned int seed);
+
+    // Reads a recorded keystroke stream with one "<virtual-key code> down|up" event per line, the code in decimal or
+    // with a 0x prefix, and # starting a comment line. Throws std::runtime_error if a line can't be parsed.
+    std::vector<KeyEvent> LoadKeystrokes(const std::filesystem::path& path);
+
+    // The hotkey table and the tracked modifier keys match the same key downs as checking the key state of the
+    // modifiers for every configured hotkey, also when the hook misses a key up of a modifier
+    std::vector<CheckResult> RunHotkeyChecks(unsigned int seed);
+
+    struct HotkeyResult
+    {
+        std::wstring matcher;
+        uint64_t events = {};
+        uint64_t matches = {};
+        double nsPerEvent = {};
+        // Key state and hotkey settings calls per event
+        double keyStatesPerEvent = {};
+        double settingsLookupsPerEvent = {};
+    };
+
+    // The cost of matching every event of the stream in the keyboard hook, with every configured hotkey checked against
+    // the key state as the module did before, and with the hotkey table
+    std::vector<HotkeyResult> RunHotkeyBenchmark(const std::vector<KeyEvent>& events, uint32_t rounds);
+}
@@ -0,0 +1,400 @@
+#include "pch.h"
+#include "LoggingBenchmark.h"
+
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+#include <AsyncLog.h>
+
+namespace
+{
+    using namespace VideoConferenceBenchmark;
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t maxLogSizeMegabytes = 10;
+    const wchar_t verboseFlagFile[] = L"PowerToysVideoConferenceVerbose.flag";
+    // Where both loggers leave the state of the flag file, which the filter checks before logging verbose lines
+    std::atomic_bool verboseIndicatorFilePresent = false;
+
+    struct CheckLine
+    {
+        uint32_t producer = 0;
+        uint64_t index = 0;
+    };
+
+    // Records what the writer passes to it, and blocks its first refresh until the gate opens
+    struct CollectingSink
+    {
+        const std::atomic_bool* gate = nullptr;
+        std::vector<CheckLine> lines;
+        uint64_t droppedLines = 0;
+        size_t batches = 0;
+
+        explicit CollectingSink(const std::atomic_bool* gate = nullptr) :
+            gate{ gate }
+        {
+        }
+
+        void refresh()
+        {
+            while (gate && !gate->load())
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        void write(const std::vector<CheckLine>& batch)
+        {
+            lines.insert(lines.end(), batch.begin(), batch.end());
+            ++batches;
+        }
+
+        void dropped(const uint64_t count)
+        {
+            droppedLines += count;
+        }
+    };
+
+    using CheckWriter = AsyncLogWriter<CheckLine, CollectingSink>;
+
+    // Every producer's lines are written in the order they were logged, and each line at most once
+    bool InOrder(const std::vector<CheckLine>& lines, const size_t producers)
+    {
+        std::vector<std::optional<uint64_t>> last(producers);
+        for (const auto& line : lines)
+        {
+            if (line.producer >= producers || (last[line.producer] && *last[line.producer] >= line.index))
+            {
+                return false;
+            }
+
+            last[line.producer] = line.index;
+        }
+
+        return true;
+    }
+
+    CheckResult CheckLinesWritten(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"Log lines written" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        constexpr size_t producers = 4;
+        constexpr uint64_t linesPerProducer = 20'000;
+        std::mt19937 random{ seed };
+        for (const size_t capacity : { size_t{ 1 } << 17, size_t{ 256 } })
+        {
+            CheckWriter::Options options;
+            options.capacity = capacity;
+            options.flush_interval = std::chrono::milliseconds{ 5 };
+            options.max_batch = 64;
+            CheckWriter writer{ options };
+
+            std::vector<std::thread> threads;
+            for (uint32_t producer = 0; producer < producers; ++producer)
+            {
+                const unsigned int producerSeed = random();
+                threads.emplace_back([&writer, producer, producerSeed] {
+                    std::mt19937 pauses{ producerSeed };
+                    for (uint64_t i = 0; i < linesPerProducer; ++i)
+                    {
+                        writer.log(CheckLine{ producer, i });
+                        if (pauses() % 512 == 0)
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+                });
+            }
+
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            writer.stop();
+            const auto& sink = writer.sink();
+            check(sink.lines.size() + sink.droppedLines == producers * linesPerProducer);
+            check(InOrder(sink.lines, producers));
+            // The ring is large enough for all lines logged before the writer wakes up
+            if (capacity >= producers * linesPerProducer)
+            {
+                check(sink.droppedLines == 0);
+            }
+        }
+
+        return result;
+    }
+
+    CheckResult CheckWriterRestart()
+    {
+        CheckResult result{ .name = L"Log writer restart" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        CheckWriter::Options options;
+        // Nothing is written before stop() unless the ring gets half full
+        options.flush_interval = std::chrono::milliseconds{ 60'000 };
+        CheckWriter writer{ options };
+
+        writer.stop();
+        check(writer.sink().lines.empty());
+
+        for (uint64_t round = 0; round < 3; ++round)
+        {
+            for (uint64_t i = 0; i < 100; ++i)
+            {
+                writer.log(CheckLine{ 0, round * 100 + i });
+            }
+
+            const auto start = Clock::now();
+            writer.stop();
+            check(Clock::now() - start < std::chrono::seconds{ 5 });
+            check(writer.sink().lines.size() == (round + 1) * 100);
+        }
+
+        check(InOrder(writer.sink().lines, 1));
+        check(writer.sink().droppedLines == 0);
+        return result;
+    }
+
+    CheckResult CheckRingFull()
+    {
+        CheckResult result{ .name = L"Log ring full" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        constexpr size_t capacity = 64;
+        constexpr size_t overflow = 10;
+        std::atomic_bool gate = false;
+        CheckWriter::Options options;
+        options.capacity = capacity;
+        options.flush_interval = std::chrono::milliseconds{ 1 };
+        CheckWriter writer{ options, &gate };
+
+        // The writer doesn't pop anything while its first refresh is blocked
+        for (uint64_t i = 0; i < capacity + overflow; ++i)
+        {
+            writer.log(CheckLine{ 0, i });
+        }
+
+        gate = true;
+        writer.stop();
+        const auto& sink = writer.sink();
+        check(sink.lines.size() == capacity);
+        check(sink.droppedLines == overflow);
+        check(!sink.lines.empty() && sink.lines.back().index == capacity - 1);
+        check(InOrder(sink.lines, 1));
+        return result;
+    }
+
+    std::string Prefix(const std::chrono::system_clock::time_point time)
+    {
+        const time_t now = std::chrono::system_clock::to_time_t(time);
+        std::tm tm{};
+#if defined(_WIN32)
+        localtime_s(&tm, &now);
+#else
+        localtime_r(&now, &tm);
+#endif
+        char prefix[64]{};
+        std::strftime(prefix, sizeof(prefix), "[%d.%m %H:%M:%S] ", &tm);
+        return prefix;
+    }
+
+    // What LogToFile did for every line, holding a global mutex: the temp directory, the flag file and the log size
+    // are looked up, and the log is opened, appended to and closed
+    class SynchronousLog
+    {
+    public:
+        explicit SynchronousLog(std::filesystem::path logFilePath) :
+            _logFilePath{ std::move(logFilePath) }
+        {
+        }
+
+        void log(std::wstring what, const bool verbose)
+        {
+            std::error_code _;
+            const auto tempPath = std::filesystem::temp_directory_path(_);
+            if (verbose)
+            {
+                verboseIndicatorFilePresent = std::filesystem::exists(tempPath / verboseFlagFile, _);
+            }
+
+            const auto prefix = Prefix(std::chrono::system_clock::now());
+
+            std::lock_guard lock{ _mutex };
+            const auto logSize = std::filesystem::file_size(_logFilePath, _);
+            if (logSize != static_cast<std::uintmax_t>(-1) && (logSize >> 20) > maxLogSizeMegabytes)
+            {
+                std::filesystem::resize_file(_logFilePath, 0, _);
+            }
+
+            std::wofstream file;
+            file.open(_logFilePath, std::fstream::app);
+            file << prefix.c_str() << what << "\n";
+            file.close();
+        }
+
+    private:
+        std::filesystem::path _logFilePath;
+        std::mutex _mutex;
+    };
+
+    struct FileLine
+    {
+        std::chrono::system_clock::time_point time;
+        std::wstring what;
+    };
+
+    // The writer side of LogToFile, with a file stream which stays open
+    class FileSink
+    {
+    public:
+        explicit FileSink(std::filesystem::path logFilePath) :
+            _logFilePath{ std::move(logFilePath) }
+        {
+        }
+
+        void refresh()
+        {
+            std::error_code _;
+            const auto tempPath = std::filesystem::temp_directory_path(_);
+            verboseIndicatorFilePresent = std::filesystem::exists(tempPath / verboseFlagFile, _);
+            if (!_file.is_open())
+            {
+                _file.open(_logFilePath, std::ios::binary | std::ios::app);
+            }
+
+            const auto logSize = std::filesystem::file_size(_logFilePath, _);
+            if (logSize != static_cast<std::uintmax_t>(-1) && (logSize >> 20) > maxLogSizeMegabytes)
+            {
+                std::filesystem::resize_file(_logFilePath, 0, _);
+            }
+        }
+
+        void write(const std::vector<FileLine>& lines)
+        {
+            _buffer.clear();
+            for (const auto& line : lines)
+            {
+                _buffer += Prefix(line.time);
+                for (const wchar_t c : line.what)
+                {
+                    _buffer += static_cast<char>(c);
+                }
+                _buffer += '\n';
+            }
+
+            _file.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+            _file.flush();
+        }
+
+        void dropped(const uint64_t lines)
+        {
+            _dropped += lines;
+        }
+
+        uint64_t DroppedLines() const
+        {
+            return _dropped;
+        }
+
+    private:
+        std::filesystem::path _logFilePath;
+        std::ofstream _file;
+        std::string _buffer;
+        uint64_t _dropped = 0;
+    };
+
+    template<typename Log>
+    LoggingResult RunLogger(const wchar_t* name, Log& logger, const size_t threads, const uint32_t callsPerThread)
+    {
+        std::vector<std::vector<double>> callNs(threads);
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t] {
+                auto& samples = callNs[t];
+                samples.reserve(callsPerThread);
+                for (uint32_t i = 0; i < callsPerThread; ++i)
+                {
+                    std::wstring line = L"VideoCaptureProxyFilter::Receive frame " + std::to_wstring(i) + L" on thread " + std::to_wstring(t);
+                    const auto start = Clock::now();
+                    logger(std::move(line));
+                    samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+                }
+            });
+        }
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+
+        std::vector<double> all;
+        for (const auto& samples : callNs)
+        {
+            all.insert(all.end(), samples.begin(), samples.end());
+        }
+
+        std::sort(all.begin(), all.end());
+        LoggingResult result{ name, threads, all.size() };
+        double sum = 0;
+        for (const double ns : all)
+        {
+            sum += ns;
+        }
+
+        result.callMeanNs = sum / static_cast<double>(all.size());
+        result.callP99Ns = all[std::min(all.size() - 1, all.size() * 99 / 100)];
+        result.callMaxNs = all.back();
+        return result;
+    }
+}
+
+namespace VideoConferenceBenchmark
+{
+    std::vector<CheckResult> RunLoggingChecks(const unsigned int seed)
+    {
+        return { CheckLinesWritten(seed), CheckWriterRestart(), CheckRingFull() };
+    }
+
+    std::vector<LoggingResult> RunLoggingBenchmark(const uint32_t callsPerThread)
+    {
+        std::error_code _;
+        const auto directory = std::filesystem::temp_directory_path(_);
+        const auto synchronousPath = directory / L"PowerToysVideoConferenceBenchmark_sync.log";
+        const auto asyncPath = directory / L"PowerToysVideoConferenceBenchmark_async.log";
+
+        std::vector<LoggingResult> results;
+        for (const size_t threads : { size_t{ 1 }, size_t{ 4 } })
+        {
+            std::filesystem::remove(synchronousPath, _);
+            SynchronousLog synchronous{ synchronousPath };
+            auto logSynchronously = [&synchronous](std::wstring line) { synchronous.log(std::move(line), true); };
+            results.push_back(RunLogger(L"Synchronous", logSynchronously, threads, callsPerThread));
+
+            std::filesystem::remove(asyncPath, _);
+            AsyncLogWriter<FileLine, FileSink> writer{ AsyncLogWriter<FileLine, FileSink>::Options{}, asyncPath };
+            auto logAsync = [&writer](std::wstring line) { writer.log(FileLine{ std::chrono::system_clock::now(), std::move(line) }); };
+            auto result = RunLogger(L"Async", logAsync, threads, callsPerThread);
+            writer.stop();
+            result.dropped = writer.sink().DroppedLines();
+            results.push_back(std::move(result));
+        }
+
+        std::filesystem::remove(synchronousPath, _);
+        std::filesystem::remove(asyncPath, _);
+        return results;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+namespace VideoConferenceBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Lines logged from many threads reach the sink in order and are all written by stop(), also when the writer is
+    // restarted, and lines not fitting into the ring are counted
+    std::vector<CheckResult> RunLoggingChecks(unsigned int seed);
+
+    struct LoggingResult
+    {
+        std::wstring logger;
+        size_t threads = {};
+        uint64_t calls = {};
+        double callMeanNs = {};
+        double callP99Ns = {};
+        double callMaxNs = {};
+        uint64_t dropped = {};
+    };
+
+    // The cost of logging a line on the calling thread, with the file system checked, the file opened and the line
+    // written for every call as the filter did before, and with the lines handed to the writer thread
+    std::vector<LoggingResult> RunLoggingBenchmark(uint32_t callsPerThread);
+}
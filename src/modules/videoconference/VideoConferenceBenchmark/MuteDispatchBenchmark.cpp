@@ -0,0 +1,403 @@
+#include "pch.h"
+#include "MuteDispatchBenchmark.h"
+
+#include <mutex>
+
+#include <MuteDispatcher.h>
+
+namespace
+{
+    using namespace VideoConferenceBenchmark;
+    using Clock = std::chrono::steady_clock;
+
+    // A microphone whose driver takes a while to mute it, counting how many are muted at the same time
+    class MockMicrophone
+    {
+    public:
+        MockMicrophone(const std::chrono::microseconds latency, std::atomic<int>& busy, std::atomic<int>& maxBusy) :
+            _latency{ latency }, _busy{ busy }, _maxBusy{ maxBusy }
+        {
+        }
+
+        void set_muted(const bool muted)
+        {
+            const int busy = ++_busy;
+            int maxBusy = _maxBusy;
+            while (busy > maxBusy && !_maxBusy.compare_exchange_weak(maxBusy, busy))
+            {
+            }
+
+            std::this_thread::sleep_for(_latency);
+            _muted = muted;
+            ++_calls;
+            --_busy;
+        }
+
+        bool muted() const
+        {
+            return _muted;
+        }
+
+        uint64_t Calls() const
+        {
+            return _calls;
+        }
+
+    private:
+        std::chrono::microseconds _latency;
+        std::atomic<int>& _busy;
+        std::atomic<int>& _maxBusy;
+        std::atomic_bool _muted = false;
+        std::atomic<uint64_t> _calls = 0;
+    };
+
+    // The mute handling of VideoConferenceModule on mocked devices
+    class MockModule
+    {
+    public:
+        MockModule(const size_t devices, const std::chrono::microseconds latency) :
+            _dispatcher{ MuteDispatcher::Handlers{
+                .mute_microphones = [this](const bool muted, const MuteDispatcher::ForEach& forEach) {
+                    std::unique_lock lock{ _devicesMutex };
+                    _applyStarted = Clock::now();
+                    forEach(_devices.size(), [this, muted](const size_t i) { _devices[i]->set_muted(muted); });
+                },
+                .mute_camera = [this](const bool muted) { _cameraMuted = muted; },
+                .applied = [this](const MuteDispatcher::Device device, const bool muted) {
+                    std::unique_lock lock{ _appliedMutex };
+                    _applied.push_back({ device, muted, _applyStarted, Clock::now() });
+                } } }
+        {
+            for (size_t i = 0; i < devices; ++i)
+            {
+                _devices.push_back(std::make_unique<MockMicrophone>(latency, _busy, _maxBusy));
+            }
+        }
+
+        struct Applied
+        {
+            MuteDispatcher::Device device;
+            bool muted;
+            Clock::time_point started;
+            Clock::time_point time;
+        };
+
+        bool MicrophoneMuted()
+        {
+            if (const auto target = _dispatcher.targets().microphone)
+            {
+                return *target;
+            }
+
+            return _devices[0]->muted();
+        }
+
+        bool CameraMuted()
+        {
+            if (const auto target = _dispatcher.targets().camera)
+            {
+                return *target;
+            }
+
+            return _cameraMuted;
+        }
+
+        void ToggleMicrophone()
+        {
+            _dispatcher.request({ .microphone = !MicrophoneMuted() });
+        }
+
+        // As the module applied a toggle before, on the hook thread
+        void ToggleMicrophoneInline()
+        {
+            const auto started = Clock::now();
+            const bool muted = !_devices[0]->muted();
+            for (auto& device : _devices)
+            {
+                device->set_muted(muted);
+            }
+
+            std::unique_lock lock{ _appliedMutex };
+            _applied.push_back({ MuteDispatcher::Device::Microphone, muted, started, Clock::now() });
+        }
+
+        void ToggleCameraAndMicrophone()
+        {
+            _dispatcher.request({ .microphone = !MicrophoneMuted(), .camera = !CameraMuted() });
+        }
+
+        // The push-to-talk key unmutes while it's held
+        void PushToTalk(const bool pressed)
+        {
+            if (pressed == MicrophoneMuted())
+            {
+                ToggleMicrophone();
+            }
+        }
+
+        void Stop()
+        {
+            _dispatcher.stop();
+        }
+
+        MuteDispatcher& Dispatcher()
+        {
+            return _dispatcher;
+        }
+
+        const std::vector<std::unique_ptr<MockMicrophone>>& Devices() const
+        {
+            return _devices;
+        }
+
+        bool CameraApplied() const
+        {
+            return _cameraMuted;
+        }
+
+        int MaxBusy() const
+        {
+            return _maxBusy;
+        }
+
+        std::vector<Applied> AppliedStates()
+        {
+            std::unique_lock lock{ _appliedMutex };
+            return _applied;
+        }
+
+        // Waits until the dispatcher applied everything asked for
+        bool WaitIdle(const std::chrono::milliseconds timeout = std::chrono::seconds{ 5 })
+        {
+            const auto deadline = Clock::now() + timeout;
+            while (Clock::now() < deadline)
+            {
+                const auto targets = _dispatcher.targets();
+                if (!targets.microphone && !targets.camera)
+                {
+                    return true;
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+            }
+
+            return false;
+        }
+
+    private:
+        std::atomic<int> _busy = 0;
+        std::atomic<int> _maxBusy = 0;
+        std::mutex _devicesMutex;
+        Clock::time_point _applyStarted;
+        std::vector<std::unique_ptr<MockMicrophone>> _devices;
+        std::atomic_bool _cameraMuted = false;
+        std::mutex _appliedMutex;
+        std::vector<Applied> _applied;
+        MuteDispatcher _dispatcher;
+    };
+
+    bool AllMuted(const MockModule& module, const bool muted)
+    {
+        return std::all_of(module.Devices().begin(), module.Devices().end(), [muted](const auto& device) {
+            return device->muted() == muted;
+        });
+    }
+
+    CheckResult CheckCoalescing()
+    {
+        CheckResult result{ .name = L"Mute coalescing" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        // Nine toggles while the first one is applied end muted, in far fewer applies
+        MockModule module{ 3, std::chrono::milliseconds{ 30 } };
+        for (int i = 0; i < 9; ++i)
+        {
+            module.ToggleMicrophone();
+        }
+
+        check(module.MicrophoneMuted());
+        check(module.WaitIdle());
+        check(AllMuted(module, true));
+        const auto stats = module.Dispatcher().stats();
+        check(stats.requests == 9);
+        check(stats.microphone_applies >= 1 && stats.microphone_applies <= 3);
+        for (const auto& device : module.Devices())
+        {
+            check(device->Calls() == stats.microphone_applies);
+        }
+
+        const auto applied = module.AppliedStates();
+        check(applied.size() == stats.microphone_applies && applied.back().muted);
+
+        // An even number of toggles ends where it started
+        for (int i = 0; i < 4; ++i)
+        {
+            module.ToggleMicrophone();
+        }
+
+        check(module.WaitIdle());
+        check(AllMuted(module, true));
+
+        // The camera and the microphone together
+        module.ToggleCameraAndMicrophone();
+        check(module.WaitIdle());
+        check(AllMuted(module, false) && module.CameraApplied());
+        return result;
+    }
+
+    CheckResult CheckParallelApply()
+    {
+        CheckResult result{ .name = L"Mute parallel apply" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        constexpr auto latency = std::chrono::milliseconds{ 50 };
+        MockModule module{ 4, latency };
+        const auto start = Clock::now();
+        module.ToggleMicrophone();
+        check(module.WaitIdle());
+        const auto elapsed = Clock::now() - start;
+        check(AllMuted(module, true));
+        check(module.MaxBusy() == 4);
+        // Four devices one after another would take four times as long
+        check(elapsed < latency * 3);
+        return result;
+    }
+
+    CheckResult CheckPushToTalk()
+    {
+        CheckResult result{ .name = L"Mute push-to-talk burst" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        MockModule module{ 2, std::chrono::milliseconds{ 20 } };
+        module.ToggleMicrophone();
+        check(module.WaitIdle());
+
+        // Tapped faster than the devices take it, the microphone ends muted
+        for (int i = 0; i < 20; ++i)
+        {
+            module.PushToTalk(true);
+            module.PushToTalk(false);
+        }
+
+        check(module.WaitIdle());
+        check(AllMuted(module, true));
+        check(module.Dispatcher().stats().microphone_applies < 20);
+
+        // Held, it ends unmuted
+        module.PushToTalk(true);
+        check(module.WaitIdle());
+        check(AllMuted(module, false));
+        module.PushToTalk(false);
+        check(module.WaitIdle());
+        check(AllMuted(module, true));
+        return result;
+    }
+
+    CheckResult CheckStop()
+    {
+        CheckResult result{ .name = L"Mute stop" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        // Stopping applies what's pending, and a later request starts the worker again
+        MockModule module{ 2, std::chrono::milliseconds{ 10 } };
+        module.ToggleMicrophone();
+        module.Stop();
+        check(AllMuted(module, true));
+        check(!module.Dispatcher().targets().microphone);
+
+        module.ToggleMicrophone();
+        check(module.WaitIdle());
+        check(AllMuted(module, false));
+        module.Stop();
+        module.Stop();
+        check(module.AppliedStates().size() == 2);
+        return result;
+    }
+
+    double Percentile(std::vector<double> values, const double percentile)
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, static_cast<size_t>(static_cast<double>(values.size()) * percentile))];
+    }
+}
+
+namespace VideoConferenceBenchmark
+{
+    std::vector<CheckResult> RunMuteDispatchChecks()
+    {
+        return { CheckCoalescing(), CheckParallelApply(), CheckPushToTalk(), CheckStop() };
+    }
+
+    std::vector<MuteDispatchResult> RunMuteDispatchBenchmark(const uint32_t toggles)
+    {
+        constexpr size_t devices = 2;
+        constexpr auto toggleInterval = std::chrono::milliseconds{ 20 };
+        std::vector<MuteDispatchResult> results;
+        for (const auto latency : { std::chrono::microseconds{ 200 }, std::chrono::microseconds{ 5000 }, std::chrono::microseconds{ 150000 } })
+        {
+            for (const bool inline_ : { true, false })
+            {
+                MockModule module{ devices, latency };
+                std::vector<double> hookUs;
+                std::vector<Clock::time_point> toggled;
+                auto next = Clock::now();
+                for (uint32_t i = 0; i < toggles; ++i)
+                {
+                    std::this_thread::sleep_until(next);
+                    const auto start = Clock::now();
+                    inline_ ? module.ToggleMicrophoneInline() : module.ToggleMicrophone();
+                    hookUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+                    toggled.push_back(start);
+                    next = std::max(next + toggleInterval, Clock::now());
+                }
+
+                module.WaitIdle(std::chrono::seconds{ 30 });
+                module.Stop();
+
+                // A toggle is applied by the first apply started after it, with its state or a later one
+                const auto applied = module.AppliedStates();
+                double appliedMs = 0;
+                size_t next_applied = 0;
+                for (const auto time : toggled)
+                {
+                    while (next_applied < applied.size() && applied[next_applied].started < time)
+                    {
+                        ++next_applied;
+                    }
+
+                    if (next_applied < applied.size())
+                    {
+                        appliedMs += std::chrono::duration<double, std::milli>(applied[next_applied].time - time).count();
+                    }
+                }
+
+                MuteDispatchResult result{ inline_ ? L"Hook" : L"Dispatcher", latency, devices };
+                result.toggles = toggles;
+                result.applies = applied.size();
+                result.hookP50Us = Percentile(hookUs, 0.5);
+                result.hookMaxUs = Percentile(hookUs, 1);
+                result.appliedMeanMs = toggles ? appliedMs / toggles : 0;
+                results.push_back(result);
+            }
+        }
+
+        return results;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+namespace VideoConferenceBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Mute states asked for by the hook reach every mocked device, the devices are applied in parallel, and toggles
+    // and push-to-talk bursts faster than the devices are collapsed into the last state
+    std::vector<CheckResult> RunMuteDispatchChecks();
+
+    struct MuteDispatchResult
+    {
+        std::wstring dispatch;
+        std::chrono::microseconds deviceLatency{};
+        size_t devices = {};
+        uint64_t toggles = {};
+        uint64_t applies = {};
+        // Time the keyboard hook spends on a toggle
+        double hookP50Us = {};
+        double hookMaxUs = {};
+        // From the toggle until the toolbar is told
+        double appliedMeanMs = {};
+    };
+
+    // Microphone toggles with mocked devices as slow as audio drivers can be, applied on the hook thread as the module
+    // did before and through the dispatcher
+    std::vector<MuteDispatchResult> RunMuteDispatchBenchmark(uint32_t toggles);
+}
@@ -0,0 +1,329 @@
+#include "pch.h"
+#include "OverlayDeliveryBenchmark.h"
+
+#include <cstring>
+#include <deque>
+
+#include <OverlayDelivery.h>
+
+namespace
+{
+    using namespace VideoConferenceBenchmark;
+    using Clock = std::chrono::steady_clock;
+
+    constexpr double framesPerSecond = 30.0;
+
+    struct Overlay
+    {
+        uint64_t version = 0;
+        std::vector<uint8_t> bytes;
+    };
+
+    Overlay MakeOverlay(const uint64_t version, const size_t size)
+    {
+        Overlay overlay{ version, std::vector<uint8_t>(size) };
+        for (size_t i = 0; i < size; ++i)
+        {
+            overlay.bytes[i] = static_cast<uint8_t>(version * 31 + i * 7);
+        }
+
+        return overlay;
+    }
+
+    // Hands out its buffers like the DirectShow memory allocator, the most recently released one first, and none while
+    // all of them are held
+    class SimulatedAllocator
+    {
+    public:
+        SimulatedAllocator(const size_t buffers, const size_t bufferSize) :
+            _buffers(buffers, std::vector<uint8_t>(bufferSize))
+        {
+            for (size_t i = buffers; i-- > 0;)
+            {
+                _free.push_back(i);
+            }
+        }
+
+        std::optional<size_t> GetBuffer()
+        {
+            if (_free.empty())
+            {
+                return std::nullopt;
+            }
+
+            const size_t index = _free.back();
+            _free.pop_back();
+            return index;
+        }
+
+        void Release(const size_t index)
+        {
+            _free.push_back(index);
+        }
+
+        std::vector<uint8_t>& Buffer(const size_t index)
+        {
+            return _buffers[index];
+        }
+
+    private:
+        std::vector<std::vector<uint8_t>> _buffers;
+        std::vector<size_t> _free;
+    };
+
+    struct DeliveredSample
+    {
+        SimulatedAllocator* allocator = nullptr;
+        size_t index = 0;
+        size_t length = 0;
+    };
+
+    // A camera filling its own buffers, the muted frame delivery of the proxy filter, and a downstream filter holding
+    // the last samples it received
+    class DeliverySimulation
+    {
+    public:
+        DeliverySimulation(const bool pooled, const size_t poolBuffers, const size_t heldSamples, const size_t bufferSize) :
+            _pooled{ pooled },
+            _heldSamples{ heldSamples },
+            _camera{ heldSamples + 1, bufferSize },
+            _pool{ poolBuffers, bufferSize }
+        {
+        }
+
+        size_t Capture()
+        {
+            const size_t frame = *_camera.GetBuffer();
+            auto& buffer = _camera.Buffer(frame);
+            std::fill_n(buffer.begin(), std::min<size_t>(buffer.size(), 64), static_cast<uint8_t>(0xCC));
+            return frame;
+        }
+
+        // Delivers the overlay in a pool buffer if one is free, or else in the camera frame, overwriting it
+        DeliveredSample Deliver(const size_t frame, const Overlay& overlay)
+        {
+            if (_pooled)
+            {
+                if (const auto index = _pool.GetBuffer())
+                {
+                    auto& buffer = _pool.Buffer(*index);
+                    auto length = _tracker.Held(buffer.data(), overlay.version);
+                    if (!length && overlay.bytes.size() <= buffer.size())
+                    {
+                        std::memcpy(buffer.data(), overlay.bytes.data(), overlay.bytes.size());
+                        _tracker.Written(buffer.data(), overlay.version, overlay.bytes.size());
+                        length = overlay.bytes.size();
+                    }
+
+                    if (length)
+                    {
+                        _camera.Release(frame);
+                        return { &_pool, *index, *length };
+                    }
+
+                    _tracker.Forget(buffer.data());
+                    _pool.Release(*index);
+                }
+
+                ++_fallbacks;
+            }
+
+            auto& buffer = _camera.Buffer(frame);
+            std::memcpy(buffer.data(), overlay.bytes.data(), overlay.bytes.size());
+            ++_overwrites;
+            _overwrittenBytes += overlay.bytes.size();
+            return { &_camera, frame, overlay.bytes.size() };
+        }
+
+        void Receive(const DeliveredSample& sample)
+        {
+            _held.push_back(sample);
+            while (_held.size() > _heldSamples)
+            {
+                _held.front().allocator->Release(_held.front().index);
+                _held.pop_front();
+            }
+        }
+
+        const OverlayBufferTracker::Statistics& PoolStats() const
+        {
+            return _tracker.Stats();
+        }
+
+        uint64_t Copies() const
+        {
+            return _tracker.Stats().copies + _overwrites;
+        }
+
+        uint64_t BytesCopied() const
+        {
+            return _tracker.Stats().bytesCopied + _overwrittenBytes;
+        }
+
+        uint64_t Fallbacks() const
+        {
+            return _fallbacks;
+        }
+
+    private:
+        bool _pooled = false;
+        size_t _heldSamples = 0;
+        SimulatedAllocator _camera;
+        SimulatedAllocator _pool;
+        OverlayBufferTracker _tracker;
+        std::deque<DeliveredSample> _held;
+        uint64_t _fallbacks = 0;
+        uint64_t _overwrites = 0;
+        uint64_t _overwrittenBytes = 0;
+    };
+
+    CheckResult CheckBufferTracker()
+    {
+        CheckResult result{ .name = L"Overlay buffer tracker" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        OverlayBufferTracker tracker;
+        uint8_t first = 0, second = 0;
+        check(!tracker.Held(&first, 1));
+        tracker.Written(&first, 1, 100);
+        check(tracker.Held(&first, 1) == 100);
+        check(!tracker.Held(&first, 2));
+        check(!tracker.Held(&second, 1));
+
+        // Writing another overlay into a buffer replaces the one it held
+        tracker.Written(&first, 2, 200);
+        check(!tracker.Held(&first, 1));
+        check(tracker.Held(&first, 2) == 200);
+
+        tracker.Written(&second, 2, 200);
+        tracker.Forget(&first);
+        check(!tracker.Held(&first, 2));
+        check(tracker.Held(&second, 2) == 200);
+
+        tracker.Clear();
+        check(!tracker.Held(&second, 2));
+
+        const auto& stats = tracker.Stats();
+        check(stats.deliveries == 9);
+        check(stats.reuses == 3);
+        check(stats.copies == 3);
+        check(stats.bytesCopied == 500);
+        return result;
+    }
+
+    CheckResult CheckDeliveredContent(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"Overlay delivered content" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        constexpr size_t bufferSize = 4096;
+        std::mt19937 random{ seed };
+        std::uniform_int_distribution<size_t> poolBuffers{ 1, 5 };
+        std::uniform_int_distribution<size_t> heldSamples{ 0, 5 };
+        std::uniform_int_distribution<size_t> overlaySize{ 1, bufferSize };
+        std::bernoulli_distribution overlayChange{ 0.05 };
+        for (int scenario = 0; scenario < 200; ++scenario)
+        {
+            const size_t buffers = poolBuffers(random);
+            const size_t held = heldSamples(random);
+            DeliverySimulation simulation{ true, buffers, held, bufferSize };
+
+            // A new overlay image, or a new frame size the overlay is fitted to, both give a new overlay sample
+            uint64_t versions = 1;
+            Overlay overlay = MakeOverlay(versions, overlaySize(random));
+            for (int i = 0; i < 200; ++i)
+            {
+                if (overlayChange(random))
+                {
+                    overlay = MakeOverlay(++versions, overlaySize(random));
+                }
+
+                const auto sample = simulation.Deliver(simulation.Capture(), overlay);
+                const auto& buffer = sample.allocator->Buffer(sample.index);
+                check(sample.length == overlay.bytes.size() &&
+                      std::equal(overlay.bytes.begin(), overlay.bytes.end(), buffer.begin()));
+                simulation.Receive(sample);
+            }
+
+            // The pool only runs dry when the downstream filter holds all of its buffers
+            check((held < buffers) == (simulation.Fallbacks() == 0));
+            // Every buffer is written at most once per overlay
+            check(simulation.PoolStats().copies <= versions * buffers);
+        }
+
+        return result;
+    }
+
+    OverlayDeliveryResult RunDelivery(const wchar_t* delivery,
+                                      const bool pooled,
+                                      const wchar_t* format,
+                                      const size_t frameSize,
+                                      const size_t overlaySize,
+                                      const uint32_t frames)
+    {
+        constexpr size_t poolBuffers = 3;
+        constexpr size_t heldSamples = 1;
+        DeliverySimulation simulation{ pooled, poolBuffers, heldSamples, frameSize };
+        const Overlay overlays[] = { MakeOverlay(1, overlaySize), MakeOverlay(2, overlaySize) };
+
+        Clock::duration elapsed{};
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            const auto& overlay = overlays[i < frames / 2 ? 0 : 1];
+            const size_t frame = simulation.Capture();
+            const auto start = Clock::now();
+            const auto sample = simulation.Deliver(frame, overlay);
+            elapsed += Clock::now() - start;
+            simulation.Receive(sample);
+        }
+
+        OverlayDeliveryResult result{ delivery, format, overlaySize, frames };
+        result.copies = simulation.Copies();
+        result.reuses = simulation.PoolStats().reuses;
+        result.bytesPerFrame = static_cast<double>(simulation.BytesCopied()) / frames;
+        result.megabytesPerSecond = result.bytesPerFrame * framesPerSecond / (1024.0 * 1024.0);
+        result.usPerFrame = std::chrono::duration<double, std::micro>(elapsed).count() / frames;
+        return result;
+    }
+}
+
+namespace VideoConferenceBenchmark
+{
+    std::vector<CheckResult> RunOverlayDeliveryChecks(const unsigned int seed)
+    {
+        return { CheckBufferTracker(), CheckDeliveredContent(seed) };
+    }
+
+    std::vector<OverlayDeliveryResult> RunOverlayDeliveryBenchmark(const uint32_t frames)
+    {
+        struct Case
+        {
+            const wchar_t* format;
+            size_t frameSize;
+            size_t overlaySize;
+        };
+
+        // MJPEG overlays are encoded to fit the frame buffer, the others are as large as the frame
+        const Case cases[] = {
+            { L"MJPEG 1080p", 1920 * 1080 / 2, 300 * 1024 },
+            { L"YUY2 1080p", 1920 * 1080 * 2, 1920 * 1080 * 2 },
+            { L"NV12 1080p", 1920 * 1080 * 3 / 2, 1920 * 1080 * 3 / 2 },
+            { L"NV12 4K", 3840 * 2160 * 3 / 2, 3840 * 2160 * 3 / 2 },
+        };
+
+        std::vector<OverlayDeliveryResult> results;
+        for (const auto& c : cases)
+        {
+            results.push_back(RunDelivery(L"Overwrite", false, c.format, c.frameSize, c.overlaySize, frames));
+            results.push_back(RunDelivery(L"Pool", true, c.format, c.frameSize, c.overlaySize, frames));
+        }
+
+        return results;
+    }
+}
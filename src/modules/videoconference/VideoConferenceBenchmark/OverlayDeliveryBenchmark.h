@@ -0,0 +1,30 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+namespace VideoConferenceBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Muted frames delivered from a simulated allocator hold the current overlay, across overlay and frame size changes,
+    // exhausted pools and downstream filters holding samples, and the buffer tracker of the proxy filter
+    std::vector<CheckResult> RunOverlayDeliveryChecks(unsigned int seed);
+
+    struct OverlayDeliveryResult
+    {
+        std::wstring delivery;
+        std::wstring format;
+        size_t overlaySize = {};
+        uint64_t frames = {};
+        uint64_t copies = {};
+        uint64_t reuses = {};
+        double bytesPerFrame = {};
+        // Copied per second at 30 frames per second
+        double megabytesPerSecond = {};
+        double usPerFrame = {};
+    };
+
+    // Muted frames delivered by copying the overlay into every camera buffer as the filter did before, and from the
+    // overlay pool, with the overlay changing once halfway
+    std::vector<OverlayDeliveryResult> RunOverlayDeliveryBenchmark(uint32_t frames);
+}
@@ -0,0 +1,473 @@
+#include "pch.h"
+#include "OverlayPreparationBenchmark.h"
+
+#include <cmath>
+
+#include <OverlayPreparation.h>
+
+namespace
+{
+    using namespace VideoConferenceBenchmark;
+    using Clock = std::chrono::steady_clock;
+
+    constexpr float initialQuality = 0.5f;
+    constexpr float minimalQuality = 0.05f;
+    constexpr int fittingSteps = 5;
+    // An MJPEG frame buffer of a 1080p camera
+    constexpr size_t frameSize = 1920 * 1080 / 2;
+
+    struct SimulatedSample
+    {
+        size_t size = 0;
+        float quality = 0.f;
+    };
+
+    using Sample = std::shared_ptr<const SimulatedSample>;
+
+    // Grows with the quality, and doesn't fit the frame at the initial quality, so the encoding must be fitted
+    size_t OverlaySize(const size_t frame, const float quality)
+    {
+        return static_cast<size_t>(static_cast<double>(frame) * (0.4 + 1.6 * quality));
+    }
+
+    Sample Encode(const size_t frame, const float quality, const std::chrono::milliseconds cost)
+    {
+        std::this_thread::sleep_for(cost);
+        return std::make_shared<const SimulatedSample>(SimulatedSample{ OverlaySize(frame, quality), quality });
+    }
+
+    bool Overwrite(std::vector<uint8_t>& frame, const Sample& sample, const uint8_t value)
+    {
+        if (!sample || sample->size > frame.size())
+        {
+            return false;
+        }
+
+        std::fill_n(frame.begin(), sample->size, value);
+        return true;
+    }
+
+    CheckResult CheckQualityFitting(const unsigned int seed)
+    {
+        CheckResult result{ .name = L"Overlay quality fitting" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        // The quality is bisected down to this precision
+        const float precision = (initialQuality - minimalQuality) / (1 << fittingSteps);
+
+        std::mt19937 random{ seed };
+        std::uniform_real_distribution<double> unit{ 0.0, 1.0 };
+        for (int i = 0; i < 500; ++i)
+        {
+            // size(quality) = base + scale * quality^exponent, which the fitting only assumes to be growing
+            const size_t maxSize = 100'000 + static_cast<size_t>(unit(random) * 2'000'000);
+            const double base = unit(random) * static_cast<double>(maxSize);
+            const double scale = (0.2 + unit(random) * 4) * static_cast<double>(maxSize);
+            const double exponent = 0.5 + unit(random) * 2;
+            const auto sizeAt = [&](const float quality) {
+                return static_cast<size_t>(base + scale * std::pow(static_cast<double>(quality), exponent));
+            };
+
+            size_t encodes = 0;
+            const auto fitted = FitOverlayQuality<int>(
+                [&](const float quality) -> std::optional<EncodedOverlay<int>> {
+                    ++encodes;
+                    return EncodedOverlay<int>{ i, sizeAt(quality), quality };
+                },
+                maxSize,
+                minimalQuality,
+                initialQuality,
+                fittingSteps);
+
+            if (sizeAt(initialQuality) <= maxSize)
+            {
+                check(fitted && fitted->quality == initialQuality && encodes == 1);
+            }
+            else if (sizeAt(minimalQuality) > maxSize)
+            {
+                check(!fitted && encodes == 2);
+            }
+            else
+            {
+                check(fitted && fitted->size <= maxSize && fitted->size == sizeAt(fitted->quality));
+                check(fitted && sizeAt(fitted->quality + precision * 1.01f) > maxSize);
+                check(encodes == 2 + fittingSteps);
+            }
+        }
+
+        // Encodings which fail count as not fitting
+        const auto fitted = FitOverlayQuality<int>(
+            [](const float quality) -> std::optional<EncodedOverlay<int>> {
+                if (quality > 0.3f)
+                {
+                    return std::nullopt;
+                }
+
+                return EncodedOverlay<int>{ 0, 1, quality };
+            },
+            1,
+            minimalQuality,
+            initialQuality,
+            fittingSteps);
+        check(fitted && fitted->quality <= 0.3f && fitted->quality > 0.3f - precision * 1.01f);
+
+        // Formats ignoring the quality are encoded once
+        size_t encodes = 0;
+        check(FitOverlayQuality<int>(
+                  [&](const float quality) -> std::optional<EncodedOverlay<int>> {
+                      ++encodes;
+                      return EncodedOverlay<int>{ 0, 100, quality };
+                  },
+                  100,
+                  minimalQuality,
+                  initialQuality,
+                  fittingSteps)
+                  .has_value() &&
+              encodes == 1);
+        return result;
+    }
+
+    CheckResult CheckSampleCache()
+    {
+        CheckResult result{ .name = L"Overlay sample cache" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        using namespace std::chrono_literals;
+        OverlaySampleCache<int, Sample> cache{ 3 };
+        std::atomic<bool> building = false;
+        std::atomic<bool> release = false;
+        std::atomic<size_t> builds = 0;
+        const auto blockingBuild = [&](const size_t size) {
+            return [&, size] {
+                building = true;
+                while (!release)
+                {
+                    std::this_thread::yield();
+                }
+
+                ++builds;
+                return std::make_shared<const SimulatedSample>(SimulatedSample{ size, initialQuality });
+            };
+        };
+
+        // Requests are queued before the thread starts, and duplicates are dropped
+        cache.Request(1, blockingBuild(1));
+        cache.Request(1, blockingBuild(1));
+        check(!cache.Find(1).has_value());
+
+        std::thread thread{ [&cache] { cache.Run(); } };
+        while (!building)
+        {
+            std::this_thread::yield();
+        }
+
+        // Lookups don't wait for the build, and neither do requests for the sample being built
+        const auto start = Clock::now();
+        check(!cache.Find(1).has_value());
+        cache.Request(1, blockingBuild(1));
+        check(Clock::now() - start < 50ms);
+
+        // Queued builds are cancelled, e.g. for the samples of an image which was replaced
+        cache.Request(10, blockingBuild(10));
+        cache.Request(11, blockingBuild(11));
+        cache.CancelPending();
+
+        release = true;
+        cache.WaitIdle();
+        const auto first = cache.Find(1);
+        check(first.has_value() && *first && (*first)->size == 1);
+        check(builds == 1 && cache.Builds() == 1);
+        check(!cache.Find(10).has_value() && !cache.Find(11).has_value());
+
+        // Failed builds are kept, so they aren't retried for every frame
+        cache.Request(2, [&] {
+            ++builds;
+            return Sample{};
+        });
+        cache.WaitIdle();
+        const auto failed = cache.Find(2);
+        check(failed.has_value() && !*failed);
+        cache.Request(2, [&] {
+            ++builds;
+            return Sample{};
+        });
+        cache.WaitIdle();
+        check(builds == 2);
+
+        // The oldest samples are dropped beyond the capacity
+        for (int key = 3; key <= 4; ++key)
+        {
+            cache.Request(key, blockingBuild(static_cast<size_t>(key)));
+        }
+        cache.WaitIdle();
+        check(!cache.Find(1).has_value() && cache.Find(2).has_value() && cache.Find(4).has_value());
+
+        // Stopping drops the queued builds and ends Run()
+        release = false;
+        building = false;
+        cache.Request(5, blockingBuild(5));
+        cache.Request(6, blockingBuild(6));
+        while (!building)
+        {
+            std::this_thread::yield();
+        }
+
+        cache.Stop();
+        release = true;
+        thread.join();
+        check(!cache.Find(6).has_value());
+        cache.Request(7, blockingBuild(7));
+        check(!cache.Find(7).has_value());
+        return result;
+    }
+
+    enum class FrameContent
+    {
+        Camera,
+        Overlay,
+        Blank,
+    };
+
+    // The filter before: the overlay is loaded on the frame thread after it was reset, and loaded again with the lower
+    // qualities if it doesn't fit the frame
+    class InlinePreparation
+    {
+    public:
+        explicit InlinePreparation(const MuteToggleOptions& options) :
+            _encodeCost{ options.encodeCost }
+        {
+        }
+
+        FrameContent Deliver(const bool muted, const uint32_t imageGeneration, std::vector<uint8_t>& frame)
+        {
+            if (imageGeneration != _imageGeneration)
+            {
+                _imageGeneration = imageGeneration;
+                _overlay.reset();
+                _loaded = false;
+                _lowerQualities = { 0.1f, 0.25f };
+            }
+
+            if (!muted)
+            {
+                return FrameContent::Camera;
+            }
+
+            if (!_loaded)
+            {
+                _overlay = Load(frame.size(), initialQuality);
+                _loaded = true;
+            }
+
+            bool overwritten = Overwrite(frame, _overlay, static_cast<uint8_t>(imageGeneration));
+            while (!overwritten && _overlay)
+            {
+                _overlay.reset();
+                if (!_lowerQualities.empty())
+                {
+                    const float quality = _lowerQualities.back();
+                    _lowerQualities.pop_back();
+                    _overlay = Load(frame.size(), quality);
+                    overwritten = Overwrite(frame, _overlay, static_cast<uint8_t>(imageGeneration));
+                }
+            }
+
+            return overwritten ? FrameContent::Overlay : FrameContent::Blank;
+        }
+
+        uint64_t EncodesOnFrameThread() const
+        {
+            return _encodes;
+        }
+
+    private:
+        Sample Load(const size_t frame, const float quality)
+        {
+            ++_encodes;
+            return Encode(frame, quality, _encodeCost);
+        }
+
+        std::chrono::milliseconds _encodeCost;
+        Sample _overlay;
+        bool _loaded = false;
+        std::vector<float> _lowerQualities;
+        uint32_t _imageGeneration = 0;
+        uint64_t _encodes = 0;
+    };
+
+    struct SimulatedKey
+    {
+        size_t frameSize = 0;
+        uint32_t imageGeneration = 0;
+
+        bool operator==(const SimulatedKey&) const = default;
+    };
+
+    // The filter now: SyncCurrentSettings requests the overlay when an image is posted, and frames only look it up
+    class CachedPreparation
+    {
+    public:
+        explicit CachedPreparation(const MuteToggleOptions& options) :
+            _encodeCost{ options.encodeCost }
+        {
+        }
+
+        ~CachedPreparation()
+        {
+            _cache.Stop();
+            _thread.join();
+        }
+
+        FrameContent Deliver(const bool muted, const uint32_t imageGeneration, std::vector<uint8_t>& frame)
+        {
+            if (imageGeneration != _imageGeneration)
+            {
+                _imageGeneration = imageGeneration;
+                _cache.CancelPending();
+                Prepare(frame.size());
+            }
+
+            if (!muted)
+            {
+                return FrameContent::Camera;
+            }
+
+            if (Overwrite(frame, Prepare(frame.size()), static_cast<uint8_t>(imageGeneration)))
+            {
+                return FrameContent::Overlay;
+            }
+
+            std::fill_n(frame.begin(), 64, uint8_t{ 0 });
+            return FrameContent::Blank;
+        }
+
+        uint64_t EncodesOnFrameThread() const
+        {
+            return 0;
+        }
+
+    private:
+        Sample Prepare(const size_t frame)
+        {
+            const SimulatedKey key{ frame, _imageGeneration };
+            if (auto sample = _cache.Find(key))
+            {
+                return *sample;
+            }
+
+            _cache.Request(key, [frame, cost = _encodeCost] {
+                auto fitted = FitOverlayQuality<Sample>(
+                    [&](const float quality) -> std::optional<EncodedOverlay<Sample>> {
+                        auto sample = Encode(frame, quality, cost);
+                        return EncodedOverlay<Sample>{ sample, sample->size, quality };
+                    },
+                    frame,
+                    minimalQuality,
+                    initialQuality,
+                    fittingSteps);
+                return fitted ? fitted->sample : Sample{};
+            });
+
+            return nullptr;
+        }
+
+        std::chrono::milliseconds _encodeCost;
+        uint32_t _imageGeneration = 0;
+        OverlaySampleCache<SimulatedKey, Sample> _cache;
+        std::thread _thread{ [this] { _cache.Run(); } };
+    };
+
+    template<typename Preparation>
+    MuteToggleResult RunMuteToggle(std::wstring name, const MuteToggleOptions& options)
+    {
+        MuteToggleResult result{ .preparation = std::move(name) };
+        Preparation preparation{ options };
+        std::vector<uint8_t> frame(frameSize);
+        std::vector<double> frameMs;
+
+        bool muted = false;
+        bool justMuted = false;
+        uint32_t imageGeneration = 1;
+        uint32_t toggles = 0;
+
+        const auto start = Clock::now();
+        const auto deadline = start + options.duration;
+        auto nextToggle = start + options.toggleInterval;
+        for (auto nextFrame = start; nextFrame < deadline; nextFrame += options.frameInterval)
+        {
+            std::this_thread::sleep_until(nextFrame);
+            const auto frameStart = Clock::now();
+            if (frameStart >= nextToggle)
+            {
+                muted = !muted;
+                justMuted = muted;
+                // A new image is posted every few toggles, muted or not
+                if (++toggles % 3 == 0)
+                {
+                    ++imageGeneration;
+                }
+                nextToggle += options.toggleInterval;
+            }
+
+            const FrameContent content = preparation.Deliver(muted, imageGeneration, frame);
+            const double ms = std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+            frameMs.push_back(ms);
+
+            result.frames++;
+            result.mutedFrames += muted ? 1 : 0;
+            result.blankFrames += content == FrameContent::Blank ? 1 : 0;
+            if (justMuted)
+            {
+                result.toggleMaxMs = std::max(result.toggleMaxMs, ms);
+                justMuted = false;
+            }
+
+            // A late frame delays the next ones instead of making them pile up, as the camera would drop them
+            nextFrame = std::max(nextFrame, Clock::now() - options.frameInterval);
+        }
+
+        result.encodesOnFrameThread = preparation.EncodesOnFrameThread();
+        if (!frameMs.empty())
+        {
+            std::sort(begin(frameMs), end(frameMs));
+            result.frameP99Ms = frameMs[std::min(frameMs.size() - 1, frameMs.size() * 99 / 100)];
+            result.frameMaxMs = frameMs.back();
+        }
+
+        return result;
+    }
+
+    CheckResult CheckMuteToggleLatency()
+    {
+        CheckResult result{ .name = L"Mute toggle frame latency" };
+        MuteToggleOptions options;
+        options.duration = std::chrono::milliseconds{ 1500 };
+        const auto cached = RunMuteToggle<CachedPreparation>(L"Cached", options);
+
+        // Frames never wait for an encoding, so even the slowest frame is faster than a single one
+        result.cases = 3;
+        result.failures += cached.encodesOnFrameThread == 0 ? 0 : 1;
+        result.failures += cached.frameMaxMs < std::chrono::duration<double, std::milli>(options.encodeCost).count() ? 0 : 1;
+        result.failures += cached.mutedFrames > cached.blankFrames ? 0 : 1;
+        return result;
+    }
+}
+
+namespace VideoConferenceBenchmark
+{
+    std::vector<CheckResult> RunOverlayPreparationChecks(const unsigned int seed)
+    {
+        return { CheckQualityFitting(seed), CheckSampleCache(), CheckMuteToggleLatency() };
+    }
+
+    std::vector<MuteToggleResult> RunMuteToggleBenchmark(const MuteToggleOptions& options)
+    {
+        return { RunMuteToggle<InlinePreparation>(L"Inline", options), RunMuteToggle<CachedPreparation>(L"Cached", options) };
+    }
+}
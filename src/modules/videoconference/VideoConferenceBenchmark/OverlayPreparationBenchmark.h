@@ -0,0 +1,40 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+namespace VideoConferenceBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Quality fitting of the overlay encodings, and requests, lookups, eviction and cancellation of the overlay sample
+    // cache of the proxy filter
+    std::vector<CheckResult> RunOverlayPreparationChecks(unsigned int seed);
+
+    struct MuteToggleOptions
+    {
+        std::chrono::milliseconds duration{ 3000 };
+        std::chrono::milliseconds frameInterval{ 33 };
+        // How long the camera stays muted and unmuted
+        std::chrono::milliseconds toggleInterval{ 250 };
+        // How long decoding, scaling and encoding the overlay image once takes
+        std::chrono::milliseconds encodeCost{ 40 };
+    };
+
+    struct MuteToggleResult
+    {
+        std::wstring preparation;
+        uint64_t frames = {};
+        uint64_t mutedFrames = {};
+        // Muted frames showing the blank image because their overlay wasn't ready
+        uint64_t blankFrames = {};
+        uint64_t encodesOnFrameThread = {};
+        double frameP99Ms = {};
+        double frameMaxMs = {};
+        // The slowest frame of the ones delivered right after the camera was muted
+        double toggleMaxMs = {};
+    };
+
+    // Frames delivered while the camera is muted and unmuted, and a new overlay image is posted, with the overlay loaded
+    // on the frame thread as the filter did before, and prepared on the thread of the overlay sample cache
+    std::vector<MuteToggleResult> RunMuteToggleBenchmark(const MuteToggleOptions& options);
+}
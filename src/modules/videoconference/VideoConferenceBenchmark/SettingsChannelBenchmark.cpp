@@ -0,0 +1,471 @@
+#include "pch.h"
+#include "SettingsChannelBenchmark.h"
+
+#include <array>
+#include <new>
+
+#include <CameraStateUpdateChannels.h>
+#include <VersionedChannel.h>
+
+#include "SharedMapping.h"
+
+namespace
+{
+    using namespace VideoConferenceBenchmark;
+    using Clock = std::chrono::steady_clock;
+
+    // Big enough that a writer is likely to be caught in the middle of its copy
+    struct StressValue
+    {
+        uint32_t writer = 0;
+        uint32_t sequence = 0;
+        std::array<uint32_t, 160> fill{};
+    };
+
+    uint32_t Fill(const uint32_t writer, const uint32_t sequence)
+    {
+        return writer * 0x9E3779B1u ^ sequence * 0x85EBCA77u;
+    }
+
+    bool Consistent(const StressValue& value)
+    {
+        const uint32_t expected = Fill(value.writer, value.sequence);
+        return std::all_of(value.fill.begin(), value.fill.end(), [expected](const uint32_t word) { return word == expected; });
+    }
+
+    template<typename T>
+    T* Construct(uint8_t* memory)
+    {
+        return new (memory) T{};
+    }
+
+    CheckResult CheckTornReads(const std::chrono::milliseconds duration, const unsigned int seed)
+    {
+        CheckResult result{ .name = L"Channel torn reads" };
+        constexpr uint32_t writers = 2;
+        constexpr size_t readers = 3;
+
+        SharedMapping mapping{ sizeof(VersionedChannel<StressValue>) };
+        Construct<VersionedChannel<StressValue>>(mapping.MapView());
+
+        std::atomic<bool> stop = false;
+        std::atomic<size_t> failures = 0;
+        std::atomic<size_t> reads = 0;
+        std::vector<std::thread> threads;
+        for (uint32_t writer = 1; writer <= writers; ++writer)
+        {
+            auto channel = reinterpret_cast<VersionedChannel<StressValue>*>(mapping.MapView());
+            threads.emplace_back([&, channel, writer] {
+                std::mt19937 random{ seed + writer };
+                for (uint32_t sequence = 1; !stop; ++sequence)
+                {
+                    channel->update([&](StressValue& value) {
+                        // The value a writer gets is the last published one, never a torn one
+                        failures += Consistent(value) ? 0 : 1;
+                        value.writer = writer;
+                        value.sequence = sequence;
+                        value.fill.fill(Fill(writer, sequence));
+                    });
+
+                    if (random() % 4 == 0)
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        for (size_t reader = 0; reader < readers; ++reader)
+        {
+            auto channel = reinterpret_cast<const VersionedChannel<StressValue>*>(mapping.MapView());
+            threads.emplace_back([&, channel] {
+                StressValue value;
+                uint32_t generation = VersionedChannel<StressValue>::UNREAD;
+                uint32_t lastGeneration = 0;
+                size_t count = 0;
+                while (!stop)
+                {
+                    if (channel->read_if_changed(generation, value))
+                    {
+                        // Generations are even and only grow
+                        failures += Consistent(value) && generation % 2 == 0 && (count == 0 || generation - lastGeneration - 1 < 0x80000000u) ? 0 : 1;
+                        lastGeneration = generation;
+                        count++;
+                    }
+                }
+
+                reads += count;
+            });
+        }
+
+        std::this_thread::sleep_for(duration);
+        stop = true;
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        result.cases = reads;
+        result.failures = failures;
+        return result;
+    }
+
+    CheckResult CheckWriterExclusion()
+    {
+        CheckResult result{ .name = L"Channel writers" };
+        constexpr size_t writers = 4;
+        constexpr uint64_t updates = 20000;
+
+        SharedMapping mapping{ sizeof(VersionedChannel<uint64_t>) };
+        Construct<VersionedChannel<uint64_t>>(mapping.MapView());
+        std::vector<std::thread> threads;
+        for (size_t writer = 0; writer < writers; ++writer)
+        {
+            auto channel = reinterpret_cast<VersionedChannel<uint64_t>*>(mapping.MapView());
+            threads.emplace_back([channel] {
+                for (uint64_t i = 0; i < updates; ++i)
+                {
+                    channel->update([](uint64_t& value) { value++; });
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        const auto channel = reinterpret_cast<const VersionedChannel<uint64_t>*>(mapping.MapView());
+        result.cases = 2;
+        result.failures += channel->read() == writers * updates ? 0 : 1;
+        result.failures += channel->generation() == 2 * writers * updates ? 0 : 1;
+        return result;
+    }
+
+    CheckResult CheckChangeDetection()
+    {
+        CheckResult result{ .name = L"Channel generations" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        SharedMapping mapping{ sizeof(CameraSettingsUpdateChannel) };
+        auto module = Construct<CameraSettingsUpdateChannel>(mapping.MapView());
+        auto filter = reinterpret_cast<CameraSettingsUpdateChannel*>(mapping.MapView());
+
+        // The first read copies the initial settings
+        CameraSettings settings;
+        settings.useOverlayImage = true;
+        uint32_t generation = VersionedChannel<CameraSettings>::UNREAD;
+        check(filter->settings.read_if_changed(generation, settings) && !settings.useOverlayImage && generation == 0);
+
+        // Nothing changed, nothing is copied
+        settings.useOverlayImage = true;
+        check(!filter->settings.read_if_changed(generation, settings) && settings.useOverlayImage);
+
+        const std::wstring_view cameraName = L"Integrated Camera";
+        module->settings.update([&](CameraSettings& s) {
+            s.sourceCameraName.emplace();
+            std::copy(cameraName.begin(), cameraName.end(), s.sourceCameraName->begin());
+            s.overlayImageSize = 1234;
+            s.overlayImageGeneration++;
+        });
+
+        check(filter->settings.read_if_changed(generation, settings));
+        check(settings.sourceCameraName && std::wstring_view{ settings.sourceCameraName->data() } == cameraName);
+        check(settings.overlayImageSize == 1234u && settings.overlayImageGeneration == 1 && !settings.useOverlayImage);
+        check(!filter->settings.read_if_changed(generation, settings));
+
+        module->settings.update([](CameraSettings& s) { s.useOverlayImage = !s.useOverlayImage; });
+        check(filter->settings.read_if_changed(generation, settings) && settings.useOverlayImage && generation == 4);
+        check(module->settings.read().useOverlayImage);
+
+        // The flag the filter sets is outside the versioned settings, so it doesn't make readers copy them again
+        filter->cameraInUse = true;
+        check(module->cameraInUse && !filter->settings.read_if_changed(generation, settings));
+        return result;
+    }
+
+    CheckResult CheckStalledWriter()
+    {
+        CheckResult result{ .name = L"Channel stalled writer" };
+        const auto check = [&result](const bool passed) {
+            result.cases++;
+            result.failures += passed ? 0 : 1;
+        };
+
+        using namespace std::chrono_literals;
+        SharedMapping mapping{ sizeof(VersionedChannel<StressValue>) };
+        auto channel = Construct<VersionedChannel<StressValue>>(mapping.MapView());
+        channel->update([](StressValue& value) { value.fill.fill(Fill(0, 0)); });
+
+        // A writer stopped in the middle of its write, e.g. preempted
+        std::atomic<bool> stalled = false;
+        std::thread stalledWriter{ [&] {
+            channel->update([&](StressValue& value) {
+                value.writer = 1;
+                value.fill[0] = 1;
+                stalled = true;
+                std::this_thread::sleep_for(400ms);
+            });
+        } };
+
+        while (!stalled)
+        {
+            std::this_thread::yield();
+        }
+
+        // Readers don't wait for it, and keep what they have
+        StressValue value;
+        uint32_t generation = 0;
+        const auto start = Clock::now();
+        check(!channel->read_if_changed(generation, value));
+        check(Clock::now() - start < 50ms);
+
+        // Another writer waits for it, and gets its value
+        const auto waitStart = Clock::now();
+        channel->update([](StressValue& v) {
+            v.writer = 2;
+            v.sequence = v.fill[0];
+            v.fill.fill(Fill(2, v.sequence));
+        });
+
+        check(Clock::now() - waitStart >= 300ms);
+        stalledWriter.join();
+        const StressValue published = channel->read();
+        check(Consistent(published) && published.writer == 2 && published.sequence == 1);
+        check(channel->generation() == 6);
+        return result;
+    }
+
+    // The channel as it was before: the settings, then the byte SerializedSharedMemory locks
+    struct SpinlockSettings
+    {
+        bool useOverlayImage = false;
+        bool cameraInUse = false;
+
+        std::optional<uint32_t> overlayImageSize;
+        std::optional<std::array<wchar_t, 256>> sourceCameraName;
+
+        bool newOverlayImagePosted = false;
+    };
+
+    struct SpinlockChannel
+    {
+        SpinlockSettings settings;
+        std::atomic<char> lock = 0;
+
+        template<typename Fn>
+        void Access(Fn&& fn)
+        {
+            char unlocked = 0;
+            while (!lock.compare_exchange_strong(unlocked, 1, std::memory_order_acquire))
+            {
+                unlocked = 0;
+                while (lock.load(std::memory_order_relaxed) == 1)
+                {
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+                    _mm_pause();
+#else
+                    std::this_thread::yield();
+#endif
+                }
+            }
+
+            fn(settings);
+            lock.store(0, std::memory_order_release);
+        }
+    };
+
+    // What the frame thread and the keyboard hook do with each channel
+    struct SpinlockClient
+    {
+        SpinlockChannel* channel;
+        std::wstring currentCameraName;
+
+        bool FrameRead()
+        {
+            bool disabled = false;
+            channel->Access([&](SpinlockSettings& settings) {
+                disabled = settings.useOverlayImage;
+                settings.cameraInUse = true;
+                if (settings.sourceCameraName && currentCameraName != settings.sourceCameraName->data())
+                {
+                    disabled = !disabled;
+                }
+
+                if (settings.overlayImageSize && settings.newOverlayImagePosted)
+                {
+                    disabled = !disabled;
+                }
+            });
+            return disabled;
+        }
+
+        bool Poll()
+        {
+            bool inUse = false;
+            bool muted = false;
+            channel->Access([&](SpinlockSettings& settings) { inUse = settings.cameraInUse; });
+            channel->Access([&](SpinlockSettings& settings) { muted = settings.useOverlayImage; });
+            return inUse && muted;
+        }
+
+        void ToggleMute()
+        {
+            channel->Access([](SpinlockSettings& settings) { settings.useOverlayImage = !settings.useOverlayImage; });
+        }
+    };
+
+    struct VersionedClient
+    {
+        CameraSettingsUpdateChannel* channel;
+        std::wstring currentCameraName;
+        CameraSettings settings;
+        uint32_t generation = VersionedChannel<CameraSettings>::UNREAD;
+
+        bool FrameRead()
+        {
+            if (!channel->cameraInUse.load(std::memory_order_relaxed))
+            {
+                channel->cameraInUse = true;
+            }
+
+            channel->settings.read_if_changed(generation, settings);
+            bool disabled = settings.useOverlayImage;
+            if (settings.sourceCameraName && currentCameraName != settings.sourceCameraName->data())
+            {
+                disabled = !disabled;
+            }
+
+            return disabled;
+        }
+
+        bool Poll()
+        {
+            return channel->cameraInUse.load(std::memory_order_relaxed) && channel->settings.read().useOverlayImage;
+        }
+
+        void ToggleMute()
+        {
+            channel->settings.update([](CameraSettings& s) { s.useOverlayImage = !s.useOverlayImage; });
+        }
+    };
+
+    template<typename Client, typename Channel>
+    SettingsChannelResult RunScenario(std::wstring channelName, std::wstring scenario, const std::chrono::milliseconds duration, const size_t pollers, const bool writer)
+    {
+        SharedMapping mapping{ sizeof(Channel) };
+        Construct<Channel>(mapping.MapView());
+
+        // Every duration is kept until there are too many, the count goes on
+        constexpr size_t maxSamples = 4'000'000;
+        std::vector<float> samples;
+        samples.reserve(maxSamples);
+
+        std::atomic<bool> stop = false;
+        std::atomic<uint64_t> pollerReads = 0;
+        std::atomic<uint64_t> writes = 0;
+        uint64_t frameReads = 0;
+        std::atomic<bool> sink = false;
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < pollers; ++i)
+        {
+            Client client{ reinterpret_cast<Channel*>(mapping.MapView()) };
+            threads.emplace_back([&, client]() mutable {
+                uint64_t count = 0;
+                bool result = false;
+                while (!stop)
+                {
+                    result ^= client.Poll();
+                    count++;
+                }
+
+                pollerReads += count;
+                sink = sink ^ result;
+            });
+        }
+
+        if (writer)
+        {
+            Client client{ reinterpret_cast<Channel*>(mapping.MapView()) };
+            threads.emplace_back([&, client]() mutable {
+                while (!stop)
+                {
+                    client.ToggleMute();
+                    writes++;
+                    std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+                }
+            });
+        }
+
+        Client frame{ reinterpret_cast<Channel*>(mapping.MapView()) };
+        double maxNs = 0;
+        double totalNs = 0;
+        bool result = false;
+        const auto deadline = Clock::now() + duration;
+        for (auto now = Clock::now(); now < deadline;)
+        {
+            result ^= frame.FrameRead();
+            const auto end = Clock::now();
+            const double ns = std::chrono::duration<double, std::nano>(end - now).count();
+            totalNs += ns;
+            maxNs = std::max(maxNs, ns);
+            if (samples.size() < maxSamples)
+            {
+                samples.push_back(static_cast<float>(ns));
+            }
+
+            frameReads++;
+            now = end;
+        }
+
+        stop = true;
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        sink = sink ^ result;
+        std::sort(samples.begin(), samples.end());
+        return {
+            .channel = std::move(channelName),
+            .scenario = std::move(scenario),
+            .frameReads = frameReads,
+            .frameMeanNs = frameReads != 0 ? totalNs / frameReads : 0.0,
+            .frameP99Ns = samples.empty() ? 0.0 : samples[samples.size() * 99 / 100],
+            .frameMaxNs = maxNs,
+            .pollerReads = pollerReads,
+            .writes = writes,
+        };
+    }
+}
+
+namespace VideoConferenceBenchmark
+{
+    std::vector<CheckResult> RunSettingsChannelChecks(std::chrono::milliseconds stressDuration, unsigned int seed)
+    {
+        return { CheckTornReads(stressDuration, seed), CheckWriterExclusion(), CheckChangeDetection(), CheckStalledWriter() };
+    }
+
+    std::vector<SettingsChannelResult> RunSettingsChannelBenchmark(std::chrono::milliseconds duration, size_t pollers)
+    {
+        std::vector<SettingsChannelResult> results;
+        const std::wstring withPollers = L"frame + " + std::to_wstring(pollers) + L" pollers";
+        const std::tuple<std::wstring, size_t, bool> scenarios[] = {
+            { L"frame", 0, false },
+            { withPollers, pollers, false },
+            { withPollers + L" + writer", pollers, true },
+        };
+
+        for (const auto& [scenario, scenarioPollers, writer] : scenarios)
+        {
+            results.push_back(RunScenario<SpinlockClient, SpinlockChannel>(L"Spinlock", scenario, duration, scenarioPollers, writer));
+            results.push_back(RunScenario<VersionedClient, CameraSettingsUpdateChannel>(L"Versioned", scenario, duration, scenarioPollers, writer));
+        }
+
+        return results;
+    }
+}
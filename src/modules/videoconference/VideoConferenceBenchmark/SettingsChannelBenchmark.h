@@ -0,0 +1,30 @@
+#pragma once
+
+#include <common/utils/benchmark.h>
+
+namespace VideoConferenceBenchmark
+{
+    using benchmark::CheckResult;
+
+    // Torn reads, writer exclusion, skipped copies and stalled writers of the versioned settings channel, with threads
+    // reading and writing through their own views of a shared mapping
+    std::vector<CheckResult> RunSettingsChannelChecks(std::chrono::milliseconds stressDuration, unsigned int seed);
+
+    struct SettingsChannelResult
+    {
+        std::wstring channel;
+        std::wstring scenario;
+        // Reads of the frame thread, as SyncCurrentSettings does them
+        uint64_t frameReads = {};
+        double frameMeanNs = {};
+        double frameP99Ns = {};
+        double frameMaxNs = {};
+        // Reads of the threads polling the mute state and whether the camera is in use, as the keyboard hook does
+        uint64_t pollerReads = {};
+        uint64_t writes = {};
+    };
+
+    // The spinlock the channel used before against the versioned channel, for a frame thread alone, with pollers, and
+    // with pollers and a writer toggling the mute state
+    std::vector<SettingsChannelResult> RunSettingsChannelBenchmark(std::chrono::milliseconds duration, size_t pollers);
+}
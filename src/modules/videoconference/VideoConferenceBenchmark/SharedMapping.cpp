@@ -0,0 +1,85 @@
+#include "pch.h"
+#include "SharedMapping.h"
+
+#if defined(_WIN32)
+#include <wil/resource.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace VideoConferenceBenchmark
+{
+    struct SharedMapping::Impl
+    {
+        size_t size = 0;
+#if defined(_WIN32)
+        wil::unique_handle mapping;
+#else
+        // An anonymous file, mapped shared as the file mapping of the module is
+        int file = -1;
+#endif
+        std::vector<void*> views;
+    };
+
+    SharedMapping::SharedMapping(const size_t size) :
+        impl{ std::make_unique<Impl>() }
+    {
+        impl->size = size;
+#if defined(_WIN32)
+        impl->mapping.reset(CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(size), nullptr));
+        if (!impl->mapping)
+        {
+            throw std::runtime_error("failed to create a file mapping");
+        }
+#else
+        impl->file = memfd_create("VideoConferenceBenchmark", MFD_CLOEXEC);
+        if (impl->file == -1)
+        {
+            throw std::runtime_error("failed to create a file mapping");
+        }
+
+        if (ftruncate(impl->file, static_cast<off_t>(size)) != 0)
+        {
+            close(impl->file);
+            throw std::runtime_error("failed to create a file mapping");
+        }
+#endif
+    }
+
+    SharedMapping::~SharedMapping()
+    {
+        for (void* view : impl->views)
+        {
+#if defined(_WIN32)
+            UnmapViewOfFile(view);
+#else
+            munmap(view, impl->size);
+#endif
+        }
+
+#if !defined(_WIN32)
+        close(impl->file);
+#endif
+    }
+
+    uint8_t* SharedMapping::MapView()
+    {
+#if defined(_WIN32)
+        void* view = MapViewOfFile(impl->mapping.get(), FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, impl->size);
+#else
+        void* view = mmap(nullptr, impl->size, PROT_READ | PROT_WRITE, MAP_SHARED, impl->file, 0);
+        if (view == MAP_FAILED)
+        {
+            view = nullptr;
+        }
+#endif
+        if (!view)
+        {
+            throw std::runtime_error("failed to map a view of a file mapping");
+        }
+
+        impl->views.push_back(view);
+        return static_cast<uint8_t*>(view);
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace VideoConferenceBenchmark
+{
+    // Zero-filled memory shared like the module shares it with the proxy filter, mapped at a different address by
+    // every view, e.g. one per thread
+    class SharedMapping
+    {
+        struct Impl;
+        std::unique_ptr<Impl> impl;
+
+    public:
+        explicit SharedMapping(size_t size);
+        ~SharedMapping();
+
+        // Throws if the memory can't be mapped
+        uint8_t* MapView();
+    };
+}
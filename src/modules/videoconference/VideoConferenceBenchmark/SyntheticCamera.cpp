@@ -0,0 +1,147 @@
+#include "pch.h"
+#include "SyntheticCamera.h"
+
+#include <cstring>
+
+namespace VideoConferenceBenchmark
+{
+    const wchar_t* CameraFormatName(const CameraFormat format)
+    {
+        switch (format)
+        {
+        case CameraFormat::Mjpeg:
+            return L"MJPEG";
+        case CameraFormat::Nv12:
+            return L"NV12";
+        case CameraFormat::Yuy2:
+            return L"YUY2";
+        }
+
+        return L"";
+    }
+
+    std::optional<CameraFormat> ParseCameraFormat(const std::wstring_view name)
+    {
+        for (const auto format : { CameraFormat::Mjpeg, CameraFormat::Nv12, CameraFormat::Yuy2 })
+        {
+            if (name == CameraFormatName(format))
+            {
+                return format;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    size_t FrameBufferSize(const CameraFormat format, const uint32_t width, const uint32_t height)
+    {
+        const size_t pixels = static_cast<size_t>(width) * height;
+        switch (format)
+        {
+        case CameraFormat::Nv12:
+            return pixels * 3 / 2;
+        case CameraFormat::Mjpeg:
+        case CameraFormat::Yuy2:
+            return pixels * 2;
+        }
+
+        return 0;
+    }
+
+    size_t FramePayloadSize(const CameraFormat format, const uint32_t width, const uint32_t height)
+    {
+        // A typical MJPEG frame of a webcam compresses to about 1.2 bits per pixel
+        return format == CameraFormat::Mjpeg ? static_cast<size_t>(width) * height * 3 / 20 :
+                                               FrameBufferSize(format, width, height);
+    }
+
+    SyntheticCamera::SyntheticCamera(const CameraOptions& options, std::function<void(SyntheticFramePtr)> onFrame) :
+        _options{ options }, _onFrame{ std::move(onFrame) }, _pool{ std::make_shared<Pool>() }
+    {
+        const size_t bufferSize = FrameBufferSize(options.format, options.width, options.height);
+        const size_t payloadSize = FramePayloadSize(options.format, options.width, options.height);
+        for (size_t i = 0; i < options.buffers; ++i)
+        {
+            auto frame = std::make_unique<SyntheticFrame>();
+            frame->data.assign(bufferSize, static_cast<uint8_t>(0x80));
+            frame->length = payloadSize;
+            _pool->free.push_back(std::move(frame));
+        }
+    }
+
+    SyntheticCamera::~SyntheticCamera()
+    {
+        Stop();
+    }
+
+    void SyntheticCamera::Start()
+    {
+        if (!_thread.joinable())
+        {
+            _stopping = false;
+            _thread = std::thread{ [this] { Run(); } };
+        }
+    }
+
+    void SyntheticCamera::Stop()
+    {
+        _stopping = true;
+        if (_thread.joinable())
+        {
+            _thread.join();
+        }
+    }
+
+    uint64_t SyntheticCamera::Captured() const
+    {
+        return _captured;
+    }
+
+    uint64_t SyntheticCamera::Skipped() const
+    {
+        return _skipped;
+    }
+
+    SyntheticFramePtr SyntheticCamera::Acquire()
+    {
+        std::unique_lock lock{ _pool->mutex };
+        if (_pool->free.empty())
+        {
+            return nullptr;
+        }
+
+        SyntheticFrame* frame = _pool->free.back().release();
+        _pool->free.pop_back();
+        return SyntheticFramePtr{ frame, [pool = _pool](SyntheticFrame* released) {
+                                     std::unique_lock lock{ pool->mutex };
+                                     pool->free.emplace_back(released);
+                                 } };
+    }
+
+    void SyntheticCamera::Run()
+    {
+        using Clock = std::chrono::steady_clock;
+        const auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{ 1.0 / _options.fps });
+        auto next = Clock::now();
+        uint64_t sequence = 0;
+        while (!_stopping)
+        {
+            next += interval;
+            std::this_thread::sleep_until(next);
+
+            auto frame = Acquire();
+            if (!frame)
+            {
+                ++_skipped;
+                continue;
+            }
+
+            frame->sequence = ++sequence;
+            frame->length = FramePayloadSize(_options.format, _options.width, _options.height);
+            std::memcpy(frame->data.data(), &frame->sequence, sizeof(frame->sequence));
+            frame->captured = Clock::now();
+            ++_captured;
+            _onFrame(std::move(frame));
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <string_view>
+
+namespace VideoConferenceBenchmark
+{
+    enum class CameraFormat
+    {
+        Mjpeg,
+        Nv12,
+        Yuy2,
+    };
+
+    const wchar_t* CameraFormatName(CameraFormat format);
+    std::optional<CameraFormat> ParseCameraFormat(std::wstring_view name);
+
+    // The size of the frame buffers of a camera, which MJPEG cameras allocate for the largest frame
+    size_t FrameBufferSize(CameraFormat format, uint32_t width, uint32_t height);
+    // The bytes a frame holds, smaller than the buffer for MJPEG
+    size_t FramePayloadSize(CameraFormat format, uint32_t width, uint32_t height);
+
+    struct SyntheticFrame
+    {
+        std::vector<uint8_t> data;
+        size_t length = 0;
+        uint64_t sequence = 0;
+        std::chrono::steady_clock::time_point captured;
+    };
+
+    using SyntheticFramePtr = std::shared_ptr<SyntheticFrame>;
+
+    struct CameraOptions
+    {
+        CameraFormat format = CameraFormat::Mjpeg;
+        uint32_t width = 1920;
+        uint32_t height = 1080;
+        double fps = 30;
+        // Frames of the camera's allocator
+        size_t buffers = 4;
+    };
+
+    // Captures frames into a pool of buffers like a webcam's allocator at the frame rate, and hands them to the callback
+    // on its own thread. A frame returns to the pool when the last handle to it is released. The camera skips a frame
+    // when no buffer is free, as webcams do. Every frame starts with its sequence number.
+    class SyntheticCamera
+    {
+    public:
+        SyntheticCamera(const CameraOptions& options, std::function<void(SyntheticFramePtr)> onFrame);
+        ~SyntheticCamera();
+
+        SyntheticCamera(const SyntheticCamera&) = delete;
+        SyntheticCamera& operator=(const SyntheticCamera&) = delete;
+
+        void Start();
+        void Stop();
+
+        uint64_t Captured() const;
+        uint64_t Skipped() const;
+
+    private:
+        struct Pool
+        {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<SyntheticFrame>> free;
+        };
+
+        SyntheticFramePtr Acquire();
+        void Run();
+
+        CameraOptions _options;
+        std::function<void(SyntheticFramePtr)> _onFrame;
+        std::shared_ptr<Pool> _pool;
+        std::atomic_bool _stopping = false;
+        std::atomic<uint64_t> _captured = 0;
+        std::atomic<uint64_t> _skipped = 0;
+        std::thread _thread;
+    };
+}
@@ -0,0 +1,435 @@
+#include "pch.h"
+
+#include <iostream>
+#include <string_view>
+
+#include "ColorConversionBenchmark.h"
+#include "FrameLatencyBenchmark.h"
+#include "HotkeyBenchmark.h"
+#include "LoggingBenchmark.h"
+#include "MuteDispatchBenchmark.h"
+#include "OverlayDeliveryBenchmark.h"
+#include "OverlayPreparationBenchmark.h"
+#include "SettingsChannelBenchmark.h"
+
+using namespace VideoConferenceBenchmark;
+
+namespace
+{
+    struct Options
+    {
+        // How long the threads hammer the settings channel for the checks
+        uint32_t stressMs = 2000;
+        // How long every contention scenario runs
+        uint32_t durationMs = 1000;
+        // Threads polling the settings like the keyboard hook
+        size_t pollers = 2;
+        // How long the camera is muted and unmuted for every overlay preparation
+        uint32_t latencyMs = 3000;
+        // How long loading the overlay once takes
+        uint32_t encodeMs = 40;
+        // How long every color conversion case runs
+        uint32_t conversionMs = 200;
+        // Muted frames delivered in every overlay delivery case
+        uint32_t deliveryFrames = 900;
+        // Lines every thread logs in every logging case
+        uint32_t logCalls = 20000;
+        // How long the synthetic camera runs for every frame latency case
+        uint32_t cameraMs = 2000;
+        double cameraFps = 30;
+        // All formats at their typical resolutions unless set
+        std::optional<CameraFormat> cameraFormat;
+        std::optional<std::pair<uint32_t, uint32_t>> cameraSize;
+        // Events of the synthesized keystroke stream, unless a recorded one is replayed
+        size_t keyEvents = 200000;
+        std::optional<std::filesystem::path> keystrokes;
+        // Microphone toggles in every mute dispatch case
+        uint32_t muteToggles = 20;
+        unsigned int seed = 42;
+    };
+
+    void PrintUsage()
+    {
+        std::wcout << L"Usage: VideoConferenceBenchmark.exe [options]\n"
+                   << L"  --stress-ms <n>         duration of the settings channel stress check (default 2000)\n"
+                   << L"  --duration-ms <n>       duration of every settings channel scenario (default 1000)\n"
+                   << L"  --pollers <n>           threads polling the settings while frames are read (default 2)\n"
+                   << L"  --latency-ms <n>        duration of every mute toggle scenario (default 3000)\n"
+                   << L"  --encode-ms <n>         simulated duration of loading the overlay once (default 40)\n"
+                   << L"  --conversion-ms <n>     duration of every color conversion case (default 200)\n"
+                   << L"  --delivery-frames <n>   muted frames delivered in every overlay delivery case (default 900)\n"
+                   << L"  --log-calls <n>         lines logged by every thread in every logging case (default 20000)\n"
+                   << L"  --camera-ms <n>         duration of every frame latency case (default 2000)\n"
+                   << L"  --camera-fps <n>        frame rate of the synthetic camera (default 30)\n"
+                   << L"  --camera-format <f>     MJPEG, NV12 or YUY2 (default all of them)\n"
+                   << L"  --camera-size <w>x<h>   resolution of the synthetic camera (default 1920x1080, 1280x720 for YUY2)\n"
+                   << L"  --key-events <n>        events of the synthesized keystroke stream (default 200000)\n"
+                   << L"  --keystrokes <path>     recorded keystroke stream to replay, \"<code> down|up\" per line\n"
+                   << L"  --mute-toggles <n>      microphone toggles in every mute dispatch case (default 20)\n"
+                   << L"  --seed <n>              random seed (default 42)\n";
+    }
+
+    bool ParseOptions(int argc, wchar_t* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::wstring arg = argv[i];
+            if (i + 1 >= argc)
+            {
+                return false;
+            }
+
+            const std::wstring value = argv[++i];
+            try
+            {
+                if (arg == L"--stress-ms")
+                {
+                    options.stressMs = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--duration-ms")
+                {
+                    options.durationMs = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--pollers")
+                {
+                    options.pollers = std::stoull(value);
+                }
+                else if (arg == L"--latency-ms")
+                {
+                    options.latencyMs = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--encode-ms")
+                {
+                    options.encodeMs = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--conversion-ms")
+                {
+                    options.conversionMs = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--delivery-frames")
+                {
+                    options.deliveryFrames = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--log-calls")
+                {
+                    options.logCalls = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--camera-ms")
+                {
+                    options.cameraMs = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--camera-fps")
+                {
+                    options.cameraFps = std::stod(value);
+                }
+                else if (arg == L"--camera-format")
+                {
+                    options.cameraFormat = ParseCameraFormat(value);
+                    if (!options.cameraFormat)
+                    {
+                        return false;
+                    }
+                }
+                else if (arg == L"--camera-size")
+                {
+                    const auto separator = value.find(L'x');
+                    if (separator == std::wstring::npos)
+                    {
+                        return false;
+                    }
+
+                    options.cameraSize.emplace(static_cast<uint32_t>(std::stoul(value.substr(0, separator))),
+                                               static_cast<uint32_t>(std::stoul(value.substr(separator + 1))));
+                }
+                else if (arg == L"--key-events")
+                {
+                    options.keyEvents = std::stoull(value);
+                }
+                else if (arg == L"--keystrokes")
+                {
+                    options.keystrokes = value;
+                }
+                else if (arg == L"--mute-toggles")
+                {
+                    options.muteToggles = static_cast<uint32_t>(std::stoul(value));
+                }
+                else if (arg == L"--seed")
+                {
+                    options.seed = static_cast<unsigned int>(std::stoul(value));
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+        }
+
+        return options.durationMs > 0 && options.latencyMs > 0 && options.deliveryFrames > 0 && options.logCalls > 0 && options.cameraMs > 0 &&
+               options.cameraFps > 0 && options.keyEvents > 0 && options.muteToggles > 0 &&
+               (!options.cameraSize || (options.cameraSize->first > 0 && options.cameraSize->second > 0));
+    }
+
+    int Run(int argc, wchar_t* argv[])
+    {
+        Options options;
+        if (!ParseOptions(argc, argv, options))
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        std::vector<CameraOptions> cameras;
+        for (const auto format : { CameraFormat::Mjpeg, CameraFormat::Nv12, CameraFormat::Yuy2 })
+        {
+            if (options.cameraFormat && format != *options.cameraFormat)
+            {
+                continue;
+            }
+
+            CameraOptions camera{ format };
+            camera.fps = options.cameraFps;
+            if (options.cameraSize)
+            {
+                camera.width = options.cameraSize->first;
+                camera.height = options.cameraSize->second;
+            }
+            else if (format == CameraFormat::Yuy2)
+            {
+                camera.width = 1280;
+                camera.height = 720;
+            }
+
+            cameras.push_back(camera);
+        }
+
+        std::vector<KeyEvent> keystrokes;
+        try
+        {
+            keystrokes = options.keystrokes ? LoadKeystrokes(*options.keystrokes) : SynthesizeKeystrokes(options.keyEvents, options.seed);
+        }
+        catch (const std::exception& e)
+        {
+            std::wcerr << e.what() << L"\n";
+            return 1;
+        }
+
+        size_t failures = 0;
+        wprintf(L"Settings channel checks\n\n");
+        for (const auto& result : RunSettingsChannelChecks(std::chrono::milliseconds{ options.stressMs }, options.seed))
+        {
+            wprintf(L"%-24ls %10zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        wprintf(L"\nOverlay preparation checks\n\n");
+        for (const auto& result : RunOverlayPreparationChecks(options.seed))
+        {
+            wprintf(L"%-24ls %10zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        wprintf(L"\nColor conversion checks\n\n");
+        for (const auto& result : RunColorConversionChecks(options.seed))
+        {
+            wprintf(L"%-24ls %10zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        wprintf(L"\nOverlay delivery checks\n\n");
+        for (const auto& result : RunOverlayDeliveryChecks(options.seed))
+        {
+            wprintf(L"%-24ls %10zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        wprintf(L"\nLogging checks\n\n");
+        for (const auto& result : RunLoggingChecks(options.seed))
+        {
+            wprintf(L"%-24ls %10zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        wprintf(L"\nFrame latency checks\n\n");
+        for (const auto& result : RunFrameLatencyChecks())
+        {
+            wprintf(L"%-24ls %10zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        wprintf(L"\nHotkey checks\n\n");
+        for (const auto& result : RunHotkeyChecks(options.seed))
+        {
+            wprintf(L"%-24ls %10zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        wprintf(L"\nMute dispatch checks\n\n");
+        for (const auto& result : RunMuteDispatchChecks())
+        {
+            wprintf(L"%-24ls %10zu cases %6zu failures\n", result.name.c_str(), result.cases, result.failures);
+            failures += result.failures;
+        }
+
+        wprintf(L"\nSettings channel contention, %u ms per scenario, %u threads\n\n", options.durationMs, std::thread::hardware_concurrency());
+        for (const auto& result : RunSettingsChannelBenchmark(std::chrono::milliseconds{ options.durationMs }, options.pollers))
+        {
+            wprintf(L"%-10ls %-24ls %11llu frame reads %9.1f ns mean %9.1f ns p99 %11.1f ns max %11llu poller reads %6llu writes\n",
+                    result.channel.c_str(),
+                    result.scenario.c_str(),
+                    static_cast<unsigned long long>(result.frameReads),
+                    result.frameMeanNs,
+                    result.frameP99Ns,
+                    result.frameMaxNs,
+                    static_cast<unsigned long long>(result.pollerReads),
+                    static_cast<unsigned long long>(result.writes));
+        }
+
+        MuteToggleOptions muteToggle;
+        muteToggle.duration = std::chrono::milliseconds{ options.latencyMs };
+        muteToggle.encodeCost = std::chrono::milliseconds{ options.encodeMs };
+        wprintf(L"\nMute toggles, %lld ms frames, muted and unmuted every %lld ms, %lld ms overlay loads\n\n",
+                static_cast<long long>(muteToggle.frameInterval.count()),
+                static_cast<long long>(muteToggle.toggleInterval.count()),
+                static_cast<long long>(muteToggle.encodeCost.count()));
+        for (const auto& result : RunMuteToggleBenchmark(muteToggle))
+        {
+            wprintf(L"%-8ls %6llu frames %6llu muted %6llu blank %5llu loads on frame thread %8.2f ms p99 %8.2f ms max %8.2f ms max after muting\n",
+                    result.preparation.c_str(),
+                    static_cast<unsigned long long>(result.frames),
+                    static_cast<unsigned long long>(result.mutedFrames),
+                    static_cast<unsigned long long>(result.blankFrames),
+                    static_cast<unsigned long long>(result.encodesOnFrameThread),
+                    result.frameP99Ms,
+                    result.frameMaxMs,
+                    result.toggleMaxMs);
+        }
+
+        wprintf(L"\nColor conversion from BGR24, at least %u ms per case\n\n", options.conversionMs);
+        for (const auto& result : RunColorConversionBenchmark(std::chrono::milliseconds{ options.conversionMs }, options.seed))
+        {
+            wprintf(L"%-6ls %-7ls %5ux%-5u %6zu frames %9.3f ms/frame %9.1f Mpx/s\n",
+                    result.format.c_str(),
+                    result.path.c_str(),
+                    result.width,
+                    result.height,
+                    result.frames,
+                    result.msPerFrame,
+                    result.megapixelsPerSecond);
+        }
+
+        wprintf(L"\nMuted frame delivery, %u frames per case, the overlay changing halfway\n\n", options.deliveryFrames);
+        for (const auto& result : RunOverlayDeliveryBenchmark(options.deliveryFrames))
+        {
+            wprintf(L"%-9ls %-11ls %9zu byte overlay %6llu copies %6llu reused %12.0f bytes/frame %8.1f MB/s at 30 fps %9.2f us/frame\n",
+                    result.delivery.c_str(),
+                    result.format.c_str(),
+                    result.overlaySize,
+                    static_cast<unsigned long long>(result.copies),
+                    static_cast<unsigned long long>(result.reuses),
+                    result.bytesPerFrame,
+                    result.megabytesPerSecond,
+                    result.usPerFrame);
+        }
+
+        wprintf(L"\nLogging cost on the calling thread, %u lines per thread\n\n", options.logCalls);
+        for (const auto& result : RunLoggingBenchmark(options.logCalls))
+        {
+            wprintf(L"%-12ls %2zu threads %8llu calls %10.0f ns mean %10.0f ns p99 %12.0f ns max %6llu dropped\n",
+                    result.logger.c_str(),
+                    result.threads,
+                    static_cast<unsigned long long>(result.calls),
+                    result.callMeanNs,
+                    result.callP99Ns,
+                    result.callMaxNs,
+                    static_cast<unsigned long long>(result.dropped));
+        }
+
+        wprintf(L"\nFrame latency added by the proxy filter, synthetic camera, %u ms per case\n\n", options.cameraMs);
+        for (const auto& result : RunFrameLatencyBenchmark(cameras, std::chrono::milliseconds{ options.cameraMs }))
+        {
+            wprintf(L"%-11ls %-5ls %5ux%-5u %5.1f fps %6llu captured %6llu delivered %5llu replaced %5llu skipped %9.1f us p50 %9.1f us p99 %9.1f us max %9.1f us CPU/frame\n",
+                    result.delivery.c_str(),
+                    CameraFormatName(result.camera.format),
+                    result.camera.width,
+                    result.camera.height,
+                    result.camera.fps,
+                    static_cast<unsigned long long>(result.captured),
+                    static_cast<unsigned long long>(result.delivered),
+                    static_cast<unsigned long long>(result.replaced),
+                    static_cast<unsigned long long>(result.skipped),
+                    result.p50Us,
+                    result.p99Us,
+                    result.maxUs,
+                    result.cpuUsPerFrame);
+        }
+
+        // Enough rounds of a short recorded stream for a stable measurement
+        const auto keyRounds = static_cast<uint32_t>(std::max<size_t>(1, 1000000 / std::max<size_t>(1, keystrokes.size())));
+        wprintf(L"\nHotkey matching in the keyboard hook, %zu events %ls, %u rounds\n\n",
+                keystrokes.size(),
+                options.keystrokes ? L"recorded" : L"synthesized",
+                keyRounds);
+        for (const auto& result : RunHotkeyBenchmark(keystrokes, keyRounds))
+        {
+            wprintf(L"%-9ls %10llu events %7llu hotkeys %8.1f ns/event %6.3f key states/event %6.3f settings lookups/event\n",
+                    result.matcher.c_str(),
+                    static_cast<unsigned long long>(result.events),
+                    static_cast<unsigned long long>(result.matches),
+                    result.nsPerEvent,
+                    result.keyStatesPerEvent,
+                    result.settingsLookupsPerEvent);
+        }
+
+        wprintf(L"\nMicrophone toggles in the keyboard hook, %u toggles per case\n\n", options.muteToggles);
+        for (const auto& result : RunMuteDispatchBenchmark(options.muteToggles))
+        {
+            wprintf(L"%-10ls %2zu devices %8.1f ms latency %4llu toggles %4llu applies %10.1f us p50 in hook %10.1f us max in hook %8.1f ms until applied\n",
+                    result.dispatch.c_str(),
+                    result.devices,
+                    std::chrono::duration<double, std::milli>(result.deviceLatency).count(),
+                    static_cast<unsigned long long>(result.toggles),
+                    static_cast<unsigned long long>(result.applies),
+                    result.hookP50Us,
+                    result.hookMaxUs,
+                    result.appliedMeanMs);
+        }
+
+        if (failures != 0)
+        {
+            std::wcerr << L"\n" << failures << L" checks failed\n";
+            return 1;
+        }
+
+        return 0;
+    }
+}
+
+#ifdef _WIN32
+int wmain(int argc, wchar_t* argv[])
+{
+    return Run(argc, argv);
+}
+#else
+// The options are ASCII
+int main(int argc, char* argv[])
+{
+    std::vector<std::wstring> arguments;
+    for (int i = 0; i < argc; i++)
+    {
+        const std::string_view argument = argv[i];
+        arguments.emplace_back(argument.begin(), argument.end());
+    }
+
+    std::vector<wchar_t*> pointers;
+    for (auto& argument : arguments)
+    {
+        pointers.push_back(argument.data());
+    }
+
+    return Run(argc, pointers.data());
+}
+#endif
@@ -0,0 +1,13 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by VideoConferenceBenchmark.rc
+
+//////////////////////////////
+// Non-localizable
+
+#define FILE_DESCRIPTION "PowerToys Video Conference Benchmark"
+#define INTERNAL_NAME "VideoConferenceBenchmark"
+#define ORIGINAL_FILENAME "VideoConferenceBenchmark.exe"
+
+// Non-localizable
+//////////////////////////////
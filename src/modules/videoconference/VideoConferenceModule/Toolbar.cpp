@@ -357,11 +357,10 @@ bool Toolbar::getCameraMute()
 
 void Toolbar::setCameraMute(bool mute)
 {
-    if (mute != cameraMuted)
+    if (cameraMuted.exchange(mute) != mute)
     {
         lastTimeCamOrMicMuteStateChanged = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
     }
-    cameraMuted = mute;
 }
 
 bool Toolbar::getMicrophoneMute()
@@ -371,12 +370,10 @@ bool Toolbar::getMicrophoneMute()
 
 void Toolbar::setMicrophoneMute(bool mute)
 {
-    if (mute != microphoneMuted)
+    if (microphoneMuted.exchange(mute) != mute)
     {
         lastTimeCamOrMicMuteStateChanged = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
     }
-
-    microphoneMuted = mute;
 }
 
 void Toolbar::setToolbarHide(std::wstring hide)
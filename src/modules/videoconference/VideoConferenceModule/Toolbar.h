@@ -47,16 +47,17 @@ private:
     ToolbarImages lightImages;
     AudioDeviceNotificationClient audioConfChangesNotifier;
 
-    bool cameraMuted = false;
+    // Written by the mute dispatcher thread as well as the toolbar thread
+    std::atomic_bool cameraMuted = false;
     bool cameraInUse = false;
     bool previouscameraInUse = false;
-    bool microphoneMuted = false;
+    std::atomic_bool microphoneMuted = false;
 
     std::wstring theme = L"system";
 
     std::wstring ToolbarHide = L"When both camera and microphone are unmuted";
 
-    uint64_t lastTimeCamOrMicMuteStateChanged{};
+    std::atomic<uint64_t> lastTimeCamOrMicMuteStateChanged{};
 
     std::atomic_bool moduleSettingsUpdateScheduled = false;
     std::atomic_bool generalSettingsUpdateScheduled = false;
@@ -27,6 +27,7 @@ VideoConferenceModule* instance = nullptr;
 VideoConferenceSettings VideoConferenceModule::settings;
 Toolbar VideoConferenceModule::toolbar;
 bool VideoConferenceModule::pushToTalkPressed = false;
+HotkeyMatcher<HotkeyAction> VideoConferenceModule::hotkeys;
 
 HHOOK VideoConferenceModule::hook_handle;
 
@@ -39,85 +40,121 @@ bool VideoConferenceModule::isKeyPressed(unsigned int keyCode)
 
 namespace fs = std::filesystem;
 
-bool VideoConferenceModule::isHotkeyPressed(DWORD code, PowerToysSettings::HotkeyObject& hotkey)
+uint8_t VideoConferenceModule::readModifierKeys()
 {
-    return code == hotkey.get_code() &&
-           isKeyPressed(VK_SHIFT) == hotkey.shift_pressed() &&
-           isKeyPressed(VK_CONTROL) == hotkey.ctrl_pressed() &&
-           isKeyPressed(VK_LWIN) == hotkey.win_pressed() &&
-           (isKeyPressed(VK_LMENU)) == hotkey.alt_pressed();
+    uint8_t keysDown = 0;
+    for (const auto key : ModifierKeys::KEYS)
+    {
+        if (isKeyPressed(key))
+        {
+            keysDown |= ModifierKeys::key_bit(key);
+        }
+    }
+
+    return keysDown;
+}
+
+void VideoConferenceModule::compileHotkeys()
+{
+    const auto add = [](const PowerToysSettings::HotkeyObject& hotkey, const HotkeyAction action) {
+        uint8_t modifiers = 0;
+        modifiers |= hotkey.shift_pressed() ? HotkeyModifiers::Shift : 0;
+        modifiers |= hotkey.ctrl_pressed() ? HotkeyModifiers::Control : 0;
+        modifiers |= hotkey.win_pressed() ? HotkeyModifiers::Win : 0;
+        modifiers |= hotkey.alt_pressed() ? HotkeyModifiers::Alt : 0;
+        hotkeys.add(hotkey.get_code(), modifiers, action);
+    };
+
+    // From the highest priority down, in the order the hook checked them before
+    hotkeys.clear();
+    add(settings.cameraAndMicrophoneMuteHotkey, HotkeyAction::MuteCameraAndMicrophone);
+    add(settings.microphoneMuteHotkey, HotkeyAction::MuteMicrophone);
+    add(settings.microphonePushToTalkHotkey, HotkeyAction::PushToTalk);
+    add(settings.cameraMuteHotkey, HotkeyAction::MuteCamera);
 }
 
 void VideoConferenceModule::reverseMicrophoneMute()
 {
     // All controlled mic should same state with _microphoneTrackedInUI
     // Avoid manually change in Control Panel make controlled mic has different state
-    bool muted = !getMicrophoneMuteState();
-    for (auto& controlledMic : instance->_controlledMicrophones)
-    {
-        controlledMic->set_muted(muted);
-    }
-    if (muted)
-    {
-        Trace::MicrophoneMuted();
-    }
+    const bool muted = !getMicrophoneMuteState();
     instance->_mic_muted_state_during_disconnect = !instance->_mic_muted_state_during_disconnect;
-
-    toolbar.setMicrophoneMute(muted);
+    instance->_muteDispatcher.request({ .microphone = muted });
 }
 
 bool VideoConferenceModule::getMicrophoneMuteState()
 {
+    if (const auto target = instance->_muteDispatcher.targets().microphone)
+    {
+        return *target;
+    }
+
     return instance->_microphoneTrackedInUI ? instance->_microphoneTrackedInUI->muted() : instance->_mic_muted_state_during_disconnect;
 }
 
 void VideoConferenceModule::reverseVirtualCameraMuteState()
 {
-    bool muted = false;
-    if (!instance->_settingsUpdateChannel.has_value())
+    if (!instance->settingsChannel())
     {
         return;
     }
 
-    instance->_settingsUpdateChannel->access([&muted](auto settingsMemory) {
-        auto settings = reinterpret_cast<CameraSettingsUpdateChannel*>(settingsMemory._data);
-        settings->useOverlayImage = !settings->useOverlayImage;
-        muted = settings->useOverlayImage;
-    });
+    instance->_muteDispatcher.request({ .camera = !getVirtualCameraMuteState() });
+}
 
-    if (muted)
+bool VideoConferenceModule::getVirtualCameraMuteState()
+{
+    if (const auto target = instance->_muteDispatcher.targets().camera)
     {
-        Trace::CameraMuted();
+        return *target;
     }
-    toolbar.setCameraMute(muted);
+
+    auto channel = instance->settingsChannel();
+    return channel && channel->settings.read().useOverlayImage;
 }
 
-bool VideoConferenceModule::getVirtualCameraMuteState()
+void VideoConferenceModule::applyMicrophoneMute(const bool muted, const MuteDispatcher::ForEach& forEach)
 {
-    bool disabled = false;
-    if (!instance->_settingsUpdateChannel.has_value())
+    std::unique_lock lock{ _controlledMicrophonesMutex };
+    forEach(_controlledMicrophones.size(), [this, muted](const size_t i) {
+        _controlledMicrophones[i]->set_muted(muted);
+    });
+}
+
+void VideoConferenceModule::applyVirtualCameraMute(const bool muted)
+{
+    if (auto channel = settingsChannel())
     {
-        return disabled;
+        channel->settings.update([muted](CameraSettings& settings) {
+            settings.useOverlayImage = muted;
+        });
     }
-    instance->_settingsUpdateChannel->access([&disabled](auto settingsMemory) {
-        auto settings = reinterpret_cast<CameraSettingsUpdateChannel*>(settingsMemory._data);
-        disabled = settings->useOverlayImage;
-    });
-    return disabled;
 }
 
-bool VideoConferenceModule::getVirtualCameraInUse()
+void VideoConferenceModule::muteApplied(const MuteDispatcher::Device device, const bool muted)
 {
-    if (!instance->_settingsUpdateChannel.has_value())
+    if (device == MuteDispatcher::Device::Microphone)
     {
-        return false;
+        if (muted)
+        {
+            Trace::MicrophoneMuted();
+        }
+        toolbar.setMicrophoneMute(muted);
+    }
+    else
+    {
+        if (muted)
+        {
+            Trace::CameraMuted();
+        }
+        toolbar.setCameraMute(muted);
     }
-    bool inUse = false;
-    instance->_settingsUpdateChannel->access([&inUse](auto settingsMemory) {
-        auto settings = reinterpret_cast<CameraSettingsUpdateChannel*>(settingsMemory._data);
-        inUse = settings->cameraInUse;
-    });
-    return inUse;
+}
+
+bool VideoConferenceModule::getVirtualCameraInUse()
+{
+    auto channel = instance->settingsChannel();
+    return channel && channel->cameraInUse.load(std::memory_order_relaxed);
 }
 
 LRESULT CALLBACK VideoConferenceModule::LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam)
@@ -125,11 +162,13 @@ LRESULT CALLBACK VideoConferenceModule::LowLevelKeyboardProc(int nCode, WPARAM w
     if (nCode == HC_ACTION)
     {
         KBDLLHOOKSTRUCT* kbd = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
+        hotkeys.on_key(kbd->vkCode, wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN);
         switch (wParam)
         {
         case WM_KEYDOWN:
-
-            if (isHotkeyPressed(kbd->vkCode, settings.cameraAndMicrophoneMuteHotkey))
+            switch (hotkeys.match(kbd->vkCode, readModifierKeys))
+            {
+            case HotkeyAction::MuteCameraAndMicrophone:
             {
                 const bool cameraInUse = getVirtualCameraInUse();
                 const bool microphoneIsMuted = getMicrophoneMuteState();
@@ -159,13 +198,10 @@ LRESULT CALLBACK VideoConferenceModule::LowLevelKeyboardProc(int nCode, WPARAM w
                 }
                 return 1;
             }
-            else if (isHotkeyPressed(kbd->vkCode, settings.microphoneMuteHotkey))
-            {
+            case HotkeyAction::MuteMicrophone:
                 reverseMicrophoneMute();
                 return 1;
-            }
-            else if (isHotkeyPressed(kbd->vkCode, settings.microphonePushToTalkHotkey))
-            {
+            case HotkeyAction::PushToTalk:
                 if (!pushToTalkPressed)
                 {
                     if (settings.pushToReverseEnabled || getMicrophoneMuteState())
@@ -175,11 +211,11 @@ LRESULT CALLBACK VideoConferenceModule::LowLevelKeyboardProc(int nCode, WPARAM w
                     pushToTalkPressed = true;
                 }
                 return 1;
-            }
-            else if (isHotkeyPressed(kbd->vkCode, settings.cameraMuteHotkey))
-            {
+            case HotkeyAction::MuteCamera:
                 reverseVirtualCameraMuteState();
                 return 1;
+            case HotkeyAction::None:
+                break;
             }
             break;
         case WM_KEYUP:
@@ -261,6 +297,7 @@ void VideoConferenceModule::onModuleSettingsChanged()
             {
                 settings.cameraMuteHotkey = PowerToysSettings::HotkeyObject::from_json(*val);
             }
+            compileHotkeys();
             if (const auto val = values.get_string_value(L"toolbar_position"))
             {
                 settings.toolbarPositionString = val.value();
@@ -313,6 +350,7 @@ void VideoConferenceModule::onMicrophoneConfigurationChanged()
     }
 
     const bool mutedStateForNewMics = getMicrophoneMuteState();
+    std::unique_lock lock{ _controlledMicrophonesMutex };
     std::unordered_set<std::wstring_view> currentlyTrackedMicsIds;
     for (const auto& controlledMic : _controlledMicrophones)
     {
@@ -344,7 +382,26 @@ void VideoConferenceModule::onMicrophoneConfigurationChanged()
     }
 }
 
-VideoConferenceModule::VideoConferenceModule()
+CameraSettingsUpdateChannel* VideoConferenceModule::settingsChannel() const
+{
+    return _settingsUpdateChannel ? reinterpret_cast<CameraSettingsUpdateChannel*>(_settingsUpdateChannel->data()) : nullptr;
+}
+
+VideoConferenceModule::VideoConferenceModule() :
+    _muteDispatcher{ MuteDispatcher::Handlers{
+        .run_thread =
+            [](const std::function<void()>& body) {
+                // The audio endpoints are free-threaded
+                const bool comInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+                body();
+                if (comInitialized)
+                {
+                    CoUninitialize();
+                }
+            },
+        .mute_microphones = [this](const bool muted, const MuteDispatcher::ForEach& forEach) { applyMicrophoneMute(muted, forEach); },
+        .mute_camera = [this](const bool muted) { applyVirtualCameraMute(muted); },
+        .applied = [](const MuteDispatcher::Device device, const bool muted) { muteApplied(device, muted); } } }
 {
     init_settings();
     _settingsUpdateChannel =
@@ -466,6 +523,8 @@ void VideoConferenceModule::init_settings()
         // Error while loading from the settings file. Just let default values stay as they are.
     }
 
+    compileHotkeys();
+
     try
     {
         auto loaded = PTSettingsHelper::load_general_settings();
@@ -483,6 +542,7 @@ void VideoConferenceModule::init_settings()
 
 void VideoConferenceModule::updateControlledMicrophones(const std::wstring_view new_mic)
 {
+    std::unique_lock lock{ _controlledMicrophonesMutex };
     for (auto& controlledMic : _controlledMicrophones)
     {
         controlledMic->set_muted(false);
@@ -609,6 +669,7 @@ void VideoConferenceModule::enable()
             return;
         }
 #endif
+        hotkeys.resync(readModifierKeys());
         hook_handle = SetWindowsHookEx(WH_KEYBOARD_LL, LowLevelKeyboardProc, GetModuleHandle(NULL), NULL);
     }
 }
@@ -675,6 +736,7 @@ void VideoConferenceModule::destroy()
 {
     delete this;
     instance = nullptr;
+    StopLogging();
 }
 
 bool VideoConferenceModule::is_enabled_by_default() const
@@ -684,28 +746,29 @@ bool VideoConferenceModule::is_enabled_by_default() const
 
 void VideoConferenceModule::sendSourceCameraNameUpdate()
 {
-    if (!_settingsUpdateChannel.has_value() || settings.selectedCamera.empty())
+    auto channel = settingsChannel();
+    if (!channel || settings.selectedCamera.empty())
     {
         return;
     }
-    _settingsUpdateChannel->access([](auto memory) {
-        auto updatesChannel = reinterpret_cast<CameraSettingsUpdateChannel*>(memory._data);
-        updatesChannel->sourceCameraName.emplace();
-        std::copy(begin(settings.selectedCamera), end(settings.selectedCamera), begin(*updatesChannel->sourceCameraName));
+    channel->settings.update([](CameraSettings& channelSettings) {
+        channelSettings.sourceCameraName.emplace();
+        std::copy(begin(settings.selectedCamera), end(settings.selectedCamera), begin(*channelSettings.sourceCameraName));
         if (settings.startupAction == L"Unmute")
         {
-            updatesChannel->useOverlayImage = false;
+            channelSettings.useOverlayImage = false;
         }
         else if (settings.startupAction == L"Mute")
         {
-            updatesChannel->useOverlayImage = true;
+            channelSettings.useOverlayImage = true;
         }
     });
 }
 
 void VideoConferenceModule::sendOverlayImageUpdate()
 {
-    if (!_settingsUpdateChannel.has_value())
+    auto channel = settingsChannel();
+    if (!channel)
     {
         return;
     }
@@ -723,9 +786,8 @@ void VideoConferenceModule::sendOverlayImageUpdate()
                                                                    settings.imageOverlayPath != L"" ? settings.imageOverlayPath : blankImagePath);
 
     const auto imageSize = static_cast<uint32_t>(_imageOverlayChannel->size());
-    _settingsUpdateChannel->access([imageSize](auto memory) {
-        auto updatesChannel = reinterpret_cast<CameraSettingsUpdateChannel*>(memory._data);
-        updatesChannel->overlayImageSize.emplace(imageSize);
-        updatesChannel->newOverlayImagePosted = true;
+    channel->settings.update([imageSize](CameraSettings& channelSettings) {
+        channelSettings.overlayImageSize.emplace(imageSize);
+        channelSettings.overlayImageGeneration++;
     });
 }
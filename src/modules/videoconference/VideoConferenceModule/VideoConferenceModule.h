@@ -12,6 +12,9 @@
 
 #include "Toolbar.h"
 
+#include <CameraStateUpdateChannels.h>
+#include <HotkeyMatcher.h>
+#include <MuteDispatcher.h>
 #include <SerializedSharedMemory.h>
 
 extern class VideoConferenceModule* instance;
@@ -35,6 +38,15 @@ struct VideoConferenceSettings
     bool pushToReverseEnabled = false;
 };
 
+enum class HotkeyAction : uint8_t
+{
+    None,
+    MuteCameraAndMicrophone,
+    MuteMicrophone,
+    PushToTalk,
+    MuteCamera,
+};
+
 class VideoConferenceModule : public PowertoyModuleIface
 {
 public:
@@ -76,17 +88,28 @@ private:
     void init_settings();
     void updateControlledMicrophones(const std::wstring_view new_mic);
     MicrophoneDevice* controlledDefaultMic();
+    CameraSettingsUpdateChannel* settingsChannel() const;
+
+    // Called by the mute dispatcher on its threads
+    void applyMicrophoneMute(bool muted, const MuteDispatcher::ForEach& forEach);
+    void applyVirtualCameraMute(bool muted);
+    static void muteApplied(MuteDispatcher::Device device, bool muted);
 
     //  all callback methods and used by callback have to be static
     static LRESULT CALLBACK LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam);
     static bool isKeyPressed(unsigned int keyCode);
-    static bool isHotkeyPressed(DWORD code, PowerToysSettings::HotkeyObject& hotkey);
+    // The ModifierKeys bits of the modifier keys held down
+    static uint8_t readModifierKeys();
+    // Rebuilds the hotkey table from the hotkeys of the settings
+    static void compileHotkeys();
 
     static HHOOK hook_handle;
     bool _enabled = false;
 
     bool _mic_muted_state_during_disconnect = false;
     bool _controllingAllMics = false;
+    // Guards _controlledMicrophones, which the mute dispatcher applies the mute state to
+    std::mutex _controlledMicrophonesMutex;
     std::vector<std::unique_ptr<MicrophoneDevice>> _controlledMicrophones;
     MicrophoneDevice* _microphoneTrackedInUI = nullptr;
 
@@ -96,7 +119,11 @@ private:
     std::unique_ptr<FileWatcher> _generalSettingsWatcher;
     std::unique_ptr<FileWatcher> _moduleSettingsWatcher;
 
+    // Applies the mute states off the keyboard hook. Declared last, so it's stopped before the devices are destroyed.
+    MuteDispatcher _muteDispatcher;
+
     static VideoConferenceSettings settings;
     static Toolbar toolbar;
     static bool pushToTalkPressed;
+    static HotkeyMatcher<HotkeyAction> hotkeys;
 };
@@ -0,0 +1,323 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define COLOR_CONVERSION_SSE2
+#include <emmintrin.h>
+#endif
+
+// Converts the top-down BGR images WIC decodes into the formats webcams deliver, so loading an overlay doesn't need a
+// Media Foundation transform. The YUV formats use BT.601 limited range coefficients in 8 bit fixed point, computed
+// with SSE2 where it's available and with the same integer arithmetic otherwise, so both give identical frames.
+namespace ColorConversion
+{
+    enum class SourceFormat
+    {
+        Bgr24,
+        Bgra32,
+    };
+
+    enum class TargetFormat
+    {
+        Nv12,
+        I420,
+        Yuy2,
+        Rgb24,
+        Rgb32,
+    };
+
+    inline size_t BytesPerPixel(const SourceFormat format) noexcept
+    {
+        return format == SourceFormat::Bgr24 ? 3 : 4;
+    }
+
+    inline size_t FrameSize(const TargetFormat format, const uint32_t width, const uint32_t height) noexcept
+    {
+        const size_t pixels = size_t{ width } * height;
+        switch (format)
+        {
+        case TargetFormat::Nv12:
+        case TargetFormat::I420:
+            return pixels + pixels / 2;
+        case TargetFormat::Yuy2:
+            return pixels * 2;
+        case TargetFormat::Rgb24:
+            return pixels * 3;
+        case TargetFormat::Rgb32:
+            return pixels * 4;
+        }
+
+        return 0;
+    }
+
+    namespace Detail
+    {
+        constexpr int YB = 25, YG = 129, YR = 66;
+        constexpr int UB = 112, UG = -74, UR = -38;
+        constexpr int VB = -18, VG = -94, VR = 112;
+
+        inline uint8_t Luma(const int b, const int g, const int r) noexcept
+        {
+            return static_cast<uint8_t>(((YB * b + YG * g + YR * r + 128) >> 8) + 16);
+        }
+
+        // Chroma of the sums of the channels of a 2x2 block
+        inline uint8_t Chroma(const int cb, const int cg, const int cr, const int b, const int g, const int r) noexcept
+        {
+            return static_cast<uint8_t>(((cb * b + cg * g + cr * r + 512) >> 10) + 128);
+        }
+
+        inline void LumaRow(const uint8_t* bgra, uint8_t* luma, const uint32_t width, const bool simd) noexcept
+        {
+            uint32_t x = 0;
+#if defined(COLOR_CONVERSION_SSE2)
+            if (simd)
+            {
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i coefficients = _mm_setr_epi16(YB, YG, YR, 0, YB, YG, YR, 0);
+                const __m128i rounding = _mm_set1_epi32(128);
+                const __m128i offset = _mm_set1_epi16(16);
+
+                // Dot products of the channels of 4 pixels with the coefficients
+                const auto dot = [&](const __m128i pixels) {
+                    const __m128i low = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), coefficients);
+                    const __m128i high = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), coefficients);
+                    const __m128 lowPs = _mm_castsi128_ps(low);
+                    const __m128 highPs = _mm_castsi128_ps(high);
+                    return _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(lowPs, highPs, _MM_SHUFFLE(2, 0, 2, 0))),
+                                         _mm_castps_si128(_mm_shuffle_ps(lowPs, highPs, _MM_SHUFFLE(3, 1, 3, 1))));
+                };
+
+                for (; x + 8 <= width; x += 8)
+                {
+                    const __m128i first = dot(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bgra + x * 4)));
+                    const __m128i second = dot(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bgra + x * 4 + 16)));
+                    const __m128i words = _mm_add_epi16(_mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(first, rounding), 8),
+                                                                        _mm_srai_epi32(_mm_add_epi32(second, rounding), 8)),
+                                                        offset);
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(luma + x), _mm_packus_epi16(words, words));
+                }
+            }
+#else
+            (void)simd;
+#endif
+            for (; x < width; ++x)
+            {
+                luma[x] = Luma(bgra[x * 4], bgra[x * 4 + 1], bgra[x * 4 + 2]);
+            }
+        }
+
+        // Chroma of the 2x2 blocks of two rows, or of the horizontal pairs of a row passed twice
+        inline void ChromaRow(const uint8_t* top,
+                              const uint8_t* bottom,
+                              uint8_t* u,
+                              uint8_t* v,
+                              const uint32_t chromaWidth,
+                              const bool simd) noexcept
+        {
+            uint32_t x = 0;
+#if defined(COLOR_CONVERSION_SSE2)
+            if (simd)
+            {
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i uCoefficients = _mm_setr_epi16(UB, UG, UR, 0, UB, UG, UR, 0);
+                const __m128i vCoefficients = _mm_setr_epi16(VB, VG, VR, 0, VB, VG, VR, 0);
+                const __m128i rounding = _mm_set1_epi32(512);
+                const __m128i offset = _mm_set1_epi16(128);
+
+                // The channel sums of the 2 blocks of 4 pixels of both rows
+                const auto blockSums = [&](const size_t pixel) {
+                    const __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + pixel * 4));
+                    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + pixel * 4));
+                    const __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(t, zero), _mm_unpacklo_epi8(b, zero));
+                    const __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(t, zero), _mm_unpackhi_epi8(b, zero));
+                    return _mm_unpacklo_epi64(_mm_add_epi16(low, _mm_srli_si128(low, 8)),
+                                              _mm_add_epi16(high, _mm_srli_si128(high, 8)));
+                };
+
+                const auto dot = [&](const __m128i first, const __m128i second, const __m128i coefficients) {
+                    const __m128 firstPs = _mm_castsi128_ps(_mm_madd_epi16(first, coefficients));
+                    const __m128 secondPs = _mm_castsi128_ps(_mm_madd_epi16(second, coefficients));
+                    const __m128i sums =
+                        _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(firstPs, secondPs, _MM_SHUFFLE(2, 0, 2, 0))),
+                                      _mm_castps_si128(_mm_shuffle_ps(firstPs, secondPs, _MM_SHUFFLE(3, 1, 3, 1))));
+                    const __m128i words =
+                        _mm_add_epi16(_mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(sums, rounding), 10), zero), offset);
+                    return _mm_packus_epi16(words, words);
+                };
+
+                for (; x + 4 <= chromaWidth; x += 4)
+                {
+                    const __m128i first = blockSums(size_t{ x } * 2);
+                    const __m128i second = blockSums(size_t{ x } * 2 + 4);
+                    const int uBytes = _mm_cvtsi128_si32(dot(first, second, uCoefficients));
+                    const int vBytes = _mm_cvtsi128_si32(dot(first, second, vCoefficients));
+                    std::memcpy(u + x, &uBytes, 4);
+                    std::memcpy(v + x, &vBytes, 4);
+                }
+            }
+#else
+            (void)simd;
+#endif
+            for (; x < chromaWidth; ++x)
+            {
+                const uint8_t* t = top + size_t{ x } * 8;
+                const uint8_t* b = bottom + size_t{ x } * 8;
+                const int sumB = t[0] + t[4] + b[0] + b[4];
+                const int sumG = t[1] + t[5] + b[1] + b[5];
+                const int sumR = t[2] + t[6] + b[2] + b[6];
+                u[x] = Chroma(UB, UG, UR, sumB, sumG, sumR);
+                v[x] = Chroma(VB, VG, VR, sumB, sumG, sumR);
+            }
+        }
+
+        inline void ExpandBgrRow(const uint8_t* bgr, uint8_t* bgra, const uint32_t width) noexcept
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                const uint32_t pixel = bgr[x * 3] | (bgr[x * 3 + 1] << 8) | (bgr[x * 3 + 2] << 16) | 0xFF000000u;
+                std::memcpy(bgra + size_t{ x } * 4, &pixel, 4);
+            }
+        }
+
+        // The row as BGRA, expanded into buffer if it's BGR
+        inline const uint8_t* BgraRow(const uint8_t* row, const SourceFormat format, const uint32_t width, std::vector<uint8_t>& buffer)
+        {
+            if (format == SourceFormat::Bgra32)
+            {
+                return row;
+            }
+
+            buffer.resize(size_t{ width } * 4);
+            ExpandBgrRow(row, buffer.data(), width);
+            return buffer.data();
+        }
+    }
+
+    // Converts a top-down image into a frame of the target format, which has rows without padding and, for NV12 and
+    // I420, its planes one after the other. The YUV formats need an even width, and NV12 and I420 an even height.
+    // Returns false if the image can't be converted into the destination.
+    inline bool Convert(const uint8_t* source,
+                        const size_t sourceStride,
+                        const SourceFormat sourceFormat,
+                        const uint32_t width,
+                        const uint32_t height,
+                        const TargetFormat targetFormat,
+                        uint8_t* destination,
+                        const size_t destinationSize,
+                        const bool simd = true)
+    {
+        if (!source || !destination || !width || !height || sourceStride < width * BytesPerPixel(sourceFormat) ||
+            destinationSize < FrameSize(targetFormat, width, height))
+        {
+            return false;
+        }
+
+        const bool planar = targetFormat == TargetFormat::Nv12 || targetFormat == TargetFormat::I420;
+        if ((planar || targetFormat == TargetFormat::Yuy2) && width % 2 != 0)
+        {
+            return false;
+        }
+
+        if (planar && height % 2 != 0)
+        {
+            return false;
+        }
+
+        const auto sourceRow = [&](const uint32_t y) { return source + y * sourceStride; };
+        std::vector<uint8_t> topBuffer;
+        std::vector<uint8_t> bottomBuffer;
+
+        if (targetFormat == TargetFormat::Rgb24 || targetFormat == TargetFormat::Rgb32)
+        {
+            const size_t targetBytes = targetFormat == TargetFormat::Rgb24 ? 3 : 4;
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                uint8_t* target = destination + y * size_t{ width } * targetBytes;
+                if (BytesPerPixel(sourceFormat) == targetBytes)
+                {
+                    std::memcpy(target, sourceRow(y), width * targetBytes);
+                    continue;
+                }
+
+                const uint8_t* row = sourceRow(y);
+                if (targetBytes == 4)
+                {
+                    Detail::ExpandBgrRow(row, target, width);
+                    continue;
+                }
+
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    std::memcpy(target + x * 3, row + x * 4, 3);
+                }
+            }
+
+            return true;
+        }
+
+        const uint32_t chromaWidth = width / 2;
+        std::vector<uint8_t> u(chromaWidth);
+        std::vector<uint8_t> v(chromaWidth);
+
+        if (targetFormat == TargetFormat::Yuy2)
+        {
+            std::vector<uint8_t> luma(width);
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                const uint8_t* row = Detail::BgraRow(sourceRow(y), sourceFormat, width, topBuffer);
+                Detail::LumaRow(row, luma.data(), width, simd);
+                // A row passed twice sums its horizontal pairs twice, which averages them like the 2x2 blocks
+                Detail::ChromaRow(row, row, u.data(), v.data(), chromaWidth, simd);
+
+                uint8_t* target = destination + y * size_t{ width } * 2;
+                for (uint32_t x = 0; x < chromaWidth; ++x)
+                {
+                    target[x * 4] = luma[x * 2];
+                    target[x * 4 + 1] = u[x];
+                    target[x * 4 + 2] = luma[x * 2 + 1];
+                    target[x * 4 + 3] = v[x];
+                }
+            }
+
+            return true;
+        }
+
+        uint8_t* lumaPlane = destination;
+        uint8_t* chromaPlane = destination + size_t{ width } * height;
+        for (uint32_t y = 0; y < height; y += 2)
+        {
+            const uint8_t* top = Detail::BgraRow(sourceRow(y), sourceFormat, width, topBuffer);
+            const uint8_t* bottom = Detail::BgraRow(sourceRow(y + 1), sourceFormat, width, bottomBuffer);
+            Detail::LumaRow(top, lumaPlane + y * size_t{ width }, width, simd);
+            Detail::LumaRow(bottom, lumaPlane + (y + 1) * size_t{ width }, width, simd);
+
+            const size_t chromaRow = y / 2;
+            if (targetFormat == TargetFormat::I420)
+            {
+                const size_t chromaPlaneSize = size_t{ chromaWidth } * (height / 2);
+                Detail::ChromaRow(top,
+                                  bottom,
+                                  chromaPlane + chromaRow * chromaWidth,
+                                  chromaPlane + chromaPlaneSize + chromaRow * chromaWidth,
+                                  chromaWidth,
+                                  simd);
+                continue;
+            }
+
+            Detail::ChromaRow(top, bottom, u.data(), v.data(), chromaWidth, simd);
+            uint8_t* target = chromaPlane + chromaRow * width;
+            for (uint32_t x = 0; x < chromaWidth; ++x)
+            {
+                target[x * 2] = u[x];
+                target[x * 2 + 1] = v[x];
+            }
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+// Hands the frames of the capture thread to the worker thread of the proxy filter. Only the last frame posted is kept:
+// a frame posted before the worker took the previous one replaces it, and the replaced frame is released. The worker
+// processes the frames under the filter's mutex, but posting a frame never waits for a frame being processed. Frame is
+// a movable handle releasing the frame when destroyed, e.g. a COM pointer.
+template<typename Frame>
+class FrameWorker
+{
+public:
+    struct Statistics
+    {
+        uint64_t posted = 0;
+        uint64_t processed = 0;
+        // Replaced before the worker took them, or posted after Stop()
+        uint64_t dropped = 0;
+    };
+
+    FrameWorker() = default;
+    FrameWorker(const FrameWorker&) = delete;
+    FrameWorker& operator=(const FrameWorker&) = delete;
+
+    void Post(Frame frame)
+    {
+        std::optional<Frame> replaced;
+        {
+            std::unique_lock<std::mutex> lock{ _mutex };
+            ++_statistics.posted;
+            if (_stopped)
+            {
+                ++_statistics.dropped;
+                replaced.emplace(std::move(frame));
+            }
+            else
+            {
+                if (_pending)
+                {
+                    ++_statistics.dropped;
+                    replaced = std::move(_pending);
+                }
+
+                _pending.emplace(std::move(frame));
+            }
+        }
+
+        _cv.notify_one();
+    }
+
+    // Calls process(Frame&) for every frame taken until Stop() is called, with processingMutex locked. The frame is
+    // released after process returns.
+    template<typename Process>
+    void Run(std::mutex& processingMutex, Process&& process)
+    {
+        while (true)
+        {
+            std::optional<Frame> frame;
+            {
+                std::unique_lock<std::mutex> lock{ _mutex };
+                _cv.wait(lock, [this] { return _stopped || _pending; });
+                if (_stopped)
+                {
+                    return;
+                }
+
+                frame = std::move(_pending);
+                _pending.reset();
+            }
+
+            std::unique_lock<std::mutex> processingLock{ processingMutex };
+            process(*frame);
+            processingLock.unlock();
+
+            std::unique_lock<std::mutex> lock{ _mutex };
+            ++_statistics.processed;
+        }
+    }
+
+    // Makes Run() return once the frame being processed is done, and releases the pending frame
+    void Stop()
+    {
+        std::optional<Frame> pending;
+        {
+            std::unique_lock<std::mutex> lock{ _mutex };
+            _stopped = true;
+            if (_pending)
+            {
+                ++_statistics.dropped;
+                pending = std::move(_pending);
+                _pending.reset();
+            }
+        }
+
+        _cv.notify_all();
+    }
+
+    Statistics Stats() const
+    {
+        std::unique_lock<std::mutex> lock{ _mutex };
+        return _statistics;
+    }
+
+private:
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+    std::optional<Frame> _pending;
+    bool _stopped = false;
+    Statistics _statistics;
+};
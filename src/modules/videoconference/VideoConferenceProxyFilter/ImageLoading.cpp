@@ -10,6 +10,8 @@
 #pragma warning(pop)
 
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <mfapi.h>
 #include <shcore.h>
 #include <algorithm>
@@ -25,10 +27,14 @@
 #include <shlwapi.h>
 
 #include "Logging.h"
+#include "ColorConversion.h"
 
 IWICImagingFactory* _GetWIC() noexcept
 {
     static IWICImagingFactory* s_Factory = nullptr;
+    // Overlay samples are loaded on their own thread while the filter loads its blank image
+    static std::mutex s_FactoryMutex;
+    std::lock_guard<std::mutex> lock{ s_FactoryMutex };
 
     if (s_Factory)
     {
@@ -322,6 +328,72 @@ IMFSample* ConvertIMFVideoSample(const MFT_REGISTER_TYPE_INFO& inputType,
     return outputSamples.pSample;
 }
 
+std::optional<ColorConversion::TargetFormat> BuiltInConversionTarget(const GUID& subtype)
+{
+    if (subtype == MFVideoFormat_NV12)
+    {
+        return ColorConversion::TargetFormat::Nv12;
+    }
+    else if (subtype == MFVideoFormat_I420 || subtype == MFVideoFormat_IYUV)
+    {
+        return ColorConversion::TargetFormat::I420;
+    }
+    else if (subtype == MFVideoFormat_YUY2)
+    {
+        return ColorConversion::TargetFormat::Yuy2;
+    }
+    else if (subtype == MFVideoFormat_RGB32)
+    {
+        return ColorConversion::TargetFormat::Rgb32;
+    }
+
+    return std::nullopt;
+}
+
+wil::com_ptr_nothrow<IMFSample> ConvertBGRSample(IMFMediaBuffer* bgrBuffer,
+                                                 const ColorConversion::TargetFormat targetFormat,
+                                                 const UINT width,
+                                                 const UINT height)
+{
+    const DWORD convertedSize = static_cast<DWORD>(ColorConversion::FrameSize(targetFormat, width, height));
+
+    wil::com_ptr_nothrow<IMFSample> convertedSample;
+    OK_OR_BAIL(MFCreateSample(&convertedSample));
+    OK_OR_BAIL(convertedSample->SetUINT32(MF_MT_VIDEO_ROTATION, MFVideoRotationFormat::MFVideoRotationFormat_0));
+    OK_OR_BAIL(convertedSample->SetSampleDuration(333333));
+    OK_OR_BAIL(convertedSample->SetSampleTime(1));
+    wil::com_ptr_nothrow<IMFMediaBuffer> convertedBuffer;
+    OK_OR_BAIL(MFCreateAlignedMemoryBuffer(convertedSize, MF_64_BYTE_ALIGNMENT, &convertedBuffer));
+
+    BYTE* bgrMemory = nullptr;
+    DWORD bgrLength = 0;
+    OK_OR_BAIL(bgrBuffer->Lock(&bgrMemory, nullptr, &bgrLength));
+    auto unlockBgrBuffer = wil::scope_exit([bgrBuffer] { bgrBuffer->Unlock(); });
+
+    BYTE* convertedMemory = nullptr;
+    DWORD convertedMaxLength = 0;
+    OK_OR_BAIL(convertedBuffer->Lock(&convertedMemory, &convertedMaxLength, nullptr));
+    auto unlockConvertedBuffer = wil::scope_exit([&convertedBuffer] { convertedBuffer->Unlock(); });
+
+    if (bgrLength < 3ull * width * height ||
+        !ColorConversion::Convert(bgrMemory,
+                                  3ull * width,
+                                  ColorConversion::SourceFormat::Bgr24,
+                                  width,
+                                  height,
+                                  targetFormat,
+                                  convertedMemory,
+                                  convertedMaxLength))
+    {
+        return nullptr;
+    }
+
+    unlockConvertedBuffer.reset();
+    OK_OR_BAIL(convertedBuffer->SetCurrentLength(convertedSize));
+    OK_OR_BAIL(convertedSample->AddBuffer(convertedBuffer.get()));
+    return convertedSample;
+}
+
 wil::com_ptr_nothrow<IMFSample> LoadImageAsSample(wil::com_ptr_nothrow<IStream> imageStream,
                                                   IMFMediaType* sampleMediaType,
                                                   const float quality) noexcept
@@ -415,6 +487,17 @@ wil::com_ptr_nothrow<IMFSample> LoadImageAsSample(wil::com_ptr_nothrow<IStream>
         return jpgSample;
     }
 
+    // The formats webcams commonly use are converted directly, and transforms are only looked for the others
+    if (const auto builtInTarget = BuiltInConversionTarget(outputType.guidSubtype))
+    {
+        if (auto convertedSample = ConvertBGRSample(outputMediaBuffer, *builtInTarget, targetWidth, targetHeight))
+        {
+            return convertedSample;
+        }
+
+        LOG("Built-in conversion failed, looking for a converter");
+    }
+
     // Now we are ready to convert it to the requested media type
     MFT_REGISTER_TYPE_INFO intermediateType = { MFMediaType_Video, MFVideoFormat_RGB24 };
 
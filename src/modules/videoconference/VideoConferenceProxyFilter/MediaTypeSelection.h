@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+// The subtypes the filter always negotiated rank first, so cameras offering any of them keep the format they were
+// opened with. The subtypes ColorConversion added are only negotiated with cameras offering none of those.
+enum class SubTypePriority
+{
+    Unsupported,
+    Converted,
+    Original,
+};
+
+struct MediaTypeOffer
+{
+    SubTypePriority priority = SubTypePriority::Unsupported;
+    // In 100 ns units, as AvgTimePerFrame
+    int64_t avgFrameTime = 0;
+    long width = 0;
+    long height = 0;
+};
+
+// Index of the offer the capture device is opened with, in the order the pin enumerates them. Among the offers of the
+// highest priority, the last one which is at least as fast, as wide and as high as the one selected before it wins.
+// Offers without a frame time or slower than minimalFps are skipped.
+inline std::optional<size_t> SelectMediaTypeOffer(const std::vector<MediaTypeOffer>& offers, const int64_t minimalFps)
+{
+    struct Best
+    {
+        std::optional<size_t> index;
+        int64_t avgFrameTime = std::numeric_limits<int64_t>::max();
+        long width = 0;
+        long height = 0;
+    };
+
+    Best original;
+    Best converted;
+    for (size_t i = 0; i < offers.size(); ++i)
+    {
+        const MediaTypeOffer& offer = offers[i];
+        if (offer.priority == SubTypePriority::Unsupported || offer.avgFrameTime <= 0 || 10000000LL / offer.avgFrameTime < minimalFps)
+        {
+            continue;
+        }
+
+        Best& best = offer.priority == SubTypePriority::Original ? original : converted;
+        if (offer.avgFrameTime > best.avgFrameTime || offer.width < best.width || offer.height < best.height)
+        {
+            continue;
+        }
+
+        best = Best{ .index = i, .avgFrameTime = offer.avgFrameTime, .width = offer.width, .height = offer.height };
+    }
+
+    return original.index ? original.index : converted.index;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Remembers which overlay every buffer of a pool holds, so a buffer the allocator recycles unchanged is delivered
+// again without copying the overlay into it. Overlays are identified by a version the caller changes with the overlay
+// or the media type. Only valid for buffers nothing else writes into, e.g. not the ones the camera fills.
+class OverlayBufferTracker
+{
+public:
+    struct Statistics
+    {
+        uint64_t deliveries = 0;
+        uint64_t copies = 0;
+        uint64_t reuses = 0;
+        uint64_t bytesCopied = 0;
+    };
+
+    // The length of the overlay in the buffer, if it holds that version
+    std::optional<size_t> Held(const void* buffer, const uint64_t overlayVersion)
+    {
+        ++_statistics.deliveries;
+        for (const auto& entry : _buffers)
+        {
+            if (entry.buffer == buffer && entry.overlayVersion == overlayVersion)
+            {
+                ++_statistics.reuses;
+                return entry.length;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    void Written(const void* buffer, const uint64_t overlayVersion, const size_t length)
+    {
+        ++_statistics.copies;
+        _statistics.bytesCopied += length;
+        for (auto& entry : _buffers)
+        {
+            if (entry.buffer == buffer)
+            {
+                entry.overlayVersion = overlayVersion;
+                entry.length = length;
+                return;
+            }
+        }
+
+        _buffers.push_back({ buffer, overlayVersion, length });
+    }
+
+    // The buffer was written by someone else, or a write into it failed
+    void Forget(const void* buffer)
+    {
+        std::erase_if(_buffers, [buffer](const Entry& entry) { return entry.buffer == buffer; });
+    }
+
+    // The buffers were freed, e.g. with their allocator
+    void Clear()
+    {
+        _buffers.clear();
+    }
+
+    const Statistics& Stats() const
+    {
+        return _statistics;
+    }
+
+private:
+    struct Entry
+    {
+        const void* buffer = nullptr;
+        uint64_t overlayVersion = 0;
+        size_t length = 0;
+    };
+
+    std::vector<Entry> _buffers;
+    Statistics _statistics;
+};
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+template<typename Sample>
+struct EncodedOverlay
+{
+    Sample sample;
+    size_t size = 0;
+    float quality = 0.f;
+};
+
+// Finds the highest encoding quality in [minQuality, maxQuality] whose overlay fits maxSize bytes, assuming the size
+// grows with the quality. encode(quality) returns an std::optional<EncodedOverlay<Sample>>. Formats ignoring the
+// quality fit or fail with the first encoding, and so do images fitting at maxQuality.
+template<typename Sample, typename Encode>
+std::optional<EncodedOverlay<Sample>> FitOverlayQuality(Encode&& encode,
+                                                        const size_t maxSize,
+                                                        const float minQuality,
+                                                        const float maxQuality,
+                                                        const int steps)
+{
+    std::optional<EncodedOverlay<Sample>> best = encode(maxQuality);
+    if (best && best->size <= maxSize)
+    {
+        return best;
+    }
+
+    best = encode(minQuality);
+    if (!best || best->size > maxSize)
+    {
+        return std::nullopt;
+    }
+
+    float fitting = minQuality;
+    float exceeding = maxQuality;
+    for (int step = 0; step < steps; ++step)
+    {
+        const float quality = (fitting + exceeding) / 2;
+        auto encoded = encode(quality);
+        if (encoded && encoded->size <= maxSize)
+        {
+            fitting = quality;
+            best = std::move(encoded);
+        }
+        else
+        {
+            exceeding = quality;
+        }
+    }
+
+    return best;
+}
+
+// Overlay samples built by Run() on a thread of their own and kept afterwards, so threads delivering frames only look
+// them up. A build which failed is kept as an empty sample, so it isn't retried for every frame. The oldest samples
+// are dropped once there are more than the capacity.
+template<typename Key, typename Sample>
+class OverlaySampleCache
+{
+public:
+    using Build = std::function<Sample()>;
+
+    explicit OverlaySampleCache(const size_t capacity = 8) :
+        _capacity{ capacity }
+    {
+    }
+
+    OverlaySampleCache(const OverlaySampleCache&) = delete;
+    OverlaySampleCache& operator=(const OverlaySampleCache&) = delete;
+
+    // Never waits for a build
+    std::optional<Sample> Find(const Key& key) const
+    {
+        std::unique_lock<std::mutex> lock{ _mutex };
+        for (const auto& [cachedKey, sample] : _samples)
+        {
+            if (cachedKey == key)
+            {
+                return sample;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    // Queues the build unless the sample is cached or already queued
+    void Request(const Key& key, Build build)
+    {
+        std::unique_lock<std::mutex> lock{ _mutex };
+        if (_stopped || Contains(_samples, key) || Contains(_pending, key) || _building == key)
+        {
+            return;
+        }
+
+        _pending.emplace_back(key, std::move(build));
+        _cv.notify_one();
+    }
+
+    // Drops the queued builds which weren't started yet, e.g. after a newer overlay image was posted
+    void CancelPending()
+    {
+        std::unique_lock<std::mutex> lock{ _mutex };
+        _pending.clear();
+    }
+
+    // Builds the requested samples until Stop() is called
+    void Run()
+    {
+        std::unique_lock<std::mutex> lock{ _mutex };
+        while (true)
+        {
+            _cv.wait(lock, [this] { return _stopped || !_pending.empty(); });
+            if (_stopped)
+            {
+                return;
+            }
+
+            auto [key, build] = std::move(_pending.front());
+            _pending.pop_front();
+            _building = key;
+
+            lock.unlock();
+            Sample sample = build();
+            lock.lock();
+
+            _building.reset();
+            _samples.emplace_back(std::move(key), std::move(sample));
+            if (_samples.size() > _capacity)
+            {
+                _samples.erase(begin(_samples));
+            }
+            ++_builds;
+            _idleCv.notify_all();
+        }
+    }
+
+    void Stop()
+    {
+        std::unique_lock<std::mutex> lock{ _mutex };
+        _stopped = true;
+        _pending.clear();
+        _cv.notify_all();
+        _idleCv.notify_all();
+    }
+
+    // Waits until every requested sample is built
+    void WaitIdle()
+    {
+        std::unique_lock<std::mutex> lock{ _mutex };
+        _idleCv.wait(lock, [this] { return _stopped || (_pending.empty() && !_building); });
+    }
+
+    size_t Builds() const
+    {
+        std::unique_lock<std::mutex> lock{ _mutex };
+        return _builds;
+    }
+
+private:
+    template<typename Entries>
+    static bool Contains(const Entries& entries, const Key& key)
+    {
+        for (const auto& entry : entries)
+        {
+            if (entry.first == key)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    const size_t _capacity;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+    std::condition_variable _idleCv;
+
+    std::vector<std::pair<Key, Sample>> _samples;
+    std::deque<std::pair<Key, Build>> _pending;
+    std::optional<Key> _building;
+    size_t _builds = 0;
+    bool _stopped = false;
+};
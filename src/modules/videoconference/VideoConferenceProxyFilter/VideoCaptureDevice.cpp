@@ -1,5 +1,6 @@
 #include "Logging.h"
 #include "VideoCaptureDevice.h"
+#include "MediaTypeSelection.h"
 
 #include <wil/resource.h>
 #include <cguid.h>
@@ -382,9 +383,40 @@ const char* GetMediaSubTypeString(const GUID& guid)
         return "MEDIASUBTYPE_NV12";
     }
 
+    if (guid == MEDIASUBTYPE_I420)
+    {
+        return "MEDIASUBTYPE_I420";
+    }
+
+    if (guid == MEDIASUBTYPE_IYUV)
+    {
+        return "MEDIASUBTYPE_IYUV";
+    }
+
+    if (guid == MEDIASUBTYPE_RGB32)
+    {
+        return "MEDIASUBTYPE_RGB32";
+    }
+
     return "MEDIASUBTYPE_UNKNOWN";
 }
 
+SubTypePriority GetSubTypePriority(const GUID& guid)
+{
+    if (guid == MEDIASUBTYPE_YUY2 || guid == MEDIASUBTYPE_MJPG || guid == MEDIASUBTYPE_RGB24)
+    {
+        return SubTypePriority::Original;
+    }
+
+    // The subtypes ColorConversion converts the overlay image into
+    if (guid == MEDIASUBTYPE_RGB32 || guid == MEDIASUBTYPE_NV12 || guid == MEDIASUBTYPE_I420 || guid == MEDIASUBTYPE_IYUV)
+    {
+        return SubTypePriority::Converted;
+    }
+
+    return SubTypePriority::Unsupported;
+}
+
 std::optional<VideoStreamFormat> SelectBestMediaType(wil::com_ptr_nothrow<IPin>& pin)
 {
     VERBOSE_LOG;
@@ -395,7 +427,8 @@ std::optional<VideoStreamFormat> SelectBestMediaType(wil::com_ptr_nothrow<IPin>&
     }
 
     ULONG _ = 0;
-    VideoStreamFormat bestFormat;
+    std::vector<MediaTypeOffer> offers;
+    std::vector<unique_media_type_ptr> mediaTypes;
     unique_media_type_ptr mt;
     while (mediaTypeEnum->Next(1, wil::out_param(mt), &_) == S_OK)
     {
@@ -411,18 +444,8 @@ std::optional<VideoStreamFormat> SelectBestMediaType(wil::com_ptr_nothrow<IPin>&
             continue;
         }
 
-        const auto formatAvgFPS = 10000000LL / format->AvgTimePerFrame;
-        if (format->AvgTimePerFrame > bestFormat.avgFrameTime || formatAvgFPS < MINIMAL_FPS_ALLOWED)
-        {
-            continue;
-        }
-
-        if (format->bmiHeader.biWidth < bestFormat.width || format->bmiHeader.biHeight < bestFormat.height)
-        {
-            continue;
-        }
-
-        if (mt->subtype != MEDIASUBTYPE_YUY2 && mt->subtype != MEDIASUBTYPE_MJPG && mt->subtype != MEDIASUBTYPE_RGB24)
+        const auto priority = GetSubTypePriority(mt->subtype);
+        if (priority == SubTypePriority::Unsupported)
         {
             OLECHAR* guidString;
             StringFromCLSID(mt->subtype, &guidString);
@@ -432,10 +455,20 @@ std::optional<VideoStreamFormat> SelectBestMediaType(wil::com_ptr_nothrow<IPin>&
             continue;
         }
 
-        bestFormat.avgFrameTime = format->AvgTimePerFrame;
-        bestFormat.width = format->bmiHeader.biWidth;
-        bestFormat.height = format->bmiHeader.biHeight;
-        bestFormat.mediaType = std::move(mt);
+        offers.push_back(MediaTypeOffer{ .priority = priority,
+                                         .avgFrameTime = format->AvgTimePerFrame,
+                                         .width = format->bmiHeader.biWidth,
+                                         .height = format->bmiHeader.biHeight });
+        mediaTypes.push_back(std::move(mt));
+    }
+
+    VideoStreamFormat bestFormat;
+    if (const auto selected = SelectMediaTypeOffer(offers, MINIMAL_FPS_ALLOWED))
+    {
+        bestFormat.avgFrameTime = offers[*selected].avgFrameTime;
+        bestFormat.width = offers[*selected].width;
+        bestFormat.height = offers[*selected].height;
+        bestFormat.mediaType = std::move(mediaTypes[*selected]);
     }
 
     if (!bestFormat.mediaType)
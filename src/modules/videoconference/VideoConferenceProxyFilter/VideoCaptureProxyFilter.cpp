@@ -13,6 +13,11 @@ constexpr static inline wchar_t VENDOR[] = L"Microsoft Corporation";
 namespace
 {
     constexpr float initialJpgQuality = 0.5f;
+    constexpr float minimalJpgQuality = 0.05f;
+    // Bisections of the quality range for overlays not fitting at the initial quality
+    constexpr int jpgQualityFittingSteps = 5;
+    // Buffers in the overlay pool at least, so one is free while the downstream filter holds the previous frame
+    constexpr long minimalOverlayBuffers = 2;
     constexpr std::array<unsigned char, 3> overlayColor = { 0, 0, 0 };
     // clang-format off
     unsigned char bmpPixelData[58] = {
@@ -516,102 +521,94 @@ void DumpSample(IMediaSample* frame, const std::string_view filename)
 #endif
 
 VideoCaptureProxyFilter::VideoCaptureProxyFilter() :
-    _worker_thread{
+    _overlay_thread{
         std::thread{
             [this]() {
-                using namespace std::chrono_literals;
-                const auto uninitializedSleepInterval = 15ms;
-                std::vector<float> lowerJpgQualityModes = { 0.1f, 0.25f };
-                while (!_shutdown_request)
+                const bool comInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+                _overlaySamples.Run();
+                if (comInitialized)
                 {
-                    std::unique_lock<std::mutex> lock{ _worker_mutex };
-                    _worker_cv.wait(lock, [this] { return _pending_frame != nullptr || _shutdown_request; });
-
-                    if (!_outPin || !_outPin->_connectedInputPin)
-                    {
-                        lock.unlock();
-                        std::this_thread::sleep_for(uninitializedSleepInterval);
-                        continue;
-                    }
-
-                    auto input = _outPin->_connectedInputPin.try_query<IMemInputPin>();
-                    if (!input)
-                    {
-                        continue;
-                    }
-
-                    IMediaSample* sample = _pending_frame;
-                    if (!sample)
-                    {
-                        continue;
-                    }
+                    CoUninitialize();
+                }
+            } }
+    },
+    _worker_thread{
+        std::thread{
+            [this]() {
+                _frames.Run(_worker_mutex, [this](wil::com_ptr_nothrow<IMediaSample>& frame) { ProcessFrame(frame.get()); });
+            } }
+    }
+{
+}
+
+void VideoCaptureProxyFilter::ProcessFrame(IMediaSample* sample)
+{
+    if (!_outPin || !_outPin->_connectedInputPin)
+    {
+        return;
+    }
+
+    auto input = _outPin->_connectedInputPin.try_query<IMemInputPin>();
+    if (!input)
+    {
+        return;
+    }
+
 #if defined(DEBUG_FRAME_DATA)
-                    static bool realFrameSaved = false;
-                    if (!realFrameSaved)
-                    {
-                        DumpSample(sample, "PowerToysVCMRealFrame.binary");
-                        realFrameSaved = true;
-                    }
+    static bool realFrameSaved = false;
+    if (!realFrameSaved)
+    {
+        DumpSample(sample, "PowerToysVCMRealFrame.binary");
+        realFrameSaved = true;
+    }
 #endif
-                    auto newSettings = SyncCurrentSettings();
-                    if (newSettings.webcamDisabled)
-                    {
+    _frameSize = sample->GetSize();
+    IMediaSample* delivered = sample;
+    wil::com_ptr_nothrow<IMediaSample> overlaySample;
+    auto newSettings = SyncCurrentSettings();
+    if (newSettings.webcamDisabled)
+    {
 #if !defined(DEBUG_OVERWRITE_FRAME)
-                        bool overwritten = OverwriteFrame(_pending_frame, _overlayImage ? _overlayImage : _blankImage);
-                        while (!overwritten && _overlayImage)
-                        {
-                            _overlayImage.reset();
-                            newSettings = SyncCurrentSettings();
-                            if (!lowerJpgQualityModes.empty() && newSettings.overlayImage)
-                            {
-                                const float quality = lowerJpgQualityModes.back();
-                                lowerJpgQualityModes.pop_back();
-                                char buf[512]{};
-                                sprintf_s(buf, "Reload overlay image with quality %f", quality);
-                                LOG(buf);
-                                _overlayImage = LoadImageAsSample(newSettings.overlayImage, _targetMediaType.get(), quality);
-                                overwritten = OverwriteFrame(_pending_frame, _overlayImage);
-                            }
-                            else
-                            {
-                                LOG("Couldn't overwrite frame with image with all available quality modes.");
-                            }
-                        }
+        // Shows the blank image until the overlay sample fitting this frame is prepared
+        auto overlayImage = PrepareOverlaySample(_frameSize);
+        overlaySample = OverlayPoolSample(sample, overlayImage ? overlayImage : _blankImage);
+        if (overlaySample)
+        {
+            delivered = overlaySample.get();
+        }
+        else
+        {
+            const bool overwritten = OverwriteFrame(sample, overlayImage);
 #if defined(DEBUG_FRAME_DATA)
-                        static bool overlayFrameSaved = false;
-                        if (!overlayFrameSaved && _overlayImage && overwritten)
-                        {
-                            DumpSample(sample, "PowerToysVCMOverlayImageFrame.binary");
-                            overlayFrameSaved = true;
-                        }
+            static bool overlayFrameSaved = false;
+            if (!overlayFrameSaved && overwritten)
+            {
+                DumpSample(sample, "PowerToysVCMOverlayImageFrame.binary");
+                overlayFrameSaved = true;
+            }
 #endif
-                        if (!overwritten && !_overlayImage)
-                        {
-                            OverwriteFrame(_pending_frame, _blankImage);
-                        }
+            if (!overwritten)
+            {
+                OverwriteFrame(sample, _blankImage);
+            }
+        }
 #else
-                        DebugOverwriteFrame(_pending_frame, "R:\\frame.data");
+        DebugOverwriteFrame(sample, "R:\\frame.data");
 #endif
-                    }
+    }
 #if defined(DEBUG_REENCODE_JPG_DATA)
-                    else
-                    {
-                        GUID subtype{};
-                        _targetMediaType->GetGUID(MF_MT_SUBTYPE, &subtype);
-                        if (subtype == MFVideoFormat_MJPG)
-                        {
-                            ReencodeFrame(_pending_frame);
-                        }
-                    }
+    else
+    {
+        GUID subtype{};
+        _targetMediaType->GetGUID(MF_MT_SUBTYPE, &subtype);
+        if (subtype == MFVideoFormat_MJPG)
+        {
+            ReencodeFrame(sample);
+        }
+    }
 #endif
 
-                    _pending_frame = nullptr;
-                    input->Receive(sample);
-                    sample->Release();
-                }
-            } }
-    }
-{
+    input->Receive(delivered);
 }
 
 HRESULT VideoCaptureProxyFilter::Stop(void)
@@ -645,6 +642,7 @@ HRESULT VideoCaptureProxyFilter::Pause(void)
         }
 
         allocator->Commit();
+        CreateOverlayAllocator();
     }
 
     _state = State_Paused;
@@ -698,6 +696,18 @@ GUID MapDShowSubtypeToMFT(const GUID& dshowSubtype)
     {
         return MFVideoFormat_RGB24;
     }
+    else if (dshowSubtype == MEDIASUBTYPE_RGB32)
+    {
+        return MFVideoFormat_RGB32;
+    }
+    else if (dshowSubtype == MEDIASUBTYPE_NV12)
+    {
+        return MFVideoFormat_NV12;
+    }
+    else if (dshowSubtype == MEDIASUBTYPE_I420 || dshowSubtype == MEDIASUBTYPE_IYUV)
+    {
+        return MFVideoFormat_I420;
+    }
     else
     {
         LOG("MapDShowSubtypeToMFT: Unsupported media type format provided!");
@@ -770,10 +780,7 @@ HRESULT VideoCaptureProxyFilter::EnumPins(IEnumPins** ppEnum)
         _outPin.attach(pin.detach());
 
         auto frameCallback = [this](IMediaSample* sample) {
-            std::unique_lock<std::mutex> lock{ _worker_mutex };
-            sample->AddRef();
-            _pending_frame = sample;
-            _worker_cv.notify_one();
+            _frames.Post(wil::com_ptr_nothrow<IMediaSample>{ sample });
         };
 
         _targetMediaType.reset();
@@ -785,6 +792,9 @@ HRESULT VideoCaptureProxyFilter::EnumPins(IEnumPins** ppEnum)
         MFSetAttributeSize(
             _targetMediaType.get(), MF_MT_FRAME_SIZE, webcam.bestFormat.width, webcam.bestFormat.height);
         MFSetAttributeRatio(_targetMediaType.get(), MF_MT_PIXEL_ASPECT_RATIO, 1, 1);
+        _targetMediaKey = {};
+        _targetMediaType->GetGUID(MF_MT_SUBTYPE, &_targetMediaKey.subtype);
+        MFGetAttributeSize(_targetMediaType.get(), MF_MT_FRAME_SIZE, &_targetMediaKey.width, &_targetMediaKey.height);
 
         _captureDevice = VideoCaptureDevice::Create(std::move(webcam), std::move(frameCallback));
         if (_captureDevice)
@@ -795,7 +805,9 @@ HRESULT VideoCaptureProxyFilter::EnumPins(IEnumPins** ppEnum)
                 _blankImage = LoadImageAsSample(blackBMPImage, _targetMediaType.get(), initialJpgQuality);
             }
 
-            _overlayImage = LoadImageAsSample(newSettings.overlayImage, _targetMediaType.get(), initialJpgQuality);
+            // Prepares the overlay before the first frame if the media type tells the size of the frames
+            _frameSize = _outPin->_mediaFormat ? static_cast<long>(_outPin->_mediaFormat->lSampleSize) : 0;
+            PrepareOverlaySample(_frameSize);
             LOG("VideoCaptureProxyFilter::EnumPins capture device created successfully");
         }
         else
@@ -865,16 +877,41 @@ ULONG VideoCaptureProxyFilter::GetMiscFlags(void)
 VideoCaptureProxyFilter::~VideoCaptureProxyFilter()
 {
     VERBOSE_LOG;
-    _shutdown_request = true;
-
-    _worker_cv.notify_one();
+    _frames.Stop();
     _worker_thread.join();
+    _overlaySamples.Stop();
+    _overlay_thread.join();
+
+    if (const auto frames = _frames.Stats(); frames.posted)
+    {
+        char buf[512]{};
+        sprintf_s(buf,
+                  "Processed %llu of %llu frames captured, %llu were replaced by newer frames before",
+                  frames.processed,
+                  frames.posted,
+                  frames.dropped);
+        LOG(buf);
+    }
+
+    if (const auto& stats = _overlayBuffers.Stats(); stats.deliveries)
+    {
+        char buf[512]{};
+        sprintf_s(buf,
+                  "Delivered %llu overlay frames from the pool, copied the overlay %llu times (%llu bytes), reused %llu buffers",
+                  stats.deliveries,
+                  stats.copies,
+                  stats.bytesCopied,
+                  stats.reuses);
+        LOG(buf);
+    }
+
+    if (_overlayAllocator)
+    {
+        _overlayAllocator->Decommit();
+    }
     if (_settingsUpdateChannel)
     {
-        _settingsUpdateChannel->access([](auto settingsMemory) {
-            auto settings = reinterpret_cast<CameraSettingsUpdateChannel*>(settingsMemory._data);
-            settings->cameraInUse = false;
-        });
+        reinterpret_cast<CameraSettingsUpdateChannel*>(_settingsUpdateChannel->data())->cameraInUse = false;
     }
 }
 
@@ -891,47 +928,195 @@ VideoCaptureProxyFilter::SyncedSettings VideoCaptureProxyFilter::SyncCurrentSett
         return result;
     }
 
-    _settingsUpdateChannel->access([this, &result](auto settingsMemory) {
-        auto settings = reinterpret_cast<CameraSettingsUpdateChannel*>(settingsMemory._data);
-        bool cameraNameUpdated = false;
-        result.webcamDisabled = settings->useOverlayImage;
+    auto channel = reinterpret_cast<CameraSettingsUpdateChannel*>(_settingsUpdateChannel->data());
+    if (!channel->cameraInUse.load(std::memory_order_relaxed))
+    {
+        channel->cameraInUse = true;
+    }
 
-        settings->cameraInUse = true;
+    // Doesn't take a lock, and only copies the settings after they changed
+    channel->settings.read_if_changed(_settingsGeneration, _settings);
+    result.webcamDisabled = _settings.useOverlayImage;
 
-        if (settings->sourceCameraName.has_value())
+    if (_settings.sourceCameraName.has_value())
+    {
+        std::wstring_view newCameraNameView{ _settings.sourceCameraName->data() };
+        if (!_currentSourceCameraName.has_value() || *_currentSourceCameraName != newCameraNameView)
         {
-            std::wstring_view newCameraNameView{ settings->sourceCameraName->data() };
-            if (!_currentSourceCameraName.has_value() || *_currentSourceCameraName != newCameraNameView)
-            {
-                cameraNameUpdated = true;
-                result.newCameraName = newCameraNameView;
-            }
+            result.newCameraName = newCameraNameView;
         }
+    }
+
+    if (!_settings.overlayImageSize.has_value())
+    {
+        return result;
+    }
 
-        if (!settings->overlayImageSize.has_value())
+    if (_syncedOverlayImageGeneration != _settings.overlayImageGeneration || !_overlayImageData)
+    {
+        auto imageChannel =
+            SerializedSharedMemory::open(CameraOverlayImageChannel::endpoint(), *_settings.overlayImageSize, true);
+        if (!imageChannel)
         {
-            return;
+            return result;
         }
 
-        if (settings->newOverlayImagePosted || !_overlayImage)
+        std::shared_ptr<std::vector<uint8_t>> imageData;
+        imageChannel->access([&imageData](auto imageMemory) {
+            imageData = std::make_shared<std::vector<uint8_t>>(imageMemory._data, imageMemory._data + imageMemory._size);
+        });
+
+        if (!imageData || imageData->empty())
         {
-            auto imageChannel =
-                SerializedSharedMemory::open(CameraOverlayImageChannel::endpoint(), *settings->overlayImageSize, true);
-            if (!imageChannel)
+            return result;
+        }
+
+        _overlayImageData = std::move(imageData);
+        _syncedOverlayImageGeneration = _settings.overlayImageGeneration;
+
+        // The samples of the previous image won't be shown anymore, and the new one is prepared before it's needed
+        _overlaySamples.CancelPending();
+        PrepareOverlaySample(_frameSize);
+    }
+
+    return result;
+}
+
+wil::com_ptr_nothrow<IMFSample> VideoCaptureProxyFilter::PrepareOverlaySample(const long frameSize)
+{
+    if (!_overlayImageData || !_syncedOverlayImageGeneration || !_targetMediaType || frameSize <= 0)
+    {
+        return nullptr;
+    }
+
+    OverlaySampleKey key = _targetMediaKey;
+    key.frameSize = frameSize;
+    key.imageGeneration = *_syncedOverlayImageGeneration;
+    if (auto sample = _overlaySamples.Find(key))
+    {
+        return *sample;
+    }
+
+    using Sample = wil::com_ptr_nothrow<IMFSample>;
+    _overlaySamples.Request(key, [image = _overlayImageData, mediaType = _targetMediaType, frameSize]() -> Sample {
+        auto encode = [&](const float quality) -> std::optional<EncodedOverlay<Sample>> {
+            wil::com_ptr_nothrow<IStream> imageStream = SHCreateMemStream(image->data(), static_cast<UINT>(image->size()));
+            auto sample = LoadImageAsSample(imageStream, mediaType.get(), quality);
+            if (!sample)
             {
-                return;
+                return std::nullopt;
             }
 
-            imageChannel->access([this, settings, &result](auto imageMemory) {
-                result.overlayImage = SHCreateMemStream(imageMemory._data, static_cast<UINT>(imageMemory._size));
-                if (!result.overlayImage)
-                {
-                    return;
-                }
+            const long size = GetImageSize(sample);
+            return EncodedOverlay<Sample>{ std::move(sample), static_cast<size_t>(size), quality };
+        };
 
-                settings->newOverlayImagePosted = false;
-            });
+        auto fitted = FitOverlayQuality<Sample>(
+            encode, static_cast<size_t>(frameSize), minimalJpgQuality, initialJpgQuality, jpgQualityFittingSteps);
+        if (!fitted)
+        {
+            LOG("Couldn't fit the overlay image into the frame with any quality");
+            return nullptr;
         }
+
+        char buf[512]{};
+        sprintf_s(buf, "Prepared overlay image with quality %f, %zu of %ld bytes", fitted->quality, fitted->size, frameSize);
+        LOG(buf);
+        return std::move(fitted->sample);
     });
-    return result;
+
+    return nullptr;
+}
+
+void VideoCaptureProxyFilter::CreateOverlayAllocator()
+{
+    if (_overlayAllocator || !_captureDevice || !_captureDevice->_allocator)
+    {
+        return;
+    }
+
+    ALLOCATOR_PROPERTIES cameraProperties{};
+    if (FAILED(_captureDevice->_allocator->GetProperties(&cameraProperties)) || cameraProperties.cbBuffer <= 0)
+    {
+        LOG("VideoCaptureProxyFilter::CreateOverlayAllocator FAILED camera allocator properties");
+        return;
+    }
+
+    wil::com_ptr_nothrow<IMemAllocator> allocator;
+    if (FAILED(CoCreateInstance(CLSID_MemoryAllocator, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&allocator))))
+    {
+        LOG("VideoCaptureProxyFilter::CreateOverlayAllocator FAILED CoCreateInstance");
+        return;
+    }
+
+    ALLOCATOR_PROPERTIES requested = cameraProperties;
+    requested.cBuffers = cameraProperties.cBuffers < minimalOverlayBuffers ? minimalOverlayBuffers : cameraProperties.cBuffers;
+    requested.cbPrefix = 0;
+    ALLOCATOR_PROPERTIES actual{};
+    if (FAILED(allocator->SetProperties(&requested, &actual)) || FAILED(allocator->Commit()))
+    {
+        LOG("VideoCaptureProxyFilter::CreateOverlayAllocator FAILED SetProperties or Commit");
+        return;
+    }
+
+    _overlayBuffers.Clear();
+    _overlayAllocator = std::move(allocator);
+}
+
+wil::com_ptr_nothrow<IMediaSample> VideoCaptureProxyFilter::OverlayPoolSample(IMediaSample* frame,
+                                                                              wil::com_ptr_nothrow<IMFSample>& image)
+{
+    if (!_overlayAllocator || !image)
+    {
+        return nullptr;
+    }
+
+    // A frame changing the media type is delivered itself, so the change reaches the downstream filter
+    AM_MEDIA_TYPE* frameMediaType = nullptr;
+    if (frame->GetMediaType(&frameMediaType) == S_OK)
+    {
+        MyDeleteMediaType(frameMediaType);
+        return nullptr;
+    }
+
+    if (image != _deliveredOverlay)
+    {
+        _deliveredOverlay = image;
+        ++_deliveredOverlayVersion;
+    }
+
+    wil::com_ptr_nothrow<IMediaSample> poolSample;
+    if (FAILED(_overlayAllocator->GetBuffer(&poolSample, nullptr, nullptr, AM_GBF_NOWAIT)) || !poolSample)
+    {
+        return nullptr;
+    }
+
+    BYTE* buffer = nullptr;
+    poolSample->GetPointer(&buffer);
+    if (!buffer)
+    {
+        return nullptr;
+    }
+
+    if (const auto length = _overlayBuffers.Held(buffer, _deliveredOverlayVersion))
+    {
+        poolSample->SetActualDataLength(static_cast<long>(*length));
+    }
+    else if (OverwriteFrame(poolSample.get(), image))
+    {
+        _overlayBuffers.Written(buffer, _deliveredOverlayVersion, poolSample->GetActualDataLength());
+    }
+    else
+    {
+        _overlayBuffers.Forget(buffer);
+        return nullptr;
+    }
+
+    REFERENCE_TIME start = 0, stop = 0;
+    const HRESULT timeResult = frame->GetTime(&start, &stop);
+    poolSample->SetTime(SUCCEEDED(timeResult) ? &start : nullptr, timeResult == S_OK ? &stop : nullptr);
+    poolSample->SetSyncPoint(TRUE);
+    poolSample->SetDiscontinuity(frame->IsDiscontinuity() == S_OK);
+    poolSample->SetPreroll(frame->IsPreroll() == S_OK);
+    return poolSample;
 }
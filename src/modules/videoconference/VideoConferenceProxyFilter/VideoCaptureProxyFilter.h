@@ -14,9 +14,13 @@
 #include <SerializedSharedMemory.h>
 
 #include "VideoCaptureDevice.h"
+#include "OverlayPreparation.h"
+#include "OverlayDelivery.h"
+#include "FrameWorker.h"
 
 #include <mutex>
 #include <condition_variable>
+#include <memory>
 
 struct VideoCaptureProxyPin;
 struct IMFSample;
@@ -24,27 +28,59 @@ struct IMFMediaType;
 
 inline const wchar_t CAMERA_NAME[] = L"PowerToys VideoConference Mute";
 
+// The media type and frame buffer size an overlay sample is fitted to, and the overlay image it shows
+struct OverlaySampleKey
+{
+    GUID subtype = {};
+    UINT32 width = 0;
+    UINT32 height = 0;
+    long frameSize = 0;
+    uint32_t imageGeneration = 0;
+
+    bool operator==(const OverlaySampleKey&) const = default;
+};
+
 struct VideoCaptureProxyFilter : winrt::implements<VideoCaptureProxyFilter, IBaseFilter, IAMFilterMiscFlags>
 {
     // BLOCK START: member accessed concurrently
     wil::com_ptr_nothrow<VideoCaptureProxyPin> _outPin;
-    IMediaSample* _pending_frame = nullptr;
-    std::atomic_bool _shutdown_request = false;
     std::optional<SerializedSharedMemory> _settingsUpdateChannel;
+    // The settings last copied from the channel, which are copied again only after they change
+    CameraSettings _settings;
+    uint32_t _settingsGeneration = VersionedChannel<CameraSettings>::UNREAD;
+    std::optional<uint32_t> _syncedOverlayImageGeneration;
     std::optional<std::wstring> _currentSourceCameraName;
+    // A copy of the overlay image last posted, which the overlay samples are built from
+    std::shared_ptr<const std::vector<uint8_t>> _overlayImageData;
+    // The size of the frame buffers last delivered, which the overlay samples must fit
+    long _frameSize = 0;
     wil::com_ptr_nothrow<IMFSample> _blankImage;
-    wil::com_ptr_nothrow<IMFSample> _overlayImage;
     wil::com_ptr_nothrow<IMFMediaType> _targetMediaType;
+    // The media type of the overlay samples, without a frame size and an image
+    OverlaySampleKey _targetMediaKey;
+    // Muted frames are delivered in buffers of this pool rather than the camera's, which it rewrites every frame, so a
+    // buffer already holding the overlay is delivered again without copying it
+    wil::com_ptr_nothrow<IMemAllocator> _overlayAllocator;
+    OverlayBufferTracker _overlayBuffers;
+    // Held so no other overlay sample gets its address while its version is in _overlayBuffers
+    wil::com_ptr_nothrow<IMFSample> _deliveredOverlay;
+    uint64_t _deliveredOverlayVersion = 0;
     // BLOCK END: member accessed concurrently
 
     std::mutex _worker_mutex;
-    std::condition_variable _worker_cv;
+    // Frames of the capture device, processed by _worker_thread while holding _worker_mutex. Outlives _captureDevice,
+    // which posts the frames.
+    FrameWorker<wil::com_ptr_nothrow<IMediaSample>> _frames;
 
     FILTER_STATE _state = State_Stopped;
     wil::com_ptr_nothrow<IReferenceClock> _clock;
     IFilterGraph* _graph = nullptr;
     std::optional<VideoCaptureDevice> _captureDevice;
 
+    // Overlay samples are decoded, scaled and encoded on _overlay_thread, never while delivering a frame
+    OverlaySampleCache<OverlaySampleKey, wil::com_ptr_nothrow<IMFSample>> _overlaySamples;
+    std::thread _overlay_thread;
+
     std::thread _worker_thread;
 
     VideoCaptureProxyFilter();
@@ -54,11 +90,21 @@ struct VideoCaptureProxyFilter : winrt::implements<VideoCaptureProxyFilter, IBas
     {
         bool webcamDisabled = false;
         std::wstring newCameraName;
-        wil::com_ptr_nothrow<IStream> overlayImage;
     };
 
     SyncedSettings SyncCurrentSettings();
 
+    // Overwrites the frame with the overlay if the camera is muted, and delivers it downstream
+    void ProcessFrame(IMediaSample* sample);
+
+    // Returns the overlay sample fitting frames of frameSize bytes if it's ready, and requests it otherwise
+    wil::com_ptr_nothrow<IMFSample> PrepareOverlaySample(long frameSize);
+
+    // Returns a sample of _overlayAllocator holding the image, timed like the frame, or nullptr when the pool has no
+    // free buffer
+    wil::com_ptr_nothrow<IMediaSample> OverlayPoolSample(IMediaSample* frame, wil::com_ptr_nothrow<IMFSample>& image);
+    void CreateOverlayAllocator();
+
     HRESULT STDMETHODCALLTYPE Stop(void) override;
     HRESULT STDMETHODCALLTYPE Pause(void) override;
     HRESULT STDMETHODCALLTYPE Run(REFERENCE_TIME tStart) override;
@@ -69,6 +69,7 @@ HRESULT STDMETHODCALLTYPE DllCanUnloadNow()
     }
 
     winrt::clear_factory_cache();
+    StopLogging();
     return S_OK;
 }
 
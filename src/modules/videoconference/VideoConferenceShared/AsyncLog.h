@@ -0,0 +1,208 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <common/utils/mpsc_ring.h>
+
+// Hands the lines logged on any thread to a writer thread, which passes them to the sink in batches, so logging never
+// waits for the file system. The writer is started by the first line logged after construction or stop(). The sink is
+// only called by one thread at a time:
+// - write(std::vector<Line>&) writes a batch of lines
+// - dropped(uint64_t) records how many lines didn't fit into the ring since the last batch
+// - refresh() updates what the sink caches about the file system, at most once per refresh interval
+template<typename Line, typename Sink>
+class AsyncLogWriter
+{
+public:
+    struct Options
+    {
+        size_t capacity = 4096;
+        // How long lines wait for the writer at most, unless the ring gets half full before
+        std::chrono::milliseconds flush_interval{ 200 };
+        std::chrono::milliseconds refresh_interval{ 1000 };
+        size_t max_batch = 256;
+    };
+
+private:
+    Options _options;
+    MpscRing<Line> _ring;
+    Sink _sink;
+    std::atomic<uint64_t> _dropped = 0;
+    std::chrono::steady_clock::time_point _last_refresh;
+    bool _refreshed = false;
+
+    std::mutex _control_mutex;
+    std::atomic_bool _running = false;
+    std::thread _writer;
+
+    std::mutex _wake_mutex;
+    std::condition_variable _wake_cv;
+    bool _wake_requested = false;
+    bool _stopping = false;
+
+    void wake()
+    {
+        {
+            std::lock_guard lock{ _wake_mutex };
+            _wake_requested = true;
+        }
+        _wake_cv.notify_one();
+    }
+
+    void start()
+    {
+        std::lock_guard lock{ _control_mutex };
+        if (_running.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        {
+            std::lock_guard wakeLock{ _wake_mutex };
+            _stopping = false;
+        }
+
+        try
+        {
+            _writer = std::thread{ [this] { run(); } };
+            _running.store(true, std::memory_order_release);
+        }
+        catch (const std::system_error&)
+        {
+            // The lines stay in the ring until stop() or the destructor writes them
+        }
+    }
+
+    void run()
+    {
+        std::vector<Line> batch;
+        for (;;)
+        {
+            bool stopping = false;
+            {
+                std::unique_lock lock{ _wake_mutex };
+                _wake_cv.wait_for(lock, _options.flush_interval, [this] { return _wake_requested || _stopping; });
+                _wake_requested = false;
+                stopping = _stopping;
+            }
+
+            // Lines logged before stop() was called are written before the writer exits
+            write_queued(batch);
+            if (stopping)
+            {
+                return;
+            }
+        }
+    }
+
+    void write_queued(std::vector<Line>& batch)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        if (!_refreshed || now - _last_refresh >= _options.refresh_interval)
+        {
+            _sink.refresh();
+            _last_refresh = now;
+            _refreshed = true;
+        }
+
+        Line line;
+        while (_ring.try_pop(line))
+        {
+            batch.push_back(std::move(line));
+            if (batch.size() == _options.max_batch)
+            {
+                _sink.write(batch);
+                batch.clear();
+            }
+        }
+
+        if (const uint64_t dropped = _dropped.exchange(0, std::memory_order_relaxed))
+        {
+            _sink.dropped(dropped);
+        }
+
+        if (!batch.empty())
+        {
+            _sink.write(batch);
+            batch.clear();
+        }
+    }
+
+public:
+    template<typename... SinkArgs>
+    explicit AsyncLogWriter(const Options& options, SinkArgs&&... sinkArgs) :
+        _options{ options }, _ring{ options.capacity }, _sink{ std::forward<SinkArgs>(sinkArgs)... }
+    {
+    }
+
+    AsyncLogWriter(const AsyncLogWriter&) = delete;
+    AsyncLogWriter& operator=(const AsyncLogWriter&) = delete;
+
+    // Destroyed on process exit without stop(), the writer thread has been terminated already, so it's neither woken
+    // nor joined, and the lines it didn't write are written here
+    ~AsyncLogWriter()
+    {
+        if (_writer.joinable())
+        {
+            _writer.detach();
+        }
+
+        std::vector<Line> batch;
+        write_queued(batch);
+    }
+
+    // Never waits for the writer. The line is dropped and counted when the ring is full.
+    void log(Line line)
+    {
+        if (!_running.load(std::memory_order_acquire))
+        {
+            start();
+        }
+
+        if (!_ring.try_push(std::move(line)))
+        {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            wake();
+            return;
+        }
+
+        if (_ring.size() >= _ring.capacity() / 2)
+        {
+            wake();
+        }
+    }
+
+    // Writes every line logged before and joins the writer thread. Must be called before the module containing the
+    // writer is unloaded, but not while the loader lock is held.
+    void stop()
+    {
+        std::lock_guard lock{ _control_mutex };
+        if (_running.load(std::memory_order_relaxed))
+        {
+            {
+                std::lock_guard wakeLock{ _wake_mutex };
+                _stopping = true;
+            }
+            _wake_cv.notify_one();
+            _writer.join();
+            _running.store(false, std::memory_order_release);
+        }
+
+        std::vector<Line> batch;
+        write_queued(batch);
+    }
+
+    const Sink& sink() const noexcept
+    {
+        return _sink;
+    }
+};
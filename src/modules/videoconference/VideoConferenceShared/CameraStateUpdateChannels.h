@@ -3,16 +3,28 @@
 #include <optional>
 #include <string_view>
 #include <array>
+#include <atomic>
 
-struct alignas(16) CameraSettingsUpdateChannel
+#include "VersionedChannel.h"
+
+// Published by the module, read by the proxy filter for every frame
+struct CameraSettings
 {
     bool useOverlayImage = false;
-    bool cameraInUse = false;
 
     std::optional<uint32_t> overlayImageSize;
     std::optional<std::array<wchar_t, 256>> sourceCameraName;
 
-    bool newOverlayImagePosted = false;
+    // Incremented for every posted overlay image, so every proxy filter instance notices it
+    uint32_t overlayImageGeneration = 0;
+};
+
+struct alignas(16) CameraSettingsUpdateChannel
+{
+    VersionedChannel<CameraSettings> settings;
+
+    // Set by the proxy filter, which only writes it when it changes so its frames don't write to the shared memory
+    std::atomic<bool> cameraInUse = false;
 
     static std::wstring_view endpoint();
 };
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+
+// Virtual-key codes of the modifier keys, as in WinUser.h. The low-level keyboard hook reports the left and right keys,
+// injected input may report the generic ones.
+namespace ModifierVirtualKeys
+{
+    constexpr uint32_t Shift = 0x10;
+    constexpr uint32_t Control = 0x11;
+    constexpr uint32_t Menu = 0x12;
+    constexpr uint32_t LeftWin = 0x5B;
+    constexpr uint32_t RightWin = 0x5C;
+    constexpr uint32_t LeftShift = 0xA0;
+    constexpr uint32_t RightShift = 0xA1;
+    constexpr uint32_t LeftControl = 0xA2;
+    constexpr uint32_t RightControl = 0xA3;
+    constexpr uint32_t LeftMenu = 0xA4;
+    constexpr uint32_t RightMenu = 0xA5;
+}
+
+// Bits of the modifier mask of a hotkey
+namespace HotkeyModifiers
+{
+    constexpr uint8_t Shift = 1;
+    constexpr uint8_t Control = 2;
+    constexpr uint8_t Win = 4;
+    constexpr uint8_t Alt = 8;
+    constexpr uint8_t Count = 16;
+}
+
+// The modifier keys held down, tracked from the key events instead of asking for the key state on every event. Every
+// modifier key has a bit in keys_down(), so a caller can resync the state from the system.
+class ModifierKeys
+{
+    uint8_t _keys_down = 0;
+
+public:
+    constexpr static uint32_t KEYS[] = {
+        ModifierVirtualKeys::LeftShift, ModifierVirtualKeys::RightShift, ModifierVirtualKeys::LeftControl,
+        ModifierVirtualKeys::RightControl, ModifierVirtualKeys::LeftWin, ModifierVirtualKeys::RightWin,
+        ModifierVirtualKeys::LeftMenu, ModifierVirtualKeys::RightMenu,
+    };
+
+    // The bit of the modifier key in keys_down(), or 0 for other keys. The generic keys count as the left ones.
+    constexpr static uint8_t key_bit(const uint32_t vk) noexcept
+    {
+        switch (vk)
+        {
+        case ModifierVirtualKeys::Shift:
+            return key_bit(ModifierVirtualKeys::LeftShift);
+        case ModifierVirtualKeys::Control:
+            return key_bit(ModifierVirtualKeys::LeftControl);
+        case ModifierVirtualKeys::Menu:
+            return key_bit(ModifierVirtualKeys::LeftMenu);
+        }
+
+        for (uint8_t i = 0; i < std::size(KEYS); ++i)
+        {
+            if (KEYS[i] == vk)
+            {
+                return static_cast<uint8_t>(1u << i);
+            }
+        }
+
+        return 0;
+    }
+
+    // Returns false if the key isn't a modifier key
+    bool update(const uint32_t vk, const bool down) noexcept
+    {
+        const uint8_t bit = key_bit(vk);
+        if (down)
+        {
+            _keys_down |= bit;
+        }
+        else
+        {
+            _keys_down &= ~bit;
+        }
+
+        return bit != 0;
+    }
+
+    void assign(const uint8_t keys_down) noexcept
+    {
+        _keys_down = keys_down;
+    }
+
+    uint8_t keys_down() const noexcept
+    {
+        return _keys_down;
+    }
+
+    // Either Shift or Control key sets its modifier, but only the left Windows and Alt keys do, as the module has always
+    // checked them
+    constexpr static uint8_t mask(const uint8_t keys_down) noexcept
+    {
+        const auto any = [keys_down](const uint32_t left, const uint32_t right) {
+            return (keys_down & (key_bit(left) | key_bit(right))) != 0;
+        };
+
+        uint8_t result = 0;
+        result |= any(ModifierVirtualKeys::LeftShift, ModifierVirtualKeys::RightShift) ? HotkeyModifiers::Shift : 0;
+        result |= any(ModifierVirtualKeys::LeftControl, ModifierVirtualKeys::RightControl) ? HotkeyModifiers::Control : 0;
+        result |= (keys_down & key_bit(ModifierVirtualKeys::LeftWin)) ? HotkeyModifiers::Win : 0;
+        result |= (keys_down & key_bit(ModifierVirtualKeys::LeftMenu)) ? HotkeyModifiers::Alt : 0;
+        return result;
+    }
+
+    uint8_t mask() const noexcept
+    {
+        return mask(_keys_down);
+    }
+};
+
+// The configured hotkeys compiled into a table indexed by the virtual-key code and the modifier mask, so matching a key
+// event takes a single lookup. Action is an enum whose value-initialized value means no hotkey. The table is rebuilt
+// by another thread than the one matching the events, so an event matched while it's rebuilt may miss a hotkey being
+// rebound, but never sees a torn entry. The tracked modifier keys belong to the matching thread.
+template<typename Action>
+class HotkeyMatcher
+{
+    static_assert(sizeof(Action) == 1);
+    static_assert(std::atomic<Action>::is_always_lock_free);
+
+    constexpr static inline size_t KEYS = 256;
+
+    std::array<std::atomic<Action>, KEYS * HotkeyModifiers::Count> _actions{};
+    // Whether the key is bound with any modifiers
+    std::array<std::atomic_bool, KEYS> _hotkey_keys{};
+    ModifierKeys _modifiers;
+    // The key whose modifiers were read last, until another event comes, so the repeats of a held hotkey aren't read
+    uint32_t _confirmed_vk = 0;
+    uint64_t _resyncs = 0;
+
+public:
+    struct Statistics
+    {
+        uint64_t resyncs = 0;
+    };
+
+    void clear() noexcept
+    {
+        for (auto& action : _actions)
+        {
+            action.store(Action{}, std::memory_order_relaxed);
+        }
+
+        for (auto& key : _hotkey_keys)
+        {
+            key.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // A combination bound already keeps its action, so the hotkeys are added from the highest priority down. Keys
+    // outside of the virtual-key range, like the 0 of an unset hotkey, are ignored.
+    void add(const uint32_t vk, const uint8_t modifiers, const Action action) noexcept
+    {
+        if (vk == 0 || vk >= KEYS || modifiers >= HotkeyModifiers::Count)
+        {
+            return;
+        }
+
+        auto& entry = _actions[vk * HotkeyModifiers::Count + modifiers];
+        if (entry.load(std::memory_order_relaxed) == Action{})
+        {
+            entry.store(action, std::memory_order_relaxed);
+        }
+
+        _hotkey_keys[vk].store(true, std::memory_order_relaxed);
+    }
+
+    Action find(const uint32_t vk, const uint8_t modifiers) const noexcept
+    {
+        return vk < KEYS ? _actions[vk * HotkeyModifiers::Count + modifiers].load(std::memory_order_relaxed) : Action{};
+    }
+
+    // To be called for every key event, so the modifier keys are tracked
+    void on_key(const uint32_t vk, const bool down) noexcept
+    {
+        _modifiers.update(vk, down);
+        if (!down || vk != _confirmed_vk)
+        {
+            _confirmed_vk = 0;
+        }
+    }
+
+    // Replaces the tracked modifier keys, e.g. when the hook is installed while keys are held
+    void resync(const uint8_t keys_down) noexcept
+    {
+        _modifiers.assign(keys_down);
+        _confirmed_vk = 0;
+    }
+
+    // Matches a key down against the hotkeys with the tracked modifiers. A key up of a modifier missed by the hook, e.g.
+    // when the session is locked while it's held, would leave the key down for good, so read_keys_down(), returning
+    // the ModifierKeys bits of the keys actually held, confirms a match before it's reported, and is asked again when
+    // a hotkey key is pressed with tracked modifiers matching no hotkey. Other keys, and the repeats of a key held
+    // since it was confirmed, never call it.
+    template<typename ReadKeysDown>
+    Action match(const uint32_t vk, ReadKeysDown&& read_keys_down)
+    {
+        if (vk >= KEYS || !_hotkey_keys[vk].load(std::memory_order_relaxed))
+        {
+            return Action{};
+        }
+
+        const uint8_t tracked = _modifiers.keys_down();
+        const Action action = find(vk, ModifierKeys::mask(tracked));
+        if ((action == Action{} && tracked == 0) || vk == _confirmed_vk)
+        {
+            return action;
+        }
+
+        const uint8_t held = read_keys_down();
+        _confirmed_vk = vk;
+        if (held == tracked)
+        {
+            return action;
+        }
+
+        ++_resyncs;
+        _modifiers.assign(held);
+        return find(vk, ModifierKeys::mask(held));
+    }
+
+    uint8_t modifiers() const noexcept
+    {
+        return _modifiers.mask();
+    }
+
+    Statistics stats() const noexcept
+    {
+        return { _resyncs };
+    }
+};
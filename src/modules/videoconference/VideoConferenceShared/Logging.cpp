@@ -1,72 +1,159 @@
 #include "Logging.h"
 
-#include <iostream>
-#include <fstream>
-#include <mutex>
-#include <iomanip>
+#include <atomic>
 #include <chrono>
+#include <ctime>
 #include <filesystem>
 
 #include <initguid.h>
 #include <mfapi.h>
 
-#pragma warning(disable : 4127)
+#include <wil/resource.h>
 
-static std::mutex logMutex;
-constexpr inline size_t maxLogSizeMegabytes = 10;
-constexpr inline bool alwaysLogVerbose = true;
+#include "AsyncLog.h"
 
-void LogToFile(std::wstring what, const bool verbose)
+#pragma warning(disable : 4127)
+
+namespace
 {
-    std::error_code _;
-    const auto tempPath = std::filesystem::temp_directory_path(_);
-    if (verbose)
+    constexpr inline size_t maxLogSizeMegabytes = 10;
+    constexpr inline bool alwaysLogVerbose = true;
+
+    // Refreshed by the log writer, so logging a verbose line doesn't touch the file system
+    std::atomic_bool verboseIndicatorFilePresent = false;
+
+    struct LogLine
     {
-        const bool verboseIndicatorFilePresent = std::filesystem::exists(tempPath / L"PowerToysVideoConferenceVerbose.flag", _);
-        if (!alwaysLogVerbose && !verboseIndicatorFilePresent)
+        std::chrono::system_clock::time_point time;
+        std::wstring what;
+    };
+
+    // Appends batches of lines to the log file through a handle which stays open. The log is shared with the other
+    // processes using the filter, so it's opened for appending only.
+    class LogFileSink
+    {
+        wil::unique_hfile _file;
+        std::filesystem::path _logFilePath;
+        bool _sessionStarted = false;
+        std::string _buffer;
+
+        void append_prefix(const std::chrono::system_clock::time_point time)
         {
-            return;
+            time_t now = std::chrono::system_clock::to_time_t(time);
+            std::tm tm;
+            localtime_s(&tm, &now);
+            char prefix[64];
+            const auto pid = GetCurrentProcessId();
+            const int pidLength = sprintf_s(prefix, "[%ld]", pid);
+            std::strftime(prefix + pidLength, sizeof(prefix) - pidLength, "[%d.%m %H:%M:%S] ", &tm);
+            _buffer += prefix;
         }
-    }
-    time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-    std::tm tm;
-    localtime_s(&tm, &now);
-    char prefix[64];
-    const auto pid = GetCurrentProcessId();
-    const auto iter = prefix + sprintf_s(prefix, "[%ld]", pid);
-    std::strftime(iter, sizeof(prefix) - (prefix - iter), "[%d.%m %H:%M:%S] ", &tm);
-
-    std::lock_guard lock{ logMutex };
-    std::wstring logFilePath = tempPath;
+
+        void append_text(const std::wstring& what)
+        {
+            if (what.empty())
+            {
+                return;
+            }
+
+            const int length = WideCharToMultiByte(CP_UTF8, 0, what.data(), static_cast<int>(what.size()), nullptr, 0, nullptr, nullptr);
+            if (length <= 0)
+            {
+                return;
+            }
+
+            const size_t offset = _buffer.size();
+            _buffer.resize(offset + length);
+            WideCharToMultiByte(CP_UTF8, 0, what.data(), static_cast<int>(what.size()), _buffer.data() + offset, length, nullptr, nullptr);
+        }
+
+        void flush()
+        {
+            if (!_file || _buffer.empty())
+            {
+                _buffer.clear();
+                return;
+            }
+
+            DWORD written = 0;
+            WriteFile(_file.get(), _buffer.data(), static_cast<DWORD>(_buffer.size()), &written, nullptr);
+            _buffer.clear();
+        }
+
+    public:
+        void refresh()
+        {
+            std::error_code _;
+            const auto tempPath = std::filesystem::temp_directory_path(_);
+            verboseIndicatorFilePresent = std::filesystem::exists(tempPath / L"PowerToysVideoConferenceVerbose.flag", _);
+
+            if (!_file)
+            {
+                _logFilePath = tempPath;
 #if defined(_WIN64)
-    logFilePath += L"\\PowerToysVideoConference_x64.log";
+                _logFilePath /= L"PowerToysVideoConference_x64.log";
 #elif defined(_WIN32)
-    logFilePath += L"\\PowerToysVideoConference_x86.log";
+                _logFilePath /= L"PowerToysVideoConference_x86.log";
 #endif
-    size_t logSizeMBs = 0;
-    try
-    {
-        logSizeMBs = static_cast<size_t>(std::filesystem::file_size(logFilePath) >> 20);
-    }
-    catch (...)
+                _file.reset(CreateFileW(_logFilePath.c_str(),
+                                        FILE_APPEND_DATA,
+                                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                        nullptr,
+                                        OPEN_ALWAYS,
+                                        FILE_ATTRIBUTE_NORMAL,
+                                        nullptr));
+            }
+
+            LARGE_INTEGER logSize{};
+            if (_file && GetFileSizeEx(_file.get(), &logSize) && static_cast<size_t>(logSize.QuadPart >> 20) > maxLogSizeMegabytes)
+            {
+                // Truncate the log file to zero, the handle keeps appending at its new end
+                std::filesystem::resize_file(_logFilePath, 0, _);
+            }
+        }
+
+        void write(const std::vector<LogLine>& lines)
+        {
+            if (!_sessionStarted)
+            {
+                append_prefix(lines.front().time);
+                _buffer += "\n\n<<<NEW SESSION>>\n";
+                _sessionStarted = true;
+            }
+
+            for (const auto& line : lines)
+            {
+                append_prefix(line.time);
+                append_text(line.what);
+                _buffer += '\n';
+            }
+
+            flush();
+        }
+
+        void dropped(const uint64_t lines)
+        {
+            append_prefix(std::chrono::system_clock::now());
+            _buffer += std::to_string(lines) + " log lines were dropped, because they were logged faster than written\n";
+            flush();
+        }
+    };
+
+    AsyncLogWriter<LogLine, LogFileSink>& LogWriter()
     {
+        static AsyncLogWriter<LogLine, LogFileSink> writer{ AsyncLogWriter<LogLine, LogFileSink>::Options{} };
+        return writer;
     }
-    if (logSizeMBs > maxLogSizeMegabytes)
+}
+
+void LogToFile(std::wstring what, const bool verbose)
+{
+    if (verbose && !alwaysLogVerbose && !verboseIndicatorFilePresent.load(std::memory_order_relaxed))
     {
-        std::error_code __;
-        // Truncate the log file to zero
-        std::filesystem::resize_file(logFilePath, 0, __);
+        return;
     }
-    std::wofstream myfile;
-    myfile.open(logFilePath, std::fstream::app);
-
-    static const auto newLaunch = [&] {
-        myfile << prefix << "\n\n<<<NEW SESSION>>";
-        return 0;
-    }();
 
-    myfile << prefix << what << "\n";
-    myfile.close();
+    LogWriter().log(LogLine{ std::chrono::system_clock::now(), std::move(what) });
 }
 
 void LogToFile(std::string what, const bool verbose)
@@ -75,6 +162,11 @@ void LogToFile(std::string what, const bool verbose)
     LogToFile(std::move(native), verbose);
 }
 
+void StopLogging()
+{
+    LogWriter().stop();
+}
+
 std::string toMediaTypeString(GUID subtype)
 {
     if (subtype == MFVideoFormat_YUY2)
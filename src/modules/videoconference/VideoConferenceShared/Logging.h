@@ -9,6 +9,9 @@
 
 void LogToFile(std::string what, const bool verbose = false);
 void LogToFile(std::wstring what, const bool verbose = false);
+// Lines are written to the log file by a background thread. Writes the lines logged so far and stops the thread,
+// which the next line logged starts again. Must be called before the module is unloaded, outside of DllMain.
+void StopLogging();
 std::string toMediaTypeString(GUID subtype);
 
 #define RETURN_IF_FAILED_WITH_LOGGING(val)                                                             \
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// The mute states to apply, an unset one is left as it is
+struct MuteTargets
+{
+    std::optional<bool> microphone;
+    std::optional<bool> camera;
+};
+
+// Applies the mute states the keyboard hook asks for on a worker thread, so the hook never waits for an audio driver.
+// A request replaces the state of the same device still pending, so toggles and push-to-talk bursts faster than the
+// devices take them are collapsed into the last state asked for. Until a state is applied, targets() tells it, so the
+// next toggle flips the state asked for instead of the one the devices still have.
+class MuteDispatcher
+{
+public:
+    enum class Device
+    {
+        Microphone,
+        Camera,
+    };
+
+    // Runs apply(i) for every i < count, in parallel, and returns once all of them returned
+    using ForEach = std::function<void(size_t count, const std::function<void(size_t)>& apply)>;
+
+    struct Handlers
+    {
+        // Runs the body of every thread of the dispatcher, e.g. in a COM apartment
+        std::function<void(const std::function<void()>& body)> run_thread;
+        // Mutes or unmutes the controlled microphones, applying the devices through for_each
+        std::function<void(bool muted, const ForEach& for_each)> mute_microphones;
+        std::function<void(bool muted)> mute_camera;
+        // Called on the worker once the state is applied
+        std::function<void(Device device, bool muted)> applied;
+    };
+
+    struct Statistics
+    {
+        uint64_t requests = 0;
+        uint64_t microphone_applies = 0;
+        uint64_t camera_applies = 0;
+    };
+
+    explicit MuteDispatcher(Handlers handlers) :
+        _handlers{ std::move(handlers) }
+    {
+    }
+
+    MuteDispatcher(const MuteDispatcher&) = delete;
+    MuteDispatcher& operator=(const MuteDispatcher&) = delete;
+
+    ~MuteDispatcher()
+    {
+        stop();
+    }
+
+    // Never waits for a state being applied. The worker starts with the first request.
+    void request(const MuteTargets& targets)
+    {
+        {
+            std::unique_lock lock{ _mutex };
+            ++_statistics.requests;
+            merge(_pending, targets);
+            merge(_targets, targets);
+            if (!_worker.joinable())
+            {
+                _stopping = false;
+                _worker = std::thread{ [this] { run_thread([this] { run(); }); } };
+            }
+        }
+
+        _cv.notify_one();
+    }
+
+    // The states asked for and not applied yet
+    MuteTargets targets() const
+    {
+        std::unique_lock lock{ _mutex };
+        return _targets;
+    }
+
+    // Applies the pending states and joins the worker. A later request starts it again.
+    void stop()
+    {
+        {
+            std::unique_lock lock{ _mutex };
+            _stopping = true;
+        }
+
+        _cv.notify_one();
+        if (_worker.joinable())
+        {
+            _worker.join();
+        }
+    }
+
+    Statistics stats() const
+    {
+        std::unique_lock lock{ _mutex };
+        return _statistics;
+    }
+
+private:
+    static void merge(MuteTargets& into, const MuteTargets& targets)
+    {
+        if (targets.microphone)
+        {
+            into.microphone = targets.microphone;
+        }
+
+        if (targets.camera)
+        {
+            into.camera = targets.camera;
+        }
+    }
+
+    void for_each(const size_t count, const std::function<void(size_t)>& apply) const
+    {
+        // Toggles come at the pace of a person pressing keys, so the threads of the other devices aren't pooled
+        std::vector<std::thread> helpers;
+        for (size_t i = 1; i < count; ++i)
+        {
+            helpers.emplace_back([this, i, &apply] { run_thread([i, &apply] { apply(i); }); });
+        }
+
+        if (count > 0)
+        {
+            apply(0);
+        }
+
+        for (auto& helper : helpers)
+        {
+            helper.join();
+        }
+    }
+
+    void run_thread(const std::function<void()>& body) const
+    {
+        if (_handlers.run_thread)
+        {
+            _handlers.run_thread(body);
+        }
+        else
+        {
+            body();
+        }
+    }
+
+    void run()
+    {
+        const ForEach forEach = [this](const size_t count, const std::function<void(size_t)>& apply) {
+            for_each(count, apply);
+        };
+
+        std::unique_lock lock{ _mutex };
+        while (true)
+        {
+            _cv.wait(lock, [this] { return _stopping || _pending.microphone || _pending.camera; });
+            const MuteTargets taken = _pending;
+            _pending = {};
+            if (!taken.microphone && !taken.camera)
+            {
+                break;
+            }
+
+            lock.unlock();
+            if (taken.camera)
+            {
+                _handlers.mute_camera(*taken.camera);
+            }
+
+            if (taken.microphone)
+            {
+                _handlers.mute_microphones(*taken.microphone, forEach);
+            }
+
+            lock.lock();
+            // A state asked for meanwhile is still the target
+            if (taken.camera)
+            {
+                ++_statistics.camera_applies;
+                if (!_pending.camera)
+                {
+                    _targets.camera.reset();
+                }
+            }
+
+            if (taken.microphone)
+            {
+                ++_statistics.microphone_applies;
+                if (!_pending.microphone)
+                {
+                    _targets.microphone.reset();
+                }
+            }
+
+            lock.unlock();
+            if (_handlers.applied)
+            {
+                if (taken.camera)
+                {
+                    _handlers.applied(Device::Camera, *taken.camera);
+                }
+
+                if (taken.microphone)
+                {
+                    _handlers.applied(Device::Microphone, *taken.microphone);
+                }
+            }
+
+            lock.lock();
+        }
+    }
+
+    Handlers _handlers;
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+    MuteTargets _pending;
+    MuteTargets _targets;
+    bool _stopping = false;
+    Statistics _statistics;
+    std::thread _worker;
+};
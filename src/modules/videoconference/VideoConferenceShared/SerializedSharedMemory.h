@@ -36,6 +36,9 @@ public:
     void access(std::function<void(memory_t)> access_routine) noexcept;
     inline size_t size() const noexcept { return _memory._size; }
 
+    // For memory synchronized by its own atomics, e.g. a VersionedChannel, rather than by access()
+    inline uint8_t* data() const noexcept { return _memory._data; }
+
     ~SerializedSharedMemory() noexcept;
     SerializedSharedMemory(SerializedSharedMemory&&) noexcept;
     SerializedSharedMemory& operator=(SerializedSharedMemory&&) noexcept;
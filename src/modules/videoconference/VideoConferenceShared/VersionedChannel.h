@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(_M_ARM64)
+#include <intrin.h>
+#endif
+
+// Seqlock-style channel publishing a trivially copyable value through memory shared between processes. Readers never
+// take a lock: they compare the generation with the one they copied last and copy the value only if it changed,
+// retrying if a writer published meanwhile. Writers are serialized by making the generation odd while they write, so
+// a writer which dies while writing blocks the other writers, but never the readers. The layout only depends on T, so
+// x86 and x64 processes can share it.
+template<typename T>
+class VersionedChannel
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+    constexpr static inline size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    // Odd while a writer writes
+    std::atomic<uint32_t> _generation = 0;
+    // The value is copied word by word with atomic accesses, so a torn copy is discarded instead of being a data race
+    std::array<std::atomic<uint32_t>, WORDS> _words;
+
+    static void pause() noexcept
+    {
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+        _mm_pause();
+#elif defined(_M_ARM64)
+        __yield();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    void load_words(T& value) const noexcept
+    {
+        std::array<uint32_t, WORDS> words;
+        for (size_t i = 0; i < WORDS; ++i)
+        {
+            words[i] = _words[i].load(std::memory_order_relaxed);
+        }
+
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+    }
+
+    void store_words(const T& value) noexcept
+    {
+        std::array<uint32_t, WORDS> words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+        for (size_t i = 0; i < WORDS; ++i)
+        {
+            _words[i].store(words[i], std::memory_order_relaxed);
+        }
+    }
+
+public:
+    // A generation no value is published with, for readers which haven't copied anything yet
+    constexpr static inline uint32_t UNREAD = 1;
+
+    explicit VersionedChannel(const T& value = {}) noexcept
+    {
+        store_words(value);
+    }
+
+    VersionedChannel(const VersionedChannel&) = delete;
+    VersionedChannel& operator=(const VersionedChannel&) = delete;
+
+    uint32_t generation() const noexcept
+    {
+        return _generation.load(std::memory_order_acquire);
+    }
+
+    // Copies the value if it was published after the generation the caller copied last, and updates that generation.
+    // Returns false without blocking if nothing changed, or if a writer is writing, in which case the caller keeps the
+    // value it has and tries again on its next call.
+    bool read_if_changed(uint32_t& seen_generation, T& value, const int attempts = 64) const noexcept
+    {
+        for (int attempt = 0; attempt < attempts; ++attempt)
+        {
+            const uint32_t before = _generation.load(std::memory_order_acquire);
+            if (before == seen_generation)
+            {
+                return false;
+            }
+
+            if (before & 1)
+            {
+                pause();
+                continue;
+            }
+
+            T copy;
+            load_words(copy);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_generation.load(std::memory_order_relaxed) == before)
+            {
+                value = copy;
+                seen_generation = before;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Waits for the writer, if any, for callers which need the value, e.g. to show it
+    T read() const noexcept
+    {
+        T value{};
+        uint32_t seen_generation = UNREAD;
+        while (!read_if_changed(seen_generation, value))
+        {
+            std::this_thread::yield();
+        }
+
+        return value;
+    }
+
+    // Changes the value with update_routine(T&) and publishes it, after the other writers. The routine gets the value
+    // last published.
+    template<typename Fn>
+    void update(Fn&& update_routine) noexcept
+    {
+        uint32_t current = _generation.load(std::memory_order_relaxed);
+        while ((current & 1) || !_generation.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            if (current & 1)
+            {
+                pause();
+                current = _generation.load(std::memory_order_relaxed);
+            }
+        }
+
+        // The odd generation is visible before any of the words change
+        std::atomic_thread_fence(std::memory_order_release);
+
+        T value;
+        load_words(value);
+        update_routine(value);
+        store_words(value);
+        _generation.store(current + 2, std::memory_order_release);
+    }
+};
@@ -478,7 +478,9 @@ void run_settings_window(bool show_oobe_window, bool show_scoobe_window, std::op
 
     {
         std::unique_lock lock{ ipc_mutex };
-        current_settings_ipc = new TwoWayPipeMessageIPC(powertoys_pipe_name, settings_pipe_name, receive_json_send_to_main_thread);
+        current_settings_ipc = new TwoWayPipeMessageIPC(powertoys_pipe_name, settings_pipe_name, receive_json_send_to_main_thread, true, [](const std::wstring& error) {
+            Logger::warn(L"Settings pipe: {}", error);
+        });
         current_settings_ipc->start(hToken);
     }
     g_settings_process_id = process_info.dwProcessId;
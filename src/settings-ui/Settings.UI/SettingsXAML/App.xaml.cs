@@ -153,13 +153,18 @@ namespace Microsoft.PowerToys.Settings.UI
                     Environment.Exit(0);
                 });
 
-                ipcmanager = new TwoWayPipeMessageIPCManaged(cmdArgs[(int)Arguments.SettingsPipeName], cmdArgs[(int)Arguments.PTPipeName], (string message) =>
-                {
-                    if (IPCMessageReceivedCallback != null && message.Length > 0)
+                // The runner talks to Settings in the session mode
+                ipcmanager = new TwoWayPipeMessageIPCManaged(
+                    cmdArgs[(int)Arguments.SettingsPipeName],
+                    cmdArgs[(int)Arguments.PTPipeName],
+                    (string message) =>
                     {
-                        IPCMessageReceivedCallback(message);
-                    }
-                });
+                        if (IPCMessageReceivedCallback != null && message.Length > 0)
+                        {
+                            IPCMessageReceivedCallback(message);
+                        }
+                    },
+                    true);
                 ipcmanager.Start();
 
                 if (!ShowOobe && !ShowScoobe && !ShowFlyout)
@@ -0,0 +1,56 @@
+#include "pch.h"
+
+#include <binary_log_decoder.h>
+
+// Turns the .bin files the logger writes when "logFormat" is "binary" into the text the text log would have had
+int wmain(int argc, wchar_t* argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::wcout << L"Usage: PowerToys.BinaryLogDecoder.exe <log.bin> [output.txt]\n"
+                   << L"  Writes the messages of the binary log as text, next to it when no output file is given.\n";
+        return 1;
+    }
+
+    const std::filesystem::path input = argv[1];
+    const std::filesystem::path output = argc == 3 ? std::filesystem::path{ argv[2] } : std::filesystem::path{ input }.replace_extension(L".txt");
+
+    std::ifstream stream{ input, std::ios::binary };
+    if (!stream)
+    {
+        std::wcerr << L"Can't open " << input.wstring() << L"\n";
+        return 1;
+    }
+
+    const std::string data{ std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{} };
+    std::string text;
+    const auto result = binary_log::decode(data, [&text](const binary_log::event& e) { binary_log::render(e, text); });
+
+    if (result.events == 0 && !result.error.empty())
+    {
+        std::wcerr << input.wstring() << L" can't be decoded: " << std::wstring(result.error.begin(), result.error.end()) << L"\n";
+        return 1;
+    }
+
+    std::ofstream file{ output, std::ios::binary };
+    file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    if (!file)
+    {
+        std::wcerr << L"Can't write " << output.wstring() << L"\n";
+        return 1;
+    }
+
+    std::wcout << result.events << L" messages in " << result.formats << L" formats written to " << output.wstring() << L"\n";
+    if (!result.error.empty())
+    {
+        std::wcerr << L"The log is damaged, decoding stopped: " << std::wstring(result.error.begin(), result.error.end()) << L"\n";
+        return 1;
+    }
+
+    if (!result.complete)
+    {
+        std::wcout << L"The last message was cut, as when the process stopped while writing it\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#define NOMINMAX
+#include <Windows.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>